@@ -52,40 +52,54 @@
 #define REKEY_BASE	(1024*1024) /* NB. should be a power of 2 */
 
 /* Marked MAP_INHERIT_ZERO, so zero'd out in fork children. */
-static struct _rs {
+struct _rs {
 	size_t		rs_have;	/* valid bytes at end of rs_buf */
 	size_t		rs_count;	/* bytes till reseed */
-} *rs;
+	volatile u_int	rs_busy;	/* in use by a thread, see _rs_get() */
+};
 
 /* Maybe be preserved in fork children, if _rs_allocate() decides. */
-static struct _rsx {
+struct _rsx {
 	chacha_ctx	rs_chacha;	/* chacha context for random keystream */
 	u_char		rs_buf[RSBUFSZ];	/* keystream blocks */
-} *rsx;
+};
 
 static inline int _rs_allocate(struct _rs **, struct _rsx **);
-static inline void _rs_forkdetect(void);
+static inline void _rs_forkdetect(struct _rs *);
 #include "arc4random.h"
 
-static inline void _rs_rekey(u_char *dat, size_t datlen);
+/*
+ * Number of independent keystream states, which may be raised by
+ * arc4random.h to avoid serialising threads on _ARC4_LOCK.
+ */
+#ifndef _RS_NSTATES
+#define _RS_NSTATES	1
+#endif
+
+static struct _rss {
+	struct _rs	*rs;
+	struct _rsx	*rsx;
+} _rss[_RS_NSTATES];
+
+static inline void _rs_rekey(struct _rss *, u_char *dat, size_t datlen);
 
 static inline void
-_rs_init(u_char *buf, size_t n)
+_rs_init(struct _rss *rss, u_char *buf, size_t n)
 {
 	if (n < KEYSZ + IVSZ)
 		return;
 
-	if (rs == NULL) {
-		if (_rs_allocate(&rs, &rsx) == -1)
+	if (rss->rs == NULL) {
+		if (_rs_allocate(&rss->rs, &rss->rsx) == -1)
 			_exit(1);
 	}
 
-	chacha_keysetup(&rsx->rs_chacha, buf, KEYSZ * 8);
-	chacha_ivsetup(&rsx->rs_chacha, buf + KEYSZ);
+	chacha_keysetup(&rss->rsx->rs_chacha, buf, KEYSZ * 8);
+	chacha_ivsetup(&rss->rsx->rs_chacha, buf + KEYSZ);
 }
 
 static void
-_rs_stir(void)
+_rs_stir(struct _rss *rss)
 {
 	u_char rnd[KEYSZ + IVSZ];
 	uint32_t rekey_fuzz = 0;
@@ -93,37 +107,39 @@ _rs_stir(void)
 	if (getentropy(rnd, sizeof rnd) == -1)
 		_getentropy_fail();
 
-	if (!rs)
-		_rs_init(rnd, sizeof(rnd));
+	if (!rss->rs)
+		_rs_init(rss, rnd, sizeof(rnd));
 	else
-		_rs_rekey(rnd, sizeof(rnd));
+		_rs_rekey(rss, rnd, sizeof(rnd));
 	explicit_bzero(rnd, sizeof(rnd));	/* discard source seed */
 
 	/* invalidate rs_buf */
-	rs->rs_have = 0;
-	memset(rsx->rs_buf, 0, sizeof(rsx->rs_buf));
+	rss->rs->rs_have = 0;
+	memset(rss->rsx->rs_buf, 0, sizeof(rss->rsx->rs_buf));
 
 	/* rekey interval should not be predictable */
-	chacha_encrypt_bytes(&rsx->rs_chacha, (uint8_t *)&rekey_fuzz,
+	chacha_encrypt_bytes(&rss->rsx->rs_chacha, (uint8_t *)&rekey_fuzz,
 	    (uint8_t *)&rekey_fuzz, sizeof(rekey_fuzz));
-	rs->rs_count = REKEY_BASE + (rekey_fuzz % REKEY_BASE);
+	rss->rs->rs_count = REKEY_BASE + (rekey_fuzz % REKEY_BASE);
 }
 
 static inline void
-_rs_stir_if_needed(size_t len)
+_rs_stir_if_needed(struct _rss *rss, size_t len)
 {
-	_rs_forkdetect();
-	if (!rs || rs->rs_count <= len)
-		_rs_stir();
-	if (rs->rs_count <= len)
-		rs->rs_count = 0;
+	_rs_forkdetect(rss->rs);
+	if (!rss->rs || rss->rs->rs_count <= len)
+		_rs_stir(rss);
+	if (rss->rs->rs_count <= len)
+		rss->rs->rs_count = 0;
 	else
-		rs->rs_count -= len;
+		rss->rs->rs_count -= len;
 }
 
 static inline void
-_rs_rekey(u_char *dat, size_t datlen)
+_rs_rekey(struct _rss *rss, u_char *dat, size_t datlen)
 {
+	struct _rsx *rsx = rss->rsx;
+
 #ifndef KEYSTREAM_ONLY
 	memset(rsx->rs_buf, 0, sizeof(rsx->rs_buf));
 #endif
@@ -139,57 +155,130 @@ _rs_rekey(u_char *dat, size_t datlen)
 			rsx->rs_buf[i] ^= dat[i];
 	}
 	/* immediately reinit for backtracking resistance */
-	_rs_init(rsx->rs_buf, KEYSZ + IVSZ);
+	_rs_init(rss, rsx->rs_buf, KEYSZ + IVSZ);
 	memset(rsx->rs_buf, 0, KEYSZ + IVSZ);
-	rs->rs_have = sizeof(rsx->rs_buf) - KEYSZ - IVSZ;
+	rss->rs->rs_have = sizeof(rsx->rs_buf) - KEYSZ - IVSZ;
 }
 
 static inline void
-_rs_random_buf(void *_buf, size_t n)
+_rs_random_buf(struct _rss *rss, void *_buf, size_t n)
 {
 	u_char *buf = (u_char *)_buf;
 	u_char *keystream;
 	size_t m;
 
-	_rs_stir_if_needed(n);
+	_rs_stir_if_needed(rss, n);
 	while (n > 0) {
-		if (rs->rs_have > 0) {
-			m = minimum(n, rs->rs_have);
-			keystream = rsx->rs_buf + sizeof(rsx->rs_buf)
-			    - rs->rs_have;
+		if (rss->rs->rs_have > 0) {
+			m = minimum(n, rss->rs->rs_have);
+			keystream = rss->rsx->rs_buf + sizeof(rss->rsx->rs_buf)
+			    - rss->rs->rs_have;
 			memcpy(buf, keystream, m);
 			memset(keystream, 0, m);
 			buf += m;
 			n -= m;
-			rs->rs_have -= m;
+			rss->rs->rs_have -= m;
 		}
-		if (rs->rs_have == 0)
-			_rs_rekey(NULL, 0);
+		if (rss->rs->rs_have == 0)
+			_rs_rekey(rss, NULL, 0);
 	}
 }
 
 static inline void
-_rs_random_u32(uint32_t *val)
+_rs_random_u32(struct _rss *rss, uint32_t *val)
 {
 	u_char *keystream;
 
-	_rs_stir_if_needed(sizeof(*val));
-	if (rs->rs_have < sizeof(*val))
-		_rs_rekey(NULL, 0);
-	keystream = rsx->rs_buf + sizeof(rsx->rs_buf) - rs->rs_have;
+	_rs_stir_if_needed(rss, sizeof(*val));
+	if (rss->rs->rs_have < sizeof(*val))
+		_rs_rekey(rss, NULL, 0);
+	keystream = rss->rsx->rs_buf + sizeof(rss->rsx->rs_buf)
+	    - rss->rs->rs_have;
 	memcpy(val, keystream, sizeof(*val));
 	memset(keystream, 0, sizeof(*val));
-	rs->rs_have -= sizeof(*val);
+	rss->rs->rs_have -= sizeof(*val);
 }
 
+#if _RS_NSTATES > 1
+/*
+ * Find a keystream state that is not in use, starting with the one selected
+ * by the thread ID, and mark it busy. The busy flag lives in the
+ * MAP_INHERIT_ZERO mapping, hence a state that was in use by another thread
+ * at fork time is free (and will be stirred) in the child. States are only
+ * allocated, under _ARC4_LOCK, when first needed; rs is published after rsx
+ * so that the unlocked check of rs never yields a state without its rsx.
+ */
+static inline struct _rss *
+_rs_get(void)
+{
+	struct _rss *rss;
+	struct _rs *rs;
+	struct _rsx *rsx;
+	u_int h, i;
+
+	if (!_RS_THREADED())
+		h = 0;
+	else
+		h = _rs_thread_id();
+
+	for (i = 0;; i++) {
+		rss = &_rss[(h + i) % _RS_NSTATES];
+		if (rss->rs == NULL) {
+			_ARC4_LOCK();
+			if (rss->rs == NULL) {
+				if (_rs_allocate(&rs, &rsx) == -1)
+					_exit(1);
+				rss->rsx = rsx;
+				membar_producer();
+				rss->rs = rs;
+			}
+			_ARC4_UNLOCK();
+		}
+		/* Pairs with membar_producer(), rsx is valid once rs is. */
+		membar_consumer();
+		if (!_RS_THREADED())
+			return rss;
+		if (atomic_cas_uint(&rss->rs->rs_busy, 0, 1) == 0) {
+			membar_enter_after_atomic();
+			return rss;
+		}
+		if (i % _RS_NSTATES == _RS_NSTATES - 1)
+			sched_yield();
+	}
+}
+
+static inline void
+_rs_put(struct _rss *rss)
+{
+	if (!_RS_THREADED())
+		return;
+	membar_exit();
+	rss->rs->rs_busy = 0;
+}
+#else
+static inline struct _rss *
+_rs_get(void)
+{
+	_ARC4_LOCK();
+	return &_rss[0];
+}
+
+static inline void
+_rs_put(struct _rss *rss)
+{
+	_ARC4_UNLOCK();
+}
+#endif
+
 uint32_t
 arc4random(void)
 {
+	struct _rss *rss;
 	uint32_t val;
 
-	_ARC4_LOCK();
-	_rs_random_u32(&val);
-	_ARC4_UNLOCK();
+	rss = _rs_get();
+	_rs_random_u32(rss, &val);
+	_rs_put(rss);
 	return val;
 }
 DEF_WEAK(arc4random);
@@ -197,8 +286,10 @@ DEF_WEAK(arc4random);
 void
 arc4random_buf(void *buf, size_t n)
 {
-	_ARC4_LOCK();
-	_rs_random_buf(buf, n);
-	_ARC4_UNLOCK();
+	struct _rss *rss;
+
+	rss = _rs_get();
+	_rs_random_buf(rss, buf, n);
+	_rs_put(rss);
 }
 DEF_WEAK(arc4random_buf);
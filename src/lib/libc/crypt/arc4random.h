@@ -22,12 +22,28 @@
 /*
  * Stub functions for portability.
  */
+#include <sys/atomic.h>
 #include <sys/mman.h>
 
+#include <sched.h>
 #include <signal.h>
+#include <tib.h>
 
 #include "thread_private.h"
 
+/*
+ * Threads use one of several keystream states, rather than serialising on
+ * _ARC4_LOCK, with the state selected by thread ID.
+ */
+#define _RS_NSTATES	16
+#define _RS_THREADED()	(__isthreaded)
+
+static inline u_int
+_rs_thread_id(void)
+{
+	return TIB_GET()->tib_tid;
+}
+
 static inline void
 _getentropy_fail(void)
 {
@@ -56,6 +72,6 @@ _rs_allocate(struct _rs **rsp, struct _rsx **rsxp)
 }
 
 static inline void
-_rs_forkdetect(void)
+_rs_forkdetect(struct _rs *rs)
 {
 }
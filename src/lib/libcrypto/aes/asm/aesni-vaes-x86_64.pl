@@ -0,0 +1,187 @@
+#!/usr/bin/env perl
+# $OpenBSD$
+#
+# Copyright (c) 2026 agent <agent@local>
+#
+# Permission to use, copy, modify, and distribute this software for any
+# purpose with or without fee is hereby granted, provided that the above
+# copyright notice and this permission notice appear in all copies.
+#
+# THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+# WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+# ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+# WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+# ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+# OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+#
+# AES-CTR using VAES with 512 bit registers, processing 16 blocks per
+# iteration.
+#
+# void aesni_vaes_ctr32_encrypt_blocks(const void *in, void *out,
+#     size_t blocks, const AES_KEY *key, const unsigned char ivec[16]);
+#
+# This has the same semantics as aesni_ctr32_encrypt_blocks(), in that only
+# the low 32 bits of the counter are incremented, however blocks must be a
+# multiple of 16. The key schedule must have been produced by
+# aesni_set_encrypt_key(), which stores the number of rounds less one. The
+# caller must have checked for AVX-512F, AVX-512BW and VAES support.
+
+$flavour = shift;
+$output  = shift;
+if ($flavour =~ /\./) { $output = $flavour; undef $flavour; }
+
+$win64=0; $win64=1 if ($flavour =~ /[nm]asm|mingw64/ || $output =~ /\.asm$/);
+die "Win64 is not supported" if ($win64);
+
+$0 =~ m/(.*[\/\\])[^\/\\]+$/; $dir=$1;
+( $xlate="${dir}x86_64-xlate.pl" and -f $xlate ) or
+( $xlate="${dir}../../perlasm/x86_64-xlate.pl" and -f $xlate) or
+die "can't locate x86_64-xlate.pl";
+
+open OUT,"| \"$^X\" $xlate $flavour $output";
+*STDOUT=*OUT;
+
+($inp,$out,$blocks,$key,$ivp)=("%rdi","%rsi","%rdx","%rcx","%r8");
+($rounds,$ctr)=("%eax","%r10d");
+
+# Round keys, broadcast to all lanes, with the last round key in %zmm31.
+@K=map("%zmm$_",(16..30));
+$Klast="%zmm31";
+
+# Counters (little endian, in the last dword of each lane) and blocks.
+@C=map("%zmm$_",(0..3));
+@B=map("%zmm$_",(4..7));
+($iv,$ctr_bswap,$sixteen)=("%zmm8","%zmm9","%zmm10");
+
+$code.=<<___;
+.text
+
+.globl	aesni_vaes_ctr32_encrypt_blocks
+.type	aesni_vaes_ctr32_encrypt_blocks,\@abi-omnipotent
+.align	32
+aesni_vaes_ctr32_encrypt_blocks:
+	shr		\$4,$blocks
+	jz		.Lctr32_vaes_done
+
+	mov		240($key),$rounds
+___
+for ($i = 0; $i < 15; $i++) {
+$code.=<<___;
+	vbroadcasti32x4	`16*$i`($key),$K[$i]
+___
+}
+$code.=<<___;
+	mov		$rounds,%r11d
+	inc		%r11d
+	shl		\$4,%r11d
+	vbroadcasti32x4	($key,%r11),$Klast
+
+	# The IV with the counter cleared, in all lanes.
+	vmovdqu		($ivp),%xmm8
+	vpshufb		.Lctr32_vaes_iv_mask(%rip),%xmm8,%xmm8
+	vshufi64x2	\$0,$iv,$iv,$iv
+	vbroadcasti32x4	.Lctr32_vaes_bswap(%rip),$ctr_bswap
+	vbroadcasti32x4	.Lctr32_vaes_sixteen(%rip),$sixteen
+
+	# Counters for blocks 0..15, in host byte order.
+	mov		12($ivp),$ctr
+	bswap		$ctr
+	vpbroadcastd	$ctr,$C[0]
+	vpaddd		.Lctr32_vaes_init(%rip),$C[0],$C[0]
+	vbroadcasti32x4	.Lctr32_vaes_four(%rip),$B[0]
+	vpaddd		$B[0],$C[0],$C[1]
+	vpaddd		$B[0],$C[1],$C[2]
+	vpaddd		$B[0],$C[2],$C[3]
+	jmp		.Lctr32_vaes_loop
+
+.align	32
+.Lctr32_vaes_loop:
+___
+for ($i = 0; $i < 4; $i++) {
+$code.=<<___;
+	vpshufb		$ctr_bswap,$C[$i],$B[$i]
+	vpternlogq	\$0x96,$iv,$K[0],$B[$i]
+	vpaddd		$sixteen,$C[$i],$C[$i]
+___
+}
+for ($r = 1; $r < 10; $r++) {
+$code.=<<___;
+	vaesenc		$K[$r],$B[0],$B[0]
+	vaesenc		$K[$r],$B[1],$B[1]
+	vaesenc		$K[$r],$B[2],$B[2]
+	vaesenc		$K[$r],$B[3],$B[3]
+___
+}
+$code.=<<___;
+	cmp		\$9,$rounds
+	je		.Lctr32_vaes_last
+___
+for ($r = 10; $r < 12; $r++) {
+$code.=<<___;
+	vaesenc		$K[$r],$B[0],$B[0]
+	vaesenc		$K[$r],$B[1],$B[1]
+	vaesenc		$K[$r],$B[2],$B[2]
+	vaesenc		$K[$r],$B[3],$B[3]
+___
+}
+$code.=<<___;
+	cmp		\$11,$rounds
+	je		.Lctr32_vaes_last
+___
+for ($r = 12; $r < 14; $r++) {
+$code.=<<___;
+	vaesenc		$K[$r],$B[0],$B[0]
+	vaesenc		$K[$r],$B[1],$B[1]
+	vaesenc		$K[$r],$B[2],$B[2]
+	vaesenc		$K[$r],$B[3],$B[3]
+___
+}
+$code.=<<___;
+
+.Lctr32_vaes_last:
+	vaesenclast	$Klast,$B[0],$B[0]
+	vaesenclast	$Klast,$B[1],$B[1]
+	vaesenclast	$Klast,$B[2],$B[2]
+	vaesenclast	$Klast,$B[3],$B[3]
+
+	vpxorq		0x00($inp),$B[0],$B[0]
+	vpxorq		0x40($inp),$B[1],$B[1]
+	vpxorq		0x80($inp),$B[2],$B[2]
+	vpxorq		0xc0($inp),$B[3],$B[3]
+	vmovdqu64	$B[0],0x00($out)
+	vmovdqu64	$B[1],0x40($out)
+	vmovdqu64	$B[2],0x80($out)
+	vmovdqu64	$B[3],0xc0($out)
+
+	lea		0x100($inp),$inp
+	lea		0x100($out),$out
+	dec		$blocks
+	jnz		.Lctr32_vaes_loop
+
+	vzeroupper
+
+.Lctr32_vaes_done:
+	ret
+.size	aesni_vaes_ctr32_encrypt_blocks,.-aesni_vaes_ctr32_encrypt_blocks
+
+.section .rodata
+.align	64
+.Lctr32_vaes_init:
+	.long	0,0,0,0, 0,0,0,1, 0,0,0,2, 0,0,0,3
+.Lctr32_vaes_iv_mask:
+	.byte	0,1,2,3,4,5,6,7,8,9,10,11,0x80,0x80,0x80,0x80
+.Lctr32_vaes_bswap:
+	.byte	0x80,0x80,0x80,0x80,0x80,0x80,0x80,0x80
+	.byte	0x80,0x80,0x80,0x80,15,14,13,12
+.Lctr32_vaes_four:
+	.long	0,0,0,4
+.Lctr32_vaes_sixteen:
+	.long	0,0,0,16
+___
+
+$code =~ s/\`([^\`]*)\`/eval($1)/gem;
+
+print $code;
+
+close STDOUT;
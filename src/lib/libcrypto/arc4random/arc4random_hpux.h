@@ -49,7 +49,7 @@ _rs_forkhandler(void)
 }
 
 static inline void
-_rs_forkdetect(void)
+_rs_forkdetect(struct _rs *rs)
 {
 	static pid_t _rs_pid = 0;
 	pid_t pid = getpid();
@@ -73,6 +73,6 @@ _rs_forkhandler(void)
 }
 
 static inline void
-_rs_forkdetect(void)
+_rs_forkdetect(struct _rs *rs)
 {
 }
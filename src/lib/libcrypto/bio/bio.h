@@ -171,6 +171,12 @@ extern "C" {
 #define BIO_CTRL_DGRAM_SET_NEXT_TIMEOUT   45 /* Next DTLS handshake timeout to
                                               * adjust socket timeouts */
 
+#define BIO_CTRL_DGRAM_SET_BATCH         160 /* batch datagram I/O using
+                                              * recvmmsg/sendmmsg */
+#define BIO_CTRL_DGRAM_GET_BATCH         161
+#define BIO_CTRL_DGRAM_DEFER_FLUSH       162 /* do not send batched
+                                              * datagrams on flush */
+
 
 /* modifiers */
 #define BIO_FP_READ		0x02
@@ -523,6 +529,10 @@ int BIO_ctrl_reset_read_request(BIO *b);
          (int)BIO_ctrl(b, BIO_CTRL_DGRAM_GET_PEER, 0, (char *)peer)
 #define BIO_dgram_set_peer(b,peer) \
          (int)BIO_ctrl(b, BIO_CTRL_DGRAM_SET_PEER, 0, (char *)peer)
+#define BIO_dgram_set_batch(b,n) \
+         (int)BIO_ctrl(b, BIO_CTRL_DGRAM_SET_BATCH, n, NULL)
+#define BIO_dgram_get_batch(b) \
+         (int)BIO_ctrl(b, BIO_CTRL_DGRAM_GET_BATCH, 0, NULL)
 
 /* These two aren't currently implemented */
 /* int BIO_get_ex_num(BIO *bio); */
@@ -815,7 +815,7 @@ BIO_ctrl_reset_read_request(BIO *bio)
 }
 
 
-/* BIO_nread0/nread/nwrite0/nwrite are available only for BIO pairs for now
+/* BIO_nread0/nread/nwrite0/nwrite are available for BIO pairs and memory BIOs
  * (conceivably some other BIOs could allow non-copying reads and writes too.)
  */
 int
@@ -59,12 +59,14 @@
 
 #include <sys/socket.h>
 #include <sys/time.h>
+#include <sys/uio.h>
 
 #include <netinet/in.h>
 
 #include <errno.h>
 #include <netdb.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
@@ -100,6 +102,28 @@ static const BIO_METHOD methods_dgramp = {
 };
 
 
+#define BIO_DGRAM_MAX_BATCH	64
+
+/*
+ * Datagrams that have been received by recvmmsg() but not yet read, or that
+ * have been written but not yet sent by sendmmsg().
+ */
+struct bio_dgram_msg {
+	struct sockaddr_storage addr;
+	socklen_t addr_len;
+	size_t offset;
+	size_t len;
+};
+
+struct bio_dgram_queue {
+	struct bio_dgram_msg msgs[BIO_DGRAM_MAX_BATCH];
+	size_t count;
+	size_t next;
+	uint8_t *buf;
+	size_t buf_len;
+	size_t buf_size;
+};
+
 typedef struct bio_dgram_data_st {
 	union {
 		struct sockaddr sa;
@@ -111,6 +135,10 @@ typedef struct bio_dgram_data_st {
 	unsigned int mtu;
 	struct timeval next_timeout;
 	struct timeval socket_timeout;
+	unsigned int batch;
+	int defer_flush;
+	struct bio_dgram_queue rq;
+	struct bio_dgram_queue wq;
 } bio_dgram_data;
 
 
@@ -159,16 +187,73 @@ dgram_free(BIO *a)
 		return 0;
 
 	data = (bio_dgram_data *)a->ptr;
+	freezero(data->rq.buf, data->rq.buf_size);
+	freezero(data->wq.buf, data->wq.buf_size);
 	free(data);
 
 	return (1);
 }
 
+static void
+dgram_queue_clear(struct bio_dgram_queue *q)
+{
+	q->count = 0;
+	q->next = 0;
+	q->buf_len = 0;
+}
+
+static int
+dgram_queue_reserve(struct bio_dgram_queue *q, size_t len)
+{
+	uint8_t *buf;
+	size_t size;
+
+	if (q->buf_size - q->buf_len >= len)
+		return 1;
+
+	if ((size = q->buf_len + len) < len)
+		return 0;
+	if ((buf = recallocarray(q->buf, q->buf_size, size, 1)) == NULL)
+		return 0;
+	q->buf = buf;
+	q->buf_size = size;
+
+	return 1;
+}
+
+static size_t
+dgram_queue_pending(struct bio_dgram_queue *q)
+{
+	size_t i, pending = 0;
+
+	for (i = q->next; i < q->count; i++)
+		pending += q->msgs[i].len;
+
+	return pending;
+}
+
+static socklen_t
+dgram_peer_len(bio_dgram_data *data)
+{
+	if (data->peer.sa.sa_family == AF_INET)
+		return sizeof(data->peer.sa_in);
+	if (data->peer.sa.sa_family == AF_INET6)
+		return sizeof(data->peer.sa_in6);
+
+	return sizeof(data->peer);
+}
+
 static int
 dgram_clear(BIO *a)
 {
+	bio_dgram_data *data;
+
 	if (a == NULL)
 		return (0);
+	if ((data = a->ptr) != NULL) {
+		dgram_queue_clear(&data->rq);
+		dgram_queue_clear(&data->wq);
+	}
 	if (a->shutdown) {
 		if (a->init) {
 			shutdown(a->num, SHUT_RDWR);
@@ -247,12 +332,90 @@ dgram_reset_rcv_timeout(BIO *b)
 #endif
 }
 
+static int dgram_flush_batch(BIO *b);
+
+/*
+ * Read a datagram from the queue filled by recvmmsg(), or if it is empty,
+ * receive up to data->batch datagrams - the first is received directly into
+ * the caller's buffer, while the remainder are queued.
+ */
+static int
+dgram_read_batch(BIO *b, char *out, int outl)
+{
+	bio_dgram_data *data = b->ptr;
+	struct bio_dgram_queue *q = &data->rq;
+	struct mmsghdr mmsg[BIO_DGRAM_MAX_BATCH];
+	struct iovec iov[BIO_DGRAM_MAX_BATCH];
+	struct bio_dgram_msg *msg;
+	size_t i;
+	int ret;
+
+	BIO_clear_retry_flags(b);
+
+	if (q->next < q->count) {
+		msg = &q->msgs[q->next++];
+		ret = msg->len < (size_t)outl ? msg->len : (size_t)outl;
+		memcpy(out, &q->buf[msg->offset], ret);
+		if (!data->connected)
+			BIO_ctrl(b, BIO_CTRL_DGRAM_SET_PEER, 0, &msg->addr);
+		return ret;
+	}
+	dgram_queue_clear(q);
+
+	if (!dgram_queue_reserve(q, (data->batch - 1) * (size_t)outl))
+		return -1;
+
+	memset(mmsg, 0, sizeof(mmsg));
+	for (i = 0; i < data->batch; i++) {
+		msg = &q->msgs[i];
+		msg->offset = 0;
+		iov[i].iov_base = out;
+		if (i > 0) {
+			msg->offset = (i - 1) * outl;
+			iov[i].iov_base = &q->buf[msg->offset];
+		}
+		iov[i].iov_len = outl;
+		mmsg[i].msg_hdr.msg_name = &msg->addr;
+		mmsg[i].msg_hdr.msg_namelen = sizeof(msg->addr);
+		mmsg[i].msg_hdr.msg_iov = &iov[i];
+		mmsg[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	errno = 0;
+	dgram_adjust_rcv_timeout(b);
+	ret = recvmmsg(b->num, mmsg, data->batch, MSG_WAITFORONE, NULL);
+	if (ret > 0) {
+		for (i = 0; i < (size_t)ret; i++)
+			q->msgs[i].len = mmsg[i].msg_len;
+		q->count = ret;
+		q->next = 1;
+		if (!data->connected)
+			BIO_ctrl(b, BIO_CTRL_DGRAM_SET_PEER, 0, &q->msgs[0].addr);
+		ret = q->msgs[0].len;
+	} else if (BIO_dgram_should_retry(ret)) {
+		BIO_set_retry_read(b);
+		data->_errno = errno;
+	}
+	dgram_reset_rcv_timeout(b);
+
+	return ret;
+}
+
 static int
 dgram_read(BIO *b, char *out, int outl)
 {
 	int ret = 0;
 	bio_dgram_data *data = (bio_dgram_data *)b->ptr;
 
+	/* Datagrams being read are likely replies to those still queued. */
+	if (data->wq.count > 0 && !data->defer_flush) {
+		if (dgram_flush_batch(b) <= 0 && BIO_should_retry(b))
+			BIO_clear_retry_flags(b);
+	}
+
+	if (out != NULL && outl > 0 && data->batch > 1)
+		return dgram_read_batch(b, out, outl);
+
 	struct	{
 		socklen_t len;
 		union	{
@@ -286,24 +449,109 @@ dgram_read(BIO *b, char *out, int outl)
 	return (ret);
 }
 
+/*
+ * Send the queued datagrams using as few calls to sendmmsg() as possible.
+ * If sending would block, the datagrams that have not been sent remain
+ * queued, otherwise the queue is discarded on error.
+ */
+static int
+dgram_flush_batch(BIO *b)
+{
+	bio_dgram_data *data = b->ptr;
+	struct bio_dgram_queue *q = &data->wq;
+	struct mmsghdr mmsg[BIO_DGRAM_MAX_BATCH];
+	struct iovec iov[BIO_DGRAM_MAX_BATCH];
+	struct bio_dgram_msg *msg;
+	size_t i, n;
+	int ret;
+
+	BIO_clear_retry_flags(b);
+
+	while (q->next < q->count) {
+		memset(mmsg, 0, sizeof(mmsg));
+		for (i = q->next, n = 0; i < q->count; i++, n++) {
+			msg = &q->msgs[i];
+			iov[n].iov_base = &q->buf[msg->offset];
+			iov[n].iov_len = msg->len;
+			if (!data->connected) {
+				mmsg[n].msg_hdr.msg_name = &msg->addr;
+				mmsg[n].msg_hdr.msg_namelen = msg->addr_len;
+			}
+			mmsg[n].msg_hdr.msg_iov = &iov[n];
+			mmsg[n].msg_hdr.msg_iovlen = 1;
+		}
+
+		errno = 0;
+		if ((ret = sendmmsg(b->num, mmsg, n, 0)) <= 0) {
+			if (BIO_dgram_should_retry(ret)) {
+				BIO_set_retry_write(b);
+				data->_errno = errno;
+				return -1;
+			}
+			dgram_queue_clear(q);
+			return -1;
+		}
+		q->next += ret;
+	}
+	dgram_queue_clear(q);
+
+	return 1;
+}
+
+/*
+ * Queue a datagram to be sent by sendmmsg(), when the BIO is flushed, the
+ * queue is full or a read is performed.
+ */
+static int
+dgram_write_batch(BIO *b, const char *in, int inl)
+{
+	bio_dgram_data *data = b->ptr;
+	struct bio_dgram_queue *q = &data->wq;
+	struct bio_dgram_msg *msg;
+	int ret;
+
+	if (q->count >= data->batch) {
+		if ((ret = dgram_flush_batch(b)) <= 0)
+			return ret;
+	}
+
+	BIO_clear_retry_flags(b);
+
+	if (!dgram_queue_reserve(q, inl))
+		return -1;
+
+	msg = &q->msgs[q->count++];
+	memset(&msg->addr, 0, sizeof(msg->addr));
+	msg->addr_len = 0;
+	if (!data->connected) {
+		memcpy(&msg->addr, &data->peer, sizeof(data->peer));
+		msg->addr_len = dgram_peer_len(data);
+	}
+	msg->offset = q->buf_len;
+	msg->len = inl;
+
+	memcpy(&q->buf[q->buf_len], in, inl);
+	q->buf_len += inl;
+
+	return inl;
+}
+
 static int
 dgram_write(BIO *b, const char *in, int inl)
 {
 	int ret;
 	bio_dgram_data *data = (bio_dgram_data *)b->ptr;
+
+	if (data->batch > 1 && in != NULL && inl > 0)
+		return dgram_write_batch(b, in, inl);
+
 	errno = 0;
 
 	if (data->connected)
 		ret = write(b->num, in, inl);
-	else {
-		int peerlen = sizeof(data->peer);
-
-		if (data->peer.sa.sa_family == AF_INET)
-			peerlen = sizeof(data->peer.sa_in);
-		else if (data->peer.sa.sa_family == AF_INET6)
-			peerlen = sizeof(data->peer.sa_in6);
-		ret = sendto(b->num, in, inl, 0, &data->peer.sa, peerlen);
-	}
+	else
+		ret = sendto(b->num, in, inl, 0, &data->peer.sa,
+		    dgram_peer_len(data));
 
 	BIO_clear_retry_flags(b);
 	if (ret <= 0) {
@@ -373,12 +621,42 @@ dgram_ctrl(BIO *b, int cmd, long num, void *ptr)
 		b->shutdown = (int)num;
 		break;
 	case BIO_CTRL_PENDING:
+		ret = dgram_queue_pending(&data->rq);
+		break;
 	case BIO_CTRL_WPENDING:
+		/*
+		 * Queued datagrams are complete, so they are not reported -
+		 * DTLS uses this to determine space left in the datagram.
+		 */
 		ret = 0;
 		break;
 	case BIO_CTRL_DUP:
+		ret = 1;
+		break;
 	case BIO_CTRL_FLUSH:
 		ret = 1;
+		if (data->wq.count > 0 && !data->defer_flush)
+			ret = dgram_flush_batch(b);
+		break;
+	case BIO_CTRL_DGRAM_SET_BATCH:
+		if (num < 0) {
+			ret = 0;
+			break;
+		}
+		if (num > BIO_DGRAM_MAX_BATCH)
+			num = BIO_DGRAM_MAX_BATCH;
+		if (num <= 1 && data->wq.count > 0) {
+			if ((ret = dgram_flush_batch(b)) <= 0)
+				break;
+		}
+		data->batch = num > 1 ? num : 0;
+		ret = 1;
+		break;
+	case BIO_CTRL_DGRAM_GET_BATCH:
+		ret = data->batch;
+		break;
+	case BIO_CTRL_DGRAM_DEFER_FLUSH:
+		data->defer_flush = num != 0;
 		break;
 	case BIO_CTRL_DGRAM_CONNECT:
 		to = (struct sockaddr *)ptr;
@@ -87,6 +87,67 @@ bio_mem_read_ptr(struct bio_mem *bm)
 	return &bm->buf->data[bm->read_offset];
 }
 
+/*
+ * Ensure that at least len bytes of space are available following the
+ * pending data. Space that has already been read is reclaimed by moving the
+ * pending data to the start of the buffer, but only if the amount of data
+ * that would be moved does not exceed the amount already read - this keeps
+ * the cost of moves proportional to the amount of data that passes through
+ * the BIO, rather than to the number of writes.
+ */
+static int
+bio_mem_reserve(struct bio_mem *bm, size_t len)
+{
+	size_t pending, buf_len;
+
+	if ((pending = bio_mem_pending(bm)) == 0) {
+		bm->buf->length = 0;
+		bm->read_offset = 0;
+	}
+	if (bm->buf->max - bm->buf->length >= len)
+		return 1;
+
+	if (bm->read_offset >= pending) {
+		memmove(bm->buf->data, bio_mem_read_ptr(bm), pending);
+		bm->buf->length = pending;
+		bm->read_offset = 0;
+		if (bm->buf->max - bm->buf->length >= len)
+			return 1;
+	}
+
+	/*
+	 * Check for overflow and ensure we do not exceed an int, otherwise we
+	 * cannot tell if BUF_MEM_grow_clean() succeeded.
+	 */
+	buf_len = bm->buf->length + len;
+	if (buf_len < bm->buf->length || buf_len > INT_MAX)
+		return 0;
+
+	if (BUF_MEM_grow_clean(bm->buf, buf_len) != buf_len)
+		return 0;
+	bm->buf->length = buf_len - len;
+
+	return 1;
+}
+
+/*
+ * Move any pending data to the start of the buffer, so that the BUF_MEM
+ * only contains data that has not yet been read.
+ */
+static void
+bio_mem_compact(struct bio_mem *bm)
+{
+	size_t pending;
+
+	if (bm->read_offset == 0)
+		return;
+
+	pending = bio_mem_pending(bm);
+	memmove(bm->buf->data, bio_mem_read_ptr(bm), pending);
+	bm->buf->length = pending;
+	bm->read_offset = 0;
+}
+
 static int mem_new(BIO *bio);
 static int mem_free(BIO *bio);
 static int mem_write(BIO *bio, const char *in, int in_len);
@@ -220,7 +281,6 @@ static int
 mem_write(BIO *bio, const char *in, int in_len)
 {
 	struct bio_mem *bm = bio->ptr;
-	size_t buf_len;
 
 	BIO_clear_retry_flags(bio);
 
@@ -232,27 +292,108 @@ mem_write(BIO *bio, const char *in, int in_len)
 		return -1;
 	}
 
-	if (bm->read_offset > 4096) {
-		memmove(bm->buf->data, bio_mem_read_ptr(bm),
-		    bio_mem_pending(bm));
-		bm->buf->length = bio_mem_pending(bm);
-		bm->read_offset = 0;
+	if (!bio_mem_reserve(bm, in_len))
+		return -1;
+
+	memcpy(&bm->buf->data[bm->buf->length], in, in_len);
+	bm->buf->length += in_len;
+
+	return in_len;
+}
+
+/*
+ * Non-copying reads - bio_mem_nread0() returns the number of bytes that
+ * are available to read, with buf pointing at them, while bio_mem_nread()
+ * also consumes up to num of them.
+ */
+static long
+bio_mem_nread0(BIO *bio, char **buf)
+{
+	struct bio_mem *bm = bio->ptr;
+	size_t pending;
+
+	BIO_clear_retry_flags(bio);
+
+	if ((pending = bio_mem_pending(bm)) == 0) {
+		if (bio->num != 0)
+			BIO_set_retry_read(bio);
+		return bio->num;
 	}
 
-	/*
-	 * Check for overflow and ensure we do not exceed an int, otherwise we
-	 * cannot tell if BUF_MEM_grow_clean() succeeded.
-	 */
-	buf_len = bm->buf->length + in_len;
-	if (buf_len < bm->buf->length || buf_len > INT_MAX)
+	if (buf != NULL)
+		*buf = (char *)bio_mem_read_ptr(bm);
+
+	return pending;
+}
+
+static long
+bio_mem_nread(BIO *bio, char **buf, long num)
+{
+	struct bio_mem *bm = bio->ptr;
+	long ret;
+
+	if (num < 0)
 		return -1;
 
-	if (BUF_MEM_grow_clean(bm->buf, buf_len) != buf_len)
+	if ((ret = bio_mem_nread0(bio, buf)) <= 0)
+		return ret;
+	if (num < ret)
+		ret = num;
+
+	bm->read_offset += ret;
+
+	return ret;
+}
+
+/*
+ * Non-copying writes - bio_mem_nwrite0() makes space available for writing
+ * and returns the number of bytes available, with buf pointing at them,
+ * while bio_mem_nwrite() commits num of these bytes to the BIO. The space is
+ * committed in place, since the caller may have already written to it.
+ */
+#define BIO_MEM_NWRITE_MIN	4096
+
+static long
+bio_mem_nwrite0(BIO *bio, char **buf)
+{
+	struct bio_mem *bm = bio->ptr;
+
+	BIO_clear_retry_flags(bio);
+
+	if (bio->flags & BIO_FLAGS_MEM_RDONLY) {
+		BIOerror(BIO_R_WRITE_TO_READ_ONLY_BIO);
 		return -1;
+	}
 
-	memcpy(&bm->buf->data[buf_len - in_len], in, in_len);
+	if (!bio_mem_reserve(bm, BIO_MEM_NWRITE_MIN))
+		return -1;
 
-	return in_len;
+	if (buf != NULL)
+		*buf = &bm->buf->data[bm->buf->length];
+
+	return bm->buf->max - bm->buf->length;
+}
+
+static long
+bio_mem_nwrite(BIO *bio, char **buf, long num)
+{
+	struct bio_mem *bm = bio->ptr;
+
+	BIO_clear_retry_flags(bio);
+
+	if (bio->flags & BIO_FLAGS_MEM_RDONLY) {
+		BIOerror(BIO_R_WRITE_TO_READ_ONLY_BIO);
+		return -1;
+	}
+
+	if (num < 0 || num > bm->buf->max - bm->buf->length)
+		return -1;
+
+	if (buf != NULL)
+		*buf = &bm->buf->data[bm->buf->length];
+	bm->buf->length += num;
+
+	return num;
 }
 
 static long
@@ -293,6 +434,8 @@ mem_ctrl(BIO *bio, int cmd, long num, void *ptr)
 		break;
 	case BIO_C_GET_BUF_MEM_PTR:
 		if (ptr != NULL) {
+			if (!(bio->flags & BIO_FLAGS_MEM_RDONLY))
+				bio_mem_compact(bm);
 			pptr = (void **)ptr;
 			*pptr = bm->buf;
 		}
@@ -313,6 +456,18 @@ mem_ctrl(BIO *bio, int cmd, long num, void *ptr)
 	case BIO_CTRL_FLUSH:
 		ret = 1;
 		break;
+	case BIO_C_NREAD0:
+		ret = bio_mem_nread0(bio, ptr);
+		break;
+	case BIO_C_NREAD:
+		ret = bio_mem_nread(bio, ptr, num);
+		break;
+	case BIO_C_NWRITE0:
+		ret = bio_mem_nwrite0(bio, ptr);
+		break;
+	case BIO_C_NWRITE:
+		ret = bio_mem_nwrite(bio, ptr, num);
+		break;
 	case BIO_CTRL_PUSH:
 	case BIO_CTRL_POP:
 	default:
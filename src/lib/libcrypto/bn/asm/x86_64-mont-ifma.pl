@@ -0,0 +1,200 @@
+#!/usr/bin/env perl
+# $OpenBSD$
+#
+# Copyright (c) 2026 agent <agent@local>
+#
+# Permission to use, copy, modify, and distribute this software for any
+# purpose with or without fee is hereby granted, provided that the above
+# copyright notice and this permission notice appear in all copies.
+#
+# THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+# WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+# ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+# WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+# ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+# OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+#
+# Montgomery multiplication of eight independent 1040 bit numbers using
+# AVX-512 IFMA, one number per 64 bit lane.
+#
+# void bn_mont_mul_52x20_x8_ifma(uint64_t *r, const uint64_t *a,
+#     const uint64_t *b, const uint64_t *m, const uint64_t *k0);
+#
+# Each operand consists of 20 limbs of 52 bits, stored limb by limb with
+# the eight lanes of a limb being adjacent, so that a limb of all eight
+# numbers may be loaded into a single register. k0 holds -m^-1 mod 2^52 for
+# each lane. The result is a * b * 2^-1040 mod m, with limbs fully reduced
+# to 52 bits, although the value itself is only reduced to less than 2m,
+# provided that a and b are less than 2m and m is less than 2^1038. r may
+# alias a or b.
+#
+# void bn_select_52x20_x8_win5_ifma(uint64_t *r, const uint64_t *table,
+#     const uint64_t *idx);
+#
+# Select entry idx[i] of a table of 32 such operands for each lane i, reading
+# every entry so that the memory access pattern does not depend on idx.
+#
+# The caller must have checked for AVX-512F and AVX-512 IFMA support.
+
+$flavour = shift;
+$output  = shift;
+if ($flavour =~ /\./) { $output = $flavour; undef $flavour; }
+
+$win64=0; $win64=1 if ($flavour =~ /[nm]asm|mingw64/ || $output =~ /\.asm$/);
+die "Win64 is not supported" if ($win64);
+
+$0 =~ m/(.*[\/\\])[^\/\\]+$/; $dir=$1;
+( $xlate="${dir}x86_64-xlate.pl" and -f $xlate ) or
+( $xlate="${dir}../../perlasm/x86_64-xlate.pl" and -f $xlate) or
+die "can't locate x86_64-xlate.pl";
+
+open OUT,"| \"$^X\" $xlate $flavour $output";
+*STDOUT=*OUT;
+
+($rp,$ap,$bp,$np,$k0p)=("%rdi","%rsi","%rdx","%rcx","%r8");
+
+$limbs=20;
+
+# The accumulator, one limb longer than the operands. The registers are
+# renamed after each iteration, rather than the limbs being moved.
+@acc=map("%zmm$_",(0..$limbs));
+($B,$M,$K0,$T,$mask)=map("%zmm$_",($limbs+1..$limbs+5));
+
+$code.=<<___;
+.text
+
+.globl	bn_mont_mul_52x20_x8_ifma
+.type	bn_mont_mul_52x20_x8_ifma,\@abi-omnipotent
+.align	32
+bn_mont_mul_52x20_x8_ifma:
+	vmovdqu64	($k0p),$K0
+	vpbroadcastq	.Lmont_ifma_mask52(%rip),$mask
+___
+for ($j = 0; $j <= $limbs; $j++) {
+$code.=<<___;
+	vpxorq		$acc[$j],$acc[$j],$acc[$j]
+___
+}
+for ($i = 0; $i < $limbs; $i++) {
+# acc += a * b[i], then acc += m * (acc[0] * k0 mod 2^52), leaving the low
+# limb divisible by 2^52. Its carry is then folded into the next limb and
+# the accumulator shifted down by one limb.
+$code.=<<___;
+
+	vmovdqu64	`64*$i`($bp),$B
+	vpmadd52luq	0($ap),$B,$acc[0]
+	vpxorq		$M,$M,$M
+	vpmadd52luq	$K0,$acc[0],$M
+___
+for ($j = 1; $j < $limbs; $j++) {
+$code.=<<___;
+	vpmadd52luq	`64*$j`($ap),$B,$acc[$j]
+___
+}
+for ($j = 0; $j < $limbs; $j++) {
+$code.=<<___;
+	vpmadd52huq	`64*$j`($ap),$B,$acc[$j+1]
+___
+}
+for ($j = 0; $j < $limbs; $j++) {
+$code.=<<___;
+	vpmadd52luq	`64*$j`($np),$M,$acc[$j]
+___
+}
+for ($j = 0; $j < $limbs; $j++) {
+$code.=<<___;
+	vpmadd52huq	`64*$j`($np),$M,$acc[$j+1]
+___
+}
+$code.=<<___;
+	vpsrlq		\$52,$acc[0],$T
+	vpaddq		$T,$acc[1],$acc[1]
+	vpxorq		$acc[0],$acc[0],$acc[0]
+___
+push(@acc, shift(@acc));
+}
+
+# Propagate the carries so that each limb is 52 bits.
+$code.=<<___;
+
+___
+for ($j = 0; $j < $limbs - 1; $j++) {
+$code.=<<___;
+	vpsrlq		\$52,$acc[$j],$T
+	vpandq		$mask,$acc[$j],$acc[$j]
+	vpaddq		$T,$acc[$j+1],$acc[$j+1]
+___
+}
+for ($j = 0; $j < $limbs; $j++) {
+$code.=<<___;
+	vmovdqu64	$acc[$j],`64*$j`($rp)
+___
+}
+$code.=<<___;
+
+	vzeroupper
+	ret
+.size	bn_mont_mul_52x20_x8_ifma,.-bn_mont_mul_52x20_x8_ifma
+___
+
+($rp,$tp,$idxp)=("%rdi","%rsi","%rdx");
+($idx,$k,$one)=map("%zmm$_",($limbs..$limbs+2));
+
+$code.=<<___;
+
+.globl	bn_select_52x20_x8_win5_ifma
+.type	bn_select_52x20_x8_win5_ifma,\@abi-omnipotent
+.align	32
+bn_select_52x20_x8_win5_ifma:
+	vmovdqu64	($idxp),$idx
+	vpxorq		$k,$k,$k
+	vpbroadcastq	.Lmont_ifma_one(%rip),$one
+___
+for ($j = 0; $j < $limbs; $j++) {
+$code.=<<___;
+	vpxorq		%zmm$j,%zmm$j,%zmm$j
+___
+}
+$code.=<<___;
+	mov		\$32,%eax
+
+.align	32
+.Lselect_ifma_loop:
+	vpcmpeqq	$idx,$k,%k1
+___
+for ($j = 0; $j < $limbs; $j++) {
+$code.=<<___;
+	vpblendmq	`64*$j`($tp),%zmm$j,%zmm$j\{%k1\}
+___
+}
+$code.=<<___;
+	vpaddq		$one,$k,$k
+	lea		`64*$limbs`($tp),$tp
+	dec		%eax
+	jnz		.Lselect_ifma_loop
+___
+for ($j = 0; $j < $limbs; $j++) {
+$code.=<<___;
+	vmovdqu64	%zmm$j,`64*$j`($rp)
+___
+}
+$code.=<<___;
+
+	vzeroupper
+	ret
+.size	bn_select_52x20_x8_win5_ifma,.-bn_select_52x20_x8_win5_ifma
+
+.section .rodata
+.align	8
+.Lmont_ifma_mask52:
+	.quad	0xfffffffffffff
+.Lmont_ifma_one:
+	.quad	1
+___
+
+$code =~ s/\`([^\`]*)\`/eval($1)/gem;
+
+print $code;
+
+close STDOUT;
@@ -15,6 +15,7 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <pthread.h>
 #include <stddef.h>
 #include <string.h>
 
@@ -22,9 +23,23 @@
 #include <openssl/err.h>
 
 #include "bn_local.h"
+#include "cryptlib.h"
 
 #define BN_CTX_INITIAL_LEN	8
+#define BN_CTX_MAX_ARENAS	24
 
+/*
+ * Maximum number of BIGNUMs that a BN_CTX may hold and still be retained
+ * in the cache when it is freed.
+ */
+#define BN_CTX_CACHE_MAX_LEN	64
+
+/*
+ * The BIGNUMs handed out by a BN_CTX are allocated in contiguous arenas,
+ * with each arena doubling the number of BIGNUMs available. Once a BIGNUM
+ * has been expanded, its words are retained until the BN_CTX is freed, so
+ * that a BN_CTX that is reused performs no further allocations.
+ */
 struct bignum_ctx {
 	BIGNUM **bignums;
 	uint8_t *groups;
@@ -32,15 +47,28 @@ struct bignum_ctx {
 	size_t index;
 	size_t len;
 
+	BIGNUM *arenas[BN_CTX_MAX_ARENAS];
+	size_t num_arenas;
+
 	int error;
 };
 
+/*
+ * Number of freed BN_CTXs that are retained for reuse by BN_CTX_new().
+ */
+#define BN_CTX_CACHE_SLOTS	16
+
+static pthread_mutex_t bn_ctx_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static BN_CTX *bn_ctx_cache[BN_CTX_CACHE_SLOTS];
+static size_t bn_ctx_cache_len;
+
 static int
 bn_ctx_grow(BN_CTX *bctx)
 {
 	BIGNUM **bignums = NULL;
+	BIGNUM *arena = NULL;
 	uint8_t *groups = NULL;
-	size_t len;
+	size_t i, len;
 
 	if ((len = bctx->len) == 0) {
 		len = BN_CTX_INITIAL_LEN;
@@ -50,24 +78,121 @@ bn_ctx_grow(BN_CTX *bctx)
 		len *= 2;
 	}
 
+	if (bctx->num_arenas >= BN_CTX_MAX_ARENAS)
+		return 0;
+	if ((arena = calloc(len - bctx->len, sizeof(*arena))) == NULL)
+		return 0;
+
 	if ((bignums = recallocarray(bctx->bignums, bctx->len, len,
 	    sizeof(bctx->bignums[0]))) == NULL)
-		return 0;
+		goto err;
 	bctx->bignums = bignums;
 
 	if ((groups = reallocarray(bctx->groups, len,
 	    sizeof(bctx->groups[0]))) == NULL)
-		return 0;
+		goto err;
 	bctx->groups = groups;
 
+	for (i = bctx->len; i < len; i++)
+		bctx->bignums[i] = &arena[i - bctx->len];
+	bctx->arenas[bctx->num_arenas++] = arena;
+
 	bctx->len = len;
 
 	return 1;
+
+ err:
+	free(arena);
+
+	return 0;
+}
+
+static void
+bn_ctx_destroy(BN_CTX *bctx)
+{
+	size_t i;
+
+	for (i = 0; i < bctx->len; i++) {
+		BN_free(bctx->bignums[i]);
+		bctx->bignums[i] = NULL;
+	}
+	for (i = 0; i < bctx->num_arenas; i++) {
+		free(bctx->arenas[i]);
+		bctx->arenas[i] = NULL;
+	}
+
+	free(bctx->bignums);
+	free(bctx->groups);
+
+	freezero(bctx, sizeof(*bctx));
+}
+
+/*
+ * Freed BN_CTXs are retained in a small process wide cache, so that callers
+ * that create a BN_CTX per operation reuse its BIGNUMs rather than allocating
+ * new ones. A cache that relies on thread specific data is avoided, since its
+ * destructor would need to remain mapped for as long as any thread exists.
+ */
+static BN_CTX *
+bn_ctx_cache_get(void)
+{
+	BN_CTX *bctx = NULL;
+
+	if (pthread_mutex_lock(&bn_ctx_cache_mutex) != 0)
+		return NULL;
+	if (bn_ctx_cache_len > 0) {
+		bctx = bn_ctx_cache[--bn_ctx_cache_len];
+		bn_ctx_cache[bn_ctx_cache_len] = NULL;
+	}
+	(void)pthread_mutex_unlock(&bn_ctx_cache_mutex);
+
+	return bctx;
+}
+
+static int
+bn_ctx_cache_put(BN_CTX *bctx)
+{
+	size_t i;
+	int ret = 0;
+
+	if (bctx->error || bctx->group != 0 || bctx->index != 0)
+		return 0;
+	if (bctx->len > BN_CTX_CACHE_MAX_LEN)
+		return 0;
+
+	for (i = 0; i < bctx->len; i++) {
+		BN_clear(bctx->bignums[i]);
+		bctx->bignums[i]->flags = 0;
+	}
+
+	if (pthread_mutex_lock(&bn_ctx_cache_mutex) != 0)
+		return 0;
+	if (bn_ctx_cache_len < BN_CTX_CACHE_SLOTS) {
+		bn_ctx_cache[bn_ctx_cache_len++] = bctx;
+		ret = 1;
+	}
+	(void)pthread_mutex_unlock(&bn_ctx_cache_mutex);
+
+	return ret;
+}
+
+void
+bn_ctx_cache_free(void)
+{
+	BN_CTX *bctx;
+
+	while ((bctx = bn_ctx_cache_get()) != NULL)
+		bn_ctx_destroy(bctx);
 }
 
 BN_CTX *
 BN_CTX_new(void)
 {
+	BN_CTX *bctx;
+
+	if ((bctx = bn_ctx_cache_get()) != NULL)
+		return bctx;
+
 	return calloc(1, sizeof(struct bignum_ctx));
 }
 
@@ -80,20 +205,13 @@ BN_CTX_init(BN_CTX *bctx)
 void
 BN_CTX_free(BN_CTX *bctx)
 {
-	size_t i;
-
 	if (bctx == NULL)
 		return;
 
-	for (i = 0; i < bctx->len; i++) {
-		BN_free(bctx->bignums[i]);
-		bctx->bignums[i] = NULL;
-	}
-
-	free(bctx->bignums);
-	free(bctx->groups);
+	if (bn_ctx_cache_put(bctx))
+		return;
 
-	freezero(bctx, sizeof(*bctx));
+	bn_ctx_destroy(bctx);
 }
 
 void
@@ -130,14 +248,7 @@ BN_CTX_get(BN_CTX *bctx)
 		}
 	}
 
-	if ((bn = bctx->bignums[bctx->index]) == NULL) {
-		if ((bn = BN_new()) == NULL) {
-			BNerror(BN_R_TOO_MANY_TEMPORARY_VARIABLES);
-			bctx->error = 1;
-			return NULL;
-		}
-		bctx->bignums[bctx->index] = bn;
-	}
+	bn = bctx->bignums[bctx->index];
 	bctx->groups[bctx->index] = bctx->group;
 	bctx->index++;
 
@@ -0,0 +1,434 @@
+/*	$OpenBSD$ */
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Multi-buffer modular exponentiation. Up to BN_MOD_EXP_MB_LANES independent
+ * exponentiations, each with its own modulus, are performed in lockstep. The
+ * numbers are held as 20 limbs of 52 bits, with the lanes of each limb being
+ * adjacent in memory, so that a single vector instruction operates on the
+ * same limb of every number.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <openssl/opensslconf.h>
+
+#include <openssl/bn.h>
+#include <openssl/crypto.h>
+#include <openssl/err.h>
+
+#include "bn_local.h"
+#include "cryptlib.h"
+
+#if defined(OPENSSL_BN_ASM_MONT_IFMA)
+#include "x86_arch.h"
+#endif
+
+#define BN_MB_LANES		BN_MOD_EXP_MB_LANES
+#define BN_MB_LIMBS		20
+#define BN_MB_LIMB_BITS		52
+#define BN_MB_LIMB_MASK		0xfffffffffffffULL
+#define BN_MB_WORDS		(BN_MB_LIMBS * BN_MB_LANES)
+#define BN_MB_BITS		(BN_MB_LIMBS * BN_MB_LIMB_BITS)
+
+/* Allow for a 64 bit load or store at the byte offset of the last limb. */
+#define BN_MB_BYTES		(BN_MB_BITS / 8 + 8)
+
+#define BN_MB_WINDOW		5
+#define BN_MB_TABLE_SIZE	(1 << BN_MB_WINDOW)
+
+#if defined(OPENSSL_BN_ASM_MONT_IFMA)
+void bn_mont_mul_52x20_x8_ifma(uint64_t *r, const uint64_t *a,
+    const uint64_t *b, const uint64_t *m, const uint64_t *k0);
+void bn_select_52x20_x8_win5_ifma(uint64_t *r, const uint64_t *table,
+    const uint64_t *idx);
+#endif
+
+struct bn_mod_exp_mb {
+	void (*mont_mul)(uint64_t *r, const uint64_t *a, const uint64_t *b,
+	    const uint64_t *m, const uint64_t *k0);
+	void (*select)(uint64_t *r, const uint64_t *table,
+	    const uint64_t *idx);
+	uint64_t m[BN_MB_WORDS];
+	uint64_t k0[BN_MB_LANES];
+	uint64_t one[BN_MB_WORDS];
+	uint64_t rr[BN_MB_WORDS];
+	uint64_t acc[BN_MB_WORDS];
+	uint64_t tmp[BN_MB_WORDS];
+	uint64_t table[BN_MB_TABLE_SIZE][BN_MB_WORDS];
+	unsigned char exp[BN_MB_LANES][BN_MB_BYTES];
+};
+
+/*
+ * Compute the 104 bit product of two 52 bit limbs, as a high and low limb.
+ */
+static inline void
+bn_mb_mulw52(uint64_t a, uint64_t b, uint64_t *out_hi, uint64_t *out_lo)
+{
+	uint64_t a0, a1, b0, b1, mid, lo;
+
+	a0 = a & 0x3ffffff;
+	a1 = a >> 26;
+	b0 = b & 0x3ffffff;
+	b1 = b >> 26;
+
+	mid = a1 * b0 + a0 * b1;
+	lo = a0 * b0 + ((mid & 0x3ffffff) << 26);
+
+	*out_hi = a1 * b1 + (mid >> 26) + (lo >> BN_MB_LIMB_BITS);
+	*out_lo = lo & BN_MB_LIMB_MASK;
+}
+
+/*
+ * Compute a * b * 2^-1040 mod m for each lane. This is the C equivalent of
+ * bn_mont_mul_52x20_x8_ifma(), which documents the constraints.
+ */
+static void
+bn_mont_mul_52x20_x8(uint64_t *r, const uint64_t *a, const uint64_t *b,
+    const uint64_t *m, const uint64_t *k0)
+{
+	uint64_t t[BN_MB_LIMBS + 1];
+	uint64_t hi, lo, q;
+	int i, j, l;
+
+	for (l = 0; l < BN_MB_LANES; l++) {
+		memset(t, 0, sizeof(t));
+
+		for (i = 0; i < BN_MB_LIMBS; i++) {
+			for (j = 0; j < BN_MB_LIMBS; j++) {
+				bn_mb_mulw52(a[j * BN_MB_LANES + l],
+				    b[i * BN_MB_LANES + l], &hi, &lo);
+				t[j] += lo;
+				t[j + 1] += hi;
+			}
+			q = (t[0] * k0[l]) & BN_MB_LIMB_MASK;
+			for (j = 0; j < BN_MB_LIMBS; j++) {
+				bn_mb_mulw52(m[j * BN_MB_LANES + l], q,
+				    &hi, &lo);
+				t[j] += lo;
+				t[j + 1] += hi;
+			}
+			t[1] += t[0] >> BN_MB_LIMB_BITS;
+			for (j = 0; j < BN_MB_LIMBS; j++)
+				t[j] = t[j + 1];
+			t[BN_MB_LIMBS] = 0;
+		}
+
+		for (j = 0; j < BN_MB_LIMBS - 1; j++) {
+			t[j + 1] += t[j] >> BN_MB_LIMB_BITS;
+			t[j] &= BN_MB_LIMB_MASK;
+		}
+		for (j = 0; j < BN_MB_LIMBS; j++)
+			r[j * BN_MB_LANES + l] = t[j];
+	}
+
+	explicit_bzero(t, sizeof(t));
+}
+
+/*
+ * Select table entry idx[l] for each lane l, reading every entry.
+ */
+static void
+bn_select_52x20_x8_win5(uint64_t *r, const uint64_t *table,
+    const uint64_t *idx)
+{
+	uint64_t mask[BN_MB_LANES];
+	int j, k, l;
+
+	memset(r, 0, BN_MB_WORDS * sizeof(*r));
+
+	for (k = 0; k < BN_MB_TABLE_SIZE; k++) {
+		for (l = 0; l < BN_MB_LANES; l++)
+			mask[l] = 0 - (((idx[l] ^ k) - 1) >> 63);
+		for (j = 0; j < BN_MB_WORDS; j += BN_MB_LANES) {
+			for (l = 0; l < BN_MB_LANES; l++)
+				r[j + l] |= table[j + l] & mask[l];
+		}
+		table += BN_MB_WORDS;
+	}
+}
+
+int
+bn_mod_exp_mb_accelerated(void)
+{
+#if defined(OPENSSL_BN_ASM_MONT_IFMA)
+	return (OPENSSL_cpu_caps() & CPUCAP_MASK_AVX512IFMA) != 0;
+#else
+	return 0;
+#endif
+}
+
+const char *
+bn_mod_exp_mb_cpu_impl(void)
+{
+	return bn_mod_exp_mb_accelerated() ? "avx512ifma" : "c";
+}
+
+/*
+ * Compute -m^-1 mod 2^52 from the low limb of an odd modulus.
+ */
+static uint64_t
+bn_mb_k0(uint64_t m0)
+{
+	uint64_t inv = m0;
+	int i;
+
+	/* Newton iteration, doubling the number of correct bits each time. */
+	for (i = 0; i < 5; i++)
+		inv *= 2 - m0 * inv;
+
+	return (0 - inv) & BN_MB_LIMB_MASK;
+}
+
+static int
+bn_mb_set_lane(uint64_t *r, int lane, const BIGNUM *a)
+{
+	unsigned char buf[BN_MB_BYTES];
+	uint64_t v;
+	int i, j, bit;
+
+	if (BN_bn2lebinpad(a, buf, sizeof(buf)) != sizeof(buf))
+		return 0;
+
+	for (j = 0; j < BN_MB_LIMBS; j++) {
+		bit = j * BN_MB_LIMB_BITS;
+		v = 0;
+		for (i = 7; i >= 0; i--)
+			v = v << 8 | buf[bit / 8 + i];
+		r[j * BN_MB_LANES + lane] = (v >> (bit % 8)) & BN_MB_LIMB_MASK;
+	}
+
+	explicit_bzero(buf, sizeof(buf));
+
+	return 1;
+}
+
+static int
+bn_mb_get_lane(BIGNUM *r, const uint64_t *a, int lane)
+{
+	unsigned char buf[BN_MB_BYTES];
+	uint64_t v;
+	int i, j, bit;
+	int ret = 0;
+
+	memset(buf, 0, sizeof(buf));
+
+	for (j = 0; j < BN_MB_LIMBS; j++) {
+		bit = j * BN_MB_LIMB_BITS;
+		v = a[j * BN_MB_LANES + lane] << (bit % 8);
+		for (i = 0; i < 8; i++)
+			buf[bit / 8 + i] |= (v >> (8 * i)) & 0xff;
+	}
+
+	if (BN_lebin2bn(buf, sizeof(buf), r) == NULL)
+		goto err;
+
+	ret = 1;
+
+ err:
+	explicit_bzero(buf, sizeof(buf));
+
+	return ret;
+}
+
+/*
+ * Reduce each lane of r, which must be at most m, to less than m.
+ */
+static void
+bn_mb_reduce(uint64_t *r, const uint64_t *m)
+{
+	uint64_t t[BN_MB_LIMBS];
+	uint64_t borrow, d, mask;
+	int j, l;
+
+	for (l = 0; l < BN_MB_LANES; l++) {
+		borrow = 0;
+		for (j = 0; j < BN_MB_LIMBS; j++) {
+			d = r[j * BN_MB_LANES + l] - m[j * BN_MB_LANES + l] -
+			    borrow;
+			t[j] = d & BN_MB_LIMB_MASK;
+			borrow = d >> 63;
+		}
+		mask = borrow - 1;
+		for (j = 0; j < BN_MB_LIMBS; j++) {
+			r[j * BN_MB_LANES + l] = (t[j] & mask) |
+			    (r[j * BN_MB_LANES + l] & ~mask);
+		}
+	}
+
+	explicit_bzero(t, sizeof(t));
+}
+
+static unsigned int
+bn_mb_window(const unsigned char *exp, int bit)
+{
+	unsigned int w;
+
+	w = exp[bit / 8] | (unsigned int)exp[bit / 8 + 1] << 8;
+
+	return (w >> (bit % 8)) & (BN_MB_TABLE_SIZE - 1);
+}
+
+/*
+ * Select the table entry for each lane at the window starting at the given
+ * exponent bit.
+ */
+static void
+bn_mb_select(struct bn_mod_exp_mb *mb, uint64_t *r, int bit)
+{
+	uint64_t idx[BN_MB_LANES];
+	int l;
+
+	for (l = 0; l < BN_MB_LANES; l++)
+		idx[l] = bn_mb_window(mb->exp[l], bit);
+
+	mb->select(r, mb->table[0], idx);
+
+	explicit_bzero(idx, sizeof(idx));
+}
+
+/*
+ * Compute rr[i] = a[i]^p[i] mod m[i] for up to BN_MOD_EXP_MB_LANES values of
+ * i, in constant time. Each m[i] must be odd and no more than
+ * BN_MOD_EXP_MB_MAX_BITS in length.
+ */
+int
+bn_mod_exp_mont_consttime_mb(BIGNUM **rr, const BIGNUM **a,
+    const BIGNUM **p, const BIGNUM **m, size_t n, BN_CTX *ctx)
+{
+	struct bn_mod_exp_mb *mb = NULL;
+	BIGNUM *t;
+	int bits = 0;
+	int bit, j, k;
+	size_t i;
+	int ret = 0;
+
+	BN_CTX_start(ctx);
+
+	if ((t = BN_CTX_get(ctx)) == NULL)
+		goto err;
+
+	if (n == 0 || n > BN_MB_LANES) {
+		BNerror(BN_R_INVALID_LENGTH);
+		goto err;
+	}
+
+	if ((mb = calloc(1, sizeof(*mb))) == NULL) {
+		BNerror(ERR_R_MALLOC_FAILURE);
+		goto err;
+	}
+
+	mb->mont_mul = bn_mont_mul_52x20_x8;
+	mb->select = bn_select_52x20_x8_win5;
+#if defined(OPENSSL_BN_ASM_MONT_IFMA)
+	if (bn_mod_exp_mb_accelerated()) {
+		mb->mont_mul = bn_mont_mul_52x20_x8_ifma;
+		mb->select = bn_select_52x20_x8_win5_ifma;
+	}
+#endif
+
+	for (i = 0; i < n; i++) {
+		if (!BN_is_odd(m[i])) {
+			BNerror(BN_R_CALLED_WITH_EVEN_MODULUS);
+			goto err;
+		}
+		if (BN_is_negative(m[i]) ||
+		    BN_num_bits(m[i]) > BN_MOD_EXP_MB_MAX_BITS ||
+		    BN_is_negative(p[i]) || BN_num_bits(p[i]) > BN_MB_BITS) {
+			BNerror(BN_R_BIGNUM_TOO_LONG);
+			goto err;
+		}
+		if (BN_num_bits(p[i]) > bits)
+			bits = BN_num_bits(p[i]);
+		if (BN_bn2lebinpad(p[i], mb->exp[i], BN_MB_BYTES) !=
+		    BN_MB_BYTES)
+			goto err;
+
+		if (!bn_mb_set_lane(mb->m, i, m[i]))
+			goto err;
+		mb->k0[i] = bn_mb_k0(mb->m[i]);
+
+		/* Stash a in the first power of the table. */
+		if (BN_is_negative(a[i]) || BN_ucmp(a[i], m[i]) >= 0) {
+			if (!BN_nnmod(t, a[i], m[i], ctx))
+				goto err;
+			if (!bn_mb_set_lane(mb->table[1], i, t))
+				goto err;
+		} else {
+			if (!bn_mb_set_lane(mb->table[1], i, a[i]))
+				goto err;
+		}
+
+		/* R^2 mod m, where R is 2^1040. */
+		BN_zero(t);
+		if (!BN_set_bit(t, 2 * BN_MB_BITS))
+			goto err;
+		if (!BN_mod_ct(t, t, m[i], ctx))
+			goto err;
+		if (!bn_mb_set_lane(mb->rr, i, t))
+			goto err;
+	}
+
+	/*
+	 * Unused lanes have a zero modulus and operands, which produce zero
+	 * results that are discarded.
+	 */
+	for (i = 0; i < BN_MB_LANES; i++)
+		mb->one[i] = 1;
+
+	/* Powers of a in Montgomery form, starting with a^0 = R mod m. */
+	mb->mont_mul(mb->table[0], mb->rr, mb->one, mb->m, mb->k0);
+	mb->mont_mul(mb->table[1], mb->table[1], mb->rr, mb->m, mb->k0);
+	for (k = 2; k < BN_MB_TABLE_SIZE; k++)
+		mb->mont_mul(mb->table[k], mb->table[k - 1], mb->table[1],
+		    mb->m, mb->k0);
+
+	if (bits == 0) {
+		memcpy(mb->acc, mb->table[0], sizeof(mb->acc));
+	} else {
+		bit = ((bits - 1) / BN_MB_WINDOW) * BN_MB_WINDOW;
+		bn_mb_select(mb, mb->acc, bit);
+
+		while (bit > 0) {
+			bit -= BN_MB_WINDOW;
+			for (j = 0; j < BN_MB_WINDOW; j++)
+				mb->mont_mul(mb->acc, mb->acc, mb->acc, mb->m,
+				    mb->k0);
+			bn_mb_select(mb, mb->tmp, bit);
+			mb->mont_mul(mb->acc, mb->acc, mb->tmp, mb->m, mb->k0);
+		}
+	}
+
+	/* Convert out of Montgomery form, which leaves the result <= m. */
+	mb->mont_mul(mb->acc, mb->acc, mb->one, mb->m, mb->k0);
+	bn_mb_reduce(mb->acc, mb->m);
+
+	for (i = 0; i < n; i++) {
+		if (!bn_mb_get_lane(rr[i], mb->acc, i))
+			goto err;
+	}
+
+	ret = 1;
+
+ err:
+	freezero(mb, sizeof(*mb));
+	BN_CTX_end(ctx);
+
+	return ret;
+}
@@ -296,6 +296,15 @@ int BN_mod_exp_mont_ct(BIGNUM *r, const BIGNUM *a, const BIGNUM *p,
     const BIGNUM *m, BN_CTX *ctx, BN_MONT_CTX *m_ctx);
 int BN_mod_exp_mont_nonct(BIGNUM *r, const BIGNUM *a, const BIGNUM *p,
     const BIGNUM *m, BN_CTX *ctx, BN_MONT_CTX *m_ctx);
+
+/* Multi-buffer modular exponentiation for moduli of up to 1038 bits. */
+#define BN_MOD_EXP_MB_LANES	8
+#define BN_MOD_EXP_MB_MAX_BITS	1038
+
+int bn_mod_exp_mb_accelerated(void);
+int bn_mod_exp_mont_consttime_mb(BIGNUM **rr, const BIGNUM **a,
+    const BIGNUM **p, const BIGNUM **m, size_t n, BN_CTX *ctx);
+
 int BN_div_nonct(BIGNUM *q, BIGNUM *r, const BIGNUM *n, const BIGNUM *d,
     BN_CTX *ctx);
 int BN_div_ct(BIGNUM *q, BIGNUM *r, const BIGNUM *n, const BIGNUM *d,
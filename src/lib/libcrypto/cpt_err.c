@@ -82,6 +82,7 @@ static ERR_STRING_DATA CRYPTO_str_functs[] = {
 static ERR_STRING_DATA CRYPTO_str_reasons[] = {
 	{ERR_REASON(CRYPTO_R_FIPS_MODE_NOT_SUPPORTED), "fips mode not supported"},
 	{ERR_REASON(CRYPTO_R_NO_DYNLOCK_CREATE_CALLBACK), "no dynlock create callback"},
+	{ERR_REASON(CRYPTO_R_UNKNOWN_CPU_CAPABILITY), "unknown cpu capability"},
 	{0, NULL}
 };
 
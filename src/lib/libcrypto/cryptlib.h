@@ -77,6 +77,13 @@ extern "C" {
 
 void OPENSSL_cpuid_setup(void);
 
+void bn_ctx_cache_free(void);
+
+/* The implementations selected by the dispatch code of each primitive. */
+const char *aes_cpu_impl(void);
+const char *bn_mod_exp_mb_cpu_impl(void);
+const char *gcm128_cpu_impl(void);
+
 #ifdef  __cplusplus
 }
 #endif
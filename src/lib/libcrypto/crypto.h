@@ -492,6 +492,9 @@ void OpenSSLDie(const char *file, int line, const char *assertion);
 #define OPENSSL_assert(e)       (void)((e) ? 0 : (OpenSSLDie(__FILE__, __LINE__, #e),1))
 
 uint64_t OPENSSL_cpu_caps(void);
+int OPENSSL_cpu_caps_disable(const char *caps);
+const char *OPENSSL_cpu_impl(const char *primitive);
+const char *OPENSSL_cpu_impl_primitive(size_t idx);
 
 int OPENSSL_isservice(void);
 
@@ -528,6 +531,7 @@ void ERR_load_CRYPTO_strings(void);
 /* Reason codes. */
 #define CRYPTO_R_FIPS_MODE_NOT_SUPPORTED		 101
 #define CRYPTO_R_NO_DYNLOCK_CREATE_CALLBACK		 100
+#define CRYPTO_R_UNKNOWN_CPU_CAPABILITY			 102
 
 /*
  * OpenSSL compatible OPENSSL_INIT options.
@@ -18,6 +18,8 @@
 
 #include <pthread.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include <openssl/conf.h>
 #include <openssl/engine.h>
@@ -28,6 +30,17 @@
 #include "cryptlib.h"
 #include "x509_issuer_cache.h"
 
+#if defined(__i386__) || defined(__x86_64__)
+#define CRYPTO_CPU_X86
+#include "x86_arch.h"
+#elif defined(OPENSSL_CPUID_OBJ) && defined(__arm__)
+#define CRYPTO_CPU_ARM
+#include "arm_arch.h"
+#elif defined(OPENSSL_CPUID_OBJ) && defined(__aarch64__)
+#define CRYPTO_CPU_ARM
+#include "arm64_arch.h"
+#endif
+
 int OpenSSL_config(const char *);
 int OpenSSL_no_config(void);
 
@@ -81,6 +94,220 @@ OPENSSL_cleanup(void)
 	ENGINE_cleanup();
 	EVP_cleanup();
 	x509_issuer_cache_free();
+	bn_ctx_cache_free();
 
 	crypto_init_cleaned_up = 1;
 }
+
+/*
+ * CPU capabilities that may be disabled via OPENSSL_cpu_caps_disable().
+ */
+struct crypto_cpu_cap {
+	const char *name;
+	uint64_t mask;
+};
+
+static const struct crypto_cpu_cap crypto_cpu_caps[] = {
+#if defined(CRYPTO_CPU_X86)
+	{ "aesni", CPUCAP_MASK_AESNI },
+	{ "avx", CPUCAP_MASK_AVX },
+	{ "avx512ifma", CPUCAP_MASK_AVX512IFMA },
+	{ "fxsr", CPUCAP_MASK_FXSR },
+	{ "mmx", CPUCAP_MASK_MMX },
+	{ "pclmul", CPUCAP_MASK_PCLMUL },
+	{ "sse", CPUCAP_MASK_SSE },
+	{ "ssse3", CPUCAP_MASK_SSSE3 },
+	{ "vaes512", CPUCAP_MASK_VAES512 },
+#elif defined(CRYPTO_CPU_ARM)
+	{ "neon", ARMV7_NEON },
+	{ "armv8-aes", ARMV8_AES },
+	{ "armv8-pmull", ARMV8_PMULL },
+	{ "armv8-sha1", ARMV8_SHA1 },
+	{ "armv8-sha256", ARMV8_SHA256 },
+#endif
+	{ NULL, 0 },
+};
+
+#if defined(CRYPTO_CPU_X86)
+extern uint64_t OPENSSL_ia32cap_P;
+#endif
+
+static void
+crypto_cpu_caps_clear(uint64_t mask)
+{
+#if defined(CRYPTO_CPU_X86)
+	OPENSSL_ia32cap_P &= ~mask;
+#elif defined(CRYPTO_CPU_ARM)
+	OPENSSL_armcap_P &= ~(unsigned int)mask;
+#endif
+}
+
+/*
+ * The implementations of AES, GHASH and multi-buffer Montgomery
+ * multiplication are reported by the code that selects them. Assembly
+ * implementations of the remaining primitives choose between instruction
+ * set extensions internally, hence they are only reported as "asm".
+ */
+
+static const char *
+crypto_cpu_impl_aes(void)
+{
+	return aes_cpu_impl();
+}
+
+static const char *
+crypto_cpu_impl_ghash(void)
+{
+	return gcm128_cpu_impl();
+}
+
+static const char *
+crypto_cpu_impl_sha1(void)
+{
+#if defined(SHA1_ASM)
+	return "asm";
+#else
+	return "c";
+#endif
+}
+
+static const char *
+crypto_cpu_impl_sha256(void)
+{
+#if defined(SHA256_ASM)
+	return "asm";
+#else
+	return "c";
+#endif
+}
+
+static const char *
+crypto_cpu_impl_sha512(void)
+{
+#if defined(SHA512_ASM)
+	return "asm";
+#else
+	return "c";
+#endif
+}
+
+static const char *
+crypto_cpu_impl_chacha(void)
+{
+	return "c";
+}
+
+static const char *
+crypto_cpu_impl_poly1305(void)
+{
+	return "c";
+}
+
+static const char *
+crypto_cpu_impl_bn_mont(void)
+{
+#if defined(OPENSSL_BN_ASM_MONT) && !defined(OPENSSL_NO_ASM)
+	return "asm";
+#else
+	return "c";
+#endif
+}
+
+static const char *
+crypto_cpu_impl_bn_mont_mb(void)
+{
+	return bn_mod_exp_mb_cpu_impl();
+}
+
+struct crypto_cpu_impl {
+	const char *primitive;
+	const char *(*impl)(void);
+};
+
+static const struct crypto_cpu_impl crypto_cpu_impls[] = {
+	{ "aes", crypto_cpu_impl_aes },
+	{ "ghash", crypto_cpu_impl_ghash },
+	{ "sha1", crypto_cpu_impl_sha1 },
+	{ "sha256", crypto_cpu_impl_sha256 },
+	{ "sha512", crypto_cpu_impl_sha512 },
+	{ "chacha", crypto_cpu_impl_chacha },
+	{ "poly1305", crypto_cpu_impl_poly1305 },
+	{ "bn_mont", crypto_cpu_impl_bn_mont },
+	{ "bn_mont_mb", crypto_cpu_impl_bn_mont_mb },
+};
+
+#define N_CRYPTO_CPU_IMPLS \
+    (sizeof(crypto_cpu_impls) / sizeof(crypto_cpu_impls[0]))
+
+const char *
+OPENSSL_cpu_impl(const char *primitive)
+{
+	size_t i;
+
+	if (!OPENSSL_init_crypto(0, NULL))
+		return NULL;
+
+	for (i = 0; i < N_CRYPTO_CPU_IMPLS; i++) {
+		if (strcmp(crypto_cpu_impls[i].primitive, primitive) == 0)
+			return crypto_cpu_impls[i].impl();
+	}
+
+	return NULL;
+}
+
+const char *
+OPENSSL_cpu_impl_primitive(size_t idx)
+{
+	if (idx >= N_CRYPTO_CPU_IMPLS)
+		return NULL;
+
+	return crypto_cpu_impls[idx].primitive;
+}
+
+/*
+ * Disable the named CPU capabilities, given as a comma or space separated
+ * list. The capabilities are read without synchronisation by the dispatch
+ * code, hence this may only be called during initialisation, before any
+ * other thread uses the library. It also only affects contexts that are
+ * initialised after the call.
+ */
+int
+OPENSSL_cpu_caps_disable(const char *caps)
+{
+	const struct crypto_cpu_cap *cap;
+	char *names = NULL, *s, *name;
+	uint64_t mask = 0;
+	int ret = 0;
+
+	if (!OPENSSL_init_crypto(0, NULL))
+		return 0;
+
+	if ((names = strdup(caps)) == NULL) {
+		CRYPTOerror(ERR_R_MALLOC_FAILURE);
+		goto err;
+	}
+
+	s = names;
+	while ((name = strsep(&s, ", ")) != NULL) {
+		if (*name == '\0')
+			continue;
+		for (cap = crypto_cpu_caps; cap->name != NULL; cap++) {
+			if (strcmp(cap->name, name) == 0)
+				break;
+		}
+		if (cap->name == NULL) {
+			CRYPTOerror(CRYPTO_R_UNKNOWN_CPU_CAPABILITY);
+			goto err;
+		}
+		mask |= cap->mask;
+	}
+
+	crypto_cpu_caps_clear(mask);
+
+	ret = 1;
+
+ err:
+	free(names);
+
+	return ret;
+}
@@ -3163,6 +3163,12 @@ static const struct {
 
 #endif
 
+#ifdef HAVE_EC_GFP_P256_METHOD
+#define EC_P256_METHOD	EC_GFp_p256_method
+#else
+#define EC_P256_METHOD	0
+#endif
+
 typedef struct _ec_list_element_st {
 	int nid;
 	const EC_CURVE_DATA *data;
@@ -3195,7 +3201,7 @@ static const ec_list_element curve_list[] = {
 	{NID_X9_62_prime239v1, &_EC_X9_62_PRIME_239V1.h, 0, "X9.62 curve over a 239 bit prime field"},
 	{NID_X9_62_prime239v2, &_EC_X9_62_PRIME_239V2.h, 0, "X9.62 curve over a 239 bit prime field"},
 	{NID_X9_62_prime239v3, &_EC_X9_62_PRIME_239V3.h, 0, "X9.62 curve over a 239 bit prime field"},
-	{NID_X9_62_prime256v1, &_EC_X9_62_PRIME_256V1.h, 0, "X9.62/SECG curve over a 256 bit prime field"},
+	{NID_X9_62_prime256v1, &_EC_X9_62_PRIME_256V1.h, EC_P256_METHOD, "X9.62/SECG curve over a 256 bit prime field"},
 #ifndef OPENSSL_NO_EC2M
 	/* characteristic two field curves */
 	/* NIST/SECG curves */
@@ -647,8 +647,20 @@ EC_GROUP_cmp(const EC_GROUP *a, const EC_GROUP *b, BN_CTX *ctx)
 	if (r || BN_cmp(a1, b1) || BN_cmp(a2, b2) || BN_cmp(a3, b3))
 		r = 1;
 
-	/* XXX EC_POINT_cmp() assumes that the methods are equal */
-	if (r || EC_POINT_cmp(a, EC_GROUP_get0_generator(a),
+	/*
+	 * EC_POINT_cmp() assumes that the methods are equal. A named curve
+	 * may use a specialized method, while the same curve decoded from
+	 * explicit parameters does not, so compare affine coordinates then.
+	 */
+	if (!r && a->meth != b->meth) {
+		if (!EC_POINT_get_affine_coordinates(a,
+		    EC_GROUP_get0_generator(a), a1, a2, ctx) ||
+		    !EC_POINT_get_affine_coordinates(b,
+		    EC_GROUP_get0_generator(b), b1, b2, ctx))
+			goto err;
+		if (BN_cmp(a1, b1) || BN_cmp(a2, b2))
+			r = 1;
+	} else if (r || EC_POINT_cmp(a, EC_GROUP_get0_generator(a),
 		EC_GROUP_get0_generator(b), ctx))
 		r = 1;
 
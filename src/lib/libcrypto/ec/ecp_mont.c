@@ -75,7 +75,7 @@ ec_GFp_mont_group_clear(EC_GROUP *group)
 	group->mont_one = NULL;
 }
 
-static int
+int
 ec_GFp_mont_group_init(EC_GROUP *group)
 {
 	int ok;
@@ -86,14 +86,14 @@ ec_GFp_mont_group_init(EC_GROUP *group)
 	return ok;
 }
 
-static void
+void
 ec_GFp_mont_group_finish(EC_GROUP *group)
 {
 	ec_GFp_mont_group_clear(group);
 	ec_GFp_simple_group_finish(group);
 }
 
-static int
+int
 ec_GFp_mont_group_copy(EC_GROUP *dest, const EC_GROUP *src)
 {
 	ec_GFp_mont_group_clear(dest);
@@ -123,7 +123,7 @@ ec_GFp_mont_group_copy(EC_GROUP *dest, const EC_GROUP *src)
 	return 0;
 }
 
-static int
+int
 ec_GFp_mont_group_set_curve(EC_GROUP *group, const BIGNUM *p, const BIGNUM *a,
     const BIGNUM *b, BN_CTX *ctx)
 {
@@ -162,7 +162,7 @@ ec_GFp_mont_group_set_curve(EC_GROUP *group, const BIGNUM *p, const BIGNUM *a,
 	return ret;
 }
 
-static int
+int
 ec_GFp_mont_field_mul(const EC_GROUP *group, BIGNUM *r, const BIGNUM *a,
     const BIGNUM *b, BN_CTX *ctx)
 {
@@ -173,7 +173,7 @@ ec_GFp_mont_field_mul(const EC_GROUP *group, BIGNUM *r, const BIGNUM *a,
 	return BN_mod_mul_montgomery(r, a, b, group->mont_ctx, ctx);
 }
 
-static int
+int
 ec_GFp_mont_field_sqr(const EC_GROUP *group, BIGNUM *r, const BIGNUM *a,
     BN_CTX *ctx)
 {
@@ -184,7 +184,7 @@ ec_GFp_mont_field_sqr(const EC_GROUP *group, BIGNUM *r, const BIGNUM *a,
 	return BN_mod_mul_montgomery(r, a, a, group->mont_ctx, ctx);
 }
 
-static int
+int
 ec_GFp_mont_field_encode(const EC_GROUP *group, BIGNUM *r, const BIGNUM *a,
     BN_CTX *ctx)
 {
@@ -195,7 +195,7 @@ ec_GFp_mont_field_encode(const EC_GROUP *group, BIGNUM *r, const BIGNUM *a,
 	return BN_to_montgomery(r, a, group->mont_ctx, ctx);
 }
 
-static int
+int
 ec_GFp_mont_field_decode(const EC_GROUP *group, BIGNUM *r, const BIGNUM *a,
     BN_CTX *ctx)
 {
@@ -206,7 +206,7 @@ ec_GFp_mont_field_decode(const EC_GROUP *group, BIGNUM *r, const BIGNUM *a,
 	return BN_from_montgomery(r, a, group->mont_ctx, ctx);
 }
 
-static int
+int
 ec_GFp_mont_field_set_to_one(const EC_GROUP *group, BIGNUM *r, BN_CTX *ctx)
 {
 	if (group->mont_one == NULL) {
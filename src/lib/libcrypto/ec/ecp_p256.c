@@ -0,0 +1,1238 @@
+/*	$OpenBSD$ */
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Constant time arithmetic for the NIST P-256 curve (X9.62 prime256v1).
+ *
+ * Field elements are held in four 64 bit limbs in the Montgomery domain with
+ * R = 2^256. This is the same representation that EC_GFp_mont_method() uses
+ * for the coordinates of an EC_POINT, so points can be converted to and from
+ * the fixed size representation by copying words. Only the scalar
+ * multiplications, the conversion to affine coordinates and the field
+ * multiplication are replaced - everything else is handled by the generic
+ * Montgomery and simple methods.
+ *
+ * Variable base multiplication uses a fixed 4 bit window with a constant time
+ * table lookup, while multiplication of the generator uses a comb with two
+ * precomputed tables of 16 affine points each.
+ */
+
+#include <string.h>
+
+#include <openssl/bn.h>
+#include <openssl/ec.h>
+#include <openssl/err.h>
+#include <openssl/objects.h>
+
+#include "bn_internal.h"
+#include "ec_local.h"
+
+#ifdef HAVE_EC_GFP_P256_METHOD
+
+#define P256_LIMBS	4
+
+typedef BN_ULONG p256_felem[P256_LIMBS];
+
+struct p256_point {
+	p256_felem X;
+	p256_felem Y;
+	p256_felem Z;
+};
+
+struct p256_affine {
+	p256_felem x;
+	p256_felem y;
+};
+
+/* p = 2^256 - 2^224 + 2^192 + 2^96 - 1 */
+static const p256_felem p256_p = {
+	0xffffffffffffffffULL, 0x00000000ffffffffULL,
+	0x0000000000000000ULL, 0xffffffff00000001ULL,
+};
+
+/* n, the order of the generator. */
+static const p256_felem p256_n = {
+	0xf3b9cac2fc632551ULL, 0xbce6faada7179e84ULL,
+	0xffffffffffffffffULL, 0xffffffff00000000ULL,
+};
+
+/* R mod p, that is one in the Montgomery domain. */
+static const p256_felem p256_one = {
+	0x0000000000000001ULL, 0xffffffff00000000ULL,
+	0xffffffffffffffffULL, 0x00000000fffffffeULL,
+};
+
+/*
+ * Precomputed multiples of the generator G for the comb, in affine
+ * coordinates and in the Montgomery domain. For a 4 bit index with bits
+ * b0..b3, p256_base_table[0][index] is the sum of b_i * 2^(64 * i) * G and
+ * p256_base_table[1][index] is 2^32 times that point. The zero index denotes
+ * the point at infinity. Generated by ecp_p256_table.pl.
+ */
+static const struct p256_affine p256_base_table[2][16] = {
+	{
+		{
+			.x = { 0 },
+			.y = { 0 },
+		},
+		{
+			.x = {
+				0x79e730d418a9143c, 0x75ba95fc5fedb601,
+				0x79fb732b77622510, 0x18905f76a53755c6,
+			},
+			.y = {
+				0xddf25357ce95560a, 0x8b4ab8e4ba19e45c,
+				0xd2e88688dd21f325, 0x8571ff1825885d85,
+			},
+		},
+		{
+			.x = {
+				0x4f922fc516a0d2bb, 0x0d5cc16c1a623499,
+				0x9241cf3a57c62c8b, 0x2f5e6961fd1b667f,
+			},
+			.y = {
+				0x5c15c70bf5a01797, 0x3d20b44d60956192,
+				0x04911b37071fdb52, 0xf648f9168d6f0f7b,
+			},
+		},
+		{
+			.x = {
+				0x9e566847e137bbbc, 0xe434469e8a6a0bec,
+				0xb1c4276179d73463, 0x5abe0285133d0015,
+			},
+			.y = {
+				0x92aa837cc04c7dab, 0x573d9f4c43260c07,
+				0x0c93156278e6cc37, 0x94bb725b6b6f7383,
+			},
+		},
+		{
+			.x = {
+				0x62a8c244bfe20925, 0x91c19ac38fdce867,
+				0x5a96a5d5dd387063, 0x61d587d421d324f6,
+			},
+			.y = {
+				0xe87673a2a37173ea, 0x2384800853778b65,
+				0x10f8441e05bab43e, 0xfa11fe124621efbe,
+			},
+		},
+		{
+			.x = {
+				0x1c891f2b2cb19ffd, 0x01ba8d5bb1923c23,
+				0xb6d03d678ac5ca8e, 0x586eb04c1f13bedc,
+			},
+			.y = {
+				0x0c35c6e527e8ed09, 0x1e81a33c1819ede2,
+				0x278fd6c056c652fa, 0x19d5ac0870864f11,
+			},
+		},
+		{
+			.x = {
+				0x62577734d2b533d5, 0x673b8af6a1bdddc0,
+				0x577e7c9aa79ec293, 0xbb6de651c3b266b1,
+			},
+			.y = {
+				0xe7e9303ab65259b3, 0xd6a0afd3d03a7480,
+				0xc5ac83d19b3cfc27, 0x60b4619a5d18b99b,
+			},
+		},
+		{
+			.x = {
+				0xbd6a38e11ae5aa1c, 0xb8b7652b49e73658,
+				0x0b130014ee5f87ed, 0x9d0f27b2aeebffcd,
+			},
+			.y = {
+				0xca9246317a730a55, 0x9c955b2fddbbc83a,
+				0x07c1dfe0ac019a71, 0x244a566d356ec48d,
+			},
+		},
+		{
+			.x = {
+				0x56f8410ef4f8b16a, 0x97241afec47b266a,
+				0x0a406b8e6d9c87c1, 0x803f3e02cd42ab1b,
+			},
+			.y = {
+				0x7f0309a804dbec69, 0xa83b85f73bbad05f,
+				0xc6097273ad8e197f, 0xc097440e5067adc1,
+			},
+		},
+		{
+			.x = {
+				0x846a56f2c379ab34, 0xa8ee068b841df8d1,
+				0x20314459176c68ef, 0xf1af32d5915f1f30,
+			},
+			.y = {
+				0x99c375315d75bd50, 0x837cffbaf72f67bc,
+				0x0613a41848d7723f, 0x23d0f130e2d41c8b,
+			},
+		},
+		{
+			.x = {
+				0xed93e225d5be5a2b, 0x6fe799835934f3c6,
+				0x4314092622626ffc, 0x50bbb4d97990216a,
+			},
+			.y = {
+				0x378191c6e57ec63e, 0x65422c40181dcdb2,
+				0x41a8099b0236e0f6, 0x2b10011801fe49c3,
+			},
+		},
+		{
+			.x = {
+				0xfc68b5c59b391593, 0xc385f5a2598270fc,
+				0x7144f3aad19adcbb, 0xdd55899983fbae0c,
+			},
+			.y = {
+				0x93b88b8e74b82ff4, 0xd2e03c4071e734c9,
+				0x9a7a9eaf43c0322a, 0xe6e4c551149d6041,
+			},
+		},
+		{
+			.x = {
+				0x5fe14bfe80ec21fe, 0xf6ce116ac255be82,
+				0x98bc5a072f4a5d67, 0xfad27148db7e63af,
+			},
+			.y = {
+				0x90c0b6ac29ab05b3, 0x37a9a83c4e251ae6,
+				0x0a7dc875c2aade7d, 0x77387de39f0e1a84,
+			},
+		},
+		{
+			.x = {
+				0x1e9ecc49a56c0dd7, 0xa5cffcd846086c74,
+				0x8f7a1408f505aece, 0xb37b85c0bef0c47e,
+			},
+			.y = {
+				0x3596b6e4cc0e6a8f, 0xfd6d4bbf6b388f23,
+				0xaba453fac39cef4e, 0x9c135ac8f9f628d5,
+			},
+		},
+		{
+			.x = {
+				0x0a1c729495c8f8be, 0x2961c4803bf362bf,
+				0x9e418403df63d4ac, 0xc109f9cb91ece900,
+			},
+			.y = {
+				0xc2d095d058945705, 0xb9083d96ddeb85c0,
+				0x84692b8d7a40449b, 0x9bc3344f2eee1ee1,
+			},
+		},
+		{
+			.x = {
+				0x0d5ae35642913074, 0x55491b2748a542b1,
+				0x469ca665b310732a, 0x29591d525f1a4cc1,
+			},
+			.y = {
+				0xe76f5b6bb84f983f, 0xbe7eef419f5f84e1,
+				0x1200d49680baa189, 0x6376551f18ef332c,
+			},
+		},
+	},
+	{
+		{
+			.x = { 0 },
+			.y = { 0 },
+		},
+		{
+			.x = {
+				0x202886024147519a, 0xd0981eac26b372f0,
+				0xa9d4a7caa785ebc8, 0xd953c50ddbdf58e9,
+			},
+			.y = {
+				0x9d6361ccfd590f8f, 0x72e9626b44e6c917,
+				0x7fd9611022eb64cf, 0x863ebb7e9eb288f3,
+			},
+		},
+		{
+			.x = {
+				0x4fe7ee31b0e63d34, 0xf4600572a9e54fab,
+				0xc0493334d5e7b5a4, 0x8589fb9206d54831,
+			},
+			.y = {
+				0xaa70f5cc6583553a, 0x0879094ae25649e5,
+				0xcc90450710044652, 0xebb0696d02541c4f,
+			},
+		},
+		{
+			.x = {
+				0xabbaa0c03b89da99, 0xa6f2d79eb8284022,
+				0x27847862b81c05e8, 0x337a4b5905e54d63,
+			},
+			.y = {
+				0x3c67500d21f7794a, 0x207005b77d6d7f61,
+				0x0a5a378104cfd6e8, 0x0d65e0d5f4c2fbd6,
+			},
+		},
+		{
+			.x = {
+				0xd433e50f6d3549cf, 0x6f33696ffacd665e,
+				0x695bfdacce11fcb4, 0x810ee252af7c9860,
+			},
+			.y = {
+				0x65450fe17159bb2c, 0xf7dfbebe758b357b,
+				0x2b057e74d69fea72, 0xd485717a92731745,
+			},
+		},
+		{
+			.x = {
+				0xce1f69bbe83f7669, 0x09f8ae8272877d6b,
+				0x9548ae543244278d, 0x207755dee3c2c19c,
+			},
+			.y = {
+				0x87bd61d96fef1945, 0x18813cefb12d28c3,
+				0x9fbcd1d672df64aa, 0x48dc5ee57154b00d,
+			},
+		},
+		{
+			.x = {
+				0xef0f469ef49a3154, 0x3e85a5956e2b2e9a,
+				0x45aaec1eaa924a9c, 0xaa12dfc8a09e4719,
+			},
+			.y = {
+				0x26f272274df69f1d, 0xe0e4c82ca2ff5e73,
+				0xb9d8ce73b7a9dd44, 0x6c036e73e48ca901,
+			},
+		},
+		{
+			.x = {
+				0xe1e421e1a47153f0, 0xb86c3b79920418c9,
+				0x93bdce87705d7672, 0xf25ae793cab79a77,
+			},
+			.y = {
+				0x1f3194a36d869d0c, 0x9d55c8824986c264,
+				0x49fb5ea3096e945e, 0x39b8e65313db0a3e,
+			},
+		},
+		{
+			.x = {
+				0xe3417bc035d0b34a, 0x440b386b8327c0a7,
+				0x8fb7262dac0362d1, 0x2c41114ce0cdf943,
+			},
+			.y = {
+				0x2ba5cef1ad95a0b1, 0xc09b37a867d54362,
+				0x26d6cdd201e486c9, 0x20477abf42ff9297,
+			},
+		},
+		{
+			.x = {
+				0x0f121b41bc0a67d2, 0x62d4760a444d248a,
+				0x0e044f1d659b4737, 0x08fde365250bb4a8,
+			},
+			.y = {
+				0xaceec3da848bf287, 0xc2a62182d3369d6e,
+				0x3582dfdc92449482, 0x2f7e2fd2565d6cd7,
+			},
+		},
+		{
+			.x = {
+				0x0a0122b5178a876b, 0x51ff96ff085104b4,
+				0x050b31ab14f29f76, 0x84abb28b5f87d4e6,
+			},
+			.y = {
+				0xd5ed439f8270790a, 0x2d6cb59d85e3f46b,
+				0x75f55c1b6c1e2212, 0xe5436f6717655640,
+			},
+		},
+		{
+			.x = {
+				0xc2965ecc9aeb596d, 0x01ea03e7023c92b4,
+				0x4704b4b62e013961, 0x0ca8fd3f905ea367,
+			},
+			.y = {
+				0x92523a42551b2b61, 0x1eb7a89c390fcd06,
+				0xe7f1d2be0392a63e, 0x96dca2644ddb0c33,
+			},
+		},
+		{
+			.x = {
+				0x231c210e15339848, 0xe87a28e870778c8d,
+				0x9d1de6616956e170, 0x4ac3c9382bb09c0b,
+			},
+			.y = {
+				0x19be05516998987d, 0x8b2376c4ae09f4d6,
+				0x1de0b7651a3f933d, 0x380d94c7e39705f4,
+			},
+		},
+		{
+			.x = {
+				0x3685954b8c31c31d, 0x68533d005bf21a0c,
+				0x0bd7626e75c79ec9, 0xca17754742c69d54,
+			},
+			.y = {
+				0xcc6edafff6d2dbb2, 0xfd0d8cbd174a9d18,
+				0x875e8793aa4578e8, 0xa976a7139cab2ce6,
+			},
+		},
+		{
+			.x = {
+				0xce37ab11b43ea1db, 0x0a7ff1a95259d292,
+				0x851b02218f84f186, 0xa7222beadefaad13,
+			},
+			.y = {
+				0xa2ac78ec2b0a9144, 0x5a024051f2fa59c5,
+				0x91d1eca56147ce38, 0xbe94d523bc2ac690,
+			},
+		},
+		{
+			.x = {
+				0x2d8daefd79ec1a0f, 0x3bbcd6fdceb39c97,
+				0xf5575ffc58f61a95, 0xdbd986c4adf7b420,
+			},
+			.y = {
+				0x81aa881415f39eb7, 0x6ee2fcf5b98d976c,
+				0x5465475dcf2f717d, 0x8e24d3c46860bbd0,
+			},
+		},
+	},
+};
+
+static void
+p256_felem_select(p256_felem r, BN_ULONG mask, const p256_felem a,
+    const p256_felem b)
+{
+	int i;
+
+	/* r = mask ? a : b */
+	for (i = 0; i < P256_LIMBS; i++)
+		r[i] = (a[i] & mask) | (b[i] & ~mask);
+}
+
+static BN_ULONG
+p256_felem_is_zero_mask(const p256_felem a)
+{
+	return bn_ct_eq_zero_mask(a[0] | a[1] | a[2] | a[3]);
+}
+
+/*
+ * Reduce (carry:t) modulo p, where (carry:t) < 2p and carry is 0 or 1.
+ */
+static void
+p256_felem_reduce_once(p256_felem r, BN_ULONG carry, const p256_felem t)
+{
+	p256_felem u;
+	BN_ULONG borrow;
+
+	bn_subw(t[0], p256_p[0], &borrow, &u[0]);
+	bn_subw_subw(t[1], p256_p[1], borrow, &borrow, &u[1]);
+	bn_subw_subw(t[2], p256_p[2], borrow, &borrow, &u[2]);
+	bn_subw_subw(t[3], p256_p[3], borrow, &borrow, &u[3]);
+
+	/* Keep t if the subtraction of p underflowed. */
+	p256_felem_select(r, bn_ct_ne_zero_mask(borrow & ~carry), t, u);
+}
+
+static void
+p256_felem_add(p256_felem r, const p256_felem a, const p256_felem b)
+{
+	p256_felem t;
+	BN_ULONG carry;
+
+	bn_addw(a[0], b[0], &carry, &t[0]);
+	bn_addw_addw(a[1], b[1], carry, &carry, &t[1]);
+	bn_addw_addw(a[2], b[2], carry, &carry, &t[2]);
+	bn_addw_addw(a[3], b[3], carry, &carry, &t[3]);
+
+	p256_felem_reduce_once(r, carry, t);
+}
+
+static void
+p256_felem_sub(p256_felem r, const p256_felem a, const p256_felem b)
+{
+	p256_felem t;
+	BN_ULONG borrow, carry, mask;
+
+	bn_subw(a[0], b[0], &borrow, &t[0]);
+	bn_subw_subw(a[1], b[1], borrow, &borrow, &t[1]);
+	bn_subw_subw(a[2], b[2], borrow, &borrow, &t[2]);
+	bn_subw_subw(a[3], b[3], borrow, &borrow, &t[3]);
+
+	/* Add p back if the subtraction underflowed. */
+	mask = bn_ct_ne_zero_mask(borrow);
+	bn_addw(t[0], p256_p[0] & mask, &carry, &r[0]);
+	bn_addw_addw(t[1], p256_p[1] & mask, carry, &carry, &r[1]);
+	bn_addw_addw(t[2], p256_p[2] & mask, carry, &carry, &r[2]);
+	bn_addw_addw(t[3], p256_p[3] & mask, carry, &carry, &r[3]);
+}
+
+/*
+ * Montgomery multiplication, r = a * b * R^-1 mod p, using coarsely integrated
+ * operand scanning. Since p = -1 mod 2^64, -p^-1 mod 2^64 is 1 and the
+ * Montgomery factor for each round is simply the least significant word.
+ */
+static void
+p256_felem_mul(p256_felem r, const p256_felem a, const p256_felem b)
+{
+	BN_ULONG t[P256_LIMBS + 2];
+	BN_ULONG carry, m, x;
+	int i, j;
+
+	memset(t, 0, sizeof(t));
+
+	for (i = 0; i < P256_LIMBS; i++) {
+		/* t += a * b[i] */
+		carry = 0;
+		for (j = 0; j < P256_LIMBS; j++)
+			bn_mulw_addw_addw(a[j], b[i], t[j], carry, &carry,
+			    &t[j]);
+		bn_addw(t[P256_LIMBS], carry, &t[P256_LIMBS + 1],
+		    &t[P256_LIMBS]);
+
+		/* t = (t + m * p) / 2^64 */
+		m = t[0];
+		bn_mulw_addw(m, p256_p[0], t[0], &carry, &x);
+		for (j = 1; j < P256_LIMBS; j++)
+			bn_mulw_addw_addw(m, p256_p[j], t[j], carry, &carry,
+			    &t[j - 1]);
+		bn_addw(t[P256_LIMBS], carry, &carry, &t[P256_LIMBS - 1]);
+		t[P256_LIMBS] = t[P256_LIMBS + 1] + carry;
+	}
+
+	p256_felem_reduce_once(r, t[P256_LIMBS], t);
+}
+
+static void
+p256_felem_sqr(p256_felem r, const p256_felem a)
+{
+	p256_felem_mul(r, a, a);
+}
+
+static void
+p256_felem_sqr_n(p256_felem r, const p256_felem a, int n)
+{
+	p256_felem_sqr(r, a);
+	while (--n > 0)
+		p256_felem_sqr(r, r);
+}
+
+/*
+ * Compute r = a^-1 as a^(p - 2) using a fixed addition chain, where
+ * p - 2 = ffffffff 00000001 00000000 00000000 00000000 ffffffff ffffffff
+ * fffffffd. The input of zero maps to zero.
+ */
+static void
+p256_felem_inv(p256_felem r, const p256_felem a)
+{
+	p256_felem e2, e4, e8, e16, e32, t;
+
+	/* e_n = a^(2^n - 1) */
+	p256_felem_sqr(t, a);
+	p256_felem_mul(e2, t, a);
+	p256_felem_sqr_n(t, e2, 2);
+	p256_felem_mul(e4, t, e2);
+	p256_felem_sqr_n(t, e4, 4);
+	p256_felem_mul(e8, t, e4);
+	p256_felem_sqr_n(t, e8, 8);
+	p256_felem_mul(e16, t, e8);
+	p256_felem_sqr_n(t, e16, 16);
+	p256_felem_mul(e32, t, e16);
+
+	/* ffffffff 00000001 */
+	p256_felem_sqr_n(t, e32, 32);
+	p256_felem_mul(t, t, a);
+
+	/* 00000000 00000000 00000000 ffffffff */
+	p256_felem_sqr_n(t, t, 128);
+	p256_felem_mul(t, t, e32);
+
+	/* ffffffff */
+	p256_felem_sqr_n(t, t, 32);
+	p256_felem_mul(t, t, e32);
+
+	/* fffffffd */
+	p256_felem_sqr_n(t, t, 16);
+	p256_felem_mul(t, t, e16);
+	p256_felem_sqr_n(t, t, 8);
+	p256_felem_mul(t, t, e8);
+	p256_felem_sqr_n(t, t, 4);
+	p256_felem_mul(t, t, e4);
+	p256_felem_sqr_n(t, t, 2);
+	p256_felem_mul(t, t, e2);
+	p256_felem_sqr_n(t, t, 2);
+	p256_felem_mul(r, t, a);
+}
+
+static int
+p256_felem_from_bn(p256_felem r, const BIGNUM *bn)
+{
+	int i;
+
+	if (BN_is_negative(bn) || bn->top > P256_LIMBS)
+		return 0;
+
+	for (i = 0; i < P256_LIMBS; i++)
+		r[i] = i < bn->top ? bn->d[i] : 0;
+
+	/* Any value below 2^256 is less than 2p. */
+	p256_felem_reduce_once(r, 0, r);
+
+	return 1;
+}
+
+static int
+p256_felem_to_bn(BIGNUM *bn, const p256_felem a)
+{
+	if (!bn_wexpand(bn, P256_LIMBS))
+		return 0;
+
+	memcpy(bn->d, a, sizeof(p256_felem));
+	bn->top = P256_LIMBS;
+	bn->neg = 0;
+	bn_correct_top(bn);
+
+	return 1;
+}
+
+/*
+ * Point doubling in Jacobian coordinates for a = -3, see "dbl-2001-b" in the
+ * Explicit-Formulas Database. The point at infinity (Z = 0) maps to itself.
+ */
+static void
+p256_point_double(struct p256_point *r, const struct p256_point *a)
+{
+	p256_felem alpha, beta, gamma, delta, t0, t1;
+
+	p256_felem_sqr(delta, a->Z);
+	p256_felem_sqr(gamma, a->Y);
+	p256_felem_mul(beta, a->X, gamma);
+
+	/* alpha = 3 * (X1 - delta) * (X1 + delta) */
+	p256_felem_sub(t0, a->X, delta);
+	p256_felem_add(t1, a->X, delta);
+	p256_felem_mul(t0, t0, t1);
+	p256_felem_add(alpha, t0, t0);
+	p256_felem_add(alpha, alpha, t0);
+
+	/* Z3 = (Y1 + Z1)^2 - gamma - delta */
+	p256_felem_add(t0, a->Y, a->Z);
+	p256_felem_sqr(t0, t0);
+	p256_felem_sub(t0, t0, gamma);
+	p256_felem_sub(r->Z, t0, delta);
+
+	/* X3 = alpha^2 - 8 * beta */
+	p256_felem_add(beta, beta, beta);
+	p256_felem_add(beta, beta, beta);
+	p256_felem_sqr(t0, alpha);
+	p256_felem_sub(t0, t0, beta);
+	p256_felem_sub(r->X, t0, beta);
+
+	/* Y3 = alpha * (4 * beta - X3) - 8 * gamma^2 */
+	p256_felem_sub(t0, beta, r->X);
+	p256_felem_mul(t0, alpha, t0);
+	p256_felem_sqr(gamma, gamma);
+	p256_felem_add(gamma, gamma, gamma);
+	p256_felem_add(gamma, gamma, gamma);
+	p256_felem_add(gamma, gamma, gamma);
+	p256_felem_sub(r->Y, t0, gamma);
+}
+
+/*
+ * Point addition in Jacobian coordinates, see "add-2007-bl" in the
+ * Explicit-Formulas Database. Either input may be the point at infinity, which
+ * is handled in constant time. If both inputs are the same point the result is
+ * computed by doubling - this cannot happen during the scalar multiplications
+ * below with a scalar that is reduced modulo the group order, hence the branch
+ * does not leak information about the scalar.
+ */
+static void
+p256_point_add(struct p256_point *r, const struct p256_point *a,
+    const struct p256_point *b)
+{
+	struct p256_point out;
+	p256_felem z1z1, z2z2, u1, u2, s1, s2, h, rr, hh, hhh, v, t;
+	BN_ULONG a_inf, b_inf;
+
+	a_inf = p256_felem_is_zero_mask(a->Z);
+	b_inf = p256_felem_is_zero_mask(b->Z);
+
+	p256_felem_sqr(z1z1, a->Z);
+	p256_felem_sqr(z2z2, b->Z);
+	p256_felem_mul(u1, a->X, z2z2);
+	p256_felem_mul(u2, b->X, z1z1);
+	p256_felem_mul(t, b->Z, z2z2);
+	p256_felem_mul(s1, a->Y, t);
+	p256_felem_mul(t, a->Z, z1z1);
+	p256_felem_mul(s2, b->Y, t);
+
+	p256_felem_sub(h, u2, u1);
+	p256_felem_sub(rr, s2, s1);
+
+	if ((p256_felem_is_zero_mask(h) & p256_felem_is_zero_mask(rr) &
+	    ~a_inf & ~b_inf) != 0) {
+		p256_point_double(r, a);
+		return;
+	}
+
+	p256_felem_sqr(hh, h);
+	p256_felem_mul(hhh, h, hh);
+	p256_felem_mul(v, u1, hh);
+
+	/* X3 = r^2 - H^3 - 2 * V */
+	p256_felem_sqr(t, rr);
+	p256_felem_sub(t, t, hhh);
+	p256_felem_sub(t, t, v);
+	p256_felem_sub(out.X, t, v);
+
+	/* Y3 = r * (V - X3) - S1 * H^3 */
+	p256_felem_sub(t, v, out.X);
+	p256_felem_mul(t, rr, t);
+	p256_felem_mul(s1, s1, hhh);
+	p256_felem_sub(out.Y, t, s1);
+
+	/* Z3 = Z1 * Z2 * H */
+	p256_felem_mul(t, a->Z, b->Z);
+	p256_felem_mul(out.Z, t, h);
+
+	p256_felem_select(out.X, b_inf, a->X, out.X);
+	p256_felem_select(out.Y, b_inf, a->Y, out.Y);
+	p256_felem_select(out.Z, b_inf, a->Z, out.Z);
+	p256_felem_select(r->X, a_inf, b->X, out.X);
+	p256_felem_select(r->Y, a_inf, b->Y, out.Y);
+	p256_felem_select(r->Z, a_inf, b->Z, out.Z);
+}
+
+/*
+ * Mixed point addition with an affine second input (Z2 = 1), which is treated
+ * as the point at infinity if b_inf is an all ones mask. The same caveats as
+ * for p256_point_add() apply.
+ */
+static void
+p256_point_add_affine(struct p256_point *r, const struct p256_point *a,
+    const struct p256_affine *b, BN_ULONG b_inf)
+{
+	struct p256_point out;
+	p256_felem z1z1, u2, s2, h, rr, hh, hhh, v, t;
+	BN_ULONG a_inf;
+
+	a_inf = p256_felem_is_zero_mask(a->Z);
+
+	p256_felem_sqr(z1z1, a->Z);
+	p256_felem_mul(u2, b->x, z1z1);
+	p256_felem_mul(t, a->Z, z1z1);
+	p256_felem_mul(s2, b->y, t);
+
+	p256_felem_sub(h, u2, a->X);
+	p256_felem_sub(rr, s2, a->Y);
+
+	if ((p256_felem_is_zero_mask(h) & p256_felem_is_zero_mask(rr) &
+	    ~a_inf & ~b_inf) != 0) {
+		p256_point_double(r, a);
+		return;
+	}
+
+	p256_felem_sqr(hh, h);
+	p256_felem_mul(hhh, h, hh);
+	p256_felem_mul(v, a->X, hh);
+
+	/* X3 = r^2 - H^3 - 2 * V */
+	p256_felem_sqr(t, rr);
+	p256_felem_sub(t, t, hhh);
+	p256_felem_sub(t, t, v);
+	p256_felem_sub(out.X, t, v);
+
+	/* Y3 = r * (V - X3) - Y1 * H^3 */
+	p256_felem_sub(t, v, out.X);
+	p256_felem_mul(t, rr, t);
+	p256_felem_mul(hhh, a->Y, hhh);
+	p256_felem_sub(out.Y, t, hhh);
+
+	/* Z3 = Z1 * H */
+	p256_felem_mul(out.Z, a->Z, h);
+
+	/* If both inputs are the point at infinity, so is the result. */
+	a_inf &= ~b_inf;
+
+	p256_felem_select(out.X, b_inf, a->X, out.X);
+	p256_felem_select(out.Y, b_inf, a->Y, out.Y);
+	p256_felem_select(out.Z, b_inf, a->Z, out.Z);
+	p256_felem_select(r->X, a_inf, b->x, out.X);
+	p256_felem_select(r->Y, a_inf, b->y, out.Y);
+	p256_felem_select(r->Z, a_inf, p256_one, out.Z);
+}
+
+/*
+ * Constant time table lookups - every entry is read regardless of the index.
+ */
+static void
+p256_point_lookup(struct p256_point *r, const struct p256_point *table,
+    size_t table_len, size_t idx)
+{
+	BN_ULONG mask;
+	size_t i;
+	int j;
+
+	memset(r, 0, sizeof(*r));
+
+	for (i = 0; i < table_len; i++) {
+		mask = bn_ct_eq_zero_mask(i ^ idx);
+		for (j = 0; j < P256_LIMBS; j++) {
+			r->X[j] |= table[i].X[j] & mask;
+			r->Y[j] |= table[i].Y[j] & mask;
+			r->Z[j] |= table[i].Z[j] & mask;
+		}
+	}
+}
+
+static void
+p256_affine_lookup(struct p256_affine *r, const struct p256_affine *table,
+    size_t table_len, size_t idx)
+{
+	BN_ULONG mask;
+	size_t i;
+	int j;
+
+	memset(r, 0, sizeof(*r));
+
+	for (i = 0; i < table_len; i++) {
+		mask = bn_ct_eq_zero_mask(i ^ idx);
+		for (j = 0; j < P256_LIMBS; j++) {
+			r->x[j] |= table[i].x[j] & mask;
+			r->y[j] |= table[i].y[j] & mask;
+		}
+	}
+}
+
+static BN_ULONG
+p256_scalar_bit(const p256_felem k, int i)
+{
+	return (k[i / BN_BITS2] >> (i % BN_BITS2)) & 1;
+}
+
+/*
+ * Compute r = k * a using a fixed window of 4 bits, processing the scalar
+ * from the most significant window downwards.
+ */
+static void
+p256_point_mul(struct p256_point *r, const p256_felem k,
+    const struct p256_point *a)
+{
+	struct p256_point table[16], t;
+	size_t idx;
+	int i;
+
+	/* table[i] = i * a, where table[0] is the point at infinity. */
+	memset(&table[0], 0, sizeof(table[0]));
+	table[1] = *a;
+	for (i = 2; i < 16; i += 2) {
+		p256_point_double(&table[i], &table[i / 2]);
+		p256_point_add(&table[i + 1], &table[i], a);
+	}
+
+	memset(r, 0, sizeof(*r));
+
+	for (i = 256 - 4; i >= 0; i -= 4) {
+		if (i != 256 - 4) {
+			p256_point_double(r, r);
+			p256_point_double(r, r);
+			p256_point_double(r, r);
+			p256_point_double(r, r);
+		}
+		idx = (k[i / BN_BITS2] >> (i % BN_BITS2)) & 0xf;
+		p256_point_lookup(&t, table, 16, idx);
+		p256_point_add(r, r, &t);
+	}
+
+	explicit_bzero(table, sizeof(table));
+	explicit_bzero(&t, sizeof(t));
+}
+
+/*
+ * Compute r = k * G using the comb with the precomputed base tables. Each of
+ * the 32 rounds consumes the scalar bits i, i + 64, i + 128, i + 192 for the
+ * first table and the bits 32 higher for the second table.
+ */
+static void
+p256_point_mul_base(struct p256_point *r, const p256_felem k)
+{
+	struct p256_affine t;
+	size_t idx;
+	int i, j;
+
+	memset(r, 0, sizeof(*r));
+
+	for (i = 31; i >= 0; i--) {
+		if (i != 31)
+			p256_point_double(r, r);
+
+		for (j = 0; j < 2; j++) {
+			idx = p256_scalar_bit(k, i + 32 * j);
+			idx |= p256_scalar_bit(k, i + 32 * j + 64) << 1;
+			idx |= p256_scalar_bit(k, i + 32 * j + 128) << 2;
+			idx |= p256_scalar_bit(k, i + 32 * j + 192) << 3;
+			p256_affine_lookup(&t, p256_base_table[j], 16, idx);
+			p256_point_add_affine(r, r, &t,
+			    bn_ct_eq_zero_mask(idx));
+		}
+	}
+
+	explicit_bzero(&t, sizeof(t));
+}
+
+static int
+p256_point_from_ec_point(struct p256_point *r, const EC_POINT *point)
+{
+	if (!p256_felem_from_bn(r->X, &point->X))
+		return 0;
+	if (!p256_felem_from_bn(r->Y, &point->Y))
+		return 0;
+	if (!p256_felem_from_bn(r->Z, &point->Z))
+		return 0;
+
+	return 1;
+}
+
+static int
+p256_point_to_ec_point(const EC_GROUP *group, EC_POINT *point,
+    const struct p256_point *a)
+{
+	if (!p256_felem_to_bn(&point->X, a->X))
+		return 0;
+	if (!p256_felem_to_bn(&point->Y, a->Y))
+		return 0;
+	if (!p256_felem_to_bn(&point->Z, a->Z))
+		return 0;
+	point->Z_is_one = memcmp(a->Z, p256_one, sizeof(p256_felem)) == 0;
+
+	return 1;
+}
+
+/*
+ * Subtract n from (carry:t) unless this underflows, where carry is 0 or 1.
+ */
+static void
+p256_scalar_sub_n_once(p256_felem r, BN_ULONG *carry, const p256_felem t)
+{
+	p256_felem u;
+	BN_ULONG borrow, c, mask;
+
+	bn_subw(t[0], p256_n[0], &borrow, &u[0]);
+	bn_subw_subw(t[1], p256_n[1], borrow, &borrow, &u[1]);
+	bn_subw_subw(t[2], p256_n[2], borrow, &borrow, &u[2]);
+	bn_subw_subw(t[3], p256_n[3], borrow, &borrow, &u[3]);
+	bn_subw(*carry, borrow, &borrow, &c);
+
+	/* Keep (carry:t) if the subtraction of n underflowed. */
+	mask = bn_ct_ne_zero_mask(borrow);
+	p256_felem_select(r, mask, t, u);
+	*carry = (*carry & mask) | (c & ~mask);
+}
+
+static int
+p256_order_is_n(const EC_GROUP *group)
+{
+	const BIGNUM *order = &group->order;
+
+	return !BN_is_negative(order) && order->top == P256_LIMBS &&
+	    memcmp(order->d, p256_n, sizeof(p256_felem)) == 0;
+}
+
+/*
+ * Convert a scalar into its fixed size representation. Scalars of up to 257
+ * bits are reduced modulo n in constant time. This covers the k + n or k + 2n
+ * that ECDSA signing uses to hide the length of the nonce, both of which are
+ * less than 3n. Scalars that are negative or wider are reduced with
+ * BN_nnmod(); this is an unusual input for which constant time is not
+ * guaranteed.
+ */
+static int
+p256_scalar_from_bn(const EC_GROUP *group, p256_felem k, const BIGNUM *scalar,
+    BN_CTX *ctx)
+{
+	BIGNUM *tmp;
+	BN_ULONG carry;
+	int order_is_n;
+	int i;
+	int ret = 0;
+
+	BN_CTX_start(ctx);
+
+	order_is_n = p256_order_is_n(group);
+
+	if (!order_is_n || BN_is_negative(scalar) ||
+	    BN_num_bits(scalar) > 257) {
+		if ((tmp = BN_CTX_get(ctx)) == NULL)
+			goto err;
+		if (!BN_nnmod(tmp, scalar, &group->order, ctx))
+			goto err;
+		scalar = tmp;
+		if (BN_num_bits(scalar) > 256) {
+			ECerror(EC_R_INVALID_GROUP_ORDER);
+			goto err;
+		}
+	}
+
+	for (i = 0; i < P256_LIMBS; i++)
+		k[i] = i < scalar->top ? scalar->d[i] : 0;
+	carry = P256_LIMBS < scalar->top ? scalar->d[P256_LIMBS] : 0;
+
+	if (order_is_n) {
+		p256_scalar_sub_n_once(k, &carry, k);
+		p256_scalar_sub_n_once(k, &carry, k);
+	}
+
+	ret = 1;
+
+ err:
+	BN_CTX_end(ctx);
+
+	return ret;
+}
+
+static int
+ec_GFp_p256_group_set_curve(EC_GROUP *group, const BIGNUM *p, const BIGNUM *a,
+    const BIGNUM *b, BN_CTX *ctx)
+{
+	if (BN_cmp(p, BN_get0_nist_prime_256()) != 0) {
+		ECerror(EC_R_NOT_A_NIST_PRIME);
+		return 0;
+	}
+	if (!ec_GFp_mont_group_set_curve(group, p, a, b, ctx))
+		return 0;
+	if (!group->a_is_minus3) {
+		ECerror(EC_R_INVALID_CURVE);
+		return 0;
+	}
+
+	return 1;
+}
+
+static int
+ec_GFp_p256_point_get_affine_coordinates(const EC_GROUP *group,
+    const EC_POINT *point, BIGNUM *x, BIGNUM *y, BN_CTX *ctx)
+{
+	static const p256_felem p256_raw_one = { 1 };
+	struct p256_point a;
+	p256_felem z_inv, z_inv2, t;
+
+	if (EC_POINT_is_at_infinity(group, point) > 0) {
+		ECerror(EC_R_POINT_AT_INFINITY);
+		return 0;
+	}
+	if (!p256_point_from_ec_point(&a, point)) {
+		ECerror(EC_R_COORDINATES_OUT_OF_RANGE);
+		return 0;
+	}
+
+	p256_felem_inv(z_inv, a.Z);
+	p256_felem_sqr(z_inv2, z_inv);
+
+	/* Multiplying by one also converts out of the Montgomery domain. */
+	if (x != NULL) {
+		p256_felem_mul(t, a.X, z_inv2);
+		p256_felem_mul(t, t, p256_raw_one);
+		if (!p256_felem_to_bn(x, t))
+			return 0;
+	}
+	if (y != NULL) {
+		p256_felem_mul(z_inv2, z_inv2, z_inv);
+		p256_felem_mul(t, a.Y, z_inv2);
+		p256_felem_mul(t, t, p256_raw_one);
+		if (!p256_felem_to_bn(y, t))
+			return 0;
+	}
+
+	return 1;
+}
+
+static int
+ec_GFp_p256_mul_single_ct(const EC_GROUP *group, EC_POINT *r,
+    const BIGNUM *scalar, const EC_POINT *point, BN_CTX *ctx)
+{
+	struct p256_point a, out;
+	p256_felem k;
+	int ret = 0;
+
+	if (!p256_scalar_from_bn(group, k, scalar, ctx))
+		goto err;
+	if (!p256_point_from_ec_point(&a, point)) {
+		ECerror(EC_R_COORDINATES_OUT_OF_RANGE);
+		goto err;
+	}
+
+	p256_point_mul(&out, k, &a);
+
+	if (!p256_point_to_ec_point(group, r, &out))
+		goto err;
+
+	ret = 1;
+
+ err:
+	explicit_bzero(k, sizeof(k));
+	explicit_bzero(&out, sizeof(out));
+
+	return ret;
+}
+
+static int
+p256_is_generator(const EC_POINT *generator)
+{
+	struct p256_point g;
+
+	if (!p256_point_from_ec_point(&g, generator))
+		return 0;
+
+	return memcmp(g.X, p256_base_table[0][1].x, sizeof(p256_felem)) == 0 &&
+	    memcmp(g.Y, p256_base_table[0][1].y, sizeof(p256_felem)) == 0 &&
+	    memcmp(g.Z, p256_one, sizeof(p256_felem)) == 0;
+}
+
+static int
+ec_GFp_p256_mul_generator_ct(const EC_GROUP *group, EC_POINT *r,
+    const BIGNUM *scalar, BN_CTX *ctx)
+{
+	struct p256_point out;
+	p256_felem k;
+	int ret = 0;
+
+	if (group->generator == NULL) {
+		ECerror(EC_R_UNDEFINED_GENERATOR);
+		goto err;
+	}
+
+	/* The base tables are only valid for the standard generator. */
+	if (!p256_is_generator(group->generator))
+		return ec_GFp_p256_mul_single_ct(group, r, scalar,
+		    group->generator, ctx);
+
+	if (!p256_scalar_from_bn(group, k, scalar, ctx))
+		goto err;
+
+	p256_point_mul_base(&out, k);
+
+	if (!p256_point_to_ec_point(group, r, &out))
+		goto err;
+
+	ret = 1;
+
+ err:
+	explicit_bzero(k, sizeof(k));
+	explicit_bzero(&out, sizeof(out));
+
+	return ret;
+}
+
+static int
+ec_GFp_p256_mul_double_nonct(const EC_GROUP *group, EC_POINT *r,
+    const BIGNUM *g_scalar, const BIGNUM *p_scalar, const EC_POINT *point,
+    BN_CTX *ctx)
+{
+	struct p256_point a, g, out;
+	p256_felem k;
+
+	if (group->generator == NULL) {
+		ECerror(EC_R_UNDEFINED_GENERATOR);
+		return 0;
+	}
+	if (!p256_point_from_ec_point(&g, group->generator) ||
+	    !p256_point_from_ec_point(&a, point)) {
+		ECerror(EC_R_COORDINATES_OUT_OF_RANGE);
+		return 0;
+	}
+
+	if (!p256_scalar_from_bn(group, k, g_scalar, ctx))
+		return 0;
+	if (p256_is_generator(group->generator))
+		p256_point_mul_base(&g, k);
+	else
+		p256_point_mul(&g, k, &g);
+
+	if (!p256_scalar_from_bn(group, k, p_scalar, ctx))
+		return 0;
+	p256_point_mul(&a, k, &a);
+
+	p256_point_add(&out, &g, &a);
+
+	return p256_point_to_ec_point(group, r, &out);
+}
+
+static int
+ec_GFp_p256_field_mul(const EC_GROUP *group, BIGNUM *r, const BIGNUM *a,
+    const BIGNUM *b, BN_CTX *ctx)
+{
+	p256_felem fa, fb;
+
+	if (!p256_felem_from_bn(fa, a) || !p256_felem_from_bn(fb, b))
+		return ec_GFp_mont_field_mul(group, r, a, b, ctx);
+
+	p256_felem_mul(fa, fa, fb);
+
+	return p256_felem_to_bn(r, fa);
+}
+
+static int
+ec_GFp_p256_field_sqr(const EC_GROUP *group, BIGNUM *r, const BIGNUM *a,
+    BN_CTX *ctx)
+{
+	p256_felem fa;
+
+	if (!p256_felem_from_bn(fa, a))
+		return ec_GFp_mont_field_sqr(group, r, a, ctx);
+
+	p256_felem_sqr(fa, fa);
+
+	return p256_felem_to_bn(r, fa);
+}
+
+static const EC_METHOD ec_GFp_p256_method = {
+	.field_type = NID_X9_62_prime_field,
+	.group_init = ec_GFp_mont_group_init,
+	.group_finish = ec_GFp_mont_group_finish,
+	.group_copy = ec_GFp_mont_group_copy,
+	.group_set_curve = ec_GFp_p256_group_set_curve,
+	.group_get_curve = ec_GFp_simple_group_get_curve,
+	.group_get_degree = ec_GFp_simple_group_get_degree,
+	.group_order_bits = ec_group_simple_order_bits,
+	.group_check_discriminant = ec_GFp_simple_group_check_discriminant,
+	.point_init = ec_GFp_simple_point_init,
+	.point_finish = ec_GFp_simple_point_finish,
+	.point_copy = ec_GFp_simple_point_copy,
+	.point_set_to_infinity = ec_GFp_simple_point_set_to_infinity,
+	.point_set_Jprojective_coordinates =
+	    ec_GFp_simple_set_Jprojective_coordinates,
+	.point_get_Jprojective_coordinates =
+	    ec_GFp_simple_get_Jprojective_coordinates,
+	.point_set_affine_coordinates =
+	    ec_GFp_simple_point_set_affine_coordinates,
+	.point_get_affine_coordinates =
+	    ec_GFp_p256_point_get_affine_coordinates,
+	.point_set_compressed_coordinates =
+	    ec_GFp_simple_set_compressed_coordinates,
+	.point2oct = ec_GFp_simple_point2oct,
+	.oct2point = ec_GFp_simple_oct2point,
+	.add = ec_GFp_simple_add,
+	.dbl = ec_GFp_simple_dbl,
+	.invert = ec_GFp_simple_invert,
+	.is_at_infinity = ec_GFp_simple_is_at_infinity,
+	.is_on_curve = ec_GFp_simple_is_on_curve,
+	.point_cmp = ec_GFp_simple_cmp,
+	.make_affine = ec_GFp_simple_make_affine,
+	.points_make_affine = ec_GFp_simple_points_make_affine,
+	.mul_generator_ct = ec_GFp_p256_mul_generator_ct,
+	.mul_single_ct = ec_GFp_p256_mul_single_ct,
+	.mul_double_nonct = ec_GFp_p256_mul_double_nonct,
+	.field_mul = ec_GFp_p256_field_mul,
+	.field_sqr = ec_GFp_p256_field_sqr,
+	.field_encode = ec_GFp_mont_field_encode,
+	.field_decode = ec_GFp_mont_field_decode,
+	.field_set_to_one = ec_GFp_mont_field_set_to_one,
+	.blind_coordinates = ec_GFp_simple_blind_coordinates,
+};
+
+const EC_METHOD *
+EC_GFp_p256_method(void)
+{
+	return &ec_GFp_p256_method;
+}
+
+#endif /* HAVE_EC_GFP_P256_METHOD */
@@ -0,0 +1,148 @@
+#!/usr/bin/perl
+#	$OpenBSD$
+#
+# Copyright (c) 2026 agent <agent@local>
+#
+# Permission to use, copy, modify, and distribute this software for any
+# purpose with or without fee is hereby granted, provided that the above
+# copyright notice and this permission notice appear in all copies.
+#
+# THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+# WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+# ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+# WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+# ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+# OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+#
+# Generate p256_base_table for ecp_p256.c from the curve parameters.
+# p256_base_table[0][idx] is the sum of b_i * 2^(64 * i) * G for the bits
+# b0..b3 of idx and p256_base_table[1][idx] is 2^32 times that point, both
+# in affine coordinates and in the Montgomery domain with R = 2^256.
+#
+# Usage: perl ecp_p256_table.pl > table.c
+#
+
+use strict;
+use warnings;
+
+use Math::BigInt try => 'GMP';
+
+my $p = Math::BigInt->from_hex("ffffffff00000001000000000000000000000000" .
+    "ffffffffffffffffffffffff");
+my $b = Math::BigInt->from_hex("5ac635d8aa3a93e7b3ebbd55769886bc651d06b0" .
+    "cc53b0f63bce3c3e27d2604b");
+my $gx = Math::BigInt->from_hex("6b17d1f2e12c4247f8bce6e563a440f277037d81" .
+    "2deb33a0f4a13945d898c296");
+my $gy = Math::BigInt->from_hex("4fe342e2fe1a7f9b8ee7eb4a7c0f9e162bce3357" .
+    "6b315ececbb6406837bf51f5");
+
+sub modp {
+	my ($x) = @_;
+
+	return $x->bmod($p);
+}
+
+sub on_curve {
+	my ($pt) = @_;
+	my ($x, $y) = @$pt;
+
+	# y^2 = x^3 - 3x + b
+	my $lhs = modp($y->copy->bmul($y));
+	my $rhs = modp($x->copy->bmul($x)->bmul($x)->bsub($x->copy->bmul(3))
+	    ->badd($b));
+
+	return $lhs->bcmp($rhs) == 0;
+}
+
+# Affine point addition and doubling, undef denotes the point at infinity.
+sub point_add {
+	my ($s, $t) = @_;
+	my ($l, $x, $y);
+
+	return $t if !defined($s);
+	return $s if !defined($t);
+
+	my ($x1, $y1) = @$s;
+	my ($x2, $y2) = @$t;
+
+	if ($x1->bcmp($x2) == 0) {
+		return undef if modp($y1->copy->badd($y2))->is_zero;
+
+		# l = (3x^2 - 3) / 2y
+		$l = modp($x1->copy->bmul($x1)->bmul(3)->bsub(3));
+		$l = modp($l->bmul($y1->copy->bmul(2)->bmodinv($p)));
+	} else {
+		# l = (y2 - y1) / (x2 - x1)
+		$l = modp($y2->copy->bsub($y1));
+		$l = modp($l->bmul(modp($x2->copy->bsub($x1))->bmodinv($p)));
+	}
+
+	$x = modp($l->copy->bmul($l)->bsub($x1)->bsub($x2));
+	$y = modp($x1->copy->bsub($x)->bmul($l)->bsub($y1));
+
+	return [ $x, $y ];
+}
+
+sub point_double_n {
+	my ($s, $n) = @_;
+
+	$s = point_add($s, $s) while ($n-- > 0);
+
+	return $s;
+}
+
+sub print_felem {
+	my ($name, $v) = @_;
+	my $m = modp($v->copy->blsft(256));
+	my $mask = Math::BigInt->new(2)->bpow(64)->bsub(1);
+	my @w;
+
+	for (1 .. 4) {
+		push @w, sprintf("0x%016s",
+		    substr($m->copy->band($mask)->as_hex, 2));
+		$m->brsft(64);
+	}
+
+	print "\t\t\t.$name = {\n";
+	print "\t\t\t\t$w[0], $w[1],\n";
+	print "\t\t\t\t$w[2], $w[3],\n";
+	print "\t\t\t},\n";
+}
+
+my $g = [ $gx, $gy ];
+die "generator is not on the curve" if !on_curve($g);
+
+my @base = ($g);
+push @base, point_double_n($base[-1], 64) for (1 .. 3);
+
+print "static const struct p256_affine p256_base_table[2][16] = {\n";
+
+for my $j (0 .. 1) {
+	print "\t{\n";
+
+	for my $idx (0 .. 15) {
+		my $pt;
+
+		for my $i (0 .. 3) {
+			$pt = point_add($pt, $base[$i]) if ($idx >> $i) & 1;
+		}
+		$pt = point_double_n($pt, 32 * $j) if defined($pt);
+
+		print "\t\t{\n";
+		if (!defined($pt)) {
+			print "\t\t\t.x = { 0 },\n";
+			print "\t\t\t.y = { 0 },\n";
+		} else {
+			die "point is not on the curve" if !on_curve($pt);
+			print_felem("x", $pt->[0]);
+			print_felem("y", $pt->[1]);
+		}
+		print "\t\t},\n";
+	}
+
+	print "\t},\n";
+}
+
+print "};\n";
@@ -60,6 +60,7 @@
 #include <openssl/err.h>
 #include <openssl/evp.h>
 
+#include "cryptlib.h"
 #include "evp_local.h"
 #include "modes_local.h"
 
@@ -198,6 +199,59 @@ void aesni_ccm64_decrypt_blocks (const unsigned char *in, unsigned char *out,
     size_t blocks, const void *key, const unsigned char ivec[16],
     unsigned char cmac[16]);
 
+#if defined(__x86_64) || defined(__x86_64__)
+#define	AESNI_VAES_CAPABLE	(OPENSSL_cpu_caps() & CPUCAP_MASK_VAES512)
+
+void aesni_vaes_ctr32_encrypt_blocks(const unsigned char *in,
+    unsigned char *out, size_t blocks, const void *key,
+    const unsigned char *ivec);
+
+/*
+ * Encrypt blocks in multiples of 16 with VAES, leaving any remainder to
+ * the AES-NI implementation. Neither updates ivec, hence the counter is
+ * advanced locally for the remaining blocks.
+ */
+static void
+aesni_vaes_ctr32_encrypt(const unsigned char *in, unsigned char *out,
+    size_t blocks, const void *key, const unsigned char *ivec)
+{
+	unsigned char iv[16];
+	size_t bulk;
+	uint32_t ctr;
+
+	if ((bulk = blocks & ~(size_t)15) == 0) {
+		aesni_ctr32_encrypt_blocks(in, out, blocks, key, ivec);
+		return;
+	}
+
+	aesni_vaes_ctr32_encrypt_blocks(in, out, bulk, key, ivec);
+	if ((blocks -= bulk) == 0)
+		return;
+
+	memcpy(iv, ivec, sizeof(iv));
+	ctr = (uint32_t)iv[12] << 24 | (uint32_t)iv[13] << 16 |
+	    (uint32_t)iv[14] << 8 | iv[15];
+	ctr += (uint32_t)bulk;
+	iv[12] = ctr >> 24;
+	iv[13] = ctr >> 16;
+	iv[14] = ctr >> 8;
+	iv[15] = ctr;
+
+	aesni_ctr32_encrypt_blocks(in + bulk * 16, out + bulk * 16, blocks,
+	    key, iv);
+}
+#endif
+
+static ctr128_f
+aesni_ctr32_func(void)
+{
+#ifdef AESNI_VAES_CAPABLE
+	if (AESNI_VAES_CAPABLE)
+		return (ctr128_f)aesni_vaes_ctr32_encrypt;
+#endif
+	return (ctr128_f)aesni_ctr32_encrypt_blocks;
+}
+
 static int
 aesni_init_key(EVP_CIPHER_CTX *ctx, const unsigned char *key,
     const unsigned char *iv, int enc)
@@ -220,7 +274,7 @@ aesni_init_key(EVP_CIPHER_CTX *ctx, const unsigned char *key,
 		if (mode == EVP_CIPH_CBC_MODE)
 			dat->stream.cbc = (cbc128_f)aesni_cbc_encrypt;
 		else if (mode == EVP_CIPH_CTR_MODE)
-			dat->stream.ctr = (ctr128_f)aesni_ctr32_encrypt_blocks;
+			dat->stream.ctr = aesni_ctr32_func();
 		else
 			dat->stream.cbc = NULL;
 	}
@@ -269,7 +323,7 @@ aesni_gcm_init_key(EVP_CIPHER_CTX *ctx, const unsigned char *key,
 		aesni_set_encrypt_key(key, ctx->key_len * 8, &gctx->ks);
 		CRYPTO_gcm128_init(&gctx->gcm, &gctx->ks,
 		    (block128_f)aesni_encrypt);
-		gctx->ctr = (ctr128_f)aesni_ctr32_encrypt_blocks;
+		gctx->ctr = aesni_ctr32_func();
 		/* If we have an iv can set it directly, otherwise use
 		 * saved IV.
 		 */
@@ -426,6 +480,35 @@ aes_init_key(EVP_CIPHER_CTX *ctx, const unsigned char *key,
 	return 1;
 }
 
+/*
+ * Report the implementation that the cipher selection and key setup above
+ * use for AES-CTR, given the current CPU capabilities.
+ */
+const char *
+aes_cpu_impl(void)
+{
+#ifdef AESNI_CAPABLE
+	if (AESNI_CAPABLE) {
+		if (aesni_ctr32_func() != (ctr128_f)aesni_ctr32_encrypt_blocks)
+			return "aesni-vaes";
+		return "aesni";
+	}
+#endif
+#ifdef BSAES_CAPABLE
+	if (BSAES_CAPABLE)
+		return "bsaes";
+#endif
+#ifdef VPAES_CAPABLE
+	if (VPAES_CAPABLE)
+		return "vpaes";
+#endif
+#ifdef AES_ASM
+	return "asm";
+#else
+	return "c";
+#endif
+}
+
 static int
 aes_cbc_cipher(EVP_CIPHER_CTX *ctx, unsigned char *out,
     const unsigned char *in, size_t len)
@@ -2266,7 +2349,7 @@ aead_aes_gcm_init(EVP_AEAD_CTX *ctx, const unsigned char *key, size_t key_len,
 		aesni_set_encrypt_key(key, key_bits, &gcm_ctx->ks.ks);
 		CRYPTO_gcm128_init(&gcm_ctx->gcm, &gcm_ctx->ks.ks,
 		    (block128_f)aesni_encrypt);
-		gcm_ctx->ctr = (ctr128_f) aesni_ctr32_encrypt_blocks;
+		gcm_ctx->ctr = aesni_ctr32_func();
 	} else
 #endif
 	{
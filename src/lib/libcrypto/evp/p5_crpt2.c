@@ -67,6 +67,7 @@
 #include <openssl/err.h>
 #include <openssl/evp.h>
 #include <openssl/hmac.h>
+#include <openssl/sha.h>
 #include <openssl/x509.h>
 
 #include "evp_local.h"
@@ -78,6 +79,212 @@
  * <pgut001@cs.auckland.ac.nz> to the PKCS-TNG <pkcs-tng@rsa.com> mailing list.
  */
 
+/*
+ * HMAC state for the SHA family of digests. The hash states after absorbing
+ * the inner and outer pads are computed once per derivation and are then
+ * copied for each iteration, which avoids the EVP_MD_CTX copies (and their
+ * allocations) that HMAC_CTX_copy() performs.
+ */
+union pbkdf2_sha_ctx {
+	SHA_CTX sha1;
+	SHA256_CTX sha256;
+	SHA512_CTX sha512;
+};
+
+struct pbkdf2_hmac_sha {
+	int nid;
+	size_t block_size;
+	size_t md_size;
+	union pbkdf2_sha_ctx inner;
+	union pbkdf2_sha_ctx outer;
+};
+
+static int
+pbkdf2_sha_init(int nid, union pbkdf2_sha_ctx *ctx)
+{
+	switch (nid) {
+	case NID_sha1:
+		return SHA1_Init(&ctx->sha1);
+	case NID_sha224:
+		return SHA224_Init(&ctx->sha256);
+	case NID_sha256:
+		return SHA256_Init(&ctx->sha256);
+	case NID_sha384:
+		return SHA384_Init(&ctx->sha512);
+	case NID_sha512:
+		return SHA512_Init(&ctx->sha512);
+	}
+	return 0;
+}
+
+static int
+pbkdf2_sha_update(int nid, union pbkdf2_sha_ctx *ctx, const void *data,
+    size_t len)
+{
+	switch (nid) {
+	case NID_sha1:
+		return SHA1_Update(&ctx->sha1, data, len);
+	case NID_sha224:
+		return SHA224_Update(&ctx->sha256, data, len);
+	case NID_sha256:
+		return SHA256_Update(&ctx->sha256, data, len);
+	case NID_sha384:
+		return SHA384_Update(&ctx->sha512, data, len);
+	case NID_sha512:
+		return SHA512_Update(&ctx->sha512, data, len);
+	}
+	return 0;
+}
+
+static int
+pbkdf2_sha_final(int nid, union pbkdf2_sha_ctx *ctx, unsigned char *md)
+{
+	switch (nid) {
+	case NID_sha1:
+		return SHA1_Final(md, &ctx->sha1);
+	case NID_sha224:
+		return SHA224_Final(md, &ctx->sha256);
+	case NID_sha256:
+		return SHA256_Final(md, &ctx->sha256);
+	case NID_sha384:
+		return SHA384_Final(md, &ctx->sha512);
+	case NID_sha512:
+		return SHA512_Final(md, &ctx->sha512);
+	}
+	return 0;
+}
+
+static int
+pbkdf2_hmac_sha_init(struct pbkdf2_hmac_sha *hs, const EVP_MD *digest,
+    const char *pass, size_t passlen)
+{
+	unsigned char key[SHA512_CBLOCK], pad[SHA512_CBLOCK];
+	union pbkdf2_sha_ctx ctx;
+	size_t i;
+	int ret = 0;
+
+	memset(hs, 0, sizeof(*hs));
+	memset(key, 0, sizeof(key));
+
+	hs->nid = EVP_MD_type(digest);
+	switch (hs->nid) {
+	case NID_sha1:
+	case NID_sha224:
+	case NID_sha256:
+		hs->block_size = SHA256_CBLOCK;
+		break;
+	case NID_sha384:
+	case NID_sha512:
+		hs->block_size = SHA512_CBLOCK;
+		break;
+	default:
+		return 0;
+	}
+	hs->md_size = EVP_MD_size(digest);
+
+	if (passlen > hs->block_size) {
+		if (!pbkdf2_sha_init(hs->nid, &ctx))
+			goto err;
+		if (!pbkdf2_sha_update(hs->nid, &ctx, pass, passlen))
+			goto err;
+		if (!pbkdf2_sha_final(hs->nid, &ctx, key))
+			goto err;
+	} else if (passlen > 0)
+		memcpy(key, pass, passlen);
+
+	for (i = 0; i < hs->block_size; i++)
+		pad[i] = key[i] ^ 0x36;
+	if (!pbkdf2_sha_init(hs->nid, &hs->inner))
+		goto err;
+	if (!pbkdf2_sha_update(hs->nid, &hs->inner, pad, hs->block_size))
+		goto err;
+
+	for (i = 0; i < hs->block_size; i++)
+		pad[i] = key[i] ^ 0x5c;
+	if (!pbkdf2_sha_init(hs->nid, &hs->outer))
+		goto err;
+	if (!pbkdf2_sha_update(hs->nid, &hs->outer, pad, hs->block_size))
+		goto err;
+
+	ret = 1;
+
+ err:
+	explicit_bzero(key, sizeof(key));
+	explicit_bzero(pad, sizeof(pad));
+	explicit_bzero(&ctx, sizeof(ctx));
+
+	return ret;
+}
+
+/*
+ * Complete an HMAC whose inner hash has absorbed the message in ctx.
+ */
+static int
+pbkdf2_hmac_sha_final(const struct pbkdf2_hmac_sha *hs,
+    union pbkdf2_sha_ctx *ctx, unsigned char *md)
+{
+	if (!pbkdf2_sha_final(hs->nid, ctx, md))
+		return 0;
+	*ctx = hs->outer;
+	if (!pbkdf2_sha_update(hs->nid, ctx, md, hs->md_size))
+		return 0;
+	return pbkdf2_sha_final(hs->nid, ctx, md);
+}
+
+static int
+pbkdf2_hmac_sha(const struct pbkdf2_hmac_sha *hs, const unsigned char *salt,
+    int saltlen, int iter, int keylen, unsigned char *out)
+{
+	unsigned char digtmp[SHA512_DIGEST_LENGTH], itmp[4];
+	union pbkdf2_sha_ctx ctx;
+	unsigned long i = 1;
+	int cplen, j, k;
+	int ret = 0;
+
+	while (keylen > 0) {
+		cplen = keylen;
+		if (cplen > (int)hs->md_size)
+			cplen = hs->md_size;
+
+		itmp[0] = (unsigned char)((i >> 24) & 0xff);
+		itmp[1] = (unsigned char)((i >> 16) & 0xff);
+		itmp[2] = (unsigned char)((i >> 8) & 0xff);
+		itmp[3] = (unsigned char)(i & 0xff);
+
+		ctx = hs->inner;
+		if (!pbkdf2_sha_update(hs->nid, &ctx, salt, saltlen))
+			goto err;
+		if (!pbkdf2_sha_update(hs->nid, &ctx, itmp, 4))
+			goto err;
+		if (!pbkdf2_hmac_sha_final(hs, &ctx, digtmp))
+			goto err;
+		memcpy(out, digtmp, cplen);
+
+		for (j = 1; j < iter; j++) {
+			ctx = hs->inner;
+			if (!pbkdf2_sha_update(hs->nid, &ctx, digtmp,
+			    hs->md_size))
+				goto err;
+			if (!pbkdf2_hmac_sha_final(hs, &ctx, digtmp))
+				goto err;
+			for (k = 0; k < cplen; k++)
+				out[k] ^= digtmp[k];
+		}
+
+		keylen -= cplen;
+		out += cplen;
+		i++;
+	}
+
+	ret = 1;
+
+ err:
+	explicit_bzero(digtmp, sizeof(digtmp));
+	explicit_bzero(&ctx, sizeof(ctx));
+
+	return ret;
+}
+
 int
 PKCS5_PBKDF2_HMAC(const char *pass, int passlen, const unsigned char *salt,
     int saltlen, int iter, const EVP_MD *digest, int keylen, unsigned char *out)
@@ -86,18 +293,27 @@ PKCS5_PBKDF2_HMAC(const char *pass, int passlen, const unsigned char *salt,
 	int cplen, j, k, tkeylen, mdlen;
 	unsigned long i = 1;
 	HMAC_CTX hctx_tpl, hctx;
+	struct pbkdf2_hmac_sha hs;
+	int ret;
 
 	mdlen = EVP_MD_size(digest);
 	if (mdlen < 0)
 		return 0;
 
-	HMAC_CTX_init(&hctx_tpl);
 	p = out;
 	tkeylen = keylen;
 	if (!pass)
 		passlen = 0;
 	else if (passlen == -1)
 		passlen = strlen(pass);
+
+	if (passlen >= 0 && pbkdf2_hmac_sha_init(&hs, digest, pass, passlen)) {
+		ret = pbkdf2_hmac_sha(&hs, salt, saltlen, iter, keylen, out);
+		explicit_bzero(&hs, sizeof(hs));
+		return ret;
+	}
+
+	HMAC_CTX_init(&hctx_tpl);
 	if (!HMAC_Init_ex(&hctx_tpl, pass, passlen, digest, NULL)) {
 		HMAC_CTX_cleanup(&hctx_tpl);
 		return 0;
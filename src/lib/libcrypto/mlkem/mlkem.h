@@ -0,0 +1,132 @@
+/*	$OpenBSD$ */
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef HEADER_MLKEM_H
+#define HEADER_MLKEM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <openssl/opensslconf.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/*
+ * ML-KEM-768.
+ *
+ * ML-KEM is the module-lattice-based key-encapsulation mechanism specified
+ * in FIPS 203. ML-KEM-768 is the parameter set that targets NIST security
+ * category 3.
+ */
+
+#define MLKEM768_PUBLIC_KEY_BYTES	1184
+#define MLKEM768_CIPHERTEXT_BYTES	1088
+#define MLKEM_SHARED_SECRET_BYTES	32
+#define MLKEM_SEED_BYTES		64
+
+/*
+ * MLKEM768_public_key contains an ML-KEM-768 public key. Its contents are
+ * opaque, the structure is only defined so that it may be stack allocated.
+ */
+struct MLKEM768_public_key {
+	union {
+		uint8_t bytes[512 * (3 + 9) + 32 + 32];
+		uint16_t alignment;
+	} opaque;
+};
+
+/*
+ * MLKEM768_private_key contains an ML-KEM-768 private key, along with the
+ * corresponding public key. Its contents are opaque.
+ */
+struct MLKEM768_private_key {
+	union {
+		uint8_t bytes[512 * (3 + 3 + 9) + 32 + 32 + 32];
+		uint16_t alignment;
+	} opaque;
+};
+
+/*
+ * MLKEM768_generate_key generates a random key pair, writing the encoded
+ * public key to |out_encoded_public_key| and the private key to
+ * |out_private_key|. If |optional_out_seed| is not NULL, the seed from which
+ * the key pair was derived is written to it.
+ */
+void MLKEM768_generate_key(
+    uint8_t out_encoded_public_key[MLKEM768_PUBLIC_KEY_BYTES],
+    uint8_t optional_out_seed[MLKEM_SEED_BYTES],
+    struct MLKEM768_private_key *out_private_key);
+
+/*
+ * MLKEM768_private_key_from_seed derives a private key from a seed that was
+ * previously output by MLKEM768_generate_key. It returns one on success or
+ * zero if |seed_len| is not MLKEM_SEED_BYTES.
+ */
+int MLKEM768_private_key_from_seed(struct MLKEM768_private_key *out_private_key,
+    const uint8_t *seed, size_t seed_len);
+
+/*
+ * MLKEM768_public_from_private sets |out_public_key| to the public key that
+ * corresponds to |private_key|.
+ */
+void MLKEM768_public_from_private(struct MLKEM768_public_key *out_public_key,
+    const struct MLKEM768_private_key *private_key);
+
+/*
+ * MLKEM768_parse_public_key parses the |in_len| byte encoded public key at
+ * |in| into |out_public_key|. It returns one on success or zero if the
+ * encoding is not a valid ML-KEM-768 public key.
+ */
+int MLKEM768_parse_public_key(struct MLKEM768_public_key *out_public_key,
+    const uint8_t *in, size_t in_len);
+
+/*
+ * MLKEM768_marshal_public_key writes the encoding of |public_key| to
+ * |out_encoded_public_key|.
+ */
+void MLKEM768_marshal_public_key(
+    uint8_t out_encoded_public_key[MLKEM768_PUBLIC_KEY_BYTES],
+    const struct MLKEM768_public_key *public_key);
+
+/*
+ * MLKEM768_encap encapsulates a random shared secret to |public_key|,
+ * writing the ciphertext to |out_ciphertext| and the shared secret to
+ * |out_shared_secret|.
+ */
+void MLKEM768_encap(uint8_t out_ciphertext[MLKEM768_CIPHERTEXT_BYTES],
+    uint8_t out_shared_secret[MLKEM_SHARED_SECRET_BYTES],
+    const struct MLKEM768_public_key *public_key);
+
+/*
+ * MLKEM768_decap decapsulates the shared secret from the |ciphertext_len|
+ * byte ciphertext at |ciphertext| using |private_key|, writing it to
+ * |out_shared_secret|. It returns zero if |ciphertext_len| is incorrect, in
+ * which case |out_shared_secret| is filled with random bytes. An invalid
+ * ciphertext of the correct length results in an unpredictable shared
+ * secret, rather than an error.
+ */
+int MLKEM768_decap(uint8_t out_shared_secret[MLKEM_SHARED_SECRET_BYTES],
+    const uint8_t *ciphertext, size_t ciphertext_len,
+    const struct MLKEM768_private_key *private_key);
+
+#if defined(__cplusplus)
+}  /* extern C */
+#endif
+
+#endif  /* HEADER_MLKEM_H */
@@ -0,0 +1,845 @@
+/*	$OpenBSD$ */
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * ML-KEM-768, as specified in FIPS 203.
+ *
+ * Polynomial coefficients are held as signed 16 bit integers and products
+ * are reduced using Montgomery reduction, as in the Kyber reference
+ * implementation. Each layer of the number theoretic transform applies the
+ * same twiddle factor to a contiguous run of coefficients and is free of
+ * data dependent branches, which allows the compiler to vectorise all but
+ * the last layers.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <openssl/mlkem.h>
+
+#include "constant_time.h"
+#include "mlkem_internal.h"
+#include "sha3_internal.h"
+
+#define CTASSERT(x)	extern char  _ctassert[(x) ? 1 : -1 ] \
+			    __attribute__((__unused__))
+
+#define DEGREE		256
+#define RANK		3
+
+#define MLKEM_Q		3329
+#define MLKEM_QINV	-3327	/* q^-1 mod 2^16 */
+#define MLKEM_MONT_SQ	1353	/* 2^32 mod q */
+#define MLKEM_INV_NTT_F	1441	/* 2^32 / 128 mod q */
+
+#define ETA1		2
+#define ETA2		2
+#define DU		10
+#define DV		4
+
+#define POLY_BYTES		(12 * DEGREE / 8)
+#define CBD_BYTES		(ETA1 * DEGREE / 4)
+#define COMPRESSED_U_BYTES	(DU * DEGREE / 8)
+#define COMPRESSED_V_BYTES	(DV * DEGREE / 8)
+
+#define SEED_BYTES		32
+
+typedef struct {
+	int16_t c[DEGREE];
+} poly;
+
+struct public_key {
+	poly t[RANK];
+	uint8_t rho[SEED_BYTES];
+	uint8_t public_key_hash[32];
+	poly m[RANK][RANK];
+};
+
+struct private_key {
+	struct public_key pub;
+	poly s[RANK];
+	uint8_t fo_failure_secret[32];
+};
+
+CTASSERT(sizeof(struct public_key) <= sizeof(struct MLKEM768_public_key));
+CTASSERT(sizeof(struct private_key) <= sizeof(struct MLKEM768_private_key));
+CTASSERT(RANK * POLY_BYTES + SEED_BYTES == MLKEM768_PUBLIC_KEY_BYTES);
+CTASSERT(RANK * COMPRESSED_U_BYTES + COMPRESSED_V_BYTES ==
+    MLKEM768_CIPHERTEXT_BYTES);
+
+static struct public_key *
+public_key_from_external(const struct MLKEM768_public_key *external)
+{
+	return (struct public_key *)external;
+}
+
+static struct private_key *
+private_key_from_external(const struct MLKEM768_private_key *external)
+{
+	return (struct private_key *)external;
+}
+
+/*
+ * Powers of the primitive 256th root of unity 17, in bit reversed order and
+ * in the Montgomery domain.
+ */
+static const int16_t zetas[128] = {
+	-1044,  -758,  -359, -1517,  1493,  1422,   287,   202,
+	 -171,   622,  1577,   182,   962, -1202, -1474,  1468,
+	  573, -1325,   264,   383,  -829,  1458, -1602,  -130,
+	 -681,  1017,   732,   608, -1542,   411,  -205, -1571,
+	 1223,   652,  -552,  1015, -1293,  1491,  -282, -1544,
+	  516,    -8,  -320,  -666, -1618, -1162,   126,  1469,
+	 -853,   -90,  -271,   830,   107, -1421,  -247,  -951,
+	 -398,   961, -1508,  -725,   448, -1065,   677, -1275,
+	-1103,   430,   555,   843, -1251,   871,  1550,   105,
+	  422,   587,   177,  -235,  -291,  -460,  1574,  1653,
+	 -246,   778,  1159,  -147,  -777,  1483,  -602,  1119,
+	-1590,   644,  -872,   349,   418,   329,  -156,   -75,
+	  817,  1097,   603,   610,  1322, -1285, -1465,   384,
+	-1215,  -136,  1218, -1335,  -874,   220, -1187, -1659,
+	-1185, -1530, -1278,   794, -1510,  -854,  -870,   478,
+	 -108,  -308,   996,   991,   958, -1460,  1522,  1628,
+};
+
+/*
+ * The values 17^(2 * BitRev7(i) + 1) used when multiplying in the NTT
+ * domain, in the Montgomery domain.
+ */
+static const int16_t gammas[128] = {
+	-1103,  1103,   430,  -430,   555,  -555,   843,  -843,
+	-1251,  1251,   871,  -871,  1550, -1550,   105,  -105,
+	  422,  -422,   587,  -587,   177,  -177,  -235,   235,
+	 -291,   291,  -460,   460,  1574, -1574,  1653, -1653,
+	 -246,   246,   778,  -778,  1159, -1159,  -147,   147,
+	 -777,   777,  1483, -1483,  -602,   602,  1119, -1119,
+	-1590,  1590,   644,  -644,  -872,   872,   349,  -349,
+	  418,  -418,   329,  -329,  -156,   156,   -75,    75,
+	  817,  -817,  1097, -1097,   603,  -603,   610,  -610,
+	 1322, -1322, -1285,  1285, -1465,  1465,   384,  -384,
+	-1215,  1215,  -136,   136,  1218, -1218, -1335,  1335,
+	 -874,   874,   220,  -220, -1187,  1187, -1659,  1659,
+	-1185,  1185, -1530,  1530, -1278,  1278,   794,  -794,
+	-1510,  1510,  -854,   854,  -870,   870,   478,  -478,
+	 -108,   108,  -308,   308,   996,  -996,   991,  -991,
+	  958,  -958, -1460,  1460,  1522, -1522,  1628, -1628,
+};
+
+/* Returns a * 2^-16 mod q, in the range (-q, q), for |a| < q * 2^15. */
+static inline int16_t
+montgomery_reduce(int32_t a)
+{
+	int16_t t;
+
+	t = (int16_t)a * MLKEM_QINV;
+
+	return (a - (int32_t)t * MLKEM_Q) >> 16;
+}
+
+/* Returns a mod q, in the range [-(q - 1) / 2, (q - 1) / 2]. */
+static inline int16_t
+barrett_reduce(int16_t a)
+{
+	const int16_t v = ((1 << 26) + MLKEM_Q / 2) / MLKEM_Q;
+	int16_t t;
+
+	t = ((int32_t)v * a + (1 << 25)) >> 26;
+
+	return a - t * MLKEM_Q;
+}
+
+static inline int16_t
+fqmul(int16_t a, int16_t b)
+{
+	return montgomery_reduce((int32_t)a * b);
+}
+
+/* Maps a value in the range (-q, q) to [0, q). */
+static inline uint16_t
+to_canonical(int16_t a)
+{
+	a += (a >> 15) & MLKEM_Q;
+
+	return a;
+}
+
+/* Returns t / q, which is exact for t <= q * 2^12. */
+static inline uint32_t
+div_q(uint32_t t)
+{
+	return ((uint64_t)t * 2580335) >> 33;
+}
+
+/* Compress_d from FIPS 203 section 4.2.1, for x in the range [0, q). */
+static inline uint16_t
+compress(uint16_t x, int bits)
+{
+	return div_q(((uint32_t)x << bits) + MLKEM_Q / 2) & ((1 << bits) - 1);
+}
+
+/* Decompress_d from FIPS 203 section 4.2.1. */
+static inline int16_t
+decompress(uint16_t y, int bits)
+{
+	return ((uint32_t)y * MLKEM_Q + (1 << (bits - 1))) >> bits;
+}
+
+static void
+poly_reduce(poly *p)
+{
+	size_t i;
+
+	for (i = 0; i < DEGREE; i++)
+		p->c[i] = barrett_reduce(p->c[i]);
+}
+
+static void
+poly_add(poly *r, const poly *a)
+{
+	size_t i;
+
+	for (i = 0; i < DEGREE; i++)
+		r->c[i] += a->c[i];
+}
+
+static void
+poly_sub(poly *r, const poly *a, const poly *b)
+{
+	size_t i;
+
+	for (i = 0; i < DEGREE; i++)
+		r->c[i] = a->c[i] - b->c[i];
+}
+
+static void
+poly_tomont(poly *p)
+{
+	size_t i;
+
+	for (i = 0; i < DEGREE; i++)
+		p->c[i] = fqmul(p->c[i], MLKEM_MONT_SQ);
+}
+
+static inline void
+ntt_butterflies(int16_t *lo, int16_t *hi, size_t len, int16_t zeta)
+{
+	int16_t t;
+	size_t j;
+
+	for (j = 0; j < len; j++) {
+		t = fqmul(zeta, hi[j]);
+		hi[j] = lo[j] - t;
+		lo[j] = lo[j] + t;
+	}
+}
+
+static inline void
+inv_ntt_butterflies(int16_t *lo, int16_t *hi, size_t len, int16_t zeta)
+{
+	int16_t t;
+	size_t j;
+
+	for (j = 0; j < len; j++) {
+		t = lo[j];
+		lo[j] = barrett_reduce(t + hi[j]);
+		hi[j] = fqmul(zeta, hi[j] - t);
+	}
+}
+
+/*
+ * NTT from FIPS 203 algorithm 9. The input coefficients must be less than q
+ * in absolute value, the output is reduced.
+ */
+static void
+poly_ntt(poly *p)
+{
+	size_t len, start, k = 1;
+
+	for (len = DEGREE / 2; len >= 2; len >>= 1) {
+		for (start = 0; start < DEGREE; start += 2 * len)
+			ntt_butterflies(&p->c[start], &p->c[start + len], len,
+			    zetas[k++]);
+	}
+
+	poly_reduce(p);
+}
+
+/*
+ * Inverse NTT from FIPS 203 algorithm 10, which also multiplies by the
+ * Montgomery factor so as to cancel out that of a preceding multiplication.
+ */
+static void
+poly_inv_ntt_tomont(poly *p)
+{
+	size_t len, start, i, k = 127;
+
+	for (len = 2; len <= DEGREE / 2; len <<= 1) {
+		for (start = 0; start < DEGREE; start += 2 * len)
+			inv_ntt_butterflies(&p->c[start], &p->c[start + len],
+			    len, zetas[k--]);
+	}
+
+	for (i = 0; i < DEGREE; i++)
+		p->c[i] = fqmul(p->c[i], MLKEM_INV_NTT_F);
+}
+
+/*
+ * Adds the product of a and b in the NTT domain to r, using
+ * BaseCaseMultiply from FIPS 203 algorithm 12. The result carries a
+ * Montgomery factor of 2^-16.
+ */
+static void
+poly_mul_acc(poly *r, const poly *a, const poly *b)
+{
+	int16_t a0, a1, b0, b1;
+	size_t i;
+
+	for (i = 0; i < DEGREE / 2; i++) {
+		a0 = a->c[2 * i];
+		a1 = a->c[2 * i + 1];
+		b0 = b->c[2 * i];
+		b1 = b->c[2 * i + 1];
+
+		r->c[2 * i] += fqmul(fqmul(a1, b1), gammas[i]) +
+		    fqmul(a0, b0);
+		r->c[2 * i + 1] += fqmul(a0, b1) + fqmul(a1, b0);
+	}
+}
+
+/* Sets out to m * v, or to the transpose of m times v. */
+static void
+matrix_mul(poly out[RANK], const poly m[RANK][RANK], const poly v[RANK],
+    int transpose)
+{
+	size_t i, j;
+
+	for (i = 0; i < RANK; i++) {
+		memset(&out[i], 0, sizeof(out[i]));
+		for (j = 0; j < RANK; j++) {
+			if (transpose)
+				poly_mul_acc(&out[i], &m[j][i], &v[j]);
+			else
+				poly_mul_acc(&out[i], &m[i][j], &v[j]);
+		}
+		poly_reduce(&out[i]);
+	}
+}
+
+static void
+vector_inner_product(poly *out, const poly a[RANK], const poly b[RANK])
+{
+	size_t i;
+
+	memset(out, 0, sizeof(*out));
+	for (i = 0; i < RANK; i++)
+		poly_mul_acc(out, &a[i], &b[i]);
+	poly_reduce(out);
+}
+
+/*
+ * SampleNTT from FIPS 203 algorithm 7, which samples a uniformly random
+ * polynomial in the NTT domain from the SHAKE128 output for rho || b0 || b1.
+ */
+static void
+poly_sample_ntt(poly *out, const uint8_t rho[SEED_BYTES], uint8_t b0,
+    uint8_t b1)
+{
+	uint8_t buf[SHAKE128_BLOCK_SIZE * 3];
+	uint8_t input[SEED_BYTES + 2];
+	size_t done = 0, len, pos;
+	uint16_t d1, d2;
+	sha3_ctx ctx;
+
+	memcpy(input, rho, SEED_BYTES);
+	input[SEED_BYTES] = b0;
+	input[SEED_BYTES + 1] = b1;
+
+	shake128_init(&ctx);
+	shake_update(&ctx, input, sizeof(input));
+	shake_xof(&ctx);
+
+	/* Three blocks usually provide enough candidates. */
+	shake_out_blocks(&ctx, buf, 3);
+	len = sizeof(buf);
+
+	for (;;) {
+		for (pos = 0; pos + 3 <= len && done < DEGREE; pos += 3) {
+			d1 = buf[pos] | (buf[pos + 1] & 0xf) << 8;
+			d2 = buf[pos + 1] >> 4 | buf[pos + 2] << 4;
+			if (d1 < MLKEM_Q)
+				out->c[done++] = d1;
+			if (d2 < MLKEM_Q && done < DEGREE)
+				out->c[done++] = d2;
+		}
+		if (done == DEGREE)
+			break;
+		shake_out_blocks(&ctx, buf, 1);
+		len = SHAKE128_BLOCK_SIZE;
+	}
+}
+
+static void
+matrix_expand(poly m[RANK][RANK], const uint8_t rho[SEED_BYTES])
+{
+	size_t i, j;
+
+	for (i = 0; i < RANK; i++) {
+		for (j = 0; j < RANK; j++)
+			poly_sample_ntt(&m[i][j], rho, j, i);
+	}
+}
+
+/*
+ * SamplePolyCBD_2 from FIPS 203 algorithm 8, applied to the output of
+ * PRF_2(seed, n).
+ */
+static void
+poly_sample_cbd(poly *out, const uint8_t seed[SEED_BYTES], uint8_t n)
+{
+	uint8_t buf[CBD_BYTES];
+	uint32_t t, d;
+	sha3_ctx ctx;
+	size_t i, j;
+
+	shake256_init(&ctx);
+	shake_update(&ctx, seed, SEED_BYTES);
+	shake_update(&ctx, &n, 1);
+	shake_xof(&ctx);
+	shake_out(&ctx, buf, sizeof(buf));
+
+	for (i = 0; i < DEGREE / 8; i++) {
+		t = (uint32_t)buf[4 * i] | (uint32_t)buf[4 * i + 1] << 8 |
+		    (uint32_t)buf[4 * i + 2] << 16 |
+		    (uint32_t)buf[4 * i + 3] << 24;
+		d = (t & 0x55555555) + ((t >> 1) & 0x55555555);
+		for (j = 0; j < 8; j++) {
+			out->c[8 * i + j] = (int16_t)((d >> (4 * j)) & 3) -
+			    (int16_t)((d >> (4 * j + 2)) & 3);
+		}
+	}
+
+	explicit_bzero(buf, sizeof(buf));
+	explicit_bzero(&ctx, sizeof(ctx));
+}
+
+/* ByteEncode_12 from FIPS 203 algorithm 5. */
+static void
+poly_encode_12(uint8_t out[POLY_BYTES], const poly *p)
+{
+	uint16_t t0, t1;
+	size_t i;
+
+	for (i = 0; i < DEGREE / 2; i++) {
+		t0 = to_canonical(p->c[2 * i]);
+		t1 = to_canonical(p->c[2 * i + 1]);
+		out[3 * i] = t0;
+		out[3 * i + 1] = (t0 >> 8) | (t1 << 4);
+		out[3 * i + 2] = t1 >> 4;
+	}
+}
+
+/*
+ * ByteDecode_12 from FIPS 203 algorithm 6. Values that are not reduced
+ * modulo q are rejected, as required for encapsulation keys.
+ */
+static int
+poly_decode_12(poly *p, const uint8_t in[POLY_BYTES])
+{
+	uint16_t t0, t1;
+	size_t i;
+
+	for (i = 0; i < DEGREE / 2; i++) {
+		t0 = in[3 * i] | (in[3 * i + 1] & 0xf) << 8;
+		t1 = in[3 * i + 1] >> 4 | in[3 * i + 2] << 4;
+		if (t0 >= MLKEM_Q || t1 >= MLKEM_Q)
+			return 0;
+		p->c[2 * i] = t0;
+		p->c[2 * i + 1] = t1;
+	}
+
+	return 1;
+}
+
+static void
+poly_compress_10(uint8_t out[COMPRESSED_U_BYTES], const poly *p)
+{
+	uint16_t t[4];
+	size_t i, j;
+
+	for (i = 0; i < DEGREE / 4; i++) {
+		for (j = 0; j < 4; j++)
+			t[j] = compress(to_canonical(p->c[4 * i + j]), 10);
+		out[5 * i] = t[0];
+		out[5 * i + 1] = (t[0] >> 8) | (t[1] << 2);
+		out[5 * i + 2] = (t[1] >> 6) | (t[2] << 4);
+		out[5 * i + 3] = (t[2] >> 4) | (t[3] << 6);
+		out[5 * i + 4] = t[3] >> 2;
+	}
+}
+
+static void
+poly_decompress_10(poly *p, const uint8_t in[COMPRESSED_U_BYTES])
+{
+	const uint8_t *b;
+	size_t i;
+
+	for (i = 0; i < DEGREE / 4; i++) {
+		b = &in[5 * i];
+		p->c[4 * i] = decompress(b[0] | (b[1] & 0x03) << 8, 10);
+		p->c[4 * i + 1] = decompress(b[1] >> 2 | (b[2] & 0x0f) << 6, 10);
+		p->c[4 * i + 2] = decompress(b[2] >> 4 | (b[3] & 0x3f) << 4, 10);
+		p->c[4 * i + 3] = decompress(b[3] >> 6 | b[4] << 2, 10);
+	}
+}
+
+static void
+poly_compress_4(uint8_t out[COMPRESSED_V_BYTES], const poly *p)
+{
+	size_t i;
+
+	for (i = 0; i < DEGREE / 2; i++) {
+		out[i] = compress(to_canonical(p->c[2 * i]), 4) |
+		    compress(to_canonical(p->c[2 * i + 1]), 4) << 4;
+	}
+}
+
+static void
+poly_decompress_4(poly *p, const uint8_t in[COMPRESSED_V_BYTES])
+{
+	size_t i;
+
+	for (i = 0; i < DEGREE / 2; i++) {
+		p->c[2 * i] = decompress(in[i] & 0xf, 4);
+		p->c[2 * i + 1] = decompress(in[i] >> 4, 4);
+	}
+}
+
+static void
+poly_from_message(poly *p, const uint8_t msg[32])
+{
+	int16_t mask;
+	size_t i, j;
+
+	for (i = 0; i < DEGREE / 8; i++) {
+		for (j = 0; j < 8; j++) {
+			mask = -(int16_t)((msg[i] >> j) & 1);
+			p->c[8 * i + j] = mask & ((MLKEM_Q + 1) / 2);
+		}
+	}
+}
+
+static void
+poly_to_message(uint8_t msg[32], const poly *p)
+{
+	size_t i, j;
+
+	for (i = 0; i < DEGREE / 8; i++) {
+		msg[i] = 0;
+		for (j = 0; j < 8; j++)
+			msg[i] |= compress(to_canonical(p->c[8 * i + j]), 1) << j;
+	}
+}
+
+static void
+public_key_encode(uint8_t out[MLKEM768_PUBLIC_KEY_BYTES],
+    const struct public_key *pub)
+{
+	size_t i;
+
+	for (i = 0; i < RANK; i++)
+		poly_encode_12(&out[i * POLY_BYTES], &pub->t[i]);
+	memcpy(&out[RANK * POLY_BYTES], pub->rho, SEED_BYTES);
+}
+
+/* K-PKE.Encrypt from FIPS 203 algorithm 14. */
+static void
+pke_encrypt(uint8_t out[MLKEM768_CIPHERTEXT_BYTES],
+    const struct public_key *pub, const uint8_t msg[32],
+    const uint8_t r[SEED_BYTES])
+{
+	poly y[RANK], u[RANK], e, v, mu;
+	uint8_t n = 0;
+	size_t i;
+
+	for (i = 0; i < RANK; i++) {
+		poly_sample_cbd(&y[i], r, n++);
+		poly_ntt(&y[i]);
+	}
+
+	matrix_mul(u, pub->m, y, 1);
+	for (i = 0; i < RANK; i++) {
+		poly_inv_ntt_tomont(&u[i]);
+		poly_sample_cbd(&e, r, n++);
+		poly_add(&u[i], &e);
+		poly_reduce(&u[i]);
+		poly_compress_10(&out[i * COMPRESSED_U_BYTES], &u[i]);
+	}
+
+	vector_inner_product(&v, pub->t, y);
+	poly_inv_ntt_tomont(&v);
+	poly_sample_cbd(&e, r, n++);
+	poly_add(&v, &e);
+	poly_from_message(&mu, msg);
+	poly_add(&v, &mu);
+	poly_reduce(&v);
+	poly_compress_4(&out[RANK * COMPRESSED_U_BYTES], &v);
+
+	explicit_bzero(y, sizeof(y));
+	explicit_bzero(u, sizeof(u));
+	explicit_bzero(&e, sizeof(e));
+	explicit_bzero(&v, sizeof(v));
+	explicit_bzero(&mu, sizeof(mu));
+}
+
+/* K-PKE.Decrypt from FIPS 203 algorithm 15. */
+static void
+pke_decrypt(uint8_t out_msg[32], const struct private_key *priv,
+    const uint8_t ciphertext[MLKEM768_CIPHERTEXT_BYTES])
+{
+	poly u[RANK], v, w;
+	size_t i;
+
+	for (i = 0; i < RANK; i++) {
+		poly_decompress_10(&u[i], &ciphertext[i * COMPRESSED_U_BYTES]);
+		poly_ntt(&u[i]);
+	}
+	poly_decompress_4(&v, &ciphertext[RANK * COMPRESSED_U_BYTES]);
+
+	vector_inner_product(&w, priv->s, u);
+	poly_inv_ntt_tomont(&w);
+	poly_sub(&w, &v, &w);
+	poly_reduce(&w);
+	poly_to_message(out_msg, &w);
+
+	explicit_bzero(&w, sizeof(w));
+}
+
+/* ML-KEM.KeyGen_internal from FIPS 203 algorithm 16. */
+void
+MLKEM768_generate_key_external_entropy(
+    uint8_t out_encoded_public_key[MLKEM768_PUBLIC_KEY_BYTES],
+    struct MLKEM768_private_key *out_private_key,
+    const uint8_t seed[MLKEM_SEED_BYTES])
+{
+	struct private_key *priv = private_key_from_external(out_private_key);
+	uint8_t input[SEED_BYTES + 1];
+	uint8_t hashed[64];
+	const uint8_t *sigma;
+	poly e;
+	uint8_t n = 0;
+	size_t i;
+
+	/* (rho, sigma) = G(d || k). */
+	memcpy(input, seed, SEED_BYTES);
+	input[SEED_BYTES] = RANK;
+	sha3(input, sizeof(input), hashed, sizeof(hashed));
+	memcpy(priv->pub.rho, hashed, SEED_BYTES);
+	sigma = &hashed[SEED_BYTES];
+
+	matrix_expand(priv->pub.m, priv->pub.rho);
+
+	for (i = 0; i < RANK; i++) {
+		poly_sample_cbd(&priv->s[i], sigma, n++);
+		poly_ntt(&priv->s[i]);
+	}
+
+	matrix_mul(priv->pub.t, priv->pub.m, priv->s, 0);
+	for (i = 0; i < RANK; i++) {
+		poly_tomont(&priv->pub.t[i]);
+		poly_sample_cbd(&e, sigma, n++);
+		poly_ntt(&e);
+		poly_add(&priv->pub.t[i], &e);
+		poly_reduce(&priv->pub.t[i]);
+	}
+
+	public_key_encode(out_encoded_public_key, &priv->pub);
+	sha3(out_encoded_public_key, MLKEM768_PUBLIC_KEY_BYTES,
+	    priv->pub.public_key_hash, sizeof(priv->pub.public_key_hash));
+	memcpy(priv->fo_failure_secret, &seed[SEED_BYTES],
+	    sizeof(priv->fo_failure_secret));
+
+	explicit_bzero(input, sizeof(input));
+	explicit_bzero(hashed, sizeof(hashed));
+	explicit_bzero(&e, sizeof(e));
+}
+
+void
+MLKEM768_generate_key(
+    uint8_t out_encoded_public_key[MLKEM768_PUBLIC_KEY_BYTES],
+    uint8_t optional_out_seed[MLKEM_SEED_BYTES],
+    struct MLKEM768_private_key *out_private_key)
+{
+	uint8_t seed[MLKEM_SEED_BYTES];
+
+	arc4random_buf(seed, sizeof(seed));
+	MLKEM768_generate_key_external_entropy(out_encoded_public_key,
+	    out_private_key, seed);
+	if (optional_out_seed != NULL)
+		memcpy(optional_out_seed, seed, sizeof(seed));
+
+	explicit_bzero(seed, sizeof(seed));
+}
+
+int
+MLKEM768_private_key_from_seed(struct MLKEM768_private_key *out_private_key,
+    const uint8_t *seed, size_t seed_len)
+{
+	uint8_t public_key[MLKEM768_PUBLIC_KEY_BYTES];
+
+	if (seed_len != MLKEM_SEED_BYTES)
+		return 0;
+
+	MLKEM768_generate_key_external_entropy(public_key, out_private_key,
+	    seed);
+
+	return 1;
+}
+
+void
+MLKEM768_public_from_private(struct MLKEM768_public_key *out_public_key,
+    const struct MLKEM768_private_key *private_key)
+{
+	struct public_key *pub = public_key_from_external(out_public_key);
+	const struct private_key *priv = private_key_from_external(private_key);
+
+	*pub = priv->pub;
+}
+
+int
+MLKEM768_parse_public_key(struct MLKEM768_public_key *out_public_key,
+    const uint8_t *in, size_t in_len)
+{
+	struct public_key *pub = public_key_from_external(out_public_key);
+	size_t i;
+
+	if (in_len != MLKEM768_PUBLIC_KEY_BYTES)
+		return 0;
+
+	for (i = 0; i < RANK; i++) {
+		if (!poly_decode_12(&pub->t[i], &in[i * POLY_BYTES]))
+			return 0;
+	}
+	memcpy(pub->rho, &in[RANK * POLY_BYTES], SEED_BYTES);
+	sha3(in, in_len, pub->public_key_hash, sizeof(pub->public_key_hash));
+	matrix_expand(pub->m, pub->rho);
+
+	return 1;
+}
+
+void
+MLKEM768_marshal_public_key(
+    uint8_t out_encoded_public_key[MLKEM768_PUBLIC_KEY_BYTES],
+    const struct MLKEM768_public_key *public_key)
+{
+	public_key_encode(out_encoded_public_key,
+	    public_key_from_external(public_key));
+}
+
+/* ML-KEM.Encaps_internal from FIPS 203 algorithm 17. */
+void
+MLKEM768_encap_external_entropy(
+    uint8_t out_ciphertext[MLKEM768_CIPHERTEXT_BYTES],
+    uint8_t out_shared_secret[MLKEM_SHARED_SECRET_BYTES],
+    const struct MLKEM768_public_key *public_key,
+    const uint8_t entropy[MLKEM_ENCAP_ENTROPY_BYTES])
+{
+	const struct public_key *pub = public_key_from_external(public_key);
+	uint8_t input[MLKEM_ENCAP_ENTROPY_BYTES + 32];
+	uint8_t key_and_randomness[64];
+
+	/* (K, r) = G(m || H(ek)). */
+	memcpy(input, entropy, MLKEM_ENCAP_ENTROPY_BYTES);
+	memcpy(&input[MLKEM_ENCAP_ENTROPY_BYTES], pub->public_key_hash,
+	    sizeof(pub->public_key_hash));
+	sha3(input, sizeof(input), key_and_randomness,
+	    sizeof(key_and_randomness));
+
+	pke_encrypt(out_ciphertext, pub, entropy, &key_and_randomness[32]);
+	memcpy(out_shared_secret, key_and_randomness,
+	    MLKEM_SHARED_SECRET_BYTES);
+
+	explicit_bzero(input, sizeof(input));
+	explicit_bzero(key_and_randomness, sizeof(key_and_randomness));
+}
+
+void
+MLKEM768_encap(uint8_t out_ciphertext[MLKEM768_CIPHERTEXT_BYTES],
+    uint8_t out_shared_secret[MLKEM_SHARED_SECRET_BYTES],
+    const struct MLKEM768_public_key *public_key)
+{
+	uint8_t entropy[MLKEM_ENCAP_ENTROPY_BYTES];
+
+	arc4random_buf(entropy, sizeof(entropy));
+	MLKEM768_encap_external_entropy(out_ciphertext, out_shared_secret,
+	    public_key, entropy);
+
+	explicit_bzero(entropy, sizeof(entropy));
+}
+
+/* ML-KEM.Decaps_internal from FIPS 203 algorithm 18. */
+int
+MLKEM768_decap(uint8_t out_shared_secret[MLKEM_SHARED_SECRET_BYTES],
+    const uint8_t *ciphertext, size_t ciphertext_len,
+    const struct MLKEM768_private_key *private_key)
+{
+	const struct private_key *priv = private_key_from_external(private_key);
+	uint8_t expected_ciphertext[MLKEM768_CIPHERTEXT_BYTES];
+	uint8_t failure_key[MLKEM_SHARED_SECRET_BYTES];
+	uint8_t key_and_randomness[64];
+	uint8_t input[32 + 32];
+	unsigned char mask;
+	sha3_ctx ctx;
+	size_t i;
+
+	if (ciphertext_len != MLKEM768_CIPHERTEXT_BYTES) {
+		arc4random_buf(out_shared_secret, MLKEM_SHARED_SECRET_BYTES);
+		return 0;
+	}
+
+	pke_decrypt(input, priv, ciphertext);
+
+	/* (K', r') = G(m' || h). */
+	memcpy(&input[32], priv->pub.public_key_hash,
+	    sizeof(priv->pub.public_key_hash));
+	sha3(input, sizeof(input), key_and_randomness,
+	    sizeof(key_and_randomness));
+
+	pke_encrypt(expected_ciphertext, &priv->pub, input,
+	    &key_and_randomness[32]);
+
+	/* K_bar = J(z || c). */
+	shake256_init(&ctx);
+	shake_update(&ctx, priv->fo_failure_secret,
+	    sizeof(priv->fo_failure_secret));
+	shake_update(&ctx, ciphertext, ciphertext_len);
+	shake_xof(&ctx);
+	shake_out(&ctx, failure_key, sizeof(failure_key));
+
+	mask = constant_time_is_zero_8(timingsafe_memcmp(ciphertext,
+	    expected_ciphertext, sizeof(expected_ciphertext)));
+	for (i = 0; i < MLKEM_SHARED_SECRET_BYTES; i++)
+		out_shared_secret[i] = constant_time_select_8(mask,
+		    key_and_randomness[i], failure_key[i]);
+
+	explicit_bzero(expected_ciphertext, sizeof(expected_ciphertext));
+	explicit_bzero(failure_key, sizeof(failure_key));
+	explicit_bzero(key_and_randomness, sizeof(key_and_randomness));
+	explicit_bzero(input, sizeof(input));
+	explicit_bzero(&ctx, sizeof(ctx));
+
+	return 1;
+}
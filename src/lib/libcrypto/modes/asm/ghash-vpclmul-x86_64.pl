@@ -0,0 +1,185 @@
+#!/usr/bin/env perl
+# $OpenBSD$
+#
+# Copyright (c) 2026 agent <agent@local>
+#
+# Permission to use, copy, modify, and distribute this software for any
+# purpose with or without fee is hereby granted, provided that the above
+# copyright notice and this permission notice appear in all copies.
+#
+# THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+# WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+# ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+# WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+# ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+# OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+#
+# GHASH using VPCLMULQDQ with 512 bit registers, processing 16 blocks per
+# iteration with a single reduction.
+#
+# The table of hash key powers H^1..H^16 is computed by gcm_init_vpclmul()
+# in gcm128.c, in the same representation as used by gcm_ghash_clmul() in
+# ghash-x86_64.pl (which only uses the first two entries). As such, the
+# result of each iteration is
+#
+#	Xi = (Xi + I[0]) * H^16 + I[1] * H^15 + ... + I[15] * H
+#
+# The input length must be a multiple of 256 bytes. The caller must have
+# checked for AVX-512F, AVX-512BW, AVX-512VL and VPCLMULQDQ support.
+
+$flavour = shift;
+$output  = shift;
+if ($flavour =~ /\./) { $output = $flavour; undef $flavour; }
+
+$win64=0; $win64=1 if ($flavour =~ /[nm]asm|mingw64/ || $output =~ /\.asm$/);
+die "Win64 is not supported" if ($win64);
+
+$0 =~ m/(.*[\/\\])[^\/\\]+$/; $dir=$1;
+( $xlate="${dir}x86_64-xlate.pl" and -f $xlate ) or
+( $xlate="${dir}../../perlasm/x86_64-xlate.pl" and -f $xlate) or
+die "can't locate x86_64-xlate.pl";
+
+open OUT,"| \"$^X\" $xlate $flavour $output";
+*STDOUT=*OUT;
+
+($Xip,$Htbl,$inp,$len)=("%rdi","%rsi","%rdx","%rcx");
+
+# Input blocks and hash key powers.
+@I=map("%zmm$_",(0..3));
+@H=map("%zmm$_",(16..19));
+$bswap="%zmm20";
+
+# Unreduced products.
+($Lo,$Hi,$Mid)=("%zmm4","%zmm5","%zmm6");
+@T=map("%zmm$_",(7..10));
+
+# Reduction, using VEX encoded instructions on %xmm0-%xmm15.
+($Xi,$Xhi,$T1,$T2)=("%xmm15","%xmm5","%xmm11","%xmm12");
+
+sub reduction_alg9 {
+my ($Xhi,$Xi) = @_;
+
+$code.=<<___;
+	# 1st phase
+	vpsllq		\$1,$Xi,$T2
+	vpxor		$Xi,$T2,$T2
+	vpsllq		\$5,$T2,$T2
+	vpxor		$Xi,$T2,$T2
+	vpsllq		\$57,$T2,$T2
+	vpsrldq		\$8,$T2,$T1
+	vpslldq		\$8,$T2,$T2
+	vpxor		$Xi,$T2,$Xi
+	vpxor		$T1,$Xhi,$Xhi
+
+	# 2nd phase
+	vpsrlq		\$5,$Xi,$T2
+	vpxor		$Xi,$T2,$T2
+	vpsrlq		\$1,$T2,$T2
+	vpxor		$Xi,$T2,$T2
+	vpxor		$Xhi,$Xi,$T1
+	vpsrlq		\$1,$T2,$T2
+	vpxor		$T1,$T2,$Xi
+___
+}
+
+$code.=<<___;
+.text
+
+.globl	gcm_ghash_vpclmul
+.type	gcm_ghash_vpclmul,\@abi-omnipotent
+.align	32
+gcm_ghash_vpclmul:
+	shr		\$8,$len
+	jz		.Lghash_vpclmul_done
+
+	vbroadcasti32x4	.Lbswap_mask(%rip),$bswap
+	vmovdqu		($Xip),$Xi
+	vpshufb		.Lbswap_mask(%rip),$Xi,$Xi
+
+	# Load H^16..H^1, with the highest power in the lowest lane.
+	vmovdqu64	0xc0($Htbl),$H[0]
+	vmovdqu64	0x80($Htbl),$H[1]
+	vmovdqu64	0x40($Htbl),$H[2]
+	vmovdqu64	0x00($Htbl),$H[3]
+	vshufi64x2	\$0x1b,$H[0],$H[0],$H[0]
+	vshufi64x2	\$0x1b,$H[1],$H[1],$H[1]
+	vshufi64x2	\$0x1b,$H[2],$H[2],$H[2]
+	vshufi64x2	\$0x1b,$H[3],$H[3],$H[3]
+	jmp		.Lghash_vpclmul_loop
+
+.align	32
+.Lghash_vpclmul_loop:
+	vmovdqu64	0x00($inp),$I[0]
+	vmovdqu64	0x40($inp),$I[1]
+	vmovdqu64	0x80($inp),$I[2]
+	vmovdqu64	0xc0($inp),$I[3]
+	lea		0x100($inp),$inp
+	vpshufb		$bswap,$I[0],$I[0]
+	vpshufb		$bswap,$I[1],$I[1]
+	vpshufb		$bswap,$I[2],$I[2]
+	vpshufb		$bswap,$I[3],$I[3]
+
+	# The upper lanes of %zmm15 are zero, so this only affects I[0].
+	vpxorq		%zmm15,$I[0],$I[0]
+
+	vpclmulqdq	\$0x00,$H[0],$I[0],$Lo
+	vpclmulqdq	\$0x11,$H[0],$I[0],$Hi
+	vpclmulqdq	\$0x01,$H[0],$I[0],$Mid
+	vpclmulqdq	\$0x10,$H[0],$I[0],$T[0]
+	vpxorq		$T[0],$Mid,$Mid
+___
+for ($i = 1; $i < 4; $i++) {
+$code.=<<___;
+	vpclmulqdq	\$0x00,$H[$i],$I[$i],$T[0]
+	vpclmulqdq	\$0x11,$H[$i],$I[$i],$T[1]
+	vpclmulqdq	\$0x01,$H[$i],$I[$i],$T[2]
+	vpclmulqdq	\$0x10,$H[$i],$I[$i],$T[3]
+	vpxorq		$T[0],$Lo,$Lo
+	vpxorq		$T[1],$Hi,$Hi
+	vpternlogq	\$0x96,$T[2],$T[3],$Mid
+___
+}
+$code.=<<___;
+
+	# Fold the middle terms into the low and high halves.
+	vpsrldq		\$8,$Mid,$T[0]
+	vpslldq		\$8,$Mid,$T[1]
+	vpxorq		$T[0],$Hi,$Hi
+	vpxorq		$T[1],$Lo,$Lo
+
+	# Sum the four lanes.
+	vextracti64x4	\$1,$Lo,%ymm7
+	vextracti64x4	\$1,$Hi,%ymm8
+	vpxor		%ymm7,%ymm4,%ymm4
+	vpxor		%ymm8,%ymm5,%ymm5
+	vextracti128	\$1,%ymm4,%xmm7
+	vextracti128	\$1,%ymm5,%xmm8
+	vpxor		%xmm7,%xmm4,$Xi
+	vpxor		%xmm8,%xmm5,$Xhi
+___
+	&reduction_alg9($Xhi,$Xi);
+$code.=<<___;
+
+	dec		$len
+	jnz		.Lghash_vpclmul_loop
+
+	vpshufb		.Lbswap_mask(%rip),$Xi,$Xi
+	vmovdqu		$Xi,($Xip)
+	vzeroupper
+
+.Lghash_vpclmul_done:
+	ret
+.size	gcm_ghash_vpclmul,.-gcm_ghash_vpclmul
+
+.section .rodata
+.align	16
+.Lbswap_mask:
+	.byte	15,14,13,12,11,10,9,8,7,6,5,4,3,2,1,0
+___
+
+$code =~ s/\`([^\`]*)\`/eval($1)/gem;
+
+print $code;
+
+close STDOUT;
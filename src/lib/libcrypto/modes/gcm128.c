@@ -51,6 +51,7 @@
 #define OPENSSL_FIPSAPI
 
 #include <openssl/crypto.h>
+#include "cryptlib.h"
 #include "modes_local.h"
 #include <string.h>
 
@@ -651,6 +652,49 @@ void gcm_init_clmul(u128 Htable[16],const u64 Xi[2]);
 void gcm_gmult_clmul(u64 Xi[2],const u128 Htable[16]);
 void gcm_ghash_clmul(u64 Xi[2],const u128 Htable[16],const u8 *inp,size_t len);
 
+#  if	defined(__x86_64) || defined(__x86_64__)
+#   define GHASH_ASM_VPCLMUL
+void gcm_ghash_vpclmul(u64 Xi[2],const u128 Htable[16],const u8 *inp,size_t len);
+
+/*
+ * gcm_ghash_vpclmul() processes 16 blocks at a time and requires H^1..H^16
+ * in Htable, in the same representation as produced by gcm_init_clmul().
+ * The powers are computed by multiplying the byte swapped previous power
+ * by H, using gcm_gmult_clmul().
+ */
+static void
+gcm_init_vpclmul(u128 Htable[16], const u64 H[2])
+{
+	u64 X[2];
+	int i;
+
+	gcm_init_clmul(Htable, H);
+
+	for (i = 2; i < 16; i++) {
+		X[0] = BSWAP8(Htable[i - 1].lo);
+		X[1] = BSWAP8(Htable[i - 1].hi);
+		gcm_gmult_clmul(X, Htable);
+		Htable[i].lo = BSWAP8(X[0]);
+		Htable[i].hi = BSWAP8(X[1]);
+	}
+}
+
+static void
+gcm_ghash_vpclmul_any(u64 Xi[2], const u128 Htable[16], const u8 *inp,
+    size_t len)
+{
+	size_t bulk;
+
+	if ((bulk = len & ~(size_t)255) != 0) {
+		gcm_ghash_vpclmul(Xi, Htable, inp, bulk);
+		inp += bulk;
+		len -= bulk;
+	}
+	if (len != 0)
+		gcm_ghash_clmul(Xi, Htable, inp, len);
+}
+#  endif
+
 #  if	defined(__i386) || defined(__i386__) || defined(_M_IX86)
 #   define GHASH_ASM_X86
 void gcm_gmult_4bit_mmx(u64 Xi[2],const u128 Htable[16]);
@@ -710,6 +754,14 @@ void CRYPTO_gcm128_init(GCM128_CONTEXT *ctx,void *key,block128_f block)
 	/* check FXSR and PCLMULQDQ bits */
 	if ((OPENSSL_cpu_caps() & (CPUCAP_MASK_FXSR | CPUCAP_MASK_PCLMUL)) ==
 	    (CPUCAP_MASK_FXSR | CPUCAP_MASK_PCLMUL)) {
+#   if	defined(GHASH_ASM_VPCLMUL)
+		if (OPENSSL_cpu_caps() & CPUCAP_MASK_VAES512) {
+			gcm_init_vpclmul(ctx->Htable,ctx->H.u);
+			ctx->gmult = gcm_gmult_clmul;
+			ctx->ghash = gcm_ghash_vpclmul_any;
+			return;
+		}
+#   endif
 		gcm_init_clmul(ctx->Htable,ctx->H.u);
 		ctx->gmult = gcm_gmult_clmul;
 		ctx->ghash = gcm_ghash_clmul;
@@ -748,6 +800,50 @@ void CRYPTO_gcm128_init(GCM128_CONTEXT *ctx,void *key,block128_f block)
 #endif
 }
 
+static void
+gcm128_impl_block(const unsigned char in[16], unsigned char out[16],
+    const void *key)
+{
+	memset(out, 0, 16);
+}
+
+/*
+ * Report the GHASH implementation that CRYPTO_gcm128_init() selects, given
+ * the current CPU capabilities.
+ */
+const char *
+gcm128_cpu_impl(void)
+{
+	GCM128_CONTEXT ctx;
+	const char *impl;
+
+	CRYPTO_gcm128_init(&ctx, NULL, gcm128_impl_block);
+
+#if	defined(GHASH_ASM_X86_OR_64)
+	impl = "4bit-asm";
+	if (ctx.ghash == gcm_ghash_clmul)
+		impl = "clmul";
+#  if	defined(GHASH_ASM_VPCLMUL)
+	if (ctx.ghash == gcm_ghash_vpclmul_any)
+		impl = "vpclmul";
+#  endif
+#  if	defined(GHASH_ASM_X86)
+	if (ctx.ghash == gcm_ghash_4bit_mmx)
+		impl = "4bit-mmx";
+#  endif
+#elif	defined(GHASH_ASM_ARM)
+	impl = ctx.ghash == gcm_ghash_neon ? "neon" : "4bit-asm";
+#elif	defined(GHASH_ASM)
+	impl = "4bit-asm";
+#else
+	impl = "4bit-c";
+#endif
+
+	explicit_bzero(&ctx, sizeof(ctx));
+
+	return impl;
+}
+
 void CRYPTO_gcm128_setiv(GCM128_CONTEXT *ctx,const unsigned char *iv,size_t len)
 {
 	unsigned int ctr;
@@ -256,6 +256,9 @@ int RSA_public_encrypt(int flen, const unsigned char *from,
     unsigned char *to, RSA *rsa, int padding);
 int RSA_private_encrypt(int flen, const unsigned char *from,
     unsigned char *to, RSA *rsa, int padding);
+int RSA_private_encrypt_batch(size_t num, const int *flen,
+    const unsigned char *const *from, unsigned char *const *to,
+    RSA *const *rsa, int padding, int *out_len);
 int RSA_public_decrypt(int flen, const unsigned char *from,
     unsigned char *to, RSA *rsa, int padding);
 int RSA_private_decrypt(int flen, const unsigned char *from,
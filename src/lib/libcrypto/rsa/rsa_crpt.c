@@ -99,6 +99,15 @@ RSA_private_encrypt(int flen, const unsigned char *from, unsigned char *to,
 	return rsa->meth->rsa_priv_enc(flen, from, to, rsa, padding);
 }
 
+int
+RSA_private_encrypt_batch(size_t num, const int *flen,
+    const unsigned char *const *from, unsigned char *const *to,
+    RSA *const *rsa, int padding, int *out_len)
+{
+	return rsa_eay_private_encrypt_batch(num, flen, from, to, rsa,
+	    padding, out_len);
+}
+
 int
 RSA_private_decrypt(int flen, const unsigned char *from, unsigned char *to,
     RSA *rsa, int padding)
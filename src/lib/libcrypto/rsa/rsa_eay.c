@@ -130,6 +130,8 @@ static int RSA_eay_public_decrypt(int flen, const unsigned char *from,
 static int RSA_eay_private_decrypt(int flen, const unsigned char *from,
     unsigned char *to, RSA *rsa, int padding);
 static int RSA_eay_mod_exp(BIGNUM *r0, const BIGNUM *i, RSA *rsa, BN_CTX *ctx);
+static int rsa_eay_crt_combine(BIGNUM *r0, BIGNUM *m1, const BIGNUM *I,
+    RSA *rsa, BN_CTX *ctx);
 static int RSA_eay_init(RSA *rsa);
 static int RSA_eay_finish(RSA *rsa);
 
@@ -346,13 +348,57 @@ rsa_blinding_invert(BN_BLINDING *b, BIGNUM *f, BIGNUM *unblind, BN_CTX *ctx)
 	return BN_BLINDING_invert_ex(f, unblind, b, ctx);
 }
 
+static int
+rsa_eay_private_encrypt_pad(unsigned char *buf, int num,
+    const unsigned char *from, int flen, int padding)
+{
+	switch (padding) {
+	case RSA_PKCS1_PADDING:
+		return RSA_padding_add_PKCS1_type_1(buf, num, from, flen);
+	case RSA_X931_PADDING:
+		return RSA_padding_add_X931(buf, num, from, flen);
+	case RSA_NO_PADDING:
+		return RSA_padding_add_none(buf, num, from, flen);
+	default:
+		RSAerror(RSA_R_UNKNOWN_PADDING_TYPE);
+		return -1;
+	}
+}
+
+static int
+rsa_eay_private_encrypt_output(unsigned char *to, int num, BIGNUM *ret,
+    BIGNUM *f, RSA *rsa, int padding)
+{
+	BIGNUM *res;
+	int i, j, k;
+
+	if (padding == RSA_X931_PADDING) {
+		if (!BN_sub(f, rsa->n, ret))
+			return 0;
+		if (BN_cmp(ret, f) > 0)
+			res = f;
+		else
+			res = ret;
+	} else
+		res = ret;
+
+	/* put in leading 0 bytes if the number is less than the
+	 * length of the modulus */
+	j = BN_num_bytes(res);
+	i = BN_bn2bin(res, &(to[num - j]));
+	for (k = 0; k < num - i; k++)
+		to[k] = 0;
+
+	return 1;
+}
+
 /* signing */
 static int
 RSA_eay_private_encrypt(int flen, const unsigned char *from, unsigned char *to,
     RSA *rsa, int padding)
 {
-	BIGNUM *f, *ret, *res;
-	int i, j, k, num = 0, r = -1;
+	BIGNUM *f, *ret;
+	int i, num = 0, r = -1;
 	unsigned char *buf = NULL;
 	BN_CTX *ctx = NULL;
 	int local_blinding = 0;
@@ -378,20 +424,7 @@ RSA_eay_private_encrypt(int flen, const unsigned char *from, unsigned char *to,
 		goto err;
 	}
 
-	switch (padding) {
-	case RSA_PKCS1_PADDING:
-		i = RSA_padding_add_PKCS1_type_1(buf, num, from, flen);
-		break;
-	case RSA_X931_PADDING:
-		i = RSA_padding_add_X931(buf, num, from, flen);
-		break;
-	case RSA_NO_PADDING:
-		i = RSA_padding_add_none(buf, num, from, flen);
-		break;
-	default:
-		RSAerror(RSA_R_UNKNOWN_PADDING_TYPE);
-		goto err;
-	}
+	i = rsa_eay_private_encrypt_pad(buf, num, from, flen, padding);
 	if (i <= 0)
 		goto err;
 
@@ -448,22 +481,8 @@ RSA_eay_private_encrypt(int flen, const unsigned char *from, unsigned char *to,
 		if (!rsa_blinding_invert(blinding, ret, unblind, ctx))
 			goto err;
 
-	if (padding == RSA_X931_PADDING) {
-		if (!BN_sub(f, rsa->n, ret))
-			goto err;
-		if (BN_cmp(ret, f) > 0)
-			res = f;
-		else
-			res = ret;
-	} else
-		res = ret;
-
-	/* put in leading 0 bytes if the number is less than the
-	 * length of the modulus */
-	j = BN_num_bytes(res);
-	i = BN_bn2bin(res, &(to[num - j]));
-	for (k = 0; k < num - i; k++)
-		to[k] = 0;
+	if (!rsa_eay_private_encrypt_output(to, num, ret, f, rsa, padding))
+		goto err;
 
 	r = num;
 err:
@@ -703,15 +722,14 @@ err:
 static int
 RSA_eay_mod_exp(BIGNUM *r0, const BIGNUM *I, RSA *rsa, BN_CTX *ctx)
 {
-	BIGNUM *r1, *m1, *vrfy;
-	BIGNUM dmp1, dmq1, c, pr1;
+	BIGNUM *r1, *m1;
+	BIGNUM dmp1, dmq1, c;
 	int ret = 0;
 
 	BN_CTX_start(ctx);
 	r1 = BN_CTX_get(ctx);
 	m1 = BN_CTX_get(ctx);
-	vrfy = BN_CTX_get(ctx);
-	if (r1 == NULL || m1 == NULL || vrfy == NULL) {
+	if (r1 == NULL || m1 == NULL) {
 		RSAerror(ERR_R_MALLOC_FAILURE);
 		goto err;
 	}
@@ -774,6 +792,35 @@ RSA_eay_mod_exp(BIGNUM *r0, const BIGNUM *I, RSA *rsa, BN_CTX *ctx)
 	    rsa->_method_mod_p))
 		goto err;
 
+	if (!rsa_eay_crt_combine(r0, m1, I, rsa, ctx))
+		goto err;
+
+	ret = 1;
+err:
+	BN_CTX_end(ctx);
+	return ret;
+}
+
+/*
+ * Combine r0 = I^dmp1 mod p and m1 = I^dmq1 mod q into r0 = I^d mod n,
+ * verifying the result.
+ */
+static int
+rsa_eay_crt_combine(BIGNUM *r0, BIGNUM *m1, const BIGNUM *I, RSA *rsa,
+    BN_CTX *ctx)
+{
+	BIGNUM *r1, *vrfy;
+	BIGNUM pr1;
+	int ret = 0;
+
+	BN_CTX_start(ctx);
+	r1 = BN_CTX_get(ctx);
+	vrfy = BN_CTX_get(ctx);
+	if (r1 == NULL || vrfy == NULL) {
+		RSAerror(ERR_R_MALLOC_FAILURE);
+		goto err;
+	}
+
 	if (!BN_sub(r0, r0, m1))
 		goto err;
 
@@ -851,6 +898,242 @@ err:
 	return ret;
 }
 
+/*
+ * Private key encryptions that are batched use the multi-buffer modular
+ * exponentiation, with each operation occupying two lanes, one for each of
+ * its CRT exponentiations. Batching fewer operations than this does not
+ * outperform performing them individually.
+ */
+#define RSA_EAY_BATCH_MAX	(BN_MOD_EXP_MB_LANES / 2)
+#define RSA_EAY_BATCH_MIN	2
+
+/* Primes shorter than this are faster to exponentiate individually. */
+#define RSA_EAY_BATCH_MIN_PRIME_BITS	768
+
+struct rsa_eay_batch_op {
+	RSA *rsa;
+	int flen;
+	const unsigned char *from;
+	unsigned char *to;
+	int num;
+	BIGNUM *f;
+	BIGNUM *ret;
+	BIGNUM *m1;
+	BIGNUM *unblind;
+	BN_BLINDING *blinding;
+	int *out_len;
+};
+
+static int
+rsa_eay_batchable(const RSA *rsa)
+{
+	if (rsa->meth != &rsa_pkcs1_eay_meth)
+		return 0;
+	if ((rsa->flags & RSA_FLAG_EXT_PKEY) != 0)
+		return 0;
+	if (rsa->n == NULL || rsa->p == NULL || rsa->q == NULL ||
+	    rsa->dmp1 == NULL || rsa->dmq1 == NULL || rsa->iqmp == NULL)
+		return 0;
+	if (BN_num_bits(rsa->p) < RSA_EAY_BATCH_MIN_PRIME_BITS ||
+	    BN_num_bits(rsa->p) > BN_MOD_EXP_MB_MAX_BITS)
+		return 0;
+	if (BN_num_bits(rsa->q) < RSA_EAY_BATCH_MIN_PRIME_BITS ||
+	    BN_num_bits(rsa->q) > BN_MOD_EXP_MB_MAX_BITS)
+		return 0;
+
+	return 1;
+}
+
+/*
+ * Pad and blind the input of a batched operation, then reduce it modulo
+ * p and q, leaving the results in op->ret and op->m1 respectively.
+ */
+static int
+rsa_eay_batch_op_start(struct rsa_eay_batch_op *op, int padding,
+    BN_CTX *ctx)
+{
+	RSA *rsa = op->rsa;
+	unsigned char *buf = NULL;
+	int local_blinding;
+	BIGNUM c;
+	int ret = 0;
+
+	op->num = BN_num_bytes(rsa->n);
+	op->f = BN_CTX_get(ctx);
+	op->ret = BN_CTX_get(ctx);
+	op->m1 = BN_CTX_get(ctx);
+	op->unblind = BN_CTX_get(ctx);
+	buf = malloc(op->num);
+
+	if (op->unblind == NULL || buf == NULL) {
+		RSAerror(ERR_R_MALLOC_FAILURE);
+		goto err;
+	}
+
+	if (rsa_eay_private_encrypt_pad(buf, op->num, op->from, op->flen,
+	    padding) <= 0)
+		goto err;
+
+	if (BN_bin2bn(buf, op->num, op->f) == NULL)
+		goto err;
+
+	if (BN_ucmp(op->f, rsa->n) >= 0) {
+		/* usually the padding functions would catch this */
+		RSAerror(RSA_R_DATA_TOO_LARGE_FOR_MODULUS);
+		goto err;
+	}
+
+	if (rsa->flags & RSA_FLAG_CACHE_PUBLIC) {
+		if (!BN_MONT_CTX_set_locked(&rsa->_method_mod_n,
+		    CRYPTO_LOCK_RSA, rsa->n, ctx))
+			goto err;
+	}
+
+	/*
+	 * Several operations in a batch may use the same key, so the
+	 * unblinding factor is always stored outside the blinding.
+	 */
+	if (!(rsa->flags & RSA_FLAG_NO_BLINDING)) {
+		op->blinding = rsa_get_blinding(rsa, &local_blinding, ctx);
+		if (op->blinding == NULL) {
+			RSAerror(ERR_R_INTERNAL_ERROR);
+			goto err;
+		}
+		if (!rsa_blinding_convert(op->blinding, op->f, op->unblind,
+		    ctx))
+			goto err;
+	}
+
+	BN_init(&c);
+	BN_with_flags(&c, op->f, BN_FLG_CONSTTIME);
+
+	if (!BN_mod_ct(op->ret, &c, rsa->p, ctx))
+		goto err;
+	if (!BN_mod_ct(op->m1, &c, rsa->q, ctx))
+		goto err;
+
+	ret = 1;
+
+ err:
+	freezero(buf, op->num);
+
+	return ret;
+}
+
+static int
+rsa_eay_batch_op_finish(struct rsa_eay_batch_op *op, int padding,
+    BN_CTX *ctx)
+{
+	if (!rsa_eay_crt_combine(op->ret, op->m1, op->f, op->rsa, ctx))
+		return 0;
+
+	if (op->blinding != NULL) {
+		if (!rsa_blinding_invert(op->blinding, op->ret, op->unblind,
+		    ctx))
+			return 0;
+	}
+
+	return rsa_eay_private_encrypt_output(op->to, op->num, op->ret,
+	    op->f, op->rsa, padding);
+}
+
+static void
+rsa_eay_batch_run(struct rsa_eay_batch_op *ops, size_t num_ops, int padding)
+{
+	const BIGNUM *a[BN_MOD_EXP_MB_LANES];
+	const BIGNUM *p[BN_MOD_EXP_MB_LANES];
+	const BIGNUM *m[BN_MOD_EXP_MB_LANES];
+	BIGNUM *rr[BN_MOD_EXP_MB_LANES];
+	struct rsa_eay_batch_op *started[RSA_EAY_BATCH_MAX];
+	BN_CTX *ctx = NULL;
+	size_t i, n = 0;
+
+	if ((ctx = BN_CTX_new()) == NULL)
+		goto err;
+
+	BN_CTX_start(ctx);
+
+	for (i = 0; i < num_ops; i++) {
+		if (!rsa_eay_batch_op_start(&ops[i], padding, ctx))
+			continue;
+
+		a[2 * n] = rr[2 * n] = ops[i].ret;
+		p[2 * n] = ops[i].rsa->dmp1;
+		m[2 * n] = ops[i].rsa->p;
+		a[2 * n + 1] = rr[2 * n + 1] = ops[i].m1;
+		p[2 * n + 1] = ops[i].rsa->dmq1;
+		m[2 * n + 1] = ops[i].rsa->q;
+
+		started[n++] = &ops[i];
+	}
+
+	if (n == 0)
+		goto err;
+
+	if (!bn_mod_exp_mont_consttime_mb(rr, a, p, m, 2 * n, ctx))
+		goto err;
+
+	for (i = 0; i < n; i++) {
+		if (rsa_eay_batch_op_finish(started[i], padding, ctx))
+			*started[i]->out_len = started[i]->num;
+	}
+
+ err:
+	BN_CTX_end(ctx);
+	BN_CTX_free(ctx);
+}
+
+int
+rsa_eay_private_encrypt_batch(size_t num, const int *flen,
+    const unsigned char *const *from, unsigned char *const *to,
+    RSA *const *rsa, int padding, int *out_len)
+{
+	struct rsa_eay_batch_op ops[RSA_EAY_BATCH_MAX];
+	int accelerated;
+	size_t i, n = 0;
+	int ret = 1;
+
+	accelerated = bn_mod_exp_mb_accelerated();
+
+	for (i = 0; i < num; i++) {
+		out_len[i] = -1;
+
+		if (!accelerated || !rsa_eay_batchable(rsa[i])) {
+			out_len[i] = RSA_private_encrypt(flen[i], from[i],
+			    to[i], rsa[i], padding);
+			continue;
+		}
+
+		memset(&ops[n], 0, sizeof(ops[n]));
+		ops[n].rsa = rsa[i];
+		ops[n].flen = flen[i];
+		ops[n].from = from[i];
+		ops[n].to = to[i];
+		ops[n].out_len = &out_len[i];
+
+		if (++n == RSA_EAY_BATCH_MAX) {
+			rsa_eay_batch_run(ops, n, padding);
+			n = 0;
+		}
+	}
+
+	if (n >= RSA_EAY_BATCH_MIN) {
+		rsa_eay_batch_run(ops, n, padding);
+	} else {
+		for (i = 0; i < n; i++) {
+			*ops[i].out_len = RSA_private_encrypt(ops[i].flen,
+			    ops[i].from, ops[i].to, ops[i].rsa, padding);
+		}
+	}
+
+	for (i = 0; i < num; i++) {
+		if (out_len[i] <= 0)
+			ret = 0;
+	}
+
+	return ret;
+}
+
 static int
 RSA_eay_init(RSA *rsa)
 {
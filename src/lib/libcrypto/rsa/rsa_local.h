@@ -91,4 +91,8 @@ extern int int_rsa_verify(int dtype, const unsigned char *m,
     unsigned int m_len, unsigned char *rm, size_t *prm_len,
     const unsigned char *sigbuf, size_t siglen, RSA *rsa);
 
+int rsa_eay_private_encrypt_batch(size_t num, const int *flen,
+    const unsigned char *const *from, unsigned char *const *to,
+    RSA *const *rsa, int padding, int *out_len);
+
 __END_HIDDEN_DECLS
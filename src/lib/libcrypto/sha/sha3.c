@@ -0,0 +1,251 @@
+/*	$OpenBSD$ */
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <endian.h>
+#include <string.h>
+
+#include <openssl/crypto.h>
+
+#include "crypto_internal.h"
+#include "sha3_internal.h"
+
+#define KECCAK_ROUNDS	24
+
+static const uint64_t keccak_round_constants[KECCAK_ROUNDS] = {
+	0x0000000000000001ULL, 0x0000000000008082ULL,
+	0x800000000000808aULL, 0x8000000080008000ULL,
+	0x000000000000808bULL, 0x0000000080000001ULL,
+	0x8000000080008081ULL, 0x8000000000008009ULL,
+	0x000000000000008aULL, 0x0000000000000088ULL,
+	0x0000000080008009ULL, 0x000000008000000aULL,
+	0x000000008000808bULL, 0x800000000000008bULL,
+	0x8000000000008089ULL, 0x8000000000008003ULL,
+	0x8000000000008002ULL, 0x8000000000000080ULL,
+	0x000000000000800aULL, 0x800000008000000aULL,
+	0x8000000080008081ULL, 0x8000000000008080ULL,
+	0x0000000080000001ULL, 0x8000000080008008ULL,
+};
+
+static void
+keccak_f1600(uint64_t st[25])
+{
+	uint64_t b[25], c[5], d[5];
+	size_t i, r;
+
+	for (r = 0; r < KECCAK_ROUNDS; r++) {
+		/* Theta. */
+		for (i = 0; i < 5; i++)
+			c[i] = st[i] ^ st[i + 5] ^ st[i + 10] ^ st[i + 15] ^
+			    st[i + 20];
+		d[0] = c[4] ^ crypto_rol_u64(c[1], 1);
+		d[1] = c[0] ^ crypto_rol_u64(c[2], 1);
+		d[2] = c[1] ^ crypto_rol_u64(c[3], 1);
+		d[3] = c[2] ^ crypto_rol_u64(c[4], 1);
+		d[4] = c[3] ^ crypto_rol_u64(c[0], 1);
+
+		/* Rho and pi. */
+		b[0] = st[0] ^ d[0];
+		b[1] = crypto_rol_u64(st[6] ^ d[1], 44);
+		b[2] = crypto_rol_u64(st[12] ^ d[2], 43);
+		b[3] = crypto_rol_u64(st[18] ^ d[3], 21);
+		b[4] = crypto_rol_u64(st[24] ^ d[4], 14);
+		b[5] = crypto_rol_u64(st[3] ^ d[3], 28);
+		b[6] = crypto_rol_u64(st[9] ^ d[4], 20);
+		b[7] = crypto_rol_u64(st[10] ^ d[0], 3);
+		b[8] = crypto_rol_u64(st[16] ^ d[1], 45);
+		b[9] = crypto_rol_u64(st[22] ^ d[2], 61);
+		b[10] = crypto_rol_u64(st[1] ^ d[1], 1);
+		b[11] = crypto_rol_u64(st[7] ^ d[2], 6);
+		b[12] = crypto_rol_u64(st[13] ^ d[3], 25);
+		b[13] = crypto_rol_u64(st[19] ^ d[4], 8);
+		b[14] = crypto_rol_u64(st[20] ^ d[0], 18);
+		b[15] = crypto_rol_u64(st[4] ^ d[4], 27);
+		b[16] = crypto_rol_u64(st[5] ^ d[0], 36);
+		b[17] = crypto_rol_u64(st[11] ^ d[1], 10);
+		b[18] = crypto_rol_u64(st[17] ^ d[2], 15);
+		b[19] = crypto_rol_u64(st[23] ^ d[3], 56);
+		b[20] = crypto_rol_u64(st[2] ^ d[2], 62);
+		b[21] = crypto_rol_u64(st[8] ^ d[3], 55);
+		b[22] = crypto_rol_u64(st[14] ^ d[4], 39);
+		b[23] = crypto_rol_u64(st[15] ^ d[0], 41);
+		b[24] = crypto_rol_u64(st[21] ^ d[1], 2);
+
+		/* Chi. */
+		for (i = 0; i < 25; i += 5) {
+			st[i] = b[i] ^ (~b[i + 1] & b[i + 2]);
+			st[i + 1] = b[i + 1] ^ (~b[i + 2] & b[i + 3]);
+			st[i + 2] = b[i + 2] ^ (~b[i + 3] & b[i + 4]);
+			st[i + 3] = b[i + 3] ^ (~b[i + 4] & b[i]);
+			st[i + 4] = b[i + 4] ^ (~b[i] & b[i + 1]);
+		}
+
+		/* Iota. */
+		st[0] ^= keccak_round_constants[r];
+	}
+}
+
+static inline void
+keccak_xor_byte(uint64_t st[25], size_t pos, uint8_t b)
+{
+	st[pos / 8] ^= (uint64_t)b << (8 * (pos % 8));
+}
+
+static inline uint8_t
+keccak_get_byte(const uint64_t st[25], size_t pos)
+{
+	return st[pos / 8] >> (8 * (pos % 8));
+}
+
+static void
+keccak_absorb_block(uint64_t st[25], const uint8_t *in, size_t rate)
+{
+	uint64_t v;
+	size_t i;
+
+	for (i = 0; i < rate / 8; i++) {
+		memcpy(&v, &in[i * 8], sizeof(v));
+		st[i] ^= le64toh(v);
+	}
+	keccak_f1600(st);
+}
+
+static void
+keccak_squeeze_block(const uint64_t st[25], uint8_t *out, size_t rate)
+{
+	uint64_t v;
+	size_t i;
+
+	for (i = 0; i < rate / 8; i++) {
+		v = htole64(st[i]);
+		memcpy(&out[i * 8], &v, sizeof(v));
+	}
+}
+
+int
+sha3_init(sha3_ctx *ctx, size_t md_len)
+{
+	if (md_len == 0 || 2 * md_len >= KECCAK_BYTE_WIDTH)
+		return 0;
+
+	memset(ctx, 0, sizeof(*ctx));
+
+	ctx->md_len = md_len;
+	ctx->rate = KECCAK_BYTE_WIDTH - 2 * md_len;
+
+	return 1;
+}
+
+int
+sha3_update(sha3_ctx *ctx, const void *_data, size_t len)
+{
+	const uint8_t *data = _data;
+
+	while (len > 0 && ctx->pos != 0) {
+		keccak_xor_byte(ctx->state, ctx->pos++, *data++);
+		len--;
+		if (ctx->pos == ctx->rate) {
+			keccak_f1600(ctx->state);
+			ctx->pos = 0;
+		}
+	}
+
+	while (len >= ctx->rate) {
+		keccak_absorb_block(ctx->state, data, ctx->rate);
+		data += ctx->rate;
+		len -= ctx->rate;
+	}
+
+	while (len > 0) {
+		keccak_xor_byte(ctx->state, ctx->pos++, *data++);
+		len--;
+	}
+
+	return 1;
+}
+
+int
+sha3_final(uint8_t *md, sha3_ctx *ctx)
+{
+	size_t i;
+
+	keccak_xor_byte(ctx->state, ctx->pos, 0x06);
+	keccak_xor_byte(ctx->state, ctx->rate - 1, 0x80);
+	keccak_f1600(ctx->state);
+
+	for (i = 0; i < ctx->md_len; i++)
+		md[i] = keccak_get_byte(ctx->state, i);
+
+	explicit_bzero(ctx, sizeof(*ctx));
+
+	return 1;
+}
+
+int
+sha3(const void *in, size_t in_len, uint8_t *md, size_t md_len)
+{
+	sha3_ctx ctx;
+
+	if (!sha3_init(&ctx, md_len))
+		return 0;
+	if (!sha3_update(&ctx, in, in_len))
+		return 0;
+
+	return sha3_final(md, &ctx);
+}
+
+void
+shake_xof(sha3_ctx *ctx)
+{
+	keccak_xor_byte(ctx->state, ctx->pos, 0x1f);
+	keccak_xor_byte(ctx->state, ctx->rate - 1, 0x80);
+	keccak_f1600(ctx->state);
+	ctx->pos = 0;
+}
+
+void
+shake_out(sha3_ctx *ctx, uint8_t *out, size_t len)
+{
+	size_t n;
+
+	while (len > 0) {
+		if (ctx->pos == ctx->rate) {
+			keccak_f1600(ctx->state);
+			ctx->pos = 0;
+		}
+		if (ctx->pos == 0 && len >= ctx->rate) {
+			n = len / ctx->rate;
+			shake_out_blocks(ctx, out, n);
+			out += n * ctx->rate;
+			len -= n * ctx->rate;
+			continue;
+		}
+		*out++ = keccak_get_byte(ctx->state, ctx->pos++);
+		len--;
+	}
+}
+
+void
+shake_out_blocks(sha3_ctx *ctx, uint8_t *out, size_t num_blocks)
+{
+	while (num_blocks-- > 0) {
+		if (ctx->pos == ctx->rate)
+			keccak_f1600(ctx->state);
+		keccak_squeeze_block(ctx->state, out, ctx->rate);
+		out += ctx->rate;
+		ctx->pos = ctx->rate;
+	}
+}
@@ -0,0 +1,76 @@
+/*	$OpenBSD$ */
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef HEADER_SHA3_INTERNAL_H
+#define HEADER_SHA3_INTERNAL_H
+
+__BEGIN_HIDDEN_DECLS
+
+#define KECCAK_BYTE_WIDTH	200
+
+#define SHA3_224_BLOCK_SIZE	144
+#define SHA3_256_BLOCK_SIZE	136
+#define SHA3_384_BLOCK_SIZE	104
+#define SHA3_512_BLOCK_SIZE	72
+
+#define SHAKE128_BLOCK_SIZE	168
+#define SHAKE256_BLOCK_SIZE	136
+
+/*
+ * Keccak state, as used by the SHA-3 hash functions and the SHAKE extendable
+ * output functions (FIPS 202).
+ */
+typedef struct sha3_ctx_st {
+	uint64_t state[KECCAK_BYTE_WIDTH / 8];
+	size_t pos;
+	size_t rate;
+	size_t md_len;
+} sha3_ctx;
+
+/*
+ * sha3_init initialises ctx for SHA3 with a digest length of md_len bytes,
+ * or for SHAKE with a security strength of md_len * 4 bits.
+ */
+int sha3_init(sha3_ctx *ctx, size_t md_len);
+int sha3_update(sha3_ctx *ctx, const void *data, size_t len);
+int sha3_final(uint8_t *md, sha3_ctx *ctx);
+
+int sha3(const void *in, size_t in_len, uint8_t *md, size_t md_len);
+
+#define shake128_init(ctx)	sha3_init((ctx), 16)
+#define shake256_init(ctx)	sha3_init((ctx), 32)
+#define shake_update		sha3_update
+
+/*
+ * shake_xof finalises the absorption of input, after which shake_out may be
+ * called any number of times to squeeze output from ctx.
+ */
+void shake_xof(sha3_ctx *ctx);
+void shake_out(sha3_ctx *ctx, uint8_t *out, size_t len);
+
+/*
+ * shake_out_blocks squeezes num_blocks complete blocks of the rate of ctx
+ * directly into out. It must only be called at a block boundary.
+ */
+void shake_out_blocks(sha3_ctx *ctx, uint8_t *out, size_t num_blocks);
+
+__END_HIDDEN_DECLS
+
+#endif
@@ -104,7 +104,7 @@ OPENSSL_ia32_cpuid:
 	mov	\$1,%eax
 	cpuid
 	# force reserved bits to 0
-	and	\$(~(IA32CAP_MASK0_INTELP4 | IA32CAP_MASK0_INTEL)),%edx
+	and	\$(~(IA32CAP_MASK0_INTELP4 | IA32CAP_MASK0_INTEL | IA32CAP_MASK0_VAES512)),%edx
 	cmp	\$0,%r9d
 	jne	.Lnotintel
 	# set reserved bit#30 on Intel CPUs
@@ -131,15 +131,47 @@ OPENSSL_ia32_cpuid:
 	and	\$IA32CAP_MASK1_AMD_XOP,%r9d	# isolate AMD XOP flag
 	and	\$(~IA32CAP_MASK1_AMD_XOP),%ecx
 	or	%ecx,%r9d		# merge AMD XOP flag
+	and	\$(~IA32CAP_MASK1_AVX512IFMA),%r9d	# force reserved bit to 0
 
 	mov	%edx,%r10d		# %r9d:%r10d is copy of %ecx:%edx
+	and	\$(~IA32CAP_MASK0_VAES512),%r10d	# force reserved bit to 0
 	bt	\$IA32CAP_BIT1_OSXSAVE,%r9d	# check OSXSAVE bit
 	jnc	.Lclear_avx
 	xor	%ecx,%ecx		# XCR0
 	.byte	0x0f,0x01,0xd0		# xgetbv
+	mov	%eax,%edx
 	and	\$6,%eax		# isolate XMM and YMM state support
 	cmp	\$6,%eax
-	je	.Ldone
+	jne	.Lclear_avx
+
+	# set reserved bit#10 if AVX-512 state is enabled (opmask, ZMM0-15
+	# upper halves, ZMM16-31) and AVX-512F, AVX-512BW, AVX-512VL, VAES
+	# and VPCLMULQDQ are all supported
+	and	\$0xe0,%edx
+	cmp	\$0xe0,%edx
+	jne	.Ldone
+	cmp	\$7,%r11d
+	jb	.Ldone
+	mov	\$7,%eax
+	xor	%ecx,%ecx
+	cpuid
+
+	# set reserved bit#16 of the high word if AVX-512F and AVX-512 IFMA
+	# are supported
+	mov	%ebx,%eax
+	and	\$0x00210000,%eax	# AVX-512F, AVX-512 IFMA
+	cmp	\$0x00210000,%eax
+	jne	.Lno_ifma
+	or	\$IA32CAP_MASK1_AVX512IFMA,%r9d
+.Lno_ifma:
+	and	\$0xc0010000,%ebx	# AVX-512F, AVX-512BW, AVX-512VL
+	cmp	\$0xc0010000,%ebx
+	jne	.Ldone
+	and	\$0x600,%ecx		# VAES, VPCLMULQDQ
+	cmp	\$0x600,%ecx
+	jne	.Ldone
+	or	\$IA32CAP_MASK0_VAES512,%r10d
+	jmp	.Ldone
 .Lclear_avx:
 	mov	\$(~(IA32CAP_MASK1_AVX | IA32CAP_MASK1_FMA3 | IA32CAP_MASK1_AMD_XOP)),%eax
 	and	%eax,%r9d		# clear AVX, FMA and AMD XOP bits
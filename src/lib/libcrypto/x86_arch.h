@@ -50,6 +50,7 @@
 /* the following bits are not obtained from cpuid */
 #define	IA32CAP_BIT0_INTELP4	20
 #define	IA32CAP_BIT0_INTEL	30
+#define	IA32CAP_BIT0_VAES512	10	/* AVX-512 with VAES and VPCLMULQDQ */
 
 /* bit numbers for the high word */
 #define	IA32CAP_BIT1_PCLMUL	1
@@ -61,6 +62,9 @@
 
 #define	IA32CAP_BIT1_AMD_XOP	11
 
+/* the following bits are not obtained from cpuid */
+#define	IA32CAP_BIT1_AVX512IFMA	16	/* AVX-512F with AVX-512 IFMA */
+
 /* bit masks for the low word */
 #define	IA32CAP_MASK0_MMX	(1 << IA32CAP_BIT0_MMX)
 #define	IA32CAP_MASK0_FXSR	(1 << IA32CAP_BIT0_FXSR)
@@ -70,6 +74,7 @@
 
 #define	IA32CAP_MASK0_INTELP4	(1 << IA32CAP_BIT0_INTELP4)
 #define	IA32CAP_MASK0_INTEL	(1 << IA32CAP_BIT0_INTEL)
+#define	IA32CAP_MASK0_VAES512	(1 << IA32CAP_BIT0_VAES512)
 
 /* bit masks for the high word */
 #define	IA32CAP_MASK1_PCLMUL	(1 << IA32CAP_BIT1_PCLMUL)
@@ -80,11 +85,17 @@
 
 #define	IA32CAP_MASK1_AMD_XOP	(1 << IA32CAP_BIT1_AMD_XOP)
 
+#define	IA32CAP_MASK1_AVX512IFMA	(1 << IA32CAP_BIT1_AVX512IFMA)
+
 /* bit masks for OPENSSL_cpu_caps() */
 #define	CPUCAP_MASK_MMX		IA32CAP_MASK0_MMX
 #define	CPUCAP_MASK_FXSR	IA32CAP_MASK0_FXSR
 #define	CPUCAP_MASK_SSE		IA32CAP_MASK0_SSE
 #define	CPUCAP_MASK_INTELP4	IA32CAP_MASK0_INTELP4
+#define	CPUCAP_MASK_INTEL	IA32CAP_MASK0_INTEL
+#define	CPUCAP_MASK_VAES512	IA32CAP_MASK0_VAES512
 #define	CPUCAP_MASK_PCLMUL	(1ULL << (32 + IA32CAP_BIT1_PCLMUL))
 #define	CPUCAP_MASK_SSSE3	(1ULL << (32 + IA32CAP_BIT1_SSSE3))
 #define	CPUCAP_MASK_AESNI	(1ULL << (32 + IA32CAP_BIT1_AESNI))
+#define	CPUCAP_MASK_AVX		(1ULL << (32 + IA32CAP_BIT1_AVX))
+#define	CPUCAP_MASK_AVX512IFMA	(1ULL << (32 + IA32CAP_BIT1_AVX512IFMA))
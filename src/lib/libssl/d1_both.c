@@ -250,8 +250,17 @@ dtls1_do_write(SSL *s, int type)
 		    DTLS1_RT_HEADER_LENGTH - overhead;
 
 		if (curr_mtu <= DTLS1_HM_HEADER_LENGTH) {
+			/*
+			 * Complete the current datagram - a datagram BIO that
+			 * batches writes defers sending it until the flight
+			 * is flushed.
+			 */
+			(void)BIO_ctrl(SSL_get_wbio(s),
+			    BIO_CTRL_DGRAM_DEFER_FLUSH, 1, NULL);
 			/* grr.. we could get an error if MTU picked was wrong */
 			ret = BIO_flush(SSL_get_wbio(s));
+			(void)BIO_ctrl(SSL_get_wbio(s),
+			    BIO_CTRL_DGRAM_DEFER_FLUSH, 0, NULL);
 			if (ret <= 0)
 				return ret;
 			curr_mtu = s->d1->mtu - DTLS1_RT_HEADER_LENGTH -
@@ -932,6 +941,12 @@ dtls1_retransmit_buffered_messages(SSL *s)
 		}
 	}
 
+	/* Flush the flight as a whole, so that it may be sent in one batch. */
+	if (BIO_flush(SSL_get_wbio(s)) <= 0) {
+		s->rwstate = SSL_WRITING;
+		return -1;
+	}
+
 	return 1;
 }
 
@@ -1058,7 +1073,6 @@ dtls1_retransmit_message(SSL *s, unsigned short seq, unsigned long frag_off,
 
 	s->d1->retransmitting = 0;
 
-	(void)BIO_flush(SSL_get_wbio(s));
 	return ret;
 }
 
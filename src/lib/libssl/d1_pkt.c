@@ -963,7 +963,23 @@ dtls1_write_app_data_bytes(SSL *s, int type, const void *buf_, int len)
 		return -1;
 	}
 
-	i = dtls1_write_bytes(s, type, buf_, len);
+	/*
+	 * A datagram BIO that batches writes holds the record until it is
+	 * flushed. If flushing would block, the record has already been
+	 * written, so only the flush is repeated when the write is retried.
+	 */
+	if ((i = s->s3->wnum) == 0) {
+		if ((i = dtls1_write_bytes(s, type, buf_, len)) <= 0)
+			return i;
+	}
+	s->s3->wnum = 0;
+
+	if (BIO_flush(s->wbio) <= 0) {
+		s->rwstate = SSL_WRITING;
+		s->s3->wnum = i;
+		return -1;
+	}
+
 	return i;
 }
 
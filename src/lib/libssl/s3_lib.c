@@ -1578,7 +1578,10 @@ ssl3_free(SSL *s)
 
 	tls_buffer_free(s->s3->hs.tls13.quic_read_buffer);
 
+	free(s->s3->hs.tls13.cert_comp_algs);
+
 	sk_X509_NAME_pop_free(s->s3->hs.tls12.ca_names, X509_NAME_free);
+	free(s->s3->hs.tls12.server_kex_params);
 	sk_X509_pop_free(s->verified_chain, X509_free);
 
 	tls1_transcript_free(s);
@@ -1602,6 +1605,7 @@ ssl3_clear(SSL *s)
 
 	tls1_cleanup_key_block(s);
 	sk_X509_NAME_pop_free(s->s3->hs.tls12.ca_names, X509_NAME_free);
+	free(s->s3->hs.tls12.server_kex_params);
 	sk_X509_pop_free(s->verified_chain, X509_free);
 	s->verified_chain = NULL;
 
@@ -1634,6 +1638,11 @@ ssl3_clear(SSL *s)
 	s->s3->hs.tls13.quic_read_level = ssl_encryption_initial;
 	s->s3->hs.tls13.quic_write_level = ssl_encryption_initial;
 
+	free(s->s3->hs.tls13.cert_comp_algs);
+	s->s3->hs.tls13.cert_comp_algs = NULL;
+	s->s3->hs.tls13.cert_comp_algs_len = 0;
+	s->s3->hs.tls13.cert_comp_alg = 0;
+
 	s->s3->hs.extensions_seen = 0;
 
 	rp = s->s3->rbuf.buf;
@@ -1770,6 +1779,7 @@ static int
 _SSL_set_tmp_dh(SSL *s, DH *dh)
 {
 	DH *dhe_params;
+	SSL_CERT *cert;
 
 	if (dh == NULL) {
 		SSLerror(s, ERR_R_PASSED_NULL_PARAMETER);
@@ -1786,8 +1796,13 @@ _SSL_set_tmp_dh(SSL *s, DH *dh)
 		return 0;
 	}
 
-	DH_free(s->cert->dhe_params);
-	s->cert->dhe_params = dhe_params;
+	if ((cert = ssl_get0_cert(NULL, s)) == NULL) {
+		DH_free(dhe_params);
+		return 0;
+	}
+
+	DH_free(cert->dhe_params);
+	cert->dhe_params = dhe_params;
 
 	return 1;
 }
@@ -1795,7 +1810,12 @@ _SSL_set_tmp_dh(SSL *s, DH *dh)
 static int
 _SSL_set_dh_auto(SSL *s, int state)
 {
-	s->cert->dhe_params_auto = state;
+	SSL_CERT *cert;
+
+	if ((cert = ssl_get0_cert(NULL, s)) == NULL)
+		return 0;
+
+	cert->dhe_params_auto = state;
 	return 1;
 }
 
@@ -1981,6 +2001,33 @@ SSL_set1_groups_list(SSL *s, const char *groups)
 	    &s->tlsext_supportedgroups_length, groups);
 }
 
+int
+SSL_set_key_share_group(SSL *s, int nid)
+{
+	uint16_t group_id = 0;
+
+	if (nid != NID_undef && !tls1_ec_nid2group_id(nid, &group_id))
+		return 0;
+
+	s->key_share_group = group_id;
+
+	return 1;
+}
+
+int
+SSL_get_negotiated_group(const SSL *s)
+{
+	int nid;
+
+	if (s->s3->hs.key_share == NULL)
+		return NID_undef;
+	if (!tls1_ec_group_id2nid(tls_key_share_group(s->s3->hs.key_share),
+	    &nid))
+		return NID_undef;
+
+	return nid;
+}
+
 static int
 _SSL_get_signature_nid(SSL *s, int *nid)
 {
@@ -2185,13 +2232,17 @@ ssl3_ctrl(SSL *s, int cmd, long larg, void *parg)
 long
 ssl3_callback_ctrl(SSL *s, int cmd, void (*fp)(void))
 {
+	SSL_CERT *cert;
+
 	switch (cmd) {
 	case SSL_CTRL_SET_TMP_RSA_CB:
 		SSLerror(s, ERR_R_SHOULD_NOT_HAVE_BEEN_CALLED);
 		return 0;
 
 	case SSL_CTRL_SET_TMP_DH_CB:
-		s->cert->dhe_params_cb = (DH *(*)(SSL *, int, int))fp;
+		if ((cert = ssl_get0_cert(NULL, s)) == NULL)
+			return 0;
+		cert->dhe_params_cb = (DH *(*)(SSL *, int, int))fp;
 		return 1;
 
 	case SSL_CTRL_SET_TMP_ECDH_CB:
@@ -2210,6 +2261,7 @@ static int
 _SSL_CTX_set_tmp_dh(SSL_CTX *ctx, DH *dh)
 {
 	DH *dhe_params;
+	SSL_CERT *cert;
 
 	if (dh == NULL) {
 		SSLerrorx(ERR_R_PASSED_NULL_PARAMETER);
@@ -2226,8 +2278,13 @@ _SSL_CTX_set_tmp_dh(SSL_CTX *ctx, DH *dh)
 		return 0;
 	}
 
-	DH_free(ctx->cert->dhe_params);
-	ctx->cert->dhe_params = dhe_params;
+	if ((cert = ssl_get0_cert(ctx, NULL)) == NULL) {
+		DH_free(dhe_params);
+		return 0;
+	}
+
+	DH_free(cert->dhe_params);
+	cert->dhe_params = dhe_params;
 
 	return 1;
 }
@@ -2235,7 +2292,12 @@ _SSL_CTX_set_tmp_dh(SSL_CTX *ctx, DH *dh)
 static int
 _SSL_CTX_set_dh_auto(SSL_CTX *ctx, int state)
 {
-	ctx->cert->dhe_params_auto = state;
+	SSL_CERT *cert;
+
+	if ((cert = ssl_get0_cert(ctx, NULL)) == NULL)
+		return 0;
+
+	cert->dhe_params_auto = state;
 	return 1;
 }
 
@@ -2516,13 +2578,17 @@ ssl3_ctx_ctrl(SSL_CTX *ctx, int cmd, long larg, void *parg)
 long
 ssl3_ctx_callback_ctrl(SSL_CTX *ctx, int cmd, void (*fp)(void))
 {
+	SSL_CERT *cert;
+
 	switch (cmd) {
 	case SSL_CTRL_SET_TMP_RSA_CB:
 		SSLerrorx(ERR_R_SHOULD_NOT_HAVE_BEEN_CALLED);
 		return 0;
 
 	case SSL_CTRL_SET_TMP_DH_CB:
-		ctx->cert->dhe_params_cb =
+		if ((cert = ssl_get0_cert(ctx, NULL)) == NULL)
+			return 0;
+		cert->dhe_params_cb =
 		    (DH *(*)(SSL *, int, int))fp;
 		return 1;
 
@@ -2560,10 +2626,16 @@ ssl3_choose_cipher(SSL *s, STACK_OF(SSL_CIPHER) *clnt,
 	SSL_CIPHER *c, *ret = NULL;
 	int can_use_ecc;
 	int i, ii, nid, ok;
-	SSL_CERT *cert;
 
 	/* Let's see which ciphers we can support */
-	cert = s->cert;
+	ssl_cert_masks(s->cert, &mask_k, &mask_a);
+
+	/*
+	 * The private key method only provides signatures, hence key exchanges
+	 * that decrypt with the private key cannot be used with it.
+	 */
+	if (s->private_key_method != NULL)
+		mask_k &= ~(SSL_kRSA|SSL_kGOST);
 
 	can_use_ecc = tls1_get_supported_group(s, &nid);
 
@@ -2603,10 +2675,6 @@ ssl3_choose_cipher(SSL *s, STACK_OF(SSL_CIPHER) *clnt,
 		if (!ssl_security_shared_cipher(s, c))
 			continue;
 
-		ssl_set_cert_masks(cert, c);
-		mask_k = cert->mask_k;
-		mask_a = cert->mask_a;
-
 		alg_k = c->algorithm_mkey;
 		alg_a = c->algorithm_auth;
 
@@ -649,18 +649,65 @@ void SSL_get0_alpn_selected(const SSL *ssl, const unsigned char **data,
 typedef int (*SSL_psk_use_session_cb_func)(SSL *ssl, const EVP_MD *md,
     const unsigned char **id, size_t *idlen, SSL_SESSION **sess);
 void SSL_set_psk_use_session_callback(SSL *s, SSL_psk_use_session_cb_func cb);
+
+typedef int (*SSL_cert_compress_func)(SSL *ssl, uint8_t **out,
+    size_t *out_len, const uint8_t *in, size_t in_len);
+typedef int (*SSL_cert_decompress_func)(SSL *ssl, uint8_t *out,
+    size_t out_len, const uint8_t *in, size_t in_len);
+int SSL_CTX_add_cert_compression_alg(SSL_CTX *ctx, uint16_t alg_id,
+    SSL_cert_compress_func compress, SSL_cert_decompress_func decompress);
 #endif
 
+enum ssl_private_key_result_t {
+	ssl_private_key_success,
+	ssl_private_key_retry,
+	ssl_private_key_failure,
+};
+
+typedef struct ssl_private_key_method_st {
+	enum ssl_private_key_result_t (*sign)(SSL *ssl, uint8_t *out,
+	    size_t *out_len, size_t max_out, uint16_t signature_algorithm,
+	    const uint8_t *in, size_t in_len);
+	enum ssl_private_key_result_t (*complete)(SSL *ssl, uint8_t *out,
+	    size_t *out_len, size_t max_out);
+} SSL_PRIVATE_KEY_METHOD;
+
+void SSL_CTX_set_private_key_method(SSL_CTX *ctx,
+    const SSL_PRIVATE_KEY_METHOD *key_method);
+void SSL_set_private_key_method(SSL *ssl,
+    const SSL_PRIVATE_KEY_METHOD *key_method);
+
+enum ssl_ticket_aead_result_t {
+	ssl_ticket_aead_success,
+	ssl_ticket_aead_renew,
+	ssl_ticket_aead_ignore_ticket,
+	ssl_ticket_aead_error,
+};
+
+typedef struct ssl_ticket_aead_method_st {
+	size_t (*max_overhead)(SSL *ssl);
+	int (*seal)(SSL *ssl, uint8_t *out, size_t *out_len, size_t max_out,
+	    const uint8_t *in, size_t in_len);
+	enum ssl_ticket_aead_result_t (*open)(SSL *ssl, uint8_t *out,
+	    size_t *out_len, size_t max_out, const uint8_t *in, size_t in_len);
+} SSL_TICKET_AEAD_METHOD;
+
+void SSL_CTX_set_ticket_aead_method(SSL_CTX *ctx,
+    const SSL_TICKET_AEAD_METHOD *aead_method);
+
 #define SSL_NOTHING	1
 #define SSL_WRITING	2
 #define SSL_READING	3
 #define SSL_X509_LOOKUP	4
+#define SSL_PRIVATE_KEY_OPERATION	9
 
 /* These will only be used when doing non-blocking IO */
 #define SSL_want_nothing(s)	(SSL_want(s) == SSL_NOTHING)
 #define SSL_want_read(s)	(SSL_want(s) == SSL_READING)
 #define SSL_want_write(s)	(SSL_want(s) == SSL_WRITING)
 #define SSL_want_x509_lookup(s)	(SSL_want(s) == SSL_X509_LOOKUP)
+#define SSL_want_private_key_operation(s) \
+	(SSL_want(s) == SSL_PRIVATE_KEY_OPERATION)
 
 #define SSL_MAC_FLAG_READ_MAC_STREAM 1
 #define SSL_MAC_FLAG_WRITE_MAC_STREAM 2
@@ -839,6 +886,7 @@ int PEM_write_SSL_SESSION(FILE *fp, SSL_SESSION *x);
 #define SSL_ERROR_WANT_ASYNC			9
 #define SSL_ERROR_WANT_ASYNC_JOB		10
 #define SSL_ERROR_WANT_CLIENT_HELLO_CB		11
+#define SSL_ERROR_WANT_PRIVATE_KEY_OPERATION	13
 
 #define SSL_CTRL_NEED_TMP_RSA			1
 #define SSL_CTRL_SET_TMP_RSA			2
@@ -1023,6 +1071,9 @@ int SSL_CTX_set1_groups_list(SSL_CTX *ctx, const char *groups);
 int SSL_set1_groups(SSL *ssl, const int *groups, size_t groups_len);
 int SSL_set1_groups_list(SSL *ssl, const char *groups);
 
+int SSL_set_key_share_group(SSL *ssl, int nid);
+int SSL_get_negotiated_group(const SSL *ssl);
+
 int SSL_CTX_get_min_proto_version(SSL_CTX *ctx);
 int SSL_CTX_get_max_proto_version(SSL_CTX *ctx);
 int SSL_CTX_set_min_proto_version(SSL_CTX *ctx, uint16_t version);
@@ -1098,6 +1149,8 @@ int SSL_get_peer_signature_type_nid(const SSL *ssl, int *nid);
 #define SSL_CTX_set1_groups_list	SSL_CTX_set1_groups_list
 #define SSL_set1_groups			SSL_set1_groups
 #define SSL_set1_groups_list		SSL_set1_groups_list
+#define SSL_set_key_share_group		SSL_set_key_share_group
+#define SSL_get_negotiated_group	SSL_get_negotiated_group
 
 #define SSL_CTX_get_min_proto_version	SSL_CTX_get_min_proto_version
 #define SSL_CTX_get_max_proto_version	SSL_CTX_get_max_proto_version
@@ -2341,6 +2394,7 @@ void ERR_load_SSL_strings(void);
 #define SSL_R_PEER_BEHAVING_BADLY			 666
 #define SSL_R_QUIC_INTERNAL_ERROR			 667
 #define SSL_R_WRONG_ENCRYPTION_LEVEL_RECEIVED		 668
+#define SSL_R_PRIVATE_KEY_OPERATION_FAILED		 669
 #define SSL_R_UNKNOWN					 999
 
 /*
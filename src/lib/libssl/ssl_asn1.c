@@ -44,8 +44,7 @@ time_max(void)
 }
 
 static int
-SSL_SESSION_encode(SSL_SESSION *s, unsigned char **out, size_t *out_len,
-    int ticket_encoding)
+SSL_SESSION_encode(SSL_SESSION *s, unsigned char **out, size_t *out_len)
 {
 	CBB cbb, session, cipher_suite, session_id, master_key, time, timeout;
 	CBB peer_cert, sidctx, verify_result, hostname, lifetime, ticket, value;
@@ -79,11 +78,10 @@ SSL_SESSION_encode(SSL_SESSION *s, unsigned char **out, size_t *out_len,
 	if (!CBB_add_u16(&cipher_suite, cid))
 		goto err;
 
-	/* Session ID - zero length for a ticket. */
+	/* Session ID. */
 	if (!CBB_add_asn1(&session, &session_id, CBS_ASN1_OCTETSTRING))
 		goto err;
-	if (!CBB_add_bytes(&session_id, s->session_id,
-	    ticket_encoding ? 0 : s->session_id_length))
+	if (!CBB_add_bytes(&session_id, s->session_id, s->session_id_length))
 		goto err;
 
 	/* Master key. */
@@ -190,8 +188,96 @@ SSL_SESSION_encode(SSL_SESSION *s, unsigned char **out, size_t *out_len,
 	return rv;
 }
 
+/*
+ * Session tickets are only ever parsed by the server that issued them, hence
+ * the session state is encoded using a compact, fixed layout rather than as
+ * ASN.1. The leading version byte cannot be confused with an ASN.1 SEQUENCE,
+ * which allows tickets that were issued using the ASN.1 encoding to continue
+ * to be accepted.
+ */
+static int
+SSL_SESSION_ticket_encode(SSL_SESSION *s, int include_peer_cert,
+    unsigned char **out, size_t *out_len)
+{
+	CBB cbb, master_key, sidctx, hostname, peer_cert;
+	unsigned char *peer_cert_bytes = NULL;
+	int len, rv = 0;
+	uint16_t cid;
+
+	if (!CBB_init(&cbb, 128))
+		goto err;
+
+	if (!CBB_add_u8(&cbb, SSL_SESSION_TICKET_VERSION))
+		goto err;
+
+	if (s->ssl_version < 0 || s->ssl_version > 0xffff)
+		goto err;
+	if (!CBB_add_u16(&cbb, s->ssl_version))
+		goto err;
+
+	cid = (uint16_t)(s->cipher_id & SSL3_CK_VALUE_MASK);
+	if (s->cipher != NULL)
+		cid = ssl3_cipher_get_value(s->cipher);
+	if (!CBB_add_u16(&cbb, cid))
+		goto err;
+
+	if (!CBB_add_u8_length_prefixed(&cbb, &master_key))
+		goto err;
+	if (!CBB_add_bytes(&master_key, s->master_key, s->master_key_length))
+		goto err;
+
+	if (s->time < 0 || s->timeout < 0)
+		goto err;
+	if (!CBB_add_u64(&cbb, s->time))
+		goto err;
+	if (!CBB_add_u64(&cbb, s->timeout))
+		goto err;
+
+	if (s->verify_result < 0 || s->verify_result > UINT32_MAX)
+		goto err;
+	if (!CBB_add_u32(&cbb, s->verify_result))
+		goto err;
+	if (!CBB_add_u32(&cbb, s->tlsext_tick_lifetime_hint))
+		goto err;
+
+	if (!CBB_add_u8_length_prefixed(&cbb, &sidctx))
+		goto err;
+	if (!CBB_add_bytes(&sidctx, s->sid_ctx, s->sid_ctx_length))
+		goto err;
+
+	if (!CBB_add_u16_length_prefixed(&cbb, &hostname))
+		goto err;
+	if (s->tlsext_hostname != NULL) {
+		if (!CBB_add_bytes(&hostname,
+		    (const uint8_t *)s->tlsext_hostname,
+		    strlen(s->tlsext_hostname)))
+			goto err;
+	}
+
+	if (!CBB_add_u24_length_prefixed(&cbb, &peer_cert))
+		goto err;
+	if (include_peer_cert && s->peer_cert != NULL) {
+		if ((len = i2d_X509(s->peer_cert, &peer_cert_bytes)) <= 0)
+			goto err;
+		if (!CBB_add_bytes(&peer_cert, peer_cert_bytes, len))
+			goto err;
+	}
+
+	if (!CBB_finish(&cbb, out, out_len))
+		goto err;
+
+	rv = 1;
+
+ err:
+	CBB_cleanup(&cbb);
+	free(peer_cert_bytes);
+
+	return rv;
+}
+
 int
-SSL_SESSION_ticket(SSL_SESSION *ss, unsigned char **out, size_t *out_len)
+SSL_SESSION_ticket(SSL_SESSION *ss, int include_peer_cert, unsigned char **out,
+    size_t *out_len)
 {
 	if (ss == NULL)
 		return 0;
@@ -199,7 +285,127 @@ SSL_SESSION_ticket(SSL_SESSION *ss, unsigned char **out, size_t *out_len)
 	if (ss->cipher == NULL && ss->cipher_id == 0)
 		return 0;
 
-	return SSL_SESSION_encode(ss, out, out_len, 1);
+	return SSL_SESSION_ticket_encode(ss, include_peer_cert, out, out_len);
+}
+
+static SSL_SESSION *
+SSL_SESSION_ticket_decode(CBS *cbs)
+{
+	CBS master_key, sidctx, hostname, peer_cert;
+	uint64_t stime, timeout;
+	uint32_t verify_result, lifetime;
+	uint16_t tls_version, cipher_value;
+	const unsigned char *peer_cert_bytes;
+	SSL_SESSION *s;
+	uint8_t version;
+
+	if ((s = SSL_SESSION_new()) == NULL) {
+		SSLerrorx(ERR_R_MALLOC_FAILURE);
+		return NULL;
+	}
+
+	if (!CBS_get_u8(cbs, &version))
+		goto err;
+	if (version != SSL_SESSION_TICKET_VERSION)
+		goto err;
+
+	if (!CBS_get_u16(cbs, &tls_version))
+		goto err;
+	s->ssl_version = tls_version;
+
+	if (!CBS_get_u16(cbs, &cipher_value))
+		goto err;
+	s->cipher = NULL;
+	s->cipher_id = SSL3_CK_ID | cipher_value;
+
+	if (!CBS_get_u8_length_prefixed(cbs, &master_key))
+		goto err;
+	if (!CBS_write_bytes(&master_key, s->master_key, sizeof(s->master_key),
+	    &s->master_key_length))
+		goto err;
+
+	if (!CBS_get_u64(cbs, &stime))
+		goto err;
+	if (stime > time_max())
+		goto err;
+	s->time = (time_t)stime;
+
+	if (!CBS_get_u64(cbs, &timeout))
+		goto err;
+	if (timeout > LONG_MAX)
+		goto err;
+	s->timeout = (long)timeout;
+
+	if (!CBS_get_u32(cbs, &verify_result))
+		goto err;
+	if (verify_result > LONG_MAX)
+		goto err;
+	s->verify_result = (long)verify_result;
+
+	if (!CBS_get_u32(cbs, &lifetime))
+		goto err;
+	s->tlsext_tick_lifetime_hint = lifetime;
+
+	if (!CBS_get_u8_length_prefixed(cbs, &sidctx))
+		goto err;
+	if (!CBS_write_bytes(&sidctx, s->sid_ctx, sizeof(s->sid_ctx),
+	    &s->sid_ctx_length))
+		goto err;
+
+	if (!CBS_get_u16_length_prefixed(cbs, &hostname))
+		goto err;
+	if (CBS_len(&hostname) > 0) {
+		if (CBS_contains_zero_byte(&hostname))
+			goto err;
+		if (!CBS_strdup(&hostname, &s->tlsext_hostname))
+			goto err;
+	}
+
+	if (!CBS_get_u24_length_prefixed(cbs, &peer_cert))
+		goto err;
+	if (CBS_len(&peer_cert) > 0) {
+		peer_cert_bytes = CBS_data(&peer_cert);
+		if (d2i_X509(&s->peer_cert, &peer_cert_bytes,
+		    (long)CBS_len(&peer_cert)) == NULL)
+			goto err;
+		if (peer_cert_bytes != CBS_data(&peer_cert) +
+		    CBS_len(&peer_cert))
+			goto err;
+	}
+
+	if (CBS_len(cbs) != 0)
+		goto err;
+
+	return s;
+
+ err:
+	SSL_SESSION_free(s);
+
+	return NULL;
+}
+
+/*
+ * Parse the session state from a decrypted session ticket, which is either in
+ * the compact ticket encoding or, for tickets issued by older versions, the
+ * ASN.1 encoding.
+ */
+SSL_SESSION *
+SSL_SESSION_from_ticket(const unsigned char *data, size_t data_len)
+{
+	CBS cbs;
+	uint8_t version;
+
+	CBS_init(&cbs, data, data_len);
+
+	if (!CBS_peek_u8(&cbs, &version))
+		return NULL;
+	if (version == CBS_ASN1_SEQUENCE) {
+		if (data_len > LONG_MAX)
+			return NULL;
+		return d2i_SSL_SESSION(NULL, &data, (long)data_len);
+	}
+
+	return SSL_SESSION_ticket_decode(&cbs);
 }
 
 int
@@ -215,7 +421,7 @@ i2d_SSL_SESSION(SSL_SESSION *ss, unsigned char **pp)
 	if (ss->cipher == NULL && ss->cipher_id == 0)
 		return 0;
 
-	if (!SSL_SESSION_encode(ss, &data, &data_len, 0))
+	if (!SSL_SESSION_encode(ss, &data, &data_len))
 		goto err;
 
 	if (data_len > INT_MAX)
@@ -191,6 +191,7 @@ int
 ssl3_output_cert_chain(SSL *s, CBB *cbb, SSL_CERT_PKEY *cpk)
 {
 	X509_STORE_CTX *xs_ctx = NULL;
+	struct ssl_cert_list *cl = NULL;
 	STACK_OF(X509) *chain;
 	CBB cert_list;
 	X509 *x;
@@ -208,8 +209,12 @@ ssl3_output_cert_chain(SSL *s, CBB *cbb, SSL_CERT_PKEY *cpk)
 		chain = s->ctx->extra_certs;
 
 	if (chain != NULL || (s->mode & SSL_MODE_NO_AUTO_CHAIN)) {
-		if (!ssl3_add_cert(&cert_list, cpk->x509))
+		/* Use the cached encoding of the configured chain. */
+		if ((cl = ssl_cert_list_get(s, cpk, chain)) == NULL)
 			goto err;
+		if (!CBB_add_bytes(&cert_list, cl->tls12, cl->tls12_len))
+			goto err;
+		goto done;
 	} else {
 		if ((xs_ctx = X509_STORE_CTX_new()) == NULL)
 			goto err;
@@ -239,6 +244,7 @@ ssl3_output_cert_chain(SSL *s, CBB *cbb, SSL_CERT_PKEY *cpk)
 
  err:
 	X509_STORE_CTX_free(xs_ctx);
+	ssl_cert_list_free(cl);
 
 	return (ret);
 }
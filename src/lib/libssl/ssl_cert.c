@@ -168,6 +168,10 @@ ssl_cert_new(void)
 		SSLerrorx(ERR_R_MALLOC_FAILURE);
 		return (NULL);
 	}
+	if (pthread_rwlock_init(&ret->cert_list_lock, NULL) != 0) {
+		free(ret);
+		return (NULL);
+	}
 	ret->key = &(ret->pkeys[SSL_PKEY_RSA]);
 	ret->references = 1;
 	ret->security_cb = ssl_security_default_cb;
@@ -187,6 +191,10 @@ ssl_cert_dup(SSL_CERT *cert)
 		SSLerrorx(ERR_R_MALLOC_FAILURE);
 		return (NULL);
 	}
+	if (pthread_rwlock_init(&ret->cert_list_lock, NULL) != 0) {
+		free(ret);
+		return (NULL);
+	}
 
 	/*
 	 * same as ret->key = ret->pkeys + (cert->key - cert->pkeys),
@@ -194,10 +202,6 @@ ssl_cert_dup(SSL_CERT *cert)
 	 */
 	ret->key = &ret->pkeys[cert->key - &cert->pkeys[0]];
 
-	ret->valid = cert->valid;
-	ret->mask_k = cert->mask_k;
-	ret->mask_a = cert->mask_a;
-
 	if (cert->dhe_params != NULL) {
 		ret->dhe_params = DHparams_dup(cert->dhe_params);
 		if (ret->dhe_params == NULL) {
@@ -247,6 +251,11 @@ ssl_cert_dup(SSL_CERT *cert)
 			    X509_chain_up_ref(cert->pkeys[i].chain)) == NULL)
 				goto err;
 		}
+
+		(void)pthread_rwlock_rdlock(&cert->cert_list_lock);
+		if ((ret->pkeys[i].cert_list = cert->pkeys[i].cert_list) != NULL)
+			ssl_cert_list_up_ref(ret->pkeys[i].cert_list);
+		(void)pthread_rwlock_unlock(&cert->cert_list_lock);
 	}
 
 	ret->security_cb = cert->security_cb;
@@ -269,7 +278,9 @@ ssl_cert_dup(SSL_CERT *cert)
 		X509_free(ret->pkeys[i].x509);
 		EVP_PKEY_free(ret->pkeys[i].privatekey);
 		sk_X509_pop_free(ret->pkeys[i].chain, X509_free);
+		ssl_cert_list_free(ret->pkeys[i].cert_list);
 	}
+	(void)pthread_rwlock_destroy(&ret->cert_list_lock);
 	free (ret);
 	return NULL;
 }
@@ -293,18 +304,34 @@ ssl_cert_free(SSL_CERT *c)
 		X509_free(c->pkeys[i].x509);
 		EVP_PKEY_free(c->pkeys[i].privatekey);
 		sk_X509_pop_free(c->pkeys[i].chain, X509_free);
+		ssl_cert_list_free(c->pkeys[i].cert_list);
 	}
 
+	(void)pthread_rwlock_destroy(&c->cert_list_lock);
+
 	free(c);
 }
 
+/*
+ * Return the SSL_CERT of the SSL or, if it is NULL, of the SSL_CTX, so that
+ * it may be modified. An SSL_CERT is shared by an SSL_CTX and its SSLs until
+ * one of them modifies it, at which point the modifier gets its own copy.
+ */
 SSL_CERT *
 ssl_get0_cert(SSL_CTX *ctx, SSL *ssl)
 {
-	if (ssl != NULL)
-		return ssl->cert;
+	SSL_CERT **cert = (ssl != NULL) ? &ssl->cert : &ctx->cert;
+	SSL_CERT *new_cert;
+
+	if (*cert == NULL || (*cert)->references <= 1)
+		return *cert;
 
-	return ctx->cert;
+	if ((new_cert = ssl_cert_dup(*cert)) == NULL)
+		return NULL;
+	ssl_cert_free(*cert);
+	*cert = new_cert;
+
+	return *cert;
 }
 
 int
@@ -333,6 +360,8 @@ ssl_cert_set0_chain(SSL_CTX *ctx, SSL *ssl, STACK_OF(X509) *chain)
 	sk_X509_pop_free(cpk->chain, X509_free);
 	cpk->chain = chain;
 
+	ssl_cert_list_invalidate(ssl_cert, cpk);
+
 	return 1;
 }
 
@@ -378,6 +407,8 @@ ssl_cert_add0_chain_cert(SSL_CTX *ctx, SSL *ssl, X509 *cert)
 	if (!sk_X509_push(cpk->chain, cert))
 		return 0;
 
+	ssl_cert_list_invalidate(ssl_cert, cpk);
+
 	return 1;
 }
 
@@ -392,6 +423,235 @@ ssl_cert_add1_chain_cert(SSL_CTX *ctx, SSL *ssl, X509 *cert)
 	return 1;
 }
 
+void
+ssl_cert_list_free(struct ssl_cert_list *cl)
+{
+	if (cl == NULL)
+		return;
+
+	if (__atomic_sub_fetch(&cl->references, 1, __ATOMIC_ACQ_REL) > 0)
+		return;
+
+	X509_free(cl->leaf);
+	sk_X509_pop_free(cl->chain, X509_free);
+	free(cl->tls12);
+	free(cl->leaf_der);
+	free(cl->tls13_chain);
+	if (cl->comp != NULL) {
+		free(cl->comp->in);
+		free(cl->comp->out);
+		free(cl->comp);
+	}
+	free(cl);
+}
+
+static int
+ssl_cert_list_matches(const struct ssl_cert_list *cl, X509 *leaf,
+    STACK_OF(X509) *chain)
+{
+	int i;
+
+	if (cl == NULL || cl->leaf != leaf)
+		return 0;
+	if (sk_X509_num(cl->chain) != sk_X509_num(chain))
+		return 0;
+	for (i = 0; i < sk_X509_num(chain); i++) {
+		if (sk_X509_value(cl->chain, i) != sk_X509_value(chain, i))
+			return 0;
+	}
+
+	return 1;
+}
+
+void
+ssl_cert_list_up_ref(struct ssl_cert_list *cl)
+{
+	__atomic_add_fetch(&cl->references, 1, __ATOMIC_RELAXED);
+}
+
+/*
+ * Replace the cert_list of a SSL_CERT_PKEY that belongs to cert, returning
+ * the previous one, which the caller must release with ssl_cert_list_free().
+ * A reference to cl is taken if it is not NULL.
+ */
+static struct ssl_cert_list *
+ssl_cert_list_set(SSL_CERT *cert, SSL_CERT_PKEY *cpk,
+    struct ssl_cert_list *cl)
+{
+	struct ssl_cert_list *old_cl;
+
+	if (cl != NULL)
+		ssl_cert_list_up_ref(cl);
+
+	(void)pthread_rwlock_wrlock(&cert->cert_list_lock);
+	old_cl = cpk->cert_list;
+	cpk->cert_list = cl;
+	(void)pthread_rwlock_unlock(&cert->cert_list_lock);
+
+	return old_cl;
+}
+
+/*
+ * Return a reference to the cert_list of a SSL_CERT_PKEY that belongs to
+ * cert, if it was built from the given certificate and chain.
+ */
+static struct ssl_cert_list *
+ssl_cert_list_lookup(SSL_CERT *cert, SSL_CERT_PKEY *cpk, X509 *leaf,
+    STACK_OF(X509) *chain)
+{
+	struct ssl_cert_list *cl = NULL;
+
+	(void)pthread_rwlock_rdlock(&cert->cert_list_lock);
+	if (ssl_cert_list_matches(cpk->cert_list, leaf, chain)) {
+		cl = cpk->cert_list;
+		ssl_cert_list_up_ref(cl);
+	}
+	(void)pthread_rwlock_unlock(&cert->cert_list_lock);
+
+	return cl;
+}
+
+void
+ssl_cert_list_invalidate(SSL_CERT *cert, SSL_CERT_PKEY *cpk)
+{
+	ssl_cert_list_free(ssl_cert_list_set(cert, cpk, NULL));
+}
+
+static struct ssl_cert_list *
+ssl_cert_list_new(X509 *leaf, STACK_OF(X509) *chain)
+{
+	struct ssl_cert_list *cl;
+	CBB tls12, tls13, cert, cert13, exts;
+	uint8_t *der = NULL;
+	int der_len;
+	X509 *x;
+	int i;
+
+	memset(&tls12, 0, sizeof(tls12));
+	memset(&tls13, 0, sizeof(tls13));
+
+	if ((cl = calloc(1, sizeof(*cl))) == NULL)
+		goto err;
+	cl->references = 1;
+
+	X509_up_ref(leaf);
+	cl->leaf = leaf;
+	if (chain != NULL) {
+		if ((cl->chain = X509_chain_up_ref(chain)) == NULL)
+			goto err;
+	}
+
+	if (!CBB_init(&tls12, 0))
+		goto err;
+	if (!CBB_init(&tls13, 0))
+		goto err;
+
+	if ((der_len = i2d_X509(leaf, &der)) <= 0)
+		goto err;
+	if (!CBB_add_u24_length_prefixed(&tls12, &cert))
+		goto err;
+	if (!CBB_add_bytes(&cert, der, der_len))
+		goto err;
+	cl->leaf_der = der;
+	cl->leaf_der_len = der_len;
+	der = NULL;
+
+	for (i = 0; i < sk_X509_num(chain); i++) {
+		x = sk_X509_value(chain, i);
+
+		if ((der_len = i2d_X509(x, &der)) <= 0)
+			goto err;
+
+		if (!CBB_add_u24_length_prefixed(&tls12, &cert))
+			goto err;
+		if (!CBB_add_bytes(&cert, der, der_len))
+			goto err;
+
+		/*
+		 * An automatically built chain includes the leaf, which
+		 * TLSv1.3 has already sent along with its extensions.
+		 */
+		if (i != 0 || x != leaf) {
+			if (!CBB_add_u24_length_prefixed(&tls13, &cert13))
+				goto err;
+			if (!CBB_add_bytes(&cert13, der, der_len))
+				goto err;
+			if (!CBB_add_u16_length_prefixed(&tls13, &exts))
+				goto err;
+		}
+
+		free(der);
+		der = NULL;
+	}
+
+	if (!CBB_finish(&tls12, &cl->tls12, &cl->tls12_len))
+		goto err;
+	if (!CBB_finish(&tls13, &cl->tls13_chain, &cl->tls13_chain_len))
+		goto err;
+
+	return cl;
+
+ err:
+	CBB_cleanup(&tls12);
+	CBB_cleanup(&tls13);
+	free(der);
+	ssl_cert_list_free(cl);
+
+	return NULL;
+}
+
+/*
+ * Return the encoded certificate_list for the given certificate and chain,
+ * which the caller must release with ssl_cert_list_free(). The encoding is
+ * cached on the SSL_CERT_PKEY and, if the certificate and chain are also
+ * those configured on the SSL_CTX, on the SSL_CTX so that subsequent
+ * connections may use it without encoding any certificates.
+ */
+struct ssl_cert_list *
+ssl_cert_list_get(SSL *s, SSL_CERT_PKEY *cpk, STACK_OF(X509) *chain)
+{
+	struct ssl_cert_list *cl;
+	SSL_CERT_PKEY *ctx_cpk = NULL;
+	STACK_OF(X509) *ctx_chain;
+	SSL_CERT *ctx_cert;
+
+	if ((ctx_cert = s->ctx->cert) != NULL && ctx_cert != s->cert &&
+	    cpk >= &s->cert->pkeys[0] && cpk < &s->cert->pkeys[SSL_PKEY_NUM])
+		ctx_cpk = &ctx_cert->pkeys[cpk - &s->cert->pkeys[0]];
+
+	/*
+	 * Only the SSL_CERT that holds the cert_list is locked, and never
+	 * two at once. The encoding is built without holding a lock.
+	 */
+	if ((cl = ssl_cert_list_lookup(s->cert, cpk, cpk->x509, chain)) != NULL)
+		return cl;
+
+	if (ctx_cpk != NULL && (cl = ssl_cert_list_lookup(ctx_cert, ctx_cpk,
+	    cpk->x509, chain)) != NULL) {
+		ssl_cert_list_free(ssl_cert_list_set(s->cert, cpk, cl));
+		return cl;
+	}
+
+	if ((cl = ssl_cert_list_new(cpk->x509, chain)) == NULL)
+		return NULL;
+
+	ssl_cert_list_free(ssl_cert_list_set(s->cert, cpk, cl));
+
+	if (ctx_cpk != NULL) {
+		/*
+		 * The chain of a copied SSL_CERT_PKEY is a different stack
+		 * holding the same certificates, hence the comparison.
+		 */
+		if ((ctx_chain = ctx_cpk->chain) == NULL)
+			ctx_chain = s->ctx->extra_certs;
+		if (ssl_cert_list_matches(cl, ctx_cpk->x509, ctx_chain))
+			ssl_cert_list_free(ssl_cert_list_set(ctx_cert, ctx_cpk,
+			    cl));
+	}
+
+	return cl;
+}
+
 int
 ssl_verify_cert_chain(SSL *s, STACK_OF(X509) *certs)
 {
@@ -942,7 +942,7 @@ ssl_cipher_strength_sort(CIPHER_ORDER **head_p, CIPHER_ORDER **tail_p)
 
 static int
 ssl_cipher_process_rulestr(const char *rule_str, CIPHER_ORDER **head_p,
-    CIPHER_ORDER **tail_p, const SSL_CIPHER **ca_list, SSL_CERT *cert,
+    CIPHER_ORDER **tail_p, const SSL_CIPHER **ca_list, int *security_level,
     int *tls13_seen)
 {
 	unsigned long alg_mkey, alg_auth, alg_enc, alg_mac, alg_ssl;
@@ -1159,7 +1159,7 @@ ssl_cipher_process_rulestr(const char *rule_str, CIPHER_ORDER **head_p,
 				int level = buf[9] - '0';
 
 				if (level >= 0 && level <= 5) {
-					cert->security_level = level;
+					*security_level = level;
 					ok = 1;
 				} else {
 					SSLerrorx(SSL_R_INVALID_COMMAND);
@@ -1192,18 +1192,23 @@ ssl_cipher_process_rulestr(const char *rule_str, CIPHER_ORDER **head_p,
 static inline int
 ssl_aes_is_accelerated(void)
 {
-#if defined(__i386__) || defined(__x86_64__)
-	return ((OPENSSL_cpu_caps() & (1ULL << 57)) != 0);
-#else
-	return (0);
-#endif
+	const char *impl;
+
+	if ((impl = OPENSSL_cpu_impl("aes")) == NULL)
+		return 0;
+
+	return strcmp(impl, "aesni") == 0 || strcmp(impl, "aesni-vaes") == 0;
 }
 
+/*
+ * Build a cipher list from the given rule string. A SECLEVEL= command in the
+ * rule string is returned via security_level, which is otherwise unchanged.
+ */
 STACK_OF(SSL_CIPHER) *
 ssl_create_cipher_list(const SSL_METHOD *ssl_method,
     STACK_OF(SSL_CIPHER) **cipher_list,
     STACK_OF(SSL_CIPHER) *cipher_list_tls13,
-    const char *rule_str, SSL_CERT *cert)
+    const char *rule_str, int *security_level)
 {
 	int ok, num_of_ciphers, num_of_alias_max, num_of_group_aliases;
 	unsigned long disabled_mkey, disabled_auth, disabled_enc, disabled_mac, disabled_ssl;
@@ -1326,7 +1331,7 @@ ssl_create_cipher_list(const SSL_METHOD *ssl_method,
 	rule_p = rule_str;
 	if (strncmp(rule_str, "DEFAULT", 7) == 0) {
 		ok = ssl_cipher_process_rulestr(SSL_DEFAULT_CIPHER_LIST,
-		    &head, &tail, ca_list, cert, &tls13_seen);
+		    &head, &tail, ca_list, security_level, &tls13_seen);
 		rule_p += 7;
 		if (*rule_p == ':')
 			rule_p++;
@@ -1334,7 +1339,7 @@ ssl_create_cipher_list(const SSL_METHOD *ssl_method,
 
 	if (ok && (strlen(rule_p) > 0))
 		ok = ssl_cipher_process_rulestr(rule_p, &head, &tail, ca_list,
-		    cert, &tls13_seen);
+		    security_level, &tls13_seen);
 
 	if (!ok) {
 		/* Rule processing failure */
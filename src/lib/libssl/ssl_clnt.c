@@ -1270,7 +1270,8 @@ ssl3_get_server_kex_ecdhe(SSL *s, CBS *cbs)
 	 * Check that the group is one of our preferences - if it is not,
 	 * the server has sent us an invalid group.
 	 */
-	if (!tls1_check_group(s, group_id)) {
+	if (!tls1_check_group(s, group_id) ||
+	    tls1_group_id_is_tls13_only(group_id)) {
 		SSLerror(s, SSL_R_WRONG_CURVE);
 		ssl3_send_alert(s, SSL3_AL_FATAL, SSL_AD_ILLEGAL_PARAMETER);
 		goto err;
@@ -202,6 +202,7 @@ SSL_clear(SSL *s)
 	ssl_clear_cipher_state(s);
 
 	s->first_packet = 0;
+	s->status_cert_idx = -1;
 
 	/*
 	 * Check to see if we were changed into a different method, if
@@ -224,12 +225,12 @@ int
 SSL_CTX_set_ssl_version(SSL_CTX *ctx, const SSL_METHOD *meth)
 {
 	STACK_OF(SSL_CIPHER) *ciphers;
+	int security_level = -1;
 
 	ctx->method = meth;
 
 	ciphers = ssl_create_cipher_list(ctx->method, &ctx->cipher_list,
-	    ctx->cipher_list_tls13, SSL_DEFAULT_CIPHER_LIST,
-	    ctx->cert);
+	    ctx->cipher_list_tls13, SSL_DEFAULT_CIPHER_LIST, &security_level);
 	if (ciphers == NULL || sk_SSL_CIPHER_num(ciphers) <= 0) {
 		SSLerrorx(SSL_R_SSL_LIBRARY_HAS_NO_CIPHERS);
 		return (0);
@@ -268,8 +269,10 @@ SSL_new(SSL_CTX *ctx)
 	s->max_cert_list = ctx->max_cert_list;
 	s->num_tickets = ctx->num_tickets;
 
-	if ((s->cert = ssl_cert_dup(ctx->cert)) == NULL)
-		goto err;
+	/* The certificate is copied if and when it is modified. */
+	CRYPTO_add(&ctx->cert->references, 1, CRYPTO_LOCK_SSL_CERT);
+	s->cert = ctx->cert;
+	s->status_cert_idx = -1;
 
 	s->read_ahead = ctx->read_ahead;
 	s->msg_callback = ctx->msg_callback;
@@ -302,6 +305,10 @@ SSL_new(SSL_CTX *ctx)
 	CRYPTO_add(&ctx->references, 1, CRYPTO_LOCK_SSL_CTX);
 	s->initial_ctx = ctx;
 
+	/*
+	 * The lists are copied rather than shared, since the SSL_CTX setters
+	 * free and replace them.
+	 */
 	if (ctx->tlsext_ecpointformatlist != NULL) {
 		s->tlsext_ecpointformatlist =
 		    calloc(ctx->tlsext_ecpointformatlist_length,
@@ -339,6 +346,7 @@ SSL_new(SSL_CTX *ctx)
 
 	s->method = ctx->method;
 	s->quic_method = ctx->quic_method;
+	s->private_key_method = ctx->private_key_method;
 
 	if (!s->method->ssl_new(s))
 		goto err;
@@ -1551,6 +1559,8 @@ int
 SSL_CTX_set_cipher_list(SSL_CTX *ctx, const char *str)
 {
 	STACK_OF(SSL_CIPHER) *ciphers;
+	int security_level = -1;
+	SSL_CERT *cert;
 
 	/*
 	 * ssl_create_cipher_list may return an empty stack if it was unable to
@@ -1560,10 +1570,18 @@ SSL_CTX_set_cipher_list(SSL_CTX *ctx, const char *str)
 	 * ctx->cipher_list has been updated.
 	 */
 	ciphers = ssl_create_cipher_list(ctx->method, &ctx->cipher_list,
-	    ctx->cipher_list_tls13, str, ctx->cert);
-	if (ciphers == NULL) {
+	    ctx->cipher_list_tls13, str, &security_level);
+	if (ciphers == NULL)
 		return (0);
-	} else if (sk_SSL_CIPHER_num(ciphers) == 0) {
+
+	/* Only copy a shared SSL_CERT if a security level was specified. */
+	if (security_level != -1) {
+		if ((cert = ssl_get0_cert(ctx, NULL)) == NULL)
+			return (0);
+		cert->security_level = security_level;
+	}
+
+	if (sk_SSL_CIPHER_num(ciphers) == 0) {
 		SSLerrorx(SSL_R_NO_CIPHER_MATCH);
 		return (0);
 	}
@@ -1589,16 +1607,25 @@ int
 SSL_set_cipher_list(SSL *s, const char *str)
 {
 	STACK_OF(SSL_CIPHER) *ciphers, *ciphers_tls13;
+	int security_level = -1;
+	SSL_CERT *cert;
 
 	if ((ciphers_tls13 = s->cipher_list_tls13) == NULL)
 		ciphers_tls13 = s->ctx->cipher_list_tls13;
 
-	/* See comment in SSL_CTX_set_cipher_list. */
+	/* See comments in SSL_CTX_set_cipher_list. */
 	ciphers = ssl_create_cipher_list(s->ctx->method, &s->cipher_list,
-	    ciphers_tls13, str, s->cert);
-	if (ciphers == NULL) {
+	    ciphers_tls13, str, &security_level);
+	if (ciphers == NULL)
 		return (0);
-	} else if (sk_SSL_CIPHER_num(ciphers) == 0) {
+
+	if (security_level != -1) {
+		if ((cert = ssl_get0_cert(NULL, s)) == NULL)
+			return (0);
+		cert->security_level = security_level;
+	}
+
+	if (sk_SSL_CIPHER_num(ciphers) == 0) {
 		SSLerror(s, SSL_R_NO_CIPHER_MATCH);
 		return (0);
 	}
@@ -1867,6 +1894,56 @@ SSL_set_psk_use_session_callback(SSL *s, SSL_psk_use_session_cb_func cb)
 	return;
 }
 
+/*
+ * Add a certificate compression algorithm (RFC 8879), with algorithms being
+ * preferred in the order that they are added. The application provides the
+ * implementation, hence at least one of the callbacks must be given.
+ */
+int
+SSL_CTX_add_cert_compression_alg(SSL_CTX *ctx, uint16_t alg_id,
+    SSL_cert_compress_func compress, SSL_cert_decompress_func decompress)
+{
+	struct ssl_cert_comp_alg *algs;
+	size_t n;
+
+	if (alg_id == 0 || (compress == NULL && decompress == NULL)) {
+		SSLerrorx(SSL_R_INVALID_COMPRESSION_ALGORITHM);
+		return 0;
+	}
+	if (ssl_cert_comp_alg_find(ctx, alg_id) != NULL) {
+		SSLerrorx(SSL_R_DUPLICATE_COMPRESSION_ID);
+		return 0;
+	}
+
+	n = ctx->cert_comp_algs_len;
+	if ((algs = recallocarray(ctx->cert_comp_algs, n, n + 1,
+	    sizeof(*algs))) == NULL) {
+		SSLerrorx(ERR_R_MALLOC_FAILURE);
+		return 0;
+	}
+	algs[n].alg_id = alg_id;
+	algs[n].compress = compress;
+	algs[n].decompress = decompress;
+
+	ctx->cert_comp_algs = algs;
+	ctx->cert_comp_algs_len = n + 1;
+
+	return 1;
+}
+
+const struct ssl_cert_comp_alg *
+ssl_cert_comp_alg_find(SSL_CTX *ctx, uint16_t alg_id)
+{
+	size_t i;
+
+	for (i = 0; i < ctx->cert_comp_algs_len; i++) {
+		if (ctx->cert_comp_algs[i].alg_id == alg_id)
+			return &ctx->cert_comp_algs[i];
+	}
+
+	return NULL;
+}
+
 int
 SSL_export_keying_material(SSL *s, unsigned char *out, size_t out_len,
     const char *label, size_t label_len, const unsigned char *context,
@@ -1959,6 +2036,11 @@ SSL_CTX_new(const SSL_METHOD *meth)
 		SSLerrorx(ERR_R_MALLOC_FAILURE);
 		return (NULL);
 	}
+	if (pthread_rwlock_init(&ret->group_cache_lock, NULL) != 0) {
+		SSLerrorx(ERR_R_MALLOC_FAILURE);
+		free(ret);
+		return (NULL);
+	}
 
 	if (SSL_get_ex_data_X509_STORE_CTX_idx() < 0) {
 		SSLerrorx(SSL_R_X509_VERIFICATION_SETUP_PROBLEMS);
@@ -2021,7 +2103,7 @@ SSL_CTX_new(const SSL_METHOD *meth)
 		goto err;
 
 	ssl_create_cipher_list(ret->method, &ret->cipher_list,
-	    NULL, SSL_DEFAULT_CIPHER_LIST, ret->cert);
+	    NULL, SSL_DEFAULT_CIPHER_LIST, &ret->cert->security_level);
 	if (ret->cipher_list == NULL ||
 	    sk_SSL_CIPHER_num(ret->cipher_list) <= 0) {
 		SSLerrorx(SSL_R_LIBRARY_HAS_NO_CIPHERS);
@@ -2135,8 +2217,13 @@ SSL_CTX_free(SSL_CTX *ctx)
 	free(ctx->tlsext_ecpointformatlist);
 	free(ctx->tlsext_supportedgroups);
 
+	tls1_group_cache_free(ctx);
+	pthread_rwlock_destroy(&ctx->group_cache_lock);
+
 	free(ctx->alpn_client_proto_list);
 
+	free(ctx->cert_comp_algs);
+
 	free(ctx);
 }
 
@@ -2192,14 +2279,16 @@ SSL_CTX_set_verify_depth(SSL_CTX *ctx, int depth)
 	X509_VERIFY_PARAM_set_depth(ctx->param, depth);
 }
 
+/*
+ * Determine the key exchange and authentication algorithms that are usable
+ * with the given certificates.
+ */
 void
-ssl_set_cert_masks(SSL_CERT *c, const SSL_CIPHER *cipher)
+ssl_cert_masks(const SSL_CERT *c, unsigned long *out_mask_k,
+    unsigned long *out_mask_a)
 {
 	unsigned long mask_a, mask_k;
-	SSL_CERT_PKEY *cpk;
-
-	if (c == NULL)
-		return;
+	const SSL_CERT_PKEY *cpk;
 
 	mask_a = SSL_aNULL | SSL_aTLS1_3;
 	mask_k = SSL_kECDHE | SSL_kTLS1_3;
@@ -2227,9 +2316,8 @@ ssl_set_cert_masks(SSL_CERT *c, const SSL_CIPHER *cipher)
 		mask_k |= SSL_kRSA;
 	}
 
-	c->mask_k = mask_k;
-	c->mask_a = mask_a;
-	c->valid = 1;
+	*out_mask_k = mask_k;
+	*out_mask_a = mask_a;
 }
 
 /* See if this handshake is using an ECC cipher suite. */
@@ -2265,6 +2353,19 @@ ssl_check_srvr_ecc_cert_and_alg(SSL *s, X509 *x)
 	return (1);
 }
 
+/*
+ * Return the current certificate and key of an SSL, being the one selected
+ * for the OCSP status callback, if any.
+ */
+SSL_CERT_PKEY *
+ssl_get0_cert_pkey(const SSL *s)
+{
+	if (s->status_cert_idx >= 0)
+		return &s->cert->pkeys[s->status_cert_idx];
+
+	return s->cert->key;
+}
+
 SSL_CERT_PKEY *
 ssl_get_server_send_pkey(const SSL *s)
 {
@@ -2273,7 +2374,6 @@ ssl_get_server_send_pkey(const SSL *s)
 	int i;
 
 	c = s->cert;
-	ssl_set_cert_masks(c, s->s3->hs.cipher);
 
 	alg_a = s->s3->hs.cipher->algorithm_auth;
 
@@ -2325,6 +2425,112 @@ ssl_get_sign_pkey(SSL *s, const SSL_CIPHER *cipher, const EVP_MD **pmd,
 	return (pkey);
 }
 
+/*
+ * Sign content with the private key using the given signature algorithm, or
+ * hand it off to the private key method if one is configured. Returns 1 on
+ * success, 0 on failure and -1 if the private key method has yet to complete
+ * the signature, in which case the handshake must be resumed by the caller
+ * and this function called again with the same content.
+ */
+int
+ssl_private_key_sign(SSL *s, EVP_PKEY *pkey, const struct ssl_sigalg *sigalg,
+    const uint8_t *content, size_t content_len, uint8_t **out_sig,
+    size_t *out_sig_len)
+{
+	const SSL_PRIVATE_KEY_METHOD *key_method = s->private_key_method;
+	enum ssl_private_key_result_t result;
+	EVP_MD_CTX *mdctx = NULL;
+	EVP_PKEY_CTX *pctx;
+	uint8_t *sig = NULL;
+	size_t sig_len = 0;
+	int max_sig_len;
+	int ret = 0;
+
+	*out_sig = NULL;
+	*out_sig_len = 0;
+
+	if (key_method != NULL) {
+		/*
+		 * The configured key need only contain the public key, which
+		 * bounds the size of the signature.
+		 */
+		if ((max_sig_len = EVP_PKEY_size(pkey)) <= 0) {
+			SSLerror(s, ERR_R_INTERNAL_ERROR);
+			goto err;
+		}
+		if ((sig = calloc(1, max_sig_len)) == NULL) {
+			SSLerror(s, ERR_R_MALLOC_FAILURE);
+			goto err;
+		}
+		if (!s->s3->hs.private_key_op_pending)
+			result = key_method->sign(s, sig, &sig_len, max_sig_len,
+			    sigalg->value, content, content_len);
+		else
+			result = key_method->complete(s, sig, &sig_len,
+			    max_sig_len);
+
+		s->s3->hs.private_key_op_pending = 0;
+
+		if (result == ssl_private_key_retry) {
+			s->s3->hs.private_key_op_pending = 1;
+			s->rwstate = SSL_PRIVATE_KEY_OPERATION;
+			ret = -1;
+			goto err;
+		}
+		if (result != ssl_private_key_success || sig_len == 0 ||
+		    sig_len > (size_t)max_sig_len) {
+			SSLerror(s, SSL_R_PRIVATE_KEY_OPERATION_FAILED);
+			goto err;
+		}
+
+		goto done;
+	}
+
+	if ((mdctx = EVP_MD_CTX_new()) == NULL) {
+		SSLerror(s, ERR_R_MALLOC_FAILURE);
+		goto err;
+	}
+	if (!EVP_DigestSignInit(mdctx, &pctx, sigalg->md(), NULL, pkey)) {
+		SSLerror(s, ERR_R_EVP_LIB);
+		goto err;
+	}
+	if ((sigalg->flags & SIGALG_FLAG_RSA_PSS) &&
+	    (!EVP_PKEY_CTX_set_rsa_padding(pctx, RSA_PKCS1_PSS_PADDING) ||
+	    !EVP_PKEY_CTX_set_rsa_pss_saltlen(pctx, -1))) {
+		SSLerror(s, ERR_R_EVP_LIB);
+		goto err;
+	}
+	if (!EVP_DigestSignUpdate(mdctx, content, content_len)) {
+		SSLerror(s, ERR_R_EVP_LIB);
+		goto err;
+	}
+	if (EVP_DigestSignFinal(mdctx, NULL, &sig_len) <= 0 || sig_len == 0) {
+		SSLerror(s, ERR_R_EVP_LIB);
+		goto err;
+	}
+	if ((sig = calloc(1, sig_len)) == NULL) {
+		SSLerror(s, ERR_R_MALLOC_FAILURE);
+		goto err;
+	}
+	if (EVP_DigestSignFinal(mdctx, sig, &sig_len) <= 0) {
+		SSLerror(s, ERR_R_EVP_LIB);
+		goto err;
+	}
+
+ done:
+	*out_sig = sig;
+	*out_sig_len = sig_len;
+	sig = NULL;
+
+	ret = 1;
+
+ err:
+	EVP_MD_CTX_free(mdctx);
+	free(sig);
+
+	return ret;
+}
+
 size_t
 ssl_dhe_params_auto_key_bits(SSL *s)
 {
@@ -2570,6 +2776,9 @@ SSL_get_error(const SSL *s, int i)
 	if (SSL_want_x509_lookup(s))
 		return (SSL_ERROR_WANT_X509_LOOKUP);
 
+	if (SSL_want_private_key_operation(s))
+		return (SSL_ERROR_WANT_PRIVATE_KEY_OPERATION);
+
 	if ((s->shutdown & SSL_RECEIVED_SHUTDOWN) &&
 	    (s->s3->warn_alert == SSL_AD_CLOSE_NOTIFY))
 		return (SSL_ERROR_ZERO_RETURN);
@@ -2577,6 +2786,26 @@ SSL_get_error(const SSL *s, int i)
 	return (SSL_ERROR_SYSCALL);
 }
 
+void
+SSL_CTX_set_private_key_method(SSL_CTX *ctx,
+    const SSL_PRIVATE_KEY_METHOD *key_method)
+{
+	ctx->private_key_method = key_method;
+}
+
+void
+SSL_set_private_key_method(SSL *ssl, const SSL_PRIVATE_KEY_METHOD *key_method)
+{
+	ssl->private_key_method = key_method;
+}
+
+void
+SSL_CTX_set_ticket_aead_method(SSL_CTX *ctx,
+    const SSL_TICKET_AEAD_METHOD *aead_method)
+{
+	ctx->ticket_aead_method = aead_method;
+}
+
 int
 SSL_CTX_set_quic_method(SSL_CTX *ctx, const SSL_QUIC_METHOD *quic_method)
 {
@@ -2948,14 +3177,14 @@ ssl_msg_callback_cbs(SSL *s, int is_write, int content_type, CBS *cbs)
 X509 *
 SSL_get_certificate(const SSL *s)
 {
-	return (s->cert->key->x509);
+	return (ssl_get0_cert_pkey(s)->x509);
 }
 
 /* Fix this function so that it takes an optional type parameter */
 EVP_PKEY *
 SSL_get_privatekey(const SSL *s)
 {
-	return (s->cert->key->privatekey);
+	return (ssl_get0_cert_pkey(s)->privatekey);
 }
 
 const SSL_CIPHER *
@@ -3108,17 +3337,15 @@ SSL_get_SSL_CTX(const SSL *ssl)
 SSL_CTX *
 SSL_set_SSL_CTX(SSL *ssl, SSL_CTX* ctx)
 {
-	SSL_CERT *new_cert;
-
 	if (ctx == NULL)
 		ctx = ssl->initial_ctx;
 	if (ssl->ctx == ctx)
 		return (ssl->ctx);
 
-	if ((new_cert = ssl_cert_dup(ctx->cert)) == NULL)
-		return NULL;
+	CRYPTO_add(&ctx->cert->references, 1, CRYPTO_LOCK_SSL_CERT);
 	ssl_cert_free(ssl->cert);
-	ssl->cert = new_cert;
+	ssl->cert = ctx->cert;
+	ssl->status_cert_idx = -1;
 
 	SSL_CTX_up_ref(ctx);
 	SSL_CTX_free(ssl->ctx); /* decrement reference count */
@@ -3423,7 +3650,12 @@ SSL_CTX_get_security_level(const SSL_CTX *ctx)
 void
 SSL_CTX_set_security_level(SSL_CTX *ctx, int level)
 {
-	ctx->cert->security_level = level;
+	SSL_CERT *cert;
+
+	if ((cert = ssl_get0_cert(ctx, NULL)) == NULL)
+		return;
+
+	cert->security_level = level;
 }
 
 int
@@ -3435,7 +3667,12 @@ SSL_get_security_level(const SSL *ssl)
 void
 SSL_set_security_level(SSL *ssl, int level)
 {
-	ssl->cert->security_level = level;
+	SSL_CERT *cert;
+
+	if ((cert = ssl_get0_cert(NULL, ssl)) == NULL)
+		return;
+
+	cert->security_level = level;
 }
 
 int
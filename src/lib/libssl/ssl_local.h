@@ -146,6 +146,7 @@
 #include <sys/types.h>
 
 #include <errno.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
@@ -356,10 +357,74 @@ __BEGIN_HIDDEN_DECLS
 #define EXPLICIT_CHAR2_CURVE_TYPE  2
 #define NAMED_CURVE_TYPE           3
 
+/*
+ * Encoded certificate_list for a certificate and chain, which is built on
+ * first use and shared between copies of the SSL_CERT_PKEY. It holds
+ * references to the certificates that it was built from, which are compared
+ * against the current certificate and chain before use.
+ */
+struct ssl_cert_list {
+	X509 *leaf;
+	STACK_OF(X509) *chain;
+
+	/* TLSv1.2 certificate_list, without the length prefix. */
+	uint8_t *tls12;
+	size_t tls12_len;
+
+	/* DER encoding of the leaf certificate. */
+	uint8_t *leaf_der;
+	size_t leaf_der_len;
+
+	/* TLSv1.3 CertificateEntry structures for the chain, sans leaf. */
+	uint8_t *tls13_chain;
+	size_t tls13_chain_len;
+
+	/*
+	 * Compressed TLSv1.3 Certificate message, which is set once with a
+	 * compare and swap and not modified thereafter.
+	 */
+	struct ssl_cert_comp_cache *comp;
+
+	int references;
+};
+
+struct ssl_cert_comp_cache {
+	uint16_t alg_id;
+
+	/* The Certificate message that was compressed. */
+	uint8_t *in;
+	size_t in_len;
+
+	uint8_t *out;
+	size_t out_len;
+};
+
+struct ssl_cert_comp_alg {
+	uint16_t alg_id;
+	SSL_cert_compress_func compress;
+	SSL_cert_decompress_func decompress;
+};
+
+/*
+ * Number of servers for which a TLSv1.3 client remembers the group that was
+ * selected via a hello retry request, and the number of seconds for which it
+ * is remembered before our most preferred group is offered again.
+ */
+#define SSL_GROUP_CACHE_SIZE	32
+#define SSL_GROUP_CACHE_TIMEOUT	(60 * 60)
+
+struct ssl_group_cache_entry {
+	char *hostname;
+	uint16_t group_id;
+	time_t expires;
+};
+
 typedef struct ssl_cert_pkey_st {
 	X509 *x509;
 	EVP_PKEY *privatekey;
 	STACK_OF(X509) *chain;
+
+	struct ssl_cert_list *cert_list;
 } SSL_CERT_PKEY;
 
 typedef struct ssl_cert_st {
@@ -371,11 +436,8 @@ typedef struct ssl_cert_st {
 
 	SSL_CERT_PKEY pkeys[SSL_PKEY_NUM];
 
-	/* The following masks are for the key and auth
-	 * algorithms that are supported by the certs below */
-	int valid;
-	unsigned long mask_k;
-	unsigned long mask_a;
+	/* Protects the cert_list of each of the pkeys. */
+	pthread_rwlock_t cert_list_lock;
 
 	DH *dhe_params;
 	DH *(*dhe_params_cb)(SSL *ssl, int is_export, int keysize);
@@ -386,7 +448,12 @@ typedef struct ssl_cert_st {
 	int security_level;
 	void *security_ex_data; /* Not exposed in API. */
 
-	int references; /* >1 only if SSL_copy_session_id is used */
+	/*
+	 * An SSL_CERT is shared between an SSL_CTX and the SSLs created from
+	 * it - it must only be modified via ssl_get0_cert(), which makes a
+	 * private copy if it is shared.
+	 */
+	int references;
 } SSL_CERT;
 
 struct ssl_comp_st {
@@ -549,6 +616,10 @@ typedef struct ssl_handshake_tls12_st {
 
 	/* Transcript hash prior to sending certificate verify message. */
 	uint8_t cert_verify[EVP_MAX_MD_SIZE];
+
+	/* Server key exchange parameters awaiting a signature. */
+	uint8_t *server_kex_params;
+	size_t server_kex_params_len;
 } SSL_HANDSHAKE_TLS12;
 
 typedef struct ssl_handshake_tls13_st {
@@ -587,6 +658,13 @@ typedef struct ssl_handshake_tls13_st {
 	struct tls_buffer *quic_read_buffer;
 	enum ssl_encryption_level_t quic_read_level;
 	enum ssl_encryption_level_t quic_write_level;
+
+	/* Certificate compression algorithms offered by the client. */
+	uint8_t *cert_comp_algs;
+	size_t cert_comp_algs_len;
+
+	/* Algorithm used to compress our Certificate message, if any. */
+	uint16_t cert_comp_alg;
 } SSL_HANDSHAKE_TLS13;
 
 typedef struct ssl_handshake_st {
@@ -631,6 +709,9 @@ typedef struct ssl_handshake_st {
 	const struct ssl_sigalg *our_sigalg;
 	const struct ssl_sigalg *peer_sigalg;
 
+	/* A signature is pending completion by the private key method. */
+	int private_key_op_pending;
+
 	/* sigalgs offered in this handshake in wire form */
 	uint8_t *sigalgs;
 	size_t sigalgs_len;
@@ -719,6 +800,7 @@ typedef void (ssl_msg_callback_fn)(int is_write, int version, int content_type,
 struct ssl_ctx_st {
 	const SSL_METHOD *method;
 	const SSL_QUIC_METHOD *quic_method;
+	const SSL_PRIVATE_KEY_METHOD *private_key_method;
 
 	STACK_OF(SSL_CIPHER) *cipher_list;
 
@@ -812,6 +894,9 @@ struct ssl_ctx_st {
 	int (*tlsext_ticket_key_cb)(SSL *ssl, unsigned char *name,
 	    unsigned char *iv, EVP_CIPHER_CTX *ectx, HMAC_CTX *hctx, int enc);
 
+	/* Ticket encryption, in place of the above. */
+	const SSL_TICKET_AEAD_METHOD *ticket_aead_method;
+
 	/* certificate status request info */
 	/* Callback for status request */
 	int (*tlsext_status_cb)(SSL *ssl, void *arg);
@@ -917,6 +1002,15 @@ struct ssl_ctx_st {
 	uint16_t *tlsext_supportedgroups; /* our list */
 	SSL_CTX_keylog_cb_func keylog_callback; /* Unused. For OpenSSL compatibility. */
 	size_t num_tickets; /* Unused, for OpenSSL compatibility */
+
+	/* Certificate compression algorithms, in order of preference. */
+	struct ssl_cert_comp_alg *cert_comp_algs;
+	size_t cert_comp_algs_len;
+
+	/* Groups selected by servers, keyed by host name. */
+	pthread_rwlock_t group_cache_lock;
+	struct ssl_group_cache_entry group_cache[SSL_GROUP_CACHE_SIZE];
+	size_t group_cache_next;
 };
 
 struct ssl_st {
@@ -927,6 +1021,7 @@ struct ssl_st {
 
 	const SSL_METHOD *method;
 	const SSL_QUIC_METHOD *quic_method;
+	const SSL_PRIVATE_KEY_METHOD *private_key_method;
 
 	/* There are 2 BIO's even though they are normally both the
 	 * same.  This is so data can be read and written to different
@@ -949,6 +1044,12 @@ struct ssl_st {
 	/* This is used to hold the server certificate used */
 	SSL_CERT *cert;
 
+	/*
+	 * Index of the certificate selected for the OCSP status callback, or
+	 * -1 to use the current certificate of the (possibly shared) cert.
+	 */
+	int status_cert_idx;
+
 	/* the session_id_context is used to ensure sessions are only reused
 	 * in the appropriate context */
 	size_t sid_ctx_length;
@@ -1110,6 +1211,9 @@ struct ssl_st {
 	size_t tlsext_supportedgroups_length;
 	uint16_t *tlsext_supportedgroups; /* our list */
 
+	/* Group to use for the initial TLSv1.3 key share, if non-zero. */
+	uint16_t key_share_group;
+
 	/* TLS Session Ticket extension override */
 	TLS_SESSION_TICKET_EXT *tlsext_session_ticket;
 
@@ -1165,6 +1269,7 @@ typedef struct ssl3_state_st {
 	/* we allow one fatal and one warning alert to be outstanding,
 	 * send close alert via the warning alert */
 	int alert_dispatch;
+	int alert_written;
 	unsigned char send_alert[2];
 
 	/* flags for countermeasure against known-IV weakness */
@@ -1294,6 +1399,14 @@ int ssl_cert_set0_chain(SSL_CTX *ctx, SSL *ssl, STACK_OF(X509) *chain);
 int ssl_cert_set1_chain(SSL_CTX *ctx, SSL *ssl, STACK_OF(X509) *chain);
 int ssl_cert_add0_chain_cert(SSL_CTX *ctx, SSL *ssl, X509 *cert);
 int ssl_cert_add1_chain_cert(SSL_CTX *ctx, SSL *ssl, X509 *cert);
+void ssl_cert_list_free(struct ssl_cert_list *cl);
+void ssl_cert_list_invalidate(SSL_CERT *cert, SSL_CERT_PKEY *cpk);
+void ssl_cert_list_up_ref(struct ssl_cert_list *cl);
+struct ssl_cert_list *ssl_cert_list_get(SSL *s, SSL_CERT_PKEY *cpk,
+    STACK_OF(X509) *chain);
+
+const struct ssl_cert_comp_alg *ssl_cert_comp_alg_find(SSL_CTX *ctx,
+    uint16_t alg_id);
 
 int ssl_security_default_cb(const SSL *ssl, const SSL_CTX *ctx, int op,
     int bits, int nid, void *other, void *ex_data);
@@ -1324,7 +1437,7 @@ int ssl_cipher_list_to_bytes(SSL *s, STACK_OF(SSL_CIPHER) *ciphers, CBB *cbb);
 STACK_OF(SSL_CIPHER) *ssl_bytes_to_cipher_list(SSL *s, CBS *cbs);
 STACK_OF(SSL_CIPHER) *ssl_create_cipher_list(const SSL_METHOD *meth,
     STACK_OF(SSL_CIPHER) **pref, STACK_OF(SSL_CIPHER) *tls13,
-    const char *rule_str, SSL_CERT *cert);
+    const char *rule_str, int *security_level);
 int ssl_parse_ciphersuites(STACK_OF(SSL_CIPHER) **out_ciphers, const char *str);
 int ssl_merge_cipherlists(STACK_OF(SSL_CIPHER) *cipherlist,
     STACK_OF(SSL_CIPHER) *cipherlist_tls13,
@@ -1340,16 +1453,27 @@ int ssl_undefined_function(SSL *s);
 int ssl_undefined_void_function(void);
 int ssl_undefined_const_function(const SSL *s);
 SSL_CERT_PKEY *ssl_get_server_send_pkey(const SSL *s);
+SSL_CERT_PKEY *ssl_get0_cert_pkey(const SSL *s);
 EVP_PKEY *ssl_get_sign_pkey(SSL *s, const SSL_CIPHER *c, const EVP_MD **pmd,
     const struct ssl_sigalg **sap);
+int ssl_private_key_sign(SSL *s, EVP_PKEY *pkey,
+    const struct ssl_sigalg *sigalg, const uint8_t *content,
+    size_t content_len, uint8_t **out_sig, size_t *out_sig_len);
 size_t ssl_dhe_params_auto_key_bits(SSL *s);
 int ssl_cert_type(EVP_PKEY *pkey);
-void ssl_set_cert_masks(SSL_CERT *c, const SSL_CIPHER *cipher);
+void ssl_cert_masks(const SSL_CERT *c, unsigned long *out_mask_k,
+    unsigned long *out_mask_a);
 STACK_OF(SSL_CIPHER) *ssl_get_ciphers_by_id(SSL *s);
 int ssl_has_ecc_ciphers(SSL *s);
 int ssl_verify_alarm_type(long type);
 
-int SSL_SESSION_ticket(SSL_SESSION *ss, unsigned char **out, size_t *out_len);
+/* Version of the compact session encoding used for session tickets. */
+#define SSL_SESSION_TICKET_VERSION	0x01
+
+int SSL_SESSION_ticket(SSL_SESSION *ss, int include_peer_cert,
+    unsigned char **out, size_t *out_len);
+SSL_SESSION *SSL_SESSION_from_ticket(const unsigned char *data,
+    size_t data_len);
 
 const SSL_CIPHER *ssl3_get_cipher_by_char(const unsigned char *p);
 int ssl3_do_write(SSL *s, int type);
@@ -1486,6 +1610,12 @@ int tls1_set_group_list(uint16_t **out_group_ids, size_t *out_group_ids_len,
 int tls1_ec_group_id2nid(uint16_t group_id, int *out_nid);
 int tls1_ec_group_id2bits(uint16_t group_id, int *out_bits);
 int tls1_ec_nid2group_id(int nid, uint16_t *out_group_id);
+int tls1_group_id_is_tls13_only(uint16_t group_id);
+int tls1_group_preference_index(const SSL *ssl, uint16_t group_id,
+    size_t *out_index);
+int tls1_get_key_share_group(SSL *s, uint16_t *out_group_id);
+void tls1_group_cache_update(SSL *s, uint16_t group_id);
+void tls1_group_cache_free(SSL_CTX *ctx);
 int tls1_check_group(SSL *s, uint16_t group_id);
 int tls1_count_shared_groups(const SSL *ssl, size_t *out_count);
 int tls1_get_shared_group_by_index(const SSL *ssl, size_t index, int *out_nid);
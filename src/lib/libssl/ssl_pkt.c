@@ -1283,6 +1283,7 @@ ssl3_send_alert(SSL *s, int level, int desc)
 		SSL_CTX_remove_session(s->ctx, s->session);
 
 	s->s3->alert_dispatch = 1;
+	s->s3->alert_written = 0;
 	s->s3->send_alert[0] = level;
 	s->s3->send_alert[1] = desc;
 
@@ -1299,26 +1300,36 @@ ssl3_send_alert(SSL *s, int level, int desc)
 int
 ssl3_dispatch_alert(SSL *s)
 {
-	int ret;
+	int ret = 1;
 
 	s->s3->alert_dispatch = 0;
-	if ((ret = ssl3_write_alert(s)) <= 0) {
-		s->s3->alert_dispatch = 1;
-		return ret;
+	if (!s->s3->alert_written) {
+		if ((ret = ssl3_write_alert(s)) <= 0) {
+			s->s3->alert_dispatch = 1;
+			return ret;
+		}
+		s->s3->alert_written = 1;
+
+		ssl_msg_callback(s, 1, SSL3_RT_ALERT, s->s3->send_alert, 2);
+
+		ssl_info_callback(s, SSL_CB_WRITE_ALERT,
+		    (s->s3->send_alert[0] << 8) | s->s3->send_alert[1]);
 	}
 
 	/*
-	 * Alert sent to BIO.  If it is important, flush it now.
-	 * If the message does not get sent due to non-blocking IO,
-	 * we will not worry too much.
+	 * Alert sent to BIO. If it is important, flush it now. A datagram
+	 * BIO may batch writes, so always flush for DTLS. If flushing would
+	 * block, the alert remains to be dispatched, but is not written again.
 	 */
-	if (s->s3->send_alert[0] == SSL3_AL_FATAL)
-		(void)BIO_flush(s->wbio);
-
-	ssl_msg_callback(s, 1, SSL3_RT_ALERT, s->s3->send_alert, 2);
+	if (s->s3->send_alert[0] == SSL3_AL_FATAL || SSL_is_dtls(s)) {
+		if (BIO_flush(s->wbio) <= 0 && BIO_should_retry(s->wbio)) {
+			s->s3->alert_dispatch = 1;
+			s->rwstate = SSL_WRITING;
+			return -1;
+		}
+	}
 
-	ssl_info_callback(s, SSL_CB_WRITE_ALERT,
-	    (s->s3->send_alert[0] << 8) | s->s3->send_alert[1]);
+	s->s3->alert_written = 0;
 
 	return ret;
 }
@@ -181,6 +181,8 @@ ssl_set_pkey(SSL_CTX *ctx, SSL *ssl, EVP_PKEY *pkey)
 
 	if ((c = ssl_get0_cert(ctx, ssl)) == NULL)
 		return (0);
+	if (ssl != NULL)
+		ssl->status_cert_idx = -1;
 
 	if (c->pkeys[i].x509 != NULL) {
 		EVP_PKEY *pktmp;
@@ -206,6 +208,7 @@ ssl_set_pkey(SSL_CTX *ctx, SSL *ssl, EVP_PKEY *pkey)
 			if (!X509_check_private_key(c->pkeys[i].x509, pkey)) {
 				X509_free(c->pkeys[i].x509);
 				c->pkeys[i].x509 = NULL;
+				ssl_cert_list_invalidate(c, &c->pkeys[i]);
 				return 0;
 			}
 		}
@@ -216,7 +219,6 @@ ssl_set_pkey(SSL_CTX *ctx, SSL *ssl, EVP_PKEY *pkey)
 	c->pkeys[i].privatekey = pkey;
 	c->key = &(c->pkeys[i]);
 
-	c->valid = 0;
 	return 1;
 }
 
@@ -383,6 +385,8 @@ ssl_set_cert(SSL_CTX *ctx, SSL *ssl, X509 *x)
 
 	if ((c = ssl_get0_cert(ctx, ssl)) == NULL)
 		return (0);
+	if (ssl != NULL)
+		ssl->status_cert_idx = -1;
 
 	pkey = X509_get_pubkey(x);
 	if (pkey == NULL) {
@@ -430,7 +434,8 @@ ssl_set_cert(SSL_CTX *ctx, SSL *ssl, X509 *x)
 	c->pkeys[i].x509 = x;
 	c->key = &(c->pkeys[i]);
 
-	c->valid = 0;
+	ssl_cert_list_invalidate(c, &c->pkeys[i]);
+
 	return (1);
 }
 
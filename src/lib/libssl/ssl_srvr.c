@@ -1431,48 +1431,55 @@ ssl3_send_server_kex_ecdhe(SSL *s, CBB *cbb)
 static int
 ssl3_send_server_key_exchange(SSL *s)
 {
-	CBB cbb, cbb_params, cbb_signature, server_kex;
+	CBB cbb, cbb_params, cbb_signature, server_kex, signed_params;
 	const struct ssl_sigalg *sigalg = NULL;
 	unsigned char *signature = NULL;
 	size_t signature_len = 0;
 	unsigned char *params = NULL;
 	size_t params_len;
+	unsigned char *content = NULL;
+	size_t content_len;
 	const EVP_MD *md = NULL;
 	unsigned long type;
-	EVP_MD_CTX *md_ctx = NULL;
-	EVP_PKEY_CTX *pctx;
 	EVP_PKEY *pkey;
-	int al;
+	int al, ret;
 
 	memset(&cbb, 0, sizeof(cbb));
 	memset(&cbb_params, 0, sizeof(cbb_params));
-
-	if ((md_ctx = EVP_MD_CTX_new()) == NULL)
-		goto err;
+	memset(&signed_params, 0, sizeof(signed_params));
 
 	if (s->s3->hs.state == SSL3_ST_SW_KEY_EXCH_A) {
+		/*
+		 * The parameters (and our key share) are retained while the
+		 * private key method completes a signature over them.
+		 */
+		if (s->s3->hs.tls12.server_kex_params == NULL) {
+			if (!CBB_init(&cbb_params, 0))
+				goto err;
 
-		if (!ssl3_handshake_msg_start(s, &cbb, &server_kex,
-		    SSL3_MT_SERVER_KEY_EXCHANGE))
-			goto err;
-
-		if (!CBB_init(&cbb_params, 0))
-			goto err;
+			type = s->s3->hs.cipher->algorithm_mkey;
+			if (type & SSL_kDHE) {
+				if (!ssl3_send_server_kex_dhe(s, &cbb_params))
+					goto err;
+			} else if (type & SSL_kECDHE) {
+				if (!ssl3_send_server_kex_ecdhe(s, &cbb_params))
+					goto err;
+			} else {
+				al = SSL_AD_HANDSHAKE_FAILURE;
+				SSLerror(s, SSL_R_UNKNOWN_KEY_EXCHANGE_TYPE);
+				goto fatal_err;
+			}
 
-		type = s->s3->hs.cipher->algorithm_mkey;
-		if (type & SSL_kDHE) {
-			if (!ssl3_send_server_kex_dhe(s, &cbb_params))
-				goto err;
-		} else if (type & SSL_kECDHE) {
-			if (!ssl3_send_server_kex_ecdhe(s, &cbb_params))
+			if (!CBB_finish(&cbb_params,
+			    &s->s3->hs.tls12.server_kex_params,
+			    &s->s3->hs.tls12.server_kex_params_len))
 				goto err;
-		} else {
-			al = SSL_AD_HANDSHAKE_FAILURE;
-			SSLerror(s, SSL_R_UNKNOWN_KEY_EXCHANGE_TYPE);
-			goto fatal_err;
 		}
+		params = s->s3->hs.tls12.server_kex_params;
+		params_len = s->s3->hs.tls12.server_kex_params_len;
 
-		if (!CBB_finish(&cbb_params, &params, &params_len))
+		if (!ssl3_handshake_msg_start(s, &cbb, &server_kex,
+		    SSL3_MT_SERVER_KEY_EXCHANGE))
 			goto err;
 
 		if (!CBB_add_bytes(&server_kex, params, params_len))
@@ -1496,44 +1503,27 @@ ssl3_send_server_key_exchange(SSL *s)
 				}
 			}
 
-			if (!EVP_DigestSignInit(md_ctx, &pctx, md, NULL, pkey)) {
-				SSLerror(s, ERR_R_EVP_LIB);
+			if (!CBB_init(&signed_params, 0))
 				goto err;
-			}
-			if ((sigalg->flags & SIGALG_FLAG_RSA_PSS) &&
-			    (!EVP_PKEY_CTX_set_rsa_padding(pctx,
-			    RSA_PKCS1_PSS_PADDING) ||
-			    !EVP_PKEY_CTX_set_rsa_pss_saltlen(pctx, -1))) {
-				SSLerror(s, ERR_R_EVP_LIB);
+			if (!CBB_add_bytes(&signed_params, s->s3->client_random,
+			    SSL3_RANDOM_SIZE))
 				goto err;
-			}
-			if (!EVP_DigestSignUpdate(md_ctx, s->s3->client_random,
-			    SSL3_RANDOM_SIZE)) {
-				SSLerror(s, ERR_R_EVP_LIB);
+			if (!CBB_add_bytes(&signed_params, s->s3->server_random,
+			    SSL3_RANDOM_SIZE))
 				goto err;
-			}
-			if (!EVP_DigestSignUpdate(md_ctx, s->s3->server_random,
-			    SSL3_RANDOM_SIZE)) {
-				SSLerror(s, ERR_R_EVP_LIB);
-				goto err;
-			}
-			if (!EVP_DigestSignUpdate(md_ctx, params, params_len)) {
-				SSLerror(s, ERR_R_EVP_LIB);
+			if (!CBB_add_bytes(&signed_params, params, params_len))
 				goto err;
-			}
-			if (!EVP_DigestSignFinal(md_ctx, NULL, &signature_len) ||
-			    !signature_len) {
-				SSLerror(s, ERR_R_EVP_LIB);
-				goto err;
-			}
-			if ((signature = calloc(1, signature_len)) == NULL) {
-				SSLerror(s, ERR_R_MALLOC_FAILURE);
+			if (!CBB_finish(&signed_params, &content, &content_len))
 				goto err;
+
+			if ((ret = ssl_private_key_sign(s, pkey, sigalg, content,
+			    content_len, &signature, &signature_len)) == -1) {
+				CBB_cleanup(&cbb);
+				free(content);
+				return -1;
 			}
-			if (!EVP_DigestSignFinal(md_ctx, signature, &signature_len)) {
-				SSLerror(s, ERR_R_EVP_LIB);
+			if (ret != 1)
 				goto err;
-			}
 
 			if (!CBB_add_u16_length_prefixed(&server_kex,
 			    &cbb_signature))
@@ -1546,11 +1536,14 @@ ssl3_send_server_key_exchange(SSL *s)
 		if (!ssl3_handshake_msg_finish(s, &cbb))
 			goto err;
 
+		free(s->s3->hs.tls12.server_kex_params);
+		s->s3->hs.tls12.server_kex_params = NULL;
+		s->s3->hs.tls12.server_kex_params_len = 0;
+
 		s->s3->hs.state = SSL3_ST_SW_KEY_EXCH_B;
 	}
 
-	EVP_MD_CTX_free(md_ctx);
-	free(params);
+	free(content);
 	free(signature);
 
 	return (ssl3_handshake_write(s));
@@ -1559,9 +1552,9 @@ ssl3_send_server_key_exchange(SSL *s)
 	ssl3_send_alert(s, SSL3_AL_FATAL, al);
  err:
 	CBB_cleanup(&cbb_params);
+	CBB_cleanup(&signed_params);
 	CBB_cleanup(&cbb);
-	EVP_MD_CTX_free(md_ctx);
-	free(params);
+	free(content);
 	free(signature);
 
 	return (-1);
@@ -2324,15 +2317,46 @@ ssl3_send_server_certificate(SSL *s)
 	return (0);
 }
 
-/* send a new session ticket (not necessarily for a new session) */
 static int
-ssl3_send_newsession_ticket(SSL *s)
+ssl3_seal_session_ticket_aead(SSL *s, CBB *ticket, const unsigned char *session,
+    size_t session_len)
+{
+	const SSL_TICKET_AEAD_METHOD *aead_method =
+	    s->initial_ctx->ticket_aead_method;
+	unsigned char *enc_session = NULL;
+	size_t enc_session_len, enc_session_max_len;
+	int ret = 0;
+
+	enc_session_max_len = session_len + aead_method->max_overhead(s);
+	if (enc_session_max_len < session_len || enc_session_max_len > 0xffff)
+		goto err;
+	if ((enc_session = calloc(1, enc_session_max_len)) == NULL)
+		goto err;
+
+	if (!aead_method->seal(s, enc_session, &enc_session_len,
+	    enc_session_max_len, session, session_len))
+		goto err;
+	if (enc_session_len > enc_session_max_len)
+		goto err;
+
+	if (!CBB_add_bytes(ticket, enc_session, enc_session_len))
+		goto err;
+
+	ret = 1;
+
+ err:
+	free(enc_session);
+
+	return ret;
+}
+
+static int
+ssl3_seal_session_ticket(SSL *s, CBB *ticket, const unsigned char *session,
+    size_t session_len)
 {
-	CBB cbb, session_ticket, ticket;
 	SSL_CTX *tctx = s->initial_ctx;
 	size_t enc_session_len, enc_session_max_len, hmac_len;
-	size_t session_len = 0;
-	unsigned char *enc_session = NULL, *session = NULL;
+	unsigned char *enc_session = NULL;
 	unsigned char iv[EVP_MAX_IV_LENGTH];
 	unsigned char key_name[16];
 	unsigned char *hmac;
@@ -2340,72 +2364,115 @@ ssl3_send_newsession_ticket(SSL *s)
 	EVP_CIPHER_CTX *ctx = NULL;
 	HMAC_CTX *hctx = NULL;
 	int len;
+	int ret = 0;
+
+	if (tctx->ticket_aead_method != NULL)
+		return ssl3_seal_session_ticket_aead(s, ticket, session,
+		    session_len);
+
+	if ((ctx = EVP_CIPHER_CTX_new()) == NULL)
+		goto err;
+	if ((hctx = HMAC_CTX_new()) == NULL)
+		goto err;
 
 	/*
-	 * New Session Ticket - RFC 5077, section 3.3.
+	 * Initialize HMAC and cipher contexts. If callback is present
+	 * it does all the work, otherwise use generated values from
+	 * parent context.
 	 */
+	if (tctx->tlsext_ticket_key_cb != NULL) {
+		if (tctx->tlsext_ticket_key_cb(s,
+		    key_name, iv, ctx, hctx, 1) < 0)
+			goto err;
+	} else {
+		arc4random_buf(iv, 16);
+		EVP_EncryptInit_ex(ctx, EVP_aes_128_cbc(), NULL,
+		    tctx->tlsext_tick_aes_key, iv);
+		HMAC_Init_ex(hctx, tctx->tlsext_tick_hmac_key,
+		    16, EVP_sha256(), NULL);
+		memcpy(key_name, tctx->tlsext_tick_key_name, 16);
+	}
 
-	memset(&cbb, 0, sizeof(cbb));
+	/* Encrypt the session state. */
+	enc_session_max_len = session_len + EVP_MAX_BLOCK_LENGTH;
+	if ((enc_session = calloc(1, enc_session_max_len)) == NULL)
+		goto err;
+	enc_session_len = 0;
+	if (!EVP_EncryptUpdate(ctx, enc_session, &len, session,
+	    session_len))
+		goto err;
+	enc_session_len += len;
+	if (!EVP_EncryptFinal_ex(ctx, enc_session + enc_session_len,
+	    &len))
+		goto err;
+	enc_session_len += len;
 
-	if ((ctx = EVP_CIPHER_CTX_new()) == NULL)
+	if (enc_session_len > enc_session_max_len)
 		goto err;
-	if ((hctx = HMAC_CTX_new()) == NULL)
+
+	/* Generate the HMAC. */
+	if (!HMAC_Update(hctx, key_name, sizeof(key_name)))
+		goto err;
+	if (!HMAC_Update(hctx, iv, EVP_CIPHER_CTX_iv_length(ctx)))
+		goto err;
+	if (!HMAC_Update(hctx, enc_session, enc_session_len))
+		goto err;
+
+	if ((hmac_len = HMAC_size(hctx)) <= 0)
+		goto err;
+
+	if (!CBB_add_bytes(ticket, key_name, sizeof(key_name)))
+		goto err;
+	if (!CBB_add_bytes(ticket, iv, EVP_CIPHER_CTX_iv_length(ctx)))
+		goto err;
+	if (!CBB_add_bytes(ticket, enc_session, enc_session_len))
 		goto err;
+	if (!CBB_add_space(ticket, &hmac, hmac_len))
+		goto err;
+
+	if (!HMAC_Final(hctx, hmac, &hlen))
+		goto err;
+	if (hlen != hmac_len)
+		goto err;
+
+	ret = 1;
+
+ err:
+	EVP_CIPHER_CTX_free(ctx);
+	HMAC_CTX_free(hctx);
+	free(enc_session);
+
+	return ret;
+}
+
+/* send a new session ticket (not necessarily for a new session) */
+static int
+ssl3_send_newsession_ticket(SSL *s)
+{
+	CBB cbb, session_ticket, ticket;
+	size_t session_len = 0;
+	unsigned char *session = NULL;
+
+	/*
+	 * New Session Ticket - RFC 5077, section 3.3.
+	 */
+
+	memset(&cbb, 0, sizeof(cbb));
 
 	if (s->s3->hs.state == SSL3_ST_SW_SESSION_TICKET_A) {
 		if (!ssl3_handshake_msg_start(s, &cbb, &session_ticket,
 		    SSL3_MT_NEWSESSION_TICKET))
 			goto err;
 
-		if (!SSL_SESSION_ticket(s->session, &session, &session_len))
-			goto err;
-		if (session_len > 0xffff)
-			goto err;
-
 		/*
-		 * Initialize HMAC and cipher contexts. If callback is present
-		 * it does all the work, otherwise use generated values from
-		 * parent context.
+		 * The peer certificate is only needed on resumption if the
+		 * peer is being verified.
 		 */
-		if (tctx->tlsext_ticket_key_cb != NULL) {
-			if (tctx->tlsext_ticket_key_cb(s,
-			    key_name, iv, ctx, hctx, 1) < 0)
-				goto err;
-		} else {
-			arc4random_buf(iv, 16);
-			EVP_EncryptInit_ex(ctx, EVP_aes_128_cbc(), NULL,
-			    tctx->tlsext_tick_aes_key, iv);
-			HMAC_Init_ex(hctx, tctx->tlsext_tick_hmac_key,
-			    16, EVP_sha256(), NULL);
-			memcpy(key_name, tctx->tlsext_tick_key_name, 16);
-		}
-
-		/* Encrypt the session state. */
-		enc_session_max_len = session_len + EVP_MAX_BLOCK_LENGTH;
-		if ((enc_session = calloc(1, enc_session_max_len)) == NULL)
-			goto err;
-		enc_session_len = 0;
-		if (!EVP_EncryptUpdate(ctx, enc_session, &len, session,
-		    session_len))
-			goto err;
-		enc_session_len += len;
-		if (!EVP_EncryptFinal_ex(ctx, enc_session + enc_session_len,
-		    &len))
-			goto err;
-		enc_session_len += len;
-
-		if (enc_session_len > enc_session_max_len)
-			goto err;
-
-		/* Generate the HMAC. */
-		if (!HMAC_Update(hctx, key_name, sizeof(key_name)))
-			goto err;
-		if (!HMAC_Update(hctx, iv, EVP_CIPHER_CTX_iv_length(ctx)))
-			goto err;
-		if (!HMAC_Update(hctx, enc_session, enc_session_len))
+		if (!SSL_SESSION_ticket(s->session,
+		    (s->verify_mode & SSL_VERIFY_PEER) != 0, &session,
+		    &session_len))
 			goto err;
-
-		if ((hmac_len = HMAC_size(hctx)) <= 0)
+		if (session_len > 0xffff)
 			goto err;
 
 		/*
@@ -2420,18 +2487,7 @@ ssl3_send_newsession_ticket(SSL *s)
 
 		if (!CBB_add_u16_length_prefixed(&session_ticket, &ticket))
 			goto err;
-		if (!CBB_add_bytes(&ticket, key_name, sizeof(key_name)))
-			goto err;
-		if (!CBB_add_bytes(&ticket, iv, EVP_CIPHER_CTX_iv_length(ctx)))
-			goto err;
-		if (!CBB_add_bytes(&ticket, enc_session, enc_session_len))
-			goto err;
-		if (!CBB_add_space(&ticket, &hmac, hmac_len))
-			goto err;
-
-		if (!HMAC_Final(hctx, hmac, &hlen))
-			goto err;
-		if (hlen != hmac_len)
+		if (!ssl3_seal_session_ticket(s, &ticket, session, session_len))
 			goto err;
 
 		if (!ssl3_handshake_msg_finish(s, &cbb))
@@ -2440,20 +2496,14 @@ ssl3_send_newsession_ticket(SSL *s)
 		s->s3->hs.state = SSL3_ST_SW_SESSION_TICKET_B;
 	}
 
-	EVP_CIPHER_CTX_free(ctx);
-	HMAC_CTX_free(hctx);
 	freezero(session, session_len);
-	free(enc_session);
 
 	/* SSL3_ST_SW_SESSION_TICKET_B */
 	return (ssl3_handshake_write(s));
 
  err:
 	CBB_cleanup(&cbb);
-	EVP_CIPHER_CTX_free(ctx);
-	HMAC_CTX_free(hctx);
 	freezero(session, session_len);
-	free(enc_session);
 
 	return (-1);
 }
@@ -1443,9 +1443,10 @@ tlsext_keyshare_client_build(SSL *s, uint16_t msg_type, CBB *cbb)
 static int
 tlsext_keyshare_server_parse(SSL *s, uint16_t msg_type, CBS *cbs, int *alert)
 {
-	CBS client_shares, key_exchange;
+	CBS client_shares, key_exchange, selected_key_exchange;
+	size_t idx, selected_idx = 0;
+	uint16_t group, selected_group = 0;
 	int decode_error;
-	uint16_t group;
 
 	if (!CBS_get_u16_length_prefixed(cbs, &client_shares))
 		return 0;
@@ -1472,21 +1473,40 @@ tlsext_keyshare_server_parse(SSL *s, uint16_t msg_type, CBS *cbs, int *alert)
 		if (s->s3->hs.key_share != NULL)
 			continue;
 
-		/* XXX - consider implementing server preference. */
 		if (!tls1_check_group(s, group))
 			continue;
 
-		/* Decode and store the selected key share. */
-		if ((s->s3->hs.key_share = tls_key_share_new(group)) == NULL) {
+		/*
+		 * Any key share for a group that we support is accepted, even
+		 * if a more preferred group is mutually supported, since a
+		 * hello retry request would cost a round trip. Where multiple
+		 * key shares are acceptable, select the most preferred group,
+		 * falling back to the order in which they were offered.
+		 */
+		if (!tls1_group_preference_index(s, group, &idx))
+			idx = SIZE_MAX;
+
+		if (selected_group != 0 && idx >= selected_idx)
+			continue;
+
+		selected_group = group;
+		selected_idx = idx;
+		selected_key_exchange = key_exchange;
+	}
+
+	if (selected_group == 0)
+		return 1;
+
+	/* Decode and store the selected key share. */
+	if ((s->s3->hs.key_share = tls_key_share_new(selected_group)) == NULL) {
+		*alert = SSL_AD_INTERNAL_ERROR;
+		return 0;
+	}
+	if (!tls_key_share_peer_public(s->s3->hs.key_share,
+	    &selected_key_exchange, &decode_error, NULL)) {
+		if (!decode_error)
 			*alert = SSL_AD_INTERNAL_ERROR;
-			return 0;
-		}
-		if (!tls_key_share_peer_public(s->s3->hs.key_share,
-		    &key_exchange, &decode_error, NULL)) {
-			if (!decode_error)
-				*alert = SSL_AD_INTERNAL_ERROR;
-			return 0;
-		}
+		return 0;
 	}
 
 	return 1;
@@ -1892,6 +1912,89 @@ tlsext_psk_server_parse(SSL *s, uint16_t msg_type, CBS *cbs, int *alert)
 	return CBS_skip(cbs, CBS_len(cbs));
 }
 
+/*
+ * Certificate compression - RFC 8879.
+ */
+
+static int
+tlsext_compress_certificate_client_needs(SSL *s, uint16_t msg_type)
+{
+	size_t i;
+
+	if (s->s3->hs.our_max_tls_version < TLS1_3_VERSION)
+		return 0;
+
+	for (i = 0; i < s->ctx->cert_comp_algs_len; i++) {
+		if (s->ctx->cert_comp_algs[i].decompress != NULL)
+			return 1;
+	}
+
+	return 0;
+}
+
+static int
+tlsext_compress_certificate_client_build(SSL *s, uint16_t msg_type, CBB *cbb)
+{
+	CBB algs;
+	size_t i;
+
+	if (!CBB_add_u8_length_prefixed(cbb, &algs))
+		return 0;
+
+	for (i = 0; i < s->ctx->cert_comp_algs_len; i++) {
+		if (s->ctx->cert_comp_algs[i].decompress == NULL)
+			continue;
+		if (!CBB_add_u16(&algs, s->ctx->cert_comp_algs[i].alg_id))
+			return 0;
+	}
+
+	if (!CBB_flush(cbb))
+		return 0;
+
+	return 1;
+}
+
+static int
+tlsext_compress_certificate_server_parse(SSL *s, uint16_t msg_type, CBS *cbs,
+    int *alert)
+{
+	CBS algs;
+
+	if (!CBS_get_u8_length_prefixed(cbs, &algs))
+		return 0;
+	if (CBS_len(&algs) < 2 || CBS_len(&algs) % 2 != 0)
+		return 0;
+
+	/* The algorithm is selected once the server certificate is known. */
+	if (!CBS_stow(&algs, &s->s3->hs.tls13.cert_comp_algs,
+	    &s->s3->hs.tls13.cert_comp_algs_len)) {
+		*alert = SSL_AD_INTERNAL_ERROR;
+		return 0;
+	}
+
+	return 1;
+}
+
+static int
+tlsext_compress_certificate_server_needs(SSL *s, uint16_t msg_type)
+{
+	/* Compressed client certificates are not supported. */
+	return 0;
+}
+
+static int
+tlsext_compress_certificate_server_build(SSL *s, uint16_t msg_type, CBB *cbb)
+{
+	return 0;
+}
+
+static int
+tlsext_compress_certificate_client_parse(SSL *s, uint16_t msg_type, CBS *cbs,
+    int *alert)
+{
+	return 0;
+}
+
 /*
  * QUIC transport parameters extension - RFC 9001 section 8.2.
  */
@@ -2168,6 +2271,20 @@ static const struct tls_extension tls_extensions[] = {
 			.parse = tlsext_quic_transport_parameters_server_parse,
 		},
 	},
+	{
+		.type = TLSEXT_TYPE_compress_certificate,
+		.messages = SSL_TLSEXT_MSG_CH,
+		.client = {
+			.needs = tlsext_compress_certificate_client_needs,
+			.build = tlsext_compress_certificate_client_build,
+			.parse = tlsext_compress_certificate_client_parse,
+		},
+		.server = {
+			.needs = tlsext_compress_certificate_server_needs,
+			.build = tlsext_compress_certificate_server_build,
+			.parse = tlsext_compress_certificate_server_parse,
+		},
+	},
 	{
 		.type = TLSEXT_TYPE_psk_key_exchange_modes,
 		.messages = SSL_TLSEXT_MSG_CH,
@@ -2317,9 +2434,9 @@ tlsext_clienthello_hash_extension(SSL *s, uint16_t type, CBS *cbs)
 static int
 tlsext_parse(SSL *s, int is_server, uint16_t msg_type, CBS *cbs, int *alert)
 {
-	const struct tls_extension_funcs *ext;
+	const struct tls_extension_funcs *ext, *key_share_ext = NULL;
 	const struct tls_extension *tlsext;
-	CBS extensions, extension_data;
+	CBS extensions, extension_data, key_share;
 	uint16_t type;
 	size_t idx;
 	uint16_t tls_version;
@@ -2374,6 +2491,18 @@ tlsext_parse(SSL *s, int is_server, uint16_t msg_type, CBS *cbs, int *alert)
 		s->s3->hs.extensions_seen |= (1 << idx);
 
 		ext = tlsext_funcs(tlsext, is_server);
+
+		/*
+		 * A server selects between the client's key shares using the
+		 * client's supported groups, hence the key share extension is
+		 * parsed once all other extensions have been.
+		 */
+		if (is_server && type == TLSEXT_TYPE_key_share) {
+			key_share_ext = ext;
+			key_share = extension_data;
+			continue;
+		}
+
 		if (!ext->parse(s, msg_type, &extension_data, &alert_desc))
 			goto err;
 
@@ -2381,6 +2510,13 @@ tlsext_parse(SSL *s, int is_server, uint16_t msg_type, CBS *cbs, int *alert)
 			goto err;
 	}
 
+	if (key_share_ext != NULL) {
+		if (!key_share_ext->parse(s, msg_type, &key_share, &alert_desc))
+			goto err;
+		if (CBS_len(&key_share) != 0)
+			goto err;
+	}
+
 	return 1;
 
  err:
@@ -151,8 +151,10 @@ tls1_clear(SSL *s)
 }
 
 struct supported_group {
+	uint16_t group_id;
 	int nid;
 	int bits;
+	int tls13_only;
 };
 
 /*
@@ -160,122 +162,157 @@ struct supported_group {
  * https://www.iana.org/assignments/tls-parameters/#tls-parameters-8
  */
 static const struct supported_group nid_list[] = {
-	[1] = {
+	{
+		.group_id = 1,
 		.nid = NID_sect163k1,
 		.bits = 80,
 	},
-	[2] = {
+	{
+		.group_id = 2,
 		.nid = NID_sect163r1,
 		.bits = 80,
 	},
-	[3] = {
+	{
+		.group_id = 3,
 		.nid = NID_sect163r2,
 		.bits = 80,
 	},
-	[4] = {
+	{
+		.group_id = 4,
 		.nid = NID_sect193r1,
 		.bits = 80,
 	},
-	[5] = {
+	{
+		.group_id = 5,
 		.nid = NID_sect193r2,
 		.bits = 80,
 	},
-	[6] = {
+	{
+		.group_id = 6,
 		.nid = NID_sect233k1,
 		.bits = 112,
 	},
-	[7] = {
+	{
+		.group_id = 7,
 		.nid = NID_sect233r1,
 		.bits = 112,
 	},
-	[8] = {
+	{
+		.group_id = 8,
 		.nid = NID_sect239k1,
 		.bits = 112,
 	},
-	[9] = {
+	{
+		.group_id = 9,
 		.nid = NID_sect283k1,
 		.bits = 128,
 	},
-	[10] = {
+	{
+		.group_id = 10,
 		.nid = NID_sect283r1,
 		.bits = 128,
 	},
-	[11] = {
+	{
+		.group_id = 11,
 		.nid = NID_sect409k1,
 		.bits = 192,
 	},
-	[12] = {
+	{
+		.group_id = 12,
 		.nid = NID_sect409r1,
 		.bits = 192,
 	},
-	[13] = {
+	{
+		.group_id = 13,
 		.nid = NID_sect571k1,
 		.bits = 256,
 	},
-	[14] = {
+	{
+		.group_id = 14,
 		.nid = NID_sect571r1,
 		.bits = 256,
 	},
-	[15] = {
+	{
+		.group_id = 15,
 		.nid = NID_secp160k1,
 		.bits = 80,
 	},
-	[16] = {
+	{
+		.group_id = 16,
 		.nid = NID_secp160r1,
 		.bits = 80,
 	},
-	[17] = {
+	{
+		.group_id = 17,
 		.nid = NID_secp160r2,
 		.bits = 80,
 	},
-	[18] = {
+	{
+		.group_id = 18,
 		.nid = NID_secp192k1,
 		.bits = 80,
 	},
-	[19] = {
+	{
+		.group_id = 19,
 		.nid = NID_X9_62_prime192v1,	/* aka secp192r1 */
 		.bits = 80,
 	},
-	[20] = {
+	{
+		.group_id = 20,
 		.nid = NID_secp224k1,
 		.bits = 112,
 	},
-	[21] = {
+	{
+		.group_id = 21,
 		.nid = NID_secp224r1,
 		.bits = 112,
 	},
-	[22] = {
+	{
+		.group_id = 22,
 		.nid = NID_secp256k1,
 		.bits = 128,
 	},
-	[23] = {
+	{
+		.group_id = 23,
 		.nid = NID_X9_62_prime256v1,	/* aka secp256r1 */
 		.bits = 128,
 	},
-	[24] = {
+	{
+		.group_id = 24,
 		.nid = NID_secp384r1,
 		.bits = 192,
 	},
-	[25] = {
+	{
+		.group_id = 25,
 		.nid = NID_secp521r1,
 		.bits = 256,
 	},
-	[26] = {
+	{
+		.group_id = 26,
 		.nid = NID_brainpoolP256r1,
 		.bits = 128,
 	},
-	[27] = {
+	{
+		.group_id = 27,
 		.nid = NID_brainpoolP384r1,
 		.bits = 192,
 	},
-	[28] = {
+	{
+		.group_id = 28,
 		.nid = NID_brainpoolP512r1,
 		.bits = 256,
 	},
-	[29] = {
+	{
+		.group_id = 29,
 		.nid = NID_X25519,
 		.bits = 128,
 	},
+	{
+		.group_id = 4588,
+		.nid = NID_X25519MLKEM768,
+		.bits = 128,
+		.tls13_only = 1,
+	},
 };
 
 #define NID_LIST_LEN (sizeof(nid_list) / sizeof(nid_list[0]))
@@ -334,23 +371,34 @@ static const uint16_t ecgroups_client_default[] = {
 };
 
 static const uint16_t ecgroups_server_default[] = {
+	4588,			/* X25519MLKEM768 (4588) */
 	29,			/* X25519 (29) */
 	23,			/* secp256r1 (23) */
 	24,			/* secp384r1 (24) */
 };
 
+static const struct supported_group *
+tls1_supported_group_by_id(uint16_t group_id)
+{
+	size_t i;
+
+	for (i = 0; i < NID_LIST_LEN; i++) {
+		if (nid_list[i].group_id == group_id)
+			return &nid_list[i];
+	}
+
+	return NULL;
+}
+
 int
 tls1_ec_group_id2nid(uint16_t group_id, int *out_nid)
 {
-	int nid;
-
-	if (group_id >= NID_LIST_LEN)
-		return 0;
+	const struct supported_group *sg;
 
-	if ((nid = nid_list[group_id].nid) == 0)
+	if ((sg = tls1_supported_group_by_id(group_id)) == NULL)
 		return 0;
 
-	*out_nid = nid;
+	*out_nid = sg->nid;
 
 	return 1;
 }
@@ -358,15 +406,12 @@ tls1_ec_group_id2nid(uint16_t group_id, int *out_nid)
 int
 tls1_ec_group_id2bits(uint16_t group_id, int *out_bits)
 {
-	int bits;
+	const struct supported_group *sg;
 
-	if (group_id >= NID_LIST_LEN)
+	if ((sg = tls1_supported_group_by_id(group_id)) == NULL)
 		return 0;
 
-	if ((bits = nid_list[group_id].bits) == 0)
-		return 0;
-
-	*out_bits = bits;
+	*out_bits = sg->bits;
 
 	return 1;
 }
@@ -374,14 +419,14 @@ tls1_ec_group_id2bits(uint16_t group_id, int *out_bits)
 int
 tls1_ec_nid2group_id(int nid, uint16_t *out_group_id)
 {
-	uint16_t group_id;
+	size_t i;
 
 	if (nid == 0)
 		return 0;
 
-	for (group_id = 0; group_id < NID_LIST_LEN; group_id++) {
-		if (nid_list[group_id].nid == nid) {
-			*out_group_id = group_id;
+	for (i = 0; i < NID_LIST_LEN; i++) {
+		if (nid_list[i].nid == nid) {
+			*out_group_id = nid_list[i].group_id;
 			return 1;
 		}
 	}
@@ -389,6 +434,21 @@ tls1_ec_nid2group_id(int nid, uint16_t *out_group_id)
 	return 0;
 }
 
+/*
+ * Hybrid post-quantum groups only define key shares for TLSv1.3 and cannot
+ * be used for ECDHE in earlier versions.
+ */
+int
+tls1_group_id_is_tls13_only(uint16_t group_id)
+{
+	const struct supported_group *sg;
+
+	if ((sg = tls1_supported_group_by_id(group_id)) == NULL)
+		return 0;
+
+	return sg->tls13_only;
+}
+
 /*
  * Return the appropriate format list. If client_formats is non-zero, return
  * the client/session formats. Otherwise return the custom format list if one
@@ -514,6 +574,10 @@ tls1_group_by_index(const SSL *ssl, size_t n, int *out_nid,
 		if (!ssl_security_fn(ssl, pref[i]))
 			continue;
 
+		if (ssl->s3->hs.negotiated_tls_version < TLS1_3_VERSION &&
+		    tls1_group_id_is_tls13_only(pref[i]))
+			continue;
+
 		if (count++ == n)
 			return tls1_ec_group_id2nid(pref[i], out_nid);
 	}
@@ -624,6 +688,150 @@ tls1_check_group(SSL *s, uint16_t group_id)
 	return 0;
 }
 
+/*
+ * Find the position of a group in the list that is used to select between
+ * groups, which is the server's list if server preference is enabled or the
+ * client's list otherwise.
+ */
+int
+tls1_group_preference_index(const SSL *ssl, uint16_t group_id,
+    size_t *out_index)
+{
+	size_t preflen, supplen, i;
+	const uint16_t *pref, *supp;
+
+	if (!tls1_get_group_lists(ssl, &pref, &preflen, &supp, &supplen))
+		return 0;
+
+	for (i = 0; i < preflen; i++) {
+		if (pref[i] == group_id) {
+			*out_index = i;
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+static int
+tls1_group_cache_lookup(SSL *s, uint16_t *out_group_id)
+{
+	SSL_CTX *ctx = s->initial_ctx;
+	time_t now;
+	size_t i;
+	int ret = 0;
+
+	if (s->tlsext_hostname == NULL)
+		return 0;
+
+	now = time(NULL);
+
+	pthread_rwlock_rdlock(&ctx->group_cache_lock);
+	for (i = 0; i < SSL_GROUP_CACHE_SIZE; i++) {
+		if (ctx->group_cache[i].hostname == NULL)
+			continue;
+		if (strcmp(ctx->group_cache[i].hostname,
+		    s->tlsext_hostname) != 0)
+			continue;
+		if (ctx->group_cache[i].expires > now) {
+			*out_group_id = ctx->group_cache[i].group_id;
+			ret = 1;
+		}
+		break;
+	}
+	pthread_rwlock_unlock(&ctx->group_cache_lock);
+
+	return ret;
+}
+
+/*
+ * Remember the group that a server selected via a hello retry request, so
+ * that the next connection to the same host can offer a key share for that
+ * group in the initial ClientHello and avoid a round trip. Entries expire,
+ * so that our most preferred group is offered again should the server come
+ * to support it.
+ */
+void
+tls1_group_cache_update(SSL *s, uint16_t group_id)
+{
+	struct ssl_group_cache_entry *entry = NULL;
+	SSL_CTX *ctx = s->initial_ctx;
+	char *hostname;
+	size_t i;
+
+	if (s->server || s->tlsext_hostname == NULL)
+		return;
+
+	pthread_rwlock_wrlock(&ctx->group_cache_lock);
+	for (i = 0; i < SSL_GROUP_CACHE_SIZE; i++) {
+		if (ctx->group_cache[i].hostname == NULL)
+			continue;
+		if (strcmp(ctx->group_cache[i].hostname,
+		    s->tlsext_hostname) == 0) {
+			entry = &ctx->group_cache[i];
+			break;
+		}
+	}
+	if (entry == NULL) {
+		if ((hostname = strdup(s->tlsext_hostname)) == NULL)
+			goto done;
+		entry = &ctx->group_cache[ctx->group_cache_next];
+		ctx->group_cache_next = (ctx->group_cache_next + 1) %
+		    SSL_GROUP_CACHE_SIZE;
+		free(entry->hostname);
+		entry->hostname = hostname;
+	}
+	entry->group_id = group_id;
+	entry->expires = time(NULL) + SSL_GROUP_CACHE_TIMEOUT;
+
+ done:
+	pthread_rwlock_unlock(&ctx->group_cache_lock);
+}
+
+void
+tls1_group_cache_free(SSL_CTX *ctx)
+{
+	size_t i;
+
+	for (i = 0; i < SSL_GROUP_CACHE_SIZE; i++) {
+		free(ctx->group_cache[i].hostname);
+		ctx->group_cache[i].hostname = NULL;
+	}
+}
+
+/*
+ * Determine the group to use for the key share in a TLSv1.3 ClientHello -
+ * this is the group requested via SSL_set_key_share_group(), the group that
+ * the server previously selected, or otherwise our most preferred group.
+ */
+int
+tls1_get_key_share_group(SSL *s, uint16_t *out_group_id)
+{
+	const uint16_t *groups;
+	size_t groups_len;
+	uint16_t group_id;
+
+	if (s->key_share_group != 0 &&
+	    tls1_check_group(s, s->key_share_group)) {
+		*out_group_id = s->key_share_group;
+		return 1;
+	}
+
+	if (tls1_group_cache_lookup(s, &group_id) &&
+	    tls1_check_group(s, group_id)) {
+		*out_group_id = group_id;
+		return 1;
+	}
+
+	tls1_get_group_list(s, 0, &groups, &groups_len);
+	if (groups_len < 1)
+		return 0;
+
+	*out_group_id = groups[0];
+
+	return 1;
+}
+
 /* For an EC key set TLS ID and required compression based on parameters. */
 static int
 tls1_set_ec_id(uint16_t *group_id, uint8_t *comp_id, EC_KEY *ec)
@@ -780,9 +988,10 @@ ssl_check_clienthello_tlsext_late(SSL *s)
 			return 1;
 		}
 		/* Set current certificate to one we will use so
-		 * SSL_get_certificate et al can pick it up.
+		 * SSL_get_certificate et al can pick it up, without
+		 * modifying the SSL_CERT that may be shared with the SSL_CTX.
 		 */
-		s->cert->key = certpkey;
+		s->status_cert_idx = certpkey - &s->cert->pkeys[0];
 		r = s->ctx->tlsext_status_cb(s,
 		    s->ctx->tlsext_status_arg);
 		switch (r) {
@@ -964,6 +1173,69 @@ tls1_process_ticket(SSL *s, CBS *ext_block, int *alert, SSL_SESSION **ret)
 	return tls_decrypt_ticket(s, &ext_data, alert, ret);
 }
 
+/*
+ * Decrypt a session ticket using the ticket AEAD method, with the same
+ * return values as tls_decrypt_ticket.
+ */
+static int
+tls_decrypt_ticket_aead(SSL *s, CBS *ticket, int *alert, SSL_SESSION **psess)
+{
+	const SSL_TICKET_AEAD_METHOD *aead_method =
+	    s->initial_ctx->ticket_aead_method;
+	SSL_SESSION *sess = NULL;
+	unsigned char *sdec = NULL;
+	size_t sdec_len = 0, slen = 0;
+	int ret = TLS1_TICKET_FATAL_ERROR;
+
+	*psess = NULL;
+
+	sdec_len = CBS_len(ticket);
+	if ((sdec = calloc(1, sdec_len)) == NULL)
+		goto err;
+
+	switch (aead_method->open(s, sdec, &slen, sdec_len, CBS_data(ticket),
+	    CBS_len(ticket))) {
+	case ssl_ticket_aead_success:
+		break;
+	case ssl_ticket_aead_renew:
+		s->tlsext_ticket_expected = 1;
+		break;
+	case ssl_ticket_aead_ignore_ticket:
+		goto derr;
+	default:
+		goto err;
+	}
+	if (slen > sdec_len)
+		goto err;
+
+	/*
+	 * For session parse failures, indicate that we need to send a new
+	 * ticket.
+	 */
+	if ((sess = SSL_SESSION_from_ticket(sdec, slen)) == NULL)
+		goto derr;
+	*psess = sess;
+
+	ret = TLS1_TICKET_DECRYPTED;
+	goto done;
+
+ derr:
+	ERR_clear_error();
+	s->tlsext_ticket_expected = 1;
+	ret = TLS1_TICKET_NOT_DECRYPTED;
+	goto done;
+
+ err:
+	*alert = SSL_AD_INTERNAL_ERROR;
+	ret = TLS1_TICKET_FATAL_ERROR;
+	goto done;
+
+ done:
+	freezero(sdec, sdec_len);
+
+	return ret;
+}
+
 /* tls_decrypt_ticket attempts to decrypt a session ticket.
  *
  *   ticket: a CBS containing the body of the session ticket extension.
@@ -982,7 +1254,6 @@ tls_decrypt_ticket(SSL *s, CBS *ticket, int *alert, SSL_SESSION **psess)
 	SSL_SESSION *sess = NULL;
 	unsigned char *sdec = NULL;
 	size_t sdec_len = 0;
-	const unsigned char *p;
 	unsigned char hmac[EVP_MAX_MD_SIZE];
 	HMAC_CTX *hctx = NULL;
 	EVP_CIPHER_CTX *cctx = NULL;
@@ -993,6 +1264,9 @@ tls_decrypt_ticket(SSL *s, CBS *ticket, int *alert, SSL_SESSION **psess)
 
 	*psess = NULL;
 
+	if (tctx->ticket_aead_method != NULL)
+		return tls_decrypt_ticket_aead(s, ticket, alert, psess);
+
 	if (!CBS_get_bytes(ticket, &ticket_name, 16))
 		goto derr;
 
@@ -1102,8 +1376,7 @@ tls_decrypt_ticket(SSL *s, CBS *ticket, int *alert, SSL_SESSION **psess)
 	 * For session parse failures, indicate that we need to send a new
 	 * ticket.
 	 */
-	p = sdec;
-	if ((sess = d2i_SSL_SESSION(NULL, &p, slen)) == NULL)
+	if ((sess = SSL_SESSION_from_ticket(sdec, slen)) == NULL)
 		goto derr;
 	*psess = sess;
 	sess = NULL;
@@ -255,6 +255,11 @@ extern "C" {
 /* ExtensionType value from RFC 7685. */
 #define TLSEXT_TYPE_padding	21
 
+/* ExtensionType value from RFC 8879. */
+#if defined(LIBRESSL_HAS_TLS1_3) || defined(LIBRESSL_INTERNAL)
+#define TLSEXT_TYPE_compress_certificate	27
+#endif
+
 /* ExtensionType value from RFC 4507. */
 #define TLSEXT_TYPE_session_ticket		35
 
@@ -289,6 +294,13 @@ extern "C" {
 /* Temporary extension type */
 #define TLSEXT_TYPE_renegotiate                 0xff01
 
+/* CertificateCompressionAlgorithm values from RFC 8879. */
+#if defined(LIBRESSL_HAS_TLS1_3) || defined(LIBRESSL_INTERNAL)
+#define TLSEXT_cert_compression_zlib		1
+#define TLSEXT_cert_compression_brotli		2
+#define TLSEXT_cert_compression_zstd		3
+#endif
+
 /* NameType value from RFC 3546. */
 #define TLSEXT_NAMETYPE_host_name 0
 /* status request value from RFC 3546 */
@@ -27,8 +27,7 @@
 int
 tls13_client_init(struct tls13_ctx *ctx)
 {
-	const uint16_t *groups;
-	size_t groups_len;
+	uint16_t group_id;
 	SSL *s = ctx->ssl;
 
 	if (!ssl_supported_tls_version_range(s, &ctx->hs->our_min_tls_version,
@@ -47,11 +46,13 @@ tls13_client_init(struct tls13_ctx *ctx)
 	if (!tls1_transcript_init(s))
 		return 0;
 
-	/* Generate a key share using our preferred group. */
-	tls1_get_group_list(s, 0, &groups, &groups_len);
-	if (groups_len < 1)
+	/*
+	 * Generate a key share using our preferred group, unless the server
+	 * is known to select a different group.
+	 */
+	if (!tls1_get_key_share_group(s, &group_id))
 		return 0;
-	if ((ctx->hs->key_share = tls_key_share_new(groups[0])) == NULL)
+	if ((ctx->hs->key_share = tls_key_share_new(group_id)) == NULL)
 		return 0;
 	if (!tls_key_share_generate(ctx->hs->key_share))
 		return 0;
@@ -445,6 +446,8 @@ tls13_client_hello_retry_send(struct tls13_ctx *ctx, CBB *cbb)
 	if (ctx->hs->tls13.server_group == tls_key_share_group(ctx->hs->key_share))
 		return 0; /* XXX alert */
 
+	tls1_group_cache_update(ctx->ssl, ctx->hs->tls13.server_group);
+
 	/* Switch to new key share. */
 	tls_key_share_free(ctx->hs->key_share);
 	if ((ctx->hs->key_share =
@@ -522,7 +525,9 @@ tls13_server_certificate_request_recv(struct tls13_ctx *ctx, CBS *cbs)
 	 * request... in that case we call the certificate handler after
 	 * switching state, to avoid advancing state.
 	 */
-	if (tls13_handshake_msg_type(ctx->hs_msg) == TLS13_MT_CERTIFICATE) {
+	if (tls13_handshake_msg_type(ctx->hs_msg) == TLS13_MT_CERTIFICATE ||
+	    tls13_handshake_msg_type(ctx->hs_msg) ==
+	    TLS13_MT_COMPRESSED_CERTIFICATE) {
 		ctx->handshake_stage.hs_type |= WITHOUT_CR;
 		return tls13_server_certificate_recv(ctx, cbs);
 	}
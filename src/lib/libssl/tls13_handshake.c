@@ -291,6 +291,8 @@ tls13_handshake_message_name(uint8_t msg_type)
 		return "CertificateVerify";
 	case TLS13_MT_FINISHED:
 		return "Finished";
+	case TLS13_MT_COMPRESSED_CERTIFICATE:
+		return "CompressedCertificate";
 	}
 	return "Unknown";
 }
@@ -441,6 +443,7 @@ static int
 tls13_handshake_send_action(struct tls13_ctx *ctx,
     const struct tls13_handshake_action *action)
 {
+	uint8_t msg_type;
 	ssize_t ret;
 	CBB cbb;
 
@@ -456,13 +459,28 @@ tls13_handshake_send_action(struct tls13_ctx *ctx,
 
 	/* If we have no handshake message, we need to build one. */
 	if (ctx->hs_msg == NULL) {
+		/*
+		 * A server that has negotiated certificate compression sends
+		 * a CompressedCertificate in place of its Certificate.
+		 */
+		msg_type = action->handshake_type;
+		if (msg_type == TLS13_MT_CERTIFICATE &&
+		    ctx->mode == TLS13_HS_SERVER &&
+		    ctx->hs->tls13.cert_comp_alg != 0)
+			msg_type = TLS13_MT_COMPRESSED_CERTIFICATE;
+
 		if ((ctx->hs_msg = tls13_handshake_msg_new()) == NULL)
 			return TLS13_IO_FAILURE;
-		if (!tls13_handshake_msg_start(ctx->hs_msg, &cbb,
-		    action->handshake_type))
-			return TLS13_IO_FAILURE;
-		if (!action->send(ctx, &cbb))
+		if (!tls13_handshake_msg_start(ctx->hs_msg, &cbb, msg_type))
 			return TLS13_IO_FAILURE;
+		if (!action->send(ctx, &cbb)) {
+			if (!ctx->hs->private_key_op_pending)
+				return TLS13_IO_FAILURE;
+			/* Start over once the signature has been completed. */
+			tls13_handshake_msg_free(ctx->hs_msg);
+			ctx->hs_msg = NULL;
+			return TLS13_IO_WANT_PRIVATE_KEY;
+		}
 		if (!tls13_handshake_msg_finish(ctx->hs_msg))
 			return TLS13_IO_FAILURE;
 	}
@@ -505,6 +523,8 @@ static int
 tls13_handshake_recv_action(struct tls13_ctx *ctx,
     const struct tls13_handshake_action *action)
 {
+	uint8_t *cert_msg = NULL;
+	size_t cert_msg_len = 0;
 	uint8_t msg_type;
 	ssize_t ret;
 	CBS cbs;
@@ -537,6 +557,9 @@ tls13_handshake_recv_action(struct tls13_ctx *ctx,
 	 * here. The receive handler also knows how to deal with this situation.
 	 */
 	msg_type = tls13_handshake_msg_type(ctx->hs_msg);
+	if (msg_type == TLS13_MT_COMPRESSED_CERTIFICATE &&
+	    ctx->mode == TLS13_HS_CLIENT)
+		msg_type = TLS13_MT_CERTIFICATE;
 	if (msg_type != action->handshake_type &&
 	    (msg_type != TLS13_MT_CERTIFICATE ||
 	     action->handshake_type != TLS13_MT_CERTIFICATE_REQUEST))
@@ -545,6 +568,14 @@ tls13_handshake_recv_action(struct tls13_ctx *ctx,
 	if (!tls13_handshake_msg_content(ctx->hs_msg, &cbs))
 		return TLS13_IO_FAILURE;
 
+	/* Decompress and process the Certificate message in its place. */
+	if (tls13_handshake_msg_type(ctx->hs_msg) != msg_type) {
+		if (!tls13_cert_decompress(ctx, &cbs, &cert_msg,
+		    &cert_msg_len))
+			return TLS13_IO_FAILURE;
+		CBS_init(&cbs, cert_msg, cert_msg_len);
+	}
+
 	ret = TLS13_IO_FAILURE;
 	if (action->recv(ctx, &cbs)) {
 		if (CBS_len(&cbs) != 0) {
@@ -556,6 +587,8 @@ tls13_handshake_recv_action(struct tls13_ctx *ctx,
 		}
 	}
 
+	free(cert_msg);
+
 	tls13_handshake_msg_free(ctx->hs_msg);
 	ctx->hs_msg = NULL;
 
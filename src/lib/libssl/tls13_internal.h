@@ -41,6 +41,7 @@ __BEGIN_HIDDEN_DECLS
 #define TLS13_IO_USE_LEGACY		-6
 #define TLS13_IO_RECORD_VERSION		-7
 #define TLS13_IO_RECORD_OVERFLOW	-8
+#define TLS13_IO_WANT_PRIVATE_KEY	-9
 
 #define TLS13_ERR_VERIFY_FAILED		16
 #define TLS13_ERR_HRR_FAILED		17
@@ -253,6 +254,7 @@ struct tls13_handshake_stage {
 	uint8_t	message_number;
 };
 
+struct ssl_cert_list;
 struct ssl_handshake_tls13_st;
 
 struct tls13_error {
@@ -360,6 +362,7 @@ int tls13_legacy_servername_process(struct tls13_ctx *ctx, uint8_t *alert);
 #define	TLS13_MT_CERTIFICATE_STATUS_RESERVED	22
 #define	TLS13_MT_SUPPLEMENTAL_DATA_RESERVED	23
 #define	TLS13_MT_KEY_UPDATE			24
+#define	TLS13_MT_COMPRESSED_CERTIFICATE		25
 #define	TLS13_MT_MESSAGE_HASH			254
 
 int tls13_handshake_msg_record(struct tls13_ctx *ctx);
@@ -405,6 +408,14 @@ int tls13_server_finished_sent(struct tls13_ctx *ctx);
 void tls13_error_clear(struct tls13_error *error);
 int tls13_cert_add(struct tls13_ctx *ctx, CBB *cbb, X509 *cert,
     int(*build_extensions)(SSL *s, uint16_t msg_type, CBB *cbb));
+int tls13_cert_add_der(struct tls13_ctx *ctx, CBB *cbb, const uint8_t *der,
+    size_t der_len,
+    int(*build_extensions)(SSL *s, uint16_t msg_type, CBB *cbb));
+int tls13_cert_comp_select(struct tls13_ctx *ctx);
+int tls13_cert_compress(struct tls13_ctx *ctx, CBB *cbb,
+    struct ssl_cert_list *cl, const uint8_t *cert_msg, size_t cert_msg_len);
+int tls13_cert_decompress(struct tls13_ctx *ctx, CBS *cbs,
+    uint8_t **out_cert_msg, size_t *out_cert_msg_len);
 
 int tls13_synthetic_handshake_message(struct tls13_ctx *ctx);
 int tls13_clienthello_hash_init(struct tls13_ctx *ctx);
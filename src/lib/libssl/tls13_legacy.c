@@ -195,6 +195,10 @@ tls13_legacy_return_code(SSL *ssl, ssize_t ret)
 		ssl->rwstate = SSL_WRITING;
 		return -1;
 
+	case TLS13_IO_WANT_PRIVATE_KEY:
+		ssl->rwstate = SSL_PRIVATE_KEY_OPERATION;
+		return -1;
+
 	case TLS13_IO_WANT_RETRY:
 		SSLerror(ssl, ERR_R_INTERNAL_ERROR);
 		return -1;
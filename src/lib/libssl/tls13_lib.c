@@ -549,11 +549,30 @@ tls13_ctx_free(struct tls13_ctx *ctx)
 	freezero(ctx, sizeof(struct tls13_ctx));
 }
 
+static int
+tls13_cert_add_extensions(struct tls13_ctx *ctx, CBB *cbb,
+    int (*build_extensions)(SSL *s, uint16_t msg_type, CBB *cbb))
+{
+	CBB cert_exts;
+
+	if (build_extensions != NULL) {
+		if (!build_extensions(ctx->ssl, SSL_TLSEXT_MSG_CT, cbb))
+			return 0;
+	} else {
+		if (!CBB_add_u16_length_prefixed(cbb, &cert_exts))
+			return 0;
+	}
+	if (!CBB_flush(cbb))
+		return 0;
+
+	return 1;
+}
+
 int
 tls13_cert_add(struct tls13_ctx *ctx, CBB *cbb, X509 *cert,
     int (*build_extensions)(SSL *s, uint16_t msg_type, CBB *cbb))
 {
-	CBB cert_data, cert_exts;
+	CBB cert_data;
 	uint8_t *data;
 	int cert_len;
 
@@ -566,17 +585,203 @@ tls13_cert_add(struct tls13_ctx *ctx, CBB *cbb, X509 *cert,
 		return 0;
 	if (i2d_X509(cert, &data) != cert_len)
 		return 0;
-	if (build_extensions != NULL) {
-		if (!build_extensions(ctx->ssl, SSL_TLSEXT_MSG_CT, cbb))
-			return 0;
-	} else {
-		if (!CBB_add_u16_length_prefixed(cbb, &cert_exts))
-			return 0;
+
+	return tls13_cert_add_extensions(ctx, cbb, build_extensions);
+}
+
+int
+tls13_cert_add_der(struct tls13_ctx *ctx, CBB *cbb, const uint8_t *der,
+    size_t der_len,
+    int (*build_extensions)(SSL *s, uint16_t msg_type, CBB *cbb))
+{
+	CBB cert_data;
+
+	if (!CBB_add_u24_length_prefixed(cbb, &cert_data))
+		return 0;
+	if (!CBB_add_bytes(&cert_data, der, der_len))
+		return 0;
+
+	return tls13_cert_add_extensions(ctx, cbb, build_extensions);
+}
+
+/*
+ * Select the algorithm used to compress our Certificate message, being the
+ * first of our algorithms that was also offered by the peer (RFC 8879).
+ */
+int
+tls13_cert_comp_select(struct tls13_ctx *ctx)
+{
+	const struct ssl_cert_comp_alg *alg;
+	SSL *s = ctx->ssl;
+	uint16_t alg_id;
+	size_t i;
+	CBS algs;
+
+	ctx->hs->tls13.cert_comp_alg = 0;
+
+	for (i = 0; i < s->ctx->cert_comp_algs_len; i++) {
+		alg = &s->ctx->cert_comp_algs[i];
+		if (alg->compress == NULL)
+			continue;
+
+		CBS_init(&algs, ctx->hs->tls13.cert_comp_algs,
+		    ctx->hs->tls13.cert_comp_algs_len);
+		while (CBS_len(&algs) > 0) {
+			if (!CBS_get_u16(&algs, &alg_id))
+				return 0;
+			if (alg_id == alg->alg_id) {
+				ctx->hs->tls13.cert_comp_alg = alg_id;
+				return 1;
+			}
+		}
+	}
+
+	return 1;
+}
+
+/*
+ * Build a CompressedCertificate message from the given Certificate message.
+ * If the certificate list is known, the compressed message is cached on it
+ * and reused for as long as the Certificate message remains the same.
+ */
+int
+tls13_cert_compress(struct tls13_ctx *ctx, CBB *cbb, struct ssl_cert_list *cl,
+    const uint8_t *cert_msg, size_t cert_msg_len)
+{
+	const struct ssl_cert_comp_alg *alg;
+	uint16_t alg_id = ctx->hs->tls13.cert_comp_alg;
+	struct ssl_cert_comp_cache *cache = NULL, *expected = NULL;
+	uint8_t *data = NULL;
+	size_t data_len = 0, comp_len = 0;
+	const uint8_t *comp = NULL;
+	SSL *s = ctx->ssl;
+	CBB compressed;
+	int ret = 0;
+
+	if ((alg = ssl_cert_comp_alg_find(s->ctx, alg_id)) == NULL ||
+	    alg->compress == NULL)
+		goto err;
+
+	if (cl != NULL) {
+		expected = __atomic_load_n(&cl->comp, __ATOMIC_ACQUIRE);
+		if (expected != NULL && expected->alg_id == alg_id &&
+		    expected->in_len == cert_msg_len &&
+		    memcmp(expected->in, cert_msg, cert_msg_len) == 0) {
+			comp = expected->out;
+			comp_len = expected->out_len;
+		}
+	}
+
+	if (comp == NULL) {
+		if (!alg->compress(s, &data, &data_len, cert_msg, cert_msg_len))
+			goto err;
+		comp = data;
+		comp_len = data_len;
+
+		/* The first compressed message is cached, others are not. */
+		if (cl != NULL && expected == NULL &&
+		    (cache = calloc(1, sizeof(*cache))) != NULL &&
+		    (cache->in = malloc(cert_msg_len)) != NULL) {
+			memcpy(cache->in, cert_msg, cert_msg_len);
+			cache->in_len = cert_msg_len;
+			cache->alg_id = alg_id;
+			cache->out = data;
+			cache->out_len = data_len;
+
+			if (__atomic_compare_exchange_n(&cl->comp, &expected,
+			    cache, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+				cache = NULL;
+				data = NULL;
+			} else {
+				cache->out = NULL;
+			}
+		}
 	}
+
+	if (comp_len == 0)
+		goto err;
+
+	if (!CBB_add_u16(cbb, alg_id))
+		goto err;
+	if (!CBB_add_u24(cbb, cert_msg_len))
+		goto err;
+	if (!CBB_add_u24_length_prefixed(cbb, &compressed))
+		goto err;
+	if (!CBB_add_bytes(&compressed, comp, comp_len))
+		goto err;
 	if (!CBB_flush(cbb))
-		return 0;
+		goto err;
+
+	ret = 1;
+
+ err:
+	if (cache != NULL)
+		free(cache->in);
+	free(cache);
+	free(data);
+
+	return ret;
+}
+
+/*
+ * Decompress a CompressedCertificate message, returning the Certificate
+ * message that it contains.
+ */
+int
+tls13_cert_decompress(struct tls13_ctx *ctx, CBS *cbs, uint8_t **out_cert_msg,
+    size_t *out_cert_msg_len)
+{
+	const struct ssl_cert_comp_alg *alg;
+	uint8_t *cert_msg = NULL;
+	uint32_t cert_msg_len;
+	SSL *s = ctx->ssl;
+	uint16_t alg_id;
+	CBS compressed;
+
+	*out_cert_msg = NULL;
+	*out_cert_msg_len = 0;
+
+	if (!CBS_get_u16(cbs, &alg_id))
+		goto decode_err;
+	if (!CBS_get_u24(cbs, &cert_msg_len))
+		goto decode_err;
+	if (!CBS_get_u24_length_prefixed(cbs, &compressed))
+		goto decode_err;
+	if (CBS_len(&compressed) == 0 || CBS_len(cbs) != 0)
+		goto decode_err;
+
+	/* The algorithm must be one that we offered. */
+	if ((alg = ssl_cert_comp_alg_find(s->ctx, alg_id)) == NULL ||
+	    alg->decompress == NULL) {
+		ctx->alert = TLS13_ALERT_ILLEGAL_PARAMETER;
+		goto err;
+	}
+
+	if (cert_msg_len == 0 || cert_msg_len > (unsigned long)s->max_cert_list) {
+		ctx->alert = TLS13_ALERT_BAD_CERTIFICATE;
+		goto err;
+	}
+	if ((cert_msg = malloc(cert_msg_len)) == NULL) {
+		ctx->alert = TLS13_ALERT_INTERNAL_ERROR;
+		goto err;
+	}
+	if (!alg->decompress(s, cert_msg, cert_msg_len, CBS_data(&compressed),
+	    CBS_len(&compressed))) {
+		ctx->alert = TLS13_ALERT_BAD_CERTIFICATE;
+		goto err;
+	}
+
+	*out_cert_msg = cert_msg;
+	*out_cert_msg_len = cert_msg_len;
 
 	return 1;
+
+ decode_err:
+	ctx->alert = TLS13_ALERT_DECODE_ERROR;
+ err:
+	free(cert_msg);
+
+	return 0;
 }
 
 int
@@ -537,6 +537,8 @@ tls13_server_hello_sent(struct tls13_ctx *ctx)
 int
 tls13_server_encrypted_extensions_send(struct tls13_ctx *ctx, CBB *cbb)
 {
+	if (!tls13_cert_comp_select(ctx))
+		goto err;
 	if (!tlsext_server_build(ctx->ssl, SSL_TLSEXT_MSG_EE, cbb))
 		goto err;
 
@@ -631,14 +633,20 @@ int
 tls13_server_certificate_send(struct tls13_ctx *ctx, CBB *cbb)
 {
 	SSL *s = ctx->ssl;
-	CBB cert_request_context, cert_list;
+	CBB cert_request_context, cert_list, cert_msg_cbb;
 	const struct ssl_sigalg *sigalg;
+	struct ssl_cert_list *cl = NULL;
 	X509_STORE_CTX *xsc = NULL;
+	uint8_t *cert_msg = NULL;
+	size_t cert_msg_len;
 	STACK_OF(X509) *chain;
 	SSL_CERT_PKEY *cpk;
+	CBB *body = cbb;
 	X509 *cert;
 	int i, ret = 0;
 
+	memset(&cert_msg_cbb, 0, sizeof(cert_msg_cbb));
+
 	if (!tls13_server_select_certificate(ctx, &cpk, &sigalg))
 		goto err;
 
@@ -668,11 +676,35 @@ tls13_server_certificate_send(struct tls13_ctx *ctx, CBB *cbb)
 		chain = X509_STORE_CTX_get0_chain(xsc);
 	}
 
-	if (!CBB_add_u8_length_prefixed(cbb, &cert_request_context))
+	/*
+	 * If certificate compression has been negotiated, the Certificate
+	 * message is built separately, then compressed into the handshake
+	 * message.
+	 */
+	if (ctx->hs->tls13.cert_comp_alg != 0) {
+		if (!CBB_init(&cert_msg_cbb, 0))
+			goto err;
+		body = &cert_msg_cbb;
+	}
+
+	if (!CBB_add_u8_length_prefixed(body, &cert_request_context))
 		goto err;
-	if (!CBB_add_u24_length_prefixed(cbb, &cert_list))
+	if (!CBB_add_u24_length_prefixed(body, &cert_list))
 		goto err;
 
+	if (xsc == NULL) {
+		/* Use the cached encoding of the configured chain. */
+		if ((cl = ssl_cert_list_get(s, cpk, chain)) == NULL)
+			goto err;
+		if (!tls13_cert_add_der(ctx, &cert_list, cl->leaf_der,
+		    cl->leaf_der_len, tlsext_server_build))
+			goto err;
+		if (!CBB_add_bytes(&cert_list, cl->tls13_chain,
+		    cl->tls13_chain_len))
+			goto err;
+		goto done;
+	}
+
 	if (!tls13_cert_add(ctx, &cert_list, cpk->x509, tlsext_server_build))
 		goto err;
 
@@ -696,13 +728,26 @@ tls13_server_certificate_send(struct tls13_ctx *ctx, CBB *cbb)
 			goto err;
 	}
 
+ done:
+	if (body != cbb) {
+		if (!CBB_finish(body, &cert_msg, &cert_msg_len))
+			goto err;
+		if (!tls13_cert_compress(ctx, cbb, cl, cert_msg,
+		    cert_msg_len)) {
+			ctx->alert = TLS13_ALERT_INTERNAL_ERROR;
+			goto err;
+		}
+	}
 	if (!CBB_flush(cbb))
 		goto err;
 
 	ret = 1;
 
  err:
+	CBB_cleanup(&cert_msg_cbb);
 	X509_STORE_CTX_free(xsc);
+	ssl_cert_list_free(cl);
+	free(cert_msg);
 
 	return ret;
 }
@@ -713,9 +758,6 @@ tls13_server_certificate_verify_send(struct tls13_ctx *ctx, CBB *cbb)
 	const struct ssl_sigalg *sigalg;
 	uint8_t *sig = NULL, *sig_content = NULL;
 	size_t sig_len, sig_content_len;
-	EVP_MD_CTX *mdctx = NULL;
-	EVP_PKEY_CTX *pctx;
-	EVP_PKEY *pkey;
 	const SSL_CERT_PKEY *cpk;
 	CBB sig_cbb;
 	int ret = 0;
@@ -726,7 +768,6 @@ tls13_server_certificate_verify_send(struct tls13_ctx *ctx, CBB *cbb)
 		goto err;
 	if ((sigalg = ctx->hs->our_sigalg) == NULL)
 		goto err;
-	pkey = cpk->privatekey;
 
 	if (!CBB_init(&sig_cbb, 0))
 		goto err;
@@ -744,23 +785,12 @@ tls13_server_certificate_verify_send(struct tls13_ctx *ctx, CBB *cbb)
 	if (!CBB_finish(&sig_cbb, &sig_content, &sig_content_len))
 		goto err;
 
-	if ((mdctx = EVP_MD_CTX_new()) == NULL)
-		goto err;
-	if (!EVP_DigestSignInit(mdctx, &pctx, sigalg->md(), NULL, pkey))
-		goto err;
-	if (sigalg->flags & SIGALG_FLAG_RSA_PSS) {
-		if (!EVP_PKEY_CTX_set_rsa_padding(pctx, RSA_PKCS1_PSS_PADDING))
-			goto err;
-		if (!EVP_PKEY_CTX_set_rsa_pss_saltlen(pctx, -1))
-			goto err;
-	}
-	if (!EVP_DigestSignUpdate(mdctx, sig_content, sig_content_len))
-		goto err;
-	if (EVP_DigestSignFinal(mdctx, NULL, &sig_len) <= 0)
-		goto err;
-	if ((sig = calloc(1, sig_len)) == NULL)
-		goto err;
-	if (EVP_DigestSignFinal(mdctx, sig, &sig_len) <= 0)
+	/*
+	 * If the private key method has yet to complete the signature, the
+	 * handshake message is discarded and built again on resumption.
+	 */
+	if (ssl_private_key_sign(ctx->ssl, cpk->privatekey, sigalg,
+	    sig_content, sig_content_len, &sig, &sig_len) != 1)
 		goto err;
 
 	if (!CBB_add_u16(cbb, sigalg->value))
@@ -776,11 +806,10 @@ tls13_server_certificate_verify_send(struct tls13_ctx *ctx, CBB *cbb)
 	ret = 1;
 
  err:
-	if (!ret && ctx->alert == 0)
+	if (!ret && ctx->alert == 0 && !ctx->hs->private_key_op_pending)
 		ctx->alert = TLS13_ALERT_INTERNAL_ERROR;
 
 	CBB_cleanup(&sig_cbb);
-	EVP_MD_CTX_free(mdctx);
 	free(sig_content);
 	free(sig);
 
@@ -16,11 +16,13 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 
 #include <openssl/curve25519.h>
 #include <openssl/dh.h>
 #include <openssl/ec.h>
 #include <openssl/evp.h>
+#include <openssl/mlkem.h>
 
 #include "bytestring.h"
 #include "ssl_local.h"
@@ -40,8 +42,21 @@ struct tls_key_share {
 	uint8_t *x25519_public;
 	uint8_t *x25519_private;
 	uint8_t *x25519_peer_public;
+
+	struct MLKEM768_private_key *mlkem_private;
+	struct MLKEM768_public_key *mlkem_peer_public;
+	uint8_t *mlkem_public;
+	uint8_t *mlkem_ciphertext;
+	uint8_t *mlkem_shared_secret;
 };
 
+#define X25519MLKEM768_CLIENT_SHARE_LENGTH \
+	(MLKEM768_PUBLIC_KEY_BYTES + X25519_KEY_LENGTH)
+#define X25519MLKEM768_SERVER_SHARE_LENGTH \
+	(MLKEM768_CIPHERTEXT_BYTES + X25519_KEY_LENGTH)
+#define X25519MLKEM768_SHARED_KEY_LENGTH \
+	(MLKEM_SHARED_SECRET_BYTES + X25519_KEY_LENGTH)
+
 static struct tls_key_share *
 tls_key_share_new_internal(int nid, uint16_t group_id)
 {
@@ -96,6 +111,12 @@ tls_key_share_free(struct tls_key_share *ks)
 	freezero(ks->x25519_private, X25519_KEY_LENGTH);
 	freezero(ks->x25519_peer_public, X25519_KEY_LENGTH);
 
+	freezero(ks->mlkem_private, sizeof(*ks->mlkem_private));
+	freezero(ks->mlkem_peer_public, sizeof(*ks->mlkem_peer_public));
+	freezero(ks->mlkem_public, MLKEM768_PUBLIC_KEY_BYTES);
+	freezero(ks->mlkem_ciphertext, MLKEM768_CIPHERTEXT_BYTES);
+	freezero(ks->mlkem_shared_secret, MLKEM_SHARED_SECRET_BYTES);
+
 	freezero(ks, sizeof(*ks));
 }
 
@@ -230,6 +251,63 @@ tls_key_share_generate_x25519(struct tls_key_share *ks)
 	return ret;
 }
 
+/*
+ * The X25519MLKEM768 hybrid key share is generated by the client as an
+ * ML-KEM-768 encapsulation key and an X25519 public key. The server
+ * encapsulates to the client's encapsulation key, sending the ML-KEM-768
+ * ciphertext along with its own X25519 public key.
+ */
+static int
+tls_key_share_generate_x25519mlkem768(struct tls_key_share *ks)
+{
+	struct MLKEM768_private_key *private = NULL;
+	uint8_t *public = NULL, *ciphertext = NULL, *shared_secret = NULL;
+	int ret = 0;
+
+	if (ks->mlkem_private != NULL || ks->mlkem_ciphertext != NULL)
+		goto err;
+
+	if (ks->mlkem_peer_public != NULL) {
+		if ((ciphertext = calloc(1, MLKEM768_CIPHERTEXT_BYTES)) == NULL)
+			goto err;
+		if ((shared_secret = calloc(1,
+		    MLKEM_SHARED_SECRET_BYTES)) == NULL)
+			goto err;
+
+		MLKEM768_encap(ciphertext, shared_secret,
+		    ks->mlkem_peer_public);
+	} else {
+		if ((private = calloc(1, sizeof(*private))) == NULL)
+			goto err;
+		if ((public = calloc(1, MLKEM768_PUBLIC_KEY_BYTES)) == NULL)
+			goto err;
+
+		MLKEM768_generate_key(public, NULL, private);
+	}
+
+	if (!tls_key_share_generate_x25519(ks))
+		goto err;
+
+	ks->mlkem_private = private;
+	ks->mlkem_public = public;
+	ks->mlkem_ciphertext = ciphertext;
+	ks->mlkem_shared_secret = shared_secret;
+	private = NULL;
+	public = NULL;
+	ciphertext = NULL;
+	shared_secret = NULL;
+
+	ret = 1;
+
+ err:
+	freezero(private, sizeof(*private));
+	freezero(public, MLKEM768_PUBLIC_KEY_BYTES);
+	freezero(ciphertext, MLKEM768_CIPHERTEXT_BYTES);
+	freezero(shared_secret, MLKEM_SHARED_SECRET_BYTES);
+
+	return ret;
+}
+
 int
 tls_key_share_generate(struct tls_key_share *ks)
 {
@@ -239,6 +317,9 @@ tls_key_share_generate(struct tls_key_share *ks)
 	if (ks->nid == NID_X25519)
 		return tls_key_share_generate_x25519(ks);
 
+	if (ks->nid == NID_X25519MLKEM768)
+		return tls_key_share_generate_x25519mlkem768(ks);
+
 	return tls_key_share_generate_ecdhe_ecp(ks);
 }
 
@@ -287,6 +368,24 @@ tls_key_share_public_x25519(struct tls_key_share *ks, CBB *cbb)
 	return CBB_add_bytes(cbb, ks->x25519_public, X25519_KEY_LENGTH);
 }
 
+static int
+tls_key_share_public_x25519mlkem768(struct tls_key_share *ks, CBB *cbb)
+{
+	if (ks->mlkem_public != NULL) {
+		if (!CBB_add_bytes(cbb, ks->mlkem_public,
+		    MLKEM768_PUBLIC_KEY_BYTES))
+			return 0;
+	} else if (ks->mlkem_ciphertext != NULL) {
+		if (!CBB_add_bytes(cbb, ks->mlkem_ciphertext,
+		    MLKEM768_CIPHERTEXT_BYTES))
+			return 0;
+	} else {
+		return 0;
+	}
+
+	return tls_key_share_public_x25519(ks, cbb);
+}
+
 int
 tls_key_share_public(struct tls_key_share *ks, CBB *cbb)
 {
@@ -296,6 +395,9 @@ tls_key_share_public(struct tls_key_share *ks, CBB *cbb)
 	if (ks->nid == NID_X25519)
 		return tls_key_share_public_x25519(ks, cbb);
 
+	if (ks->nid == NID_X25519MLKEM768)
+		return tls_key_share_public_x25519mlkem768(ks, cbb);
+
 	return tls_key_share_public_ecdhe_ecp(ks, cbb);
 }
 
@@ -383,6 +485,63 @@ tls_key_share_peer_public_x25519(struct tls_key_share *ks, CBS *cbs,
 	return CBS_stow(cbs, &ks->x25519_peer_public, &out_len);
 }
 
+static int
+tls_key_share_peer_public_x25519mlkem768(struct tls_key_share *ks, CBS *cbs,
+    int *decode_error)
+{
+	struct MLKEM768_public_key *peer_public = NULL;
+	CBS mlkem;
+	size_t out_len;
+	int ret = 0;
+
+	*decode_error = 0;
+
+	if (ks->mlkem_peer_public != NULL)
+		goto err;
+
+	if (ks->mlkem_private != NULL) {
+		/* Client - the server has sent a ciphertext. */
+		if (ks->mlkem_ciphertext != NULL)
+			goto err;
+		if (CBS_len(cbs) != X25519MLKEM768_SERVER_SHARE_LENGTH) {
+			*decode_error = 1;
+			goto err;
+		}
+		if (!CBS_get_bytes(cbs, &mlkem, MLKEM768_CIPHERTEXT_BYTES))
+			goto err;
+		if (!CBS_stow(&mlkem, &ks->mlkem_ciphertext, &out_len))
+			goto err;
+	} else {
+		/* Server - the client has sent an encapsulation key. */
+		if (CBS_len(cbs) != X25519MLKEM768_CLIENT_SHARE_LENGTH) {
+			*decode_error = 1;
+			goto err;
+		}
+		if (!CBS_get_bytes(cbs, &mlkem, MLKEM768_PUBLIC_KEY_BYTES))
+			goto err;
+		if ((peer_public = calloc(1, sizeof(*peer_public))) == NULL)
+			goto err;
+		if (!MLKEM768_parse_public_key(peer_public, CBS_data(&mlkem),
+		    CBS_len(&mlkem))) {
+			*decode_error = 1;
+			goto err;
+		}
+	}
+
+	if (!tls_key_share_peer_public_x25519(ks, cbs, decode_error))
+		goto err;
+
+	ks->mlkem_peer_public = peer_public;
+	peer_public = NULL;
+
+	ret = 1;
+
+ err:
+	freezero(peer_public, sizeof(*peer_public));
+
+	return ret;
+}
+
 int
 tls_key_share_peer_public(struct tls_key_share *ks, CBS *cbs, int *decode_error,
     int *invalid_key)
@@ -399,6 +558,10 @@ tls_key_share_peer_public(struct tls_key_share *ks, CBS *cbs, int *decode_error,
 	if (ks->nid == NID_X25519)
 		return tls_key_share_peer_public_x25519(ks, cbs, decode_error);
 
+	if (ks->nid == NID_X25519MLKEM768)
+		return tls_key_share_peer_public_x25519mlkem768(ks, cbs,
+		    decode_error);
+
 	return tls_key_share_peer_public_ecdhe_ecp(ks, cbs);
 }
 
@@ -451,6 +614,51 @@ tls_key_share_derive_x25519(struct tls_key_share *ks,
 	return ret;
 }
 
+/*
+ * The hybrid shared secret is the ML-KEM-768 shared secret followed by the
+ * X25519 shared secret.
+ */
+static int
+tls_key_share_derive_x25519mlkem768(struct tls_key_share *ks,
+    uint8_t **shared_key, size_t *shared_key_len)
+{
+	uint8_t *sk = NULL;
+	int ret = 0;
+
+	if (ks->x25519_private == NULL || ks->x25519_peer_public == NULL)
+		goto err;
+
+	if ((sk = calloc(1, X25519MLKEM768_SHARED_KEY_LENGTH)) == NULL)
+		goto err;
+
+	if (ks->mlkem_private != NULL) {
+		if (ks->mlkem_ciphertext == NULL)
+			goto err;
+		if (!MLKEM768_decap(sk, ks->mlkem_ciphertext,
+		    MLKEM768_CIPHERTEXT_BYTES, ks->mlkem_private))
+			goto err;
+	} else {
+		if (ks->mlkem_shared_secret == NULL)
+			goto err;
+		memcpy(sk, ks->mlkem_shared_secret, MLKEM_SHARED_SECRET_BYTES);
+	}
+
+	if (!X25519(&sk[MLKEM_SHARED_SECRET_BYTES], ks->x25519_private,
+	    ks->x25519_peer_public))
+		goto err;
+
+	*shared_key = sk;
+	*shared_key_len = X25519MLKEM768_SHARED_KEY_LENGTH;
+	sk = NULL;
+
+	ret = 1;
+
+ err:
+	freezero(sk, X25519MLKEM768_SHARED_KEY_LENGTH);
+
+	return ret;
+}
+
 int
 tls_key_share_derive(struct tls_key_share *ks, uint8_t **shared_key,
     size_t *shared_key_len)
@@ -468,6 +676,10 @@ tls_key_share_derive(struct tls_key_share *ks, uint8_t **shared_key,
 		return tls_key_share_derive_x25519(ks, shared_key,
 		    shared_key_len);
 
+	if (ks->nid == NID_X25519MLKEM768)
+		return tls_key_share_derive_x25519mlkem768(ks, shared_key,
+		    shared_key_len);
+
 	return tls_key_share_derive_ecdhe_ecp(ks, shared_key,
 	    shared_key_len);
 }
@@ -479,6 +479,9 @@ tls_configure_ssl_keypair(struct tls *ctx, SSL_CTX *ssl_ctx,
 			tls_set_errorx(ctx, "failed to load private key");
 			goto err;
 		}
+		if (ctx->config->sign_async_cb != NULL)
+			SSL_CTX_set_private_key_method(ssl_ctx,
+			    tls_signer_key_method());
 		EVP_PKEY_free(pkey);
 		pkey = NULL;
 	}
@@ -717,6 +720,16 @@ tls_reset(struct tls *ctx)
 	ctx->read_cb = NULL;
 	ctx->write_cb = NULL;
 	ctx->cb_arg = NULL;
+
+	/* Freed with the SSL. */
+	ctx->mem_rbio = NULL;
+	ctx->mem_wbio = NULL;
+	ctx->mem_input_len = 0;
+
+	ctx->sign_state = TLS_SIGN_NONE;
+	free(ctx->signature);
+	ctx->signature = NULL;
+	ctx->signature_len = 0;
 }
 
 int
@@ -738,6 +751,9 @@ tls_ssl_error(struct tls *ctx, SSL *ssl_conn, int ssl_ret, const char *prefix)
 	case SSL_ERROR_WANT_WRITE:
 		return (TLS_WANT_POLLOUT);
 
+	case SSL_ERROR_WANT_PRIVATE_KEY_OPERATION:
+		return (TLS_WANT_SIGN);
+
 	case SSL_ERROR_SYSCALL:
 		if ((err = ERR_peek_error()) != 0) {
 			errstr = ERR_error_string(err, NULL);
@@ -775,6 +791,7 @@ tls_handshake(struct tls *ctx)
 	int rv = -1;
 
 	tls_error_clear(&ctx->error);
+	ctx->mem_input_len = 0;
 
 	if ((ctx->flags & (TLS_CLIENT | TLS_SERVER_CONN)) == 0) {
 		tls_set_errorx(ctx, "invalid operation for context");
@@ -812,6 +829,7 @@ tls_read(struct tls *ctx, void *buf, size_t buflen)
 	int ssl_ret;
 
 	tls_error_clear(&ctx->error);
+	ctx->mem_input_len = 0;
 
 	if ((ctx->state & TLS_HANDSHAKE_COMPLETE) == 0) {
 		if ((rv = tls_handshake(ctx)) != 0)
@@ -840,9 +858,11 @@ ssize_t
 tls_write(struct tls *ctx, const void *buf, size_t buflen)
 {
 	ssize_t rv = -1;
+	size_t pending;
 	int ssl_ret;
 
 	tls_error_clear(&ctx->error);
+	ctx->mem_input_len = 0;
 
 	if ((ctx->state & TLS_HANDSHAKE_COMPLETE) == 0) {
 		if ((rv = tls_handshake(ctx)) != 0)
@@ -854,6 +874,17 @@ tls_write(struct tls *ctx, const void *buf, size_t buflen)
 		goto out;
 	}
 
+	/* Limit the output that is buffered for a memory I/O connection. */
+	if (ctx->mem_wbio != NULL) {
+		if ((pending = BIO_ctrl_pending(ctx->mem_wbio)) >=
+		    TLS_MEM_OUTPUT_MAX) {
+			rv = TLS_WANT_POLLOUT;
+			goto out;
+		}
+		if (buflen > TLS_MEM_OUTPUT_MAX - pending)
+			buflen = TLS_MEM_OUTPUT_MAX - pending;
+	}
+
 	ERR_clear_error();
 	if ((ssl_ret = SSL_write(ctx->ssl_conn, buf, buflen)) > 0) {
 		rv = (ssize_t)ssl_ret;
@@ -874,6 +905,7 @@ tls_close(struct tls *ctx)
 	int rv = 0;
 
 	tls_error_clear(&ctx->error);
+	ctx->mem_input_len = 0;
 
 	if ((ctx->flags & (TLS_CLIENT | TLS_SERVER_CONN)) == 0) {
 		tls_set_errorx(ctx, "invalid operation for context");
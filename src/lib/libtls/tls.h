@@ -168,6 +168,7 @@ int tls_accept_fds(struct tls *_ctx, struct tls **_cctx, int _fd_read,
 int tls_accept_socket(struct tls *_ctx, struct tls **_cctx, int _socket);
 int tls_accept_cbs(struct tls *_ctx, struct tls **_cctx,
     tls_read_cb _read_cb, tls_write_cb _write_cb, void *_cb_arg);
+int tls_accept_mem(struct tls *_ctx, struct tls **_cctx);
 int tls_connect(struct tls *_ctx, const char *_host, const char *_port);
 int tls_connect_fds(struct tls *_ctx, int _fd_read, int _fd_write,
     const char *_servername);
@@ -176,11 +177,18 @@ int tls_connect_servername(struct tls *_ctx, const char *_host,
 int tls_connect_socket(struct tls *_ctx, int _s, const char *_servername);
 int tls_connect_cbs(struct tls *_ctx, tls_read_cb _read_cb,
     tls_write_cb _write_cb, void *_cb_arg, const char *_servername);
+int tls_connect_mem(struct tls *_ctx, const char *_servername);
 int tls_handshake(struct tls *_ctx);
 ssize_t tls_read(struct tls *_ctx, void *_buf, size_t _buflen);
 ssize_t tls_write(struct tls *_ctx, const void *_buf, size_t _buflen);
 int tls_close(struct tls *_ctx);
 
+ssize_t tls_mem_input(struct tls *_ctx, uint8_t **_buf);
+int tls_mem_input_done(struct tls *_ctx, size_t _len);
+int tls_mem_input_eof(struct tls *_ctx);
+ssize_t tls_mem_output(struct tls *_ctx, const uint8_t **_buf);
+int tls_mem_output_done(struct tls *_ctx, size_t _len);
+
 int tls_peer_cert_provided(struct tls *_ctx);
 int tls_peer_cert_contains_name(struct tls *_ctx, const char *_name);
 
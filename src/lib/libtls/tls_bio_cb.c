@@ -16,6 +16,7 @@
  */
 
 #include <fcntl.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <unistd.h>
 
@@ -168,3 +169,162 @@ tls_set_cbs(struct tls *ctx, tls_read_cb read_cb, tls_write_cb write_cb,
  err:
 	return (rv);
 }
+
+int
+tls_set_mem_bios(struct tls *ctx)
+{
+	BIO *rbio = NULL, *wbio = NULL;
+
+	if ((rbio = BIO_new(BIO_s_mem())) == NULL ||
+	    (wbio = BIO_new(BIO_s_mem())) == NULL) {
+		tls_set_errorx(ctx, "failed to create memory i/o");
+		goto err;
+	}
+
+	/* An empty input buffer means that more data is needed, not EOF. */
+	BIO_set_mem_eof_return(rbio, -1);
+
+	SSL_set_bio(ctx->ssl_conn, rbio, wbio);
+
+	ctx->mem_rbio = rbio;
+	ctx->mem_wbio = wbio;
+
+	return (0);
+
+ err:
+	BIO_free(rbio);
+	BIO_free(wbio);
+
+	return (-1);
+}
+
+static int
+tls_mem_check(struct tls *ctx)
+{
+	if (ctx->mem_rbio == NULL || ctx->mem_wbio == NULL) {
+		tls_set_errorx(ctx, "not a memory i/o context");
+		return (-1);
+	}
+
+	return (0);
+}
+
+/*
+ * Provide space for ciphertext received from the peer, which the caller may
+ * read into directly before committing it with tls_mem_input_done().
+ */
+ssize_t
+tls_mem_input(struct tls *ctx, uint8_t **buf)
+{
+	char *space;
+	int len;
+
+	tls_error_clear(&ctx->error);
+
+	*buf = NULL;
+
+	if (tls_mem_check(ctx) != 0)
+		return (-1);
+
+	if ((len = BIO_nwrite0(ctx->mem_rbio, &space)) <= 0) {
+		tls_set_errorx(ctx, "failed to provide input buffer");
+		return (-1);
+	}
+	*buf = (uint8_t *)space;
+	ctx->mem_input_len = len;
+
+	return (len);
+}
+
+int
+tls_mem_input_done(struct tls *ctx, size_t len)
+{
+	char *space;
+
+	tls_error_clear(&ctx->error);
+
+	if (tls_mem_check(ctx) != 0)
+		return (-1);
+
+	if (ctx->mem_input_len == 0) {
+		tls_set_errorx(ctx, "no input buffer provided");
+		return (-1);
+	}
+	if (len > ctx->mem_input_len) {
+		ctx->mem_input_len = 0;
+		tls_set_errorx(ctx, "input length exceeds buffer");
+		return (-1);
+	}
+	ctx->mem_input_len = 0;
+
+	if (len == 0)
+		return (0);
+	if (BIO_nwrite(ctx->mem_rbio, &space, len) != (int)len) {
+		tls_set_errorx(ctx, "failed to commit input");
+		return (-1);
+	}
+
+	return (0);
+}
+
+int
+tls_mem_input_eof(struct tls *ctx)
+{
+	tls_error_clear(&ctx->error);
+	ctx->mem_input_len = 0;
+
+	if (tls_mem_check(ctx) != 0)
+		return (-1);
+
+	/* Once the input has been consumed, reads see EOF. */
+	BIO_set_mem_eof_return(ctx->mem_rbio, 0);
+
+	return (0);
+}
+
+/*
+ * Return the ciphertext that is waiting to be sent to the peer, which remains
+ * in place until it is released with tls_mem_output_done().
+ */
+ssize_t
+tls_mem_output(struct tls *ctx, const uint8_t **buf)
+{
+	char *data;
+	int len;
+
+	tls_error_clear(&ctx->error);
+	ctx->mem_input_len = 0;
+
+	*buf = NULL;
+
+	if (tls_mem_check(ctx) != 0)
+		return (-1);
+
+	if ((len = BIO_nread0(ctx->mem_wbio, &data)) <= 0)
+		return (0);
+	*buf = (const uint8_t *)data;
+
+	return (len);
+}
+
+int
+tls_mem_output_done(struct tls *ctx, size_t len)
+{
+	char *data;
+
+	tls_error_clear(&ctx->error);
+	ctx->mem_input_len = 0;
+
+	if (tls_mem_check(ctx) != 0)
+		return (-1);
+
+	if (len == 0)
+		return (0);
+	if (len > INT_MAX ||
+	    BIO_nread(ctx->mem_wbio, &data, len) != (int)len) {
+		tls_set_errorx(ctx, "output length exceeds pending data");
+		return (-1);
+	}
+
+	return (0);
+}
@@ -372,6 +372,14 @@ tls_connect_common(struct tls *ctx, const char *servername)
 		}
 	}
 
+	ctx->group_cache_nid = NID_undef;
+	if (ctx->servername != NULL) {
+		if ((ctx->group_cache_nid = tls_config_group_cache_lookup(
+		    ctx->config, ctx->servername)) != NID_undef)
+			SSL_set_key_share_group(ctx->ssl_conn,
+			    ctx->group_cache_nid);
+	}
+
 	ctx->state |= TLS_CONNECTED;
 	rv = 0;
 
@@ -428,11 +436,29 @@ tls_connect_cbs(struct tls *ctx, tls_read_cb read_cb,
 	return (rv);
 }
 
+int
+tls_connect_mem(struct tls *ctx, const char *servername)
+{
+	int rv = -1;
+
+	if (tls_connect_common(ctx, servername) != 0)
+		goto err;
+
+	if (tls_set_mem_bios(ctx) != 0)
+		goto err;
+
+	rv = 0;
+
+ err:
+	return (rv);
+}
+
 int
 tls_handshake_client(struct tls *ctx)
 {
 	X509 *cert = NULL;
 	int match, ssl_ret;
+	int group_nid;
 	int rv = -1;
 
 	if ((ctx->flags & TLS_CLIENT) == 0) {
@@ -470,6 +496,15 @@ tls_handshake_client(struct tls *ctx)
 
 	ctx->state |= TLS_HANDSHAKE_COMPLETE;
 
+	if (ctx->servername != NULL &&
+	    SSL_version(ctx->ssl_conn) == TLS1_3_VERSION) {
+		/* Only update the cache if the group has changed. */
+		if ((group_nid = SSL_get_negotiated_group(ctx->ssl_conn)) !=
+		    NID_undef && group_nid != ctx->group_cache_nid)
+			tls_config_group_cache_update(ctx->config,
+			    ctx->servername, group_nid);
+	}
+
 	if (ctx->config->session_fd != -1) {
 		if (tls_client_write_session(ctx) == -1)
 			goto err;
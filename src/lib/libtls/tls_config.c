@@ -127,7 +127,6 @@ tls_config_new_internal(void)
 	if (tls_config_set_session_id(config, sid, sizeof(sid)) != 0)
 		goto err;
 	config->ticket_keyrev = arc4random();
-	config->ticket_autorekey = 1;
 
 	tls_config_prefer_ciphers_server(config);
 
@@ -149,11 +148,27 @@ tls_config_new(void)
 	return tls_config_new_internal();
 }
 
+static void
+tls_ticket_keys_free(struct tls_ticket_keys *keys)
+{
+	int i;
+
+	if (keys == NULL)
+		return;
+
+	for (i = 0; i < TLS_NUM_TICKETS; i++)
+		EVP_AEAD_CTX_free(keys->keys[i].aead_ctx);
+
+	freezero(keys, sizeof(*keys));
+}
+
 void
 tls_config_free(struct tls_config *config)
 {
+	struct tls_ticket_keys *keys, *nkeys;
 	struct tls_keypair *kp, *nkp;
 	int refcount;
+	size_t i;
 
 	if (config == NULL)
 		return;
@@ -179,6 +194,15 @@ tls_config_free(struct tls_config *config)
 	free((char *)config->crl_mem);
 	free(config->ecdhecurves);
 
+	tls_ticket_keys_free(config->ticket_keys);
+	for (keys = config->ticket_keys_retired; keys != NULL; keys = nkeys) {
+		nkeys = keys->next;
+		tls_ticket_keys_free(keys);
+	}
+
+	for (i = 0; i < TLS_GROUP_CACHE_SIZE; i++)
+		free(config->group_cache[i].servername);
+
 	pthread_mutex_destroy(&config->mutex);
 
 	free(config);
@@ -748,6 +772,18 @@ tls_config_set_sign_cb(struct tls_config *config, tls_sign_cb cb, void *cb_arg)
 	return (0);
 }
 
+int
+tls_config_set_sign_async_cb(struct tls_config *config, tls_sign_async_cb cb,
+    void *cb_arg)
+{
+	config->use_fake_private_key = 1;
+	config->skip_private_key_check = 1;
+	config->sign_async_cb = cb;
+	config->sign_async_cb_arg = cb_arg;
+
+	return (0);
+}
+
 int
 tls_config_set_verify_depth(struct tls_config *config, int verify_depth)
 {
@@ -869,61 +905,284 @@ tls_config_set_session_lifetime(struct tls_config *config, int lifetime)
 	return (0);
 }
 
-int
-tls_config_add_ticket_key(struct tls_config *config, uint32_t keyrev,
-    unsigned char *key, size_t keylen)
+/*
+ * Free the retired ticket keys if there are no readers, which must be done
+ * with the config mutex held. Readers increment ticket_keys_readers before
+ * loading the current set, hence if it is zero once a set has been retired,
+ * no reader can hold a retired set and they can all be freed.
+ */
+static void
+tls_config_ticket_keys_reclaim(struct tls_config *config)
+{
+	struct tls_ticket_keys *keys, *next;
+
+	if (__atomic_load_n(&config->ticket_keys_readers,
+	    __ATOMIC_SEQ_CST) != 0)
+		return;
+
+	keys = config->ticket_keys_retired;
+	__atomic_store_n(&config->ticket_keys_retired, NULL, __ATOMIC_SEQ_CST);
+
+	for (; keys != NULL; keys = next) {
+		next = keys->next;
+		tls_ticket_keys_free(keys);
+	}
+}
+
+/*
+ * Replace the current ticket keys, which must be done with the config mutex
+ * held. A retired set may still be in use by readers that loaded it before
+ * the new set was published, in which case it is freed by the last of the
+ * readers to release its keys.
+ */
+static void
+tls_config_ticket_keys_publish(struct tls_config *config,
+    struct tls_ticket_keys *keys)
 {
-	struct tls_ticket_key newkey;
+	struct tls_ticket_keys *old;
+
+	if ((old = config->ticket_keys) != NULL) {
+		old->next = config->ticket_keys_retired;
+		__atomic_store_n(&config->ticket_keys_retired, old,
+		    __ATOMIC_SEQ_CST);
+	}
+	__atomic_store_n(&config->ticket_keys, keys, __ATOMIC_SEQ_CST);
+
+	tls_config_ticket_keys_reclaim(config);
+}
+
+static int
+tls_config_add_ticket_key_locked(struct tls_config *config, uint32_t keyrev,
+    unsigned char *key, size_t keylen, int autorekey)
+{
+	struct tls_ticket_keys *cur, *keys = NULL;
+	struct tls_ticket_key *tk;
+	unsigned char key_name[TLS_TICKET_NAME_SIZE];
 	int i;
 
 	if (TLS_TICKET_KEY_SIZE != keylen ||
-	    sizeof(newkey.aes_key) + sizeof(newkey.hmac_key) > keylen) {
+	    TLS_TICKET_AEAD_KEY_SIZE > keylen) {
 		tls_config_set_errorx(config,
 		    "wrong amount of ticket key data");
 		return (-1);
 	}
 
 	keyrev = htonl(keyrev);
-	memset(&newkey, 0, sizeof(newkey));
-	memcpy(newkey.key_name, &keyrev, sizeof(keyrev));
-	memcpy(newkey.aes_key, key, sizeof(newkey.aes_key));
-	memcpy(newkey.hmac_key, key + sizeof(newkey.aes_key),
-	    sizeof(newkey.hmac_key));
-	newkey.time = time(NULL);
+	memset(key_name, 0, sizeof(key_name));
+	memcpy(key_name, &keyrev, sizeof(keyrev));
 
-	for (i = 0; i < TLS_NUM_TICKETS; i++) {
-		struct tls_ticket_key *tk = &config->ticket_keys[i];
-		if (memcmp(newkey.key_name, tk->key_name,
+	cur = config->ticket_keys;
+	for (i = 0; cur != NULL && i < TLS_NUM_TICKETS; i++) {
+		tk = &cur->keys[i];
+		if (tk->aead_ctx == NULL)
+			continue;
+		if (memcmp(key_name, tk->key_name,
 		    sizeof(tk->key_name)) != 0)
 			continue;
 
 		/* allow re-entry of most recent key */
-		if (i == 0 && memcmp(newkey.aes_key, tk->aes_key,
-		    sizeof(tk->aes_key)) == 0 && memcmp(newkey.hmac_key,
-		    tk->hmac_key, sizeof(tk->hmac_key)) == 0)
+		if (i == 0 && memcmp(key, tk->key, sizeof(tk->key)) == 0)
 			return (0);
 		tls_config_set_errorx(config, "ticket key already present");
 		return (-1);
 	}
 
-	memmove(&config->ticket_keys[1], &config->ticket_keys[0],
-	    sizeof(config->ticket_keys) - sizeof(config->ticket_keys[0]));
-	config->ticket_keys[0] = newkey;
+	if ((keys = calloc(1, sizeof(*keys))) == NULL) {
+		tls_config_set_errorx(config, "out of memory");
+		return (-1);
+	}
+	keys->autorekey = autorekey;
+
+	tk = &keys->keys[0];
+	memcpy(tk->key_name, key_name, sizeof(tk->key_name));
+	memcpy(tk->key, key, sizeof(tk->key));
+	tk->time = time(NULL);
+
+	for (i = 1; cur != NULL && i < TLS_NUM_TICKETS; i++) {
+		if (cur->keys[i - 1].aead_ctx == NULL)
+			break;
+		keys->keys[i] = cur->keys[i - 1];
+		keys->keys[i].aead_ctx = NULL;
+	}
+
+	/*
+	 * Each set has its own AEAD contexts, so that a retired set may be
+	 * freed independently of the keys it shares with the current set.
+	 */
+	for (i = 0; i < TLS_NUM_TICKETS; i++) {
+		tk = &keys->keys[i];
+		if (tk->time == 0)
+			break;
+		if ((tk->aead_ctx = EVP_AEAD_CTX_new()) == NULL) {
+			tls_config_set_errorx(config, "out of memory");
+			goto err;
+		}
+		if (!EVP_AEAD_CTX_init(tk->aead_ctx, EVP_aead_aes_256_gcm(),
+		    tk->key, TLS_TICKET_AEAD_KEY_SIZE,
+		    EVP_AEAD_DEFAULT_TAG_LENGTH, NULL)) {
+			tls_config_set_errorx(config,
+			    "failed to initialise ticket key");
+			goto err;
+		}
+	}
 
-	config->ticket_autorekey = 0;
+	tls_config_ticket_keys_publish(config, keys);
 
 	return (0);
+
+ err:
+	tls_ticket_keys_free(keys);
+
+	return (-1);
 }
 
 int
+tls_config_add_ticket_key(struct tls_config *config, uint32_t keyrev,
+    unsigned char *key, size_t keylen)
+{
+	int rv;
+
+	pthread_mutex_lock(&config->mutex);
+	rv = tls_config_add_ticket_key_locked(config, keyrev, key, keylen, 0);
+	pthread_mutex_unlock(&config->mutex);
+
+	return (rv);
+}
+
+static int
+tls_config_ticket_keys_expiring(struct tls_config *config,
+    const struct tls_ticket_keys *keys)
+{
+	if (keys == NULL)
+		return (1);
+	if (keys->autorekey == 0)
+		return (0);
+
+	return (time(NULL) - 3 * (config->session_lifetime / 4) >
+	    keys->keys[0].time);
+}
+
+static int
 tls_config_ticket_autorekey(struct tls_config *config)
 {
 	unsigned char key[TLS_TICKET_KEY_SIZE];
-	int rv;
+	int rv = 0;
+
+	pthread_mutex_lock(&config->mutex);
+
+	/* Another thread may have already replaced the keys. */
+	if (tls_config_ticket_keys_expiring(config, config->ticket_keys)) {
+		arc4random_buf(key, sizeof(key));
+		rv = tls_config_add_ticket_key_locked(config,
+		    config->ticket_keyrev++, key, sizeof(key), 1);
+		explicit_bzero(key, sizeof(key));
+	}
+
+	pthread_mutex_unlock(&config->mutex);
 
-	arc4random_buf(key, sizeof(key));
-	rv = tls_config_add_ticket_key(config, config->ticket_keyrev++, key,
-	    sizeof(key));
-	config->ticket_autorekey = 1;
 	return (rv);
 }
+
+/*
+ * Return the current ticket keys, which may be NULL, generating new keys
+ * first if they are automatically managed and the primary key is due to
+ * expire. The keys remain valid until tls_config_ticket_keys_release() is
+ * called, which must be done even if NULL is returned. No lock is taken
+ * unless the keys are replaced.
+ */
+const struct tls_ticket_keys *
+tls_config_ticket_keys_acquire(struct tls_config *config)
+{
+	const struct tls_ticket_keys *keys;
+
+	__atomic_add_fetch(&config->ticket_keys_readers, 1, __ATOMIC_SEQ_CST);
+	keys = __atomic_load_n(&config->ticket_keys, __ATOMIC_SEQ_CST);
+
+	if (tls_config_ticket_keys_expiring(config, keys)) {
+		tls_config_ticket_keys_release(config);
+		(void)tls_config_ticket_autorekey(config);
+		__atomic_add_fetch(&config->ticket_keys_readers, 1,
+		    __ATOMIC_SEQ_CST);
+		keys = __atomic_load_n(&config->ticket_keys, __ATOMIC_SEQ_CST);
+	}
+
+	return (keys);
+}
+
+void
+tls_config_ticket_keys_release(struct tls_config *config)
+{
+	if (__atomic_sub_fetch(&config->ticket_keys_readers, 1,
+	    __ATOMIC_SEQ_CST) != 0)
+		return;
+
+	/* The last reader frees any sets that were retired while in use. */
+	if (__atomic_load_n(&config->ticket_keys_retired,
+	    __ATOMIC_SEQ_CST) == NULL)
+		return;
+
+	pthread_mutex_lock(&config->mutex);
+	tls_config_ticket_keys_reclaim(config);
+	pthread_mutex_unlock(&config->mutex);
+}
+
+static struct tls_group_cache_entry *
+tls_config_group_cache_find(struct tls_config *config, const char *servername)
+{
+	size_t i;
+
+	for (i = 0; i < TLS_GROUP_CACHE_SIZE; i++) {
+		if (config->group_cache[i].servername == NULL)
+			continue;
+		if (strcmp(config->group_cache[i].servername, servername) == 0)
+			return &config->group_cache[i];
+	}
+
+	return NULL;
+}
+
+/*
+ * Return the group that was last used for a TLSv1.3 key exchange with the
+ * given server, or NID_undef if it is not known. Offering a key share for
+ * this group avoids a hello retry request when the server does not support
+ * our most preferred group.
+ */
+int
+tls_config_group_cache_lookup(struct tls_config *config,
+    const char *servername)
+{
+	struct tls_group_cache_entry *entry;
+	int group_nid = NID_undef;
+
+	pthread_mutex_lock(&config->mutex);
+	if ((entry = tls_config_group_cache_find(config, servername)) != NULL &&
+	    entry->expires > time(NULL))
+		group_nid = entry->group_nid;
+	pthread_mutex_unlock(&config->mutex);
+
+	return (group_nid);
+}
+
+void
+tls_config_group_cache_update(struct tls_config *config,
+    const char *servername, int group_nid)
+{
+	struct tls_group_cache_entry *entry;
+	char *name;
+
+	pthread_mutex_lock(&config->mutex);
+	if ((entry = tls_config_group_cache_find(config, servername)) == NULL) {
+		if ((name = strdup(servername)) == NULL)
+			goto done;
+		entry = &config->group_cache[config->group_cache_next];
+		config->group_cache_next = (config->group_cache_next + 1) %
+		    TLS_GROUP_CACHE_SIZE;
+		free(entry->servername);
+		entry->servername = name;
+	}
+	entry->group_nid = group_nid;
+	entry->expires = time(NULL) + TLS_GROUP_CACHE_TIMEOUT;
+
+ done:
+	pthread_mutex_unlock(&config->mutex);
+}
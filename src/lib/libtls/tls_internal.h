@@ -65,22 +65,54 @@ struct tls_keypair {
 #define TLS_MIN_SESSION_TIMEOUT (4)
 #define TLS_MAX_SESSION_TIMEOUT (24 * 60 * 60)
 
+/*
+ * Amount of encrypted output that may be pending on a memory I/O connection
+ * before tls_write() returns TLS_WANT_POLLOUT.
+ */
+#define TLS_MEM_OUTPUT_MAX	(64 * 1024)
+
 #define TLS_NUM_TICKETS				4
 #define TLS_TICKET_NAME_SIZE			16
-#define TLS_TICKET_AES_SIZE			32
-#define TLS_TICKET_HMAC_SIZE			16
+#define TLS_TICKET_AEAD_KEY_SIZE		32
+#define TLS_TICKET_NONCE_SIZE			12
 
 struct tls_ticket_key {
-	/* The key_name must be 16 bytes according to -lssl */
 	unsigned char	key_name[TLS_TICKET_NAME_SIZE];
-	unsigned char	aes_key[TLS_TICKET_AES_SIZE];
-	unsigned char	hmac_key[TLS_TICKET_HMAC_SIZE];
+	unsigned char	key[TLS_TICKET_KEY_SIZE];
+	EVP_AEAD_CTX	*aead_ctx;
 	time_t		time;
 };
 
+/*
+ * A set of ticket keys, primary key first. Sets are never modified once
+ * published, so that they may be used without holding the config mutex.
+ */
+struct tls_ticket_keys {
+	struct tls_ticket_key keys[TLS_NUM_TICKETS];
+	int autorekey;
+	struct tls_ticket_keys *next;
+};
+
+/*
+ * Number of servers for which a client remembers the group that was used for
+ * the TLSv1.3 key exchange, and the number of seconds for which it is used
+ * before the most preferred group is offered again.
+ */
+#define TLS_GROUP_CACHE_SIZE	32
+#define TLS_GROUP_CACHE_TIMEOUT	(60 * 60)
+
+struct tls_group_cache_entry {
+	char *servername;
+	int group_nid;
+	time_t expires;
+};
+
 typedef int (*tls_sign_cb)(void *_cb_arg, const char *_pubkey_hash,
     const uint8_t *_input, size_t _input_len, int _padding_type,
     uint8_t **_out_signature, size_t *_out_signature_len);
+typedef int (*tls_sign_async_cb)(void *_cb_arg, struct tls *_ctx,
+    const char *_pubkey_hash, const uint8_t *_input, size_t _input_len,
+    int _padding_type);
 
 struct tls_config {
 	struct tls_error error;
@@ -106,9 +138,10 @@ struct tls_config {
 	unsigned char session_id[TLS_MAX_SESSION_ID_LENGTH];
 	int session_fd;
 	int session_lifetime;
-	struct tls_ticket_key ticket_keys[TLS_NUM_TICKETS];
+	struct tls_ticket_keys *ticket_keys;
+	struct tls_ticket_keys *ticket_keys_retired;
+	unsigned int ticket_keys_readers;
 	uint32_t ticket_keyrev;
-	int ticket_autorekey;
 	int verify_cert;
 	int verify_client;
 	int verify_depth;
@@ -118,6 +151,10 @@ struct tls_config {
 	int use_fake_private_key;
 	tls_sign_cb sign_cb;
 	void *sign_cb_arg;
+	tls_sign_async_cb sign_async_cb;
+	void *sign_async_cb_arg;
+	struct tls_group_cache_entry group_cache[TLS_GROUP_CACHE_SIZE];
+	size_t group_cache_next;
 };
 
 struct tls_conninfo {
@@ -190,6 +227,9 @@ struct tls {
 	char *servername;
 	int socket;
 
+	/* Key share group taken from the config's group cache, if any. */
+	int group_cache_nid;
+
 	SSL *ssl_conn;
 	SSL_CTX *ssl_ctx;
 
@@ -205,6 +245,16 @@ struct tls {
 	tls_read_cb read_cb;
 	tls_write_cb write_cb;
 	void *cb_arg;
+
+	/* Memory BIOs for tls_connect_mem()/tls_accept_mem(), owned by SSL. */
+	BIO *mem_rbio;
+	BIO *mem_wbio;
+	size_t mem_input_len;
+
+	/* Signature provided via tls_sign_complete(). */
+	int sign_state;
+	uint8_t *signature;
+	size_t signature_len;
 };
 
 int tls_set_mem(char **_dest, size_t *_destlen, const void *_src,
@@ -251,11 +301,18 @@ int tls_handshake_server(struct tls *ctx);
 
 int tls_config_load_file(struct tls_error *error, const char *filetype,
     const char *filename, char **buf, size_t *len);
-int tls_config_ticket_autorekey(struct tls_config *config);
+const struct tls_ticket_keys *tls_config_ticket_keys_acquire(
+    struct tls_config *config);
+void tls_config_ticket_keys_release(struct tls_config *config);
+int tls_config_group_cache_lookup(struct tls_config *config,
+    const char *servername);
+void tls_config_group_cache_update(struct tls_config *config,
+    const char *servername, int group_nid);
 int tls_host_port(const char *hostport, char **host, char **port);
 
 int tls_set_cbs(struct tls *ctx,
     tls_read_cb read_cb, tls_write_cb write_cb, void *cb_arg);
+int tls_set_mem_bios(struct tls *ctx);
 
 void tls_error_clear(struct tls_error *error);
 int tls_error_set(struct tls_error *error, const char *fmt, ...)
@@ -299,12 +356,25 @@ int tls_password_cb(char *_buf, int _size, int _rwflag, void *_u);
 
 RSA_METHOD *tls_signer_rsa_method(void);
 ECDSA_METHOD *tls_signer_ecdsa_method(void);
+const SSL_PRIVATE_KEY_METHOD *tls_signer_key_method(void);
 
 #define TLS_PADDING_NONE			0
 #define TLS_PADDING_RSA_PKCS1			1
 
+#define TLS_SIGN_NONE				0
+#define TLS_SIGN_PENDING			1
+#define TLS_SIGN_DONE				2
+#define TLS_SIGN_FAILED				3
+
+/* Returned by tls_handshake() et al while a signature is pending. */
+#define TLS_WANT_SIGN				-4
+
 int tls_config_set_sign_cb(struct tls_config *_config, tls_sign_cb _cb,
     void *_cb_arg);
+int tls_config_set_sign_async_cb(struct tls_config *_config,
+    tls_sign_async_cb _cb, void *_cb_arg);
+int tls_sign_complete(struct tls *_ctx, const uint8_t *_signature,
+    size_t _signature_len);
 
 struct tls_signer* tls_signer_new(void);
 void tls_signer_free(struct tls_signer * _signer);
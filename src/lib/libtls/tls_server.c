@@ -137,89 +137,127 @@ tls_servername_cb(SSL *ssl, int *al, void *arg)
 	return (SSL_TLSEXT_ERR_ALERT_FATAL);
 }
 
-static struct tls_ticket_key *
-tls_server_ticket_key(struct tls_config *config, unsigned char *keyname)
+static const struct tls_ticket_key *
+tls_server_ticket_key(struct tls_config *config,
+    const struct tls_ticket_keys *keys, const unsigned char *keyname)
 {
-	struct tls_ticket_key *key = NULL;
+	const struct tls_ticket_key *tk;
 	time_t now;
 	int i;
 
+	if (keys == NULL)
+		return (NULL);
+
 	now = time(NULL);
-	if (config->ticket_autorekey == 1) {
-		if (now - 3 * (config->session_lifetime / 4) >
-		    config->ticket_keys[0].time) {
-			if (tls_config_ticket_autorekey(config) == -1)
-				return (NULL);
-		}
-	}
 	for (i = 0; i < TLS_NUM_TICKETS; i++) {
-		struct tls_ticket_key *tk = &config->ticket_keys[i];
+		tk = &keys->keys[i];
+		if (tk->aead_ctx == NULL)
+			break;
 		if (now - config->session_lifetime > tk->time)
 			continue;
 		if (keyname == NULL || timingsafe_memcmp(keyname,
-		    tk->key_name, sizeof(tk->key_name)) == 0) {
-			key = tk;
-			break;
-		}
+		    tk->key_name, sizeof(tk->key_name)) == 0)
+			return (tk);
 	}
-	return (key);
+	return (NULL);
+}
+
+/*
+ * Tickets consist of the key name, a random nonce and the session sealed
+ * with the key, using the key name as additional data.
+ */
+static size_t
+tls_server_ticket_max_overhead(SSL *ssl)
+{
+	return (TLS_TICKET_NAME_SIZE + TLS_TICKET_NONCE_SIZE +
+	    EVP_AEAD_max_overhead(EVP_aead_aes_256_gcm()));
 }
 
 static int
-tls_server_ticket_cb(SSL *ssl, unsigned char *keyname, unsigned char *iv,
-    EVP_CIPHER_CTX *ctx, HMAC_CTX *hctx, int mode)
+tls_server_ticket_seal(SSL *ssl, uint8_t *out, size_t *out_len,
+    size_t max_out, const uint8_t *in, size_t in_len)
 {
-	struct tls_ticket_key *key;
+	const size_t prefix_len = TLS_TICKET_NAME_SIZE + TLS_TICKET_NONCE_SIZE;
+	const struct tls_ticket_keys *keys;
+	const struct tls_ticket_key *key;
 	struct tls *tls_ctx;
+	size_t len;
+	int ret = 0;
 
 	if ((tls_ctx = SSL_get_app_data(ssl)) == NULL)
-		return (-1);
-
-	if (mode == 1) {
-		/* create new session */
-		key = tls_server_ticket_key(tls_ctx->config, NULL);
-		if (key == NULL) {
-			tls_set_errorx(tls_ctx, "no valid ticket key found");
-			return (-1);
-		}
-
-		memcpy(keyname, key->key_name, sizeof(key->key_name));
-		arc4random_buf(iv, EVP_MAX_IV_LENGTH);
-		if (!EVP_EncryptInit_ex(ctx, EVP_aes_256_cbc(), NULL,
-		    key->aes_key, iv)) {
-			tls_set_errorx(tls_ctx, "failed to init encrypt");
-			return (-1);
-		}
-		if (!HMAC_Init_ex(hctx, key->hmac_key, sizeof(key->hmac_key),
-		    EVP_sha256(), NULL)) {
-			tls_set_errorx(tls_ctx, "failed to init hmac");
-			return (-1);
-		}
 		return (0);
-	} else {
-		/* get key by name */
-		key = tls_server_ticket_key(tls_ctx->config, keyname);
-		if (key == NULL)
-			return (0);
-
-		if (!EVP_DecryptInit_ex(ctx, EVP_aes_256_cbc(), NULL,
-		    key->aes_key, iv)) {
-			tls_set_errorx(tls_ctx, "failed to init decrypt");
-			return (-1);
-		}
-		if (!HMAC_Init_ex(hctx, key->hmac_key, sizeof(key->hmac_key),
-		    EVP_sha256(), NULL)) {
-			tls_set_errorx(tls_ctx, "failed to init hmac");
-			return (-1);
-		}
+	if (max_out < prefix_len)
+		return (0);
+
+	keys = tls_config_ticket_keys_acquire(tls_ctx->config);
+
+	if ((key = tls_server_ticket_key(tls_ctx->config, keys,
+	    NULL)) == NULL) {
+		tls_set_errorx(tls_ctx, "no valid ticket key found");
+		goto err;
+	}
 
-		/* time to renew the ticket? is it the primary key? */
-		if (key != &tls_ctx->config->ticket_keys[0])
-			return (2);
-		return (1);
+	memcpy(out, key->key_name, TLS_TICKET_NAME_SIZE);
+	arc4random_buf(out + TLS_TICKET_NAME_SIZE, TLS_TICKET_NONCE_SIZE);
+	if (!EVP_AEAD_CTX_seal(key->aead_ctx, out + prefix_len, &len,
+	    max_out - prefix_len, out + TLS_TICKET_NAME_SIZE,
+	    TLS_TICKET_NONCE_SIZE, in, in_len, out, TLS_TICKET_NAME_SIZE)) {
+		tls_set_errorx(tls_ctx, "failed to encrypt ticket");
+		goto err;
 	}
+	*out_len = prefix_len + len;
+
+	ret = 1;
+
+ err:
+	tls_config_ticket_keys_release(tls_ctx->config);
+
+	return (ret);
 }
 
+static enum ssl_ticket_aead_result_t
+tls_server_ticket_open(SSL *ssl, uint8_t *out, size_t *out_len,
+    size_t max_out, const uint8_t *in, size_t in_len)
+{
+	const size_t prefix_len = TLS_TICKET_NAME_SIZE + TLS_TICKET_NONCE_SIZE;
+	const struct tls_ticket_keys *keys;
+	const struct tls_ticket_key *key;
+	enum ssl_ticket_aead_result_t ret;
+	struct tls *tls_ctx;
+
+	if ((tls_ctx = SSL_get_app_data(ssl)) == NULL)
+		return (ssl_ticket_aead_error);
+	if (in_len < prefix_len)
+		return (ssl_ticket_aead_ignore_ticket);
+
+	keys = tls_config_ticket_keys_acquire(tls_ctx->config);
+
+	/* get key by name */
+	ret = ssl_ticket_aead_ignore_ticket;
+	if ((key = tls_server_ticket_key(tls_ctx->config, keys, in)) == NULL)
+		goto done;
+	if (!EVP_AEAD_CTX_open(key->aead_ctx, out, out_len, max_out,
+	    in + TLS_TICKET_NAME_SIZE, TLS_TICKET_NONCE_SIZE,
+	    in + prefix_len, in_len - prefix_len, in, TLS_TICKET_NAME_SIZE))
+		goto done;
+
+	/* time to renew the ticket? is it the primary key? */
+	ret = ssl_ticket_aead_success;
+	if (key != &keys->keys[0])
+		ret = ssl_ticket_aead_renew;
+
+ done:
+	tls_config_ticket_keys_release(tls_ctx->config);
+
+	return (ret);
+}
+
+static const SSL_TICKET_AEAD_METHOD tls_server_ticket_aead_method = {
+	.max_overhead = tls_server_ticket_max_overhead,
+	.seal = tls_server_ticket_seal,
+	.open = tls_server_ticket_open,
+};
+
 static int
 tls_configure_server_ssl(struct tls *ctx, SSL_CTX **ssl_ctx,
     struct tls_keypair *keypair)
@@ -285,12 +323,8 @@ tls_configure_server_ssl(struct tls *ctx, SSL_CTX **ssl_ctx,
 		/* set the session lifetime and enable tickets */
 		SSL_CTX_set_timeout(*ssl_ctx, ctx->config->session_lifetime);
 		SSL_CTX_clear_options(*ssl_ctx, SSL_OP_NO_TICKET);
-		if (!SSL_CTX_set_tlsext_ticket_key_cb(*ssl_ctx,
-		    tls_server_ticket_cb)) {
-			tls_set_error(ctx,
-			    "failed to set the TLS ticket callback");
-			goto err;
-		}
+		SSL_CTX_set_ticket_aead_method(*ssl_ctx,
+		    &tls_server_ticket_aead_method);
 	}
 
 	if (SSL_CTX_set_session_id_context(*ssl_ctx, ctx->config->session_id,
@@ -439,6 +473,27 @@ tls_accept_cbs(struct tls *ctx, struct tls **cctx,
 	return (-1);
 }
 
+int
+tls_accept_mem(struct tls *ctx, struct tls **cctx)
+{
+	struct tls *conn_ctx;
+
+	if ((conn_ctx = tls_accept_common(ctx)) == NULL)
+		goto err;
+
+	if (tls_set_mem_bios(conn_ctx) != 0)
+		goto err;
+
+	*cctx = conn_ctx;
+
+	return (0);
+ err:
+	tls_free(conn_ctx);
+	*cctx = NULL;
+
+	return (-1);
+}
+
 int
 tls_handshake_server(struct tls *ctx)
 {
@@ -20,6 +20,7 @@
 #include <openssl/ecdsa.h>
 #include <openssl/err.h>
 #include <openssl/rsa.h>
+#include <openssl/x509.h>
 
 #include "tls.h"
 #include "tls_internal.h"
@@ -445,3 +446,284 @@ tls_signer_ecdsa_method(void)
 
 	return (ecdsa_method);
 }
+
+/*
+ * Signature algorithms that can be used with the sign callbacks, which are
+ * passed the same input as the RSA and ECDSA methods above.
+ */
+static const struct tls_signer_sigalg {
+	uint16_t value;
+	int key_type;
+	int rsa_pss;
+	const EVP_MD *(*md)(void);
+} tls_signer_sigalgs[] = {
+	{ 0x0201, EVP_PKEY_RSA, 0, EVP_sha1 },
+	{ 0x0203, EVP_PKEY_EC, 0, EVP_sha1 },
+	{ 0x0301, EVP_PKEY_RSA, 0, EVP_sha224 },
+	{ 0x0303, EVP_PKEY_EC, 0, EVP_sha224 },
+	{ 0x0401, EVP_PKEY_RSA, 0, EVP_sha256 },
+	{ 0x0403, EVP_PKEY_EC, 0, EVP_sha256 },
+	{ 0x0501, EVP_PKEY_RSA, 0, EVP_sha384 },
+	{ 0x0503, EVP_PKEY_EC, 0, EVP_sha384 },
+	{ 0x0601, EVP_PKEY_RSA, 0, EVP_sha512 },
+	{ 0x0603, EVP_PKEY_EC, 0, EVP_sha512 },
+	{ 0x0804, EVP_PKEY_RSA, 1, EVP_sha256 },
+	{ 0x0805, EVP_PKEY_RSA, 1, EVP_sha384 },
+	{ 0x0806, EVP_PKEY_RSA, 1, EVP_sha512 },
+	{ 0xff01, EVP_PKEY_RSA, 0, EVP_md5_sha1 },
+};
+
+#define N_TLS_SIGNER_SIGALGS \
+    (sizeof(tls_signer_sigalgs) / sizeof(tls_signer_sigalgs[0]))
+
+static const struct tls_signer_sigalg *
+tls_signer_sigalg(uint16_t value, EVP_PKEY *pubkey)
+{
+	size_t i;
+
+	for (i = 0; i < N_TLS_SIGNER_SIGALGS; i++) {
+		if (tls_signer_sigalgs[i].value != value)
+			continue;
+		if (tls_signer_sigalgs[i].key_type != EVP_PKEY_id(pubkey))
+			return (NULL);
+		return (&tls_signer_sigalgs[i]);
+	}
+
+	return (NULL);
+}
+
+/*
+ * Hash and encode the content to be signed into the input that an RSA or
+ * ECDSA private key operation expects for the signature algorithm.
+ */
+static int
+tls_signer_encode(struct tls *ctx, const struct tls_signer_sigalg *sigalg,
+    EVP_PKEY *pubkey, const uint8_t *content, size_t content_len,
+    uint8_t **out_input, size_t *out_input_len, int *out_padding_type)
+{
+	unsigned char digest[EVP_MAX_MD_SIZE];
+	unsigned int digest_len;
+	const EVP_MD *md = sigalg->md();
+	X509_SIG *sig = NULL;
+	X509_ALGOR *algor;
+	ASN1_OCTET_STRING *octets;
+	uint8_t *input = NULL;
+	int input_len;
+	RSA *rsa;
+	int ret = -1;
+
+	*out_input = NULL;
+	*out_input_len = 0;
+
+	if (!EVP_Digest(content, content_len, digest, &digest_len, md, NULL)) {
+		tls_set_errorx(ctx, "failed to hash signature content");
+		goto err;
+	}
+
+	if (sigalg->key_type == EVP_PKEY_EC) {
+		if ((input = malloc(digest_len)) == NULL) {
+			tls_set_error(ctx, "signature input");
+			goto err;
+		}
+		memcpy(input, digest, digest_len);
+		input_len = digest_len;
+		*out_padding_type = TLS_PADDING_NONE;
+		goto done;
+	}
+
+	if ((rsa = EVP_PKEY_get0_RSA(pubkey)) == NULL) {
+		tls_set_errorx(ctx, "public key is not RSA");
+		goto err;
+	}
+
+	if (sigalg->rsa_pss) {
+		input_len = RSA_size(rsa);
+		if ((input = calloc(1, input_len)) == NULL) {
+			tls_set_error(ctx, "signature input");
+			goto err;
+		}
+		if (!RSA_padding_add_PKCS1_PSS_mgf1(rsa, input, digest, md, md,
+		    -1)) {
+			tls_set_errorx(ctx, "failed to add PSS padding");
+			goto err;
+		}
+		*out_padding_type = TLS_PADDING_NONE;
+		goto done;
+	}
+
+	/* MD5+SHA1 signatures for TLSv1.1 and earlier have no DigestInfo. */
+	if (EVP_MD_type(md) == NID_md5_sha1) {
+		if ((input = malloc(digest_len)) == NULL) {
+			tls_set_error(ctx, "signature input");
+			goto err;
+		}
+		memcpy(input, digest, digest_len);
+		input_len = digest_len;
+		*out_padding_type = TLS_PADDING_RSA_PKCS1;
+		goto done;
+	}
+
+	if ((sig = X509_SIG_new()) == NULL) {
+		tls_set_error(ctx, "signature input");
+		goto err;
+	}
+	X509_SIG_getm(sig, &algor, &octets);
+	if (!X509_ALGOR_set0(algor, OBJ_nid2obj(EVP_MD_type(md)), V_ASN1_NULL,
+	    NULL) || !ASN1_OCTET_STRING_set(octets, digest, digest_len)) {
+		tls_set_errorx(ctx, "failed to encode digest info");
+		goto err;
+	}
+	if ((input_len = i2d_X509_SIG(sig, &input)) <= 0) {
+		tls_set_errorx(ctx, "failed to encode digest info");
+		goto err;
+	}
+	*out_padding_type = TLS_PADDING_RSA_PKCS1;
+
+ done:
+	*out_input = input;
+	*out_input_len = input_len;
+	input = NULL;
+
+	ret = 0;
+
+ err:
+	X509_SIG_free(sig);
+	free(input);
+
+	return (ret);
+}
+
+static enum ssl_private_key_result_t
+tls_private_key_complete(SSL *ssl, uint8_t *out, size_t *out_len,
+    size_t max_out)
+{
+	enum ssl_private_key_result_t ret = ssl_private_key_failure;
+	struct tls *ctx;
+
+	if ((ctx = SSL_get_app_data(ssl)) == NULL)
+		return (ssl_private_key_failure);
+
+	if (ctx->sign_state == TLS_SIGN_PENDING)
+		return (ssl_private_key_retry);
+
+	if (ctx->sign_state != TLS_SIGN_DONE) {
+		tls_set_errorx(ctx, "signing failed");
+		goto err;
+	}
+	if (ctx->signature_len > max_out) {
+		tls_set_errorx(ctx, "signature too large");
+		goto err;
+	}
+
+	memcpy(out, ctx->signature, ctx->signature_len);
+	*out_len = ctx->signature_len;
+
+	ret = ssl_private_key_success;
+
+ err:
+	ctx->sign_state = TLS_SIGN_NONE;
+	free(ctx->signature);
+	ctx->signature = NULL;
+	ctx->signature_len = 0;
+
+	return (ret);
+}
+
+static enum ssl_private_key_result_t
+tls_private_key_sign(SSL *ssl, uint8_t *out, size_t *out_len, size_t max_out,
+    uint16_t signature_algorithm, const uint8_t *content, size_t content_len)
+{
+	const struct tls_signer_sigalg *sigalg;
+	struct tls_config *config;
+	struct tls *ctx;
+	EVP_PKEY *pubkey;
+	X509 *cert;
+	uint8_t *input = NULL;
+	size_t input_len;
+	char *pubkey_hash = NULL;
+	int padding_type;
+	int rv;
+
+	if ((ctx = SSL_get_app_data(ssl)) == NULL)
+		return (ssl_private_key_failure);
+	config = ctx->config;
+
+	if ((cert = SSL_get_certificate(ssl)) == NULL ||
+	    (pubkey = X509_get0_pubkey(cert)) == NULL) {
+		tls_set_errorx(ctx, "no certificate to sign with");
+		return (ssl_private_key_failure);
+	}
+	if ((sigalg = tls_signer_sigalg(signature_algorithm, pubkey)) == NULL) {
+		tls_set_errorx(ctx, "unsupported signature algorithm 0x%04x",
+		    signature_algorithm);
+		return (ssl_private_key_failure);
+	}
+	if (tls_signer_encode(ctx, sigalg, pubkey, content, content_len,
+	    &input, &input_len, &padding_type) == -1)
+		return (ssl_private_key_failure);
+	if (tls_cert_pubkey_hash(cert, &pubkey_hash) == -1) {
+		tls_set_errorx(ctx, "failed to get certificate hash");
+		free(input);
+		return (ssl_private_key_failure);
+	}
+
+	/* The callback may complete the signature before it returns. */
+	ctx->sign_state = TLS_SIGN_PENDING;
+	rv = config->sign_async_cb(config->sign_async_cb_arg, ctx, pubkey_hash,
+	    input, input_len, padding_type);
+
+	free(input);
+	free(pubkey_hash);
+
+	if (rv == -1) {
+		ctx->sign_state = TLS_SIGN_FAILED;
+		if (ctx->error.msg == NULL)
+			tls_set_errorx(ctx, "sign callback failed");
+	}
+
+	return (tls_private_key_complete(ssl, out, out_len, max_out));
+}
+
+const SSL_PRIVATE_KEY_METHOD *
+tls_signer_key_method(void)
+{
+	static const SSL_PRIVATE_KEY_METHOD key_method = {
+		.sign = tls_private_key_sign,
+		.complete = tls_private_key_complete,
+	};
+
+	return (&key_method);
+}
+
+/*
+ * Provide the signature for a request made by the asynchronous sign
+ * callback, or a NULL signature if it could not be produced. This may be
+ * called from within the callback itself, otherwise it must be called
+ * before tls_handshake() is retried and not concurrently with any other
+ * operation on the context.
+ */
+int
+tls_sign_complete(struct tls *ctx, const uint8_t *signature,
+    size_t signature_len)
+{
+	if (ctx->sign_state != TLS_SIGN_PENDING) {
+		tls_set_errorx(ctx, "no signature pending");
+		return (-1);
+	}
+
+	if (signature == NULL || signature_len == 0) {
+		ctx->sign_state = TLS_SIGN_FAILED;
+		return (0);
+	}
+
+	if ((ctx->signature = malloc(signature_len)) == NULL) {
+		tls_set_error(ctx, "signature");
+		ctx->sign_state = TLS_SIGN_FAILED;
+		return (-1);
+	}
+	memcpy(ctx->signature, signature, signature_len);
+	ctx->signature_len = signature_len;
+	ctx->sign_state = TLS_SIGN_DONE;
+
+	return (0);
+}
@@ -0,0 +1,315 @@
+/*	$OpenBSD$	*/
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+#include <err.h>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define N_THREADS	32
+#define N_WORDS		4096
+
+struct thread_buf {
+	pthread_t thread;
+	uint32_t x[N_WORDS];
+};
+
+static volatile sig_atomic_t threads_stop;
+
+static void *
+fill_thread(void *arg)
+{
+	struct thread_buf *tb = arg;
+	size_t i;
+
+	/* Alternate between the two interfaces, in small pieces. */
+	for (i = 0; i < N_WORDS; i += 64) {
+		if (i % 128 == 0)
+			arc4random_buf(&tb->x[i], 64 * sizeof(uint32_t));
+		else {
+			size_t j;
+
+			for (j = 0; j < 64; j++)
+				tb->x[i + j] = arc4random();
+		}
+	}
+
+	return NULL;
+}
+
+static size_t
+count_matches(const uint32_t *a, const uint32_t *b)
+{
+	size_t i, count = 0;
+
+	for (i = 0; i < N_WORDS; i++)
+		count += a[i] == b[i];
+
+	return count;
+}
+
+static int
+is_zero(const uint32_t *a)
+{
+	size_t i;
+
+	for (i = 0; i < N_WORDS; i++) {
+		if (a[i] != 0)
+			return 0;
+	}
+
+	return 1;
+}
+
+/*
+ * Ensure that concurrent threads do not receive the same keystream. There
+ * is less than a 1 in 2^40 chance of more than one pairwise match between
+ * two vectors of 4096 32-bit integers (see arc4random-fork).
+ */
+static int
+test_arc4random_threads(void)
+{
+	struct thread_buf *tbs;
+	size_t i, j, matches;
+	int failed = 1;
+
+	if ((tbs = calloc(N_THREADS, sizeof(*tbs))) == NULL)
+		err(1, NULL);
+
+	for (i = 0; i < N_THREADS; i++) {
+		if ((errno = pthread_create(&tbs[i].thread, NULL, fill_thread,
+		    &tbs[i])) != 0)
+			err(1, "pthread_create");
+	}
+	for (i = 0; i < N_THREADS; i++) {
+		if ((errno = pthread_join(tbs[i].thread, NULL)) != 0)
+			err(1, "pthread_join");
+	}
+
+	for (i = 0; i < N_THREADS; i++) {
+		if (is_zero(tbs[i].x)) {
+			fprintf(stderr, "FAIL: thread %zu got no output\n", i);
+			goto failed;
+		}
+		for (j = i + 1; j < N_THREADS; j++) {
+			matches = count_matches(tbs[i].x, tbs[j].x);
+			if (matches > 1) {
+				fprintf(stderr, "FAIL: threads %zu and %zu "
+				    "have %zu matching words\n", i, j, matches);
+				goto failed;
+			}
+		}
+	}
+
+	failed = 0;
+
+ failed:
+	free(tbs);
+
+	return failed;
+}
+
+static void *
+busy_thread(void *arg)
+{
+	uint32_t buf[16];
+
+	while (!threads_stop)
+		arc4random_buf(buf, sizeof(buf));
+
+	return NULL;
+}
+
+/*
+ * Fork while other threads are using arc4random, which leaves keystream
+ * states in use at the time of the fork. The child must neither block nor
+ * produce the same output as the parent.
+ */
+static int
+test_arc4random_threads_fork(void)
+{
+	pthread_t threads[N_THREADS];
+	uint32_t *parent, *child;
+	size_t i, matches;
+	pid_t pid;
+	int n, status;
+	int failed = 1;
+
+	if ((child = mmap(NULL, N_WORDS * sizeof(uint32_t),
+	    PROT_READ|PROT_WRITE, MAP_ANON|MAP_SHARED, -1, 0)) == MAP_FAILED)
+		err(1, "mmap");
+	if ((parent = calloc(N_WORDS, sizeof(uint32_t))) == NULL)
+		err(1, NULL);
+
+	threads_stop = 0;
+	for (i = 0; i < N_THREADS; i++) {
+		if ((errno = pthread_create(&threads[i], NULL, busy_thread,
+		    NULL)) != 0)
+			err(1, "pthread_create");
+	}
+
+	for (n = 0; n < 16; n++) {
+		memset(child, 0, N_WORDS * sizeof(uint32_t));
+
+		if ((pid = fork()) == -1)
+			err(1, "fork");
+		if (pid == 0) {
+			alarm(10);
+			arc4random_buf(child, N_WORDS * sizeof(uint32_t));
+			_exit(0);
+		}
+		arc4random_buf(parent, N_WORDS * sizeof(uint32_t));
+
+		while (waitpid(pid, &status, 0) == -1) {
+			if (errno != EINTR)
+				err(1, "waitpid");
+		}
+		if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+			fprintf(stderr, "FAIL: child did not exit cleanly\n");
+			goto failed;
+		}
+		if (is_zero(child)) {
+			fprintf(stderr, "FAIL: child got no output\n");
+			goto failed;
+		}
+		if ((matches = count_matches(parent, child)) > 1) {
+			fprintf(stderr, "FAIL: parent and child have %zu "
+			    "matching words\n", matches);
+			goto failed;
+		}
+	}
+
+	failed = 0;
+
+ failed:
+	threads_stop = 1;
+	for (i = 0; i < N_THREADS; i++)
+		pthread_join(threads[i], NULL);
+
+	munmap(child, N_WORDS * sizeof(uint32_t));
+	free(parent);
+
+	return failed;
+}
+
+struct benchmark_thread {
+	pthread_t thread;
+	size_t len;
+	unsigned long calls;
+};
+
+static volatile sig_atomic_t benchmark_stop;
+
+static void
+benchmark_sig_alarm(int sig)
+{
+	benchmark_stop = 1;
+}
+
+static void *
+benchmark_thread(void *arg)
+{
+	struct benchmark_thread *bt = arg;
+	uint8_t buf[1024];
+
+	while (!benchmark_stop) {
+		arc4random_buf(buf, bt->len);
+		bt->calls++;
+	}
+
+	return NULL;
+}
+
+static void
+benchmark_run(int n_threads, size_t len, int seconds)
+{
+	struct benchmark_thread bts[N_THREADS];
+	struct timespec start, end, duration;
+	unsigned long calls = 0;
+	double secs;
+	int i;
+
+	signal(SIGALRM, benchmark_sig_alarm);
+
+	memset(bts, 0, sizeof(bts));
+	benchmark_stop = 0;
+
+	fprintf(stderr, "Benchmarking arc4random_buf(%zu) with %d thread%s "
+	    "for %ds: ", len, n_threads, n_threads == 1 ? "" : "s", seconds);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	alarm(seconds);
+
+	for (i = 0; i < n_threads; i++) {
+		bts[i].len = len;
+		if ((errno = pthread_create(&bts[i].thread, NULL,
+		    benchmark_thread, &bts[i])) != 0)
+			err(1, "pthread_create");
+	}
+	for (i = 0; i < n_threads; i++) {
+		if ((errno = pthread_join(bts[i].thread, NULL)) != 0)
+			err(1, "pthread_join");
+		calls += bts[i].calls;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	timespecsub(&end, &start, &duration);
+	secs = duration.tv_sec + duration.tv_nsec / 1000000000.0;
+
+	fprintf(stderr, "%lu calls in %f seconds, %.1f MB/s\n", calls, secs,
+	    calls * len / secs / 1000000.0);
+}
+
+static void
+benchmark_arc4random(void)
+{
+	static const size_t lens[] = { 16, 1024 };
+	static const int threads[] = { 1, 2, 4, 8, 16, 32 };
+	size_t i, j;
+
+	for (i = 0; i < sizeof(lens) / sizeof(lens[0]); i++) {
+		for (j = 0; j < sizeof(threads) / sizeof(threads[0]); j++)
+			benchmark_run(threads[j], lens[i], 2);
+	}
+}
+
+int
+main(int argc, char **argv)
+{
+	int benchmark = 0, failed = 0;
+
+	if (argc == 2 && strcmp(argv[1], "--benchmark") == 0)
+		benchmark = 1;
+
+	failed |= test_arc4random_threads();
+	failed |= test_arc4random_threads_fork();
+
+	if (benchmark && !failed)
+		benchmark_arc4random();
+
+	return failed;
+}
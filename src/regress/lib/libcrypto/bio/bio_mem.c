@@ -15,11 +15,16 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <sys/time.h>
+
 #include <err.h>
+#include <signal.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
 
 #include <openssl/bio.h>
 #include <openssl/buffer.h>
@@ -332,14 +337,362 @@ bio_mem_readonly_test(void)
 	return failed;
 }
 
+static int
+bio_mem_nread_nwrite_test(void)
+{
+	uint8_t data[6000];
+	BUF_MEM *pbuf;
+	BIO *bio = NULL;
+	char *p, *wp;
+	int ret;
+	int failed = 1;
+
+	memset(data, 0xdb, sizeof(data));
+	data[0] = 0x01;
+
+	if ((bio = BIO_new(BIO_s_mem())) == NULL) {
+		fprintf(stderr, "FAIL: BIO_new() returned NULL\n");
+		goto failure;
+	}
+
+	if ((ret = BIO_nread0(bio, &p)) != -1) {
+		fprintf(stderr, "FAIL: BIO_nread0() = %d, want -1\n", ret);
+		goto failure;
+	}
+	if (!BIO_should_retry(bio)) {
+		fprintf(stderr, "FAIL: BIO_should_retry() is false\n");
+		goto failure;
+	}
+
+	if ((ret = BIO_nwrite0(bio, &wp)) < 4096) {
+		fprintf(stderr, "FAIL: BIO_nwrite0() = %d, want >= 4096\n",
+		    ret);
+		goto failure;
+	}
+	memcpy(wp, data, 100);
+	if ((ret = BIO_nwrite(bio, &p, 100)) != 100) {
+		fprintf(stderr, "FAIL: BIO_nwrite() = %d, want 100\n", ret);
+		goto failure;
+	}
+	if (p != wp) {
+		fprintf(stderr, "FAIL: BIO_nwrite() returned different "
+		    "pointer to BIO_nwrite0()\n");
+		goto failure;
+	}
+
+	/* BIO_nwrite() cannot commit more than BIO_nwrite0() made available. */
+	if ((ret = BIO_nwrite0(bio, &wp)) < 4096) {
+		fprintf(stderr, "FAIL: BIO_nwrite0() = %d, want >= 4096\n",
+		    ret);
+		goto failure;
+	}
+	if ((ret = BIO_nwrite(bio, &p, ret + 1)) != -1) {
+		fprintf(stderr, "FAIL: BIO_nwrite() = %d, want -1\n", ret);
+		goto failure;
+	}
+	memcpy(wp, &data[100], 4000);
+	if ((ret = BIO_nwrite(bio, &p, 4000)) != 4000) {
+		fprintf(stderr, "FAIL: BIO_nwrite() = %d, want 4000\n", ret);
+		goto failure;
+	}
+	if (p != wp) {
+		fprintf(stderr, "FAIL: BIO_nwrite() returned different "
+		    "pointer to BIO_nwrite0()\n");
+		goto failure;
+	}
+	if ((ret = BIO_nwrite0(bio, &wp)) < (int)sizeof(data) - 4100) {
+		fprintf(stderr, "FAIL: BIO_nwrite0() = %d, want >= %zu\n",
+		    ret, sizeof(data) - 4100);
+		goto failure;
+	}
+	memcpy(wp, &data[4100], sizeof(data) - 4100);
+	if ((ret = BIO_nwrite(bio, &p, sizeof(data) - 4100)) !=
+	    sizeof(data) - 4100) {
+		fprintf(stderr, "FAIL: BIO_nwrite() = %d, want %zu\n", ret,
+		    sizeof(data) - 4100);
+		goto failure;
+	}
+
+	if (BIO_ctrl_pending(bio) != sizeof(data)) {
+		fprintf(stderr, "FAIL: BIO_ctrl_pending() = %zu, want %zu\n",
+		    BIO_ctrl_pending(bio), sizeof(data));
+		goto failure;
+	}
+	if ((ret = BIO_nread0(bio, &p)) != sizeof(data)) {
+		fprintf(stderr, "FAIL: BIO_nread0() = %d, want %zu\n", ret,
+		    sizeof(data));
+		goto failure;
+	}
+	if (memcmp(p, data, sizeof(data)) != 0) {
+		fprintf(stderr, "FAIL: BIO_nread0() returned differing data\n");
+		goto failure;
+	}
+	if ((ret = BIO_nread(bio, &p, 10)) != 10) {
+		fprintf(stderr, "FAIL: BIO_nread() = %d, want 10\n", ret);
+		goto failure;
+	}
+	if (p[0] != 0x01) {
+		fprintf(stderr, "FAIL: got 0x%x, want 0x%x\n", p[0], 0x01);
+		goto failure;
+	}
+	if (BIO_ctrl_pending(bio) != sizeof(data) - 10) {
+		fprintf(stderr, "FAIL: BIO_ctrl_pending() = %zu, want %zu\n",
+		    BIO_ctrl_pending(bio), sizeof(data) - 10);
+		goto failure;
+	}
+
+	/* The BUF_MEM only contains data that has not been read. */
+	if (!BIO_get_mem_ptr(bio, &pbuf)) {
+		fprintf(stderr, "FAIL: BIO_get_mem_ptr() failed\n");
+		goto failure;
+	}
+	if (pbuf->length != sizeof(data) - 10) {
+		fprintf(stderr, "FAIL: Got buffer with length %zu, want %zu\n",
+		    pbuf->length, sizeof(data) - 10);
+		goto failure;
+	}
+	if (memcmp(pbuf->data, &data[10], sizeof(data) - 10) != 0) {
+		fprintf(stderr, "FAIL: Got buffer with differing data\n");
+		goto failure;
+	}
+
+	if ((ret = BIO_nread(bio, &p, sizeof(data))) != sizeof(data) - 10) {
+		fprintf(stderr, "FAIL: BIO_nread() = %d, want %zu\n", ret,
+		    sizeof(data) - 10);
+		goto failure;
+	}
+	if (!BIO_eof(bio)) {
+		fprintf(stderr, "FAIL: BIO is not EOF\n");
+		goto failure;
+	}
+
+	/*
+	 * Space returned by BIO_nwrite0() is committed in place by
+	 * BIO_nwrite(), even if the BIO has been drained in the meantime.
+	 */
+	if ((ret = BIO_puts(bio, "abc")) != 3) {
+		fprintf(stderr, "FAIL: BIO_puts() = %d, want 3\n", ret);
+		goto failure;
+	}
+	if ((ret = BIO_nwrite0(bio, &wp)) <= 0) {
+		fprintf(stderr, "FAIL: BIO_nwrite0() = %d, want > 0\n", ret);
+		goto failure;
+	}
+	memcpy(wp, "def", 3);
+	if ((ret = BIO_nread(bio, &p, 3)) != 3) {
+		fprintf(stderr, "FAIL: BIO_nread() = %d, want 3\n", ret);
+		goto failure;
+	}
+	if ((ret = BIO_nwrite(bio, &p, 3)) != 3) {
+		fprintf(stderr, "FAIL: BIO_nwrite() = %d, want 3\n", ret);
+		goto failure;
+	}
+	if (p != wp) {
+		fprintf(stderr, "FAIL: BIO_nwrite() returned different "
+		    "pointer to BIO_nwrite0()\n");
+		goto failure;
+	}
+	if ((ret = BIO_nread0(bio, &p)) != 3) {
+		fprintf(stderr, "FAIL: BIO_nread0() = %d, want 3\n", ret);
+		goto failure;
+	}
+	if (memcmp(p, "def", 3) != 0) {
+		fprintf(stderr, "FAIL: BIO_nread0() returned differing data\n");
+		goto failure;
+	}
+	BIO_free(bio);
+
+	if ((bio = BIO_new_mem_buf(data, sizeof(data))) == NULL) {
+		fprintf(stderr, "FAIL: BIO_new_mem_buf failed\n");
+		goto failure;
+	}
+	if ((ret = BIO_nwrite0(bio, &wp)) != -1) {
+		fprintf(stderr, "FAIL: BIO_nwrite0() = %d, want -1\n", ret);
+		goto failure;
+	}
+	if ((ret = BIO_nread(bio, &p, 2)) != 2) {
+		fprintf(stderr, "FAIL: BIO_nread() = %d, want 2\n", ret);
+		goto failure;
+	}
+	if (p != (char *)data) {
+		fprintf(stderr, "FAIL: BIO_nread() did not return data\n");
+		goto failure;
+	}
+
+	failed = 0;
+
+ failure:
+	BIO_free(bio);
+
+	return failed;
+}
+
+#define STREAM_RECORD_LEN	16389
+
+/*
+ * Stream data through a memory BIO in the pattern used for TLS record I/O,
+ * with reads of a record header followed by the record body, while
+ * ensuring that the buffer does not grow beyond what is needed.
+ */
+static int
+bio_mem_stream_test(void)
+{
+	uint8_t wbuf[STREAM_RECORD_LEN], rbuf[STREAM_RECORD_LEN];
+	uint8_t wval = 0, rval = 0;
+	BUF_MEM *pbuf;
+	BIO *bio;
+	size_t i, j;
+	int ret;
+	int failed = 1;
+
+	if ((bio = BIO_new(BIO_s_mem())) == NULL) {
+		fprintf(stderr, "FAIL: BIO_new() returned NULL\n");
+		goto failure;
+	}
+
+	for (i = 0; i < 1000; i++) {
+		for (j = 0; j < sizeof(wbuf); j++)
+			wbuf[j] = wval++;
+		if ((ret = BIO_write(bio, wbuf, sizeof(wbuf))) !=
+		    sizeof(wbuf)) {
+			fprintf(stderr, "FAIL: BIO_write() = %d, want %zu\n",
+			    ret, sizeof(wbuf));
+			goto failure;
+		}
+		/* Leave a partial record in the BIO every second time. */
+		if (i % 2 == 0)
+			continue;
+		while (BIO_ctrl_pending(bio) >= sizeof(rbuf)) {
+			if ((ret = BIO_read(bio, rbuf, 5)) != 5) {
+				fprintf(stderr, "FAIL: BIO_read() = %d, "
+				    "want 5\n", ret);
+				goto failure;
+			}
+			if ((ret = BIO_read(bio, &rbuf[5], sizeof(rbuf) - 5)) !=
+			    sizeof(rbuf) - 5) {
+				fprintf(stderr, "FAIL: BIO_read() = %d, "
+				    "want %zu\n", ret, sizeof(rbuf) - 5);
+				goto failure;
+			}
+			for (j = 0; j < sizeof(rbuf); j++) {
+				if (rbuf[j] != rval++) {
+					fprintf(stderr, "FAIL: got 0x%x, "
+					    "want 0x%x\n", rbuf[j],
+					    (uint8_t)(rval - 1));
+					goto failure;
+				}
+			}
+		}
+	}
+
+	if (!BIO_get_mem_ptr(bio, &pbuf)) {
+		fprintf(stderr, "FAIL: BIO_get_mem_ptr() failed\n");
+		goto failure;
+	}
+	if (pbuf->max > 4 * sizeof(wbuf)) {
+		fprintf(stderr, "FAIL: buffer grew to %zu bytes\n", pbuf->max);
+		goto failure;
+	}
+
+	failed = 0;
+
+ failure:
+	BIO_free(bio);
+
+	return failed;
+}
+
+static volatile sig_atomic_t benchmark_stop;
+
+static void
+benchmark_sig_alarm(int sig)
+{
+	benchmark_stop = 1;
+}
+
+static void
+benchmark_stream(const char *desc, size_t record_len, int nio, int seconds)
+{
+	struct timespec start, end, duration;
+	uint8_t *buf;
+	long records = 0;
+	double secs;
+	char *p;
+	int ret;
+	BIO *bio;
+
+	if ((buf = calloc(1, record_len)) == NULL)
+		err(1, NULL);
+	if ((bio = BIO_new(BIO_s_mem())) == NULL)
+		errx(1, "BIO_new");
+
+	signal(SIGALRM, benchmark_sig_alarm);
+	benchmark_stop = 0;
+	alarm(seconds);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	/* Keep a partial record buffered, as is typical for network I/O. */
+	if (BIO_write(bio, buf, record_len / 2) != (int)record_len / 2)
+		errx(1, "BIO_write");
+
+	while (!benchmark_stop) {
+		if (nio) {
+			if (BIO_nwrite(bio, &p, record_len) != (int)record_len)
+				errx(1, "BIO_nwrite");
+			memcpy(p, buf, record_len);
+			if (BIO_nread(bio, &p, 5) != 5)
+				errx(1, "BIO_nread");
+			ret = BIO_nread(bio, &p, record_len - 5);
+			memcpy(buf, p, record_len - 5);
+		} else {
+			if (BIO_write(bio, buf, record_len) != (int)record_len)
+				errx(1, "BIO_write");
+			if (BIO_read(bio, buf, 5) != 5)
+				errx(1, "BIO_read");
+			ret = BIO_read(bio, buf, record_len - 5);
+		}
+		if (ret != (int)record_len - 5)
+			errx(1, "%s: read returned %d", desc, ret);
+		records++;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	timespecsub(&end, &start, &duration);
+	secs = duration.tv_sec + duration.tv_nsec / 1000000000.0;
+
+	fprintf(stderr, "%s, %zu byte records: %.2f MB/s\n", desc, record_len,
+	    records * record_len / secs / 1000000.0);
+
+	BIO_free(bio);
+	free(buf);
+}
+
+static void
+benchmark_bio_mem(int seconds)
+{
+	benchmark_stream("BIO_write/BIO_read", 1024 + 5, 0, seconds);
+	benchmark_stream("BIO_write/BIO_read", 16384 + 5, 0, seconds);
+	benchmark_stream("BIO_nwrite/BIO_nread", 1024 + 5, 1, seconds);
+	benchmark_stream("BIO_nwrite/BIO_nread", 16384 + 5, 1, seconds);
+}
+
 int
 main(int argc, char **argv)
 {
-	int failed = 0;
+	int benchmark = 0, failed = 0;
+
+	if (argc == 2 && strcmp(argv[1], "--benchmark") == 0)
+		benchmark = 1;
 
 	failed |= bio_mem_test();
 	failed |= bio_mem_small_io_test();
 	failed |= bio_mem_readonly_test();
+	failed |= bio_mem_nread_nwrite_test();
+	failed |= bio_mem_stream_test();
+
+	if (benchmark && !failed)
+		benchmark_bio_mem(2);
 
 	return failed;
 }
@@ -0,0 +1,511 @@
+/*	$OpenBSD$ */
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <sys/time.h>
+
+#include <dlfcn.h>
+#include <err.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <openssl/bn.h>
+#include <openssl/ec.h>
+#include <openssl/ecdsa.h>
+#include <openssl/obj_mac.h>
+#include <openssl/rsa.h>
+
+/*
+ * Count calls to the allocator, so that the benchmarks can report the
+ * number of allocations performed per operation.
+ */
+static void *(*real_malloc)(size_t);
+static void *(*real_calloc)(size_t, size_t);
+static void *(*real_realloc)(void *, size_t);
+static void *(*real_reallocarray)(void *, size_t, size_t);
+static void *(*real_recallocarray)(void *, size_t, size_t, size_t);
+
+static volatile unsigned long malloc_calls;
+
+static void
+malloc_count_init(void)
+{
+	if ((real_malloc = dlsym(RTLD_NEXT, "malloc")) == NULL)
+		errx(1, "dlsym malloc");
+	if ((real_calloc = dlsym(RTLD_NEXT, "calloc")) == NULL)
+		errx(1, "dlsym calloc");
+	if ((real_realloc = dlsym(RTLD_NEXT, "realloc")) == NULL)
+		errx(1, "dlsym realloc");
+	if ((real_reallocarray = dlsym(RTLD_NEXT, "reallocarray")) == NULL)
+		errx(1, "dlsym reallocarray");
+	if ((real_recallocarray = dlsym(RTLD_NEXT, "recallocarray")) == NULL)
+		errx(1, "dlsym recallocarray");
+}
+
+void *
+malloc(size_t size)
+{
+	if (real_malloc == NULL)
+		malloc_count_init();
+	malloc_calls++;
+	return real_malloc(size);
+}
+
+void *
+calloc(size_t nmemb, size_t size)
+{
+	if (real_calloc == NULL)
+		malloc_count_init();
+	malloc_calls++;
+	return real_calloc(nmemb, size);
+}
+
+void *
+realloc(void *ptr, size_t size)
+{
+	if (real_realloc == NULL)
+		malloc_count_init();
+	malloc_calls++;
+	return real_realloc(ptr, size);
+}
+
+void *
+reallocarray(void *ptr, size_t nmemb, size_t size)
+{
+	if (real_reallocarray == NULL)
+		malloc_count_init();
+	malloc_calls++;
+	return real_reallocarray(ptr, nmemb, size);
+}
+
+void *
+recallocarray(void *ptr, size_t oldnmemb, size_t nmemb, size_t size)
+{
+	if (real_recallocarray == NULL)
+		malloc_count_init();
+	malloc_calls++;
+	return real_recallocarray(ptr, oldnmemb, nmemb, size);
+}
+
+static int
+test_bn_ctx_groups(void)
+{
+	BN_CTX *bn_ctx;
+	BIGNUM *bns[100];
+	size_t i, j;
+	int failed = 1;
+
+	if ((bn_ctx = BN_CTX_new()) == NULL)
+		errx(1, "BN_CTX_new");
+
+	/* Nested groups that require the BN_CTX to grow several times. */
+	for (i = 0; i < 10; i++) {
+		BN_CTX_start(bn_ctx);
+		for (j = 0; j < 10; j++) {
+			if ((bns[i * 10 + j] = BN_CTX_get(bn_ctx)) == NULL) {
+				fprintf(stderr, "FAIL: BN_CTX_get() failed\n");
+				goto failure;
+			}
+			if (!BN_is_zero(bns[i * 10 + j])) {
+				fprintf(stderr, "FAIL: BN_CTX_get() returned "
+				    "non-zero BIGNUM\n");
+				goto failure;
+			}
+			if (!BN_set_word(bns[i * 10 + j], i * 10 + j + 1))
+				errx(1, "BN_set_word");
+		}
+	}
+
+	for (i = 0; i < 100; i++) {
+		for (j = i + 1; j < 100; j++) {
+			if (bns[i] == bns[j]) {
+				fprintf(stderr, "FAIL: BN_CTX_get() returned "
+				    "the same BIGNUM twice\n");
+				goto failure;
+			}
+		}
+		if (!BN_is_word(bns[i], i + 1)) {
+			fprintf(stderr, "FAIL: BIGNUM %zu was modified\n", i);
+			goto failure;
+		}
+	}
+
+	/* Ending the inner group must release only its BIGNUMs. */
+	BN_CTX_end(bn_ctx);
+	BN_CTX_start(bn_ctx);
+	for (j = 0; j < 10; j++) {
+		if (BN_CTX_get(bn_ctx) != bns[90 + j]) {
+			fprintf(stderr, "FAIL: BN_CTX_get() did not reuse "
+			    "released BIGNUM\n");
+			goto failure;
+		}
+	}
+	BN_CTX_end(bn_ctx);
+	for (i = 0; i < 90; i++) {
+		if (!BN_is_word(bns[i], i + 1)) {
+			fprintf(stderr, "FAIL: BIGNUM %zu was modified\n", i);
+			goto failure;
+		}
+	}
+
+	for (i = 0; i < 9; i++)
+		BN_CTX_end(bn_ctx);
+
+	failed = 0;
+
+ failure:
+	BN_CTX_free(bn_ctx);
+
+	return failed;
+}
+
+static int
+test_bn_ctx_reuse(int count_allocs)
+{
+	unsigned long mallocs = 0;
+	BN_CTX *bn_ctx;
+	BIGNUM *bn;
+	int i;
+	int failed = 1;
+
+	for (i = 0; i < 4; i++) {
+		if (i == 1)
+			mallocs = malloc_calls;
+
+		if ((bn_ctx = BN_CTX_new()) == NULL)
+			errx(1, "BN_CTX_new");
+
+		BN_CTX_start(bn_ctx);
+		if ((bn = BN_CTX_get(bn_ctx)) == NULL) {
+			fprintf(stderr, "FAIL: BN_CTX_get() failed\n");
+			goto failure;
+		}
+		if (!BN_is_zero(bn)) {
+			fprintf(stderr, "FAIL: BN_CTX_get() returned non-zero "
+			    "BIGNUM from reused BN_CTX\n");
+			goto failure;
+		}
+		if (BN_get_flags(bn, BN_FLG_CONSTTIME) != 0) {
+			fprintf(stderr, "FAIL: BN_CTX_get() returned BIGNUM "
+			    "with flags from reused BN_CTX\n");
+			goto failure;
+		}
+		BN_set_flags(bn, BN_FLG_CONSTTIME);
+		if (!BN_set_word(bn, 0xdeadbeef))
+			errx(1, "BN_set_word");
+		if (!BN_lshift(bn, bn, 1000))
+			errx(1, "BN_lshift");
+		BN_CTX_end(bn_ctx);
+
+		BN_CTX_free(bn_ctx);
+	}
+
+	/* Once a BN_CTX has been reused, it must not need to allocate. */
+	if (count_allocs && malloc_calls != mallocs) {
+		fprintf(stderr, "FAIL: reused BN_CTX performed %lu "
+		    "allocations\n", malloc_calls - mallocs);
+		goto failure;
+	}
+
+	/* A BN_CTX that is freed with open groups must not be reused. */
+	if ((bn_ctx = BN_CTX_new()) == NULL)
+		errx(1, "BN_CTX_new");
+	BN_CTX_start(bn_ctx);
+	if ((bn = BN_CTX_get(bn_ctx)) == NULL) {
+		fprintf(stderr, "FAIL: BN_CTX_get() failed\n");
+		goto failure;
+	}
+	if (!BN_set_word(bn, 1))
+		errx(1, "BN_set_word");
+	BN_CTX_free(bn_ctx);
+
+	if ((bn_ctx = BN_CTX_new()) == NULL)
+		errx(1, "BN_CTX_new");
+	BN_CTX_start(bn_ctx);
+	if ((bn = BN_CTX_get(bn_ctx)) == NULL) {
+		fprintf(stderr, "FAIL: BN_CTX_get() failed\n");
+		goto failure;
+	}
+	if (!BN_is_zero(bn)) {
+		fprintf(stderr, "FAIL: BN_CTX_get() returned non-zero BIGNUM\n");
+		goto failure;
+	}
+	BN_CTX_end(bn_ctx);
+
+	failed = 0;
+
+ failure:
+	BN_CTX_free(bn_ctx);
+
+	return failed;
+}
+
+static void *
+test_bn_ctx_thread(void *arg)
+{
+	int *failed = arg;
+
+	*failed = test_bn_ctx_groups() | test_bn_ctx_reuse(0);
+
+	return NULL;
+}
+
+static int
+test_bn_ctx_threads(void)
+{
+	pthread_t threads[4];
+	int thread_failed[4];
+	int i;
+	int failed = 0;
+
+	for (i = 0; i < 4; i++) {
+		thread_failed[i] = 1;
+		if (pthread_create(&threads[i], NULL, test_bn_ctx_thread,
+		    &thread_failed[i]) != 0)
+			errx(1, "pthread_create");
+	}
+	for (i = 0; i < 4; i++) {
+		if (pthread_join(threads[i], NULL) != 0)
+			errx(1, "pthread_join");
+		failed |= thread_failed[i];
+	}
+
+	return failed;
+}
+
+struct benchmark {
+	const char *desc;
+	void *(*setup)(void);
+	void (*run_once)(void *);
+	void (*cleanup)(void *);
+};
+
+static void *
+benchmark_bn_ctx_setup(void)
+{
+	return NULL;
+}
+
+static void
+benchmark_bn_ctx_run_once(void *arg)
+{
+	BN_CTX *bn_ctx;
+	int i;
+
+	if ((bn_ctx = BN_CTX_new()) == NULL)
+		errx(1, "BN_CTX_new");
+	BN_CTX_start(bn_ctx);
+	for (i = 0; i < 16; i++) {
+		if (BN_CTX_get(bn_ctx) == NULL)
+			errx(1, "BN_CTX_get");
+	}
+	BN_CTX_end(bn_ctx);
+	BN_CTX_free(bn_ctx);
+}
+
+static void
+benchmark_bn_ctx_cleanup(void *arg)
+{
+}
+
+static void *
+benchmark_rsa_setup(void)
+{
+	BIGNUM *e;
+	RSA *rsa;
+
+	if ((e = BN_new()) == NULL)
+		errx(1, "BN_new");
+	if (!BN_set_word(e, RSA_F4))
+		errx(1, "BN_set_word");
+	if ((rsa = RSA_new()) == NULL)
+		errx(1, "RSA_new");
+	if (!RSA_generate_key_ex(rsa, 2048, e, NULL))
+		errx(1, "RSA_generate_key_ex");
+	BN_free(e);
+
+	return rsa;
+}
+
+static void
+benchmark_rsa_run_once(void *arg)
+{
+	unsigned char digest[32] = { 0 };
+	unsigned char sig[256];
+	unsigned int siglen;
+	RSA *rsa = arg;
+
+	if (!RSA_sign(NID_sha256, digest, sizeof(digest), sig, &siglen, rsa))
+		errx(1, "RSA_sign");
+}
+
+static void
+benchmark_rsa_cleanup(void *arg)
+{
+	RSA_free(arg);
+}
+
+static void *
+benchmark_ecdsa_setup(int nid)
+{
+	EC_KEY *ec_key;
+
+	if ((ec_key = EC_KEY_new_by_curve_name(nid)) == NULL)
+		errx(1, "EC_KEY_new_by_curve_name");
+	if (!EC_KEY_generate_key(ec_key))
+		errx(1, "EC_KEY_generate_key");
+
+	return ec_key;
+}
+
+static void *
+benchmark_ecdsa_p256_setup(void)
+{
+	return benchmark_ecdsa_setup(NID_X9_62_prime256v1);
+}
+
+static void *
+benchmark_ecdsa_p384_setup(void)
+{
+	return benchmark_ecdsa_setup(NID_secp384r1);
+}
+
+static void
+benchmark_ecdsa_run_once(void *arg)
+{
+	unsigned char digest[32] = { 0 };
+	EC_KEY *ec_key = arg;
+	ECDSA_SIG *sig;
+
+	if ((sig = ECDSA_do_sign(digest, sizeof(digest), ec_key)) == NULL)
+		errx(1, "ECDSA_do_sign");
+	ECDSA_SIG_free(sig);
+}
+
+static void
+benchmark_ecdsa_cleanup(void *arg)
+{
+	EC_KEY_free(arg);
+}
+
+static const struct benchmark benchmarks[] = {
+	{
+		.desc = "BN_CTX_new()/BN_CTX_get() x 16/BN_CTX_free()",
+		.setup = benchmark_bn_ctx_setup,
+		.run_once = benchmark_bn_ctx_run_once,
+		.cleanup = benchmark_bn_ctx_cleanup,
+	},
+	{
+		.desc = "RSA 2048 sign",
+		.setup = benchmark_rsa_setup,
+		.run_once = benchmark_rsa_run_once,
+		.cleanup = benchmark_rsa_cleanup,
+	},
+	{
+		.desc = "ECDSA P-256 sign",
+		.setup = benchmark_ecdsa_p256_setup,
+		.run_once = benchmark_ecdsa_run_once,
+		.cleanup = benchmark_ecdsa_cleanup,
+	},
+	{
+		.desc = "ECDSA P-384 sign",
+		.setup = benchmark_ecdsa_p384_setup,
+		.run_once = benchmark_ecdsa_run_once,
+		.cleanup = benchmark_ecdsa_cleanup,
+	},
+};
+
+#define N_BENCHMARKS (sizeof(benchmarks) / sizeof(benchmarks[0]))
+
+static volatile sig_atomic_t benchmark_stop;
+
+static void
+benchmark_sig_alarm(int sig)
+{
+	benchmark_stop = 1;
+}
+
+static void
+benchmark_run(const struct benchmark *bm, int seconds)
+{
+	struct timespec start, end, duration;
+	unsigned long mallocs;
+	void *arg;
+	int i;
+
+	signal(SIGALRM, benchmark_sig_alarm);
+
+	arg = bm->setup();
+
+	/* Warm up, so that any one-time allocations are not counted. */
+	bm->run_once(arg);
+
+	benchmark_stop = 0;
+	i = 0;
+	alarm(seconds);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	mallocs = malloc_calls;
+
+	fprintf(stderr, "Benchmarking %s for %ds: ", bm->desc, seconds);
+	while (!benchmark_stop) {
+		bm->run_once(arg);
+		i++;
+	}
+	mallocs = malloc_calls - mallocs;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	timespecsub(&end, &start, &duration);
+	fprintf(stderr, "%d iterations in %f seconds, %.1f allocations per "
+	    "iteration\n", i, duration.tv_sec + duration.tv_nsec / 1000000000.0,
+	    (double)mallocs / i);
+
+	bm->cleanup(arg);
+}
+
+static void
+benchmark_bn_ctx(void)
+{
+	const struct benchmark *bm;
+	size_t i;
+
+	for (i = 0; i < N_BENCHMARKS; i++) {
+		bm = &benchmarks[i];
+		benchmark_run(bm, 5);
+	}
+}
+
+int
+main(int argc, char **argv)
+{
+	int benchmark = 0, failed = 0;
+
+	if (argc == 2 && strcmp(argv[1], "--benchmark") == 0)
+		benchmark = 1;
+
+	failed |= test_bn_ctx_groups();
+	failed |= test_bn_ctx_reuse(1);
+	failed |= test_bn_ctx_threads();
+
+	if (benchmark && !failed)
+		benchmark_bn_ctx();
+
+	return failed;
+}
@@ -524,6 +524,126 @@ test_bn_mod_exp2(void)
 	return failed;
 }
 
+#define N_MOD_EXP_MB_TESTS	20
+
+static int
+bn_mod_exp_mb_test(int reduce, BIGNUM **want, BIGNUM **got, BIGNUM **a,
+    BIGNUM **p, BIGNUM **m, BN_CTX *ctx)
+{
+	size_t i, n;
+	int bits;
+	int failed = 0;
+
+	n = 1 + arc4random_uniform(BN_MOD_EXP_MB_LANES);
+
+	for (i = 0; i < n; i++) {
+		bits = 2 + arc4random_uniform(BN_MOD_EXP_MB_MAX_BITS - 1);
+		if (!BN_rand(m[i], bits, 0, 1))
+			errx(1, "BN_rand");
+		if (!BN_rand(p[i], 1 + arc4random_uniform(bits), 0, 0))
+			errx(1, "BN_rand");
+		if (!BN_rand(a[i], bits + 64, 0, 0))
+			errx(1, "BN_rand");
+		if (reduce && !BN_mod(a[i], a[i], m[i], ctx))
+			errx(1, "BN_mod");
+		if (!BN_mod_exp_simple(want[i], a[i], p[i], m[i], ctx))
+			errx(1, "BN_mod_exp_simple");
+	}
+
+	if (!bn_mod_exp_mont_consttime_mb(got, (const BIGNUM **)a,
+	    (const BIGNUM **)p, (const BIGNUM **)m, n, ctx)) {
+		fprintf(stderr, "FAIL: bn_mod_exp_mont_consttime_mb "
+		    "with %zu lanes\n", n);
+		return 1;
+	}
+
+	for (i = 0; i < n; i++) {
+		if (BN_cmp(want[i], got[i]) != 0) {
+			dump_results(a[i], p[i], NULL, NULL, m[i], want[i],
+			    got[i], "bn_mod_exp_mont_consttime_mb");
+			failed |= 1;
+		}
+	}
+
+	return failed;
+}
+
+static int
+test_bn_mod_exp_mb(void)
+{
+	BIGNUM *a[BN_MOD_EXP_MB_LANES], *p[BN_MOD_EXP_MB_LANES];
+	BIGNUM *m[BN_MOD_EXP_MB_LANES], *want[BN_MOD_EXP_MB_LANES];
+	BIGNUM *got[BN_MOD_EXP_MB_LANES];
+	BN_CTX *ctx;
+	size_t i;
+	int reduce;
+	int failed = 0;
+
+	if ((ctx = BN_CTX_new()) == NULL)
+		errx(1, "BN_CTX_new");
+
+	BN_CTX_start(ctx);
+
+	for (i = 0; i < BN_MOD_EXP_MB_LANES; i++) {
+		if ((a[i] = BN_CTX_get(ctx)) == NULL)
+			errx(1, "a = BN_CTX_get()");
+		if ((p[i] = BN_CTX_get(ctx)) == NULL)
+			errx(1, "p = BN_CTX_get()");
+		if ((m[i] = BN_CTX_get(ctx)) == NULL)
+			errx(1, "m = BN_CTX_get()");
+		if ((want[i] = BN_CTX_get(ctx)) == NULL)
+			errx(1, "want = BN_CTX_get()");
+		if ((got[i] = BN_CTX_get(ctx)) == NULL)
+			errx(1, "got = BN_CTX_get()");
+	}
+
+	reduce = 0;
+	for (i = 0; i < N_MOD_EXP_MB_TESTS && !failed; i++)
+		failed |= bn_mod_exp_mb_test(reduce, want, got, a, p, m, ctx);
+
+	reduce = 1;
+	for (i = 0; i < N_MOD_EXP_MB_TESTS && !failed; i++)
+		failed |= bn_mod_exp_mb_test(reduce, want, got, a, p, m, ctx);
+
+	/* A zero exponent and a modulus of one. */
+	if (!BN_set_word(m[0], 1) || !BN_set_word(m[1], 7))
+		errx(1, "BN_set_word");
+	BN_zero(p[0]);
+	BN_zero(p[1]);
+	if (!bn_mod_exp_mont_consttime_mb(got, (const BIGNUM **)a,
+	    (const BIGNUM **)p, (const BIGNUM **)m, 2, ctx))
+		errx(1, "bn_mod_exp_mont_consttime_mb");
+	if (!BN_is_zero(got[0]) || !BN_is_one(got[1])) {
+		fprintf(stderr, "FAIL: bn_mod_exp_mont_consttime_mb with "
+		    "zero exponent\n");
+		failed |= 1;
+	}
+
+	/* Even and overlong moduli must be rejected. */
+	if (!BN_set_word(m[0], 8))
+		errx(1, "BN_set_word");
+	if (bn_mod_exp_mont_consttime_mb(got, (const BIGNUM **)a,
+	    (const BIGNUM **)p, (const BIGNUM **)m, 1, ctx)) {
+		fprintf(stderr, "FAIL: bn_mod_exp_mont_consttime_mb succeeded "
+		    "with even modulus\n");
+		failed |= 1;
+	}
+	if (!BN_rand(m[0], BN_MOD_EXP_MB_MAX_BITS + 1, 0, 1))
+		errx(1, "BN_rand");
+	if (bn_mod_exp_mont_consttime_mb(got, (const BIGNUM **)a,
+	    (const BIGNUM **)p, (const BIGNUM **)m, 1, ctx)) {
+		fprintf(stderr, "FAIL: bn_mod_exp_mont_consttime_mb succeeded "
+		    "with %d bit modulus\n", BN_MOD_EXP_MB_MAX_BITS + 1);
+		failed |= 1;
+	}
+	ERR_clear_error();
+
+	BN_CTX_end(ctx);
+	BN_CTX_free(ctx);
+
+	return failed;
+}
+
 /*
  * Small test for a crash reported by Guido Vranken, fixed in bn_exp2.c r1.13.
  * https://github.com/openssl/openssl/issues/17648
@@ -556,6 +676,7 @@ main(void)
 	failed |= test_bn_mod_exp_zero();
 	failed |= test_bn_mod_exp();
 	failed |= test_bn_mod_exp2();
+	failed |= test_bn_mod_exp_mb();
 	failed |= test_bn_mod_exp2_mont_crash();
 
 	return failed;
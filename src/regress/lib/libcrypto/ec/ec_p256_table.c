@@ -0,0 +1,401 @@
+/*	$OpenBSD$ */
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Check the precomputed base tables of the P-256 EC_METHOD against multiples
+ * of the generator computed with the generic method, check that the comb
+ * agrees with the generic method for random scalars and check the constant
+ * time reduction of scalars modulo the group order.
+ */
+
+#include <err.h>
+#include <stdio.h>
+
+#include "ecp_p256.c"
+
+#ifdef HAVE_EC_GFP_P256_METHOD
+
+#define N_RANDOM_SCALARS 100
+
+static EC_GROUP *
+generic_p256_group(const EC_GROUP *named, BN_CTX *ctx)
+{
+	EC_GROUP *group;
+	EC_POINT *generator;
+	BIGNUM *p, *a, *b, *x, *y;
+
+	BN_CTX_start(ctx);
+
+	if ((p = BN_CTX_get(ctx)) == NULL)
+		errx(1, "BN_CTX_get");
+	if ((a = BN_CTX_get(ctx)) == NULL)
+		errx(1, "BN_CTX_get");
+	if ((b = BN_CTX_get(ctx)) == NULL)
+		errx(1, "BN_CTX_get");
+	if ((x = BN_CTX_get(ctx)) == NULL)
+		errx(1, "BN_CTX_get");
+	if ((y = BN_CTX_get(ctx)) == NULL)
+		errx(1, "BN_CTX_get");
+
+	if (!EC_GROUP_get_curve(named, p, a, b, ctx))
+		errx(1, "EC_GROUP_get_curve");
+	if ((group = EC_GROUP_new(EC_GFp_mont_method())) == NULL)
+		errx(1, "EC_GROUP_new");
+	if (!EC_GROUP_set_curve(group, p, a, b, ctx))
+		errx(1, "EC_GROUP_set_curve");
+	if (!EC_POINT_get_affine_coordinates(named,
+	    EC_GROUP_get0_generator(named), x, y, ctx))
+		errx(1, "EC_POINT_get_affine_coordinates");
+	if ((generator = EC_POINT_new(group)) == NULL)
+		errx(1, "EC_POINT_new");
+	if (!EC_POINT_set_affine_coordinates(group, generator, x, y, ctx))
+		errx(1, "EC_POINT_set_affine_coordinates");
+	if (!EC_GROUP_set_generator(group, generator, &named->order,
+	    &named->cofactor))
+		errx(1, "EC_GROUP_set_generator");
+
+	EC_POINT_free(generator);
+	BN_CTX_end(ctx);
+
+	return group;
+}
+
+static int
+p256_points_equal(const EC_GROUP *group_a, const EC_POINT *a,
+    const EC_GROUP *group_b, const EC_POINT *b, BN_CTX *ctx)
+{
+	unsigned char buf_a[65], buf_b[65];
+	size_t len_a, len_b;
+	int inf_a, inf_b;
+
+	inf_a = EC_POINT_is_at_infinity(group_a, a);
+	inf_b = EC_POINT_is_at_infinity(group_b, b);
+	if (inf_a || inf_b)
+		return inf_a == inf_b;
+
+	len_a = EC_POINT_point2oct(group_a, a, POINT_CONVERSION_UNCOMPRESSED,
+	    buf_a, sizeof(buf_a), ctx);
+	len_b = EC_POINT_point2oct(group_b, b, POINT_CONVERSION_UNCOMPRESSED,
+	    buf_b, sizeof(buf_b), ctx);
+
+	return len_a != 0 && len_a == len_b &&
+	    memcmp(buf_a, buf_b, len_a) == 0;
+}
+
+static int
+p256_base_table_test(void)
+{
+	static const p256_felem raw_one = { 1 };
+	EC_GROUP *named = NULL, *generic = NULL;
+	EC_POINT *entry = NULL, *expected = NULL;
+	BIGNUM *x, *y, *scalar;
+	const struct p256_affine *a;
+	p256_felem t;
+	BN_CTX *ctx;
+	int i, idx, j;
+	int failed = 1;
+
+	if ((ctx = BN_CTX_new()) == NULL)
+		errx(1, "BN_CTX_new");
+	BN_CTX_start(ctx);
+
+	if ((x = BN_CTX_get(ctx)) == NULL)
+		errx(1, "BN_CTX_get");
+	if ((y = BN_CTX_get(ctx)) == NULL)
+		errx(1, "BN_CTX_get");
+	if ((scalar = BN_CTX_get(ctx)) == NULL)
+		errx(1, "BN_CTX_get");
+
+	if ((named = EC_GROUP_new_by_curve_name(NID_X9_62_prime256v1)) == NULL)
+		errx(1, "EC_GROUP_new_by_curve_name");
+	generic = generic_p256_group(named, ctx);
+
+	if ((entry = EC_POINT_new(generic)) == NULL)
+		errx(1, "EC_POINT_new");
+	if ((expected = EC_POINT_new(generic)) == NULL)
+		errx(1, "EC_POINT_new");
+
+	if (!p256_is_generator(EC_GROUP_get0_generator(named))) {
+		fprintf(stderr, "FAIL: generator does not match base table\n");
+		goto err;
+	}
+
+	for (j = 0; j < 2; j++) {
+		for (idx = 0; idx < 16; idx++) {
+			a = &p256_base_table[j][idx];
+
+			/* The sum of b_i * 2^(64 * i + 32 * j) * G. */
+			BN_zero(scalar);
+			for (i = 0; i < 4; i++) {
+				if (((idx >> i) & 1) == 0)
+					continue;
+				if (!BN_set_bit(scalar, 64 * i + 32 * j))
+					errx(1, "BN_set_bit");
+			}
+			if (!EC_POINT_mul(generic, expected, scalar, NULL, NULL,
+			    ctx))
+				errx(1, "EC_POINT_mul");
+
+			if (idx == 0) {
+				if (!p256_felem_is_zero_mask(a->x) ||
+				    !p256_felem_is_zero_mask(a->y)) {
+					fprintf(stderr, "FAIL: table %d "
+					    "entry 0 is not zero\n", j);
+					goto err;
+				}
+				continue;
+			}
+
+			/* Convert out of the Montgomery domain. */
+			p256_felem_mul(t, a->x, raw_one);
+			if (!p256_felem_to_bn(x, t))
+				errx(1, "p256_felem_to_bn");
+			p256_felem_mul(t, a->y, raw_one);
+			if (!p256_felem_to_bn(y, t))
+				errx(1, "p256_felem_to_bn");
+
+			if (!EC_POINT_set_affine_coordinates(generic, entry,
+			    x, y, ctx)) {
+				fprintf(stderr, "FAIL: table %d entry %d is "
+				    "not on the curve\n", j, idx);
+				goto err;
+			}
+			if (EC_POINT_is_on_curve(generic, entry, ctx) != 1) {
+				fprintf(stderr, "FAIL: table %d entry %d is "
+				    "not on the curve\n", j, idx);
+				goto err;
+			}
+			if (!p256_points_equal(generic, entry, generic,
+			    expected, ctx)) {
+				fprintf(stderr, "FAIL: table %d entry %d is "
+				    "not the expected multiple\n", j, idx);
+				goto err;
+			}
+		}
+	}
+
+	failed = 0;
+
+ err:
+	EC_POINT_free(entry);
+	EC_POINT_free(expected);
+	EC_GROUP_free(named);
+	EC_GROUP_free(generic);
+	BN_CTX_end(ctx);
+	BN_CTX_free(ctx);
+
+	return failed;
+}
+
+static int
+p256_comb_test(void)
+{
+	EC_GROUP *named = NULL, *generic = NULL;
+	EC_POINT *comb = NULL, *expected = NULL;
+	struct p256_point out;
+	BIGNUM *scalar;
+	p256_felem k;
+	BN_CTX *ctx;
+	int i;
+	int failed = 1;
+
+	if ((ctx = BN_CTX_new()) == NULL)
+		errx(1, "BN_CTX_new");
+	BN_CTX_start(ctx);
+
+	if ((scalar = BN_CTX_get(ctx)) == NULL)
+		errx(1, "BN_CTX_get");
+
+	if ((named = EC_GROUP_new_by_curve_name(NID_X9_62_prime256v1)) == NULL)
+		errx(1, "EC_GROUP_new_by_curve_name");
+	generic = generic_p256_group(named, ctx);
+
+	if ((comb = EC_POINT_new(named)) == NULL)
+		errx(1, "EC_POINT_new");
+	if ((expected = EC_POINT_new(generic)) == NULL)
+		errx(1, "EC_POINT_new");
+
+	for (i = 0; i < N_RANDOM_SCALARS; i++) {
+		if (!BN_rand_range(scalar, &named->order))
+			errx(1, "BN_rand_range");
+
+		if (!p256_scalar_from_bn(named, k, scalar, ctx))
+			errx(1, "p256_scalar_from_bn");
+		p256_point_mul_base(&out, k);
+		if (!p256_point_to_ec_point(named, comb, &out))
+			errx(1, "p256_point_to_ec_point");
+
+		if (!EC_POINT_mul(generic, expected, scalar, NULL, NULL, ctx))
+			errx(1, "EC_POINT_mul");
+
+		if (EC_POINT_is_on_curve(named, comb, ctx) != 1 ||
+		    !p256_points_equal(named, comb, generic, expected, ctx)) {
+			fprintf(stderr, "FAIL: comb differs for scalar ");
+			BN_print_fp(stderr, scalar);
+			fprintf(stderr, "\n");
+			goto err;
+		}
+	}
+
+	failed = 0;
+
+ err:
+	EC_POINT_free(comb);
+	EC_POINT_free(expected);
+	EC_GROUP_free(named);
+	EC_GROUP_free(generic);
+	BN_CTX_end(ctx);
+	BN_CTX_free(ctx);
+
+	return failed;
+}
+
+static int
+p256_scalar_compare(const EC_GROUP *group, const BIGNUM *scalar,
+    BIGNUM *reduced, BN_CTX *ctx)
+{
+	p256_felem k;
+	BIGNUM *expected;
+	int failed = 1;
+
+	BN_CTX_start(ctx);
+
+	if ((expected = BN_CTX_get(ctx)) == NULL)
+		errx(1, "BN_CTX_get");
+	if (!BN_nnmod(expected, scalar, &group->order, ctx))
+		errx(1, "BN_nnmod");
+
+	if (!p256_scalar_from_bn(group, k, scalar, ctx))
+		errx(1, "p256_scalar_from_bn");
+	if (!p256_felem_to_bn(reduced, k))
+		errx(1, "p256_felem_to_bn");
+
+	if (BN_cmp(reduced, expected) != 0) {
+		fprintf(stderr, "FAIL: scalar ");
+		BN_print_fp(stderr, scalar);
+		fprintf(stderr, " reduced to ");
+		BN_print_fp(stderr, reduced);
+		fprintf(stderr, "\n");
+		goto err;
+	}
+
+	failed = 0;
+
+ err:
+	BN_CTX_end(ctx);
+
+	return failed;
+}
+
+static int
+p256_scalar_test(void)
+{
+	EC_GROUP *named = NULL;
+	BIGNUM *k, *scalar, *reduced;
+	BN_CTX *ctx;
+	int i, j;
+	int failed = 1;
+
+	if ((ctx = BN_CTX_new()) == NULL)
+		errx(1, "BN_CTX_new");
+	BN_CTX_start(ctx);
+
+	if ((k = BN_CTX_get(ctx)) == NULL)
+		errx(1, "BN_CTX_get");
+	if ((scalar = BN_CTX_get(ctx)) == NULL)
+		errx(1, "BN_CTX_get");
+	if ((reduced = BN_CTX_get(ctx)) == NULL)
+		errx(1, "BN_CTX_get");
+
+	if ((named = EC_GROUP_new_by_curve_name(NID_X9_62_prime256v1)) == NULL)
+		errx(1, "EC_GROUP_new_by_curve_name");
+
+	if (!p256_order_is_n(named)) {
+		fprintf(stderr, "FAIL: group order is not n\n");
+		goto err;
+	}
+
+	/* The largest 257 bit scalar and values around multiples of n. */
+	BN_zero(scalar);
+	if (!BN_set_bit(scalar, 257) || !BN_sub_word(scalar, 1))
+		errx(1, "BN_set_bit");
+	if (p256_scalar_compare(named, scalar, reduced, ctx))
+		goto err;
+	for (i = 0; i < 3; i++) {
+		if (!BN_set_word(k, i))
+			errx(1, "BN_set_word");
+		if (!BN_sub(k, &named->order, k))
+			errx(1, "BN_sub");
+		if (!BN_copy(scalar, k))
+			errx(1, "BN_copy");
+		for (j = 0; j < 3; j++) {
+			if (p256_scalar_compare(named, scalar, reduced, ctx))
+				goto err;
+			if (!BN_add(scalar, scalar, &named->order))
+				errx(1, "BN_add");
+		}
+	}
+
+	/* Random k, k + n and k + 2n as used by ECDSA signing. */
+	for (i = 0; i < N_RANDOM_SCALARS; i++) {
+		if (!BN_rand_range(k, &named->order))
+			errx(1, "BN_rand_range");
+		if (!BN_copy(scalar, k))
+			errx(1, "BN_copy");
+		for (j = 0; j < 3; j++) {
+			if (p256_scalar_compare(named, scalar, reduced, ctx))
+				goto err;
+			if (BN_cmp(reduced, k) != 0)
+				goto err;
+			if (!BN_add(scalar, scalar, &named->order))
+				errx(1, "BN_add");
+		}
+	}
+
+	failed = 0;
+
+ err:
+	EC_GROUP_free(named);
+	BN_CTX_end(ctx);
+	BN_CTX_free(ctx);
+
+	return failed;
+}
+
+int
+main(int argc, char **argv)
+{
+	int failed = 0;
+
+	failed |= p256_base_table_test();
+	failed |= p256_comb_test();
+	failed |= p256_scalar_test();
+
+	return failed;
+}
+
+#else
+
+int
+main(int argc, char **argv)
+{
+	printf("SKIPPED: no P-256 EC_METHOD\n");
+
+	return 0;
+}
+
+#endif /* HAVE_EC_GFP_P256_METHOD */
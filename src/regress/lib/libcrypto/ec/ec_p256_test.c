@@ -0,0 +1,287 @@
+/*	$OpenBSD$ */
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Compare the scalar multiplications of the P-256 named curve, which uses a
+ * dedicated EC_METHOD where available, against the same curve constructed
+ * from explicit parameters, which uses the generic Montgomery method.
+ */
+
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <openssl/bn.h>
+#include <openssl/ec.h>
+#include <openssl/objects.h>
+
+#define N_RANDOM_SCALARS 100
+
+static EC_GROUP *
+explicit_p256_group(const EC_GROUP *named, BN_CTX *ctx)
+{
+	EC_GROUP *group;
+	EC_POINT *generator;
+	BIGNUM *p, *a, *b, *x, *y, *order, *cofactor;
+
+	BN_CTX_start(ctx);
+
+	if ((p = BN_CTX_get(ctx)) == NULL)
+		errx(1, "BN_CTX_get");
+	if ((a = BN_CTX_get(ctx)) == NULL)
+		errx(1, "BN_CTX_get");
+	if ((b = BN_CTX_get(ctx)) == NULL)
+		errx(1, "BN_CTX_get");
+	if ((x = BN_CTX_get(ctx)) == NULL)
+		errx(1, "BN_CTX_get");
+	if ((y = BN_CTX_get(ctx)) == NULL)
+		errx(1, "BN_CTX_get");
+	if ((order = BN_CTX_get(ctx)) == NULL)
+		errx(1, "BN_CTX_get");
+	if ((cofactor = BN_CTX_get(ctx)) == NULL)
+		errx(1, "BN_CTX_get");
+
+	if (!EC_GROUP_get_curve(named, p, a, b, ctx))
+		errx(1, "EC_GROUP_get_curve");
+	if ((group = EC_GROUP_new_curve_GFp(p, a, b, ctx)) == NULL)
+		errx(1, "EC_GROUP_new_curve_GFp");
+	if (!EC_POINT_get_affine_coordinates(named,
+	    EC_GROUP_get0_generator(named), x, y, ctx))
+		errx(1, "EC_POINT_get_affine_coordinates");
+	if ((generator = EC_POINT_new(group)) == NULL)
+		errx(1, "EC_POINT_new");
+	if (!EC_POINT_set_affine_coordinates(group, generator, x, y, ctx))
+		errx(1, "EC_POINT_set_affine_coordinates");
+	if (!EC_GROUP_get_order(named, order, ctx))
+		errx(1, "EC_GROUP_get_order");
+	if (!EC_GROUP_get_cofactor(named, cofactor, ctx))
+		errx(1, "EC_GROUP_get_cofactor");
+	if (!EC_GROUP_set_generator(group, generator, order, cofactor))
+		errx(1, "EC_GROUP_set_generator");
+
+	EC_POINT_free(generator);
+	BN_CTX_end(ctx);
+
+	return group;
+}
+
+static int
+points_equal(const char *label, const BIGNUM *scalar, const EC_GROUP *group_a,
+    const EC_POINT *a, const EC_GROUP *group_b, const EC_POINT *b,
+    BN_CTX *ctx)
+{
+	unsigned char buf_a[65], buf_b[65];
+	size_t len_a, len_b;
+	int inf_a, inf_b;
+
+	inf_a = EC_POINT_is_at_infinity(group_a, a);
+	inf_b = EC_POINT_is_at_infinity(group_b, b);
+	if (inf_a != inf_b)
+		goto fail;
+	if (inf_a)
+		return 1;
+
+	if (EC_POINT_is_on_curve(group_a, a, ctx) != 1) {
+		fprintf(stderr, "FAIL: %s: point is not on curve\n", label);
+		return 0;
+	}
+
+	len_a = EC_POINT_point2oct(group_a, a, POINT_CONVERSION_UNCOMPRESSED,
+	    buf_a, sizeof(buf_a), ctx);
+	len_b = EC_POINT_point2oct(group_b, b, POINT_CONVERSION_UNCOMPRESSED,
+	    buf_b, sizeof(buf_b), ctx);
+	if (len_a == 0 || len_a != len_b ||
+	    memcmp(buf_a, buf_b, len_a) != 0)
+		goto fail;
+
+	return 1;
+
+ fail:
+	fprintf(stderr, "FAIL: %s: points differ for scalar ", label);
+	BN_print_fp(stderr, scalar);
+	fprintf(stderr, "\n");
+
+	return 0;
+}
+
+static int
+p256_compare_scalar(const EC_GROUP *named, const EC_GROUP *explicit,
+    const EC_POINT *point_n, const EC_POINT *point_e, const BIGNUM *scalar,
+    BN_CTX *ctx)
+{
+	EC_POINT *r_n = NULL, *r_e = NULL;
+	int failed = 1;
+
+	if ((r_n = EC_POINT_new(named)) == NULL)
+		errx(1, "EC_POINT_new");
+	if ((r_e = EC_POINT_new(explicit)) == NULL)
+		errx(1, "EC_POINT_new");
+
+	/* Generator multiplication. */
+	if (!EC_POINT_mul(named, r_n, scalar, NULL, NULL, ctx))
+		errx(1, "EC_POINT_mul");
+	if (!EC_POINT_mul(explicit, r_e, scalar, NULL, NULL, ctx))
+		errx(1, "EC_POINT_mul");
+	if (!points_equal("generator", scalar, named, r_n, explicit, r_e, ctx))
+		goto err;
+
+	/* Variable base multiplication. */
+	if (!EC_POINT_mul(named, r_n, NULL, point_n, scalar, ctx))
+		errx(1, "EC_POINT_mul");
+	if (!EC_POINT_mul(explicit, r_e, NULL, point_e, scalar, ctx))
+		errx(1, "EC_POINT_mul");
+	if (!points_equal("single", scalar, named, r_n, explicit, r_e, ctx))
+		goto err;
+
+	/* Double multiplication, as used for ECDSA verification. */
+	if (!EC_POINT_mul(named, r_n, scalar, point_n, scalar, ctx))
+		errx(1, "EC_POINT_mul");
+	if (!EC_POINT_mul(explicit, r_e, scalar, point_e, scalar, ctx))
+		errx(1, "EC_POINT_mul");
+	if (!points_equal("double", scalar, named, r_n, explicit, r_e, ctx))
+		goto err;
+
+	failed = 0;
+
+ err:
+	EC_POINT_free(r_n);
+	EC_POINT_free(r_e);
+
+	return failed;
+}
+
+static int
+p256_mul_test(void)
+{
+	EC_GROUP *named = NULL, *explicit = NULL;
+	EC_POINT *point_n = NULL, *point_e = NULL;
+	BIGNUM *order = NULL, *scalar = NULL;
+	unsigned char buf[65];
+	size_t len;
+	BN_CTX *ctx;
+	int i;
+	int failed = 1;
+
+	if ((ctx = BN_CTX_new()) == NULL)
+		errx(1, "BN_CTX_new");
+	if ((order = BN_new()) == NULL)
+		errx(1, "BN_new");
+	if ((scalar = BN_new()) == NULL)
+		errx(1, "BN_new");
+
+	if ((named = EC_GROUP_new_by_curve_name(NID_X9_62_prime256v1)) == NULL)
+		errx(1, "EC_GROUP_new_by_curve_name");
+	explicit = explicit_p256_group(named, ctx);
+	if (!EC_GROUP_get_order(named, order, ctx))
+		errx(1, "EC_GROUP_get_order");
+
+	if (EC_GROUP_cmp(named, explicit, ctx) != 0) {
+		fprintf(stderr, "FAIL: named and explicit groups differ\n");
+		goto err;
+	}
+
+	/* A random point, transferred to the explicit group via encoding. */
+	if ((point_n = EC_POINT_new(named)) == NULL)
+		errx(1, "EC_POINT_new");
+	if ((point_e = EC_POINT_new(explicit)) == NULL)
+		errx(1, "EC_POINT_new");
+	if (!BN_rand_range(scalar, order))
+		errx(1, "BN_rand_range");
+	if (!EC_POINT_mul(named, point_n, scalar, NULL, NULL, ctx))
+		errx(1, "EC_POINT_mul");
+	if ((len = EC_POINT_point2oct(named, point_n,
+	    POINT_CONVERSION_UNCOMPRESSED, buf, sizeof(buf), ctx)) == 0)
+		errx(1, "EC_POINT_point2oct");
+	if (!EC_POINT_oct2point(explicit, point_e, buf, len, ctx))
+		errx(1, "EC_POINT_oct2point");
+
+	/* Edge cases around zero, the group order and 2^256. */
+	for (i = 0; i < 3; i++) {
+		if (!BN_set_word(scalar, i))
+			errx(1, "BN_set_word");
+		if (p256_compare_scalar(named, explicit, point_n, point_e,
+		    scalar, ctx))
+			goto err;
+	}
+	for (i = -2; i <= 2; i++) {
+		if (!BN_copy(scalar, order))
+			errx(1, "BN_copy");
+		if (i < 0 && !BN_sub_word(scalar, -i))
+			errx(1, "BN_sub_word");
+		if (i > 0 && !BN_add_word(scalar, i))
+			errx(1, "BN_add_word");
+		if (p256_compare_scalar(named, explicit, point_n, point_e,
+		    scalar, ctx))
+			goto err;
+	}
+	BN_zero(scalar);
+	if (!BN_set_bit(scalar, 256) || !BN_sub_word(scalar, 1))
+		errx(1, "BN_set_bit");
+	if (p256_compare_scalar(named, explicit, point_n, point_e, scalar, ctx))
+		goto err;
+	if (!BN_set_bit(scalar, 300))
+		errx(1, "BN_set_bit");
+	if (p256_compare_scalar(named, explicit, point_n, point_e, scalar, ctx))
+		goto err;
+	BN_set_negative(scalar, 1);
+	if (p256_compare_scalar(named, explicit, point_n, point_e, scalar, ctx))
+		goto err;
+
+	for (i = 0; i < N_RANDOM_SCALARS; i++) {
+		if (!BN_rand_range(scalar, order))
+			errx(1, "BN_rand_range");
+		if (p256_compare_scalar(named, explicit, point_n, point_e,
+		    scalar, ctx))
+			goto err;
+
+		/* The k + n and k + 2n that ECDSA signing passes. */
+		if (!BN_add(scalar, scalar, order))
+			errx(1, "BN_add");
+		if (p256_compare_scalar(named, explicit, point_n, point_e,
+		    scalar, ctx))
+			goto err;
+		if (!BN_add(scalar, scalar, order))
+			errx(1, "BN_add");
+		if (p256_compare_scalar(named, explicit, point_n, point_e,
+		    scalar, ctx))
+			goto err;
+	}
+
+	failed = 0;
+
+ err:
+	EC_POINT_free(point_n);
+	EC_POINT_free(point_e);
+	EC_GROUP_free(named);
+	EC_GROUP_free(explicit);
+	BN_free(order);
+	BN_free(scalar);
+	BN_CTX_free(ctx);
+
+	return failed;
+}
+
+int
+main(int argc, char **argv)
+{
+	int failed = 0;
+
+	failed |= p256_mul_test();
+
+	return failed;
+}
@@ -0,0 +1,370 @@
+/*	$OpenBSD$ */
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <sys/time.h>
+
+#include <err.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <openssl/mlkem.h>
+#include <openssl/sha.h>
+
+#include "mlkem_internal.h"
+
+static void
+hexdump(const uint8_t *buf, size_t len)
+{
+	size_t i;
+
+	for (i = 1; i <= len; i++)
+		fprintf(stderr, " 0x%02x,%s", buf[i - 1], i % 8 ? "" : "\n");
+
+	fprintf(stderr, "\n");
+}
+
+/*
+ * Known answer values for the key pair derived from the seed 0x00..0x3f,
+ * encapsulating the message 0x80..0x9f. These were computed using an
+ * independent implementation of FIPS 203.
+ */
+static const uint8_t kat_public_key_sha256[SHA256_DIGEST_LENGTH] = {
+	0x0b, 0x79, 0x34, 0xc8, 0x31, 0x25, 0xc7, 0x88,
+	0x99, 0x5e, 0x2b, 0xa6, 0xbd, 0x76, 0x1e, 0x33,
+	0x04, 0x6b, 0x3e, 0x40, 0x57, 0x1b, 0xe5, 0x3e,
+	0x02, 0x33, 0x09, 0xa2, 0x9f, 0x39, 0x8c, 0xc9,
+};
+
+static const uint8_t kat_ciphertext_sha256[SHA256_DIGEST_LENGTH] = {
+	0x1f, 0x16, 0xe2, 0x17, 0xad, 0x23, 0x77, 0x1f,
+	0x7f, 0x72, 0x52, 0x2c, 0x60, 0x2d, 0xcf, 0x10,
+	0xcd, 0x1e, 0x2e, 0xea, 0x26, 0x48, 0xe7, 0x2d,
+	0x29, 0xc1, 0x25, 0x5a, 0x39, 0x49, 0xc3, 0x3e,
+};
+
+static const uint8_t kat_shared_secret[MLKEM_SHARED_SECRET_BYTES] = {
+	0xef, 0x91, 0xdb, 0x44, 0xb6, 0xcd, 0x5b, 0x2c,
+	0x50, 0xf4, 0x83, 0x48, 0x1a, 0x3d, 0x6e, 0x2a,
+	0x08, 0xcc, 0x14, 0x97, 0x64, 0xfc, 0xb8, 0xdc,
+	0x56, 0x88, 0x51, 0x33, 0x2d, 0xa4, 0x5e, 0xd9,
+};
+
+/* Implicit rejection secret, for the ciphertext with its first bit flipped. */
+static const uint8_t kat_rejection_secret[MLKEM_SHARED_SECRET_BYTES] = {
+	0x01, 0x6b, 0x58, 0x5c, 0x8a, 0xbc, 0x90, 0x1f,
+	0xa4, 0x53, 0x87, 0xc4, 0x96, 0xd0, 0xed, 0x74,
+	0x33, 0x2a, 0xa0, 0x65, 0x01, 0xac, 0xe2, 0xbb,
+	0x65, 0xab, 0x9f, 0x84, 0x58, 0xa3, 0x5b, 0xfc,
+};
+
+static int
+compare_data(const char *desc, const uint8_t *got, const uint8_t *want,
+    size_t len)
+{
+	if (memcmp(got, want, len) == 0)
+		return 0;
+
+	fprintf(stderr, "FAIL: %s differs\n", desc);
+	fprintf(stderr, "got:\n");
+	hexdump(got, len);
+	fprintf(stderr, "want:\n");
+	hexdump(want, len);
+
+	return 1;
+}
+
+static int
+mlkem768_kat_test(void)
+{
+	struct MLKEM768_private_key *priv;
+	struct MLKEM768_public_key *pub;
+	uint8_t encoded_public_key[MLKEM768_PUBLIC_KEY_BYTES];
+	uint8_t ciphertext[MLKEM768_CIPHERTEXT_BYTES];
+	uint8_t shared_secret[MLKEM_SHARED_SECRET_BYTES];
+	uint8_t entropy[MLKEM_ENCAP_ENTROPY_BYTES];
+	uint8_t seed[MLKEM_SEED_BYTES];
+	uint8_t md[SHA256_DIGEST_LENGTH];
+	size_t i;
+	int failed = 1;
+
+	if ((priv = calloc(1, sizeof(*priv))) == NULL)
+		err(1, NULL);
+	if ((pub = calloc(1, sizeof(*pub))) == NULL)
+		err(1, NULL);
+
+	for (i = 0; i < sizeof(seed); i++)
+		seed[i] = i;
+	for (i = 0; i < sizeof(entropy); i++)
+		entropy[i] = 0x80 + i;
+
+	MLKEM768_generate_key_external_entropy(encoded_public_key, priv, seed);
+	SHA256(encoded_public_key, sizeof(encoded_public_key), md);
+	if (compare_data("public key digest", md, kat_public_key_sha256,
+	    sizeof(md)))
+		goto failure;
+
+	MLKEM768_public_from_private(pub, priv);
+	MLKEM768_encap_external_entropy(ciphertext, shared_secret, pub,
+	    entropy);
+	SHA256(ciphertext, sizeof(ciphertext), md);
+	if (compare_data("ciphertext digest", md, kat_ciphertext_sha256,
+	    sizeof(md)))
+		goto failure;
+	if (compare_data("encapsulated secret", shared_secret,
+	    kat_shared_secret, sizeof(shared_secret)))
+		goto failure;
+
+	memset(shared_secret, 0, sizeof(shared_secret));
+	if (!MLKEM768_decap(shared_secret, ciphertext, sizeof(ciphertext),
+	    priv)) {
+		fprintf(stderr, "FAIL: MLKEM768_decap\n");
+		goto failure;
+	}
+	if (compare_data("decapsulated secret", shared_secret,
+	    kat_shared_secret, sizeof(shared_secret)))
+		goto failure;
+
+	ciphertext[0] ^= 0x01;
+	if (!MLKEM768_decap(shared_secret, ciphertext, sizeof(ciphertext),
+	    priv)) {
+		fprintf(stderr, "FAIL: MLKEM768_decap\n");
+		goto failure;
+	}
+	if (compare_data("rejection secret", shared_secret,
+	    kat_rejection_secret, sizeof(shared_secret)))
+		goto failure;
+
+	failed = 0;
+
+ failure:
+	freezero(priv, sizeof(*priv));
+	free(pub);
+
+	return failed;
+}
+
+static int
+mlkem768_round_trip_test(void)
+{
+	struct MLKEM768_private_key *priv, *priv2;
+	struct MLKEM768_public_key *pub;
+	uint8_t encoded_public_key[MLKEM768_PUBLIC_KEY_BYTES];
+	uint8_t encoded_public_key2[MLKEM768_PUBLIC_KEY_BYTES];
+	uint8_t ciphertext[MLKEM768_CIPHERTEXT_BYTES];
+	uint8_t shared_secret[MLKEM_SHARED_SECRET_BYTES];
+	uint8_t shared_secret2[MLKEM_SHARED_SECRET_BYTES];
+	uint8_t seed[MLKEM_SEED_BYTES];
+	int failed = 1;
+
+	if ((priv = calloc(1, sizeof(*priv))) == NULL)
+		err(1, NULL);
+	if ((priv2 = calloc(1, sizeof(*priv2))) == NULL)
+		err(1, NULL);
+	if ((pub = calloc(1, sizeof(*pub))) == NULL)
+		err(1, NULL);
+
+	MLKEM768_generate_key(encoded_public_key, seed, priv);
+
+	if (!MLKEM768_parse_public_key(pub, encoded_public_key,
+	    sizeof(encoded_public_key))) {
+		fprintf(stderr, "FAIL: MLKEM768_parse_public_key\n");
+		goto failure;
+	}
+	MLKEM768_marshal_public_key(encoded_public_key2, pub);
+	if (compare_data("marshalled public key", encoded_public_key2,
+	    encoded_public_key, sizeof(encoded_public_key)))
+		goto failure;
+
+	if (MLKEM768_private_key_from_seed(priv2, seed, sizeof(seed) - 1)) {
+		fprintf(stderr, "FAIL: short seed accepted\n");
+		goto failure;
+	}
+	if (!MLKEM768_private_key_from_seed(priv2, seed, sizeof(seed))) {
+		fprintf(stderr, "FAIL: MLKEM768_private_key_from_seed\n");
+		goto failure;
+	}
+
+	MLKEM768_encap(ciphertext, shared_secret, pub);
+	if (!MLKEM768_decap(shared_secret2, ciphertext, sizeof(ciphertext),
+	    priv2)) {
+		fprintf(stderr, "FAIL: MLKEM768_decap\n");
+		goto failure;
+	}
+	if (compare_data("shared secret", shared_secret2, shared_secret,
+	    sizeof(shared_secret)))
+		goto failure;
+
+	if (MLKEM768_decap(shared_secret2, ciphertext, sizeof(ciphertext) - 1,
+	    priv2)) {
+		fprintf(stderr, "FAIL: short ciphertext accepted\n");
+		goto failure;
+	}
+
+	failed = 0;
+
+ failure:
+	freezero(priv, sizeof(*priv));
+	freezero(priv2, sizeof(*priv2));
+	free(pub);
+
+	return failed;
+}
+
+static int
+mlkem768_parse_test(void)
+{
+	struct MLKEM768_private_key *priv;
+	struct MLKEM768_public_key *pub;
+	uint8_t encoded_public_key[MLKEM768_PUBLIC_KEY_BYTES + 1];
+	int failed = 1;
+
+	if ((priv = calloc(1, sizeof(*priv))) == NULL)
+		err(1, NULL);
+	if ((pub = calloc(1, sizeof(*pub))) == NULL)
+		err(1, NULL);
+
+	MLKEM768_generate_key(encoded_public_key, NULL, priv);
+	encoded_public_key[MLKEM768_PUBLIC_KEY_BYTES] = 0;
+
+	if (MLKEM768_parse_public_key(pub, encoded_public_key,
+	    MLKEM768_PUBLIC_KEY_BYTES - 1)) {
+		fprintf(stderr, "FAIL: short public key accepted\n");
+		goto failure;
+	}
+	if (MLKEM768_parse_public_key(pub, encoded_public_key,
+	    MLKEM768_PUBLIC_KEY_BYTES + 1)) {
+		fprintf(stderr, "FAIL: long public key accepted\n");
+		goto failure;
+	}
+
+	/* Set the first coefficient to q, which is not reduced. */
+	encoded_public_key[0] = 0x01;
+	encoded_public_key[1] = (encoded_public_key[1] & 0xf0) | 0x0d;
+	if (MLKEM768_parse_public_key(pub, encoded_public_key,
+	    MLKEM768_PUBLIC_KEY_BYTES)) {
+		fprintf(stderr, "FAIL: unreduced public key accepted\n");
+		goto failure;
+	}
+
+	failed = 0;
+
+ failure:
+	freezero(priv, sizeof(*priv));
+	free(pub);
+
+	return failed;
+}
+
+static volatile sig_atomic_t benchmark_stop;
+
+static void
+benchmark_sig_alarm(int sig)
+{
+	benchmark_stop = 1;
+}
+
+static void
+benchmark_run(const char *desc, int op, int seconds)
+{
+	struct MLKEM768_private_key *priv;
+	struct MLKEM768_public_key *pub;
+	uint8_t encoded_public_key[MLKEM768_PUBLIC_KEY_BYTES];
+	uint8_t ciphertext[MLKEM768_CIPHERTEXT_BYTES];
+	uint8_t shared_secret[MLKEM_SHARED_SECRET_BYTES];
+	struct timespec start, end, duration;
+	double secs;
+	long i;
+
+	if ((priv = calloc(1, sizeof(*priv))) == NULL)
+		err(1, NULL);
+	if ((pub = calloc(1, sizeof(*pub))) == NULL)
+		err(1, NULL);
+
+	MLKEM768_generate_key(encoded_public_key, NULL, priv);
+	MLKEM768_public_from_private(pub, priv);
+	MLKEM768_encap(ciphertext, shared_secret, pub);
+
+	signal(SIGALRM, benchmark_sig_alarm);
+
+	benchmark_stop = 0;
+	i = 0;
+	alarm(seconds);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	fprintf(stderr, "Benchmarking ML-KEM-768 %s for %ds: ", desc, seconds);
+	while (!benchmark_stop) {
+		switch (op) {
+		case 0:
+			MLKEM768_generate_key(encoded_public_key, NULL, priv);
+			break;
+		case 1:
+			if (!MLKEM768_parse_public_key(pub, encoded_public_key,
+			    sizeof(encoded_public_key)))
+				errx(1, "MLKEM768_parse_public_key");
+			break;
+		case 2:
+			MLKEM768_encap(ciphertext, shared_secret, pub);
+			break;
+		case 3:
+			if (!MLKEM768_decap(shared_secret, ciphertext,
+			    sizeof(ciphertext), priv))
+				errx(1, "MLKEM768_decap");
+			break;
+		}
+		i++;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	timespecsub(&end, &start, &duration);
+	secs = duration.tv_sec + duration.tv_nsec / 1000000000.0;
+	fprintf(stderr, "%ld operations in %f seconds (%.0f ops/s)\n", i,
+	    secs, i / secs);
+
+	freezero(priv, sizeof(*priv));
+	free(pub);
+}
+
+static void
+benchmark_mlkem768(void)
+{
+	benchmark_run("key generation", 0, 5);
+	benchmark_run("public key parsing", 1, 5);
+	benchmark_run("encapsulation", 2, 5);
+	benchmark_run("decapsulation", 3, 5);
+}
+
+int
+main(int argc, char **argv)
+{
+	int benchmark = 0, failed = 0;
+
+	if (argc == 2 && strcmp(argv[1], "--benchmark") == 0)
+		benchmark = 1;
+
+	failed |= mlkem768_kat_test();
+	failed |= mlkem768_round_trip_test();
+	failed |= mlkem768_parse_test();
+
+	if (benchmark && !failed)
+		benchmark_mlkem768();
+
+	return failed;
+}
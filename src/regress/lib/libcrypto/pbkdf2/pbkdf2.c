@@ -49,13 +49,20 @@
  */
 
 
+#include <sys/time.h>
+
+#include <err.h>
+#include <errno.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <errno.h>
+#include <time.h>
+#include <unistd.h>
 
 #include <openssl/opensslconf.h>
 #include <openssl/evp.h>
+#include <openssl/hmac.h>
 #ifndef OPENSSL_NO_ENGINE
 #include <openssl/engine.h>
 #endif
@@ -185,11 +192,189 @@ test_p5_pbkdf2(unsigned int n, const char *digestname, const testdata *test,
 	free(out);
 }
 
+/*
+ * Straightforward PBKDF2 built from one-shot HMAC() calls, used as the
+ * reference for the optimized implementation.
+ */
+static int
+pbkdf2_reference(const char *pass, int passlen, const unsigned char *salt,
+    int saltlen, int iter, const EVP_MD *digest, int keylen, unsigned char *out)
+{
+	unsigned char block[256], u[EVP_MAX_MD_SIZE];
+	unsigned int i, mdlen;
+	int cplen, j, k;
+
+	for (i = 1; keylen > 0; i++) {
+		if (saltlen + 4 > (int)sizeof(block))
+			return 0;
+		memcpy(block, salt, saltlen);
+		block[saltlen] = (i >> 24) & 0xff;
+		block[saltlen + 1] = (i >> 16) & 0xff;
+		block[saltlen + 2] = (i >> 8) & 0xff;
+		block[saltlen + 3] = i & 0xff;
+
+		if (HMAC(digest, pass, passlen, block, saltlen + 4, u,
+		    &mdlen) == NULL)
+			return 0;
+		cplen = keylen < (int)mdlen ? keylen : (int)mdlen;
+		memcpy(out, u, cplen);
+		for (j = 1; j < iter; j++) {
+			if (HMAC(digest, pass, passlen, u, mdlen, u,
+			    &mdlen) == NULL)
+				return 0;
+			for (k = 0; k < cplen; k++)
+				out[k] ^= u[k];
+		}
+		keylen -= cplen;
+		out += cplen;
+	}
+
+	return 1;
+}
+
+static const char *reference_digests[] = {
+	"md5",
+	"sha1",
+	"sha224",
+	"sha256",
+	"sha384",
+	"sha512",
+};
+
+#define N_REFERENCE_DIGESTS \
+    (sizeof(reference_digests) / sizeof(reference_digests[0]))
+
+static const int reference_passlens[] = { 0, 1, 63, 64, 65, 127, 128, 129, 200 };
+static const int reference_keylens[] = { 1, 20, 33, 64, 100, 200 };
+
+#define N_REFERENCE_PASSLENS \
+    (sizeof(reference_passlens) / sizeof(reference_passlens[0]))
+#define N_REFERENCE_KEYLENS \
+    (sizeof(reference_keylens) / sizeof(reference_keylens[0]))
+
+static int
+test_p5_pbkdf2_reference(void)
+{
+	unsigned char got[200], want[200];
+	char pass[200];
+	unsigned char salt[16];
+	const EVP_MD *digest;
+	size_t i, j, k;
+	int iter;
+	int failed = 1;
+
+	for (i = 0; i < sizeof(pass); i++)
+		pass[i] = 'a' + i % 26;
+	for (i = 0; i < sizeof(salt); i++)
+		salt[i] = i;
+
+	for (i = 0; i < N_REFERENCE_DIGESTS; i++) {
+		if ((digest = EVP_get_digestbyname(reference_digests[i])) == NULL)
+			errx(1, "unknown digest %s", reference_digests[i]);
+		for (j = 0; j < N_REFERENCE_PASSLENS; j++) {
+			for (k = 0; k < N_REFERENCE_KEYLENS; k++) {
+				for (iter = 1; iter <= 3; iter++) {
+					if (!pbkdf2_reference(pass,
+					    reference_passlens[j], salt,
+					    sizeof(salt), iter, digest,
+					    reference_keylens[k], want))
+						errx(1, "pbkdf2_reference");
+					if (!PKCS5_PBKDF2_HMAC(pass,
+					    reference_passlens[j], salt,
+					    sizeof(salt), iter, digest,
+					    reference_keylens[k], got)) {
+						fprintf(stderr, "FAIL: "
+						    "PKCS5_PBKDF2_HMAC(%s)\n",
+						    reference_digests[i]);
+						goto failed;
+					}
+					if (memcmp(got, want,
+					    reference_keylens[k]) != 0) {
+						fprintf(stderr, "FAIL: %s "
+						    "passlen %d keylen %d "
+						    "iter %d differs\n",
+						    reference_digests[i],
+						    reference_passlens[j],
+						    reference_keylens[k], iter);
+						goto failed;
+					}
+				}
+			}
+		}
+	}
+
+	failed = 0;
+
+ failed:
+	return failed;
+}
+
+static volatile sig_atomic_t benchmark_stop;
+
+static void
+benchmark_sig_alarm(int sig)
+{
+	benchmark_stop = 1;
+}
+
+static void
+benchmark_run(const char *digestname, int iter, int keylen, int seconds)
+{
+	struct timespec start, end, duration;
+	unsigned char out[128];
+	const EVP_MD *digest;
+	double secs;
+	int i;
+
+	if ((digest = EVP_get_digestbyname(digestname)) == NULL)
+		errx(1, "unknown digest %s", digestname);
+	if (keylen > (int)sizeof(out))
+		errx(1, "key length too large");
+
+	signal(SIGALRM, benchmark_sig_alarm);
+
+	benchmark_stop = 0;
+	i = 0;
+	alarm(seconds);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	fprintf(stderr, "Benchmarking PBKDF2-HMAC-%s (%d iterations, "
+	    "%d byte key) for %ds: ", digestname, iter, keylen, seconds);
+	while (!benchmark_stop) {
+		if (!PKCS5_PBKDF2_HMAC("password", 8,
+		    (const unsigned char *)"salt", 4, iter, digest, keylen,
+		    out))
+			errx(1, "PKCS5_PBKDF2_HMAC");
+		i++;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	timespecsub(&end, &start, &duration);
+	secs = duration.tv_sec + duration.tv_nsec / 1000000000.0;
+	fprintf(stderr, "%d derivations in %f seconds (%.0f HMAC/s)\n", i,
+	    secs, (double)i * iter * ((keylen + EVP_MD_size(digest) - 1) /
+	    EVP_MD_size(digest)) / secs);
+}
+
+static void
+benchmark_pbkdf2(void)
+{
+	benchmark_run("sha1", 10000, 20, 5);
+	benchmark_run("sha1", 10000, 32, 5);
+	benchmark_run("sha256", 10000, 32, 5);
+	benchmark_run("sha256", 10000, 64, 5);
+	benchmark_run("sha512", 10000, 64, 5);
+}
+
 int
 main(int argc,char **argv)
 {
 	unsigned int n;
 	const testdata *test = test_cases;
+	int benchmark = 0;
+
+	if (argc == 2 && strcmp(argv[1], "--benchmark") == 0)
+		benchmark = 1;
 
 	OpenSSL_add_all_digests();
 #ifndef OPENSSL_NO_ENGINE
@@ -203,6 +388,12 @@ main(int argc,char **argv)
 		test_p5_pbkdf2(n, "sha512", test, sha512_results[n]);
 	}
 
+	if (test_p5_pbkdf2_reference())
+		exit(2);
+
+	if (benchmark)
+		benchmark_pbkdf2();
+
 #ifndef OPENSSL_NO_ENGINE
 	ENGINE_cleanup();
 #endif
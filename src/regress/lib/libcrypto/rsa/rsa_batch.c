@@ -0,0 +1,339 @@
+/*	$OpenBSD$ */
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <sys/time.h>
+
+#include <err.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <openssl/bn.h>
+#include <openssl/err.h>
+#include <openssl/rsa.h>
+
+#define MAX_BATCH	16
+
+enum {
+	KEY_2048_A,
+	KEY_2048_B,
+	KEY_2048_C,
+	KEY_1024,
+	KEY_2048_NO_CRT,
+	N_KEYS,
+};
+
+static RSA *keys[N_KEYS];
+
+static RSA *
+generate_key(int bits)
+{
+	BIGNUM *e;
+	RSA *rsa;
+
+	if ((e = BN_new()) == NULL)
+		errx(1, "BN_new");
+	if (!BN_set_word(e, RSA_F4))
+		errx(1, "BN_set_word");
+	if ((rsa = RSA_new()) == NULL)
+		errx(1, "RSA_new");
+	if (!RSA_generate_key_ex(rsa, bits, e, NULL))
+		errx(1, "RSA_generate_key_ex");
+	BN_free(e);
+
+	return rsa;
+}
+
+/*
+ * A key that only has the private exponent, so that private key operations
+ * cannot use the CRT.
+ */
+static RSA *
+strip_crt(const RSA *crt_key)
+{
+	const BIGNUM *n, *e, *d;
+	BIGNUM *n2, *e2, *d2;
+	RSA *rsa;
+
+	RSA_get0_key(crt_key, &n, &e, &d);
+
+	if ((rsa = RSA_new()) == NULL)
+		errx(1, "RSA_new");
+	if ((n2 = BN_dup(n)) == NULL || (e2 = BN_dup(e)) == NULL ||
+	    (d2 = BN_dup(d)) == NULL)
+		errx(1, "BN_dup");
+	if (!RSA_set0_key(rsa, n2, e2, d2))
+		errx(1, "RSA_set0_key");
+
+	return rsa;
+}
+
+static void
+setup_keys(void)
+{
+	keys[KEY_2048_A] = generate_key(2048);
+	keys[KEY_2048_B] = generate_key(2048);
+	keys[KEY_2048_C] = generate_key(2048);
+	keys[KEY_1024] = generate_key(1024);
+	keys[KEY_2048_NO_CRT] = strip_crt(keys[KEY_2048_A]);
+}
+
+static void
+cleanup_keys(void)
+{
+	size_t i;
+
+	for (i = 0; i < N_KEYS; i++)
+		RSA_free(keys[i]);
+}
+
+struct batch {
+	size_t num;
+	int flen[MAX_BATCH];
+	unsigned char in[MAX_BATCH][512];
+	const unsigned char *from[MAX_BATCH];
+	unsigned char out[MAX_BATCH][512];
+	unsigned char *to[MAX_BATCH];
+	RSA *rsa[MAX_BATCH];
+	int out_len[MAX_BATCH];
+};
+
+static void
+batch_init(struct batch *b, size_t num, const int *key_ids, int padding)
+{
+	size_t i;
+
+	memset(b, 0, sizeof(*b));
+	b->num = num;
+
+	for (i = 0; i < num; i++) {
+		b->rsa[i] = keys[key_ids[i % N_KEYS]];
+		b->flen[i] = 32;
+		if (padding == RSA_NO_PADDING)
+			b->flen[i] = RSA_size(b->rsa[i]);
+		arc4random_buf(b->in[i], b->flen[i]);
+		/* Keep the input less than the modulus. */
+		b->in[i][0] = 0;
+		b->from[i] = b->in[i];
+		b->to[i] = b->out[i];
+	}
+}
+
+static int
+batch_check(const struct batch *b, int padding, const char *desc)
+{
+	unsigned char want[512];
+	size_t i;
+	int want_len;
+	int failed = 0;
+
+	for (i = 0; i < b->num; i++) {
+		want_len = RSA_private_encrypt(b->flen[i], b->from[i], want,
+		    b->rsa[i], padding);
+		if (want_len <= 0)
+			errx(1, "RSA_private_encrypt");
+		if (b->out_len[i] != want_len) {
+			fprintf(stderr, "FAIL: %s: operation %zu returned %d, "
+			    "want %d\n", desc, i, b->out_len[i], want_len);
+			failed = 1;
+			continue;
+		}
+		if (memcmp(b->out[i], want, want_len) != 0) {
+			fprintf(stderr, "FAIL: %s: operation %zu produced the "
+			    "wrong output\n", desc, i);
+			failed = 1;
+		}
+	}
+
+	return failed;
+}
+
+static int
+test_rsa_batch_padding(int padding, const char *desc)
+{
+	static const int key_ids[][N_KEYS] = {
+		{
+			KEY_2048_A, KEY_2048_A, KEY_2048_A, KEY_2048_A,
+			KEY_2048_A,
+		},
+		{
+			KEY_2048_A, KEY_2048_B, KEY_2048_C, KEY_2048_A,
+			KEY_2048_B,
+		},
+		{
+			KEY_2048_A, KEY_1024, KEY_2048_B, KEY_2048_NO_CRT,
+			KEY_2048_C,
+		},
+	};
+	struct batch b;
+	size_t i, num;
+	int failed = 0;
+
+	for (i = 0; i < sizeof(key_ids) / sizeof(key_ids[0]); i++) {
+		for (num = 1; num <= MAX_BATCH; num++) {
+			batch_init(&b, num, key_ids[i], padding);
+			if (!RSA_private_encrypt_batch(b.num, b.flen, b.from,
+			    b.to, b.rsa, padding, b.out_len)) {
+				fprintf(stderr, "FAIL: %s: batch of %zu "
+				    "failed\n", desc, num);
+				ERR_print_errors_fp(stderr);
+				failed = 1;
+				continue;
+			}
+			failed |= batch_check(&b, padding, desc);
+		}
+	}
+
+	return failed;
+}
+
+static int
+test_rsa_batch(void)
+{
+	int failed = 0;
+
+	failed |= test_rsa_batch_padding(RSA_PKCS1_PADDING, "PKCS#1");
+	failed |= test_rsa_batch_padding(RSA_X931_PADDING, "X9.31");
+	failed |= test_rsa_batch_padding(RSA_NO_PADDING, "no padding");
+
+	return failed;
+}
+
+static int
+test_rsa_batch_failure(void)
+{
+	static const int key_ids[N_KEYS] = {
+		KEY_2048_A, KEY_2048_B, KEY_2048_C, KEY_2048_A, KEY_2048_B,
+	};
+	struct batch b;
+	int failed = 0;
+
+	/* An input that is too long to pad fails only its own operation. */
+	batch_init(&b, 8, key_ids, RSA_PKCS1_PADDING);
+	b.flen[5] = RSA_size(b.rsa[5]);
+
+	if (RSA_private_encrypt_batch(b.num, b.flen, b.from, b.to, b.rsa,
+	    RSA_PKCS1_PADDING, b.out_len)) {
+		fprintf(stderr, "FAIL: batch with an oversized input "
+		    "succeeded\n");
+		failed = 1;
+	}
+	ERR_clear_error();
+
+	if (b.out_len[5] != -1) {
+		fprintf(stderr, "FAIL: oversized input returned %d\n",
+		    b.out_len[5]);
+		failed = 1;
+	}
+
+	/* The remaining operations must have succeeded. */
+	b.flen[5] = 32;
+	b.out_len[5] = RSA_private_encrypt(b.flen[5], b.from[5], b.to[5],
+	    b.rsa[5], RSA_PKCS1_PADDING);
+	failed |= batch_check(&b, RSA_PKCS1_PADDING, "failure");
+
+	return failed;
+}
+
+static volatile sig_atomic_t benchmark_stop;
+
+static void
+benchmark_sig_alarm(int sig)
+{
+	benchmark_stop = 1;
+}
+
+static void
+benchmark_run(size_t num, int batched, int seconds)
+{
+	static const int key_ids[N_KEYS] = {
+		KEY_2048_A, KEY_2048_B, KEY_2048_C, KEY_2048_A, KEY_2048_B,
+	};
+	struct timespec start, end, duration;
+	struct batch b;
+	double secs;
+	size_t i;
+	long ops = 0;
+
+	batch_init(&b, num, key_ids, RSA_PKCS1_PADDING);
+
+	signal(SIGALRM, benchmark_sig_alarm);
+	benchmark_stop = 0;
+	alarm(seconds);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	while (!benchmark_stop) {
+		if (batched) {
+			if (!RSA_private_encrypt_batch(b.num, b.flen, b.from,
+			    b.to, b.rsa, RSA_PKCS1_PADDING, b.out_len))
+				errx(1, "RSA_private_encrypt_batch");
+		} else {
+			for (i = 0; i < num; i++) {
+				if (RSA_private_encrypt(b.flen[i], b.from[i],
+				    b.to[i], b.rsa[i], RSA_PKCS1_PADDING) <= 0)
+					errx(1, "RSA_private_encrypt");
+			}
+		}
+		ops += num;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	timespecsub(&end, &start, &duration);
+	secs = duration.tv_sec + duration.tv_nsec / 1000000000.0;
+
+	fprintf(stderr, "RSA 2048 sign, %s, N=%2zu: %ld operations in %f "
+	    "seconds, %.1f operations per second\n",
+	    batched ? "batched   " : "individual", num, ops, secs, ops / secs);
+}
+
+static void
+benchmark_rsa_batch(void)
+{
+	static const size_t sizes[] = { 1, 4, 8, 16 };
+	size_t i;
+
+	for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		benchmark_run(sizes[i], 0, 5);
+		benchmark_run(sizes[i], 1, 5);
+	}
+}
+
+int
+main(int argc, char **argv)
+{
+	int benchmark = 0;
+	int failed = 0;
+
+	if (argc == 2 && strcmp(argv[1], "--benchmark") == 0)
+		benchmark = 1;
+
+	setup_keys();
+
+	failed |= test_rsa_batch();
+	failed |= test_rsa_batch_failure();
+
+	if (benchmark && !failed)
+		benchmark_rsa_batch();
+
+	cleanup_keys();
+
+	return failed;
+}
@@ -15,8 +15,15 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <sys/time.h>
+
 #include <err.h>
+#include <signal.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
 
 #include <openssl/bio.h>
 #include <openssl/err.h>
@@ -450,13 +457,201 @@ do_ssl_asn1_test(int test_no, struct ssl_asn1_test *sat)
 	return (rv);
 }
 
+static int
+do_ssl_ticket_test(int test_no, struct ssl_asn1_test *sat,
+    int include_peer_cert)
+{
+	SSL_SESSION want, *sp = NULL;
+	unsigned char *data = NULL;
+	size_t data_len = 0, i;
+	int rv = 1;
+
+	if (sat->peer_cert)
+		sat->session.peer_cert = peer_cert;
+
+	if (!SSL_SESSION_ticket(&sat->session, include_peer_cert, &data,
+	    &data_len)) {
+		/* See if the test is expected to fail... */
+		if (sat->asn1_len == -1)
+			return (0);
+		fprintf(stderr, "FAIL: test %d - ticket encoding failed\n",
+		    test_no);
+		goto failed;
+	}
+	if (sat->asn1_len == -1) {
+		fprintf(stderr, "FAIL: test %d - ticket encoding succeeded\n",
+		    test_no);
+		goto failed;
+	}
+	if (data_len == 0 || data[0] != SSL_SESSION_TICKET_VERSION) {
+		fprintf(stderr, "FAIL: test %d - ticket encoding has wrong "
+		    "version\n", test_no);
+		goto failed;
+	}
+
+	/* Every truncation of the encoding must be rejected. */
+	for (i = 0; i < data_len; i++) {
+		if ((sp = SSL_SESSION_from_ticket(data, i)) != NULL) {
+			fprintf(stderr, "FAIL: test %d - truncated ticket "
+			    "decoded (%zu/%zu)\n", test_no, i, data_len);
+			goto failed;
+		}
+	}
+	ERR_clear_error();
+
+	if ((sp = SSL_SESSION_from_ticket(data, data_len)) == NULL) {
+		fprintf(stderr, "FAIL: test %d - ticket decoding failed\n",
+		    test_no);
+		goto failed;
+	}
+
+	/* Tickets carry neither a session ID nor a ticket. */
+	want = sat->session;
+	want.session_id_length = 0;
+	want.tlsext_tick = NULL;
+	want.tlsext_ticklen = 0;
+	if (!include_peer_cert)
+		want.peer_cert = NULL;
+
+	if (session_cmp(sp, &want) != 0) {
+		fprintf(stderr, "FAIL: test %d - ticket decoding differs\n",
+		    test_no);
+		goto failed;
+	}
+	SSL_SESSION_free(sp);
+	sp = NULL;
+
+	/* Tickets using the ASN.1 encoding must still be accepted. */
+	if ((sp = SSL_SESSION_from_ticket(sat->asn1, sat->asn1_len)) == NULL) {
+		fprintf(stderr, "FAIL: test %d - ASN.1 ticket decoding "
+		    "failed\n", test_no);
+		goto failed;
+	}
+	if (session_cmp(sp, &sat->session) != 0) {
+		fprintf(stderr, "FAIL: test %d - ASN.1 ticket decoding "
+		    "differs\n", test_no);
+		goto failed;
+	}
+
+	rv = 0;
+
+ failed:
+	ERR_print_errors_fp(stderr);
+	SSL_SESSION_free(sp);
+	free(data);
+
+	return (rv);
+}
+
+static volatile sig_atomic_t benchmark_stop;
+
+static void
+benchmark_sig_alarm(int sig)
+{
+	benchmark_stop = 1;
+}
+
+enum benchmark_op {
+	BENCHMARK_ASN1_ENCODE,
+	BENCHMARK_ASN1_DECODE,
+	BENCHMARK_TICKET_ENCODE,
+	BENCHMARK_TICKET_DECODE,
+};
+
+static void
+benchmark_run(const char *desc, enum benchmark_op op, SSL_SESSION *session,
+    int include_peer_cert, int seconds)
+{
+	struct timespec start, end, duration;
+	unsigned char *data = NULL, *asn1 = NULL, *ap;
+	const unsigned char *pp;
+	size_t data_len = 0;
+	SSL_SESSION *sp;
+	int asn1_len;
+	double secs;
+	long ops = 0;
+
+	if ((asn1_len = i2d_SSL_SESSION(session, &asn1)) <= 0)
+		errx(1, "i2d_SSL_SESSION");
+	if (!SSL_SESSION_ticket(session, include_peer_cert, &data, &data_len))
+		errx(1, "SSL_SESSION_ticket");
+
+	signal(SIGALRM, benchmark_sig_alarm);
+	benchmark_stop = 0;
+	alarm(seconds);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	while (!benchmark_stop) {
+		switch (op) {
+		case BENCHMARK_ASN1_ENCODE:
+			ap = NULL;
+			if (i2d_SSL_SESSION(session, &ap) <= 0)
+				errx(1, "i2d_SSL_SESSION");
+			free(ap);
+			break;
+		case BENCHMARK_ASN1_DECODE:
+			pp = asn1;
+			if ((sp = d2i_SSL_SESSION(NULL, &pp, asn1_len)) == NULL)
+				errx(1, "d2i_SSL_SESSION");
+			SSL_SESSION_free(sp);
+			break;
+		case BENCHMARK_TICKET_ENCODE:
+			ap = NULL;
+			if (!SSL_SESSION_ticket(session, include_peer_cert,
+			    &ap, &data_len))
+				errx(1, "SSL_SESSION_ticket");
+			free(ap);
+			break;
+		case BENCHMARK_TICKET_DECODE:
+			if ((sp = SSL_SESSION_from_ticket(data,
+			    data_len)) == NULL)
+				errx(1, "SSL_SESSION_from_ticket");
+			SSL_SESSION_free(sp);
+			break;
+		}
+		ops++;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	timespecsub(&end, &start, &duration);
+	secs = duration.tv_sec + duration.tv_nsec / 1000000000.0;
+
+	fprintf(stderr, "%-32s: %ld operations in %f seconds, "
+	    "%.1f operations per second\n", desc, ops, secs, ops / secs);
+
+	free(asn1);
+	free(data);
+}
+
+static void
+benchmark_ssl_asn1(void)
+{
+	SSL_SESSION *session = &ssl_asn1_tests[2].session;
+
+	session->peer_cert = peer_cert;
+
+	benchmark_run("ASN.1 encode", BENCHMARK_ASN1_ENCODE, session, 1, 5);
+	benchmark_run("ASN.1 decode", BENCHMARK_ASN1_DECODE, session, 1, 5);
+	benchmark_run("ticket encode", BENCHMARK_TICKET_ENCODE, session, 1, 5);
+	benchmark_run("ticket decode", BENCHMARK_TICKET_DECODE, session, 1, 5);
+	benchmark_run("ticket encode (no peer cert)", BENCHMARK_TICKET_ENCODE,
+	    session, 0, 5);
+	benchmark_run("ticket decode (no peer cert)", BENCHMARK_TICKET_DECODE,
+	    session, 0, 5);
+}
+
 int
 main(int argc, char **argv)
 {
 	BIO *bio = NULL;
+	int benchmark = 0;
 	int failed = 0;
 	size_t i;
 
+	if (argc == 2 && strcmp(argv[1], "--benchmark") == 0)
+		benchmark = 1;
+
 	SSL_library_init();
 	SSL_load_error_strings();
 
@@ -470,6 +665,13 @@ main(int argc, char **argv)
 
 	for (i = 0; i < N_SSL_ASN1_TESTS; i++)
 		failed += do_ssl_asn1_test(i, &ssl_asn1_tests[i]);
+	for (i = 0; i < N_SSL_ASN1_TESTS; i++) {
+		failed += do_ssl_ticket_test(i, &ssl_asn1_tests[i], 1);
+		failed += do_ssl_ticket_test(i, &ssl_asn1_tests[i], 0);
+	}
+
+	if (benchmark && !failed)
+		benchmark_ssl_asn1();
 
 	X509_free(peer_cert);
 	BIO_free(bio);
@@ -0,0 +1,466 @@
+/*	$OpenBSD$ */
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * In-process handshake and record layer benchmarks - a client and server
+ * are connected via a BIO pair, so that the results are not influenced by
+ * the network stack.
+ */
+
+#include <sys/time.h>
+
+#include <err.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+
+#define BENCH_BIO_BUF_SIZE	(64 * 1024)
+#define BENCH_MAX_RECORD_SIZE	16384
+
+static const char *certs_dir;
+static int machine_output;
+static long iterations;
+static int seconds = 1;
+
+struct bench_key {
+	const char *name;
+	const char *cert_file;
+	const char *key_file;
+};
+
+static const struct bench_key bench_keys[] = {
+	{
+		.name = "ecdsa",
+		.cert_file = "server1-ecdsa-chain.pem",
+		.key_file = "server1-ecdsa.pem",
+	},
+	{
+		.name = "rsa",
+		.cert_file = "server1-rsa-chain.pem",
+		.key_file = "server1-rsa.pem",
+	},
+};
+
+#define N_BENCH_KEYS (sizeof(bench_keys) / sizeof(bench_keys[0]))
+
+struct bench_cipher {
+	uint16_t version;
+	const char *ciphers;
+};
+
+static const struct bench_cipher bench_ciphers[] = {
+	{
+		.version = TLS1_3_VERSION,
+		.ciphers = "TLS_AES_128_GCM_SHA256",
+	},
+	{
+		.version = TLS1_3_VERSION,
+		.ciphers = "TLS_AES_256_GCM_SHA384",
+	},
+	{
+		.version = TLS1_3_VERSION,
+		.ciphers = "TLS_CHACHA20_POLY1305_SHA256",
+	},
+	{
+		.version = TLS1_2_VERSION,
+		.ciphers = "ECDHE-ECDSA-AES128-GCM-SHA256:"
+		    "ECDHE-RSA-AES128-GCM-SHA256",
+	},
+	{
+		.version = TLS1_2_VERSION,
+		.ciphers = "ECDHE-ECDSA-AES256-GCM-SHA384:"
+		    "ECDHE-RSA-AES256-GCM-SHA384",
+	},
+	{
+		.version = TLS1_2_VERSION,
+		.ciphers = "ECDHE-ECDSA-CHACHA20-POLY1305:"
+		    "ECDHE-RSA-CHACHA20-POLY1305",
+	},
+};
+
+#define N_BENCH_CIPHERS (sizeof(bench_ciphers) / sizeof(bench_ciphers[0]))
+
+static const size_t bench_record_sizes[] = {
+	256, 1024, 4096, BENCH_MAX_RECORD_SIZE,
+};
+
+#define N_BENCH_RECORD_SIZES \
+    (sizeof(bench_record_sizes) / sizeof(bench_record_sizes[0]))
+
+static volatile sig_atomic_t benchmark_stop;
+
+static void
+benchmark_sig_alarm(int sig)
+{
+	benchmark_stop = 1;
+}
+
+static void
+bench_start(struct timespec *start)
+{
+	benchmark_stop = 0;
+	if (iterations == 0) {
+		signal(SIGALRM, benchmark_sig_alarm);
+		alarm(seconds);
+	}
+	clock_gettime(CLOCK_MONOTONIC, start);
+}
+
+static int
+bench_running(long count)
+{
+	if (iterations > 0)
+		return count < iterations;
+
+	return !benchmark_stop;
+}
+
+static double
+bench_stop(const struct timespec *start)
+{
+	struct timespec end, duration;
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	alarm(0);
+
+	timespecsub(&end, start, &duration);
+
+	return duration.tv_sec + duration.tv_nsec / 1000000000.0;
+}
+
+static const char *
+version_name(uint16_t version)
+{
+	switch (version) {
+	case TLS1_2_VERSION:
+		return "TLSv1.2";
+	case TLS1_3_VERSION:
+		return "TLSv1.3";
+	}
+	return "unknown";
+}
+
+static void
+bench_report(const char *test, uint16_t version, const char *key,
+    const char *cipher, size_t record_size, long count, double secs,
+    double value, const char *unit)
+{
+	char record_size_str[32] = "-";
+
+	if (record_size > 0)
+		snprintf(record_size_str, sizeof(record_size_str), "%zu",
+		    record_size);
+
+	if (machine_output) {
+		printf("%s\t%s\t%s\t%s\t%s\t%ld\t%f\t%.2f\t%s\n", test,
+		    version_name(version), key, cipher, record_size_str,
+		    count, secs, value, unit);
+		return;
+	}
+
+	printf("%-18s %-8s %-6s %-30s %6s: %10.2f %s\n", test,
+	    version_name(version), key, cipher, record_size_str, value, unit);
+}
+
+static SSL_CTX *
+server_ctx_new(const struct bench_key *key)
+{
+	char file[PATH_MAX];
+	SSL_CTX *ssl_ctx;
+
+	if ((ssl_ctx = SSL_CTX_new(TLS_server_method())) == NULL)
+		errx(1, "server context");
+
+	if (snprintf(file, sizeof(file), "%s/%s", certs_dir,
+	    key->cert_file) >= (int)sizeof(file))
+		errx(1, "certificate path too long");
+	if (SSL_CTX_use_certificate_chain_file(ssl_ctx, file) != 1)
+		errx(1, "failed to load server certificate %s", file);
+	if (snprintf(file, sizeof(file), "%s/%s", certs_dir,
+	    key->key_file) >= (int)sizeof(file))
+		errx(1, "key path too long");
+	if (SSL_CTX_use_PrivateKey_file(ssl_ctx, file, SSL_FILETYPE_PEM) != 1)
+		errx(1, "failed to load server key %s", file);
+
+	return ssl_ctx;
+}
+
+static SSL_CTX *
+client_ctx_new(const struct bench_cipher *bc)
+{
+	SSL_CTX *ssl_ctx;
+
+	if ((ssl_ctx = SSL_CTX_new(TLS_client_method())) == NULL)
+		errx(1, "client context");
+	if (!SSL_CTX_set_min_proto_version(ssl_ctx, bc->version))
+		errx(1, "SSL_CTX_set_min_proto_version");
+	if (!SSL_CTX_set_max_proto_version(ssl_ctx, bc->version))
+		errx(1, "SSL_CTX_set_max_proto_version");
+
+	if (bc->version == TLS1_3_VERSION) {
+		if (!SSL_CTX_set_ciphersuites(ssl_ctx, bc->ciphers))
+			errx(1, "SSL_CTX_set_ciphersuites");
+	} else {
+		if (!SSL_CTX_set_cipher_list(ssl_ctx, bc->ciphers))
+			errx(1, "SSL_CTX_set_cipher_list");
+	}
+
+	return ssl_ctx;
+}
+
+static void
+ssl_pair_new(SSL_CTX *server_ctx, SSL_CTX *client_ctx, SSL **server,
+    SSL **client)
+{
+	BIO *client_bio, *server_bio;
+
+	if (!BIO_new_bio_pair(&client_bio, BENCH_BIO_BUF_SIZE, &server_bio,
+	    BENCH_BIO_BUF_SIZE))
+		errx(1, "BIO pair");
+
+	if ((*client = SSL_new(client_ctx)) == NULL)
+		errx(1, "client SSL");
+	if ((*server = SSL_new(server_ctx)) == NULL)
+		errx(1, "server SSL");
+
+	SSL_set_bio(*client, client_bio, client_bio);
+	SSL_set_bio(*server, server_bio, server_bio);
+
+	SSL_set_connect_state(*client);
+	SSL_set_accept_state(*server);
+}
+
+static void
+ssl_error(SSL *ssl, int ret, const char *desc)
+{
+	switch (SSL_get_error(ssl, ret)) {
+	case SSL_ERROR_WANT_READ:
+	case SSL_ERROR_WANT_WRITE:
+		return;
+	}
+
+	ERR_print_errors_fp(stderr);
+	errx(1, "%s failed", desc);
+}
+
+static void
+do_handshake(SSL *client, SSL *server)
+{
+	int client_ret, server_ret;
+	int i;
+
+	client_ret = server_ret = 0;
+	for (i = 0; i < 100; i++) {
+		if (client_ret != 1) {
+			if ((client_ret = SSL_do_handshake(client)) != 1)
+				ssl_error(client, client_ret,
+				    "client handshake");
+		}
+		if (server_ret != 1) {
+			if ((server_ret = SSL_do_handshake(server)) != 1)
+				ssl_error(server, server_ret,
+				    "server handshake");
+		}
+		if (client_ret == 1 && server_ret == 1)
+			return;
+	}
+
+	errx(1, "handshake did not complete");
+}
+
+/*
+ * Measure complete handshakes, optionally resuming a session that was
+ * established via an initial full handshake.
+ */
+static void
+bench_handshake(const struct bench_key *key, const struct bench_cipher *bc,
+    int resume)
+{
+	SSL_CTX *server_ctx, *client_ctx;
+	SSL *client, *server;
+	SSL_SESSION *session = NULL;
+	struct timespec start;
+	char cipher[64];
+	long count = 0;
+	double secs;
+
+	server_ctx = server_ctx_new(key);
+	client_ctx = client_ctx_new(bc);
+
+	ssl_pair_new(server_ctx, client_ctx, &server, &client);
+	do_handshake(client, server);
+	strlcpy(cipher, SSL_get_cipher_name(client), sizeof(cipher));
+	if (resume && (session = SSL_get1_session(client)) == NULL)
+		errx(1, "no session");
+	SSL_free(client);
+	SSL_free(server);
+
+	bench_start(&start);
+
+	while (bench_running(count)) {
+		ssl_pair_new(server_ctx, client_ctx, &server, &client);
+		if (session != NULL && !SSL_set_session(client, session))
+			errx(1, "SSL_set_session");
+		do_handshake(client, server);
+		if (SSL_session_reused(client) != resume)
+			errx(1, "%s: session %sresumed", cipher,
+			    resume ? "not " : "");
+		SSL_free(client);
+		SSL_free(server);
+		count++;
+	}
+
+	secs = bench_stop(&start);
+
+	bench_report(resume ? "resumed-handshake" : "full-handshake",
+	    bc->version, key->name, cipher, 0, count, secs, count / secs,
+	    "handshakes/s");
+
+	SSL_SESSION_free(session);
+	SSL_CTX_free(client_ctx);
+	SSL_CTX_free(server_ctx);
+}
+
+/*
+ * Measure application data throughput from client to server, with each
+ * SSL_write() producing a single record of the given size.
+ */
+static void
+bench_bulk(const struct bench_key *key, const struct bench_cipher *bc,
+    size_t record_size)
+{
+	SSL_CTX *server_ctx, *client_ctx;
+	SSL *client, *server;
+	struct timespec start;
+	uint8_t *buf;
+	char cipher[64];
+	long count = 0;
+	double secs;
+	int ret;
+
+	if ((buf = calloc(1, BENCH_MAX_RECORD_SIZE)) == NULL)
+		err(1, NULL);
+
+	server_ctx = server_ctx_new(key);
+	client_ctx = client_ctx_new(bc);
+
+	ssl_pair_new(server_ctx, client_ctx, &server, &client);
+	do_handshake(client, server);
+	strlcpy(cipher, SSL_get_cipher_name(client), sizeof(cipher));
+
+	bench_start(&start);
+
+	while (bench_running(count)) {
+		if ((ret = SSL_write(client, buf, record_size)) <= 0) {
+			ssl_error(client, ret, "SSL_write");
+			errx(1, "SSL_write would block");
+		}
+		if ((size_t)ret != record_size)
+			errx(1, "short write");
+		while ((ret = SSL_read(server, buf, BENCH_MAX_RECORD_SIZE)) > 0)
+			;
+		ssl_error(server, ret, "SSL_read");
+		count++;
+	}
+
+	secs = bench_stop(&start);
+
+	bench_report("bulk", bc->version, "-", cipher, record_size, count,
+	    secs, count * record_size / secs / 1000000.0, "MB/s");
+
+	SSL_free(client);
+	SSL_free(server);
+	SSL_CTX_free(client_ctx);
+	SSL_CTX_free(server_ctx);
+	free(buf);
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: sslbench [-m] [-n iterations] [-t seconds] "
+	    "certsdir\n");
+	exit(1);
+}
+
+int
+main(int argc, char **argv)
+{
+	const struct bench_cipher *bc;
+	const char *errstr;
+	size_t i, j;
+	int ch;
+
+	while ((ch = getopt(argc, argv, "mn:t:")) != -1) {
+		switch (ch) {
+		case 'm':
+			machine_output = 1;
+			break;
+		case 'n':
+			iterations = strtonum(optarg, 1, LONG_MAX, &errstr);
+			if (errstr != NULL)
+				errx(1, "iterations is %s: %s", errstr, optarg);
+			break;
+		case 't':
+			seconds = strtonum(optarg, 1, INT_MAX, &errstr);
+			if (errstr != NULL)
+				errx(1, "seconds is %s: %s", errstr, optarg);
+			break;
+		default:
+			usage();
+		}
+	}
+	argc -= optind;
+	argv += optind;
+
+	if (argc != 1)
+		usage();
+	certs_dir = argv[0];
+
+	if (machine_output)
+		printf("# test\tversion\tkey\tcipher\trecord_size\tcount\t"
+		    "seconds\tvalue\tunit\n");
+
+	for (i = 0; i < N_BENCH_CIPHERS; i++) {
+		for (j = 0; j < N_BENCH_KEYS; j++)
+			bench_handshake(&bench_keys[j], &bench_ciphers[i], 0);
+	}
+
+	/* Session resumption is not currently supported for TLSv1.3. */
+	for (i = 0; i < N_BENCH_CIPHERS; i++) {
+		bc = &bench_ciphers[i];
+		if (bc->version != TLS1_2_VERSION)
+			continue;
+		for (j = 0; j < N_BENCH_KEYS; j++)
+			bench_handshake(&bench_keys[j], bc, 1);
+	}
+
+	for (i = 0; i < N_BENCH_CIPHERS; i++) {
+		for (j = 0; j < N_BENCH_RECORD_SIZES; j++)
+			bench_bulk(&bench_keys[0], &bench_ciphers[i],
+			    bench_record_sizes[j]);
+	}
+
+	return 0;
+}
@@ -0,0 +1,570 @@
+/*	$OpenBSD$ */
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <err.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <openssl/bio.h>
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+
+#include "ssl_local.h"
+#include "tls13_internal.h"
+
+static const char *certs_dir;
+
+/*
+ * Trivial run length encoding, used as the test compression algorithm since
+ * the library does not provide any itself. Runs are encoded as a count from
+ * 1 to 255, followed by the byte.
+ */
+static int rle_decompress_calls;
+
+static int
+rle_compress(SSL *ssl, uint8_t **out, size_t *out_len, const uint8_t *in,
+    size_t in_len)
+{
+	size_t i, run;
+	CBB cbb;
+
+	if (!CBB_init(&cbb, 0))
+		return 0;
+	for (i = 0; i < in_len; i += run) {
+		for (run = 1; run < 255 && i + run < in_len; run++) {
+			if (in[i + run] != in[i])
+				break;
+		}
+		if (!CBB_add_u8(&cbb, run))
+			goto err;
+		if (!CBB_add_u8(&cbb, in[i]))
+			goto err;
+	}
+	if (!CBB_finish(&cbb, out, out_len))
+		goto err;
+
+	return 1;
+
+ err:
+	CBB_cleanup(&cbb);
+
+	return 0;
+}
+
+static int
+rle_decompress(SSL *ssl, uint8_t *out, size_t out_len, const uint8_t *in,
+    size_t in_len)
+{
+	uint8_t run, byte;
+	size_t n = 0;
+	CBS cbs;
+
+	rle_decompress_calls++;
+
+	CBS_init(&cbs, in, in_len);
+	while (CBS_len(&cbs) > 0) {
+		if (!CBS_get_u8(&cbs, &run) || !CBS_get_u8(&cbs, &byte))
+			return 0;
+		if (run == 0 || run > out_len - n)
+			return 0;
+		memset(&out[n], byte, run);
+		n += run;
+	}
+
+	return n == out_len;
+}
+
+static int
+add_rle(SSL_CTX *ssl_ctx)
+{
+	return SSL_CTX_add_cert_compression_alg(ssl_ctx,
+	    TLSEXT_cert_compression_zlib, rle_compress, rle_decompress);
+}
+
+#define TEST_MAX_CERT_LIST	1024
+
+struct decompress_test {
+	const char *desc;
+	const uint8_t *msg;
+	size_t msg_len;
+	size_t want_len;
+	int want_alert;
+	int want_calls;
+};
+
+/* algorithm, uncompressed_length, compressed_certificate_message */
+static const uint8_t dt_valid[] = {
+	0x00, 0x01, 0x00, 0x00, 0x05, 0x00, 0x00, 0x04,
+	0x04, 'a', 0x01, 'b',
+};
+static const uint8_t dt_at_limit[] = {
+	0x00, 0x01, 0x00, 0x04, 0x00, 0x00, 0x00, 0x0a,
+	0xff, 'a', 0xff, 'a', 0xff, 'a', 0xff, 'a',
+	0x04, 'a',
+};
+static const uint8_t dt_truncated_header[] = {
+	0x00, 0x01, 0x00, 0x00,
+};
+static const uint8_t dt_truncated[] = {
+	0x00, 0x01, 0x00, 0x00, 0x05, 0x00, 0x00, 0x04,
+	0x04, 'a', 0x01,
+};
+static const uint8_t dt_trailing[] = {
+	0x00, 0x01, 0x00, 0x00, 0x05, 0x00, 0x00, 0x04,
+	0x04, 'a', 0x01, 'b', 0x00,
+};
+static const uint8_t dt_empty[] = {
+	0x00, 0x01, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00,
+};
+static const uint8_t dt_unknown_alg[] = {
+	0x00, 0x02, 0x00, 0x00, 0x05, 0x00, 0x00, 0x04,
+	0x04, 'a', 0x01, 'b',
+};
+static const uint8_t dt_zero_length[] = {
+	0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04,
+	0x04, 'a', 0x01, 'b',
+};
+static const uint8_t dt_oversized[] = {
+	0x00, 0x01, 0x00, 0x04, 0x01, 0x00, 0x00, 0x0a,
+	0xff, 'a', 0xff, 'a', 0xff, 'a', 0xff, 'a',
+	0x05, 'a',
+};
+static const uint8_t dt_huge[] = {
+	0x00, 0x01, 0xff, 0xff, 0xff, 0x00, 0x00, 0x02,
+	0xff, 'a',
+};
+static const uint8_t dt_short_output[] = {
+	0x00, 0x01, 0x00, 0x00, 0x06, 0x00, 0x00, 0x04,
+	0x04, 'a', 0x01, 'b',
+};
+static const uint8_t dt_long_output[] = {
+	0x00, 0x01, 0x00, 0x00, 0x04, 0x00, 0x00, 0x04,
+	0x04, 'a', 0x01, 'b',
+};
+
+static const struct decompress_test decompress_tests[] = {
+	{
+		.desc = "valid",
+		.msg = dt_valid,
+		.msg_len = sizeof(dt_valid),
+		.want_len = 5,
+		.want_calls = 1,
+	},
+	{
+		.desc = "at length limit",
+		.msg = dt_at_limit,
+		.msg_len = sizeof(dt_at_limit),
+		.want_len = TEST_MAX_CERT_LIST,
+		.want_calls = 1,
+	},
+	{
+		.desc = "truncated header",
+		.msg = dt_truncated_header,
+		.msg_len = sizeof(dt_truncated_header),
+		.want_alert = TLS13_ALERT_DECODE_ERROR,
+	},
+	{
+		.desc = "truncated compressed data",
+		.msg = dt_truncated,
+		.msg_len = sizeof(dt_truncated),
+		.want_alert = TLS13_ALERT_DECODE_ERROR,
+	},
+	{
+		.desc = "trailing data",
+		.msg = dt_trailing,
+		.msg_len = sizeof(dt_trailing),
+		.want_alert = TLS13_ALERT_DECODE_ERROR,
+	},
+	{
+		.desc = "empty compressed data",
+		.msg = dt_empty,
+		.msg_len = sizeof(dt_empty),
+		.want_alert = TLS13_ALERT_DECODE_ERROR,
+	},
+	{
+		.desc = "algorithm not offered",
+		.msg = dt_unknown_alg,
+		.msg_len = sizeof(dt_unknown_alg),
+		.want_alert = TLS13_ALERT_ILLEGAL_PARAMETER,
+	},
+	{
+		.desc = "zero uncompressed length",
+		.msg = dt_zero_length,
+		.msg_len = sizeof(dt_zero_length),
+		.want_alert = TLS13_ALERT_BAD_CERTIFICATE,
+	},
+	{
+		.desc = "uncompressed length over limit",
+		.msg = dt_oversized,
+		.msg_len = sizeof(dt_oversized),
+		.want_alert = TLS13_ALERT_BAD_CERTIFICATE,
+	},
+	{
+		.desc = "maximum uncompressed length",
+		.msg = dt_huge,
+		.msg_len = sizeof(dt_huge),
+		.want_alert = TLS13_ALERT_BAD_CERTIFICATE,
+	},
+	{
+		.desc = "decompresses to less than announced",
+		.msg = dt_short_output,
+		.msg_len = sizeof(dt_short_output),
+		.want_alert = TLS13_ALERT_BAD_CERTIFICATE,
+		.want_calls = 1,
+	},
+	{
+		.desc = "decompresses to more than announced",
+		.msg = dt_long_output,
+		.msg_len = sizeof(dt_long_output),
+		.want_alert = TLS13_ALERT_BAD_CERTIFICATE,
+		.want_calls = 1,
+	},
+};
+
+#define N_DECOMPRESS_TESTS \
+    (sizeof(decompress_tests) / sizeof(decompress_tests[0]))
+
+static int
+decompress_test(void)
+{
+	const struct decompress_test *dt;
+	struct tls13_ctx ctx;
+	uint8_t *cert_msg = NULL;
+	size_t cert_msg_len;
+	SSL_CTX *ssl_ctx;
+	SSL *ssl;
+	size_t i;
+	int ret;
+	int failed = 0;
+	CBS cbs;
+
+	if ((ssl_ctx = SSL_CTX_new(TLS_method())) == NULL)
+		errx(1, "SSL_CTX_new");
+	if (!add_rle(ssl_ctx))
+		errx(1, "failed to add compression algorithm");
+	if ((ssl = SSL_new(ssl_ctx)) == NULL)
+		errx(1, "SSL_new");
+	SSL_set_max_cert_list(ssl, TEST_MAX_CERT_LIST);
+
+	for (i = 0; i < N_DECOMPRESS_TESTS; i++) {
+		dt = &decompress_tests[i];
+
+		memset(&ctx, 0, sizeof(ctx));
+		ctx.ssl = ssl;
+		rle_decompress_calls = 0;
+
+		CBS_init(&cbs, dt->msg, dt->msg_len);
+		ret = tls13_cert_decompress(&ctx, &cbs, &cert_msg,
+		    &cert_msg_len);
+
+		if (ret != (dt->want_alert == 0)) {
+			fprintf(stderr, "FAIL: %s: decompress returned %d\n",
+			    dt->desc, ret);
+			failed = 1;
+		} else if (ctx.alert != dt->want_alert) {
+			fprintf(stderr, "FAIL: %s: got alert %d, want %d\n",
+			    dt->desc, ctx.alert, dt->want_alert);
+			failed = 1;
+		} else if (ret && cert_msg_len != dt->want_len) {
+			fprintf(stderr, "FAIL: %s: got length %zu, want %zu\n",
+			    dt->desc, cert_msg_len, dt->want_len);
+			failed = 1;
+		} else if (!ret && cert_msg != NULL) {
+			fprintf(stderr, "FAIL: %s: output on failure\n",
+			    dt->desc);
+			failed = 1;
+		}
+		if (rle_decompress_calls != dt->want_calls) {
+			fprintf(stderr, "FAIL: %s: decompress callback called "
+			    "%d times, want %d\n", dt->desc,
+			    rle_decompress_calls, dt->want_calls);
+			failed = 1;
+		}
+
+		free(cert_msg);
+		cert_msg = NULL;
+	}
+
+	SSL_free(ssl);
+	SSL_CTX_free(ssl_ctx);
+
+	return failed;
+}
+
+static int server_msg_type;
+
+static void
+server_msg_cb(int write_p, int version, int content_type, const void *buf,
+    size_t len, SSL *ssl, void *arg)
+{
+	const uint8_t *msg = buf;
+
+	if (!write_p || content_type != SSL3_RT_HANDSHAKE || len == 0)
+		return;
+	if (msg[0] == SSL3_MT_CERTIFICATE ||
+	    msg[0] == TLS13_MT_COMPRESSED_CERTIFICATE)
+		server_msg_type = msg[0];
+}
+
+static SSL_CTX *
+server_ctx_new(int compress)
+{
+	char cert_file[PATH_MAX], key_file[PATH_MAX];
+	SSL_CTX *ssl_ctx;
+
+	if ((ssl_ctx = SSL_CTX_new(TLS_method())) == NULL)
+		errx(1, "server context");
+
+	if (snprintf(cert_file, sizeof(cert_file), "%s/server1-rsa-chain.pem",
+	    certs_dir) >= (int)sizeof(cert_file))
+		errx(1, "certificate path too long");
+	if (snprintf(key_file, sizeof(key_file), "%s/server1-rsa.pem",
+	    certs_dir) >= (int)sizeof(key_file))
+		errx(1, "key path too long");
+
+	if (SSL_CTX_use_certificate_chain_file(ssl_ctx, cert_file) != 1)
+		errx(1, "failed to load server certificate");
+	if (SSL_CTX_use_PrivateKey_file(ssl_ctx, key_file,
+	    SSL_FILETYPE_PEM) != 1)
+		errx(1, "failed to load server private key");
+
+	if (compress && !add_rle(ssl_ctx))
+		errx(1, "failed to add server compression algorithm");
+
+	return ssl_ctx;
+}
+
+static SSL_CTX *
+client_ctx_new(int compress)
+{
+	char ca_file[PATH_MAX];
+	SSL_CTX *ssl_ctx;
+
+	if ((ssl_ctx = SSL_CTX_new(TLS_method())) == NULL)
+		errx(1, "client context");
+
+	if (snprintf(ca_file, sizeof(ca_file), "%s/ca-root-rsa.pem",
+	    certs_dir) >= (int)sizeof(ca_file))
+		errx(1, "CA path too long");
+	if (SSL_CTX_load_verify_locations(ssl_ctx, ca_file, NULL) != 1)
+		errx(1, "failed to load CA");
+	SSL_CTX_set_verify(ssl_ctx, SSL_VERIFY_PEER, NULL);
+
+	if (compress && !add_rle(ssl_ctx))
+		errx(1, "failed to add client compression algorithm");
+
+	return ssl_ctx;
+}
+
+static int
+do_handshake(SSL_CTX *server_ctx, SSL_CTX *client_ctx, uint16_t max_version,
+    int want_msg_type)
+{
+	SSL *client = NULL, *server = NULL;
+	BIO *client_bio, *server_bio;
+	int client_ret, server_ret;
+	int failed = 1;
+	int i;
+
+	if (!BIO_new_bio_pair(&client_bio, 0, &server_bio, 0))
+		errx(1, "BIO pair");
+
+	if ((client = SSL_new(client_ctx)) == NULL)
+		errx(1, "client SSL");
+	if ((server = SSL_new(server_ctx)) == NULL)
+		errx(1, "server SSL");
+
+	SSL_set_bio(client, client_bio, client_bio);
+	SSL_set_bio(server, server_bio, server_bio);
+
+	if (!SSL_set_max_proto_version(client, max_version))
+		errx(1, "SSL_set_max_proto_version");
+
+	SSL_set_msg_callback(server, server_msg_cb);
+	server_msg_type = -1;
+
+	SSL_set_connect_state(client);
+	SSL_set_accept_state(server);
+
+	client_ret = server_ret = 0;
+	for (i = 0; i < 100; i++) {
+		if (client_ret != 1)
+			client_ret = SSL_do_handshake(client);
+		if (server_ret != 1)
+			server_ret = SSL_do_handshake(server);
+		if (client_ret == 1 && server_ret == 1)
+			break;
+	}
+	if (client_ret != 1 || server_ret != 1) {
+		fprintf(stderr, "FAIL: handshake failed (%d, %d)\n",
+		    client_ret, server_ret);
+		ERR_print_errors_fp(stderr);
+		goto failure;
+	}
+
+	if (SSL_get_verify_result(client) != X509_V_OK) {
+		fprintf(stderr, "FAIL: verify result %ld\n",
+		    SSL_get_verify_result(client));
+		goto failure;
+	}
+	if (server_msg_type != want_msg_type) {
+		fprintf(stderr, "FAIL: server sent message type %d, "
+		    "want %d\n", server_msg_type, want_msg_type);
+		goto failure;
+	}
+
+	failed = 0;
+
+ failure:
+	SSL_free(client);
+	SSL_free(server);
+
+	return failed;
+}
+
+struct handshake_test {
+	const char *desc;
+	int server_compress;
+	int client_compress;
+	uint16_t max_version;
+	int want_msg_type;
+};
+
+static const struct handshake_test handshake_tests[] = {
+	{
+		.desc = "TLSv1.3 with compression",
+		.server_compress = 1,
+		.client_compress = 1,
+		.max_version = TLS1_3_VERSION,
+		.want_msg_type = TLS13_MT_COMPRESSED_CERTIFICATE,
+	},
+	{
+		.desc = "TLSv1.3 with client only compression",
+		.server_compress = 0,
+		.client_compress = 1,
+		.max_version = TLS1_3_VERSION,
+		.want_msg_type = SSL3_MT_CERTIFICATE,
+	},
+	{
+		.desc = "TLSv1.3 with server only compression",
+		.server_compress = 1,
+		.client_compress = 0,
+		.max_version = TLS1_3_VERSION,
+		.want_msg_type = SSL3_MT_CERTIFICATE,
+	},
+	{
+		.desc = "TLSv1.2 with compression",
+		.server_compress = 1,
+		.client_compress = 1,
+		.max_version = TLS1_2_VERSION,
+		.want_msg_type = SSL3_MT_CERTIFICATE,
+	},
+};
+
+#define N_HANDSHAKE_TESTS \
+    (sizeof(handshake_tests) / sizeof(handshake_tests[0]))
+
+static int
+handshake_test(void)
+{
+	const struct handshake_test *ht;
+	SSL_CTX *server_ctx, *client_ctx;
+	size_t i;
+	int failed = 0;
+
+	for (i = 0; i < N_HANDSHAKE_TESTS; i++) {
+		ht = &handshake_tests[i];
+
+		server_ctx = server_ctx_new(ht->server_compress);
+		client_ctx = client_ctx_new(ht->client_compress);
+
+		/* The second handshake uses the cached compressed message. */
+		if (do_handshake(server_ctx, client_ctx, ht->max_version,
+		    ht->want_msg_type) ||
+		    do_handshake(server_ctx, client_ctx, ht->max_version,
+		    ht->want_msg_type)) {
+			fprintf(stderr, "FAIL: %s\n", ht->desc);
+			failed = 1;
+		}
+
+		SSL_CTX_free(server_ctx);
+		SSL_CTX_free(client_ctx);
+	}
+
+	return failed;
+}
+
+static int
+add_alg_test(void)
+{
+	SSL_CTX *ssl_ctx;
+	int failed = 1;
+
+	if ((ssl_ctx = SSL_CTX_new(TLS_method())) == NULL)
+		errx(1, "SSL_CTX_new");
+
+	if (SSL_CTX_add_cert_compression_alg(ssl_ctx, 0, NULL, NULL)) {
+		fprintf(stderr, "FAIL: added algorithm 0\n");
+		goto failure;
+	}
+	if (SSL_CTX_add_cert_compression_alg(ssl_ctx,
+	    TLSEXT_cert_compression_zlib, NULL, NULL)) {
+		fprintf(stderr, "FAIL: added zlib without callbacks\n");
+		goto failure;
+	}
+	if (!add_rle(ssl_ctx)) {
+		fprintf(stderr, "FAIL: failed to add algorithm\n");
+		goto failure;
+	}
+	if (add_rle(ssl_ctx)) {
+		fprintf(stderr, "FAIL: added algorithm twice\n");
+		goto failure;
+	}
+	if (!SSL_CTX_add_cert_compression_alg(ssl_ctx,
+	    TLSEXT_cert_compression_brotli, NULL, rle_decompress)) {
+		fprintf(stderr, "FAIL: failed to add decompress only "
+		    "algorithm\n");
+		goto failure;
+	}
+
+	failed = 0;
+
+ failure:
+	SSL_CTX_free(ssl_ctx);
+	ERR_clear_error();
+
+	return failed;
+}
+
+int
+main(int argc, char **argv)
+{
+	int failed = 0;
+
+	if (argc != 2) {
+		fprintf(stderr, "usage: %s certsdir\n", argv[0]);
+		exit(1);
+	}
+	certs_dir = argv[1];
+
+	failed |= add_alg_test();
+	failed |= decompress_test();
+	failed |= handshake_test();
+
+	return failed;
+}
@@ -0,0 +1,335 @@
+/*	$OpenBSD$ */
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <err.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <openssl/bio.h>
+#include <openssl/err.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+
+#include "ssl_local.h"
+
+static const char *certs_dir;
+
+static void
+certs_path(char *buf, size_t len, const char *name)
+{
+	if (snprintf(buf, len, "%s/%s", certs_dir, name) >= (int)len)
+		errx(1, "path too long");
+}
+
+static X509 *
+load_cert(const char *name)
+{
+	char path[PATH_MAX];
+	X509 *cert;
+	FILE *fp;
+
+	certs_path(path, sizeof(path), name);
+	if ((fp = fopen(path, "r")) == NULL)
+		err(1, "%s", path);
+	if ((cert = PEM_read_X509(fp, NULL, NULL, NULL)) == NULL)
+		errx(1, "failed to read certificate from %s", path);
+	fclose(fp);
+
+	return cert;
+}
+
+static SSL_CTX *
+server_ctx_new(void)
+{
+	char cert_file[PATH_MAX], key_file[PATH_MAX];
+	SSL_CTX *ssl_ctx;
+
+	if ((ssl_ctx = SSL_CTX_new(TLS_method())) == NULL)
+		errx(1, "server context");
+
+	certs_path(cert_file, sizeof(cert_file), "server1-rsa-chain.pem");
+	certs_path(key_file, sizeof(key_file), "server1-rsa.pem");
+
+	if (SSL_CTX_use_certificate_chain_file(ssl_ctx, cert_file) != 1)
+		errx(1, "failed to load server certificate");
+	if (SSL_CTX_use_PrivateKey_file(ssl_ctx, key_file,
+	    SSL_FILETYPE_PEM) != 1)
+		errx(1, "failed to load server private key");
+
+	return ssl_ctx;
+}
+
+/*
+ * Perform a handshake and return the number of certificates that the client
+ * received, or -1 on failure.
+ */
+static int
+do_handshake(SSL_CTX *server_ctx, SSL *server, uint16_t max_version,
+    X509 **peer_cert)
+{
+	SSL_CTX *client_ctx;
+	SSL *client;
+	BIO *client_bio, *server_bio;
+	int client_ret, server_ret;
+	int ret = -1;
+	int i;
+
+	if ((client_ctx = SSL_CTX_new(TLS_method())) == NULL)
+		errx(1, "client context");
+	if (!SSL_CTX_set_max_proto_version(client_ctx, max_version))
+		errx(1, "SSL_CTX_set_max_proto_version");
+
+	if (!BIO_new_bio_pair(&client_bio, 0, &server_bio, 0))
+		errx(1, "BIO pair");
+
+	if ((client = SSL_new(client_ctx)) == NULL)
+		errx(1, "client SSL");
+	if (server == NULL) {
+		if ((server = SSL_new(server_ctx)) == NULL)
+			errx(1, "server SSL");
+	} else {
+		SSL_up_ref(server);
+	}
+
+	SSL_set_bio(client, client_bio, client_bio);
+	SSL_set_bio(server, server_bio, server_bio);
+
+	SSL_set_connect_state(client);
+	SSL_set_accept_state(server);
+
+	client_ret = server_ret = 0;
+	for (i = 0; i < 100; i++) {
+		if (client_ret != 1)
+			client_ret = SSL_do_handshake(client);
+		if (server_ret != 1)
+			server_ret = SSL_do_handshake(server);
+		if (client_ret == 1 && server_ret == 1)
+			break;
+	}
+	if (client_ret != 1 || server_ret != 1) {
+		fprintf(stderr, "FAIL: handshake failed (%d, %d)\n",
+		    client_ret, server_ret);
+		ERR_print_errors_fp(stderr);
+		goto failure;
+	}
+
+	ret = sk_X509_num(SSL_get_peer_cert_chain(client));
+	if (peer_cert != NULL)
+		*peer_cert = SSL_get_peer_certificate(client);
+
+ failure:
+	SSL_free(client);
+	SSL_free(server);
+	SSL_CTX_free(client_ctx);
+
+	return ret;
+}
+
+static struct ssl_cert_list *
+ctx_cert_list(SSL_CTX *ssl_ctx)
+{
+	return ssl_ctx->cert->key->cert_list;
+}
+
+static int
+cert_list_ctx_test(uint16_t max_version)
+{
+	struct ssl_cert_list *cl;
+	X509 *int_cert, *leaf, *peer_cert = NULL;
+	char path[PATH_MAX];
+	SSL_CTX *ssl_ctx;
+	int n;
+	int failed = 1;
+
+	ssl_ctx = server_ctx_new();
+	int_cert = load_cert("ca-int-rsa.pem");
+	leaf = load_cert("server2-rsa.pem");
+
+	if (ctx_cert_list(ssl_ctx) != NULL) {
+		fprintf(stderr, "FAIL: certificate list built before use\n");
+		goto failure;
+	}
+	if ((n = do_handshake(ssl_ctx, NULL, max_version, NULL)) != 2) {
+		fprintf(stderr, "FAIL: client received %d certificates, "
+		    "want 2\n", n);
+		goto failure;
+	}
+	if ((cl = ctx_cert_list(ssl_ctx)) == NULL) {
+		fprintf(stderr, "FAIL: certificate list not cached\n");
+		goto failure;
+	}
+	if ((n = do_handshake(ssl_ctx, NULL, max_version, NULL)) != 2) {
+		fprintf(stderr, "FAIL: client received %d certificates, "
+		    "want 2\n", n);
+		goto failure;
+	}
+	if (ctx_cert_list(ssl_ctx) != cl) {
+		fprintf(stderr, "FAIL: cached certificate list not reused\n");
+		goto failure;
+	}
+
+	/* Changing the chain must drop the cached list. */
+	if (!SSL_CTX_clear_chain_certs(ssl_ctx))
+		errx(1, "SSL_CTX_clear_chain_certs");
+	if (ctx_cert_list(ssl_ctx) != NULL) {
+		fprintf(stderr, "FAIL: clearing the chain did not drop the "
+		    "certificate list\n");
+		goto failure;
+	}
+	if ((n = do_handshake(ssl_ctx, NULL, max_version, NULL)) != 1) {
+		fprintf(stderr, "FAIL: client received %d certificates "
+		    "after clearing the chain, want 1\n", n);
+		goto failure;
+	}
+	if (!SSL_CTX_add1_chain_cert(ssl_ctx, int_cert))
+		errx(1, "SSL_CTX_add1_chain_cert");
+	if (ctx_cert_list(ssl_ctx) != NULL) {
+		fprintf(stderr, "FAIL: adding to the chain did not drop the "
+		    "certificate list\n");
+		goto failure;
+	}
+	if ((n = do_handshake(ssl_ctx, NULL, max_version, NULL)) != 2) {
+		fprintf(stderr, "FAIL: client received %d certificates "
+		    "after adding to the chain, want 2\n", n);
+		goto failure;
+	}
+
+	/* As must changing the certificate and key. */
+	if (SSL_CTX_use_certificate(ssl_ctx, leaf) != 1)
+		errx(1, "SSL_CTX_use_certificate");
+	if (ctx_cert_list(ssl_ctx) != NULL) {
+		fprintf(stderr, "FAIL: changing the certificate did not drop "
+		    "the certificate list\n");
+		goto failure;
+	}
+	certs_path(path, sizeof(path), "server2-rsa.pem");
+	if (SSL_CTX_use_PrivateKey_file(ssl_ctx, path, SSL_FILETYPE_PEM) != 1)
+		errx(1, "SSL_CTX_use_PrivateKey_file");
+	if ((n = do_handshake(ssl_ctx, NULL, max_version, &peer_cert)) != 2) {
+		fprintf(stderr, "FAIL: client received %d certificates "
+		    "after changing the certificate, want 2\n", n);
+		goto failure;
+	}
+	if (X509_cmp(peer_cert, leaf) != 0) {
+		fprintf(stderr, "FAIL: client received the previous "
+		    "certificate\n");
+		goto failure;
+	}
+	if (ctx_cert_list(ssl_ctx) == NULL) {
+		fprintf(stderr, "FAIL: certificate list not cached\n");
+		goto failure;
+	}
+
+	/* A key that does not match drops the certificate and its list. */
+	certs_path(path, sizeof(path), "server1-rsa.pem");
+	if (SSL_CTX_use_PrivateKey_file(ssl_ctx, path, SSL_FILETYPE_PEM) == 1) {
+		fprintf(stderr, "FAIL: mismatched private key accepted\n");
+		goto failure;
+	}
+	ERR_clear_error();
+	if (ctx_cert_list(ssl_ctx) != NULL) {
+		fprintf(stderr, "FAIL: changing the key did not drop the "
+		    "certificate list\n");
+		goto failure;
+	}
+
+	failed = 0;
+
+ failure:
+	SSL_CTX_free(ssl_ctx);
+	X509_free(int_cert);
+	X509_free(leaf);
+	X509_free(peer_cert);
+
+	return failed;
+}
+
+static int
+cert_list_ssl_test(uint16_t max_version)
+{
+	struct ssl_cert_list *cl;
+	SSL_CTX *ssl_ctx;
+	SSL *ssl = NULL;
+	int n;
+	int failed = 1;
+
+	ssl_ctx = server_ctx_new();
+
+	if (do_handshake(ssl_ctx, NULL, max_version, NULL) != 2)
+		errx(1, "handshake failed");
+	if ((cl = ctx_cert_list(ssl_ctx)) == NULL) {
+		fprintf(stderr, "FAIL: certificate list not cached\n");
+		goto failure;
+	}
+
+	/* Changing the chain of an SSL must not affect the SSL_CTX. */
+	if ((ssl = SSL_new(ssl_ctx)) == NULL)
+		errx(1, "SSL_new");
+	if (!SSL_clear_chain_certs(ssl))
+		errx(1, "SSL_clear_chain_certs");
+	if (ssl->cert == ssl_ctx->cert) {
+		fprintf(stderr, "FAIL: SSL shares the modified SSL_CERT\n");
+		goto failure;
+	}
+	if (ssl->cert->key->cert_list != NULL) {
+		fprintf(stderr, "FAIL: clearing the chain did not drop the "
+		    "SSL certificate list\n");
+		goto failure;
+	}
+	if ((n = do_handshake(ssl_ctx, ssl, max_version, NULL)) != 1) {
+		fprintf(stderr, "FAIL: client received %d certificates "
+		    "after clearing the SSL chain, want 1\n", n);
+		goto failure;
+	}
+	if (ctx_cert_list(ssl_ctx) != cl) {
+		fprintf(stderr, "FAIL: SSL_CTX certificate list replaced\n");
+		goto failure;
+	}
+	if ((n = do_handshake(ssl_ctx, NULL, max_version, NULL)) != 2) {
+		fprintf(stderr, "FAIL: client received %d certificates "
+		    "from the SSL_CTX, want 2\n", n);
+		goto failure;
+	}
+
+	failed = 0;
+
+ failure:
+	SSL_free(ssl);
+	SSL_CTX_free(ssl_ctx);
+
+	return failed;
+}
+
+int
+main(int argc, char **argv)
+{
+	int failed = 0;
+
+	if (argc != 2) {
+		fprintf(stderr, "usage: %s certsdir\n", argv[0]);
+		exit(1);
+	}
+	certs_dir = argv[1];
+
+	failed |= cert_list_ctx_test(TLS1_2_VERSION);
+	failed |= cert_list_ctx_test(TLS1_3_VERSION);
+	failed |= cert_list_ssl_test(TLS1_2_VERSION);
+	failed |= cert_list_ssl_test(TLS1_3_VERSION);
+
+	return failed;
+}
@@ -755,6 +755,7 @@ struct dtls_test {
 	long ssl_options;
 	int client_bbio_off;
 	int server_bbio_off;
+	int dgram_batch;
 	uint16_t initial_epoch;
 	int write_after_accept;
 	int shutdown_after_accept;
@@ -788,6 +789,22 @@ static const struct dtls_test dtls_tests[] = {
 		.mtu = 256,
 		.ssl_options = 0,
 	},
+	{
+		.desc = "DTLS with batched datagram I/O",
+		.ssl_options = 0,
+		.dgram_batch = 16,
+	},
+	{
+		.desc = "DTLS with cookies and batched datagram I/O",
+		.ssl_options = SSL_OP_COOKIE_EXCHANGE,
+		.dgram_batch = 16,
+	},
+	{
+		.desc = "DTLS with low MTU and batched datagram I/O",
+		.mtu = 256,
+		.ssl_options = 0,
+		.dgram_batch = 4,
+	},
 	{
 		.desc = "DTLS with low MTU and cookies",
 		.mtu = 256,
@@ -981,6 +998,23 @@ dtlstest(const struct dtls_test *dt)
 	tls12_record_layer_set_initial_epoch(client->rl, dt->initial_epoch);
 	tls12_record_layer_set_initial_epoch(server->rl, dt->initial_epoch);
 
+	if (dt->dgram_batch > 0) {
+		if (BIO_dgram_set_batch(SSL_get_wbio(client),
+		    dt->dgram_batch) != 1 ||
+		    BIO_dgram_set_batch(SSL_get_wbio(server),
+		    dt->dgram_batch) != 1) {
+			fprintf(stderr, "FAIL: failed to enable batching\n");
+			goto failure;
+		}
+		if (BIO_dgram_get_batch(SSL_get_wbio(client)) !=
+		    dt->dgram_batch) {
+			fprintf(stderr, "FAIL: got batch %d, want %d\n",
+			    BIO_dgram_get_batch(SSL_get_wbio(client)),
+			    dt->dgram_batch);
+			goto failure;
+		}
+	}
+
 	if (dt->client_bbio_off)
 		SSL_set_info_callback(client, dtls_info_callback);
 	if (dt->server_bbio_off)
@@ -15,7 +15,15 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <sys/time.h>
+
 #include <err.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <openssl/curve25519.h>
+#include <openssl/ec.h>
 
 #include "ssl_local.h"
 
@@ -182,10 +190,210 @@ uint8_t expected_exporter_master[] = {
 	0xae, 0x31, 0x1b, 0x43, 0x09, 0xd3, 0xcf, 0x50
 };
 
+static volatile sig_atomic_t benchmark_stop;
+
+static void
+benchmark_sig_alarm(int sig)
+{
+	benchmark_stop = 1;
+}
+
+static void
+benchmark_start(struct timespec *start, int seconds)
+{
+	signal(SIGALRM, benchmark_sig_alarm);
+	benchmark_stop = 0;
+	alarm(seconds);
+
+	clock_gettime(CLOCK_MONOTONIC, start);
+}
+
+static void
+benchmark_report(const char *desc, const struct timespec *start, long ops)
+{
+	struct timespec end, duration;
+	double secs;
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	timespecsub(&end, start, &duration);
+	secs = duration.tv_sec + duration.tv_nsec / 1000000000.0;
+
+	fprintf(stderr, "%-44s: %10.1f handshakes/s\n", desc, ops / secs);
+}
+
+/*
+ * Derive all TLSv1.3 secrets for a full handshake, as done once per
+ * connection by both client and server.
+ */
+static void
+benchmark_tls13_key_schedule(const char *desc, const EVP_MD *digest,
+    int seconds)
+{
+	struct tls13_secrets *secrets;
+	struct timespec start;
+	long handshakes = 0;
+
+	benchmark_start(&start, seconds);
+
+	while (!benchmark_stop) {
+		if ((secrets = tls13_secrets_create(digest, 0)) == NULL)
+			errx(1, "failed to create secrets");
+		if (!tls13_derive_early_secrets(secrets, secrets->zeros.data,
+		    secrets->zeros.len, &chello_hash))
+			errx(1, "derive_early_secrets failed");
+		if (!tls13_derive_handshake_secrets(secrets, ecdhe,
+		    sizeof(ecdhe), &cshello_hash))
+			errx(1, "derive_handshake_secrets failed");
+		if (!tls13_derive_application_secrets(secrets, &csfhello_hash))
+			errx(1, "derive_application_secrets failed");
+		tls13_secrets_destroy(secrets);
+		handshakes++;
+	}
+
+	benchmark_report(desc, &start, handshakes);
+}
+
+/*
+ * Approximate sizes of the handshake messages in a TLSv1.3 full handshake,
+ * with the transcript hash being taken after each of them.
+ */
+static const size_t benchmark_transcript_messages[] = {
+	512,	/* ClientHello */
+	128,	/* ServerHello */
+	64,	/* EncryptedExtensions */
+	2048,	/* Certificate */
+	80,	/* CertificateVerify */
+	52,	/* Server Finished */
+	52,	/* Client Finished */
+};
+
+#define N_BENCHMARK_TRANSCRIPT_MESSAGES \
+    (sizeof(benchmark_transcript_messages) / \
+     sizeof(benchmark_transcript_messages[0]))
+
+static void
+benchmark_transcript(const char *desc, uint16_t cipher_value, int seconds)
+{
+	uint8_t msg[2048], hash[EVP_MAX_MD_SIZE];
+	struct timespec start;
+	long handshakes = 0;
+	SSL_CTX *ssl_ctx;
+	SSL *ssl;
+	size_t i;
+
+	memset(msg, 0x5a, sizeof(msg));
+
+	if ((ssl_ctx = SSL_CTX_new(TLS_method())) == NULL)
+		errx(1, "SSL_CTX_new");
+	if ((ssl = SSL_new(ssl_ctx)) == NULL)
+		errx(1, "SSL_new");
+	if ((ssl->s3->hs.cipher = ssl3_get_cipher_by_value(cipher_value)) ==
+	    NULL)
+		errx(1, "no cipher 0x%04x", cipher_value);
+
+	benchmark_start(&start, seconds);
+
+	while (!benchmark_stop) {
+		if (!tls1_transcript_init(ssl))
+			errx(1, "tls1_transcript_init failed");
+		if (!tls1_transcript_hash_init(ssl))
+			errx(1, "tls1_transcript_hash_init failed");
+		for (i = 0; i < N_BENCHMARK_TRANSCRIPT_MESSAGES; i++) {
+			if (!tls1_transcript_hash_update(ssl, msg,
+			    benchmark_transcript_messages[i]))
+				errx(1, "tls1_transcript_hash_update failed");
+			if (!tls1_transcript_hash_value(ssl, hash,
+			    sizeof(hash), NULL))
+				errx(1, "tls1_transcript_hash_value failed");
+		}
+		tls1_transcript_hash_free(ssl);
+		tls1_transcript_free(ssl);
+		handshakes++;
+	}
+
+	benchmark_report(desc, &start, handshakes);
+
+	SSL_free(ssl);
+	SSL_CTX_free(ssl_ctx);
+}
+
+/*
+ * Server side public key operations for a full TLSv1.3 handshake using an
+ * X25519 key share and an ECDSA P-256 certificate, for comparison with the
+ * symmetric costs above.
+ */
+static void
+benchmark_handshake_crypto(int seconds)
+{
+	uint8_t peer_public[X25519_KEY_LENGTH], peer_private[X25519_KEY_LENGTH];
+	uint8_t public[X25519_KEY_LENGTH], private[X25519_KEY_LENGTH];
+	uint8_t shared[X25519_KEY_LENGTH], sig[256], tbs[130];
+	struct timespec start;
+	long handshakes = 0;
+	EVP_PKEY_CTX *pctx;
+	EVP_PKEY *pkey = NULL;
+	EVP_MD_CTX *mdctx;
+	size_t sig_len;
+
+	X25519_keypair(peer_public, peer_private);
+	memset(tbs, 0x20, sizeof(tbs));
+
+	if ((pctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, NULL)) == NULL)
+		errx(1, "EVP_PKEY_CTX_new_id");
+	if (EVP_PKEY_keygen_init(pctx) <= 0)
+		errx(1, "EVP_PKEY_keygen_init");
+	if (EVP_PKEY_CTX_set_ec_paramgen_curve_nid(pctx,
+	    NID_X9_62_prime256v1) <= 0)
+		errx(1, "EVP_PKEY_CTX_set_ec_paramgen_curve_nid");
+	if (EVP_PKEY_keygen(pctx, &pkey) <= 0)
+		errx(1, "EVP_PKEY_keygen");
+	if ((mdctx = EVP_MD_CTX_new()) == NULL)
+		errx(1, "EVP_MD_CTX_new");
+
+	benchmark_start(&start, seconds);
+
+	while (!benchmark_stop) {
+		X25519_keypair(public, private);
+		if (!X25519(shared, private, peer_public))
+			errx(1, "X25519 failed");
+		if (!EVP_MD_CTX_reset(mdctx))
+			errx(1, "EVP_MD_CTX_reset");
+		if (!EVP_DigestSignInit(mdctx, NULL, EVP_sha256(), NULL, pkey))
+			errx(1, "EVP_DigestSignInit");
+		sig_len = sizeof(sig);
+		if (!EVP_DigestSign(mdctx, sig, &sig_len, tbs, sizeof(tbs)))
+			errx(1, "EVP_DigestSign");
+		handshakes++;
+	}
+
+	benchmark_report("X25519 + ECDSA P-256 signature", &start,
+	    handshakes);
+
+	EVP_MD_CTX_free(mdctx);
+	EVP_PKEY_free(pkey);
+	EVP_PKEY_CTX_free(pctx);
+}
+
+static void
+benchmark_key_schedule(int seconds)
+{
+	benchmark_tls13_key_schedule("TLSv1.3 key schedule SHA-256",
+	    EVP_sha256(), seconds);
+	benchmark_tls13_key_schedule("TLSv1.3 key schedule SHA-384",
+	    EVP_sha384(), seconds);
+	benchmark_transcript("TLSv1.3 transcript SHA-256", 0x1301, seconds);
+	benchmark_transcript("TLSv1.3 transcript SHA-384", 0x1302, seconds);
+	benchmark_handshake_crypto(seconds);
+}
+
 int
 main (int argc, char **argv)
 {
 	struct tls13_secrets *secrets;
+	int benchmark = 0;
+
+	if (argc == 2 && strcmp(argv[1], "--benchmark") == 0)
+		benchmark = 1;
 
 	if ((secrets = tls13_secrets_create(EVP_sha256(), 0)) == NULL)
 		errx(1,"failed to create secrets\n");
@@ -313,5 +521,8 @@ main (int argc, char **argv)
 
 	tls13_secrets_destroy(secrets);
 
+	if (benchmark && failures == 0)
+		benchmark_key_schedule(1);
+
 	return failures;
 }
@@ -0,0 +1,801 @@
+/*	$OpenBSD$ */
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <sys/time.h>
+
+#include <err.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <openssl/err.h>
+#include <openssl/objects.h>
+#include <openssl/ssl.h>
+
+#include "bytestring.h"
+#include "ssl_local.h"
+#include "tls_internal.h"
+
+static const char *certs_dir;
+
+struct key_share_test {
+	const char *desc;
+	uint16_t group_id;
+	size_t client_share_len;
+	size_t server_share_len;
+	size_t shared_key_len;
+};
+
+static const struct key_share_test key_share_tests[] = {
+	{
+		.desc = "secp256r1",
+		.group_id = 23,
+		.client_share_len = 65,
+		.server_share_len = 65,
+		.shared_key_len = 32,
+	},
+	{
+		.desc = "X25519",
+		.group_id = 29,
+		.client_share_len = 32,
+		.server_share_len = 32,
+		.shared_key_len = 32,
+	},
+	{
+		.desc = "X25519MLKEM768",
+		.group_id = 4588,
+		.client_share_len = 1184 + 32,
+		.server_share_len = 1088 + 32,
+		.shared_key_len = 32 + 32,
+	},
+};
+
+#define N_KEY_SHARE_TESTS \
+    (sizeof(key_share_tests) / sizeof(key_share_tests[0]))
+
+static int
+key_share_public(struct tls_key_share *ks, uint8_t **out, size_t *out_len)
+{
+	CBB cbb;
+	int ret = 0;
+
+	if (!CBB_init(&cbb, 0))
+		goto err;
+	if (!tls_key_share_public(ks, &cbb))
+		goto err;
+	if (!CBB_finish(&cbb, out, out_len))
+		goto err;
+
+	ret = 1;
+
+ err:
+	CBB_cleanup(&cbb);
+
+	return ret;
+}
+
+static int
+key_share_peer_public(struct tls_key_share *ks, const uint8_t *data,
+    size_t data_len, int *decode_error)
+{
+	CBS cbs;
+
+	CBS_init(&cbs, data, data_len);
+
+	return tls_key_share_peer_public(ks, &cbs, decode_error, NULL);
+}
+
+static int
+key_share_test(const struct key_share_test *kst)
+{
+	struct tls_key_share *client = NULL, *server = NULL;
+	uint8_t *client_public = NULL, *server_public = NULL;
+	uint8_t *client_key = NULL, *server_key = NULL;
+	size_t client_public_len = 0, server_public_len = 0;
+	size_t client_key_len = 0, server_key_len = 0;
+	int decode_error;
+	int failed = 1;
+
+	if ((client = tls_key_share_new(kst->group_id)) == NULL)
+		errx(1, "%s: client key share", kst->desc);
+	if ((server = tls_key_share_new(kst->group_id)) == NULL)
+		errx(1, "%s: server key share", kst->desc);
+
+	if (!tls_key_share_generate(client)) {
+		fprintf(stderr, "FAIL: %s: client generate\n", kst->desc);
+		goto failure;
+	}
+	if (!key_share_public(client, &client_public, &client_public_len)) {
+		fprintf(stderr, "FAIL: %s: client public\n", kst->desc);
+		goto failure;
+	}
+	if (client_public_len != kst->client_share_len) {
+		fprintf(stderr, "FAIL: %s: client share is %zu bytes, "
+		    "want %zu\n", kst->desc, client_public_len,
+		    kst->client_share_len);
+		goto failure;
+	}
+
+	if (!key_share_peer_public(server, client_public, client_public_len,
+	    &decode_error)) {
+		fprintf(stderr, "FAIL: %s: server peer public\n", kst->desc);
+		goto failure;
+	}
+	if (!tls_key_share_generate(server)) {
+		fprintf(stderr, "FAIL: %s: server generate\n", kst->desc);
+		goto failure;
+	}
+	if (!key_share_public(server, &server_public, &server_public_len)) {
+		fprintf(stderr, "FAIL: %s: server public\n", kst->desc);
+		goto failure;
+	}
+	if (server_public_len != kst->server_share_len) {
+		fprintf(stderr, "FAIL: %s: server share is %zu bytes, "
+		    "want %zu\n", kst->desc, server_public_len,
+		    kst->server_share_len);
+		goto failure;
+	}
+
+	if (!key_share_peer_public(client, server_public, server_public_len,
+	    &decode_error)) {
+		fprintf(stderr, "FAIL: %s: client peer public\n", kst->desc);
+		goto failure;
+	}
+
+	if (!tls_key_share_derive(client, &client_key, &client_key_len)) {
+		fprintf(stderr, "FAIL: %s: client derive\n", kst->desc);
+		goto failure;
+	}
+	if (!tls_key_share_derive(server, &server_key, &server_key_len)) {
+		fprintf(stderr, "FAIL: %s: server derive\n", kst->desc);
+		goto failure;
+	}
+	if (client_key_len != kst->shared_key_len ||
+	    server_key_len != kst->shared_key_len) {
+		fprintf(stderr, "FAIL: %s: shared keys are %zu and %zu bytes, "
+		    "want %zu\n", kst->desc, client_key_len, server_key_len,
+		    kst->shared_key_len);
+		goto failure;
+	}
+	if (memcmp(client_key, server_key, client_key_len) != 0) {
+		fprintf(stderr, "FAIL: %s: shared keys differ\n", kst->desc);
+		goto failure;
+	}
+
+	failed = 0;
+
+ failure:
+	tls_key_share_free(client);
+	tls_key_share_free(server);
+	free(client_public);
+	free(server_public);
+	freezero(client_key, client_key_len);
+	freezero(server_key, server_key_len);
+
+	return failed;
+}
+
+static int
+test_key_shares(void)
+{
+	size_t i;
+	int failed = 0;
+
+	for (i = 0; i < N_KEY_SHARE_TESTS; i++)
+		failed |= key_share_test(&key_share_tests[i]);
+
+	return failed;
+}
+
+/*
+ * Key shares of the wrong length must be rejected as decode errors, while a
+ * modified ML-KEM ciphertext must result in a different shared key.
+ */
+static int
+test_hybrid_peer_public(void)
+{
+	struct tls_key_share *client = NULL, *server = NULL;
+	uint8_t *client_public = NULL, *server_public = NULL;
+	uint8_t *client_key = NULL, *server_key = NULL;
+	size_t client_public_len = 0, server_public_len = 0;
+	size_t client_key_len = 0, server_key_len = 0;
+	int decode_error;
+	int failed = 1;
+
+	if ((client = tls_key_share_new(4588)) == NULL)
+		errx(1, "client key share");
+	if (!tls_key_share_generate(client))
+		errx(1, "client generate");
+	if (!key_share_public(client, &client_public, &client_public_len))
+		errx(1, "client public");
+
+	if ((server = tls_key_share_new(4588)) == NULL)
+		errx(1, "server key share");
+	decode_error = 0;
+	if (key_share_peer_public(server, client_public, client_public_len - 1,
+	    &decode_error) || !decode_error) {
+		fprintf(stderr, "FAIL: truncated client share was not a "
+		    "decode error\n");
+		goto failure;
+	}
+	tls_key_share_free(server);
+
+	/* Encapsulation key coefficients must be less than q. */
+	client_public[0] = 0xff;
+	client_public[1] |= 0x0f;
+	if ((server = tls_key_share_new(4588)) == NULL)
+		errx(1, "server key share");
+	decode_error = 0;
+	if (key_share_peer_public(server, client_public, client_public_len,
+	    &decode_error) || !decode_error) {
+		fprintf(stderr, "FAIL: invalid encapsulation key was not a "
+		    "decode error\n");
+		goto failure;
+	}
+	tls_key_share_free(server);
+
+	free(client_public);
+	client_public = NULL;
+	if (!key_share_public(client, &client_public, &client_public_len))
+		errx(1, "client public");
+
+	if ((server = tls_key_share_new(4588)) == NULL)
+		errx(1, "server key share");
+	if (!key_share_peer_public(server, client_public, client_public_len,
+	    &decode_error))
+		errx(1, "server peer public");
+	if (!tls_key_share_generate(server))
+		errx(1, "server generate");
+	if (!key_share_public(server, &server_public, &server_public_len))
+		errx(1, "server public");
+
+	decode_error = 0;
+	if (key_share_peer_public(client, server_public, client_public_len,
+	    &decode_error) || !decode_error) {
+		fprintf(stderr, "FAIL: client share accepted by client\n");
+		goto failure;
+	}
+
+	server_public[0] ^= 0x01;
+	if (!key_share_peer_public(client, server_public, server_public_len,
+	    &decode_error)) {
+		fprintf(stderr, "FAIL: client peer public\n");
+		goto failure;
+	}
+	if (!tls_key_share_derive(client, &client_key, &client_key_len))
+		errx(1, "client derive");
+	if (!tls_key_share_derive(server, &server_key, &server_key_len))
+		errx(1, "server derive");
+	if (memcmp(client_key, server_key, 32) == 0) {
+		fprintf(stderr, "FAIL: modified ciphertext gave the same "
+		    "ML-KEM shared secret\n");
+		goto failure;
+	}
+	if (memcmp(&client_key[32], &server_key[32], 32) != 0) {
+		fprintf(stderr, "FAIL: X25519 shared secrets differ\n");
+		goto failure;
+	}
+
+	failed = 0;
+
+ failure:
+	tls_key_share_free(client);
+	tls_key_share_free(server);
+	free(client_public);
+	free(server_public);
+	freezero(client_key, client_key_len);
+	freezero(server_key, server_key_len);
+
+	return failed;
+}
+
+static SSL_CTX *
+server_ctx_new(void)
+{
+	char file[PATH_MAX];
+	SSL_CTX *ssl_ctx;
+
+	if ((ssl_ctx = SSL_CTX_new(TLS_method())) == NULL)
+		errx(1, "server context");
+
+	if (snprintf(file, sizeof(file), "%s/server1-ecdsa-chain.pem",
+	    certs_dir) >= (int)sizeof(file))
+		errx(1, "certificate path too long");
+	if (SSL_CTX_use_certificate_chain_file(ssl_ctx, file) != 1)
+		errx(1, "failed to load server certificate");
+	if (snprintf(file, sizeof(file), "%s/server1-ecdsa.pem",
+	    certs_dir) >= (int)sizeof(file))
+		errx(1, "key path too long");
+	if (SSL_CTX_use_PrivateKey_file(ssl_ctx, file, SSL_FILETYPE_PEM) != 1)
+		errx(1, "failed to load server key");
+
+	return ssl_ctx;
+}
+
+static int client_hellos;
+
+static void
+count_client_hellos(int write_p, int version, int content_type,
+    const void *buf, size_t len, SSL *ssl, void *arg)
+{
+	if (write_p && content_type == SSL3_RT_HANDSHAKE && len > 0 &&
+	    *(const uint8_t *)buf == SSL3_MT_CLIENT_HELLO)
+		client_hellos++;
+}
+
+/*
+ * Perform a handshake over a BIO pair, returning the group used for the key
+ * exchange.
+ */
+static int
+do_handshake_servername(SSL_CTX *server_ctx, SSL_CTX *client_ctx,
+    const char *servername, uint16_t *out_group)
+{
+	SSL *client = NULL, *server = NULL;
+	BIO *client_bio, *server_bio;
+	int client_ret, server_ret;
+	int nid;
+	int ret = 0;
+	int i;
+
+	if (!BIO_new_bio_pair(&client_bio, 0, &server_bio, 0))
+		errx(1, "BIO pair");
+
+	if ((client = SSL_new(client_ctx)) == NULL)
+		errx(1, "client SSL");
+	if ((server = SSL_new(server_ctx)) == NULL)
+		errx(1, "server SSL");
+
+	SSL_set_bio(client, client_bio, client_bio);
+	SSL_set_bio(server, server_bio, server_bio);
+
+	if (servername != NULL &&
+	    !SSL_set_tlsext_host_name(client, servername))
+		errx(1, "SSL_set_tlsext_host_name");
+
+	SSL_set_connect_state(client);
+	SSL_set_accept_state(server);
+
+	client_ret = server_ret = 0;
+	for (i = 0; i < 100; i++) {
+		if (client_ret != 1)
+			client_ret = SSL_do_handshake(client);
+		if (server_ret != 1)
+			server_ret = SSL_do_handshake(server);
+		if (client_ret == 1 && server_ret == 1)
+			break;
+		if (client_ret != 1 && SSL_get_error(client, client_ret) ==
+		    SSL_ERROR_SSL)
+			goto err;
+		if (server_ret != 1 && SSL_get_error(server, server_ret) ==
+		    SSL_ERROR_SSL)
+			goto err;
+	}
+	if (client_ret != 1 || server_ret != 1)
+		goto err;
+
+	if (client->s3->hs.key_share == NULL ||
+	    server->s3->hs.key_share == NULL)
+		goto err;
+	if (tls_key_share_group(client->s3->hs.key_share) !=
+	    tls_key_share_group(server->s3->hs.key_share))
+		goto err;
+
+	*out_group = tls_key_share_group(server->s3->hs.key_share);
+
+	if (!tls1_ec_group_id2nid(*out_group, &nid))
+		goto err;
+	if (SSL_get_negotiated_group(client) != nid ||
+	    SSL_get_negotiated_group(server) != nid)
+		goto err;
+
+	ret = 1;
+
+ err:
+	SSL_free(client);
+	SSL_free(server);
+
+	return ret;
+}
+
+static int
+do_handshake(SSL_CTX *server_ctx, SSL_CTX *client_ctx, uint16_t *out_group)
+{
+	return do_handshake_servername(server_ctx, client_ctx, NULL, out_group);
+}
+
+struct handshake_test {
+	const char *desc;
+	const char *client_groups;
+	uint16_t max_version;
+	uint16_t want_group;
+};
+
+static const struct handshake_test handshake_tests[] = {
+	{
+		.desc = "TLSv1.3 hybrid",
+		.client_groups = "X25519MLKEM768:X25519",
+		.max_version = TLS1_3_VERSION,
+		.want_group = 4588,
+	},
+	{
+		.desc = "TLSv1.3 hybrid after hello retry request",
+		.client_groups = "secp521r1:X25519MLKEM768",
+		.max_version = TLS1_3_VERSION,
+		.want_group = 4588,
+	},
+	{
+		.desc = "TLSv1.3 default groups",
+		.max_version = TLS1_3_VERSION,
+		.want_group = 29,
+	},
+	{
+		.desc = "TLSv1.2 hybrid preferred",
+		.client_groups = "X25519MLKEM768:X25519:P-256",
+		.max_version = TLS1_2_VERSION,
+		.want_group = 29,
+	},
+	{
+		.desc = "TLSv1.2 hybrid and P-256",
+		.client_groups = "X25519MLKEM768:P-256",
+		.max_version = TLS1_2_VERSION,
+		.want_group = 23,
+	},
+};
+
+#define N_HANDSHAKE_TESTS \
+    (sizeof(handshake_tests) / sizeof(handshake_tests[0]))
+
+static int
+handshake_test(SSL_CTX *server_ctx, const struct handshake_test *ht)
+{
+	SSL_CTX *client_ctx;
+	uint16_t group = 0;
+	int failed = 1;
+
+	if ((client_ctx = SSL_CTX_new(TLS_method())) == NULL)
+		errx(1, "client context");
+	if (!SSL_CTX_set_max_proto_version(client_ctx, ht->max_version))
+		errx(1, "SSL_CTX_set_max_proto_version");
+	if (ht->client_groups != NULL &&
+	    !SSL_CTX_set1_groups_list(client_ctx, ht->client_groups))
+		errx(1, "SSL_CTX_set1_groups_list");
+
+	if (!do_handshake(server_ctx, client_ctx, &group)) {
+		fprintf(stderr, "FAIL: %s: handshake failed\n", ht->desc);
+		ERR_print_errors_fp(stderr);
+		goto failure;
+	}
+	if (group != ht->want_group) {
+		fprintf(stderr, "FAIL: %s: negotiated group %u, want %u\n",
+		    ht->desc, group, ht->want_group);
+		goto failure;
+	}
+
+	failed = 0;
+
+ failure:
+	SSL_CTX_free(client_ctx);
+
+	return failed;
+}
+
+static int
+test_handshakes(void)
+{
+	SSL_CTX *server_ctx;
+	size_t i;
+	int failed = 0;
+
+	server_ctx = server_ctx_new();
+
+	for (i = 0; i < N_HANDSHAKE_TESTS; i++)
+		failed |= handshake_test(server_ctx, &handshake_tests[i]);
+
+	SSL_CTX_free(server_ctx);
+
+	return failed;
+}
+
+struct group_cache_test {
+	const char *desc;
+	const char *servername;
+	int expire;
+	int want_client_hellos;
+};
+
+static const struct group_cache_test group_cache_tests[] = {
+	{
+		.desc = "first connection",
+		.servername = "server.example.com",
+		.want_client_hellos = 2,
+	},
+	{
+		.desc = "cached group",
+		.servername = "server.example.com",
+		.want_client_hellos = 1,
+	},
+	{
+		.desc = "different server name",
+		.servername = "other.example.com",
+		.want_client_hellos = 2,
+	},
+	{
+		.desc = "no server name",
+		.servername = NULL,
+		.want_client_hellos = 2,
+	},
+	{
+		.desc = "cached group again",
+		.servername = "server.example.com",
+		.want_client_hellos = 1,
+	},
+	{
+		.desc = "expired group",
+		.servername = "server.example.com",
+		.expire = 1,
+		.want_client_hellos = 2,
+	},
+	{
+		.desc = "cached group after expiry",
+		.servername = "server.example.com",
+		.want_client_hellos = 1,
+	},
+};
+
+#define N_GROUP_CACHE_TESTS \
+    (sizeof(group_cache_tests) / sizeof(group_cache_tests[0]))
+
+/*
+ * A server that only supports X25519MLKEM768 forces a hello retry request
+ * for a client that sends an X25519 key share - once the client has learnt
+ * the server's group, later connections to the same server should not
+ * need one until the cached entry expires.
+ */
+static int
+test_group_cache(void)
+{
+	const struct group_cache_test *gct;
+	SSL_CTX *server_ctx, *client_ctx;
+	uint16_t group;
+	size_t i, j;
+	int failed = 0;
+
+	server_ctx = server_ctx_new();
+	if (!SSL_CTX_set1_groups_list(server_ctx, "X25519MLKEM768"))
+		errx(1, "SSL_CTX_set1_groups_list");
+
+	if ((client_ctx = SSL_CTX_new(TLS_method())) == NULL)
+		errx(1, "client context");
+	if (!SSL_CTX_set1_groups_list(client_ctx, "X25519:X25519MLKEM768"))
+		errx(1, "SSL_CTX_set1_groups_list");
+	SSL_CTX_set_msg_callback(client_ctx, count_client_hellos);
+
+	for (i = 0; i < N_GROUP_CACHE_TESTS; i++) {
+		gct = &group_cache_tests[i];
+
+		client_hellos = 0;
+		group = 0;
+
+		if (gct->expire) {
+			for (j = 0; j < SSL_GROUP_CACHE_SIZE; j++)
+				client_ctx->group_cache[j].expires = 0;
+		}
+
+		if (!do_handshake_servername(server_ctx, client_ctx,
+		    gct->servername, &group)) {
+			fprintf(stderr, "FAIL: %s: handshake failed\n",
+			    gct->desc);
+			ERR_print_errors_fp(stderr);
+			failed = 1;
+			continue;
+		}
+		if (group != 4588) {
+			fprintf(stderr, "FAIL: %s: negotiated group %u, "
+			    "want 4588\n", gct->desc, group);
+			failed = 1;
+		}
+		if (client_hellos != gct->want_client_hellos) {
+			fprintf(stderr, "FAIL: %s: sent %d client hellos, "
+			    "want %d\n", gct->desc, client_hellos,
+			    gct->want_client_hellos);
+			failed = 1;
+		}
+	}
+
+	SSL_CTX_free(client_ctx);
+	SSL_CTX_free(server_ctx);
+
+	return failed;
+}
+
+static int
+test_key_share_group(void)
+{
+	SSL_CTX *ssl_ctx;
+	SSL *ssl;
+	uint16_t group_id;
+	int failed = 1;
+
+	if ((ssl_ctx = SSL_CTX_new(TLS_method())) == NULL)
+		errx(1, "SSL_CTX_new");
+	if (!SSL_CTX_set1_groups_list(ssl_ctx, "X25519:P-256"))
+		errx(1, "SSL_CTX_set1_groups_list");
+	if ((ssl = SSL_new(ssl_ctx)) == NULL)
+		errx(1, "SSL_new");
+	SSL_set_connect_state(ssl);
+
+	if (!tls1_get_key_share_group(ssl, &group_id) || group_id != 29) {
+		fprintf(stderr, "FAIL: default key share group %u, "
+		    "want 29\n", group_id);
+		goto failure;
+	}
+	if (!SSL_set_key_share_group(ssl, NID_X9_62_prime256v1)) {
+		fprintf(stderr, "FAIL: SSL_set_key_share_group\n");
+		goto failure;
+	}
+	if (!tls1_get_key_share_group(ssl, &group_id) || group_id != 23) {
+		fprintf(stderr, "FAIL: explicit key share group %u, "
+		    "want 23\n", group_id);
+		goto failure;
+	}
+
+	/* A group that is not in the supported groups list is ignored. */
+	if (!SSL_set_key_share_group(ssl, NID_secp384r1)) {
+		fprintf(stderr, "FAIL: SSL_set_key_share_group\n");
+		goto failure;
+	}
+	if (!tls1_get_key_share_group(ssl, &group_id) || group_id != 29) {
+		fprintf(stderr, "FAIL: unsupported key share group %u, "
+		    "want 29\n", group_id);
+		goto failure;
+	}
+
+	if (SSL_set_key_share_group(ssl, NID_sha256)) {
+		fprintf(stderr, "FAIL: SSL_set_key_share_group succeeded "
+		    "with a non-group NID\n");
+		goto failure;
+	}
+	if (!SSL_set_key_share_group(ssl, NID_undef)) {
+		fprintf(stderr, "FAIL: SSL_set_key_share_group(NID_undef)\n");
+		goto failure;
+	}
+	if (!tls1_get_key_share_group(ssl, &group_id) || group_id != 29) {
+		fprintf(stderr, "FAIL: cleared key share group %u, "
+		    "want 29\n", group_id);
+		goto failure;
+	}
+
+	if (SSL_get_negotiated_group(ssl) != NID_undef) {
+		fprintf(stderr, "FAIL: negotiated group before handshake\n");
+		goto failure;
+	}
+
+	failed = 0;
+
+ failure:
+	SSL_free(ssl);
+	SSL_CTX_free(ssl_ctx);
+
+	return failed;
+}
+
+static volatile sig_atomic_t benchmark_stop;
+
+static void
+benchmark_sig_alarm(int sig)
+{
+	benchmark_stop = 1;
+}
+
+/*
+ * Measure the cost of producing a key share - for the client this is the
+ * generation of the key share, while for the server it also includes
+ * processing of the client's key share.
+ */
+static void
+benchmark_key_share(const char *desc, uint16_t group_id, int server,
+    int seconds)
+{
+	struct tls_key_share *client, *ks;
+	struct timespec start, end, duration;
+	uint8_t *client_public = NULL, *public = NULL;
+	size_t client_public_len = 0, public_len;
+	long shares = 0;
+	double secs;
+	int decode_error;
+
+	if ((client = tls_key_share_new(group_id)) == NULL)
+		errx(1, "client key share");
+	if (!tls_key_share_generate(client))
+		errx(1, "client generate");
+	if (!key_share_public(client, &client_public, &client_public_len))
+		errx(1, "client public");
+
+	signal(SIGALRM, benchmark_sig_alarm);
+	benchmark_stop = 0;
+	alarm(seconds);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	while (!benchmark_stop) {
+		if ((ks = tls_key_share_new(group_id)) == NULL)
+			errx(1, "key share");
+		if (server && !key_share_peer_public(ks, client_public,
+		    client_public_len, &decode_error))
+			errx(1, "peer public");
+		if (!tls_key_share_generate(ks))
+			errx(1, "generate");
+		if (!key_share_public(ks, &public, &public_len))
+			errx(1, "public");
+		free(public);
+		public = NULL;
+		tls_key_share_free(ks);
+		shares++;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	timespecsub(&end, &start, &duration);
+	secs = duration.tv_sec + duration.tv_nsec / 1000000000.0;
+
+	fprintf(stderr, "%s: %ld key shares in %f seconds, %.1f key shares "
+	    "per second\n", desc, shares, secs, shares / secs);
+
+	tls_key_share_free(client);
+	free(client_public);
+}
+
+static void
+benchmark_key_shares(int seconds)
+{
+	benchmark_key_share("X25519 client", 29, 0, seconds);
+	benchmark_key_share("X25519 server", 29, 1, seconds);
+	benchmark_key_share("X25519MLKEM768 client", 4588, 0, seconds);
+	benchmark_key_share("X25519MLKEM768 server", 4588, 1, seconds);
+}
+
+int
+main(int argc, char **argv)
+{
+	int benchmark = 0, failed = 0;
+
+	if (argc == 3 && strcmp(argv[1], "--benchmark") == 0) {
+		benchmark = 1;
+		argc--;
+		argv++;
+	}
+	if (argc != 2) {
+		fprintf(stderr, "usage: keysharetest [--benchmark] certsdir\n");
+		exit(1);
+	}
+	certs_dir = argv[1];
+
+	failed |= test_key_shares();
+	failed |= test_hybrid_peer_public();
+	failed |= test_handshakes();
+	failed |= test_group_cache();
+	failed |= test_key_share_group();
+
+	if (benchmark && !failed)
+		benchmark_key_shares(5);
+
+	return failed;
+}
@@ -0,0 +1,527 @@
+/*	$OpenBSD$ */
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <err.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <openssl/bio.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/rsa.h>
+#include <openssl/ssl.h>
+
+#include "ssl_local.h"
+
+static const char *certs_dir;
+
+#define KEY_OP_SYNC	0
+#define KEY_OP_ASYNC	1
+#define KEY_OP_FAIL	2
+
+struct key_op {
+	EVP_PKEY *pkey;
+	int mode;
+
+	uint16_t sigalg;
+	uint8_t *in;
+	size_t in_len;
+
+	int pending;
+	uint8_t *sig;
+	size_t sig_len;
+
+	int sign_calls;
+	int complete_calls;
+};
+
+static const struct key_op_sigalg {
+	uint16_t value;
+	const EVP_MD *(*md)(void);
+	int pss;
+} key_op_sigalgs[] = {
+	{ 0x0201, EVP_sha1, 0 },
+	{ 0x0203, EVP_sha1, 0 },
+	{ 0x0401, EVP_sha256, 0 },
+	{ 0x0403, EVP_sha256, 0 },
+	{ 0x0501, EVP_sha384, 0 },
+	{ 0x0503, EVP_sha384, 0 },
+	{ 0x0601, EVP_sha512, 0 },
+	{ 0x0603, EVP_sha512, 0 },
+	{ 0x0804, EVP_sha256, 1 },
+	{ 0x0805, EVP_sha384, 1 },
+	{ 0x0806, EVP_sha512, 1 },
+};
+
+#define N_KEY_OP_SIGALGS \
+    (sizeof(key_op_sigalgs) / sizeof(key_op_sigalgs[0]))
+
+/*
+ * Produce the signature that the private key method has been asked for, as
+ * an application would on a worker thread or hardware token.
+ */
+static int
+key_op_perform(struct key_op *op)
+{
+	const struct key_op_sigalg *sigalg = NULL;
+	EVP_MD_CTX *mdctx = NULL;
+	EVP_PKEY_CTX *pctx;
+	size_t i;
+	int ret = 0;
+
+	for (i = 0; i < N_KEY_OP_SIGALGS; i++) {
+		if (key_op_sigalgs[i].value == op->sigalg) {
+			sigalg = &key_op_sigalgs[i];
+			break;
+		}
+	}
+	if (sigalg == NULL) {
+		fprintf(stderr, "FAIL: unexpected signature algorithm 0x%04x\n",
+		    op->sigalg);
+		goto err;
+	}
+
+	if ((mdctx = EVP_MD_CTX_new()) == NULL)
+		errx(1, "EVP_MD_CTX_new");
+	if (!EVP_DigestSignInit(mdctx, &pctx, sigalg->md(), NULL, op->pkey))
+		goto err;
+	if (sigalg->pss) {
+		if (!EVP_PKEY_CTX_set_rsa_padding(pctx, RSA_PKCS1_PSS_PADDING))
+			goto err;
+		if (!EVP_PKEY_CTX_set_rsa_pss_saltlen(pctx, -1))
+			goto err;
+	}
+	if (!EVP_DigestSignUpdate(mdctx, op->in, op->in_len))
+		goto err;
+	if (EVP_DigestSignFinal(mdctx, NULL, &op->sig_len) <= 0)
+		goto err;
+	free(op->sig);
+	if ((op->sig = calloc(1, op->sig_len)) == NULL)
+		errx(1, "calloc");
+	if (EVP_DigestSignFinal(mdctx, op->sig, &op->sig_len) <= 0)
+		goto err;
+
+	op->pending = 0;
+
+	ret = 1;
+
+ err:
+	EVP_MD_CTX_free(mdctx);
+
+	return ret;
+}
+
+static enum ssl_private_key_result_t
+key_op_result(struct key_op *op, uint8_t *out, size_t *out_len, size_t max_out)
+{
+	if (op->sig_len > max_out) {
+		fprintf(stderr, "FAIL: signature length %zu exceeds %zu\n",
+		    op->sig_len, max_out);
+		return ssl_private_key_failure;
+	}
+	memcpy(out, op->sig, op->sig_len);
+	*out_len = op->sig_len;
+
+	return ssl_private_key_success;
+}
+
+static enum ssl_private_key_result_t
+key_method_sign(SSL *ssl, uint8_t *out, size_t *out_len, size_t max_out,
+    uint16_t signature_algorithm, const uint8_t *in, size_t in_len)
+{
+	struct key_op *op;
+
+	if ((op = SSL_get_app_data(ssl)) == NULL)
+		return ssl_private_key_failure;
+
+	op->sign_calls++;
+
+	if (op->mode == KEY_OP_FAIL)
+		return ssl_private_key_failure;
+
+	op->sigalg = signature_algorithm;
+	free(op->in);
+	if ((op->in = malloc(in_len)) == NULL)
+		errx(1, "malloc");
+	memcpy(op->in, in, in_len);
+	op->in_len = in_len;
+
+	if (op->mode == KEY_OP_ASYNC) {
+		op->pending = 1;
+		return ssl_private_key_retry;
+	}
+
+	if (!key_op_perform(op))
+		return ssl_private_key_failure;
+
+	return key_op_result(op, out, out_len, max_out);
+}
+
+static enum ssl_private_key_result_t
+key_method_complete(SSL *ssl, uint8_t *out, size_t *out_len, size_t max_out)
+{
+	struct key_op *op;
+
+	if ((op = SSL_get_app_data(ssl)) == NULL)
+		return ssl_private_key_failure;
+
+	op->complete_calls++;
+
+	if (op->pending)
+		return ssl_private_key_retry;
+
+	return key_op_result(op, out, out_len, max_out);
+}
+
+static const SSL_PRIVATE_KEY_METHOD key_method = {
+	.sign = key_method_sign,
+	.complete = key_method_complete,
+};
+
+static EVP_PKEY *
+private_key_load(const char *key_name)
+{
+	char key_file[PATH_MAX];
+	EVP_PKEY *pkey;
+	FILE *fp;
+
+	if (snprintf(key_file, sizeof(key_file), "%s/%s", certs_dir,
+	    key_name) >= (int)sizeof(key_file))
+		errx(1, "key path too long");
+	if ((fp = fopen(key_file, "r")) == NULL)
+		err(1, "failed to open %s", key_file);
+	if ((pkey = PEM_read_PrivateKey(fp, NULL, NULL, NULL)) == NULL)
+		errx(1, "failed to read private key from %s", key_file);
+	fclose(fp);
+
+	return pkey;
+}
+
+static SSL_CTX *
+server_ctx_new(const char *chain_name)
+{
+	char cert_file[PATH_MAX];
+	SSL_CTX *ssl_ctx;
+	EVP_PKEY *pubkey;
+	X509 *x509;
+	FILE *fp;
+
+	if ((ssl_ctx = SSL_CTX_new(TLS_method())) == NULL)
+		errx(1, "server context");
+
+	if (snprintf(cert_file, sizeof(cert_file), "%s/%s", certs_dir,
+	    chain_name) >= (int)sizeof(cert_file))
+		errx(1, "certificate path too long");
+	if (SSL_CTX_use_certificate_chain_file(ssl_ctx, cert_file) != 1)
+		errx(1, "failed to load server certificate");
+
+	/* The private key stays with the private key method. */
+	if ((fp = fopen(cert_file, "r")) == NULL)
+		err(1, "failed to open %s", cert_file);
+	if ((x509 = PEM_read_X509(fp, NULL, NULL, NULL)) == NULL)
+		errx(1, "failed to read certificate from %s", cert_file);
+	fclose(fp);
+	if ((pubkey = X509_get_pubkey(x509)) == NULL)
+		errx(1, "failed to get server public key");
+	if (SSL_CTX_use_PrivateKey(ssl_ctx, pubkey) != 1)
+		errx(1, "failed to use server public key");
+	EVP_PKEY_free(pubkey);
+	X509_free(x509);
+
+	SSL_CTX_set_dh_auto(ssl_ctx, 1);
+	SSL_CTX_set_private_key_method(ssl_ctx, &key_method);
+
+	return ssl_ctx;
+}
+
+static SSL_CTX *
+client_ctx_new(void)
+{
+	char ca_file[PATH_MAX];
+	SSL_CTX *ssl_ctx;
+
+	if ((ssl_ctx = SSL_CTX_new(TLS_method())) == NULL)
+		errx(1, "client context");
+
+	if (snprintf(ca_file, sizeof(ca_file), "%s/ca-root-rsa.pem",
+	    certs_dir) >= (int)sizeof(ca_file))
+		errx(1, "CA path too long");
+	if (SSL_CTX_load_verify_locations(ssl_ctx, ca_file, NULL) != 1)
+		errx(1, "failed to load RSA CA");
+	if (snprintf(ca_file, sizeof(ca_file), "%s/ca-root-ecdsa.pem",
+	    certs_dir) >= (int)sizeof(ca_file))
+		errx(1, "CA path too long");
+	if (SSL_CTX_load_verify_locations(ssl_ctx, ca_file, NULL) != 1)
+		errx(1, "failed to load ECDSA CA");
+	SSL_CTX_set_verify(ssl_ctx, SSL_VERIFY_PEER, NULL);
+
+	return ssl_ctx;
+}
+
+struct key_method_test {
+	const char *desc;
+	const char *chain;
+	const char *key;
+	uint16_t max_version;
+	const char *ciphers;
+	int mode;
+	int want_failure;
+	int want_reason;
+};
+
+static const struct key_method_test key_method_tests[] = {
+	{
+		.desc = "TLSv1.3 RSA asynchronous",
+		.chain = "server1-rsa-chain.pem",
+		.key = "server1-rsa.pem",
+		.max_version = TLS1_3_VERSION,
+		.mode = KEY_OP_ASYNC,
+	},
+	{
+		.desc = "TLSv1.3 ECDSA asynchronous",
+		.chain = "server1-ecdsa-chain.pem",
+		.key = "server1-ecdsa.pem",
+		.max_version = TLS1_3_VERSION,
+		.mode = KEY_OP_ASYNC,
+	},
+	{
+		.desc = "TLSv1.3 RSA synchronous",
+		.chain = "server1-rsa-chain.pem",
+		.key = "server1-rsa.pem",
+		.max_version = TLS1_3_VERSION,
+		.mode = KEY_OP_SYNC,
+	},
+	{
+		.desc = "TLSv1.2 ECDHE-RSA asynchronous",
+		.chain = "server1-rsa-chain.pem",
+		.key = "server1-rsa.pem",
+		.max_version = TLS1_2_VERSION,
+		.ciphers = "ECDHE-RSA-AES128-GCM-SHA256",
+		.mode = KEY_OP_ASYNC,
+	},
+	{
+		.desc = "TLSv1.2 DHE-RSA asynchronous",
+		.chain = "server1-rsa-chain.pem",
+		.key = "server1-rsa.pem",
+		.max_version = TLS1_2_VERSION,
+		.ciphers = "DHE-RSA-AES128-GCM-SHA256",
+		.mode = KEY_OP_ASYNC,
+	},
+	{
+		.desc = "TLSv1.2 ECDHE-ECDSA asynchronous",
+		.chain = "server1-ecdsa-chain.pem",
+		.key = "server1-ecdsa.pem",
+		.max_version = TLS1_2_VERSION,
+		.ciphers = "ECDHE-ECDSA-AES128-GCM-SHA256",
+		.mode = KEY_OP_ASYNC,
+	},
+	{
+		.desc = "TLSv1.2 ECDHE-RSA synchronous",
+		.chain = "server1-rsa-chain.pem",
+		.key = "server1-rsa.pem",
+		.max_version = TLS1_2_VERSION,
+		.ciphers = "ECDHE-RSA-AES128-GCM-SHA256",
+		.mode = KEY_OP_SYNC,
+	},
+	{
+		.desc = "TLSv1.3 signing failure",
+		.chain = "server1-rsa-chain.pem",
+		.key = "server1-rsa.pem",
+		.max_version = TLS1_3_VERSION,
+		.mode = KEY_OP_FAIL,
+		.want_failure = 1,
+		.want_reason = SSL_R_PRIVATE_KEY_OPERATION_FAILED,
+	},
+	{
+		.desc = "TLSv1.2 signing failure",
+		.chain = "server1-rsa-chain.pem",
+		.key = "server1-rsa.pem",
+		.max_version = TLS1_2_VERSION,
+		.ciphers = "ECDHE-RSA-AES128-GCM-SHA256",
+		.mode = KEY_OP_FAIL,
+		.want_failure = 1,
+		.want_reason = SSL_R_PRIVATE_KEY_OPERATION_FAILED,
+	},
+	{
+		.desc = "TLSv1.2 RSA key exchange",
+		.chain = "server1-rsa-chain.pem",
+		.key = "server1-rsa.pem",
+		.max_version = TLS1_2_VERSION,
+		.ciphers = "AES128-GCM-SHA256",
+		.mode = KEY_OP_ASYNC,
+		.want_failure = 1,
+		.want_reason = SSL_R_NO_SHARED_CIPHER,
+	},
+};
+
+#define N_KEY_METHOD_TESTS \
+    (sizeof(key_method_tests) / sizeof(key_method_tests[0]))
+
+static int
+key_method_test(const struct key_method_test *kmt)
+{
+	SSL_CTX *server_ctx = NULL, *client_ctx = NULL;
+	SSL *client = NULL, *server = NULL;
+	BIO *client_bio, *server_bio;
+	int client_ret, server_ret;
+	struct key_op op;
+	unsigned long err;
+	int retries = 0;
+	int failed = 1;
+	int i;
+
+	memset(&op, 0, sizeof(op));
+
+	op.pkey = private_key_load(kmt->key);
+	op.mode = kmt->mode;
+
+	server_ctx = server_ctx_new(kmt->chain);
+	client_ctx = client_ctx_new();
+
+	if (!BIO_new_bio_pair(&client_bio, 0, &server_bio, 0))
+		errx(1, "BIO pair");
+
+	if ((client = SSL_new(client_ctx)) == NULL)
+		errx(1, "client SSL");
+	if ((server = SSL_new(server_ctx)) == NULL)
+		errx(1, "server SSL");
+
+	SSL_set_bio(client, client_bio, client_bio);
+	SSL_set_bio(server, server_bio, server_bio);
+
+	if (!SSL_set_max_proto_version(client, kmt->max_version))
+		errx(1, "SSL_set_max_proto_version");
+	if (kmt->ciphers != NULL &&
+	    !SSL_set_cipher_list(client, kmt->ciphers))
+		errx(1, "SSL_set_cipher_list");
+
+	SSL_set_app_data(server, &op);
+
+	SSL_set_connect_state(client);
+	SSL_set_accept_state(server);
+
+	client_ret = server_ret = 0;
+	for (i = 0; i < 100; i++) {
+		if (client_ret != 1)
+			client_ret = SSL_do_handshake(client);
+		if (server_ret != 1) {
+			server_ret = SSL_do_handshake(server);
+			if (server_ret != 1 && SSL_get_error(server,
+			    server_ret) == SSL_ERROR_WANT_PRIVATE_KEY_OPERATION) {
+				if (!SSL_want_private_key_operation(server)) {
+					fprintf(stderr, "FAIL: %s: not waiting "
+					    "for private key operation\n",
+					    kmt->desc);
+					goto failure;
+				}
+				/* Complete the signature every other retry. */
+				if (retries++ % 2 == 1 && !key_op_perform(&op))
+					goto failure;
+			}
+		}
+		if (client_ret == 1 && server_ret == 1)
+			break;
+		if (client_ret != 1 && SSL_get_error(client, client_ret) ==
+		    SSL_ERROR_SSL)
+			break;
+		if (server_ret != 1 && SSL_get_error(server, server_ret) ==
+		    SSL_ERROR_SSL)
+			break;
+	}
+
+	if (kmt->want_failure) {
+		if (server_ret == 1) {
+			fprintf(stderr, "FAIL: %s: handshake succeeded\n",
+			    kmt->desc);
+			goto failure;
+		}
+		while ((err = ERR_get_error()) != 0) {
+			if (ERR_GET_REASON(err) == kmt->want_reason)
+				break;
+		}
+		if (err == 0) {
+			fprintf(stderr, "FAIL: %s: did not get error reason "
+			    "%d\n", kmt->desc, kmt->want_reason);
+			goto failure;
+		}
+		ERR_clear_error();
+		failed = 0;
+		goto failure;
+	}
+
+	if (client_ret != 1 || server_ret != 1) {
+		fprintf(stderr, "FAIL: %s: handshake failed (%d, %d)\n",
+		    kmt->desc, client_ret, server_ret);
+		ERR_print_errors_fp(stderr);
+		goto failure;
+	}
+	if (SSL_get_verify_result(client) != X509_V_OK) {
+		fprintf(stderr, "FAIL: %s: verify result %ld\n", kmt->desc,
+		    SSL_get_verify_result(client));
+		goto failure;
+	}
+	if (op.sign_calls != 1) {
+		fprintf(stderr, "FAIL: %s: sign called %d times\n", kmt->desc,
+		    op.sign_calls);
+		goto failure;
+	}
+	if (kmt->mode == KEY_OP_ASYNC && (retries != 2 ||
+	    op.complete_calls != 2)) {
+		fprintf(stderr, "FAIL: %s: got %d retries and %d completions, "
+		    "want 2 and 2\n", kmt->desc, retries, op.complete_calls);
+		goto failure;
+	}
+	if (kmt->mode == KEY_OP_SYNC && (retries != 0 ||
+	    op.complete_calls != 0)) {
+		fprintf(stderr, "FAIL: %s: got %d retries and %d completions, "
+		    "want none\n", kmt->desc, retries, op.complete_calls);
+		goto failure;
+	}
+
+	failed = 0;
+
+ failure:
+	SSL_free(client);
+	SSL_free(server);
+	SSL_CTX_free(client_ctx);
+	SSL_CTX_free(server_ctx);
+	EVP_PKEY_free(op.pkey);
+	free(op.in);
+	free(op.sig);
+
+	return failed;
+}
+
+int
+main(int argc, char **argv)
+{
+	size_t i;
+	int failed = 0;
+
+	if (argc != 2) {
+		fprintf(stderr, "usage: %s certsdir\n", argv[0]);
+		exit(1);
+	}
+	certs_dir = argv[1];
+
+	for (i = 0; i < N_KEY_METHOD_TESTS; i++)
+		failed |= key_method_test(&key_method_tests[i]);
+
+	return failed;
+}
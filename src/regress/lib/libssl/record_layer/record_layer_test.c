@@ -15,8 +15,15 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <sys/time.h>
+
 #include <err.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
 
 #include "ssl_local.h"
 #include "tls13_internal.h"
@@ -294,13 +301,386 @@ test_seq_num_tls13(void)
 	return failed;
 }
 
+static volatile sig_atomic_t benchmark_stop;
+
+static void
+benchmark_sig_alarm(int sig)
+{
+	benchmark_stop = 1;
+}
+
+static void
+benchmark_start(struct timespec *start, int seconds)
+{
+	signal(SIGALRM, benchmark_sig_alarm);
+	benchmark_stop = 0;
+	alarm(seconds);
+
+	clock_gettime(CLOCK_MONOTONIC, start);
+}
+
+static void
+benchmark_report(const char *desc, size_t record_size,
+    const struct timespec *start, long records)
+{
+	struct timespec end, duration;
+	double secs;
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	timespecsub(&end, start, &duration);
+	secs = duration.tv_sec + duration.tv_nsec / 1000000000.0;
+
+	fprintf(stderr, "%-44s %6zu: %10.1f records/s, %8.2f MB/s\n", desc,
+	    record_size, records / secs, records * record_size / secs / 1e6);
+}
+
+#define BENCHMARK_MAX_RECORD_SIZE	16384
+
+static const size_t benchmark_record_sizes[] = {
+	256, 1024, BENCHMARK_MAX_RECORD_SIZE,
+};
+
+#define N_BENCHMARK_RECORD_SIZES \
+    (sizeof(benchmark_record_sizes) / sizeof(benchmark_record_sizes[0]))
+
+struct benchmark_tls12_suite {
+	const char *desc;
+	const EVP_AEAD *(*aead)(void);
+	const EVP_CIPHER *(*cipher)(void);
+	const EVP_MD *(*mac_hash)(void);
+	size_t mac_key_len;
+	size_t key_len;
+	size_t iv_len;
+};
+
+static const struct benchmark_tls12_suite benchmark_tls12_suites[] = {
+	{
+		.desc = "AES-128-GCM",
+		.aead = EVP_aead_aes_128_gcm,
+		.key_len = 16,
+		.iv_len = 4,
+	},
+	{
+		.desc = "AES-256-GCM",
+		.aead = EVP_aead_aes_256_gcm,
+		.key_len = 32,
+		.iv_len = 4,
+	},
+	{
+		.desc = "ChaCha20-Poly1305",
+		.aead = EVP_aead_chacha20_poly1305,
+		.key_len = 32,
+		.iv_len = 12,
+	},
+	{
+		.desc = "AES-128-CBC-SHA1",
+		.cipher = EVP_aes_128_cbc,
+		.mac_hash = EVP_sha1,
+		.mac_key_len = 20,
+		.key_len = 16,
+		.iv_len = 16,
+	},
+};
+
+#define N_BENCHMARK_TLS12_SUITES \
+    (sizeof(benchmark_tls12_suites) / sizeof(benchmark_tls12_suites[0]))
+
+static struct tls12_record_layer *
+benchmark_tls12_record_layer_new(const struct benchmark_tls12_suite *suite,
+    int is_write)
+{
+	static const uint8_t key_material[64];
+	struct tls12_record_layer *rl;
+	CBS mac_key, key, iv;
+
+	if ((rl = tls12_record_layer_new()) == NULL)
+		errx(1, "tls12_record_layer_new");
+
+	tls12_record_layer_set_version(rl, TLS1_2_VERSION);
+	if (suite->aead != NULL)
+		tls12_record_layer_set_aead(rl, suite->aead());
+	else
+		tls12_record_layer_set_cipher_hash(rl, suite->cipher(),
+		    EVP_sha256(), suite->mac_hash());
+
+	CBS_init(&mac_key, key_material, suite->mac_key_len);
+	CBS_init(&key, key_material, suite->key_len);
+	CBS_init(&iv, key_material, suite->iv_len);
+
+	if (is_write) {
+		if (!tls12_record_layer_change_write_cipher_state(rl,
+		    &mac_key, &key, &iv))
+			errx(1, "%s: failed to change write cipher state",
+			    suite->desc);
+	} else {
+		if (!tls12_record_layer_change_read_cipher_state(rl,
+		    &mac_key, &key, &iv))
+			errx(1, "%s: failed to change read cipher state",
+			    suite->desc);
+	}
+
+	return rl;
+}
+
+/*
+ * Measure TLSv1.2 record protection, either sealing records alone or
+ * sealing records and opening them again with a second record layer.
+ */
+static void
+benchmark_tls12_record(const struct benchmark_tls12_suite *suite,
+    size_t record_size, int open, int seconds)
+{
+	struct tls12_record_layer *wrl, *rrl = NULL;
+	struct tls_content *content;
+	struct timespec start;
+	uint8_t *data, *rec;
+	size_t rec_len;
+	char desc[64];
+	long records = 0;
+	CBB cbb;
+
+	if ((data = calloc(1, BENCHMARK_MAX_RECORD_SIZE)) == NULL)
+		err(1, NULL);
+	if ((rec = calloc(1, SSL3_RT_MAX_PACKET_SIZE)) == NULL)
+		err(1, NULL);
+	if ((content = tls_content_new()) == NULL)
+		err(1, NULL);
+
+	wrl = benchmark_tls12_record_layer_new(suite, 1);
+	if (open)
+		rrl = benchmark_tls12_record_layer_new(suite, 0);
+
+	benchmark_start(&start, seconds);
+
+	while (!benchmark_stop) {
+		if (!CBB_init_fixed(&cbb, rec, SSL3_RT_MAX_PACKET_SIZE))
+			errx(1, "CBB_init_fixed");
+		if (!tls12_record_layer_seal_record(wrl,
+		    SSL3_RT_APPLICATION_DATA, data, record_size, &cbb))
+			errx(1, "%s: failed to seal record", suite->desc);
+		if (!CBB_finish(&cbb, NULL, &rec_len))
+			errx(1, "CBB_finish");
+		if (open) {
+			if (!tls12_record_layer_open_record(rrl, rec, rec_len,
+			    content))
+				errx(1, "%s: failed to open record",
+				    suite->desc);
+			if (tls_content_remaining(content) != record_size)
+				errx(1, "%s: opened record has wrong length",
+				    suite->desc);
+		}
+		records++;
+	}
+
+	snprintf(desc, sizeof(desc), "TLSv1.2 %s %s", suite->desc,
+	    open ? "seal+open" : "seal");
+	benchmark_report(desc, record_size, &start, records);
+
+	tls12_record_layer_free(wrl);
+	tls12_record_layer_free(rrl);
+	tls_content_free(content);
+	free(rec);
+	free(data);
+}
+
+struct benchmark_tls13_suite {
+	const char *desc;
+	const EVP_AEAD *(*aead)(void);
+	const EVP_MD *(*hash)(void);
+};
+
+static const struct benchmark_tls13_suite benchmark_tls13_suites[] = {
+	{
+		.desc = "AES-128-GCM-SHA256",
+		.aead = EVP_aead_aes_128_gcm,
+		.hash = EVP_sha256,
+	},
+	{
+		.desc = "AES-256-GCM-SHA384",
+		.aead = EVP_aead_aes_256_gcm,
+		.hash = EVP_sha384,
+	},
+	{
+		.desc = "ChaCha20-Poly1305-SHA256",
+		.aead = EVP_aead_chacha20_poly1305,
+		.hash = EVP_sha256,
+	},
+};
+
+#define N_BENCHMARK_TLS13_SUITES \
+    (sizeof(benchmark_tls13_suites) / sizeof(benchmark_tls13_suites[0]))
+
+/*
+ * In-memory wire used to connect two TLSv1.3 record layers - if no reader
+ * is attached, written records are discarded.
+ */
+struct benchmark_wire {
+	uint8_t buf[SSL3_RT_MAX_ENCRYPTED_LENGTH * 2];
+	size_t len;
+	size_t off;
+	int discard;
+};
+
+static ssize_t
+benchmark_wire_read(void *buf, size_t n, void *arg)
+{
+	struct benchmark_wire *wire = arg;
+
+	if (wire->off == wire->len)
+		return TLS13_IO_WANT_POLLIN;
+	if (n > wire->len - wire->off)
+		n = wire->len - wire->off;
+
+	memcpy(buf, &wire->buf[wire->off], n);
+	wire->off += n;
+
+	return n;
+}
+
+static ssize_t
+benchmark_wire_write(const void *buf, size_t n, void *arg)
+{
+	struct benchmark_wire *wire = arg;
+
+	if (wire->discard)
+		return n;
+
+	if (wire->off == wire->len)
+		wire->off = wire->len = 0;
+	if (n > sizeof(wire->buf) - wire->len)
+		return TLS13_IO_WANT_POLLOUT;
+
+	memcpy(&wire->buf[wire->len], buf, n);
+	wire->len += n;
+
+	return n;
+}
+
+static const struct tls13_record_layer_callbacks benchmark_wire_callbacks = {
+	.wire_read = benchmark_wire_read,
+	.wire_write = benchmark_wire_write,
+};
+
+static struct tls13_record_layer *
+benchmark_tls13_record_layer_new(const struct benchmark_tls13_suite *suite,
+    struct benchmark_wire *wire, int is_write)
+{
+	static uint8_t traffic_secret[EVP_MAX_MD_SIZE];
+	struct tls13_secret secret;
+	struct tls13_record_layer *rl;
+
+	if ((rl = tls13_record_layer_new(&benchmark_wire_callbacks,
+	    wire)) == NULL)
+		errx(1, "tls13_record_layer_new");
+
+	tls13_record_layer_set_aead(rl, suite->aead());
+	tls13_record_layer_set_hash(rl, suite->hash());
+
+	secret.data = traffic_secret;
+	secret.len = EVP_MD_size(suite->hash());
+
+	if (is_write) {
+		if (!tls13_record_layer_set_write_traffic_key(rl, &secret,
+		    ssl_encryption_application))
+			errx(1, "%s: failed to set write traffic key",
+			    suite->desc);
+	} else {
+		if (!tls13_record_layer_set_read_traffic_key(rl, &secret,
+		    ssl_encryption_application))
+			errx(1, "%s: failed to set read traffic key",
+			    suite->desc);
+	}
+	tls13_record_layer_handshake_completed(rl);
+
+	return rl;
+}
+
+/*
+ * Measure TLSv1.3 record protection via the application data interface,
+ * which includes record framing and padding handling.
+ */
+static void
+benchmark_tls13_record(const struct benchmark_tls13_suite *suite,
+    size_t record_size, int open, int seconds)
+{
+	struct tls13_record_layer *wrl, *rrl = NULL;
+	struct benchmark_wire *wire;
+	struct timespec start;
+	uint8_t *data;
+	char desc[64];
+	long records = 0;
+	ssize_t ret;
+
+	if ((data = calloc(1, BENCHMARK_MAX_RECORD_SIZE)) == NULL)
+		err(1, NULL);
+	if ((wire = calloc(1, sizeof(*wire))) == NULL)
+		err(1, NULL);
+	wire->discard = !open;
+
+	wrl = benchmark_tls13_record_layer_new(suite, wire, 1);
+	if (open)
+		rrl = benchmark_tls13_record_layer_new(suite, wire, 0);
+
+	benchmark_start(&start, seconds);
+
+	while (!benchmark_stop) {
+		if ((ret = tls13_write_application_data(wrl, data,
+		    record_size)) != (ssize_t)record_size)
+			errx(1, "%s: write returned %zd", suite->desc, ret);
+		if (open) {
+			if ((ret = tls13_read_application_data(rrl, data,
+			    BENCHMARK_MAX_RECORD_SIZE)) != (ssize_t)record_size)
+				errx(1, "%s: read returned %zd", suite->desc,
+				    ret);
+		}
+		records++;
+	}
+
+	snprintf(desc, sizeof(desc), "TLSv1.3 %s %s", suite->desc,
+	    open ? "seal+open" : "seal");
+	benchmark_report(desc, record_size, &start, records);
+
+	tls13_record_layer_free(wrl);
+	tls13_record_layer_free(rrl);
+	free(wire);
+	free(data);
+}
+
+static void
+benchmark_record_layer(int seconds)
+{
+	size_t i, j;
+	int open;
+
+	for (open = 0; open <= 1; open++) {
+		for (i = 0; i < N_BENCHMARK_TLS12_SUITES; i++) {
+			for (j = 0; j < N_BENCHMARK_RECORD_SIZES; j++)
+				benchmark_tls12_record(
+				    &benchmark_tls12_suites[i],
+				    benchmark_record_sizes[j], open, seconds);
+		}
+		for (i = 0; i < N_BENCHMARK_TLS13_SUITES; i++) {
+			for (j = 0; j < N_BENCHMARK_RECORD_SIZES; j++)
+				benchmark_tls13_record(
+				    &benchmark_tls13_suites[i],
+				    benchmark_record_sizes[j], open, seconds);
+		}
+	}
+}
+
 int
 main(int argc, char **argv)
 {
-	int failed = 0;
+	int benchmark = 0, failed = 0;
+
+	if (argc == 2 && strcmp(argv[1], "--benchmark") == 0)
+		benchmark = 1;
 
 	failed |= test_seq_num_tls12();
 	failed |= test_seq_num_tls13();
 
+	if (benchmark && !failed)
+		benchmark_record_layer(1);
+
 	return failed;
 }
@@ -0,0 +1,520 @@
+/*	$OpenBSD$ */
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <sys/time.h>
+
+#include <dlfcn.h>
+#include <err.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <openssl/err.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+
+#include "ssl_local.h"
+
+static const char *certs_dir;
+
+/*
+ * Count calls to the allocator, so that the benchmark can report the number
+ * of allocations performed per SSL_new() and SSL_free().
+ */
+static void *(*real_malloc)(size_t);
+static void *(*real_calloc)(size_t, size_t);
+static void *(*real_realloc)(void *, size_t);
+
+static volatile unsigned long malloc_calls;
+
+static void
+malloc_count_init(void)
+{
+	if ((real_malloc = dlsym(RTLD_NEXT, "malloc")) == NULL)
+		errx(1, "dlsym malloc");
+	if ((real_calloc = dlsym(RTLD_NEXT, "calloc")) == NULL)
+		errx(1, "dlsym calloc");
+	if ((real_realloc = dlsym(RTLD_NEXT, "realloc")) == NULL)
+		errx(1, "dlsym realloc");
+}
+
+void *
+malloc(size_t size)
+{
+	if (real_malloc == NULL)
+		malloc_count_init();
+	malloc_calls++;
+	return real_malloc(size);
+}
+
+void *
+calloc(size_t nmemb, size_t size)
+{
+	if (real_calloc == NULL)
+		malloc_count_init();
+	malloc_calls++;
+	return real_calloc(nmemb, size);
+}
+
+void *
+realloc(void *ptr, size_t size)
+{
+	if (real_realloc == NULL)
+		malloc_count_init();
+	malloc_calls++;
+	return real_realloc(ptr, size);
+}
+
+static const uint8_t alpn_protos[] = {
+	0x02, 'h', '2',
+	0x08, 'h', 't', 't', 'p', '/', '1', '.', '1',
+};
+
+static void
+certs_path(char *buf, size_t buf_len, const char *name)
+{
+	if (snprintf(buf, buf_len, "%s/%s", certs_dir, name) >= (int)buf_len)
+		errx(1, "path too long");
+}
+
+static X509 *
+load_cert(const char *name)
+{
+	char path[PATH_MAX];
+	X509 *cert;
+	FILE *fp;
+
+	certs_path(path, sizeof(path), name);
+	if ((fp = fopen(path, "r")) == NULL)
+		err(1, "%s", path);
+	if ((cert = PEM_read_X509(fp, NULL, NULL, NULL)) == NULL)
+		errx(1, "failed to read certificate from %s", path);
+	fclose(fp);
+
+	return cert;
+}
+
+static SSL_CTX *
+server_ctx_new(void)
+{
+	char cert_file[PATH_MAX], key_file[PATH_MAX];
+	SSL_CTX *ssl_ctx;
+
+	certs_path(cert_file, sizeof(cert_file), "server1-rsa-chain.pem");
+	certs_path(key_file, sizeof(key_file), "server1-rsa.pem");
+
+	if ((ssl_ctx = SSL_CTX_new(TLS_method())) == NULL)
+		errx(1, "SSL_CTX_new");
+	if (SSL_CTX_use_certificate_chain_file(ssl_ctx, cert_file) != 1)
+		errx(1, "failed to load certificate chain");
+	if (SSL_CTX_use_PrivateKey_file(ssl_ctx, key_file,
+	    SSL_FILETYPE_PEM) != 1)
+		errx(1, "failed to load private key");
+	if (!SSL_CTX_set_dh_auto(ssl_ctx, 1))
+		errx(1, "SSL_CTX_set_dh_auto");
+	if (!SSL_CTX_set1_groups_list(ssl_ctx, "X25519:P-256:P-384"))
+		errx(1, "SSL_CTX_set1_groups_list");
+	if (SSL_CTX_set_alpn_protos(ssl_ctx, alpn_protos,
+	    sizeof(alpn_protos)) != 0)
+		errx(1, "SSL_CTX_set_alpn_protos");
+
+	return ssl_ctx;
+}
+
+static int
+test_ssl_new_cert(void)
+{
+	SSL *ssl = NULL, *ssl2 = NULL;
+	X509 *ctx_cert, *other_cert;
+	SSL_CTX *ssl_ctx;
+	int failed = 1;
+
+	ssl_ctx = server_ctx_new();
+	other_cert = load_cert("server2-rsa.pem");
+
+	if ((ctx_cert = SSL_CTX_get0_certificate(ssl_ctx)) == NULL)
+		errx(1, "SSL_CTX_get0_certificate");
+
+	if ((ssl = SSL_new(ssl_ctx)) == NULL)
+		errx(1, "SSL_new");
+	if (SSL_get_certificate(ssl) != ctx_cert) {
+		fprintf(stderr, "FAIL: SSL does not have the SSL_CTX "
+		    "certificate\n");
+		goto failure;
+	}
+	if (ssl->cert != ssl_ctx->cert) {
+		fprintf(stderr, "FAIL: SSL does not share the SSL_CTX "
+		    "SSL_CERT\n");
+		goto failure;
+	}
+
+	/* Changing the SSL must not change the SSL_CTX. */
+	SSL_set_security_level(ssl, 0);
+	if (ssl->cert == ssl_ctx->cert) {
+		fprintf(stderr, "FAIL: SSL still shares the SSL_CTX SSL_CERT "
+		    "after modification\n");
+		goto failure;
+	}
+	if (SSL_CTX_get_security_level(ssl_ctx) == 0) {
+		fprintf(stderr, "FAIL: SSL_CTX security level changed\n");
+		goto failure;
+	}
+	if (SSL_get_security_level(ssl) != 0) {
+		fprintf(stderr, "FAIL: SSL security level not changed\n");
+		goto failure;
+	}
+	if (SSL_use_certificate(ssl, other_cert) != 1) {
+		fprintf(stderr, "FAIL: SSL_use_certificate\n");
+		goto failure;
+	}
+	if (SSL_get_certificate(ssl) != other_cert) {
+		fprintf(stderr, "FAIL: SSL certificate not changed\n");
+		goto failure;
+	}
+	if (SSL_CTX_get0_certificate(ssl_ctx) != ctx_cert) {
+		fprintf(stderr, "FAIL: SSL_CTX certificate changed\n");
+		goto failure;
+	}
+
+	/* Changing the SSL_CTX must not change existing SSLs. */
+	if ((ssl2 = SSL_new(ssl_ctx)) == NULL)
+		errx(1, "SSL_new");
+	if (SSL_CTX_use_certificate(ssl_ctx, other_cert) != 1) {
+		fprintf(stderr, "FAIL: SSL_CTX_use_certificate\n");
+		goto failure;
+	}
+	if (SSL_get_certificate(ssl2) != ctx_cert) {
+		fprintf(stderr, "FAIL: SSL certificate changed with the "
+		    "SSL_CTX\n");
+		goto failure;
+	}
+
+	failed = 0;
+
+ failure:
+	SSL_free(ssl);
+	SSL_free(ssl2);
+	SSL_CTX_free(ssl_ctx);
+	X509_free(other_cert);
+
+	return failed;
+}
+
+static int
+test_ssl_new_cipher_list(void)
+{
+	SSL_CTX *ssl_ctx;
+	SSL_CERT *ctx_cert;
+	SSL *ssl = NULL;
+	int failed = 1;
+
+	ssl_ctx = server_ctx_new();
+	ctx_cert = ssl_ctx->cert;
+
+	if ((ssl = SSL_new(ssl_ctx)) == NULL)
+		errx(1, "SSL_new");
+
+	/* Setting a cipher list must not copy a shared SSL_CERT... */
+	if (!SSL_CTX_set_cipher_list(ssl_ctx, "AESGCM")) {
+		fprintf(stderr, "FAIL: SSL_CTX_set_cipher_list\n");
+		goto failure;
+	}
+	if (ssl_ctx->cert != ctx_cert) {
+		fprintf(stderr, "FAIL: SSL_CTX_set_cipher_list copied the "
+		    "SSL_CERT\n");
+		goto failure;
+	}
+	if (!SSL_set_cipher_list(ssl, "AESGCM")) {
+		fprintf(stderr, "FAIL: SSL_set_cipher_list\n");
+		goto failure;
+	}
+	if (ssl->cert != ssl_ctx->cert) {
+		fprintf(stderr, "FAIL: SSL_set_cipher_list copied the "
+		    "SSL_CERT\n");
+		goto failure;
+	}
+	if (!SSL_CTX_set_ssl_version(ssl_ctx, TLS_method())) {
+		fprintf(stderr, "FAIL: SSL_CTX_set_ssl_version\n");
+		goto failure;
+	}
+	if (ssl_ctx->cert != ctx_cert || ssl->cert != ctx_cert) {
+		fprintf(stderr, "FAIL: SSL_CTX_set_ssl_version copied the "
+		    "SSL_CERT\n");
+		goto failure;
+	}
+
+	/* ...unless it sets a security level. */
+	if (!SSL_set_cipher_list(ssl, "AESGCM:@SECLEVEL=0")) {
+		fprintf(stderr, "FAIL: SSL_set_cipher_list with security "
+		    "level\n");
+		goto failure;
+	}
+	if (ssl->cert == ssl_ctx->cert) {
+		fprintf(stderr, "FAIL: SSL still shares the SSL_CTX SSL_CERT "
+		    "after setting a security level\n");
+		goto failure;
+	}
+	if (SSL_get_security_level(ssl) != 0 ||
+	    SSL_CTX_get_security_level(ssl_ctx) == 0) {
+		fprintf(stderr, "FAIL: security level not set on the SSL\n");
+		goto failure;
+	}
+	if (!SSL_CTX_set_cipher_list(ssl_ctx, "AESGCM:@SECLEVEL=0")) {
+		fprintf(stderr, "FAIL: SSL_CTX_set_cipher_list with security "
+		    "level\n");
+		goto failure;
+	}
+	if (SSL_CTX_get_security_level(ssl_ctx) != 0) {
+		fprintf(stderr, "FAIL: security level not set on the "
+		    "SSL_CTX\n");
+		goto failure;
+	}
+
+	failed = 0;
+
+ failure:
+	SSL_free(ssl);
+	SSL_CTX_free(ssl_ctx);
+
+	return failed;
+}
+
+static int
+test_ssl_new_param(void)
+{
+	X509_VERIFY_PARAM *param = NULL;
+	SSL_CTX *ssl_ctx;
+	SSL *ssl = NULL;
+	int failed = 1;
+
+	ssl_ctx = server_ctx_new();
+	SSL_CTX_set_verify_depth(ssl_ctx, 4);
+
+	if ((ssl = SSL_new(ssl_ctx)) == NULL)
+		errx(1, "SSL_new");
+	if (SSL_get_verify_depth(ssl) != 4) {
+		fprintf(stderr, "FAIL: SSL verify depth is %d, want 4\n",
+		    SSL_get_verify_depth(ssl));
+		goto failure;
+	}
+
+	SSL_set_verify_depth(ssl, 2);
+	if (SSL_set1_host(ssl, "www.example.com") != 1) {
+		fprintf(stderr, "FAIL: SSL_set1_host\n");
+		goto failure;
+	}
+	if (SSL_get_verify_depth(ssl) != 2) {
+		fprintf(stderr, "FAIL: SSL verify depth is %d, want 2\n",
+		    SSL_get_verify_depth(ssl));
+		goto failure;
+	}
+	if (X509_VERIFY_PARAM_get_depth(SSL_CTX_get0_param(ssl_ctx)) != 4) {
+		fprintf(stderr, "FAIL: SSL_CTX verify depth changed\n");
+		goto failure;
+	}
+
+	/* Changing the SSL_CTX must not affect an existing SSL. */
+	if ((param = X509_VERIFY_PARAM_new()) == NULL)
+		errx(1, "X509_VERIFY_PARAM_new");
+	X509_VERIFY_PARAM_set_depth(param, 6);
+	if (!SSL_CTX_set1_param(ssl_ctx, param)) {
+		fprintf(stderr, "FAIL: SSL_CTX_set1_param\n");
+		goto failure;
+	}
+	if (SSL_get_verify_depth(ssl) != 2) {
+		fprintf(stderr, "FAIL: SSL verify depth is %d after SSL_CTX "
+		    "change, want 2\n", SSL_get_verify_depth(ssl));
+		goto failure;
+	}
+
+	failed = 0;
+
+ failure:
+	X509_VERIFY_PARAM_free(param);
+	SSL_free(ssl);
+	SSL_CTX_free(ssl_ctx);
+
+	return failed;
+}
+
+static int
+test_ssl_new_lists(void)
+{
+	const uint16_t *groups;
+	size_t groups_len;
+	SSL_CTX *ssl_ctx;
+	SSL *ssl = NULL;
+	CBS protos;
+	int failed = 1;
+
+	ssl_ctx = server_ctx_new();
+
+	if ((ssl = SSL_new(ssl_ctx)) == NULL)
+		errx(1, "SSL_new");
+
+	CBS_init(&protos, ssl->alpn_client_proto_list,
+	    ssl->alpn_client_proto_list_len);
+	if (!CBS_mem_equal(&protos, alpn_protos, sizeof(alpn_protos))) {
+		fprintf(stderr, "FAIL: SSL does not have the SSL_CTX ALPN "
+		    "protocols\n");
+		goto failure;
+	}
+	tls1_get_group_list(ssl, 0, &groups, &groups_len);
+	if (groups_len != 3) {
+		fprintf(stderr, "FAIL: SSL has %zu groups, want 3\n",
+		    groups_len);
+		goto failure;
+	}
+
+	/* Changing the SSL_CTX must not affect an existing SSL. */
+	if (SSL_CTX_set_alpn_protos(ssl_ctx, NULL, 0) != 0) {
+		fprintf(stderr, "FAIL: SSL_CTX_set_alpn_protos\n");
+		goto failure;
+	}
+	if (!SSL_CTX_set1_groups_list(ssl_ctx, "X25519")) {
+		fprintf(stderr, "FAIL: SSL_CTX_set1_groups_list\n");
+		goto failure;
+	}
+	CBS_init(&protos, ssl->alpn_client_proto_list,
+	    ssl->alpn_client_proto_list_len);
+	if (!CBS_mem_equal(&protos, alpn_protos, sizeof(alpn_protos))) {
+		fprintf(stderr, "FAIL: SSL ALPN protocols changed with the "
+		    "SSL_CTX\n");
+		goto failure;
+	}
+	tls1_get_group_list(ssl, 0, &groups, &groups_len);
+	if (groups_len != 3) {
+		fprintf(stderr, "FAIL: SSL has %zu groups after SSL_CTX "
+		    "change, want 3\n", groups_len);
+		goto failure;
+	}
+
+	if (SSL_set_alpn_protos(ssl, NULL, 0) != 0) {
+		fprintf(stderr, "FAIL: SSL_set_alpn_protos\n");
+		goto failure;
+	}
+	if (ssl->alpn_client_proto_list_len != 0) {
+		fprintf(stderr, "FAIL: SSL still has ALPN protocols\n");
+		goto failure;
+	}
+
+	if (!SSL_set1_groups_list(ssl, "P-521")) {
+		fprintf(stderr, "FAIL: SSL_set1_groups_list\n");
+		goto failure;
+	}
+	tls1_get_group_list(ssl, 0, &groups, &groups_len);
+	if (groups_len != 1) {
+		fprintf(stderr, "FAIL: SSL has %zu groups, want 1\n",
+		    groups_len);
+		goto failure;
+	}
+	if (ssl_ctx->tlsext_supportedgroups_length != 1) {
+		fprintf(stderr, "FAIL: SSL_CTX groups changed\n");
+		goto failure;
+	}
+
+	failed = 0;
+
+ failure:
+	SSL_free(ssl);
+	SSL_CTX_free(ssl_ctx);
+
+	return failed;
+}
+
+static volatile sig_atomic_t benchmark_stop;
+
+static void
+benchmark_sig_alarm(int sig)
+{
+	benchmark_stop = 1;
+}
+
+static void
+benchmark_ssl_new(int seconds)
+{
+	struct timespec start, end, duration;
+	unsigned long mallocs;
+	SSL_CTX *ssl_ctx;
+	double secs;
+	SSL *ssl;
+	int i;
+
+	ssl_ctx = server_ctx_new();
+
+	signal(SIGALRM, benchmark_sig_alarm);
+
+	/* Warm up, so that any one-time allocations are not counted. */
+	if ((ssl = SSL_new(ssl_ctx)) == NULL)
+		errx(1, "SSL_new");
+	SSL_free(ssl);
+
+	benchmark_stop = 0;
+	i = 0;
+	alarm(seconds);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	mallocs = malloc_calls;
+
+	fprintf(stderr, "Benchmarking SSL_new/SSL_free for %ds: ", seconds);
+	while (!benchmark_stop) {
+		if ((ssl = SSL_new(ssl_ctx)) == NULL)
+			errx(1, "SSL_new");
+		SSL_free(ssl);
+		i++;
+	}
+	mallocs = malloc_calls - mallocs;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	timespecsub(&end, &start, &duration);
+	secs = duration.tv_sec + duration.tv_nsec / 1000000000.0;
+	fprintf(stderr, "%d iterations in %f seconds (%.0f/s), %.1f "
+	    "allocations per iteration\n", i, secs, i / secs,
+	    (double)mallocs / i);
+
+	SSL_CTX_free(ssl_ctx);
+}
+
+int
+main(int argc, char **argv)
+{
+	int benchmark = 0, failed = 0;
+
+	if (argc == 3 && strcmp(argv[1], "--benchmark") == 0) {
+		benchmark = 1;
+		argc--;
+		argv++;
+	}
+	if (argc != 2) {
+		fprintf(stderr, "usage: sslnewtest [--benchmark] certsdir\n");
+		exit(1);
+	}
+	certs_dir = argv[1];
+
+	failed |= test_ssl_new_cert();
+	failed |= test_ssl_new_cipher_list();
+	failed |= test_ssl_new_param();
+	failed |= test_ssl_new_lists();
+
+	if (benchmark && !failed)
+		benchmark_ssl_new(5);
+
+	return failed;
+}
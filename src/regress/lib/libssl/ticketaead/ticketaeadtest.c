@@ -0,0 +1,482 @@
+/*	$OpenBSD$ */
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <sys/time.h>
+
+#include <err.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/ssl.h>
+
+static const char *certs_dir;
+
+#define TICKET_NONCE_LEN	12
+
+struct ticket_aead {
+	EVP_AEAD_CTX *aead_ctx;
+	enum ssl_ticket_aead_result_t open_result;
+	int seal_calls;
+	int open_calls;
+};
+
+static struct ticket_aead ticket_aead;
+
+static const unsigned char ticket_key[32] = {
+	0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+	0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+	0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17,
+	0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f,
+};
+
+static size_t
+ticket_aead_max_overhead(SSL *ssl)
+{
+	return TICKET_NONCE_LEN +
+	    EVP_AEAD_max_overhead(EVP_aead_aes_256_gcm());
+}
+
+static int
+ticket_aead_seal(SSL *ssl, uint8_t *out, size_t *out_len, size_t max_out,
+    const uint8_t *in, size_t in_len)
+{
+	size_t len;
+
+	ticket_aead.seal_calls++;
+
+	if (max_out < TICKET_NONCE_LEN)
+		return 0;
+
+	arc4random_buf(out, TICKET_NONCE_LEN);
+	if (!EVP_AEAD_CTX_seal(ticket_aead.aead_ctx, out + TICKET_NONCE_LEN,
+	    &len, max_out - TICKET_NONCE_LEN, out, TICKET_NONCE_LEN, in, in_len,
+	    NULL, 0))
+		return 0;
+	*out_len = TICKET_NONCE_LEN + len;
+
+	return 1;
+}
+
+static enum ssl_ticket_aead_result_t
+ticket_aead_open(SSL *ssl, uint8_t *out, size_t *out_len, size_t max_out,
+    const uint8_t *in, size_t in_len)
+{
+	ticket_aead.open_calls++;
+
+	if (ticket_aead.open_result == ssl_ticket_aead_ignore_ticket ||
+	    ticket_aead.open_result == ssl_ticket_aead_error)
+		return ticket_aead.open_result;
+
+	if (in_len < TICKET_NONCE_LEN)
+		return ssl_ticket_aead_ignore_ticket;
+	if (!EVP_AEAD_CTX_open(ticket_aead.aead_ctx, out, out_len, max_out,
+	    in, TICKET_NONCE_LEN, in + TICKET_NONCE_LEN,
+	    in_len - TICKET_NONCE_LEN, NULL, 0))
+		return ssl_ticket_aead_ignore_ticket;
+
+	return ticket_aead.open_result;
+}
+
+static const SSL_TICKET_AEAD_METHOD ticket_aead_method = {
+	.max_overhead = ticket_aead_max_overhead,
+	.seal = ticket_aead_seal,
+	.open = ticket_aead_open,
+};
+
+/*
+ * A ticket key callback that sets up its contexts from raw key material for
+ * every ticket, for comparison in the benchmark.
+ */
+static int
+ticket_key_cb(SSL *ssl, unsigned char *key_name, unsigned char *iv,
+    EVP_CIPHER_CTX *ctx, HMAC_CTX *hctx, int enc)
+{
+	if (enc) {
+		memset(key_name, 0, 16);
+		arc4random_buf(iv, EVP_MAX_IV_LENGTH);
+		if (!EVP_EncryptInit_ex(ctx, EVP_aes_256_cbc(), NULL,
+		    ticket_key, iv))
+			return -1;
+	} else {
+		if (!EVP_DecryptInit_ex(ctx, EVP_aes_256_cbc(), NULL,
+		    ticket_key, iv))
+			return -1;
+	}
+	if (!HMAC_Init_ex(hctx, ticket_key, 16, EVP_sha256(), NULL))
+		return -1;
+
+	return 1;
+}
+
+static SSL_CTX *
+server_ctx_new(int use_aead)
+{
+	char file[PATH_MAX];
+	SSL_CTX *ssl_ctx;
+
+	if ((ssl_ctx = SSL_CTX_new(TLS_method())) == NULL)
+		errx(1, "server context");
+
+	if (snprintf(file, sizeof(file), "%s/server1-ecdsa-chain.pem",
+	    certs_dir) >= (int)sizeof(file))
+		errx(1, "certificate path too long");
+	if (SSL_CTX_use_certificate_chain_file(ssl_ctx, file) != 1)
+		errx(1, "failed to load server certificate");
+	if (snprintf(file, sizeof(file), "%s/server1-ecdsa.pem",
+	    certs_dir) >= (int)sizeof(file))
+		errx(1, "key path too long");
+	if (SSL_CTX_use_PrivateKey_file(ssl_ctx, file, SSL_FILETYPE_PEM) != 1)
+		errx(1, "failed to load server key");
+
+	if (!SSL_CTX_set_max_proto_version(ssl_ctx, TLS1_2_VERSION))
+		errx(1, "SSL_CTX_set_max_proto_version");
+
+	if (use_aead)
+		SSL_CTX_set_ticket_aead_method(ssl_ctx, &ticket_aead_method);
+	else if (!SSL_CTX_set_tlsext_ticket_key_cb(ssl_ctx, ticket_key_cb))
+		errx(1, "SSL_CTX_set_tlsext_ticket_key_cb");
+
+	return ssl_ctx;
+}
+
+static SSL_CTX *
+client_ctx_new(void)
+{
+	SSL_CTX *ssl_ctx;
+
+	if ((ssl_ctx = SSL_CTX_new(TLS_method())) == NULL)
+		errx(1, "client context");
+
+	return ssl_ctx;
+}
+
+/*
+ * Perform a handshake over a BIO pair, resuming session if it is not NULL.
+ * The client session and whether it was reused are optionally returned.
+ */
+static int
+do_handshake(SSL_CTX *server_ctx, SSL_CTX *client_ctx, SSL_SESSION *session,
+    SSL_SESSION **out_session, int *reused)
+{
+	SSL *client = NULL, *server = NULL;
+	BIO *client_bio, *server_bio;
+	int client_ret, server_ret;
+	int ret = 0;
+	int i;
+
+	if (!BIO_new_bio_pair(&client_bio, 0, &server_bio, 0))
+		errx(1, "BIO pair");
+
+	if ((client = SSL_new(client_ctx)) == NULL)
+		errx(1, "client SSL");
+	if ((server = SSL_new(server_ctx)) == NULL)
+		errx(1, "server SSL");
+
+	SSL_set_bio(client, client_bio, client_bio);
+	SSL_set_bio(server, server_bio, server_bio);
+
+	if (session != NULL && !SSL_set_session(client, session))
+		errx(1, "SSL_set_session");
+
+	SSL_set_connect_state(client);
+	SSL_set_accept_state(server);
+
+	client_ret = server_ret = 0;
+	for (i = 0; i < 100; i++) {
+		if (client_ret != 1)
+			client_ret = SSL_do_handshake(client);
+		if (server_ret != 1)
+			server_ret = SSL_do_handshake(server);
+		if (client_ret == 1 && server_ret == 1)
+			break;
+		if (client_ret != 1 && SSL_get_error(client, client_ret) ==
+		    SSL_ERROR_SSL)
+			goto err;
+		if (server_ret != 1 && SSL_get_error(server, server_ret) ==
+		    SSL_ERROR_SSL)
+			goto err;
+	}
+	if (client_ret != 1 || server_ret != 1)
+		goto err;
+
+	if (reused != NULL)
+		*reused = SSL_session_reused(client);
+	if (out_session != NULL) {
+		SSL_SESSION_free(*out_session);
+		*out_session = SSL_get1_session(client);
+	}
+
+	ret = 1;
+
+ err:
+	SSL_free(client);
+	SSL_free(server);
+
+	return ret;
+}
+
+struct ticket_aead_test {
+	const char *desc;
+	enum ssl_ticket_aead_result_t open_result;
+	int want_failure;
+	int want_reused;
+	int want_seal_calls;
+};
+
+static const struct ticket_aead_test ticket_aead_tests[] = {
+	{
+		.desc = "resumption",
+		.open_result = ssl_ticket_aead_success,
+		.want_reused = 1,
+		.want_seal_calls = 0,
+	},
+	{
+		.desc = "resumption with renewal",
+		.open_result = ssl_ticket_aead_renew,
+		.want_reused = 1,
+		.want_seal_calls = 1,
+	},
+	{
+		.desc = "ignored ticket",
+		.open_result = ssl_ticket_aead_ignore_ticket,
+		.want_reused = 0,
+		.want_seal_calls = 1,
+	},
+	{
+		.desc = "open failure",
+		.open_result = ssl_ticket_aead_error,
+		.want_failure = 1,
+	},
+};
+
+#define N_TICKET_AEAD_TESTS \
+    (sizeof(ticket_aead_tests) / sizeof(ticket_aead_tests[0]))
+
+static int
+ticket_aead_test(SSL_CTX *server_ctx, SSL_CTX *client_ctx,
+    const struct ticket_aead_test *tat)
+{
+	SSL_SESSION *session = NULL, *resumed = NULL;
+	int reused = 0;
+	int failed = 1;
+
+	ticket_aead.open_result = ssl_ticket_aead_success;
+	ticket_aead.seal_calls = 0;
+	ticket_aead.open_calls = 0;
+
+	if (!do_handshake(server_ctx, client_ctx, NULL, &session, NULL)) {
+		fprintf(stderr, "FAIL: %s: initial handshake failed\n",
+		    tat->desc);
+		ERR_print_errors_fp(stderr);
+		goto failure;
+	}
+	if (ticket_aead.seal_calls != 1 || ticket_aead.open_calls != 0) {
+		fprintf(stderr, "FAIL: %s: initial handshake made %d seal and "
+		    "%d open calls, want 1 and 0\n", tat->desc,
+		    ticket_aead.seal_calls, ticket_aead.open_calls);
+		goto failure;
+	}
+	if (!SSL_SESSION_has_ticket(session)) {
+		fprintf(stderr, "FAIL: %s: no ticket received\n", tat->desc);
+		goto failure;
+	}
+
+	ticket_aead.open_result = tat->open_result;
+	ticket_aead.seal_calls = 0;
+
+	if (!do_handshake(server_ctx, client_ctx, session, &resumed,
+	    &reused)) {
+		if (tat->want_failure) {
+			ERR_clear_error();
+			failed = 0;
+			goto failure;
+		}
+		fprintf(stderr, "FAIL: %s: resumption handshake failed\n",
+		    tat->desc);
+		ERR_print_errors_fp(stderr);
+		goto failure;
+	}
+	if (tat->want_failure) {
+		fprintf(stderr, "FAIL: %s: resumption handshake succeeded\n",
+		    tat->desc);
+		goto failure;
+	}
+	if (ticket_aead.open_calls != 1) {
+		fprintf(stderr, "FAIL: %s: got %d open calls, want 1\n",
+		    tat->desc, ticket_aead.open_calls);
+		goto failure;
+	}
+	if (reused != tat->want_reused) {
+		fprintf(stderr, "FAIL: %s: session reused is %d, want %d\n",
+		    tat->desc, reused, tat->want_reused);
+		goto failure;
+	}
+	if (ticket_aead.seal_calls != tat->want_seal_calls) {
+		fprintf(stderr, "FAIL: %s: got %d seal calls, want %d\n",
+		    tat->desc, ticket_aead.seal_calls, tat->want_seal_calls);
+		goto failure;
+	}
+
+	failed = 0;
+
+ failure:
+	SSL_SESSION_free(session);
+	SSL_SESSION_free(resumed);
+
+	return failed;
+}
+
+static int
+test_ticket_aead(void)
+{
+	SSL_CTX *server_ctx, *client_ctx;
+	SSL_SESSION *session = NULL;
+	size_t i;
+	int reused = 0;
+	int failed = 0;
+
+	server_ctx = server_ctx_new(1);
+	client_ctx = client_ctx_new();
+
+	for (i = 0; i < N_TICKET_AEAD_TESTS; i++)
+		failed |= ticket_aead_test(server_ctx, client_ctx,
+		    &ticket_aead_tests[i]);
+
+	SSL_CTX_free(server_ctx);
+
+	/* Tickets from the ticket key callback still work without it. */
+	server_ctx = server_ctx_new(0);
+	if (!do_handshake(server_ctx, client_ctx, NULL, &session, NULL) ||
+	    !do_handshake(server_ctx, client_ctx, session, NULL, &reused)) {
+		fprintf(stderr, "FAIL: ticket key callback handshake failed\n");
+		ERR_print_errors_fp(stderr);
+		failed = 1;
+	} else if (!reused) {
+		fprintf(stderr, "FAIL: ticket key callback session not "
+		    "reused\n");
+		failed = 1;
+	}
+
+	SSL_SESSION_free(session);
+	SSL_CTX_free(server_ctx);
+	SSL_CTX_free(client_ctx);
+
+	return failed;
+}
+
+static volatile sig_atomic_t benchmark_stop;
+
+static void
+benchmark_sig_alarm(int sig)
+{
+	benchmark_stop = 1;
+}
+
+static void
+benchmark_resumption(const char *desc, int use_aead,
+    enum ssl_ticket_aead_result_t open_result, int seconds)
+{
+	SSL_CTX *server_ctx, *client_ctx;
+	SSL_SESSION *session = NULL;
+	struct timespec start, end, duration;
+	long handshakes = 0;
+	double secs;
+	int reused;
+
+	server_ctx = server_ctx_new(use_aead);
+	client_ctx = client_ctx_new();
+
+	ticket_aead.open_result = ssl_ticket_aead_success;
+	if (!do_handshake(server_ctx, client_ctx, NULL, &session, NULL))
+		errx(1, "initial handshake failed");
+	ticket_aead.open_result = open_result;
+
+	signal(SIGALRM, benchmark_sig_alarm);
+	benchmark_stop = 0;
+	alarm(seconds);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	while (!benchmark_stop) {
+		if (!do_handshake(server_ctx, client_ctx, session, NULL,
+		    &reused) || !reused)
+			errx(1, "resumption handshake failed");
+		handshakes++;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	timespecsub(&end, &start, &duration);
+	secs = duration.tv_sec + duration.tv_nsec / 1000000000.0;
+
+	fprintf(stderr, "%s: %ld resumptions in %f seconds, %.1f resumptions "
+	    "per second\n", desc, handshakes, secs, handshakes / secs);
+
+	SSL_SESSION_free(session);
+	SSL_CTX_free(server_ctx);
+	SSL_CTX_free(client_ctx);
+}
+
+static void
+benchmark_ticket_aead(int seconds)
+{
+	benchmark_resumption("ticket key callback", 0,
+	    ssl_ticket_aead_success, seconds);
+	benchmark_resumption("ticket AEAD method", 1,
+	    ssl_ticket_aead_success, seconds);
+	benchmark_resumption("ticket AEAD method, renewed", 1,
+	    ssl_ticket_aead_renew, seconds);
+}
+
+int
+main(int argc, char **argv)
+{
+	int benchmark = 0, failed = 0;
+
+	if (argc == 3 && strcmp(argv[1], "--benchmark") == 0) {
+		benchmark = 1;
+		argc--;
+		argv++;
+	}
+	if (argc != 2) {
+		fprintf(stderr, "usage: ticketaeadtest [--benchmark] certsdir\n");
+		exit(1);
+	}
+	certs_dir = argv[1];
+
+	if ((ticket_aead.aead_ctx = EVP_AEAD_CTX_new()) == NULL)
+		errx(1, "EVP_AEAD_CTX_new");
+	if (!EVP_AEAD_CTX_init(ticket_aead.aead_ctx, EVP_aead_aes_256_gcm(),
+	    ticket_key, sizeof(ticket_key), EVP_AEAD_DEFAULT_TAG_LENGTH, NULL))
+		errx(1, "EVP_AEAD_CTX_init");
+
+	failed |= test_ticket_aead();
+
+	if (benchmark && !failed)
+		benchmark_ticket_aead(5);
+
+	EVP_AEAD_CTX_free(ticket_aead.aead_ctx);
+
+	return failed;
+}
@@ -26,6 +26,7 @@
 
 #include "bytestring.h"
 #include "ssl_tlsext.h"
+#include "tls13_internal.h"
 
 struct tls_extension_funcs {
 	int (*needs)(SSL *s, uint16_t msg_type);
@@ -3842,6 +3843,260 @@ done:
 	return (failure);
 }
 
+static int
+keyshare_client_shares(CBB *cbb, const uint16_t *groups, size_t groups_len)
+{
+	struct tls_key_share *ks;
+	CBB client_shares, key_exchange;
+	size_t i;
+
+	if (!CBB_add_u16_length_prefixed(cbb, &client_shares))
+		return 0;
+	for (i = 0; i < groups_len; i++) {
+		if ((ks = tls_key_share_new(groups[i])) == NULL)
+			return 0;
+		if (!tls_key_share_generate(ks)) {
+			tls_key_share_free(ks);
+			return 0;
+		}
+		if (!CBB_add_u16(&client_shares, groups[i]) ||
+		    !CBB_add_u16_length_prefixed(&client_shares,
+		    &key_exchange) ||
+		    !tls_key_share_public(ks, &key_exchange)) {
+			tls_key_share_free(ks);
+			return 0;
+		}
+		tls_key_share_free(ks);
+	}
+
+	return CBB_flush(cbb);
+}
+
+static int
+keyshare_select(SSL *ssl, const uint16_t *groups, size_t groups_len,
+    uint16_t *out_group)
+{
+	const struct tls_extension_funcs *client_funcs;
+	const struct tls_extension_funcs *server_funcs;
+	unsigned char *data = NULL;
+	size_t dlen;
+	CBB cbb;
+	CBS cbs;
+	int alert;
+	int ret = 0;
+
+	if (!tls_extension_funcs(TLSEXT_TYPE_key_share, &client_funcs,
+	    &server_funcs))
+		errx(1, "failed to fetch keyshare funcs");
+
+	if (!CBB_init(&cbb, 0))
+		errx(1, "Failed to create CBB");
+	if (!keyshare_client_shares(&cbb, groups, groups_len))
+		goto err;
+	if (!CBB_finish(&cbb, &data, &dlen))
+		goto err;
+
+	tls_key_share_free(ssl->s3->hs.key_share);
+	ssl->s3->hs.key_share = NULL;
+	ssl->s3->hs.our_max_tls_version = TLS1_3_VERSION;
+
+	CBS_init(&cbs, data, dlen);
+	if (!server_funcs->parse(ssl, SSL_TLSEXT_MSG_CH, &cbs, &alert))
+		goto err;
+	if (CBS_len(&cbs) != 0)
+		goto err;
+
+	*out_group = 0;
+	if (ssl->s3->hs.key_share != NULL)
+		*out_group = tls_key_share_group(ssl->s3->hs.key_share);
+
+	ret = 1;
+
+ err:
+	CBB_cleanup(&cbb);
+	free(data);
+
+	return ret;
+}
+
+/*
+ * Where a client sends multiple key shares, the server should select the
+ * most preferred group, without falling back to a hello retry request.
+ */
+static int
+test_tlsext_keyshare_server_select(void)
+{
+	SSL_CTX *ssl_ctx = NULL;
+	SSL *ssl = NULL;
+	const uint16_t x25519_p256[] = { 29, 23 };
+	const uint16_t p256_x25519[] = { 23, 29 };
+	const uint16_t p384_x25519[] = { 24, 29 };
+	const uint16_t p384[] = { 24 };
+	uint16_t group;
+	int failure;
+
+	failure = 1;
+
+	if ((ssl_ctx = SSL_CTX_new(TLS_server_method())) == NULL)
+		errx(1, "failed to create SSL_CTX");
+	if (!SSL_CTX_set1_groups_list(ssl_ctx, "P-256:X25519"))
+		errx(1, "failed to set groups");
+	if ((ssl = SSL_new(ssl_ctx)) == NULL)
+		errx(1, "failed to create SSL");
+	if ((ssl->session = SSL_SESSION_new()) == NULL)
+		errx(1, "failed to create session");
+
+	/* Without a client groups list the first acceptable share wins. */
+	if (!keyshare_select(ssl, x25519_p256, 2, &group)) {
+		FAIL("failed to parse client keyshares\n");
+		goto done;
+	}
+	if (group != 29) {
+		FAIL("selected group %u, want 29\n", group);
+		goto done;
+	}
+
+	/* Server preference. */
+	SSL_set_options(ssl, SSL_OP_CIPHER_SERVER_PREFERENCE);
+	if (!keyshare_select(ssl, x25519_p256, 2, &group)) {
+		FAIL("failed to parse client keyshares\n");
+		goto done;
+	}
+	if (group != 23) {
+		FAIL("selected group %u, want 23\n", group);
+		goto done;
+	}
+
+	/* Client preference, from the supported groups extension. */
+	SSL_clear_options(ssl, SSL_OP_CIPHER_SERVER_PREFERENCE);
+	if ((ssl->session->tlsext_supportedgroups =
+	    malloc(sizeof(x25519_p256))) == NULL)
+		errx(1, "malloc");
+	memcpy(ssl->session->tlsext_supportedgroups, x25519_p256,
+	    sizeof(x25519_p256));
+	ssl->session->tlsext_supportedgroups_length = 2;
+	if (!keyshare_select(ssl, p256_x25519, 2, &group)) {
+		FAIL("failed to parse client keyshares\n");
+		goto done;
+	}
+	if (group != 29) {
+		FAIL("selected group %u, want 29\n", group);
+		goto done;
+	}
+
+	/* Unsupported shares are skipped. */
+	if (!keyshare_select(ssl, p384_x25519, 2, &group)) {
+		FAIL("failed to parse client keyshares\n");
+		goto done;
+	}
+	if (group != 29) {
+		FAIL("selected group %u, want 29\n", group);
+		goto done;
+	}
+	if (!keyshare_select(ssl, p384, 1, &group)) {
+		FAIL("failed to parse client keyshares\n");
+		goto done;
+	}
+	if (group != 0) {
+		FAIL("selected group %u, want none\n", group);
+		goto done;
+	}
+
+	failure = 0;
+
+ done:
+	SSL_CTX_free(ssl_ctx);
+	SSL_free(ssl);
+
+	return (failure);
+}
+
+/*
+ * The server must select between the client's key shares using the client's
+ * supported groups, even where the key share extension precedes the supported
+ * groups extension in the ClientHello.
+ */
+static int
+test_tlsext_keyshare_server_order(void)
+{
+	SSL_CTX *ssl_ctx = NULL;
+	SSL *ssl = NULL;
+	const uint16_t x25519_p256[] = { 29, 23 };
+	const uint16_t p256_x25519[] = { 23, 29 };
+	unsigned char *data = NULL;
+	size_t dlen, i;
+	CBB cbb, extensions, extension, groups;
+	CBS cbs;
+	int alert;
+	int failure;
+
+	failure = 1;
+
+	if (!CBB_init(&cbb, 0))
+		errx(1, "Failed to create CBB");
+
+	if ((ssl_ctx = SSL_CTX_new(TLS_server_method())) == NULL)
+		errx(1, "failed to create SSL_CTX");
+	if (!SSL_CTX_set1_groups_list(ssl_ctx, "P-256:X25519"))
+		errx(1, "failed to set groups");
+	if ((ssl = SSL_new(ssl_ctx)) == NULL)
+		errx(1, "failed to create SSL");
+	if ((ssl->session = SSL_SESSION_new()) == NULL)
+		errx(1, "failed to create session");
+	if (tls13_ctx_new(TLS13_HS_SERVER, ssl) == NULL)
+		errx(1, "failed to create TLSv1.3 context");
+	if (!tls13_clienthello_hash_init(ssl->tls13))
+		errx(1, "failed to initialise ClientHello hash");
+
+	ssl->s3->hs.our_max_tls_version = TLS1_3_VERSION;
+
+	if (!CBB_add_u16_length_prefixed(&cbb, &extensions))
+		errx(1, "failed to build extensions");
+	if (!CBB_add_u16(&extensions, TLSEXT_TYPE_key_share) ||
+	    !CBB_add_u16_length_prefixed(&extensions, &extension) ||
+	    !keyshare_client_shares(&extension, p256_x25519, 2))
+		errx(1, "failed to build keyshare extension");
+	if (!CBB_add_u16(&extensions, TLSEXT_TYPE_supported_groups) ||
+	    !CBB_add_u16_length_prefixed(&extensions, &extension) ||
+	    !CBB_add_u16_length_prefixed(&extension, &groups))
+		errx(1, "failed to build supported groups extension");
+	for (i = 0; i < 2; i++) {
+		if (!CBB_add_u16(&groups, x25519_p256[i]))
+			errx(1, "failed to build supported groups extension");
+	}
+	if (!CBB_finish(&cbb, &data, &dlen))
+		errx(1, "failed to finish extensions");
+
+	CBS_init(&cbs, data, dlen);
+	if (!tlsext_server_parse(ssl, SSL_TLSEXT_MSG_CH, &cbs, &alert)) {
+		FAIL("failed to parse client extensions\n");
+		goto done;
+	}
+	if (CBS_len(&cbs) != 0) {
+		FAIL("extension data remaining\n");
+		goto done;
+	}
+	if (ssl->s3->hs.key_share == NULL) {
+		FAIL("no key share selected\n");
+		goto done;
+	}
+	if (tls_key_share_group(ssl->s3->hs.key_share) != 29) {
+		FAIL("selected group %u, want 29\n",
+		    tls_key_share_group(ssl->s3->hs.key_share));
+		goto done;
+	}
+
+	failure = 0;
+
+ done:
+	CBB_cleanup(&cbb);
+	SSL_CTX_free(ssl_ctx);
+	SSL_free(ssl);
+	free(data);
+
+	return (failure);
+}
+
 /* One day I hope to be the only Muppet in this codebase */
 const uint8_t cookie[] = "\n"
     "        (o)(o)        \n"
@@ -4468,6 +4723,8 @@ main(int argc, char **argv)
 
 	failed |= test_tlsext_keyshare_client();
 	failed |= test_tlsext_keyshare_server();
+	failed |= test_tlsext_keyshare_server_select();
+	failed |= test_tlsext_keyshare_server_order();
 
 	failed |= test_tlsext_cookie_client();
 	failed |= test_tlsext_cookie_server();
@@ -0,0 +1,130 @@
+/*	$OpenBSD$ */
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <openssl/objects.h>
+
+#include <tls.h>
+#include <tls_internal.h>
+
+static int
+group_cache_test(void)
+{
+	struct tls_config *config;
+	char name[32];
+	size_t i;
+	int nid;
+	int failed = 1;
+
+	if ((config = tls_config_new()) == NULL)
+		errx(1, "failed to create config");
+
+	if ((nid = tls_config_group_cache_lookup(config,
+	    "server.example.com")) != NID_undef) {
+		fprintf(stderr, "FAIL: empty cache returned group %d\n", nid);
+		goto failure;
+	}
+
+	tls_config_group_cache_update(config, "server.example.com",
+	    NID_X9_62_prime256v1);
+	tls_config_group_cache_update(config, "other.example.com",
+	    NID_secp384r1);
+	if ((nid = tls_config_group_cache_lookup(config,
+	    "server.example.com")) != NID_X9_62_prime256v1) {
+		fprintf(stderr, "FAIL: cached group %d, want %d\n", nid,
+		    NID_X9_62_prime256v1);
+		goto failure;
+	}
+	if ((nid = tls_config_group_cache_lookup(config,
+	    "other.example.com")) != NID_secp384r1) {
+		fprintf(stderr, "FAIL: cached group %d, want %d\n", nid,
+		    NID_secp384r1);
+		goto failure;
+	}
+
+	/* Updating an existing server replaces its group. */
+	tls_config_group_cache_update(config, "server.example.com",
+	    NID_X25519);
+	if ((nid = tls_config_group_cache_lookup(config,
+	    "server.example.com")) != NID_X25519) {
+		fprintf(stderr, "FAIL: updated group %d, want %d\n", nid,
+		    NID_X25519);
+		goto failure;
+	}
+
+	/* An expired entry is ignored, until it is updated again. */
+	for (i = 0; i < TLS_GROUP_CACHE_SIZE; i++) {
+		if (config->group_cache[i].servername != NULL)
+			config->group_cache[i].expires = 0;
+	}
+	if ((nid = tls_config_group_cache_lookup(config,
+	    "server.example.com")) != NID_undef) {
+		fprintf(stderr, "FAIL: expired entry returned group %d\n",
+		    nid);
+		goto failure;
+	}
+	tls_config_group_cache_update(config, "server.example.com",
+	    NID_X25519);
+	if ((nid = tls_config_group_cache_lookup(config,
+	    "server.example.com")) != NID_X25519) {
+		fprintf(stderr, "FAIL: refreshed group %d, want %d\n", nid,
+		    NID_X25519);
+		goto failure;
+	}
+
+	/* Filling the cache evicts the oldest entries. */
+	for (i = 0; i < TLS_GROUP_CACHE_SIZE; i++) {
+		snprintf(name, sizeof(name), "server%zu.example.com", i);
+		tls_config_group_cache_update(config, name,
+		    NID_X9_62_prime256v1);
+	}
+	if ((nid = tls_config_group_cache_lookup(config,
+	    "other.example.com")) != NID_undef) {
+		fprintf(stderr, "FAIL: evicted entry returned group %d\n",
+		    nid);
+		goto failure;
+	}
+	for (i = 0; i < TLS_GROUP_CACHE_SIZE; i++) {
+		snprintf(name, sizeof(name), "server%zu.example.com", i);
+		if ((nid = tls_config_group_cache_lookup(config, name)) !=
+		    NID_X9_62_prime256v1) {
+			fprintf(stderr, "FAIL: %s: cached group %d, want %d\n",
+			    name, nid, NID_X9_62_prime256v1);
+			goto failure;
+		}
+	}
+
+	failed = 0;
+
+ failure:
+	tls_config_free(config);
+
+	return failed;
+}
+
+int
+main(int argc, char **argv)
+{
+	int failed = 0;
+
+	failed |= group_cache_test();
+
+	return failed;
+}
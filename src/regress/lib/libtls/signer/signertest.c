@@ -36,6 +36,17 @@
 
 const char *cert_path;
 int sign_cb_count;
+int sign_async_cb_count;
+int want_sign_count;
+
+struct async_sign {
+	struct tls_signer *signer;
+	struct tls *ctx;
+	char *pubkey_hash;
+	uint8_t *input;
+	size_t input_len;
+	int padding_type;
+} async_sign;
 
 static void
 hexdump(const unsigned char *buf, size_t len)
@@ -274,6 +285,33 @@ do_signer_tests(void)
 	return failed;
 }
 
+static void
+async_sign_complete(void)
+{
+	uint8_t *signature = NULL;
+	size_t signature_len = 0;
+
+	if (async_sign.ctx == NULL)
+		errx(1, "no signature pending");
+
+	if (tls_signer_sign(async_sign.signer, async_sign.pubkey_hash,
+	    async_sign.input, async_sign.input_len, async_sign.padding_type,
+	    &signature, &signature_len) == -1)
+		errx(1, "failed to sign: %s", tls_signer_error(async_sign.signer));
+	if (tls_sign_complete(async_sign.ctx, signature, signature_len) == -1)
+		errx(1, "failed to complete signature: %s",
+		    tls_error(async_sign.ctx));
+
+	free(async_sign.pubkey_hash);
+	free(async_sign.input);
+	async_sign.ctx = NULL;
+	async_sign.pubkey_hash = NULL;
+	async_sign.input = NULL;
+	async_sign.input_len = 0;
+
+	free(signature);
+}
+
 static int
 do_tls_handshake(char *name, struct tls *ctx)
 {
@@ -284,6 +322,12 @@ do_tls_handshake(char *name, struct tls *ctx)
 		return (1);
 	if (rv == TLS_WANT_POLLIN || rv == TLS_WANT_POLLOUT)
 		return (0);
+	if (rv == TLS_WANT_SIGN) {
+		/* Complete the signature on every other attempt. */
+		if (want_sign_count++ % 2 == 1)
+			async_sign_complete();
+		return (0);
+	}
 
 	errx(1, "%s handshake failed: %s", name, tls_error(ctx));
 }
@@ -400,6 +444,93 @@ test_signer_tls(char *certfile, char *keyfile, char *cafile)
 	return (failure);
 }
 
+static int
+test_signer_tls_sign_async(void *cb_arg, struct tls *ctx,
+    const char *pubkey_hash, const uint8_t *input, size_t input_len,
+    int padding_type)
+{
+	sign_async_cb_count++;
+
+	if (async_sign.ctx != NULL)
+		errx(1, "signature already pending");
+
+	async_sign.ctx = ctx;
+	if ((async_sign.pubkey_hash = strdup(pubkey_hash)) == NULL)
+		err(1, "strdup");
+	if ((async_sign.input = malloc(input_len)) == NULL)
+		err(1, "malloc");
+	memcpy(async_sign.input, input, input_len);
+	async_sign.input_len = input_len;
+	async_sign.padding_type = padding_type;
+
+	return (0);
+}
+
+static int
+test_signer_tls_async(char *certfile, char *keyfile, char *cafile,
+    const char *protocols)
+{
+	struct tls_config *client_cfg, *server_cfg;
+	struct tls *client, *server;
+	uint32_t protos;
+	int failure = 0;
+
+	if ((async_sign.signer = tls_signer_new()) == NULL)
+		errx(1, "failed to create tls signer");
+	if (tls_signer_add_keypair_file(async_sign.signer, certfile, keyfile))
+		errx(1, "failed to add keypair to signer");
+
+	if ((client = tls_client()) == NULL)
+		errx(1, "failed to create tls client");
+	if ((client_cfg = tls_config_new()) == NULL)
+		errx(1, "failed to create tls client config");
+	tls_config_insecure_noverifyname(client_cfg);
+	if (tls_config_set_ca_file(client_cfg, cafile) == -1)
+		errx(1, "failed to set ca: %s", tls_config_error(client_cfg));
+	if (tls_config_parse_protocols(&protos, protocols) == -1)
+		errx(1, "failed to parse protocols");
+	if (tls_config_set_protocols(client_cfg, protos) == -1)
+		errx(1, "failed to set protocols: %s",
+		    tls_config_error(client_cfg));
+
+	if ((server = tls_server()) == NULL)
+		errx(1, "failed to create tls server");
+	if ((server_cfg = tls_config_new()) == NULL)
+		errx(1, "failed to create tls server config");
+	if (tls_config_set_sign_async_cb(server_cfg,
+	    test_signer_tls_sign_async, NULL) == -1)
+		errx(1, "failed to set server async signer callback: %s",
+		    tls_config_error(server_cfg));
+	if (tls_config_set_cert_file(server_cfg, certfile) == -1)
+		errx(1, "failed to set server certificate: %s",
+		    tls_config_error(server_cfg));
+
+	if (tls_configure(client, client_cfg) == -1)
+		errx(1, "failed to configure client: %s", tls_error(client));
+	if (tls_configure(server, server_cfg) == -1)
+		errx(1, "failed to configure server: %s", tls_error(server));
+
+	tls_config_free(client_cfg);
+	tls_config_free(server_cfg);
+
+	want_sign_count = 0;
+
+	failure |= test_tls_handshake_socket(client, server);
+
+	if (want_sign_count != 2) {
+		fprintf(stderr, "FAIL: %s handshake wanted a signature %d "
+		    "times, want 2\n", protocols, want_sign_count);
+		failure |= 1;
+	}
+
+	tls_signer_free(async_sign.signer);
+	async_sign.signer = NULL;
+	tls_free(client);
+	tls_free(server);
+
+	return (failure);
+}
+
 static int
 do_signer_tls_tests(void)
 {
@@ -438,6 +569,21 @@ do_signer_tls_tests(void)
 		failure |= 1;
 	}
 
+	failure |= test_signer_tls_async(server_ecdsa_cert, server_ecdsa_key,
+	    ca_root_ecdsa, "tlsv1.3");
+	failure |= test_signer_tls_async(server_rsa_cert, server_rsa_key,
+	    ca_root_rsa, "tlsv1.3");
+	failure |= test_signer_tls_async(server_ecdsa_cert, server_ecdsa_key,
+	    ca_root_ecdsa, "tlsv1.2");
+	failure |= test_signer_tls_async(server_rsa_cert, server_rsa_key,
+	    ca_root_rsa, "tlsv1.2");
+
+	if (sign_async_cb_count != 4) {
+		fprintf(stderr, "FAIL: async sign callback was called %d times, "
+		    "want 4\n", sign_async_cb_count);
+		failure |= 1;
+	}
+
 	free(ca_root_ecdsa);
 	free(ca_root_rsa);
 	free(server_ecdsa_cert);
@@ -0,0 +1,212 @@
+/*	$OpenBSD$ */
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <arpa/inet.h>
+
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <openssl/evp.h>
+
+#include <tls.h>
+#include <tls_internal.h>
+
+static const uint8_t ticket_nonce[TLS_TICKET_NONCE_SIZE];
+static const uint8_t ticket_data[] = "session state";
+
+static const struct tls_ticket_key *
+ticket_key_find(const struct tls_ticket_keys *keys, uint32_t keyrev)
+{
+	unsigned char key_name[TLS_TICKET_NAME_SIZE];
+	int i;
+
+	keyrev = htonl(keyrev);
+	memset(key_name, 0, sizeof(key_name));
+	memcpy(key_name, &keyrev, sizeof(keyrev));
+
+	for (i = 0; i < TLS_NUM_TICKETS; i++) {
+		if (keys->keys[i].aead_ctx == NULL)
+			break;
+		if (memcmp(keys->keys[i].key_name, key_name,
+		    sizeof(key_name)) == 0)
+			return &keys->keys[i];
+	}
+
+	return NULL;
+}
+
+static int
+add_ticket_key(struct tls_config *config, uint32_t keyrev)
+{
+	unsigned char key[TLS_TICKET_KEY_SIZE];
+
+	memset(key, keyrev, sizeof(key));
+
+	return tls_config_add_ticket_key(config, keyrev, key, sizeof(key));
+}
+
+static int
+ticket_seal(const struct tls_ticket_key *tk, uint8_t *out, size_t *out_len,
+    size_t max_out)
+{
+	return EVP_AEAD_CTX_seal(tk->aead_ctx, out, out_len, max_out,
+	    ticket_nonce, sizeof(ticket_nonce), ticket_data,
+	    sizeof(ticket_data), tk->key_name, sizeof(tk->key_name));
+}
+
+static int
+ticket_open(const struct tls_ticket_key *tk, const uint8_t *in, size_t in_len)
+{
+	uint8_t out[sizeof(ticket_data)];
+	size_t out_len;
+
+	if (!EVP_AEAD_CTX_open(tk->aead_ctx, out, &out_len, sizeof(out),
+	    ticket_nonce, sizeof(ticket_nonce), in, in_len, tk->key_name,
+	    sizeof(tk->key_name)))
+		return 0;
+
+	return out_len == sizeof(ticket_data) &&
+	    memcmp(out, ticket_data, out_len) == 0;
+}
+
+static int
+ticket_rotation_test(void)
+{
+	const struct tls_ticket_key *tk;
+	const struct tls_ticket_keys *keys1, *keys2;
+	struct tls_config *config;
+	uint8_t ticket[sizeof(ticket_data) + EVP_AEAD_MAX_TAG_LENGTH];
+	size_t ticket_len;
+	uint32_t keyrev;
+	int failed = 1;
+
+	if ((config = tls_config_new()) == NULL)
+		errx(1, "tls_config_new");
+
+	if (add_ticket_key(config, 1) != 0)
+		errx(1, "failed to add ticket key: %s",
+		    tls_config_error(config));
+	if (add_ticket_key(config, 1) != 0) {
+		fprintf(stderr, "FAIL: failed to re-add the current key\n");
+		goto failure;
+	}
+
+	/* Seal a ticket with the current key and hold on to the set. */
+	keys1 = tls_config_ticket_keys_acquire(config);
+	if (keys1 == NULL || (tk = ticket_key_find(keys1, 1)) == NULL ||
+	    tk != &keys1->keys[0]) {
+		fprintf(stderr, "FAIL: key 1 is not the primary key\n");
+		goto failure;
+	}
+	if (!ticket_seal(tk, ticket, &ticket_len, sizeof(ticket)))
+		errx(1, "failed to seal ticket");
+
+	/* Rotation retires the set, which must survive while it is held. */
+	if (add_ticket_key(config, 2) != 0)
+		errx(1, "failed to add ticket key: %s",
+		    tls_config_error(config));
+	if (add_ticket_key(config, 1) == 0) {
+		fprintf(stderr, "FAIL: re-added a previous key\n");
+		goto failure;
+	}
+	keys2 = config->ticket_keys;
+	if (keys2 == keys1) {
+		fprintf(stderr, "FAIL: key set not replaced\n");
+		goto failure;
+	}
+	if (config->ticket_keys_retired != keys1) {
+		fprintf(stderr, "FAIL: key set in use was not retired\n");
+		goto failure;
+	}
+	if (ticket_key_find(keys2, 2) != &keys2->keys[0]) {
+		fprintf(stderr, "FAIL: key 2 is not the primary key\n");
+		goto failure;
+	}
+
+	/* The ticket opens with both the held and the current set. */
+	if (!ticket_open(tk, ticket, ticket_len)) {
+		fprintf(stderr, "FAIL: failed to open ticket with the "
+		    "retired key set\n");
+		goto failure;
+	}
+	if ((tk = ticket_key_find(keys2, 1)) == NULL ||
+	    !ticket_open(tk, ticket, ticket_len)) {
+		fprintf(stderr, "FAIL: failed to open ticket with the "
+		    "retired key\n");
+		goto failure;
+	}
+
+	/* Releasing the last reader reclaims the retired set. */
+	tls_config_ticket_keys_release(config);
+	if (config->ticket_keys_retired != NULL) {
+		fprintf(stderr, "FAIL: retired key set not reclaimed on "
+		    "release\n");
+		goto failure;
+	}
+	if (config->ticket_keys_readers != 0) {
+		fprintf(stderr, "FAIL: %u readers after release\n",
+		    config->ticket_keys_readers);
+		goto failure;
+	}
+
+	/* Without readers, rotation frees the previous set immediately. */
+	for (keyrev = 3; keyrev < 3 + TLS_NUM_TICKETS; keyrev++) {
+		if (add_ticket_key(config, keyrev) != 0)
+			errx(1, "failed to add ticket key: %s",
+			    tls_config_error(config));
+		if (config->ticket_keys_retired != NULL) {
+			fprintf(stderr, "FAIL: unused key set retired\n");
+			goto failure;
+		}
+	}
+
+	/* The oldest keys are dropped from the current set. */
+	keys2 = config->ticket_keys;
+	if (ticket_key_find(keys2, 1) != NULL ||
+	    ticket_key_find(keys2, 2) != NULL) {
+		fprintf(stderr, "FAIL: expired keys still present\n");
+		goto failure;
+	}
+	if (ticket_key_find(keys2, 3) != &keys2->keys[TLS_NUM_TICKETS - 1]) {
+		fprintf(stderr, "FAIL: key 3 is not the oldest key\n");
+		goto failure;
+	}
+	if ((tk = ticket_key_find(keys2, 1 + TLS_NUM_TICKETS)) == NULL ||
+	    ticket_open(tk, ticket, ticket_len)) {
+		fprintf(stderr, "FAIL: opened ticket with the wrong key\n");
+		goto failure;
+	}
+
+	failed = 0;
+
+ failure:
+	tls_config_free(config);
+
+	return failed;
+}
+
+int
+main(int argc, char **argv)
+{
+	int failed = 0;
+
+	failed |= ticket_rotation_test();
+
+	return failed;
+}
@@ -291,6 +291,156 @@ test_tls_socket(struct tls *client, struct tls *server)
 	return (failure);
 }
 
+static void
+mem_transfer(char *name, struct tls *from, struct tls *to)
+{
+	const uint8_t *out;
+	uint8_t *in;
+	ssize_t in_len, out_len;
+
+	for (;;) {
+		if ((out_len = tls_mem_output(from, &out)) == -1)
+			errx(1, "%s output failed: %s", name, tls_error(from));
+		if (out_len == 0)
+			return;
+		if ((in_len = tls_mem_input(to, &in)) == -1)
+			errx(1, "%s input failed: %s", name, tls_error(to));
+		if (in_len > out_len)
+			in_len = out_len;
+		memcpy(in, out, in_len);
+		if (tls_mem_input_done(to, in_len) == -1)
+			errx(1, "%s input failed: %s", name, tls_error(to));
+		if (tls_mem_output_done(from, in_len) == -1)
+			errx(1, "%s output failed: %s", name, tls_error(from));
+	}
+}
+
+static int
+test_tls_mem(struct tls *client, struct tls *server)
+{
+	const uint8_t msg[] = "hello, world";
+	struct tls *server_cctx;
+	uint8_t buf[64], bulk[16384], *in;
+	const uint8_t *out;
+	int i, client_done, server_done;
+	size_t written;
+	ssize_t len;
+	int failure = 1;
+
+	if (tls_accept_mem(server, &server_cctx) == -1)
+		errx(1, "failed to accept: %s", tls_error(server));
+
+	if (tls_connect_mem(client, "test") == -1)
+		errx(1, "failed to connect: %s", tls_error(client));
+
+	if ((len = tls_mem_input(server_cctx, &in)) <= 0)
+		errx(1, "no input buffer: %s", tls_error(server_cctx));
+	if (tls_mem_input_done(server_cctx, len + 1) != -1) {
+		printf("FAIL: memory input overrun succeeded\n");
+		goto done;
+	}
+	if (tls_mem_input_done(server_cctx, 0) != -1) {
+		printf("FAIL: memory input without buffer succeeded\n");
+		goto done;
+	}
+	if (tls_mem_input(server_cctx, &in) <= 0)
+		errx(1, "no input buffer: %s", tls_error(server_cctx));
+	if (tls_mem_output(server_cctx, &out) != 0)
+		errx(1, "unexpected output: %s", tls_error(server_cctx));
+	if (tls_mem_input_done(server_cctx, 0) != -1) {
+		printf("FAIL: memory input after output succeeded\n");
+		goto done;
+	}
+
+	i = client_done = server_done = 0;
+	do {
+		if (client_done == 0)
+			client_done = do_tls_handshake("client", client);
+		mem_transfer("client", client, server_cctx);
+		if (server_done == 0)
+			server_done = do_tls_handshake("server", server_cctx);
+		mem_transfer("server", server_cctx, client);
+	} while (i++ < 100 && (client_done == 0 || server_done == 0));
+
+	if (client_done == 0 || server_done == 0) {
+		printf("FAIL: memory TLS handshake did not complete\n");
+		goto done;
+	}
+
+	printf("INFO: memory TLS handshake completed successfully\n");
+
+	if (tls_read(client, buf, sizeof(buf)) != TLS_WANT_POLLIN) {
+		printf("FAIL: memory TLS read without input did not block\n");
+		goto done;
+	}
+	if (tls_write(client, msg, sizeof(msg)) != sizeof(msg))
+		errx(1, "client write failed: %s", tls_error(client));
+	mem_transfer("client", client, server_cctx);
+	if ((len = tls_read(server_cctx, buf, sizeof(buf))) != sizeof(msg) ||
+	    memcmp(buf, msg, sizeof(msg)) != 0) {
+		printf("FAIL: memory TLS read returned %zd\n", len);
+		goto done;
+	}
+
+	/* Writes block once enough output is pending. */
+	memset(bulk, 'x', sizeof(bulk));
+	written = 0;
+	while ((len = tls_write(client, bulk, sizeof(bulk))) > 0) {
+		written += len;
+		if (written > 1024 * 1024)
+			break;
+	}
+	if (len != TLS_WANT_POLLOUT) {
+		printf("FAIL: memory TLS write did not block (%zd, %zu)\n",
+		    len, written);
+		goto done;
+	}
+	if (tls_mem_output(client, &out) < 64 * 1024) {
+		printf("FAIL: memory TLS write blocked early\n");
+		goto done;
+	}
+	mem_transfer("client", client, server_cctx);
+	if ((len = tls_write(client, bulk, sizeof(bulk))) <= 0) {
+		printf("FAIL: memory TLS write after output returned %zd\n",
+		    len);
+		goto done;
+	}
+	written += len;
+	mem_transfer("client", client, server_cctx);
+	while (written > 0) {
+		if ((len = tls_read(server_cctx, bulk, sizeof(bulk))) <= 0) {
+			printf("FAIL: memory TLS bulk read returned %zd\n",
+			    len);
+			goto done;
+		}
+		written -= len;
+	}
+
+	i = client_done = server_done = 0;
+	do {
+		if (client_done == 0)
+			client_done = do_tls_close("client", client);
+		mem_transfer("client", client, server_cctx);
+		if (server_done == 0)
+			server_done = do_tls_close("server", server_cctx);
+		mem_transfer("server", server_cctx, client);
+	} while (i++ < 100 && (client_done == 0 || server_done == 0));
+
+	if (client_done == 0 || server_done == 0) {
+		printf("FAIL: memory TLS close did not complete\n");
+		goto done;
+	}
+
+	printf("INFO: memory TLS close completed successfully\n");
+
+	failure = 0;
+
+ done:
+	tls_free(server_cctx);
+
+	return (failure);
+}
+
 static int
 test_tls(char *client_protocols, char *server_protocols, char *ciphers)
 {
@@ -387,6 +537,15 @@ do_tls_tests(void)
 
 	failure |= test_tls_fds(client, server);
 
+	tls_reset(client);
+	if (tls_configure(client, client_cfg) == -1)
+		errx(1, "failed to configure client: %s", tls_error(client));
+	tls_reset(server);
+	if (tls_configure(server, server_cfg) == -1)
+		errx(1, "failed to configure server: %s", tls_error(server));
+
+	failure |= test_tls_socket(client, server);
+
 	tls_reset(client);
 	if (tls_configure(client, client_cfg) == -1)
 		errx(1, "failed to configure client: %s", tls_error(client));
@@ -397,7 +556,7 @@ do_tls_tests(void)
 	tls_config_free(client_cfg);
 	tls_config_free(server_cfg);
 
-	failure |= test_tls_socket(client, server);
+	failure |= test_tls_mem(client, server);
 
 	tls_free(client);
 	tls_free(server);
@@ -1790,6 +1790,12 @@ function test_server_client {
 		$c_bin s_time -connect $host:$port -CApath $ca_dir -time 1 \
 			> $server_dir/s_time_${sc}.log
 		check_exit_status $?
+
+		start_message "s_time ... concurrent connections"
+		$c_bin s_time -connect $host:$port -CApath $ca_dir -time 1 \
+			-threads 2 -concurrency 2 -resume_ratio 50 \
+			> $server_dir/s_time_concurrent_${sc}.log
+		check_exit_status $?
 	fi
 
 	stop_s_server
@@ -1860,6 +1866,49 @@ function test_server_client_dtls {
 	stop_s_server
 }
 
+function test_server_workers {
+	# --- client/server operations (s_server workers) ---
+	section_message "client/server operations (s_server workers)"
+
+	host="localhost"
+	port=4433
+	size=100000
+	s_server_out=$server_dir/s_server_workers.out
+
+	start_message "s_server ... start TLS/SSL test server with workers"
+	$openssl_bin s_server -accept $port -CAfile $ca_cert \
+		-cert $sv_rsa_cert -key $sv_rsa_key -pass pass:$sv_rsa_pass \
+		-workers 2 -response_size $size -4 \
+		> $s_server_out 2>&1 &
+	check_exit_status $?
+	s_server_pid=$!
+	echo "s_server pid = [ $s_server_pid ]"
+	sleep 1
+
+	for i in 1 2 ; do
+		s_client_out=$user1_dir/s_client_workers_$i.out
+
+		start_message "s_client ... request $size bytes from workers ($i)"
+		printf 'GET / HTTP/1.0\r\n\r\n' | \
+			$openssl_bin s_client -connect $host:$port \
+			-CAfile $ca_cert -quiet > $s_client_out 2> /dev/null
+		check_exit_status $?
+
+		grep "^HTTP/1.0 200 ok" $s_client_out > /dev/null
+		check_exit_status $?
+
+		grep "^Content-length: $size" $s_client_out > /dev/null
+		check_exit_status $?
+
+		# The body is a single line, after the header lines.
+		len=`grep -v '^[A-Z]' $s_client_out | tr -d '\r\n' | wc -c`
+		test $len -eq $size
+		check_exit_status $?
+	done
+
+	stop_s_server
+}
+
 function test_gnutls {
 	# --- GnuTLS interoperability ---
 	section_message "GnuTLS $1 interoperability"
@@ -2067,6 +2116,7 @@ if [ $interop_tests = 1 ] ; then
 	test_server_client_dtls 0 1
 	test_server_client_dtls 1 0
 fi
+test_server_workers
 if [ $gnutls_tests = 1 ] ; then
 	test_gnutls tls
 	test_gnutls dtls
@@ -33,6 +33,7 @@
  */
 
 #include <sys/types.h>
+#include <sys/resource.h>
 #include <sys/socket.h>
 #include <sys/uio.h>
 #include <sys/un.h>
@@ -74,6 +75,7 @@
 #define TLS_MUSTSTAPLE	(1 << 4)
 
 /* Command Line Options */
+int	Bflag;					/* Bulk transfer buffer size */
 int	dflag;					/* detached, no stdin */
 int	Fflag;					/* fdpass sock to stdout */
 unsigned int iflag;				/* Interval Flag */
@@ -111,6 +113,7 @@ char	*tls_protocols;				/* TLS protocols */
 FILE	*Zflag;					/* file to save peer cert */
 
 int recvcount, recvlimit;
+size_t bufsize = BUFSIZE;
 int timeout = -1;
 int family = AF_UNSPEC;
 char *portlist[PORT_MAX+1];
@@ -144,6 +147,8 @@ void	report_tls(struct tls *tls_ctx, char * host);
 void	usage(int);
 ssize_t drainbuf(int, unsigned char *, size_t *, struct tls *);
 ssize_t fillbuf(int, unsigned char *, size_t *, struct tls *);
+void	report_bulk(const struct timespec *, unsigned long long,
+	    unsigned long long);
 void	tls_setup_client(struct tls *, int, char *);
 struct tls *tls_setup_server(struct tls *, int, char *);
 
@@ -173,7 +178,7 @@ main(int argc, char *argv[])
 	signal(SIGPIPE, SIG_IGN);
 
 	while ((ch = getopt(argc, argv,
-	    "46C:cDde:FH:hI:i:K:klM:m:NnO:o:P:p:R:rSs:T:tUuV:vW:w:X:x:Z:z"))
+	    "46B:C:cDde:FH:hI:i:K:klM:m:NnO:o:P:p:R:rSs:T:tUuV:vW:w:X:x:Z:z"))
 	    != -1) {
 		switch (ch) {
 		case '4':
@@ -302,6 +307,13 @@ main(int argc, char *argv[])
 		case 'z':
 			zflag = 1;
 			break;
+		case 'B':
+			Bflag = strtonum(optarg, 1, 65536 << 14, &errstr);
+			if (errstr != NULL)
+				errx(1, "buffer length %s: %s",
+				    errstr, optarg);
+			bufsize = Bflag;
+			break;
 		case 'D':
 			Dflag = 1;
 			break;
@@ -1100,19 +1112,28 @@ void
 readwrite(int net_fd, struct tls *tls_ctx)
 {
 	struct pollfd pfd[4];
+	struct timespec start;
 	int stdin_fd = STDIN_FILENO;
 	int stdout_fd = STDOUT_FILENO;
-	unsigned char netinbuf[BUFSIZE];
+	unsigned char *netinbuf = NULL;
 	size_t netinbufpos = 0;
-	unsigned char stdinbuf[BUFSIZE];
+	unsigned char *stdinbuf = NULL;
 	size_t stdinbufpos = 0;
-	int n, num_fds;
+	unsigned long long sent = 0, received = 0;
+	int n, num_fds, stdin_read;
 	ssize_t ret;
 
 	/* don't read from stdin if requested */
 	if (dflag)
 		stdin_fd = -1;
 
+	if ((stdinbuf = malloc(bufsize)) == NULL ||
+	    (netinbuf = malloc(bufsize)) == NULL)
+		err(1, NULL);
+
+	if (Bflag && vflag)
+		clock_gettime(CLOCK_MONOTONIC, &start);
+
 	/* stdin */
 	pfd[POLL_STDIN].fd = stdin_fd;
 	pfd[POLL_STDIN].events = POLLIN;
@@ -1133,14 +1154,14 @@ readwrite(int net_fd, struct tls *tls_ctx)
 		/* both inputs are gone, buffers are empty, we are done */
 		if (pfd[POLL_STDIN].fd == -1 && pfd[POLL_NETIN].fd == -1 &&
 		    stdinbufpos == 0 && netinbufpos == 0)
-			return;
+			goto done;
 		/* both outputs are gone, we can't continue */
 		if (pfd[POLL_NETOUT].fd == -1 && pfd[POLL_STDOUT].fd == -1)
-			return;
+			goto done;
 		/* listen and net in gone, queues empty, done */
 		if (lflag && pfd[POLL_NETIN].fd == -1 &&
 		    stdinbufpos == 0 && netinbufpos == 0)
-			return;
+			goto done;
 
 		/* help says -i is for "wait between lines sent". We read and
 		 * write arbitrary amounts of data, and we don't want to start
@@ -1157,7 +1178,7 @@ readwrite(int net_fd, struct tls *tls_ctx)
 
 		/* timeout happened */
 		if (num_fds == 0)
-			return;
+			goto done;
 
 		/* treat socket error conditions */
 		for (n = 0; n < 4; n++) {
@@ -1195,7 +1216,9 @@ readwrite(int net_fd, struct tls *tls_ctx)
 		}
 
 		/* try to read from stdin */
-		if (pfd[POLL_STDIN].revents & POLLIN && stdinbufpos < BUFSIZE) {
+		stdin_read = 0;
+		if (pfd[POLL_STDIN].revents & POLLIN &&
+		    stdinbufpos < bufsize) {
 			ret = fillbuf(pfd[POLL_STDIN].fd, stdinbuf,
 			    &stdinbufpos, NULL);
 			if (ret == TLS_WANT_POLLIN)
@@ -1204,13 +1227,22 @@ readwrite(int net_fd, struct tls *tls_ctx)
 				pfd[POLL_STDIN].events = POLLOUT;
 			else if (ret == 0 || ret == -1)
 				pfd[POLL_STDIN].fd = -1;
+			else
+				stdin_read = 1;
 			/* read something - poll net out */
 			if (stdinbufpos > 0)
 				pfd[POLL_NETOUT].events = POLLOUT;
 			/* filled buffer - remove self from polling */
-			if (stdinbufpos == BUFSIZE)
+			if (stdinbufpos == bufsize)
 				pfd[POLL_STDIN].events = 0;
 		}
+		/*
+		 * In bulk mode, hold back small TLS writes while stdin
+		 * still has data so that full records go out.
+		 */
+		if (Bflag && tls_ctx != NULL && stdin_read &&
+		    stdinbufpos < BUFSIZE)
+			pfd[POLL_NETOUT].revents &= ~POLLOUT;
 		/* try to write to network */
 		if (pfd[POLL_NETOUT].revents & POLLOUT && stdinbufpos > 0) {
 			ret = drainbuf(pfd[POLL_NETOUT].fd, stdinbuf,
@@ -1221,15 +1253,18 @@ readwrite(int net_fd, struct tls *tls_ctx)
 				pfd[POLL_NETOUT].events = POLLOUT;
 			else if (ret == -1)
 				pfd[POLL_NETOUT].fd = -1;
+			else if (ret > 0)
+				sent += ret;
 			/* buffer empty - remove self from polling */
 			if (stdinbufpos == 0)
 				pfd[POLL_NETOUT].events = 0;
 			/* buffer no longer full - poll stdin again */
-			if (stdinbufpos < BUFSIZE)
+			if (stdinbufpos < bufsize)
 				pfd[POLL_STDIN].events = POLLIN;
 		}
 		/* try to read from network */
-		if (pfd[POLL_NETIN].revents & POLLIN && netinbufpos < BUFSIZE) {
+		if (pfd[POLL_NETIN].revents & POLLIN &&
+		    netinbufpos < bufsize) {
 			ret = fillbuf(pfd[POLL_NETIN].fd, netinbuf,
 			    &netinbufpos, tls_ctx);
 			if (ret == TLS_WANT_POLLIN)
@@ -1238,6 +1273,8 @@ readwrite(int net_fd, struct tls *tls_ctx)
 				pfd[POLL_NETIN].events = POLLOUT;
 			else if (ret == -1)
 				pfd[POLL_NETIN].fd = -1;
+			else if (ret > 0)
+				received += ret;
 			/* eof on net in - remove from pfd */
 			if (ret == 0) {
 				shutdown(pfd[POLL_NETIN].fd, SHUT_RD);
@@ -1253,7 +1290,7 @@ readwrite(int net_fd, struct tls *tls_ctx)
 			if (netinbufpos > 0)
 				pfd[POLL_STDOUT].events = POLLOUT;
 			/* filled buffer - remove self from polling */
-			if (netinbufpos == BUFSIZE)
+			if (netinbufpos == bufsize)
 				pfd[POLL_NETIN].events = 0;
 			/* handle telnet */
 			if (tflag)
@@ -1274,7 +1311,7 @@ readwrite(int net_fd, struct tls *tls_ctx)
 			if (netinbufpos == 0)
 				pfd[POLL_STDOUT].events = 0;
 			/* buffer no longer full - poll net in again */
-			if (netinbufpos < BUFSIZE)
+			if (netinbufpos < bufsize)
 				pfd[POLL_NETIN].events = POLLIN;
 		}
 
@@ -1289,54 +1326,106 @@ readwrite(int net_fd, struct tls *tls_ctx)
 			pfd[POLL_STDOUT].fd = -1;
 		}
 	}
+
+ done:
+	if (Bflag && vflag)
+		report_bulk(&start, sent, received);
+	free(stdinbuf);
+	free(netinbuf);
 }
 
 ssize_t
 drainbuf(int fd, unsigned char *buf, size_t *bufpos, struct tls *tls)
 {
+	size_t off = 0;
 	ssize_t n;
 	ssize_t adjust;
 
-	if (tls) {
-		n = tls_write(tls, buf, *bufpos);
-		if (n == -1)
-			errx(1, "tls write failed (%s)", tls_error(tls));
-	} else {
-		n = write(fd, buf, *bufpos);
-		/* don't treat EAGAIN, EINTR as error */
-		if (n == -1 && (errno == EAGAIN || errno == EINTR))
-			n = TLS_WANT_POLLOUT;
-	}
-	if (n <= 0)
+	/*
+	 * In bulk mode keep handing the whole buffer to TLS, which cuts
+	 * it into full sized records, until the socket is full.
+	 */
+	do {
+		if (tls) {
+			n = tls_write(tls, buf + off, *bufpos - off);
+			if (n == -1)
+				errx(1, "tls write failed (%s)",
+				    tls_error(tls));
+		} else {
+			n = write(fd, buf + off, *bufpos - off);
+			/* don't treat EAGAIN, EINTR as error */
+			if (n == -1 && (errno == EAGAIN || errno == EINTR))
+				n = TLS_WANT_POLLOUT;
+		}
+		if (n <= 0)
+			break;
+		off += n;
+	} while (Bflag && tls && off < *bufpos);
+	if (off == 0)
 		return n;
 	/* adjust buffer */
-	adjust = *bufpos - n;
+	adjust = *bufpos - off;
 	if (adjust > 0)
-		memmove(buf, buf + n, adjust);
-	*bufpos -= n;
-	return n;
+		memmove(buf, buf + off, adjust);
+	*bufpos -= off;
+	return off;
 }
 
 ssize_t
 fillbuf(int fd, unsigned char *buf, size_t *bufpos, struct tls *tls)
 {
-	size_t num = BUFSIZE - *bufpos;
+	size_t num = 0;
 	ssize_t n;
 
-	if (tls) {
-		n = tls_read(tls, buf + *bufpos, num);
-		if (n == -1)
-			errx(1, "tls read failed (%s)", tls_error(tls));
-	} else {
-		n = read(fd, buf + *bufpos, num);
-		/* don't treat EAGAIN, EINTR as error */
-		if (n == -1 && (errno == EAGAIN || errno == EINTR))
-			n = TLS_WANT_POLLIN;
-	}
-	if (n <= 0)
+	/* In bulk mode, decrypt as many records as fit into the buffer. */
+	do {
+		if (tls) {
+			n = tls_read(tls, buf + *bufpos, bufsize - *bufpos);
+			if (n == -1)
+				errx(1, "tls read failed (%s)", tls_error(tls));
+		} else {
+			n = read(fd, buf + *bufpos, bufsize - *bufpos);
+			/* don't treat EAGAIN, EINTR as error */
+			if (n == -1 && (errno == EAGAIN || errno == EINTR))
+				n = TLS_WANT_POLLIN;
+		}
+		if (n <= 0)
+			break;
+		*bufpos += n;
+		num += n;
+	} while (Bflag && tls && *bufpos < bufsize);
+	if (num == 0)
 		return n;
-	*bufpos += n;
-	return n;
+	return num;
+}
+
+/*
+ * report_bulk()
+ * Print the amount of data moved, the throughput and the CPU time used.
+ */
+void
+report_bulk(const struct timespec *start, unsigned long long sent,
+    unsigned long long received)
+{
+	struct timespec now, elapsed;
+	struct rusage ru;
+	double secs;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	timespecsub(&now, start, &elapsed);
+	secs = elapsed.tv_sec + elapsed.tv_nsec / 1e9;
+	if (getrusage(RUSAGE_SELF, &ru) == -1)
+		err(1, "getrusage");
+
+	fprintf(stderr, "Sent %llu bytes, received %llu bytes in %lld.%03ld "
+	    "seconds", sent, received, (long long)elapsed.tv_sec,
+	    elapsed.tv_nsec / 1000000);
+	if (secs > 0)
+		fprintf(stderr, " (%.1f MB/s)",
+		    (sent + received) / secs / 1000000);
+	fprintf(stderr, "\nCPU time %lld.%03ld user, %lld.%03ld system\n",
+	    (long long)ru.ru_utime.tv_sec, ru.ru_utime.tv_usec / 1000,
+	    (long long)ru.ru_stime.tv_sec, ru.ru_stime.tv_usec / 1000);
 }
 
 /*
@@ -1807,6 +1896,7 @@ help(void)
 	fprintf(stderr, "\tCommand Summary:\n\
 	\t-4		Use IPv4\n\
 	\t-6		Use IPv6\n\
+	\t-B length	Bulk transfer mode with buffer length\n\
 	\t-C certfile	Public key file\n\
 	\t-c		Use TLS\n\
 	\t-D		Enable the debug socket option\n\
@@ -1852,16 +1942,15 @@ void
 usage(int ret)
 {
 	fprintf(stderr,
-	    "usage: nc [-46cDdFhklNnrStUuvz] [-C certfile] [-e name] "
-	    "[-H hash] [-I length]\n"
-	    "\t  [-i interval] [-K keyfile] [-M ttl] [-m minttl] [-O length]\n"
-	    "\t  [-o staplefile] [-P proxy_username] [-p source_port] "
-	    "[-R CAfile]\n"
-	    "\t  [-s sourceaddr] [-T keyword] [-V rtable] [-W recvlimit] "
-	    "[-w timeout]\n"
-	    "\t  [-X proxy_protocol] [-x proxy_address[:port]] "
-	    "[-Z peercertfile]\n"
-	    "\t  [destination] [port]\n");
+	    "usage: nc [-46cDdFhklNnrStUuvz] [-B length] [-C certfile] "
+	    "[-e name] [-H hash]\n"
+	    "\t  [-I length] [-i interval] [-K keyfile] [-M ttl] [-m minttl]\n"
+	    "\t  [-O length] [-o staplefile] [-P proxy_username] "
+	    "[-p source_port]\n"
+	    "\t  [-R CAfile] [-s sourceaddr] [-T keyword] [-V rtable] "
+	    "[-W recvlimit]\n"
+	    "\t  [-w timeout] [-X proxy_protocol] [-x proxy_address[:port]]\n"
+	    "\t  [-Z peercertfile] [destination] [port]\n");
 	if (ret)
 		exit(1);
 }
@@ -411,6 +411,15 @@ main(int argc, char **argv)
 
 	openssl_startup();
 
+	if ((p = getenv("OPENSSL_CPU_CAPS_DISABLE")) != NULL) {
+		if (!OPENSSL_cpu_caps_disable(p)) {
+			BIO_printf(bio_err, "invalid OPENSSL_CPU_CAPS_DISABLE "
+			    "value: %s\n", p);
+			ERR_print_errors(bio_err);
+			exit(1);
+		}
+	}
+
 	/* Lets load up our environment a little */
 	p = getenv("OPENSSL_CONF");
 	if (p == NULL) {
@@ -121,6 +121,7 @@ extern int verify_return_error;
 int do_server(int port, int type, int *ret,
     int (*cb)(int s, unsigned char *context),
     unsigned char *context, int naccept);
+int init_server(int *sock, int port, int type);
 #ifdef HEADER_X509_H
 int verify_callback(int ok, X509_STORE_CTX *ctx);
 #endif
@@ -151,6 +151,10 @@
 
 #include <assert.h>
 #include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <limits.h>
@@ -187,6 +191,7 @@ static int init_ssl_connection(SSL *s);
 static DH *load_dh_param(const char *dhfile);
 #endif
 static int www_body(int s, unsigned char *context);
+static int serve_workers(void);
 static int generate_session_id(const SSL *ssl, unsigned char *id,
     unsigned int *id_len);
 static int ssl_servername_cb(SSL *s, int *ad, void *arg);
@@ -280,6 +285,7 @@ static struct {
 	char *passarg;
 	short port;
 	int quiet;
+	int response_size;
 	int server_verify;
 	char *session_id_prefix;
 	long socket_mtu;
@@ -293,6 +299,7 @@ static struct {
 	int tlsextdebug;
 	int tlsextstatus;
 	X509_VERIFY_PARAM *vpm;
+	int workers;
 	int www;
 } cfg;
 
@@ -887,6 +894,14 @@ static const struct option s_server_options[] = {
 		.opt.value = &cfg.tlsextcbp.extension_error,
 		.value = SSL_TLSEXT_ERR_ALERT_FATAL,
 	},
+	{
+		.name = "response_size",
+		.argname = "bytes",
+		.desc = "Size of the response body sent by -workers "
+		    "(default 1024)",
+		.type = OPTION_ARG_INT,
+		.opt.value = &cfg.response_size,
+	},
 	{
 		.name = "serverpref",
 		.desc = "Use server's cipher preferences",
@@ -993,6 +1008,14 @@ static const struct option s_server_options[] = {
 		.type = OPTION_FLAG,
 		.opt.flag = &verify_return_error,
 	},
+	{
+		.name = "workers",
+		.argname = "num",
+		.desc = "Serve fixed size responses to many concurrent "
+		    "connections from num threads",
+		.type = OPTION_ARG_INT,
+		.opt.value = &cfg.workers,
+	},
 	{
 		.name = "WWW",
 		.desc = "Respond to a 'GET /<path> HTTP/1.0' with file ./<path>",
@@ -1057,13 +1080,13 @@ sv_usage(void)
 	    "    [-named_curve arg] [-nbio] [-nbio_test] [-no_cache]\n"
 	    "    [-no_dhe] [-no_ecdhe] [-no_ticket] [-no_tls1]\n"
 	    "    [-no_tls1_1] [-no_tls1_2] [-no_tls1_3] [-no_tmp_rsa]\n"
-	    "    [-nocert] [-pass arg] [-quiet] [-servername name]\n"
-	    "    [-servername_fatal] [-serverpref] [-state] [-status]\n"
-	    "    [-status_timeout nsec] [-status_url url]\n"
-	    "    [-status_verbose] [-timeout] [-tls1] [-tls1_1]\n"
-	    "    [-tls1_2] [-tls1_3] [-tlsextdebug] [-use_srtp profiles]\n"
-	    "    [-Verify depth] [-verify depth] [-verify_return_error]\n"
-	    "    [-WWW] [-www]\n");
+	    "    [-nocert] [-pass arg] [-quiet] [-response_size bytes]\n"
+	    "    [-servername name] [-servername_fatal] [-serverpref]\n"
+	    "    [-state] [-status] [-status_timeout nsec]\n"
+	    "    [-status_url url] [-status_verbose] [-timeout] [-tls1]\n"
+	    "    [-tls1_1] [-tls1_2] [-tls1_3] [-tlsextdebug]\n"
+	    "    [-use_srtp profiles] [-Verify depth] [-verify depth]\n"
+	    "    [-verify_return_error] [-workers num] [-WWW] [-www]\n");
 	fprintf(stderr, "\n");
 	options_usage(s_server_options);
 	fprintf(stderr, "\n");
@@ -1091,6 +1114,7 @@ s_server_main(int argc, char *argv[])
 	cfg.meth = TLS_server_method();
 	cfg.naccept = -1;
 	cfg.port = PORT;
+	cfg.response_size = 1024;
 	cfg.cert_file = TEST_CERT;
 	cfg.cert_file2 = TEST_CERT2;
 	cfg.cert_format = FORMAT_PEM;
@@ -1116,6 +1140,31 @@ s_server_main(int argc, char *argv[])
 		goto end;
 	}
 
+	if (cfg.workers < 0 || cfg.workers > 256) {
+		BIO_printf(bio_err, "-workers must be between 1 and 256\n");
+		goto end;
+	}
+	if (cfg.workers > 0 && cfg.socket_type != SOCK_STREAM) {
+		BIO_printf(bio_err, "-workers cannot be used with DTLS\n");
+		goto end;
+	}
+	/*
+	 * The callbacks for these options print to shared BIOs and keep
+	 * global state, neither of which may be used from multiple threads.
+	 */
+	if (cfg.workers > 0 && (cfg.tlsextcbp.servername != NULL ||
+	    cfg.tlsextstatus || cfg.debug || cfg.msg || cfg.state ||
+	    cfg.tlsextdebug)) {
+		BIO_printf(bio_err, "-workers cannot be used with -debug, "
+		    "-msg, -servername, -state, -status or -tlsextdebug\n");
+		goto end;
+	}
+	if (cfg.response_size < 0 || cfg.response_size > 64 * 1024 * 1024) {
+		BIO_printf(bio_err, "-response_size must be between 0 and "
+		    "%d\n", 64 * 1024 * 1024);
+		goto end;
+	}
+
 	if (!app_passwd(bio_err, cfg.passarg,
 	    cfg.dpassarg, &pass, &dpass)) {
 		BIO_printf(bio_err, "Error getting password\n");
@@ -1464,7 +1513,10 @@ s_server_main(int argc, char *argv[])
 	}
 	BIO_printf(bio_s_out, "ACCEPT\n");
 	(void) BIO_flush(bio_s_out);
-	if (cfg.www)
+	if (cfg.workers > 0) {
+		if (!serve_workers())
+			goto end;
+	} else if (cfg.www)
 		do_server(cfg.port, cfg.socket_type,
 		    &accept_socket, www_body, cfg.context,
 		    cfg.naccept);
@@ -2476,3 +2528,410 @@ alpn_cb(SSL *s, const unsigned char **out, unsigned char *outlen,
 
 	return (SSL_TLSEXT_ERR_OK);
 }
+
+/*
+ * Worker mode - each worker thread runs its own non-blocking event loop,
+ * accepting connections from the shared listening socket and answering
+ * every request with a fixed size response. This allows the handshake and
+ * record layer throughput of libssl to be measured with thousands of
+ * concurrent connections, which the one connection at a time loop of
+ * do_server() cannot provide.
+ */
+
+#define WORKER_WRITE_SIZE	16384
+#define WORKER_ACCEPT_BATCH	64
+
+enum worker_conn_state {
+	WORKER_HANDSHAKE,
+	WORKER_REQUEST,
+	WORKER_RESPONSE,
+};
+
+struct worker_conn {
+	SSL *ssl;
+	int fd;
+	enum worker_conn_state state;
+	short events;
+	size_t request_match;
+	size_t response_off;
+};
+
+struct worker {
+	pthread_t thread;
+	struct worker_conn *conns;
+	struct pollfd *pfds;
+	size_t nconns;
+	size_t maxconns;
+	long connections;
+	long resumed;
+	long failed;
+	unsigned long long bytes_written;
+};
+
+static pthread_mutex_t worker_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int worker_naccept;
+static char *worker_response;
+static size_t worker_response_len;
+
+/*
+ * Reserve one of the remaining connections allowed by -naccept, if any.
+ */
+static int
+worker_accept_reserve(void)
+{
+	int ret = 1;
+
+	pthread_mutex_lock(&worker_mutex);
+	if (worker_naccept == 0)
+		ret = 0;
+	else if (worker_naccept > 0)
+		worker_naccept--;
+	pthread_mutex_unlock(&worker_mutex);
+
+	return ret;
+}
+
+static void
+worker_accept_release(void)
+{
+	pthread_mutex_lock(&worker_mutex);
+	if (worker_naccept >= 0)
+		worker_naccept++;
+	pthread_mutex_unlock(&worker_mutex);
+}
+
+static int
+worker_accepting(void)
+{
+	int ret;
+
+	pthread_mutex_lock(&worker_mutex);
+	ret = worker_naccept != 0;
+	pthread_mutex_unlock(&worker_mutex);
+
+	return ret;
+}
+
+static void
+worker_conn_close(struct worker_conn *conn)
+{
+	SSL_free(conn->ssl);
+	if (conn->fd != -1)
+		close(conn->fd);
+
+	conn->ssl = NULL;
+	conn->fd = -1;
+}
+
+static void
+worker_conn_done(struct worker *w, struct worker_conn *conn)
+{
+	SSL_shutdown(conn->ssl);
+	w->connections++;
+	worker_conn_close(conn);
+}
+
+static void
+worker_conn_want(struct worker *w, struct worker_conn *conn, int ret)
+{
+	switch (SSL_get_error(conn->ssl, ret)) {
+	case SSL_ERROR_WANT_READ:
+		conn->events = POLLIN;
+		return;
+	case SSL_ERROR_WANT_WRITE:
+		conn->events = POLLOUT;
+		return;
+	}
+
+	w->failed++;
+	worker_conn_close(conn);
+}
+
+/* Look for the blank line that terminates an HTTP request. */
+static int
+worker_request_complete(struct worker_conn *conn, const char *buf,
+    size_t len)
+{
+	static const char eoh[] = "\r\n\r\n";
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		if (buf[i] == eoh[conn->request_match])
+			conn->request_match++;
+		else if (buf[i] == eoh[0])
+			conn->request_match = 1;
+		else
+			conn->request_match = 0;
+		if (conn->request_match == sizeof(eoh) - 1)
+			return 1;
+	}
+
+	return 0;
+}
+
+static void
+worker_conn_io(struct worker *w, struct worker_conn *conn)
+{
+	char buf[4096];
+	size_t len;
+	int ret;
+
+	switch (conn->state) {
+	case WORKER_HANDSHAKE:
+		if ((ret = SSL_accept(conn->ssl)) != 1) {
+			worker_conn_want(w, conn, ret);
+			return;
+		}
+		if (SSL_session_reused(conn->ssl))
+			w->resumed++;
+		conn->state = WORKER_REQUEST;
+		/* FALLTHROUGH */
+
+	case WORKER_REQUEST:
+		do {
+			if ((ret = SSL_read(conn->ssl, buf,
+			    sizeof(buf))) <= 0) {
+				switch (SSL_get_error(conn->ssl, ret)) {
+				case SSL_ERROR_WANT_READ:
+				case SSL_ERROR_WANT_WRITE:
+					worker_conn_want(w, conn, ret);
+					return;
+				}
+				/* Closed after the handshake, without a request. */
+				worker_conn_done(w, conn);
+				return;
+			}
+		} while (!worker_request_complete(conn, buf, ret));
+		conn->state = WORKER_RESPONSE;
+		/* FALLTHROUGH */
+
+	case WORKER_RESPONSE:
+		while (conn->response_off < worker_response_len) {
+			len = worker_response_len - conn->response_off;
+			if (len > WORKER_WRITE_SIZE)
+				len = WORKER_WRITE_SIZE;
+			if ((ret = SSL_write(conn->ssl,
+			    worker_response + conn->response_off, len)) <= 0) {
+				worker_conn_want(w, conn, ret);
+				return;
+			}
+			conn->response_off += ret;
+			w->bytes_written += ret;
+		}
+		worker_conn_done(w, conn);
+		return;
+	}
+}
+
+static int
+worker_grow(struct worker *w)
+{
+	struct worker_conn *conns;
+	struct pollfd *pfds;
+	size_t maxconns;
+
+	maxconns = w->maxconns * 2;
+
+	if ((conns = recallocarray(w->conns, w->maxconns, maxconns,
+	    sizeof(*conns))) == NULL)
+		return 0;
+	w->conns = conns;
+
+	/* The first poll entry is used for the listening socket. */
+	if ((pfds = recallocarray(w->pfds, w->maxconns + 1, maxconns + 1,
+	    sizeof(*pfds))) == NULL)
+		return 0;
+	w->pfds = pfds;
+
+	w->maxconns = maxconns;
+
+	return 1;
+}
+
+static void
+worker_accept(struct worker *w)
+{
+	struct worker_conn *conn;
+	int i, fd;
+
+	for (i = 0; i < WORKER_ACCEPT_BATCH; i++) {
+		if (w->nconns == w->maxconns && !worker_grow(w))
+			return;
+		if (!worker_accept_reserve())
+			return;
+
+		if ((fd = accept4(accept_socket, NULL, NULL,
+		    SOCK_NONBLOCK)) == -1) {
+			worker_accept_release();
+			return;
+		}
+
+		conn = &w->conns[w->nconns];
+		memset(conn, 0, sizeof(*conn));
+		conn->fd = fd;
+		conn->state = WORKER_HANDSHAKE;
+		conn->events = POLLIN;
+
+		if ((conn->ssl = SSL_new(ctx)) == NULL ||
+		    !SSL_set_fd(conn->ssl, fd)) {
+			w->failed++;
+			worker_conn_close(conn);
+			continue;
+		}
+		SSL_set_accept_state(conn->ssl);
+
+		w->nconns++;
+	}
+}
+
+static void *
+worker_run(void *arg)
+{
+	struct worker *w = arg;
+	size_t i, j, npolled;
+	int accepting;
+
+	for (;;) {
+		if (!(accepting = worker_accepting()) && w->nconns == 0)
+			break;
+
+		w->pfds[0].fd = accepting ? accept_socket : -1;
+		w->pfds[0].events = POLLIN;
+		w->pfds[0].revents = 0;
+		for (i = 0; i < w->nconns; i++) {
+			w->pfds[i + 1].fd = w->conns[i].fd;
+			w->pfds[i + 1].events = w->conns[i].events;
+			w->pfds[i + 1].revents = 0;
+		}
+		npolled = w->nconns;
+
+		/* Wake periodically, so that -naccept is noticed. */
+		if (poll(w->pfds, npolled + 1, 1000) == -1) {
+			if (errno == EINTR)
+				continue;
+			BIO_printf(bio_err, "poll: %s\n", strerror(errno));
+			break;
+		}
+
+		for (i = 0; i < npolled; i++) {
+			if (w->pfds[i + 1].revents != 0)
+				worker_conn_io(w, &w->conns[i]);
+		}
+
+		/* Drop closed connections, preserving poll order. */
+		for (i = j = 0; i < w->nconns; i++) {
+			if (w->conns[i].fd == -1)
+				continue;
+			if (i != j)
+				w->conns[j] = w->conns[i];
+			j++;
+		}
+		w->nconns = j;
+
+		if (w->pfds[0].revents & POLLIN)
+			worker_accept(w);
+	}
+
+	for (i = 0; i < w->nconns; i++)
+		worker_conn_close(&w->conns[i]);
+	w->nconns = 0;
+
+	return NULL;
+}
+
+static int
+serve_workers(void)
+{
+	struct worker *workers = NULL, *w;
+	long connections = 0, resumed = 0, failed = 0;
+	unsigned long long bytes_written = 0;
+	int header_len, started = 0;
+	int error, i;
+	int ret = 0;
+
+	if ((worker_response = malloc(256 + cfg.response_size)) == NULL)
+		goto err;
+	header_len = snprintf(worker_response, 256, "HTTP/1.0 200 ok\r\n"
+	    "Content-type: text/plain\r\nContent-length: %d\r\n\r\n",
+	    cfg.response_size);
+	if (header_len < 0 || header_len >= 256)
+		goto err;
+	memset(worker_response + header_len, 'x', cfg.response_size);
+	worker_response_len = header_len + cfg.response_size;
+
+	worker_naccept = cfg.naccept;
+
+	if (!init_server(&accept_socket, cfg.port, cfg.socket_type))
+		goto err;
+	/* Allow for bursts of many concurrent connection attempts. */
+	if (listen(accept_socket, SOMAXCONN) == -1) {
+		BIO_printf(bio_err, "listen: %s\n", strerror(errno));
+		goto err;
+	}
+	if (fcntl(accept_socket, F_SETFL, O_NONBLOCK) == -1) {
+		BIO_printf(bio_err, "fcntl: %s\n", strerror(errno));
+		goto err;
+	}
+
+	signal(SIGPIPE, SIG_IGN);
+
+	if ((workers = calloc(cfg.workers, sizeof(*workers))) == NULL)
+		goto err;
+	for (i = 0; i < cfg.workers; i++) {
+		w = &workers[i];
+		w->maxconns = 64;
+		if ((w->conns = calloc(w->maxconns,
+		    sizeof(*w->conns))) == NULL)
+			goto err;
+		if ((w->pfds = calloc(w->maxconns + 1,
+		    sizeof(*w->pfds))) == NULL)
+			goto err;
+	}
+
+	for (started = 0; started < cfg.workers; started++) {
+		if ((error = pthread_create(&workers[started].thread, NULL,
+		    worker_run, &workers[started])) != 0) {
+			BIO_printf(bio_err, "pthread_create: %s\n",
+			    strerror(error));
+			break;
+		}
+	}
+	if (started != cfg.workers) {
+		/* Stop the workers that did start. */
+		pthread_mutex_lock(&worker_mutex);
+		worker_naccept = 0;
+		pthread_mutex_unlock(&worker_mutex);
+	}
+
+	for (i = 0; i < started; i++) {
+		w = &workers[i];
+		pthread_join(w->thread, NULL);
+		connections += w->connections;
+		resumed += w->resumed;
+		failed += w->failed;
+		bytes_written += w->bytes_written;
+	}
+
+	if (started != cfg.workers)
+		goto err;
+
+	BIO_printf(bio_s_out, "%ld connections, %ld resumed, %ld failed, "
+	    "%llu bytes written\n", connections, resumed, failed,
+	    bytes_written);
+
+	ret = 1;
+
+ err:
+	if (workers != NULL) {
+		for (i = 0; i < cfg.workers; i++) {
+			free(workers[i].conns);
+			free(workers[i].pfds);
+		}
+	}
+	free(workers);
+	free(worker_response);
+	worker_response = NULL;
+	close_accept_socket();
+
+	return ret;
+}
@@ -73,7 +73,6 @@
 
 #include "s_apps.h"
 
-static int init_server(int *sock, int port, int type);
 static int init_server_long(int *sock, int port, char *ip, int type);
 static int do_accept(int acc_sock, int *sock);
 
@@ -218,7 +217,7 @@ init_server_long(int *sock, int port, char *ip, int type)
 	return (ret);
 }
 
-static int
+int
 init_server(int *sock, int port, int type)
 {
 	return (init_server_long(sock, port, NULL, type));
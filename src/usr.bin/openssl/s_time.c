@@ -63,11 +63,17 @@
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/time.h>
 
+#include <errno.h>
+#include <netdb.h>
+#include <pthread.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <limits.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 #include <poll.h>
 
@@ -92,6 +98,7 @@ extern int verify_depth;
 static void s_time_usage(void);
 static int run_test(SSL *);
 static int benchmark(int);
+static int benchmark_concurrent(void);
 static void print_tally_mark(SSL *);
 
 static SSL_CTX *tm_ctx = NULL;
@@ -104,12 +111,15 @@ static struct {
 	char *CApath;
 	char *certfile;
 	char *cipher;
+	int concurrency;
 	char *host;
 	char *keyfile;
 	time_t maxtime;
 	int nbio;
 	int no_shutdown;
 	int perform;
+	int resume_ratio;
+	int threads;
 	int verify;
 	int verify_depth;
 	char *www_path;
@@ -150,6 +160,13 @@ static const struct option s_time_options[] = {
 		.type = OPTION_ARG,
 		.opt.arg = &cfg.cipher,
 	},
+	{
+		.name = "concurrency",
+		.argname = "num",
+		.desc = "Number of concurrent connections per thread",
+		.type = OPTION_ARG_INT,
+		.opt.value = &cfg.concurrency,
+	},
 	{
 		.name = "connect",
 		.argname = "host:port",
@@ -184,6 +201,14 @@ static const struct option s_time_options[] = {
 		.type = OPTION_FLAG,
 		.opt.flag = &cfg.no_shutdown,
 	},
+	{
+		.name = "resume_ratio",
+		.argname = "percent",
+		.desc = "Percentage of concurrent connections that resume a "
+		    "session",
+		.type = OPTION_ARG_INT,
+		.opt.value = &cfg.resume_ratio,
+	},
 	{
 		.name = "reuse",
 		.desc = "Reuse the same session ID for each connection",
@@ -191,6 +216,13 @@ static const struct option s_time_options[] = {
 		.opt.value = &cfg.perform,
 		.value = 2,
 	},
+	{
+		.name = "threads",
+		.argname = "num",
+		.desc = "Number of threads making concurrent connections",
+		.type = OPTION_ARG_INT,
+		.opt.value = &cfg.threads,
+	},
 	{
 		.name = "time",
 		.argname = "seconds",
@@ -221,9 +253,10 @@ s_time_usage(void)
 	fprintf(stderr,
 	    "usage: s_time "
 	    "[-bugs] [-CAfile file] [-CApath directory] [-cert file]\n"
-	    "    [-cipher cipherlist] [-connect host:port] [-key keyfile]\n"
-	    "    [-nbio] [-new] [-no_shutdown] [-reuse] [-time seconds]\n"
-	    "    [-verify depth] [-www page]\n\n");
+	    "    [-cipher cipherlist] [-concurrency num] [-connect host:port]\n"
+	    "    [-key keyfile] [-nbio] [-new] [-no_shutdown]\n"
+	    "    [-resume_ratio percent] [-reuse] [-threads num]\n"
+	    "    [-time seconds] [-verify depth] [-www page]\n\n");
 	options_usage(s_time_options);
 }
 
@@ -250,6 +283,7 @@ s_time_main(int argc, char **argv)
 	cfg.host = SSL_CONNECT_NAME;
 	cfg.maxtime = SECONDS;
 	cfg.perform = 3;
+	cfg.resume_ratio = -1;
 	cfg.verify = SSL_VERIFY_NONE;
 	cfg.verify_depth = -1;
 
@@ -270,6 +304,21 @@ s_time_main(int argc, char **argv)
 		goto end;
 	}
 
+	if (cfg.concurrency < 0 || cfg.concurrency > 4096) {
+		BIO_printf(bio_err, "-concurrency must be between 1 and "
+		    "4096\n");
+		goto end;
+	}
+	if (cfg.threads < 0 || cfg.threads > 256) {
+		BIO_printf(bio_err, "-threads must be between 1 and 256\n");
+		goto end;
+	}
+	if (cfg.resume_ratio < -1 || cfg.resume_ratio > 100) {
+		BIO_printf(bio_err, "-resume_ratio must be between 0 and "
+		    "100\n");
+		goto end;
+	}
+
 	if ((tm_ctx = SSL_CTX_new(s_time_meth)) == NULL)
 		return (1);
 
@@ -303,6 +352,24 @@ s_time_main(int argc, char **argv)
 		/* goto end; */
 	}
 
+	/*
+	 * Make concurrent connections from one or more threads, with an
+	 * optional mix of new and resumed sessions.
+	 */
+	if (cfg.concurrency > 0 || cfg.threads > 0 ||
+	    cfg.resume_ratio >= 0) {
+		if (cfg.concurrency == 0)
+			cfg.concurrency = 1;
+		if (cfg.threads == 0)
+			cfg.threads = 1;
+		if (cfg.resume_ratio < 0)
+			cfg.resume_ratio = (cfg.perform == 2) ? 100 : 0;
+		if (benchmark_concurrent())
+			goto end;
+		ret = 0;
+		goto end;
+	}
+
 	/* Loop and time how long it takes to make connections */
 	if (cfg.perform & 1) {
 		printf("Collecting connection statistics for %lld seconds\n",
@@ -463,3 +530,506 @@ benchmark(int reuse_session)
 	SSL_free(scon);
 	return ret;
 }
+
+/*
+ * Handshake latencies are recorded in microseconds, using a histogram with
+ * 16 linear sub-buckets for each power of two. This bounds the error of a
+ * reported percentile to 1/16th of its value.
+ */
+#define LATENCY_SUB_BUCKETS	16
+#define LATENCY_MAX_SHIFT	32
+#define LATENCY_BUCKETS		((LATENCY_MAX_SHIFT + 2) * LATENCY_SUB_BUCKETS)
+
+struct latency_histogram {
+	unsigned long long buckets[LATENCY_BUCKETS];
+	unsigned long long count;
+	unsigned long long max;
+};
+
+struct s_time_stats {
+	struct latency_histogram latency;
+	long connections;
+	long resumed;
+	long failed;
+	long bytes_read;
+};
+
+enum s_time_conn_state {
+	S_TIME_IDLE,
+	S_TIME_CONNECT,
+	S_TIME_HANDSHAKE,
+	S_TIME_REQUEST,
+	S_TIME_RESPONSE,
+};
+
+struct s_time_conn {
+	SSL *ssl;
+	int fd;
+	enum s_time_conn_state state;
+	short events;
+	struct timespec start;
+};
+
+struct s_time_thread {
+	pthread_t thread;
+	struct s_time_conn *conns;
+	struct pollfd *pfds;
+	SSL_SESSION *session;
+	struct s_time_stats stats;
+};
+
+static struct addrinfo *s_time_ai;
+static struct timespec s_time_deadline;
+static char s_time_request[MYBUFSIZ];
+static int s_time_request_len;
+
+static size_t
+latency_bucket(unsigned long long usec)
+{
+	int shift = 0;
+
+	while ((usec >> shift) >= 2 * LATENCY_SUB_BUCKETS) {
+		if (++shift > LATENCY_MAX_SHIFT)
+			return LATENCY_BUCKETS - 1;
+	}
+	if (shift == 0)
+		return usec;
+
+	return (shift + 1) * LATENCY_SUB_BUCKETS +
+	    (usec >> shift) - LATENCY_SUB_BUCKETS;
+}
+
+static unsigned long long
+latency_bucket_lower(size_t bucket)
+{
+	int shift;
+
+	if (bucket < 2 * LATENCY_SUB_BUCKETS)
+		return bucket;
+
+	shift = bucket / LATENCY_SUB_BUCKETS - 1;
+
+	return (unsigned long long)(bucket % LATENCY_SUB_BUCKETS +
+	    LATENCY_SUB_BUCKETS) << shift;
+}
+
+static unsigned long long
+latency_bucket_upper(size_t bucket)
+{
+	if (bucket + 1 >= LATENCY_BUCKETS)
+		return ULLONG_MAX;
+
+	return latency_bucket_lower(bucket + 1) - 1;
+}
+
+static void
+latency_record(struct latency_histogram *lh, const struct timespec *start)
+{
+	struct timespec now, duration;
+	unsigned long long usec;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	timespecsub(&now, start, &duration);
+
+	usec = duration.tv_sec * 1000000ULL + duration.tv_nsec / 1000;
+
+	lh->buckets[latency_bucket(usec)]++;
+	lh->count++;
+	if (usec > lh->max)
+		lh->max = usec;
+}
+
+static void
+latency_merge(struct latency_histogram *dst,
+    const struct latency_histogram *src)
+{
+	size_t i;
+
+	for (i = 0; i < LATENCY_BUCKETS; i++)
+		dst->buckets[i] += src->buckets[i];
+	dst->count += src->count;
+	if (src->max > dst->max)
+		dst->max = src->max;
+}
+
+/* Return the latency below which the given permille of samples fall. */
+static unsigned long long
+latency_percentile(const struct latency_histogram *lh, int permille)
+{
+	unsigned long long cumulative = 0, target, upper;
+	size_t i;
+
+	if (lh->count == 0)
+		return 0;
+
+	target = (lh->count * permille + 999) / 1000;
+	if (target == 0)
+		target = 1;
+
+	for (i = 0; i < LATENCY_BUCKETS; i++) {
+		cumulative += lh->buckets[i];
+		if (cumulative >= target)
+			break;
+	}
+
+	upper = latency_bucket_upper(i);
+
+	return upper < lh->max ? upper : lh->max;
+}
+
+static void
+latency_print(const struct latency_histogram *lh)
+{
+	unsigned long long counts[65] = { 0 };
+	unsigned long long cumulative = 0, lower;
+	size_t i;
+	int first = -1, last = -1, row;
+
+	if (lh->count == 0)
+		return;
+
+	printf("handshake latency: p50 %.3fms, p99 %.3fms, p99.9 %.3fms, "
+	    "max %.3fms\n", latency_percentile(lh, 500) / 1000.0,
+	    latency_percentile(lh, 990) / 1000.0,
+	    latency_percentile(lh, 999) / 1000.0, lh->max / 1000.0);
+
+	/* Summarise the histogram with one row per power of two. */
+	for (i = 0; i < LATENCY_BUCKETS; i++) {
+		if (lh->buckets[i] == 0)
+			continue;
+		lower = latency_bucket_lower(i);
+		for (row = 0; lower > 0; row++)
+			lower >>= 1;
+		counts[row] += lh->buckets[i];
+		if (first == -1)
+			first = row;
+		last = row;
+	}
+
+	for (row = first; row <= last; row++) {
+		cumulative += counts[row];
+		printf("%10.3fms - %10.3fms %10llu %6.2f%%\n",
+		    (row == 0 ? 0 : 1ULL << (row - 1)) / 1000.0,
+		    (1ULL << row) / 1000.0, counts[row],
+		    cumulative * 100.0 / lh->count);
+	}
+}
+
+static void
+s_time_conn_free(struct s_time_conn *conn)
+{
+	SSL_free(conn->ssl);
+	if (conn->fd != -1)
+		close(conn->fd);
+
+	conn->ssl = NULL;
+	conn->fd = -1;
+	conn->state = S_TIME_IDLE;
+	conn->events = 0;
+}
+
+static int
+s_time_conn_fail(struct s_time_thread *st, struct s_time_conn *conn)
+{
+	st->stats.failed++;
+	s_time_conn_free(conn);
+
+	return 1;
+}
+
+static int
+s_time_conn_done(struct s_time_thread *st, struct s_time_conn *conn)
+{
+	if (cfg.no_shutdown)
+		SSL_set_shutdown(conn->ssl, SSL_SENT_SHUTDOWN |
+		    SSL_RECEIVED_SHUTDOWN);
+	else
+		SSL_shutdown(conn->ssl);
+
+	st->stats.connections++;
+	s_time_conn_free(conn);
+
+	return 1;
+}
+
+/* Wait for the socket to become ready, or fail the connection. */
+static int
+s_time_conn_want(struct s_time_thread *st, struct s_time_conn *conn, int ret)
+{
+	switch (SSL_get_error(conn->ssl, ret)) {
+	case SSL_ERROR_WANT_READ:
+		conn->events = POLLIN;
+		return 0;
+	case SSL_ERROR_WANT_WRITE:
+		conn->events = POLLOUT;
+		return 0;
+	}
+
+	return s_time_conn_fail(st, conn);
+}
+
+static void
+s_time_conn_start(struct s_time_thread *st, struct s_time_conn *conn)
+{
+	clock_gettime(CLOCK_MONOTONIC, &conn->start);
+
+	if ((conn->fd = socket(s_time_ai->ai_family,
+	    s_time_ai->ai_socktype | SOCK_NONBLOCK,
+	    s_time_ai->ai_protocol)) == -1)
+		goto fail;
+	if ((conn->ssl = SSL_new(tm_ctx)) == NULL)
+		goto fail;
+	if (!SSL_set_fd(conn->ssl, conn->fd))
+		goto fail;
+	SSL_set_connect_state(conn->ssl);
+
+	if (st->session != NULL &&
+	    arc4random_uniform(100) < (uint32_t)cfg.resume_ratio) {
+		if (!SSL_set_session(conn->ssl, st->session))
+			goto fail;
+	}
+
+	conn->state = S_TIME_HANDSHAKE;
+	conn->events = POLLOUT;
+
+	if (connect(conn->fd, s_time_ai->ai_addr,
+	    s_time_ai->ai_addrlen) == -1) {
+		if (errno != EINPROGRESS)
+			goto fail;
+		conn->state = S_TIME_CONNECT;
+	}
+
+	return;
+
+ fail:
+	s_time_conn_fail(st, conn);
+}
+
+/*
+ * Advance a connection as far as possible without blocking, returning 1 if
+ * it has completed or failed.
+ */
+static int
+s_time_conn_io(struct s_time_thread *st, struct s_time_conn *conn)
+{
+	char buf[MYBUFSIZ];
+	socklen_t len;
+	int error, ret;
+
+	switch (conn->state) {
+	case S_TIME_IDLE:
+		return 1;
+
+	case S_TIME_CONNECT:
+		len = sizeof(error);
+		if (getsockopt(conn->fd, SOL_SOCKET, SO_ERROR, &error,
+		    &len) == -1 || error != 0)
+			return s_time_conn_fail(st, conn);
+		conn->state = S_TIME_HANDSHAKE;
+		/* FALLTHROUGH */
+
+	case S_TIME_HANDSHAKE:
+		if ((ret = SSL_connect(conn->ssl)) != 1)
+			return s_time_conn_want(st, conn, ret);
+
+		latency_record(&st->stats.latency, &conn->start);
+
+		if (SSL_session_reused(conn->ssl)) {
+			st->stats.resumed++;
+		} else if (cfg.resume_ratio > 0) {
+			SSL_SESSION_free(st->session);
+			st->session = SSL_get1_session(conn->ssl);
+		}
+
+		if (cfg.www_path == NULL)
+			return s_time_conn_done(st, conn);
+		conn->state = S_TIME_REQUEST;
+		/* FALLTHROUGH */
+
+	case S_TIME_REQUEST:
+		if ((ret = SSL_write(conn->ssl, s_time_request,
+		    s_time_request_len)) <= 0)
+			return s_time_conn_want(st, conn, ret);
+		conn->state = S_TIME_RESPONSE;
+		/* FALLTHROUGH */
+
+	case S_TIME_RESPONSE:
+		while ((ret = SSL_read(conn->ssl, buf, sizeof(buf))) > 0)
+			st->stats.bytes_read += ret;
+		switch (SSL_get_error(conn->ssl, ret)) {
+		case SSL_ERROR_WANT_READ:
+		case SSL_ERROR_WANT_WRITE:
+			return s_time_conn_want(st, conn, ret);
+		}
+		return s_time_conn_done(st, conn);
+	}
+
+	return 1;
+}
+
+static void *
+s_time_thread_run(void *arg)
+{
+	struct s_time_thread *st = arg;
+	struct s_time_conn *conn;
+	struct timespec now;
+	int i;
+
+	for (i = 0; i < cfg.concurrency; i++)
+		st->conns[i].fd = -1;
+
+	for (;;) {
+		/*
+		 * Connections that are still in progress at the end of
+		 * the run are abandoned, rather than extending it.
+		 */
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		if (timespeccmp(&now, &s_time_deadline, >=))
+			break;
+
+		for (i = 0; i < cfg.concurrency; i++) {
+			conn = &st->conns[i];
+			if (conn->state == S_TIME_IDLE)
+				s_time_conn_start(st, conn);
+			st->pfds[i].fd = conn->fd;
+			st->pfds[i].events = conn->events;
+			st->pfds[i].revents = 0;
+		}
+
+		if (poll(st->pfds, cfg.concurrency, 100) == -1) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+
+		for (i = 0; i < cfg.concurrency; i++) {
+			if (st->pfds[i].revents == 0)
+				continue;
+			s_time_conn_io(st, &st->conns[i]);
+		}
+	}
+
+	for (i = 0; i < cfg.concurrency; i++)
+		s_time_conn_free(&st->conns[i]);
+
+	return NULL;
+}
+
+static int
+benchmark_concurrent(void)
+{
+	struct s_time_thread *threads = NULL, *st;
+	struct s_time_stats stats;
+	struct addrinfo hints;
+	struct timespec start, end, duration;
+	char *hostport = NULL, *host, *port = PORT_STR;
+	double elapsed;
+	int i, error, started = 0;
+	int ret = 1;
+
+	if (cfg.www_path != NULL) {
+		s_time_request_len = snprintf(s_time_request,
+		    sizeof(s_time_request), "GET %s HTTP/1.0\r\n\r\n",
+		    cfg.www_path);
+		if (s_time_request_len < 0 ||
+		    s_time_request_len >= sizeof(s_time_request)) {
+			BIO_printf(bio_err, "URL too long\n");
+			goto end;
+		}
+	}
+
+	if ((hostport = strdup(cfg.host)) == NULL)
+		goto end;
+	if (!extract_host_port(hostport, &host, NULL, &port))
+		goto end;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	if ((error = getaddrinfo(host, port, &hints, &s_time_ai)) != 0) {
+		BIO_printf(bio_err, "getaddrinfo: %s\n", gai_strerror(error));
+		goto end;
+	}
+
+	signal(SIGPIPE, SIG_IGN);
+
+	if ((threads = calloc(cfg.threads, sizeof(*threads))) == NULL)
+		goto end;
+	for (i = 0; i < cfg.threads; i++) {
+		st = &threads[i];
+		if ((st->conns = calloc(cfg.concurrency,
+		    sizeof(*st->conns))) == NULL)
+			goto end;
+		if ((st->pfds = calloc(cfg.concurrency,
+		    sizeof(*st->pfds))) == NULL)
+			goto end;
+	}
+
+	printf("Collecting connection statistics for %lld seconds using "
+	    "%d threads with %d concurrent connections each\n",
+	    (long long)cfg.maxtime, cfg.threads, cfg.concurrency);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	s_time_deadline = start;
+	s_time_deadline.tv_sec += cfg.maxtime;
+
+	for (started = 0; started < cfg.threads; started++) {
+		if ((error = pthread_create(&threads[started].thread, NULL,
+		    s_time_thread_run, &threads[started])) != 0) {
+			BIO_printf(bio_err, "pthread_create: %s\n",
+			    strerror(error));
+			break;
+		}
+	}
+
+	memset(&stats, 0, sizeof(stats));
+	for (i = 0; i < started; i++) {
+		st = &threads[i];
+		pthread_join(st->thread, NULL);
+		latency_merge(&stats.latency, &st->stats.latency);
+		stats.connections += st->stats.connections;
+		stats.resumed += st->stats.resumed;
+		stats.failed += st->stats.failed;
+		stats.bytes_read += st->stats.bytes_read;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	timespecsub(&end, &start, &duration);
+	elapsed = duration.tv_sec + duration.tv_nsec / 1000000000.0;
+
+	if (started != cfg.threads)
+		goto end;
+
+	printf("\n%ld connections in %.2f real seconds, "
+	    "%.2f connections/sec\n", stats.connections, elapsed,
+	    stats.connections / elapsed);
+	printf("%ld handshakes, %ld resumed, %ld failed, "
+	    "%ld bytes read per connection\n", (long)stats.latency.count,
+	    stats.resumed, stats.failed, stats.connections > 0 ?
+	    stats.bytes_read / stats.connections : 0);
+	latency_print(&stats.latency);
+
+	if (stats.connections == 0) {
+		BIO_printf(bio_err, "Unable to get connection\n");
+		ERR_print_errors(bio_err);
+		goto end;
+	}
+
+	ret = 0;
+
+ end:
+	if (threads != NULL) {
+		for (i = 0; i < cfg.threads; i++) {
+			SSL_SESSION_free(threads[i].session);
+			free(threads[i].conns);
+			free(threads[i].pfds);
+		}
+	}
+	free(threads);
+	if (s_time_ai != NULL)
+		freeaddrinfo(s_time_ai);
+	s_time_ai = NULL;
+	free(hostport);
+
+	return ret;
+}
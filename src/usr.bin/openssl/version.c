@@ -137,6 +137,7 @@
 
 static struct {
 	int cflags;
+	int cpuinfo;
 	int date;
 	int dir;
 	int options;
@@ -148,6 +149,7 @@ static int
 version_all_opts(void)
 {
 	cfg.cflags = 1;
+	cfg.cpuinfo = 1;
 	cfg.date = 1;
 	cfg.dir= 1;
 	cfg.options = 1;
@@ -170,6 +172,12 @@ static const struct option version_options[] = {
 		.type = OPTION_FLAG,
 		.opt.flag = &cfg.date,
 	},
+	{
+		.name = "c",
+		.desc = "CPU capabilities and selected implementations",
+		.type = OPTION_FLAG,
+		.opt.flag = &cfg.cpuinfo,
+	},
 	{
 		.name = "d",
 		.desc = "OPENSSLDIR value",
@@ -206,7 +214,7 @@ static const struct option version_options[] = {
 static void
 version_usage(void)
 {
-	fprintf(stderr, "usage: version [-abdfopv]\n");
+	fprintf(stderr, "usage: version [-abcdfopv]\n");
 	options_usage(version_options);
 }
 
@@ -262,6 +270,16 @@ version_main(int argc, char **argv)
 		printf("%s\n", SSLeay_version(SSLEAY_CFLAGS));
 	if (cfg.dir)
 		printf("%s\n", SSLeay_version(SSLEAY_DIR));
+	if (cfg.cpuinfo) {
+		const char *primitive;
+		size_t i;
+
+		printf("cpu caps: 0x%016llx\n",
+		    (unsigned long long)OPENSSL_cpu_caps());
+		for (i = 0; (primitive = OPENSSL_cpu_impl_primitive(i)) != NULL;
+		    i++)
+			printf("%s: %s\n", primitive, OPENSSL_cpu_impl(primitive));
+	}
 
 	return (0);
 }
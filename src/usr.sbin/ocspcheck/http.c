@@ -25,16 +25,21 @@
 #include <err.h>
 #include <limits.h>
 #include <netdb.h>
+#include <poll.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <tls.h>
 #include <unistd.h>
 
 #include "http.h"
 #include <tls.h>
 
+#define HTTP_MAX_HEADSZ	(64 * 1024)
+#define HTTP_MAX_BODYSZ	(1024 * 1024)
+
 /*
  * A buffer for transferring HTTP/S data.
  */
@@ -204,6 +209,28 @@ http_disconnect(struct http *http)
 	http->ctx = NULL;
 }
 
+/*
+ * Check whether a connection can still be used for another request.
+ * A connection that has become readable while idle was closed by the
+ * server, and is disconnected here.
+ */
+int
+http_connected(struct http *http)
+{
+	struct pollfd	 pfd;
+
+	if (http->fd == -1)
+		return 0;
+
+	pfd.fd = http->fd;
+	pfd.events = POLLIN;
+	if (poll(&pfd, 1, 0) != 0) {
+		http_disconnect(http);
+		return 0;
+	}
+	return 1;
+}
+
 void
 http_free(struct http *http)
 {
@@ -568,6 +595,46 @@ http_head_parse(const struct http *http, struct httpxfer *trans, size_t *sz)
 	return h;
 }
 
+/*
+ * Terminate the headers read into the transfer buffer at ep, the end of
+ * headers marker, and move whatever follows it into the body buffer.
+ */
+static char *
+http_head_split(const struct http *http, struct httpxfer *trans, char *ep,
+    size_t *sz)
+{
+	*ep = '\0';
+
+	/*
+	 * The header data is invalid if it has any binary characters in
+	 * it: check that now.
+	 * This is important because we want to guarantee that all
+	 * header keys and pairs are properly NUL-terminated.
+	 */
+
+	if (strlen(trans->hbuf) != (uintptr_t)(ep - trans->hbuf)) {
+		warnx("%s: binary data in header", http->src.ip);
+		return NULL;
+	}
+
+	/*
+	 * Copy remaining buffer into body buffer.
+	 */
+
+	ep += 4;
+	trans->bbufsz = (trans->hbuf + trans->hbufsz) - ep;
+	trans->bbuf = malloc(trans->bbufsz);
+	if (trans->bbuf == NULL) {
+		warn("malloc");
+		return NULL;
+	}
+	memcpy(trans->bbuf, ep, trans->bbufsz);
+
+	trans->headok = 1;
+	*sz = trans->hbufsz;
+	return trans->hbuf;
+}
+
 /*
  * Read the HTTP headers from the wire.
  * If invoked multiple times, this will return the same pointer with the
@@ -628,36 +695,8 @@ http_head_read(const struct http *http, struct httpxfer *trans, size_t *sz)
 		warnx("%s: partial transfer", http->src.ip);
 		return NULL;
 	}
-	*ep = '\0';
 
-	/*
-	 * The header data is invalid if it has any binary characters in
-	 * it: check that now.
-	 * This is important because we want to guarantee that all
-	 * header keys and pairs are properly NUL-terminated.
-	 */
-
-	if (strlen(trans->hbuf) != (uintptr_t)(ep - trans->hbuf)) {
-		warnx("%s: binary data in header", http->src.ip);
-		return NULL;
-	}
-
-	/*
-	 * Copy remaining buffer into body buffer.
-	 */
-
-	ep += 4;
-	trans->bbufsz = (trans->hbuf + trans->hbufsz) - ep;
-	trans->bbuf = malloc(trans->bbufsz);
-	if (trans->bbuf == NULL) {
-		warn("malloc");
-		return NULL;
-	}
-	memcpy(trans->bbuf, ep, trans->bbufsz);
-
-	trans->headok = 1;
-	*sz = trans->hbufsz;
-	return trans->hbuf;
+	return http_head_split(http, trans, ep, sz);
 }
 
 void
@@ -731,6 +770,179 @@ http_get(const struct source *addrs, size_t addrsz, const char *domain,
 	return g;
 }
 
+/*
+ * Append sz bytes from buf to the buffer *p of size *psz.
+ */
+static int
+http_append(char **p, size_t *psz, const char *buf, size_t sz)
+{
+	void	*pp;
+
+	pp = recallocarray(*p, *psz, *psz + sz, 1);
+	if (pp == NULL) {
+		warn("recallocarray");
+		return -1;
+	}
+	*p = pp;
+	memcpy(*p + *psz, buf, sz);
+	*psz += sz;
+	return 0;
+}
+
+/*
+ * Send an HTTP/1.1 POST for path on a connection from http_alloc() and
+ * read the response, whose body must be delimited by its Content-Length.
+ * Unlike http_get(), the connection is left open so that further
+ * requests to the same server can reuse it, unless the server is going
+ * to close it: use http_connected() to check before the next request.
+ * On failure the connection is always closed.
+ * The returned object does not own the connection.
+ */
+struct httpget *
+http_post(struct http *http, const char *path, const void *post,
+    size_t postsz)
+{
+	char		 buf[BUFSIZ];
+	char		*req, *ep, *headr;
+	const char	*errstr;
+	struct httpxfer	*x = NULL;
+	struct httpget	*g;
+	struct httphead	*head;
+	size_t		 i, headsz, headrsz, clen = 0;
+	ssize_t		 ssz;
+	int		 c, code, keepalive, haveclen = 0;
+
+	if (!http_connected(http)) {
+		warnx("%s: not connected", http->src.ip);
+		return NULL;
+	}
+
+	c = asprintf(&req,
+	    "POST %s HTTP/1.1\r\n"
+	    "Host: %s\r\n"
+	    "Content-Type: application/ocsp-request\r\n"
+	    "Content-Length: %zu\r\n"
+	    "\r\n",
+	    path, http->host, postsz);
+	if (c == -1) {
+		warn("asprintf");
+		goto err;
+	}
+	if (http_write(req, c, http) == -1 ||
+	    http_write(post, postsz, http) == -1) {
+		free(req);
+		goto err;
+	}
+	free(req);
+
+	if ((x = calloc(1, sizeof(struct httpxfer))) == NULL) {
+		warn("calloc");
+		goto err;
+	}
+
+	/*
+	 * Read no further than what the server has sent, since nothing
+	 * more will come until the next request.
+	 */
+	ep = NULL;
+	while (ep == NULL) {
+		if ((ssz = http->reader(buf, sizeof(buf), http)) < 0)
+			goto err;
+		if (ssz == 0) {
+			warnx("%s: connection closed", http->src.ip);
+			goto err;
+		}
+		if (x->hbufsz + ssz > HTTP_MAX_HEADSZ) {
+			warnx("%s: header too large", http->src.ip);
+			goto err;
+		}
+		if (http_append(&x->hbuf, &x->hbufsz, buf, ssz) == -1)
+			goto err;
+		ep = memmem(x->hbuf, x->hbufsz, "\r\n\r\n", 4);
+	}
+	if ((headr = http_head_split(http, x, ep, &headrsz)) == NULL)
+		goto err;
+	if ((head = http_head_parse(http, x, &headsz)) == NULL)
+		goto err;
+	if ((code = http_head_status(http, head, headsz)) < 0)
+		goto err;
+
+	keepalive = strncmp(head[0].val, "HTTP/1.1 ", 9) == 0;
+	for (i = 1; i < headsz; i++) {
+		if (strcasecmp(head[i].key, "Content-Length") == 0) {
+			clen = strtonum(head[i].val, 0, HTTP_MAX_BODYSZ,
+			    &errstr);
+			if (errstr != NULL) {
+				warnx("%s: Content-Length %s: %s",
+				    http->src.ip, errstr, head[i].val);
+				goto err;
+			}
+			haveclen = 1;
+		} else if (strcasecmp(head[i].key, "Connection") == 0) {
+			if (strcasecmp(head[i].val, "close") == 0)
+				keepalive = 0;
+			else if (strcasecmp(head[i].val, "keep-alive") == 0)
+				keepalive = 1;
+		} else if (strcasecmp(head[i].key,
+		    "Transfer-Encoding") == 0) {
+			warnx("%s: unsupported transfer encoding %s",
+			    http->src.ip, head[i].val);
+			goto err;
+		}
+	}
+
+	/* Without a length, the body runs until the connection closes. */
+	if (!haveclen) {
+		keepalive = 0;
+		clen = HTTP_MAX_BODYSZ;
+	}
+	if (x->bbufsz > clen) {
+		x->bbufsz = clen;
+		keepalive = 0;
+	}
+	while (x->bbufsz < clen) {
+		ssz = sizeof(buf);
+		if (clen - x->bbufsz < sizeof(buf))
+			ssz = clen - x->bbufsz;
+		if ((ssz = http->reader(buf, ssz, http)) < 0)
+			goto err;
+		if (ssz == 0) {
+			if (!haveclen)
+				break;
+			warnx("%s: partial transfer", http->src.ip);
+			goto err;
+		}
+		if (http_append(&x->bbuf, &x->bbufsz, buf, ssz) == -1)
+			goto err;
+	}
+	x->bodyok = 1;
+
+	if (!keepalive)
+		http_disconnect(http);
+
+	if ((g = calloc(1, sizeof(struct httpget))) == NULL) {
+		warn("calloc");
+		http_close(x);
+		return NULL;
+	}
+
+	g->headpart = headr;
+	g->headpartsz = headrsz;
+	g->bodypart = x->bbuf;
+	g->bodypartsz = x->bbufsz;
+	g->head = head;
+	g->headsz = headsz;
+	g->code = code;
+	g->xfer = x;
+	g->http = NULL;
+	return g;
+
+ err:
+	http_close(x);
+	http_disconnect(http);
+	return NULL;
+}
+
 #if 0
 int
 main(void)
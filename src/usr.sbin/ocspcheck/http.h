@@ -68,6 +68,8 @@ struct httpget	*http_get(const struct source *, size_t,
 			const char *, short, const char *,
 			const void *, size_t);
 void		 http_get_free(struct httpget *);
+struct httpget	*http_post(struct http *, const char *,
+			const void *, size_t);
 
 /* Allocation and release. */
 struct http	*http_alloc(const struct source *, size_t,
@@ -76,6 +78,7 @@ void		 http_free(struct http *);
 struct httpxfer	*http_open(const struct http *, const void *, size_t);
 void		 http_close(struct httpxfer *);
 void		 http_disconnect(struct http *);
+int		 http_connected(struct http *);
 
 /* Access. */
 char		*http_head_read(const struct http *,
@@ -20,12 +20,15 @@
 #include <netinet/in.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
 
 #include <err.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <limits.h>
 #include <netdb.h>
 #include <poll.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -34,6 +37,7 @@
 
 #include <openssl/err.h>
 #include <openssl/ocsp.h>
+#include <openssl/sha.h>
 #include <openssl/ssl.h>
 
 #include "http.h"
@@ -41,6 +45,8 @@
 #define MAXAGE_SEC (14*24*60*60)
 #define JITTER_SEC (60)
 #define OCSP_MAX_RESPONSE_SIZE (20480)
+#define BATCH_JOBS (8)
+#define BATCH_MAX_JOBS (256)
 
 typedef struct ocsp_request {
 	STACK_OF(X509) *fullchain;
@@ -307,7 +313,7 @@ issuer_from_chain(STACK_OF(X509) *fullchain)
 }
 
 static ocsp_request *
-ocsp_request_new_from_cert(const char *cadir, char *file, int nonce)
+ocsp_request_new_from_cert(char *file, int nonce)
 {
 	X509 *cert;
 	int count = 0;
@@ -326,11 +332,6 @@ ocsp_request_new_from_cert(const char *cadir, char *file, int nonce)
 		goto err;
 
 	request->fullchain = read_fullchain(file, &count);
-	if (cadir == NULL) {
-		/* Drop rpath from pledge, we don't need to read anymore */
-		if (pledge("stdio inet dns", NULL) == -1)
-			err(1, "pledge");
-	}
 	if (request->fullchain == NULL) {
 		warnx("Unable to read cert chain from file %s", file);
 		goto err;
@@ -400,7 +401,7 @@ ocsp_request_new_from_cert(const char *cadir, char *file, int nonce)
 
 int
 validate_response(char *buf, size_t size, ocsp_request *request,
-    X509_STORE *store, char *host, char *file)
+    X509_STORE *store, char *host, char *file, time_t *refresh)
 {
 	ASN1_GENERALIZEDTIME *revtime = NULL, *thisupd = NULL, *nextupd = NULL;
 	const unsigned char **p = (const unsigned char **)&buf;
@@ -527,6 +528,10 @@ validate_response(char *buf, size_t size, ocsp_request *request,
 	vspew("OCSP response validated from %s\n", host);
 	vspew("	   This Update: %s", ctime(&this_t));
 	vspew("	   Next Update: %s", ctime(&next_t));
+
+	/* Refresh once half of the validity period has passed. */
+	if (refresh != NULL)
+		*refresh = this_t + (next_t - this_t) / 2;
 	ret = 1;
  err:
 	OCSP_RESPONSE_free(resp);
@@ -535,37 +540,415 @@ validate_response(char *buf, size_t size, ocsp_request *request,
 	return ret;
 }
 
+static char *
+read_staple(int fd, size_t *size)
+{
+	char *buf;
+	ssize_t nr;
+
+	*size = 0;
+	if ((buf = calloc(OCSP_MAX_RESPONSE_SIZE, 1)) == NULL)
+		return NULL;
+	while ((nr = read(fd, buf + *size,
+	    OCSP_MAX_RESPONSE_SIZE - *size)) != -1 && nr != 0)
+		*size += nr;
+	return buf;
+}
+
+static int
+write_staple(int fd, const char *buf, size_t size)
+{
+	size_t written;
+	ssize_t w;
+
+	while (ftruncate(fd, 0) < 0) {
+		if (errno == EINVAL)
+			break;
+		if (errno != EINTR && errno != EAGAIN)
+			return -1;
+	}
+	written = 0;
+	while (written < size) {
+		w = write(fd, buf + written, size - written);
+		if (w == -1) {
+			if (errno != EINTR && errno != EAGAIN)
+				return -1;
+		} else
+			written += w;
+	}
+	return 0;
+}
+
+/*
+ * A certificate checked in batch mode, and where its OCSP response is
+ * kept.
+ */
+struct batch_cert {
+	ocsp_request *request;
+	char *file;
+	char *host;
+	char *path;
+	short port;
+	char *cachefile;
+};
+
+/*
+ * The cache file for a certificate is named for the SHA-256 hash of the
+ * DER encoded CertID in its request, which is the same for every
+ * request made for that certificate.
+ */
+static char *
+cache_path(const char *dir, ocsp_request *request)
+{
+	OCSP_ONEREQ *one;
+	unsigned char *der = NULL, md[SHA256_DIGEST_LENGTH];
+	char hex[SHA256_DIGEST_LENGTH * 2 + 1], *path;
+	int i, len;
+
+	if ((one = OCSP_request_onereq_get0(request->req, 0)) == NULL)
+		return NULL;
+	if ((len = i2d_OCSP_CERTID(OCSP_onereq_get0_id(one), &der)) <= 0)
+		return NULL;
+	SHA256(der, len, md);
+	free(der);
+
+	for (i = 0; i < SHA256_DIGEST_LENGTH; i++)
+		snprintf(hex + i * 2, 3, "%02x", md[i]);
+	if (asprintf(&path, "%s/%s.der", dir, hex) == -1)
+		return NULL;
+	return path;
+}
+
+/*
+ * Check whether a still valid response for the certificate is cached
+ * that does not need to be refreshed yet.
+ */
+static int
+cache_fresh(struct batch_cert *bc, X509_STORE *store)
+{
+	char *buf;
+	size_t size;
+	time_t refresh;
+	int fd, nonce, ret = 0;
+
+	if ((fd = open(bc->cachefile, O_RDONLY)) == -1) {
+		if (errno != ENOENT)
+			warn("Unable to open cached response %s",
+			    bc->cachefile);
+		return 0;
+	}
+	buf = read_staple(fd, &size);
+	close(fd);
+	if (buf == NULL || size == 0)
+		goto done;
+
+	dspew("Using ocsp response saved in %s:\n", bc->cachefile);
+
+	/* Can't validate a nonce on a saved reply */
+	nonce = bc->request->nonce;
+	bc->request->nonce = 0;
+	if (validate_response(buf, size, bc->request, store, bc->host,
+	    bc->file, &refresh) && time(NULL) < refresh)
+		ret = 1;
+	bc->request->nonce = nonce;
+
+ done:
+	free(buf);
+	return ret;
+}
+
+static int
+cache_write(const char *cachefile, const char *buf, size_t size)
+{
+	char *tmp;
+	int fd;
+
+	if (asprintf(&tmp, "%s.XXXXXXXXXX", cachefile) == -1)
+		return -1;
+	if ((fd = mkstemp(tmp)) == -1)
+		goto err;
+	if (fchmod(fd, S_IWUSR|S_IRUSR|S_IRGRP|S_IROTH) == -1 ||
+	    write_staple(fd, buf, size) == -1) {
+		close(fd);
+		unlink(tmp);
+		goto err;
+	}
+	if (close(fd) == -1 || rename(tmp, cachefile) == -1) {
+		unlink(tmp);
+		goto err;
+	}
+	free(tmp);
+	return 0;
+
+ err:
+	free(tmp);
+	return -1;
+}
+
+static int
+batch_cmp(const void *a, const void *b)
+{
+	const struct batch_cert *ba = a, *bb = b;
+	int c;
+
+	if ((c = strcmp(ba->host, bb->host)) != 0)
+		return c;
+	return ba->port - bb->port;
+}
+
+/*
+ * Fetch and save the responses for a run of certificates sorted by
+ * responder, keeping one connection open to each responder in turn.
+ * Returns the number of certificates that failed.
+ */
+static int
+batch_fetch(struct batch_cert *bc, size_t count, X509_STORE *store)
+{
+	struct addr addrs[MAX_SERVERS_DNS] = {{0}};
+	struct source sources[MAX_SERVERS_DNS];
+	struct http *conn = NULL;
+	struct httpget *hget;
+	ssize_t rescount = 0;
+	size_t i;
+	int j, failed = 0;
+
+	for (i = 0; i < count; i++, bc++) {
+		if (i == 0 || strcmp(bc->host, bc[-1].host) != 0 ||
+		    bc->port != bc[-1].port) {
+			http_free(conn);
+			conn = NULL;
+
+			vspew("Using %s to host %s, port %d\n",
+			    bc->port == 443 ? "https" : "http", bc->host,
+			    bc->port);
+
+			if ((rescount = host_dns(bc->host, addrs)) < 0)
+				rescount = 0;
+			for (j = 0; j < rescount; j++) {
+				sources[j].ip = addrs[j].ip;
+				sources[j].family = addrs[j].family;
+			}
+		}
+
+		if (conn != NULL && !http_connected(conn)) {
+			http_free(conn);
+			conn = NULL;
+		}
+		if (conn == NULL)
+			conn = http_alloc(sources, rescount, bc->host,
+			    bc->port, bc->path);
+		hget = NULL;
+		if (conn != NULL)
+			hget = http_post(conn, bc->path, bc->request->data,
+			    bc->request->size);
+		if (hget == NULL) {
+			/*
+			 * The responder may have dropped the idle connection
+			 * or not speak HTTP/1.1, so retry the request once
+			 * on a connection of its own.
+			 */
+			hget = http_get(sources, rescount, bc->host, bc->port,
+			    bc->path, bc->request->data, bc->request->size);
+		}
+		if (hget == NULL) {
+			warnx("Unable to fetch OCSP response for %s from %s",
+			    bc->file, bc->host);
+			failed++;
+			continue;
+		}
+
+		dspew("Server at %s returns:\n", bc->host);
+		dspew("	  [Body]=[%zu bytes]\n", hget->bodypartsz);
+		if (hget->bodypartsz <= 0) {
+			warnx("No body in reply from %s for %s", bc->host,
+			    bc->file);
+			failed++;
+		} else if (hget->code != 200) {
+			warnx("http reply code %d from %s for %s", hget->code,
+			    bc->host, bc->file);
+			failed++;
+		} else if (hget->bodypartsz > OCSP_MAX_RESPONSE_SIZE) {
+			warnx("OCSP response from %s for %s too large "
+			    "(%zu > %d bytes)", bc->host, bc->file,
+			    hget->bodypartsz, OCSP_MAX_RESPONSE_SIZE);
+			failed++;
+		} else if (!validate_response(hget->bodypart,
+		    hget->bodypartsz, bc->request, store, bc->host,
+		    bc->file, NULL)) {
+			failed++;
+		} else if (cache_write(bc->cachefile, hget->bodypart,
+		    hget->bodypartsz) == -1) {
+			warn("Write of OCSP response to %s failed",
+			    bc->cachefile);
+			failed++;
+		} else
+			vspew("%s: OCSP response saved in %s\n", bc->file,
+			    bc->cachefile);
+		http_get_free(hget);
+	}
+	http_free(conn);
+
+	return failed;
+}
+
+/*
+ * Check many certificates at once, keeping their responses in cachedir.
+ * Certificates whose cached response is still fresh are skipped, and
+ * the others are fetched by up to jobs processes in parallel.
+ */
+static int
+batch(const char *cafile, const char *cadir, const char *cachedir,
+    int argc, char **argv, int nonce, int jobs)
+{
+	struct batch_cert *bc;
+	X509_STORE *castore;
+	size_t i, count = 0, start, end;
+	pid_t *pids;
+	int n, status, failed = 0;
+
+	if ((bc = calloc(argc, sizeof(*bc))) == NULL)
+		err(1, NULL);
+
+	/*
+	 * Load all the certificates first, as there may be too many of
+	 * them to unveil one by one.
+	 */
+	for (n = 0; n < argc; n++) {
+		bc[count].file = argv[n];
+		if ((bc[count].request = ocsp_request_new_from_cert(argv[n],
+		    nonce)) == NULL) {
+			failed++;
+			continue;
+		}
+		if ((bc[count].host = url2host(bc[count].request->url,
+		    &bc[count].port, &bc[count].path)) == NULL) {
+			warnx("Invalid OCSP url %s from %s",
+			    bc[count].request->url, argv[n]);
+			failed++;
+			continue;
+		}
+		if ((bc[count].cachefile = cache_path(cachedir,
+		    bc[count].request)) == NULL) {
+			warnx("Unable to get certificate id from cert in %s",
+			    argv[n]);
+			failed++;
+			continue;
+		}
+		count++;
+	}
+
+	if (cafile != NULL) {
+		if (unveil(cafile, "r") == -1)
+			err(1, "unveil %s", cafile);
+	}
+	if (cadir != NULL) {
+		if (unveil(cadir, "r") == -1)
+			err(1, "unveil %s", cadir);
+	}
+	if (unveil(cachedir, "rwc") == -1)
+		err(1, "unveil %s", cachedir);
+
+	if (pledge("stdio inet rpath wpath cpath dns proc", NULL) == -1)
+		err(1, "pledge");
+
+	/* The store is shared with the fetching processes. */
+	if ((castore = read_cacerts(cafile, cadir)) == NULL)
+		exit(1);
+	OPENSSL_add_all_algorithms_noconf();
+
+	for (i = 0, end = 0; i < count; i++) {
+		if (cache_fresh(&bc[i], castore)) {
+			vspew("%s: cached OCSP response %s is fresh\n",
+			    bc[i].file, bc[i].cachefile);
+			continue;
+		}
+		bc[end++] = bc[i];
+	}
+	count = end;
+	if (count == 0)
+		return failed ? 1 : 0;
+
+	/*
+	 * Sort by responder and hand each process a contiguous run, so
+	 * that it can reuse its connection to the responder.
+	 */
+	qsort(bc, count, sizeof(*bc), batch_cmp);
+
+	if (jobs > count)
+		jobs = count;
+	if ((pids = calloc(jobs, sizeof(*pids))) == NULL)
+		err(1, NULL);
+
+	/* A responder closing the connection must not kill us. */
+	signal(SIGPIPE, SIG_IGN);
+
+	for (n = 0; n < jobs; n++) {
+		start = count * n / jobs;
+		end = count * (n + 1) / jobs;
+		switch (pids[n] = fork()) {
+		case -1:
+			err(1, "fork");
+		case 0:
+			if (pledge("stdio inet rpath wpath cpath dns",
+			    NULL) == -1)
+				err(1, "pledge");
+			_exit(batch_fetch(&bc[start], end - start,
+			    castore) != 0);
+		}
+	}
+	for (n = 0; n < jobs; n++) {
+		if (waitpid(pids[n], &status, 0) == -1)
+			err(1, "waitpid");
+		if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+			failed++;
+	}
+	free(pids);
+
+	return failed ? 1 : 0;
+}
+
 static void
 usage(void)
 {
 	fprintf(stderr,
 	    "usage: ocspcheck [-Nv] [-C CAfile] [-i staplefile] "
-	    "[-o staplefile] file\n");
+	    "[-o staplefile] file\n"
+	    "       ocspcheck [-Nv] [-C CAfile] [-j jobs] -d cachedir "
+	    "file ...\n");
 	exit(1);
 }
 
 int
 main(int argc, char **argv)
 {
-	const char *cafile = NULL, *cadir = NULL;
+	const char *cafile = NULL, *cadir = NULL, *cachedir = NULL;
+	const char *errstr;
 	char *host = NULL, *path = NULL, *certfile = NULL, *outfile = NULL,
 	    *instaple = NULL, *infile = NULL;
 	struct addr addrs[MAX_SERVERS_DNS] = {{0}};
 	struct source sources[MAX_SERVERS_DNS];
-	int i, ch, staplefd = -1, infd = -1, nonce = 1;
+	int i, ch, staplefd = -1, infd = -1, nonce = 1, jobs = BATCH_JOBS;
 	ocsp_request *request = NULL;
 	size_t rescount, httphsz = 0, instaplesz = 0;
 	struct httphead	*httph = NULL;
 	struct httpget *hget;
 	X509_STORE *castore;
-	ssize_t written, w;
 	short port;
 
-	while ((ch = getopt(argc, argv, "C:i:No:v")) != -1) {
+	while ((ch = getopt(argc, argv, "C:d:i:j:No:v")) != -1) {
 		switch (ch) {
 		case 'C':
 			cafile = optarg;
 			break;
+		case 'd':
+			cachedir = optarg;
+			break;
+		case 'j':
+			jobs = strtonum(optarg, 1, BATCH_MAX_JOBS, &errstr);
+			if (errstr != NULL)
+				errx(1, "number of jobs is %s: %s", errstr,
+				    optarg);
+			break;
 		case 'N':
 			nonce = 0;
 			break;
@@ -585,7 +968,10 @@ main(int argc, char **argv)
 	argc -= optind;
 	argv += optind;
 
-	if (argc != 1 || (certfile = argv[0]) == NULL)
+	if (cachedir != NULL) {
+		if (argc < 1 || infile != NULL || outfile != NULL)
+			usage();
+	} else if (argc != 1 || (certfile = argv[0]) == NULL)
 		usage();
 
 	if (outfile != NULL) {
@@ -615,6 +1001,9 @@ main(int argc, char **argv)
 			cadir = X509_get_default_cert_dir();
 	}
 
+	if (cachedir != NULL)
+		exit(batch(cafile, cadir, cachedir, argc, argv, nonce, jobs));
+
 	if (cafile != NULL) {
 		if (unveil(cafile, "r") == -1)
 			err(1, "unveil %s", cafile);
@@ -636,9 +1025,13 @@ main(int argc, char **argv)
 	 */
 	if ((castore = read_cacerts(cafile, cadir)) == NULL)
 		exit(1);
-	if ((request = ocsp_request_new_from_cert(cadir, certfile, nonce))
-	    == NULL)
+	if ((request = ocsp_request_new_from_cert(certfile, nonce)) == NULL)
 		exit(1);
+	if (cadir == NULL) {
+		/* Drop rpath from pledge, we don't need to read anymore */
+		if (pledge("stdio inet dns", NULL) == -1)
+			err(1, "pledge");
+	}
 
 	dspew("Built an %zu byte ocsp request\n", request->size);
 
@@ -694,14 +1087,11 @@ main(int argc, char **argv)
 		 */
 		OPENSSL_add_all_algorithms_noconf();
 		if (!validate_response(hget->bodypart, hget->bodypartsz,
-			request, castore, host, certfile))
+			request, castore, host, certfile, NULL))
 			exit(1);
 		instaple = hget->bodypart;
 		instaplesz = hget->bodypartsz;
 	} else {
-		size_t nr = 0;
-		instaplesz = 0;
-
 		/*
 		 * Pledge minimally before fiddling with libcrypto init
 		 */
@@ -716,13 +1106,7 @@ main(int argc, char **argv)
 		dspew("Using ocsp response saved in %s:\n", infile);
 
 		/* Use the existing OCSP response saved in infd */
-		instaple = calloc(OCSP_MAX_RESPONSE_SIZE, 1);
-		if (instaple) {
-			while ((nr = read(infd, instaple + instaplesz,
-			    OCSP_MAX_RESPONSE_SIZE - instaplesz)) != -1 &&
-			    nr != 0)
-				instaplesz += nr;
-		}
+		instaple = read_staple(infd, &instaplesz);
 		if (instaplesz == 0)
 			exit(1);
 		/*
@@ -730,7 +1114,7 @@ main(int argc, char **argv)
 		 */
 		OPENSSL_add_all_algorithms_noconf();
 		if (!validate_response(instaple, instaplesz,
-			request, castore, host, certfile))
+			request, castore, host, certfile, NULL))
 			exit(1);
 	}
 
@@ -739,22 +1123,8 @@ main(int argc, char **argv)
 	 * write out the DER format response to the staplefd
 	 */
 	if (staplefd >= 0) {
-		while (ftruncate(staplefd, 0) < 0) {
-			if (errno == EINVAL)
-				break;
-			if (errno != EINTR && errno != EAGAIN)
-				err(1, "Write of OCSP response failed");
-		}
-		written = 0;
-		while (written < instaplesz) {
-			w = write(staplefd, instaple + written,
-			    instaplesz - written);
-			if (w == -1) {
-				if (errno != EINTR && errno != EAGAIN)
-					err(1, "Write of OCSP response failed");
-			} else
-				written += w;
-		}
+		if (write_staple(staplefd, instaple, instaplesz) == -1)
+			err(1, "Write of OCSP response failed");
 		close(staplefd);
 	}
 	exit(0);